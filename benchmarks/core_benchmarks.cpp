@@ -0,0 +1,724 @@
+#include "micro_benchmark.hpp"
+#include "components/transform.hpp"
+#include "core/assert.hpp"
+#include "core/camera.hpp"
+#include "graphics/light_clusters.hpp"
+#include "graphics/occlusion_culling.hpp"
+#include "graphics/shadow_cascades.hpp"
+#include "graphics/vulkan.hpp"
+#include "lz4/lz4.h"
+#include "resource/image.hpp"
+#include "resource/material.hpp"
+#include "resource/model.hpp"
+#include "resource/resource_manager.hpp"
+#include "resource/resource_version_numbers.hpp"
+#include "resource/script.hpp"
+#include "resource/shader.hpp"
+#include "utils/json_parsing.hpp"
+#include "utils/logger.hpp"
+#include "utils/random.hpp"
+#include "utils/serialize.hpp"
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <streambuf>
+
+using namespace Progression;
+
+// Micro benchmarks for the engine primitives that the frame and load times are built from. Run
+// with -o FILE to get Google Benchmark style JSON that can be diffed across commits
+
+enum class FastfileSection
+{
+    SHADERS,
+    IMAGES,
+    MATERIALS,
+    MODELS,
+    SCRIPTS
+};
+
+static Model CreateGridModel( uint32_t quadsPerSide )
+{
+    Model model;
+    uint32_t vertsPerSide = quadsPerSide + 1;
+    for ( uint32_t z = 0; z < vertsPerSide; ++z )
+    {
+        for ( uint32_t x = 0; x < vertsPerSide; ++x )
+        {
+            float u = static_cast< float >( x ) / quadsPerSide;
+            float v = static_cast< float >( z ) / quadsPerSide;
+            model.vertices.emplace_back( u - 0.5f, 0.1f * std::sin( 10 * u ) * std::cos( 10 * v ), v - 0.5f );
+            model.normals.emplace_back( 0, 1, 0 );
+            model.uvs.emplace_back( u, v );
+        }
+    }
+    for ( uint32_t z = 0; z < quadsPerSide; ++z )
+    {
+        for ( uint32_t x = 0; x < quadsPerSide; ++x )
+        {
+            uint32_t i = z * vertsPerSide + x;
+            model.indices.insert( model.indices.end(), { i, i + vertsPerSide, i + 1, i + 1, i + vertsPerSide, i + vertsPerSide + 1 } );
+        }
+    }
+
+    Mesh mesh;
+    mesh.name          = "grid";
+    mesh.materialIndex = 0;
+    mesh.numIndices    = static_cast< uint32_t >( model.indices.size() );
+    mesh.numVertices   = static_cast< uint32_t >( model.vertices.size() );
+    model.meshes.push_back( mesh );
+    model.materials.push_back( std::make_shared< Material >() );
+    model.materials[0]->name = "gridMaterial";
+    model.RecalculateAABB();
+
+    return model;
+}
+
+static void WriteShader( std::ofstream& out, uint32_t index )
+{
+    ShaderReflectInfo reflectInfo;
+    reflectInfo.entryPoint      = "main";
+    reflectInfo.stage           = Gfx::ShaderStage::FRAGMENT;
+    reflectInfo.inputLocations  = { { "inPosition", 0 }, { "inNormal", 1 }, { "inTexCoord", 2 } };
+    reflectInfo.outputLocations = { { "outColor", 0 } };
+    std::vector< char > spirv( 16 * 1024, 0 );
+
+    // Same layout as the shader converter writes, with no descriptor sets
+    serialize::Write( out, "shader" + std::to_string( index ) );
+    serialize::Write( out, reflectInfo.entryPoint );
+    serialize::Write( out, reflectInfo.stage );
+    serialize::Write( out, reflectInfo.inputLocations.size() );
+    for ( const auto& [varName, varLoc] : reflectInfo.inputLocations )
+    {
+        serialize::Write( out, varName );
+        serialize::Write( out, varLoc );
+    }
+    serialize::Write( out, reflectInfo.outputLocations.size() );
+    for ( const auto& [varName, varLoc] : reflectInfo.outputLocations )
+    {
+        serialize::Write( out, varName );
+        serialize::Write( out, varLoc );
+    }
+    serialize::Write( out, reflectInfo.descriptorSetLayouts.size() );
+    serialize::Write( out, reflectInfo.pushConstants );
+    serialize::Write( out, spirv );
+}
+
+static void WriteImage( std::ofstream& out, uint32_t index )
+{
+    Gfx::ImageDescriptor desc;
+    desc.format = Gfx::PixelFormat::R8_G8_B8_A8_UNORM;
+    desc.width  = 256;
+    desc.height = 256;
+    Image image( desc );
+    for ( size_t i = 0; i < image.GetTotalImageBytes(); ++i )
+    {
+        image.GetPixels()[i] = static_cast< unsigned char >( i * 7 );
+    }
+
+    // No GPU texture, keep the CPU copy
+    serialize::Write( out, "image" + std::to_string( index ) );
+    serialize::Write( out, static_cast< ImageFlags >( 0 ) );
+    serialize::Write( out, desc.sampler );
+    image.Serialize( out );
+}
+
+static void WriteMaterial( std::ofstream& out, uint32_t index )
+{
+    Material material;
+    material.name = "material" + std::to_string( index );
+    material.Kd   = glm::vec3( 0.8f, 0.2f, 0.2f );
+    material.Ks   = glm::vec3( 0.5f );
+    material.Ns   = 32;
+    material.Serialize( out );
+}
+
+static void WriteModel( std::ofstream& out, uint32_t index )
+{
+    Model model = CreateGridModel( 64 );
+    model.name  = "model" + std::to_string( index );
+
+    // Keep the CPU copy and skip the GPU one, so that only the deserialization itself is measured
+    serialize::Write( out, model.name );
+    serialize::Write( out, false );
+    serialize::Write( out, false );
+    model.Serialize( out );
+}
+
+static void WriteScript( std::ofstream& out, uint32_t index )
+{
+    Script script;
+    script.name       = "script" + std::to_string( index );
+    script.scriptText =
+        "theta = 0\n"
+        "vel = .1\n"
+        "\n"
+        "function Update()\n"
+        "    theta = theta + Time.dt * vel\n"
+        "    if math.abs( theta ) > math.pi / 5 then\n"
+        "        vel = vel * -1\n"
+        "    end\n"
+        "    scene.directionalLight.direction.z = math.sin( theta )\n"
+        "    scene.directionalLight.direction.y = -math.cos( theta )\n"
+        "end\n";
+    serialize::Write( out, script.name );
+    serialize::Write( out, script.scriptText );
+}
+
+// Writes a fastfile with numResources of one type of resource, in the layout LoadFastFile expects,
+// and returns the name to pass to it
+static std::string WriteSyntheticFastfile( FastfileSection section, uint32_t numResources )
+{
+    const char* sectionNames[] = { "shaders", "images", "materials", "models", "scripts" };
+    std::string filename = ( std::filesystem::temp_directory_path() /
+        ( "pg_bench_" + std::string( sectionNames[static_cast< int >( section )] ) + std::to_string( numResources ) + ".ff" ) ).string();
+    std::string actualFilename = filename;
+#if USING( DEBUG_BUILD )
+    actualFilename += "d";
+#endif // #if USING( DEBUG_BUILD )
+
+    std::ofstream out( actualFilename, std::ios::binary );
+    serialize::Write( out, std::string( "synthetic" ) );
+
+    auto writeSection = [&]( FastfileSection current, uint32_t version, void (*writeResource)( std::ofstream&, uint32_t ) )
+    {
+        uint32_t count = current == section ? numResources : 0;
+        serialize::Write( out, count );
+        serialize::Write( out, version );
+        for ( uint32_t i = 0; i < count; ++i )
+        {
+            writeResource( out, i );
+        }
+        serialize::Write( out, PG_RESOURCE_MAGIC_NUMBER_GUARD );
+    };
+
+    writeSection( FastfileSection::SHADERS, PG_RESOURCE_SHADER_VERSION, WriteShader );
+    writeSection( FastfileSection::IMAGES, PG_RESOURCE_IMAGE_VERSION, WriteImage );
+
+    // Materials are grouped by the material file they came from, with only one guard at the end
+    uint32_t numMaterialFiles = section == FastfileSection::MATERIALS ? 1 : 0;
+    serialize::Write( out, numMaterialFiles );
+    serialize::Write( out, static_cast< uint32_t >( PG_RESOURCE_MATERIAL_VERSION ) );
+    if ( numMaterialFiles )
+    {
+        serialize::Write( out, numResources );
+        for ( uint32_t i = 0; i < numResources; ++i )
+        {
+            WriteMaterial( out, i );
+        }
+    }
+    serialize::Write( out, PG_RESOURCE_MAGIC_NUMBER_GUARD );
+
+    writeSection( FastfileSection::MODELS, PG_RESOURCE_MODEL_VERSION, WriteModel );
+    writeSection( FastfileSection::SCRIPTS, PG_RESOURCE_SCRIPT_VERSION, WriteScript );
+
+    return out.fail() ? "" : filename;
+}
+
+static void LoadSyntheticFastfile( Bench::State& state, FastfileSection section )
+{
+    // Nothing gets uploaded, so this runs without a Vulkan device
+    Gfx::g_headless = true;
+    uint32_t numResources = static_cast< uint32_t >( state.range( 0 ) );
+    std::string filename  = WriteSyntheticFastfile( section, numResources );
+    if ( filename.empty() )
+    {
+        state.SkipWithError( "Could not write the synthetic fastfile" );
+        return;
+    }
+
+    while ( state.KeepRunning() )
+    {
+        state.PauseTiming();
+        ResourceManager::Init();
+        state.ResumeTiming();
+        if ( !ResourceManager::LoadFastFile( filename, false ) )
+        {
+            state.SkipWithError( "Failed to load '" + filename + "'" );
+        }
+    }
+    ResourceManager::Shutdown();
+    state.SetItemsProcessed( state.iterations() * numResources );
+}
+
+static void BM_DeserializeShaders( Bench::State& state ) { LoadSyntheticFastfile( state, FastfileSection::SHADERS ); }
+static void BM_DeserializeImages( Bench::State& state ) { LoadSyntheticFastfile( state, FastfileSection::IMAGES ); }
+static void BM_DeserializeMaterials( Bench::State& state ) { LoadSyntheticFastfile( state, FastfileSection::MATERIALS ); }
+static void BM_DeserializeModels( Bench::State& state ) { LoadSyntheticFastfile( state, FastfileSection::MODELS ); }
+static void BM_DeserializeScripts( Bench::State& state ) { LoadSyntheticFastfile( state, FastfileSection::SCRIPTS ); }
+PG_BENCHMARK( BM_DeserializeShaders )->Arg( 1 )->Arg( 64 );
+PG_BENCHMARK( BM_DeserializeImages )->Arg( 1 )->Arg( 64 );
+PG_BENCHMARK( BM_DeserializeMaterials )->Arg( 1 )->Arg( 256 );
+PG_BENCHMARK( BM_DeserializeModels )->Arg( 1 )->Arg( 64 );
+PG_BENCHMARK( BM_DeserializeScripts )->Arg( 1 )->Arg( 256 );
+
+// Reads state.range( 0 ) of the small fixed size fields that most of a fastfile is made of
+static void BM_SerializeReadScalars( Bench::State& state )
+{
+    size_t count = static_cast< size_t >( state.range( 0 ) );
+    size_t recordSize = sizeof( uint32_t ) + sizeof( float ) + sizeof( glm::vec3 );
+    std::vector< char > data( count * recordSize );
+    for ( size_t i = 0; i < data.size(); ++i )
+    {
+        data[i] = static_cast< char >( i );
+    }
+
+    while ( state.KeepRunning() )
+    {
+        char* buffer = data.data();
+        for ( size_t i = 0; i < count; ++i )
+        {
+            uint32_t u;
+            float f;
+            glm::vec3 v;
+            serialize::Read( buffer, u );
+            serialize::Read( buffer, f );
+            serialize::Read( buffer, v );
+            Bench::DoNotOptimize( u );
+            Bench::DoNotOptimize( f );
+            Bench::DoNotOptimize( v );
+        }
+    }
+    state.SetItemsProcessed( state.iterations() * count );
+    state.SetBytesProcessed( state.iterations() * data.size() );
+}
+PG_BENCHMARK( BM_SerializeReadScalars )->Arg( 64 )->Arg( 4096 );
+
+static void BM_SerializeReadStrings( Bench::State& state )
+{
+    size_t count = static_cast< size_t >( state.range( 0 ) );
+    std::vector< char > data;
+    for ( size_t i = 0; i < count; ++i )
+    {
+        std::string name = "resource_name_" + std::to_string( i );
+        uint32_t len     = static_cast< uint32_t >( name.length() );
+        data.insert( data.end(), reinterpret_cast< char* >( &len ), reinterpret_cast< char* >( &len ) + sizeof( len ) );
+        data.insert( data.end(), name.begin(), name.end() );
+    }
+
+    std::string s;
+    while ( state.KeepRunning() )
+    {
+        char* buffer = data.data();
+        for ( size_t i = 0; i < count; ++i )
+        {
+            serialize::Read( buffer, s );
+            Bench::DoNotOptimize( s );
+        }
+    }
+    state.SetItemsProcessed( state.iterations() * count );
+    state.SetBytesProcessed( state.iterations() * data.size() );
+}
+PG_BENCHMARK( BM_SerializeReadStrings )->Arg( 64 )->Arg( 4096 );
+
+// Bulk reads, like vertex data. state.range( 0 ) is the size in bytes
+static void BM_SerializeReadVector( Bench::State& state )
+{
+    size_t numFloats = static_cast< size_t >( state.range( 0 ) ) / sizeof( float );
+    std::vector< char > data( sizeof( size_t ) + numFloats * sizeof( float ) );
+    memcpy( data.data(), &numFloats, sizeof( size_t ) );
+
+    std::vector< float > floats;
+    while ( state.KeepRunning() )
+    {
+        char* buffer = data.data();
+        serialize::Read( buffer, floats );
+        Bench::DoNotOptimize( floats.data() );
+    }
+    state.SetBytesProcessed( state.iterations() * numFloats * sizeof( float ) );
+}
+PG_BENCHMARK( BM_SerializeReadVector )->Arg( 4 * 1024 )->Arg( 1024 * 1024 )->Arg( 16 * 1024 * 1024 );
+
+// state.range( 0 ) is the number of models in the compressed fastfile
+static void BM_LZ4Decompress( Bench::State& state )
+{
+    uint32_t numModels = static_cast< uint32_t >( state.range( 0 ) );
+    std::string filename = WriteSyntheticFastfile( FastfileSection::MODELS, numModels );
+#if USING( DEBUG_BUILD )
+    filename += "d";
+#endif // #if USING( DEBUG_BUILD )
+    std::ifstream in( filename, std::ios::binary );
+    std::vector< char > src( ( std::istreambuf_iterator< char >( in ) ), std::istreambuf_iterator< char >() );
+    if ( src.empty() )
+    {
+        state.SkipWithError( "Could not write the synthetic fastfile" );
+        return;
+    }
+
+    const int srcSize = static_cast< int >( src.size() );
+    std::vector< char > compressed( LZ4_compressBound( srcSize ) );
+    const int compressedSize = LZ4_compress_default( src.data(), compressed.data(), srcSize, static_cast< int >( compressed.size() ) );
+    std::vector< char > decompressed( src.size() );
+
+    while ( state.KeepRunning() )
+    {
+        int decompressedSize = LZ4_decompress_safe( compressed.data(), decompressed.data(), compressedSize, srcSize );
+        if ( decompressedSize != srcSize )
+        {
+            state.SkipWithError( "LZ4 decompression failed" );
+        }
+    }
+    state.SetBytesProcessed( state.iterations() * src.size() );
+    state.counters["compression_ratio"] = static_cast< double >( compressedSize ) / srcSize;
+}
+PG_BENCHMARK( BM_LZ4Decompress )->Arg( 1 )->Arg( 16 );
+
+// state.range( 0 ) boxes scattered around the camera, about half of which are visible
+static void BM_BoxInFrustum( Bench::State& state )
+{
+    Camera camera;
+    camera.position = glm::vec3( 0, 2, 0 );
+    camera.UpdateOrientationVectors();
+    camera.UpdateViewMatrix();
+    camera.UpdateFrustum();
+    Frustum frustum = camera.GetFrustum();
+
+    Random::SetSeed( 0 );
+    std::vector< AABB > boxes( state.range( 0 ) );
+    for ( auto& box : boxes )
+    {
+        glm::vec3 center( Random::RandFloat( -50, 50 ), Random::RandFloat( -5, 5 ), Random::RandFloat( -50, 50 ) );
+        glm::vec3 halfExtent( Random::RandFloat( 0.1f, 2 ) );
+        box = AABB( center - halfExtent, center + halfExtent );
+    }
+
+    uint64_t numVisible = 0;
+    while ( state.KeepRunning() )
+    {
+        for ( const auto& box : boxes )
+        {
+            numVisible += frustum.BoxInFrustum( box );
+        }
+    }
+    state.SetItemsProcessed( state.iterations() * boxes.size() );
+    state.counters["visible_ratio"] = static_cast< double >( numVisible ) / ( state.iterations() * boxes.size() );
+}
+PG_BENCHMARK( BM_BoxInFrustum )->Arg( 1024 )->Arg( 65536 );
+
+// state.range( 0 ) point lights scattered around the camera, like BM_BoxInFrustum
+static void BM_AssignLightsToClusters( Bench::State& state )
+{
+    Camera camera;
+    camera.position = glm::vec3( 0, 2, 0 );
+    camera.UpdateOrientationVectors();
+    camera.UpdateViewMatrix();
+
+    Random::SetSeed( 0 );
+    std::vector< glm::vec4 > pointLights( state.range( 0 ) );
+    for ( auto& light : pointLights )
+    {
+        light = glm::vec4( Random::RandFloat( -50, 50 ), Random::RandFloat( -5, 5 ), Random::RandFloat( -50, 50 ), Random::RandFloat( 1, 8 ) );
+    }
+    std::vector< glm::vec4 > spotLights;
+    std::vector< glm::vec4 > spotCones;
+
+    Gfx::LightClusters clusters;
+    clusters.SetProjection( camera.fov, camera.aspectRatio, camera.nearPlane, camera.farPlane );
+    while ( state.KeepRunning() )
+    {
+        clusters.Assign( camera.GetV(), pointLights, spotLights, spotCones );
+    }
+    state.SetItemsProcessed( state.iterations() * pointLights.size() );
+    state.counters["lights_per_cluster"] = static_cast< double >( clusters.GetLightIndices().size() ) / PG_NUM_LIGHT_CLUSTERS;
+}
+PG_BENCHMARK( BM_AssignLightsToClusters )->Arg( 64 )->Arg( 1024 );
+
+// Fits the cascades and culls state.range( 0 ) casters against them, the same boxes as BM_BoxInFrustum
+static void BM_CullShadowCasters( Bench::State& state )
+{
+    Camera camera;
+    camera.position = glm::vec3( 0, 2, 0 );
+    camera.UpdateOrientationVectors();
+    camera.UpdateViewMatrix();
+    glm::vec3 lightDir = glm::normalize( glm::vec3( 0.3f, -1, 0.5f ) );
+
+    Random::SetSeed( 0 );
+    std::vector< AABB > boxes( state.range( 0 ) );
+    for ( auto& box : boxes )
+    {
+        glm::vec3 center( Random::RandFloat( -50, 50 ), Random::RandFloat( -5, 5 ), Random::RandFloat( -50, 50 ) );
+        glm::vec3 halfExtent( Random::RandFloat( 0.1f, 2 ) );
+        box = AABB( center - halfExtent, center + halfExtent );
+    }
+
+    uint64_t numDraws = 0;
+    float splits[PG_NUM_SHADOW_CASCADES];
+    Gfx::ShadowCascade cascades[PG_NUM_SHADOW_CASCADES];
+    while ( state.KeepRunning() )
+    {
+        Gfx::ComputeCascadeSplits( camera.nearPlane, camera.farPlane, 0.75f, splits );
+        for ( uint32_t cascade = 0; cascade < PG_NUM_SHADOW_CASCADES; ++cascade )
+        {
+            cascades[cascade].Fit( camera, lightDir, cascade == 0 ? camera.nearPlane : splits[cascade - 1], splits[cascade], glm::uvec2( 1024 ) );
+        }
+        for ( const auto& box : boxes )
+        {
+            for ( auto& cascade : cascades )
+            {
+                numDraws += cascade.AddCaster( box );
+            }
+        }
+    }
+    state.SetItemsProcessed( state.iterations() * boxes.size() );
+    // How many draws each caster costs on average, out of PG_NUM_SHADOW_CASCADES
+    state.counters["draws_per_caster"] = static_cast< double >( numDraws ) / ( state.iterations() * boxes.size() );
+}
+PG_BENCHMARK( BM_CullShadowCasters )->Arg( 1024 )->Arg( 65536 );
+
+// The same boxes as BM_BoxInFrustum, tested against the depth of a wall a little in front of the camera
+// that hides most of the view
+static void BM_OcclusionCull( Bench::State& state )
+{
+    Camera camera;
+    camera.position = glm::vec3( 0, 2, 0 );
+    camera.UpdateFrustum();
+    glm::mat4 VP = camera.GetVP();
+
+    Gfx::SoftwareDepthRasterizer rasterizer;
+    rasterizer.Init( PG_HIZ_WIDTH, PG_HIZ_HEIGHT );
+    rasterizer.DrawBox( VP, AABB( glm::vec3( -4, -5, -11 ), glm::vec3( 6, 8, -10 ) ) );
+    Gfx::DepthPyramid pyramid;
+    pyramid.Build( rasterizer.GetDepths().data(), PG_HIZ_WIDTH, PG_HIZ_HEIGHT, VP );
+
+    Random::SetSeed( 0 );
+    std::vector< AABB > boxes( state.range( 0 ) );
+    for ( auto& box : boxes )
+    {
+        glm::vec3 center( Random::RandFloat( -50, 50 ), Random::RandFloat( -5, 5 ), Random::RandFloat( -50, 50 ) );
+        glm::vec3 halfExtent( Random::RandFloat( 0.1f, 2 ) );
+        box = AABB( center - halfExtent, center + halfExtent );
+    }
+
+    uint64_t numVisible = 0;
+    while ( state.KeepRunning() )
+    {
+        for ( const auto& box : boxes )
+        {
+            numVisible += pyramid.IsBoxVisible( box );
+        }
+    }
+    state.SetItemsProcessed( state.iterations() * boxes.size() );
+    state.counters["visible_ratio"] = static_cast< double >( numVisible ) / ( state.iterations() * boxes.size() );
+}
+PG_BENCHMARK( BM_OcclusionCull )->Arg( 1024 )->Arg( 65536 );
+
+static void BM_TransformGetModelMatrix( Bench::State& state )
+{
+    Random::SetSeed( 0 );
+    std::vector< Transform > transforms( state.range( 0 ) );
+    for ( auto& transform : transforms )
+    {
+        transform.SetPosition( glm::vec3( Random::RandFloat( -50, 50 ), Random::RandFloat( -50, 50 ), Random::RandFloat( -50, 50 ) ) );
+        transform.SetEulerAngles( glm::vec3( Random::RandFloat( 0, 6 ), Random::RandFloat( 0, 6 ), Random::RandFloat( 0, 6 ) ) );
+        transform.SetScale( glm::vec3( Random::RandFloat( 0.5f, 2 ) ) );
+    }
+
+    while ( state.KeepRunning() )
+    {
+        for ( const auto& transform : transforms )
+        {
+            glm::mat4 M = transform.GetModelMatrix();
+            Bench::DoNotOptimize( M );
+        }
+    }
+    state.SetItemsProcessed( state.iterations() * transforms.size() );
+}
+PG_BENCHMARK( BM_TransformGetModelMatrix )->Arg( 1024 );
+
+static std::vector< JointTransform > RandomPose( size_t numJoints )
+{
+    std::vector< JointTransform > pose( numJoints );
+    for ( auto& joint : pose )
+    {
+        joint.position = glm::vec3( Random::RandFloat( -1, 1 ), Random::RandFloat( -1, 1 ), Random::RandFloat( -1, 1 ) );
+        joint.rotation = glm::normalize( glm::quat( Random::Rand(), Random::Rand(), Random::Rand(), Random::Rand() ) );
+        joint.scale    = glm::vec3( 1 );
+    }
+
+    return pose;
+}
+
+// A binary tree of joints, so the recursion in ApplyPoseToJoints goes a few levels deep like a real skeleton
+static Model CreateSkinnedModel( size_t numJoints )
+{
+    Model model;
+    model.skeleton.joints.resize( numJoints );
+    for ( size_t i = 0; i < numJoints; ++i )
+    {
+        Joint& joint               = model.skeleton.joints[i];
+        joint.name                 = "joint" + std::to_string( i );
+        joint.inverseBindTransform = glm::translate( glm::mat4( 1 ), glm::vec3( 0, -0.1f * i, 0 ) );
+        for ( size_t child = 2 * i + 1; child <= 2 * i + 2 && child < numJoints; ++child )
+        {
+            joint.children.push_back( static_cast< uint32_t >( child ) );
+        }
+    }
+
+    return model;
+}
+
+// state.range( 0 ) is the number of joints
+static void BM_JointTransformInterpolate( Bench::State& state )
+{
+    Random::SetSeed( 0 );
+    std::vector< JointTransform > start = RandomPose( state.range( 0 ) );
+    std::vector< JointTransform > end   = RandomPose( state.range( 0 ) );
+
+    float progress = 0;
+    while ( state.KeepRunning() )
+    {
+        for ( size_t i = 0; i < start.size(); ++i )
+        {
+            JointTransform interpolated = start[i].Interpolate( end[i], progress );
+            Bench::DoNotOptimize( interpolated );
+        }
+        progress = progress < 1 ? progress + 0.01f : 0;
+    }
+    state.SetItemsProcessed( state.iterations() * start.size() );
+}
+PG_BENCHMARK( BM_JointTransformInterpolate )->Arg( 64 );
+
+// The whole per model work of the AnimationSystem: interpolating between two keyframes, building
+// the local joint matrices, and then walking the skeleton. state.range( 0 ) is the number of joints
+static void BM_ApplyPoseToJoints( Bench::State& state )
+{
+    Random::SetSeed( 0 );
+    size_t numJoints = static_cast< size_t >( state.range( 0 ) );
+    Model model      = CreateSkinnedModel( numJoints );
+    std::vector< JointTransform > start = RandomPose( numJoints );
+    std::vector< JointTransform > end   = RandomPose( numJoints );
+    std::vector< glm::mat4 > transformBuffer( numJoints );
+
+    while ( state.KeepRunning() )
+    {
+        for ( size_t i = 0; i < numJoints; ++i )
+        {
+            transformBuffer[i] = start[i].Interpolate( end[i], 0.5f ).GetLocalTransformMatrix();
+        }
+        model.ApplyPoseToJoints( 0, glm::mat4( 1 ), transformBuffer );
+        Bench::DoNotOptimize( transformBuffer.data() );
+    }
+    state.SetItemsProcessed( state.iterations() * numJoints );
+}
+PG_BENCHMARK( BM_ApplyPoseToJoints )->Arg( 16 )->Arg( 64 )->Arg( 256 );
+
+// state.range( 0 ) is the number of quads per side of the grid mesh that gets optimized
+static void BM_ModelOptimize( Bench::State& state )
+{
+    Model original = CreateGridModel( static_cast< uint32_t >( state.range( 0 ) ) );
+    size_t numTriangles = original.indices.size() / 3;
+    Model model;
+    while ( state.KeepRunning() )
+    {
+        state.PauseTiming();
+        model.vertices = original.vertices;
+        model.normals  = original.normals;
+        model.uvs      = original.uvs;
+        model.indices  = original.indices;
+        model.meshes   = original.meshes;
+        state.ResumeTiming();
+
+        model.Optimize();
+    }
+    state.SetItemsProcessed( state.iterations() * numTriangles );
+}
+PG_BENCHMARK( BM_ModelOptimize )->Arg( 32 )->Arg( 256 );
+
+// Formats the messages like a real output would, and then throws them away
+class NullBuffer : public std::streambuf
+{
+protected:
+    int overflow( int c ) override { return c; }
+    std::streamsize xsputn( const char*, std::streamsize n ) override { return n; }
+};
+
+static Logger* GetBenchmarkLogger()
+{
+    static NullBuffer s_nullBuffer;
+    static std::ostream s_nullStream( &s_nullBuffer );
+    static Logger s_logger;
+    static bool s_initialized = [&]()
+    {
+        s_logger.Init();
+        s_logger.RemoveLocation( "stdout" );
+        s_logger.AddLocation( "null", &s_nullStream, false );
+        return true;
+    }();
+    PG_UNUSED( s_initialized );
+
+    return &s_logger;
+}
+
+// Time for the calling thread to hand a message to the logger's writer thread, with every thread
+// logging at once. DEBUG messages get dropped instead of blocking when the ring buffer is full,
+// which is counted in dropped_ratio
+static void BM_LoggerWrite( Bench::State& state )
+{
+    Logger* logger          = GetBenchmarkLogger();
+    uint64_t droppedAtStart = logger->NumDroppedMessages();
+    while ( state.KeepRunning() )
+    {
+        logger->Write( Logger::DEBUG, "Entity ", 42, " moved to (", 1.5f, ", ", 2.0f, ", ", -3.25f, ")" );
+    }
+    state.SetItemsProcessed( state.iterations() );
+
+    // The dropped count is logger wide, so only one thread reports it
+    if ( state.thread_index() == 0 )
+    {
+        logger->Flush();
+        uint64_t dropped = logger->NumDroppedMessages() - droppedAtStart;
+        state.counters["dropped_ratio"] = static_cast< double >( dropped ) / ( state.iterations() * state.threads() );
+    }
+}
+PG_BENCHMARK( BM_LoggerWrite )->Threads( 1 )->Threads( 2 )->Threads( 4 )->Threads( 8 );
+
+// Dispatching every member of a JSON object through a FunctionMapper, like the scene and resource
+// file parsing does for every entity and component
+static void BM_FunctionMapperForEachMember( Bench::State& state )
+{
+    rapidjson::Document document;
+    document.Parse( R"({
+        "position": [ 1, 2, 3 ],
+        "rotation": [ 0, 90, 0 ],
+        "scale": [ 1, 1, 1 ],
+        "fov": 45,
+        "nearPlane": 0.1,
+        "farPlane": 100,
+        "intensity": 2.5,
+        "radius": 10
+    })" );
+    PG_ASSERT( !document.HasParseError() );
+
+    struct Target
+    {
+        glm::vec3 position, rotation, scale;
+        float fov, nearPlane, farPlane, intensity, radius;
+    };
+    static FunctionMapper< void, Target& > mapping(
+    {
+        { "position",  []( rapidjson::Value& v, Target& t ) { t.position  = ParseVec3( v ); } },
+        { "rotation",  []( rapidjson::Value& v, Target& t ) { t.rotation  = glm::radians( ParseVec3( v ) ); } },
+        { "scale",     []( rapidjson::Value& v, Target& t ) { t.scale     = ParseVec3( v ); } },
+        { "fov",       []( rapidjson::Value& v, Target& t ) { t.fov       = glm::radians( ParseNumber< float >( v ) ); } },
+        { "nearPlane", []( rapidjson::Value& v, Target& t ) { t.nearPlane = ParseNumber< float >( v ); } },
+        { "farPlane",  []( rapidjson::Value& v, Target& t ) { t.farPlane  = ParseNumber< float >( v ); } },
+        { "intensity", []( rapidjson::Value& v, Target& t ) { t.intensity = ParseNumber< float >( v ); } },
+        { "radius",    []( rapidjson::Value& v, Target& t ) { t.radius    = ParseNumber< float >( v ); } },
+    });
+
+    Target target;
+    while ( state.KeepRunning() )
+    {
+        mapping.ForEachMember( document, target );
+        Bench::DoNotOptimize( target );
+    }
+    state.SetItemsProcessed( state.iterations() * document.MemberCount() );
+}
+PG_BENCHMARK( BM_FunctionMapperForEachMember );
+
+int main( int argc, char* argv[] )
+{
+    return Bench::RunBenchmarks( argc, argv );
+}
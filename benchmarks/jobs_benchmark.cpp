@@ -0,0 +1,117 @@
+#include "core/jobs.hpp"
+#include "core/time.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace Progression;
+
+// Measures the job system's per job overhead and how well ParallelFor scales with threads.
+// Prints the results as JSON so runs can be diffed across commits
+
+static double SpawnOverhead( uint32_t numJobs )
+{
+    std::atomic< uint32_t > sum = { 0 };
+    auto start = Time::GetTimePoint();
+    Jobs::Counter counter;
+    for ( uint32_t i = 0; i < numJobs; ++i )
+    {
+        Jobs::Submit( [&sum]() { sum.fetch_add( 1, std::memory_order_relaxed ); }, &counter );
+    }
+    Jobs::Wait( &counter );
+
+    return 1e6 * Time::GetDuration( start ) / numJobs; // nanoseconds per job
+}
+
+static double NestedSpawnOverhead( uint32_t numParents, uint32_t numChildren )
+{
+    auto start = Time::GetTimePoint();
+    Jobs::Counter parents;
+    for ( uint32_t i = 0; i < numParents; ++i )
+    {
+        Jobs::Submit( [numChildren]()
+        {
+            Jobs::Counter children;
+            for ( uint32_t j = 0; j < numChildren; ++j )
+            {
+                Jobs::Submit( []() {}, &children );
+            }
+            Jobs::Wait( &children );
+        }, &parents );
+    }
+    Jobs::Wait( &parents );
+
+    return 1e6 * Time::GetDuration( start ) / ( numParents * ( numChildren + 1 ) );
+}
+
+static double ParallelForTime( std::vector< float >& data, uint32_t minBatchSize )
+{
+    auto start = Time::GetTimePoint();
+    Jobs::ParallelFor( static_cast< uint32_t >( data.size() ), minBatchSize, [&data]( uint32_t begin, uint32_t end )
+    {
+        for ( uint32_t i = begin; i < end; ++i )
+        {
+            float x = data[i];
+            for ( int k = 0; k < 64; ++k )
+            {
+                x = std::sqrt( x * x + 1.0f ) - 0.5f;
+            }
+            data[i] = x;
+        }
+    });
+
+    return Time::GetDuration( start );
+}
+
+template< typename Func >
+static double Median( int iterations, Func func )
+{
+    std::vector< double > times( iterations );
+    for ( int i = 0; i < iterations; ++i )
+    {
+        times[i] = func();
+    }
+    std::sort( times.begin(), times.end() );
+
+    return times[iterations / 2];
+}
+
+int main( int argc, char* argv[] )
+{
+    // Optionally pass the max number of threads to test, defaults to the number of hardware threads
+    uint32_t maxThreads = std::max( 1u, std::thread::hardware_concurrency() );
+    if ( argc > 1 )
+    {
+        maxThreads = std::max( 1, std::atoi( argv[1] ) );
+    }
+    std::vector< float > data( 1 << 18, 1.0f );
+    double singleThreadTime = 0;
+
+    std::cout << "{\n    \"benchmark\": \"jobs\",\n    \"results\": [\n";
+    for ( uint32_t numThreads = 1; numThreads <= maxThreads; numThreads *= 2 )
+    {
+        Jobs::Init( numThreads );
+
+        double spawnNs  = Median( 9, []() { return SpawnOverhead( 100000 ); } );
+        double nestedNs = Median( 9, []() { return NestedSpawnOverhead( 256, 64 ); } );
+        double forMs    = Median( 9, [&data]() { return ParallelForTime( data, 1024 ); } );
+        if ( numThreads == 1 )
+        {
+            singleThreadTime = forMs;
+        }
+
+        std::cout << "        { \"threads\": " << numThreads
+                  << ", \"spawn_ns_per_job\": " << spawnNs
+                  << ", \"nested_spawn_ns_per_job\": " << nestedNs
+                  << ", \"parallel_for_ms\": " << forMs
+                  << ", \"parallel_for_speedup\": " << singleThreadTime / forMs << " }";
+        std::cout << ( numThreads * 2 <= maxThreads ? ",\n" : "\n" );
+        Jobs::Shutdown();
+    }
+    std::cout << "    ]\n}" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,431 @@
+#include "micro_benchmark.hpp"
+#include "getopt/getopt.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <regex>
+#include <sstream>
+#include <thread>
+
+// Cap on the iterations of a single run, for benchmarks that are too cheap to ever reach the min time
+#define MAX_ITERATIONS 1000000000ull
+
+namespace Progression
+{
+namespace Bench
+{
+
+    struct RunResult
+    {
+        std::string name;
+        uint64_t iterations;
+        int threads;
+        double realTime; // seconds, of the slowest thread
+        double cpuTime;  // seconds of process CPU time
+        uint64_t itemsProcessed;
+        uint64_t bytesProcessed;
+        std::map< std::string, double > counters;
+        std::string error;
+    };
+
+    static std::vector< std::unique_ptr< Benchmark > >& GetRegistry()
+    {
+        static std::vector< std::unique_ptr< Benchmark > > registry;
+        return registry;
+    }
+
+    State::State( uint64_t maxIterations, const std::vector< int64_t >& args, int threadIndex, int numThreads ) :
+        m_maxIterations( maxIterations ),
+        m_args( args ),
+        m_threadIndex( threadIndex ),
+        m_numThreads( numThreads )
+    {
+    }
+
+    void State::PauseTiming()
+    {
+        if ( m_timing )
+        {
+            auto realEnd  = std::chrono::high_resolution_clock::now();
+            m_realTime   += std::chrono::duration< double >( realEnd - m_realStart ).count();
+            m_cpuTime    += static_cast< double >( std::clock() - m_cpuStart ) / CLOCKS_PER_SEC;
+            m_timing      = false;
+        }
+    }
+
+    void State::ResumeTiming()
+    {
+        if ( !m_timing )
+        {
+            m_timing    = true;
+            m_cpuStart  = std::clock();
+            m_realStart = std::chrono::high_resolution_clock::now();
+        }
+    }
+
+    Benchmark::Benchmark( const std::string& _name, const std::function< void( State& ) >& _func ) :
+        name( _name ),
+        func( _func )
+    {
+    }
+
+    Benchmark* Benchmark::Arg( int64_t arg )
+    {
+        argSets.push_back( { arg } );
+        return this;
+    }
+
+    Benchmark* Benchmark::Args( const std::vector< int64_t >& args )
+    {
+        argSets.push_back( args );
+        return this;
+    }
+
+    Benchmark* Benchmark::Threads( int numThreads )
+    {
+        threadCounts.push_back( numThreads );
+        return this;
+    }
+
+    Benchmark* Register( const std::string& name, const std::function< void( State& ) >& func )
+    {
+        GetRegistry().emplace_back( std::make_unique< Benchmark >( name, func ) );
+        return GetRegistry().back().get();
+    }
+
+    class Runner
+    {
+    public:
+        static RunResult Run( const Benchmark& bench, const std::vector< int64_t >& args, int numThreads, uint64_t iterations )
+        {
+            std::vector< State > states;
+            states.reserve( numThreads );
+            for ( int i = 0; i < numThreads; ++i )
+            {
+                states.emplace_back( iterations, args, i, numThreads );
+            }
+
+            if ( numThreads == 1 )
+            {
+                bench.func( states[0] );
+            }
+            else
+            {
+                // Line the threads up first, so they're all actually running at the same time
+                std::atomic< int > numReady = { 0 };
+                std::vector< std::thread > threads;
+                for ( int i = 0; i < numThreads; ++i )
+                {
+                    threads.emplace_back( [&, i]()
+                    {
+                        numReady.fetch_add( 1 );
+                        while ( numReady.load() < numThreads )
+                        {
+                            std::this_thread::yield();
+                        }
+                        bench.func( states[i] );
+                    });
+                }
+                for ( auto& thread : threads )
+                {
+                    thread.join();
+                }
+            }
+
+            RunResult result = {};
+            result.iterations = iterations;
+            result.threads    = numThreads;
+            for ( const State& state : states )
+            {
+                result.realTime        = std::max( result.realTime, state.m_realTime );
+                result.cpuTime         = std::max( result.cpuTime, state.m_cpuTime );
+                result.itemsProcessed += state.m_itemsProcessed;
+                result.bytesProcessed += state.m_bytesProcessed;
+                for ( const auto& [name, value] : state.counters )
+                {
+                    result.counters[name] += value;
+                }
+                if ( !state.m_error.empty() )
+                {
+                    result.error = state.m_error;
+                }
+            }
+
+            return result;
+        }
+    };
+
+    // Grows the iteration count until a run takes at least minTime seconds, the same way Google Benchmark does
+    static RunResult RunUntilMinTime( const Benchmark& bench, const std::vector< int64_t >& args, int numThreads, double minTime )
+    {
+        uint64_t iterations = 1;
+        while ( true )
+        {
+            RunResult result = Runner::Run( bench, args, numThreads, iterations );
+            if ( !result.error.empty() || result.realTime >= minTime || iterations >= MAX_ITERATIONS )
+            {
+                return result;
+            }
+
+            double multiplier = 10;
+            if ( result.realTime / minTime > 0.1 )
+            {
+                multiplier = 1.4 * minTime / result.realTime;
+            }
+            uint64_t next = static_cast< uint64_t >( iterations * multiplier );
+            iterations    = std::min( std::max( next, iterations + 1 ), static_cast< uint64_t >( MAX_ITERATIONS ) );
+        }
+    }
+
+    static std::string HumanReadable( double value )
+    {
+        const char* suffixes[] = { "", "k", "M", "G", "T" };
+        int i = 0;
+        while ( value >= 1000 && i < 4 )
+        {
+            value /= 1000;
+            ++i;
+        }
+        char buffer[32];
+        snprintf( buffer, sizeof( buffer ), "%.4g%s", value, suffixes[i] );
+        return buffer;
+    }
+
+    static void PrintResult( const RunResult& result )
+    {
+        if ( !result.error.empty() )
+        {
+            char line[256];
+            snprintf( line, sizeof( line ), "%-56s ERROR OCCURRED: '%s'", result.name.c_str(), result.error.c_str() );
+            std::cout << line << std::endl;
+            return;
+        }
+        double realNs = 1e9 * result.realTime / result.iterations;
+        double cpuNs  = 1e9 * result.cpuTime / ( result.iterations * result.threads );
+        char line[256];
+        snprintf( line, sizeof( line ), "%-56s %12.1f ns %12.1f ns %12llu", result.name.c_str(), realNs, cpuNs,
+            static_cast< unsigned long long >( result.iterations ) );
+        std::cout << line;
+        if ( result.bytesProcessed )
+        {
+            std::cout << " bytes_per_second=" << HumanReadable( result.bytesProcessed / result.realTime ) << "/s";
+        }
+        if ( result.itemsProcessed )
+        {
+            std::cout << " items_per_second=" << HumanReadable( result.itemsProcessed / result.realTime ) << "/s";
+        }
+        for ( const auto& [name, value] : result.counters )
+        {
+            std::cout << " " << name << "=" << HumanReadable( value );
+        }
+        std::cout << std::endl;
+    }
+
+    static bool WriteJSON( const std::string& filename, const std::string& executable, const std::vector< RunResult >& results )
+    {
+        std::ofstream out( filename );
+        if ( !out )
+        {
+            std::cout << "Could not open output file '" << filename << "'" << std::endl;
+            return false;
+        }
+
+        char date[64];
+        std::time_t now = std::time( nullptr );
+        std::strftime( date, sizeof( date ), "%Y-%m-%dT%H:%M:%S", std::localtime( &now ) );
+#if USING( DEBUG_BUILD )
+        const char* buildType = "debug";
+#elif USING( SHIP_BUILD ) // #if USING( DEBUG_BUILD )
+        const char* buildType = "ship";
+#else // #elif USING( SHIP_BUILD ) // #if USING( DEBUG_BUILD )
+        const char* buildType = "release";
+#endif // #else // #elif USING( SHIP_BUILD ) // #if USING( DEBUG_BUILD )
+
+        out.precision( 10 );
+        out << "{\n";
+        out << "  \"context\": {\n";
+        out << "    \"date\": \"" << date << "\",\n";
+        out << "    \"executable\": \"" << executable << "\",\n";
+        out << "    \"num_cpus\": " << std::thread::hardware_concurrency() << ",\n";
+        out << "    \"library_build_type\": \"" << buildType << "\"\n";
+        out << "  },\n";
+        out << "  \"benchmarks\": [\n";
+        for ( size_t i = 0; i < results.size(); ++i )
+        {
+            const RunResult& result = results[i];
+            out << "    {\n";
+            out << "      \"name\": \"" << result.name << "\",\n";
+            out << "      \"run_name\": \"" << result.name << "\",\n";
+            out << "      \"run_type\": \"iteration\",\n";
+            out << "      \"iterations\": " << result.iterations << ",\n";
+            out << "      \"threads\": " << result.threads << ",\n";
+            if ( !result.error.empty() )
+            {
+                out << "      \"error_occurred\": true,\n";
+                out << "      \"error_message\": \"" << result.error << "\",\n";
+            }
+            out << "      \"real_time\": " << 1e9 * result.realTime / result.iterations << ",\n";
+            out << "      \"cpu_time\": " << 1e9 * result.cpuTime / ( result.iterations * result.threads ) << ",\n";
+            if ( result.bytesProcessed )
+            {
+                out << "      \"bytes_per_second\": " << result.bytesProcessed / result.realTime << ",\n";
+            }
+            if ( result.itemsProcessed )
+            {
+                out << "      \"items_per_second\": " << result.itemsProcessed / result.realTime << ",\n";
+            }
+            for ( const auto& [name, value] : result.counters )
+            {
+                out << "      \"" << name << "\": " << value << ",\n";
+            }
+            out << "      \"time_unit\": \"ns\"\n";
+            out << "    }" << ( i + 1 < results.size() ? "," : "" ) << "\n";
+        }
+        out << "  ]\n";
+        out << "}\n";
+
+        return !out.fail();
+    }
+
+    static void DisplayHelp( const char* executable )
+    {
+        std::cout << "Usage: " << executable << " [options]\n"
+            "Runs the registered micro benchmarks and prints the time per iteration of each\n"
+            "\nOptions\n"
+            "  -f, --filter REGEX\tOnly run the benchmarks whose full name (with args) matches\n"
+            "  -h, --help\t\tPrint this message and exit\n"
+            "  -l, --list\t\tList the benchmarks that would run and exit\n"
+            "  -m, --min_time SECONDS\tMinimum time of each benchmark's measured run. Default is 0.5\n"
+            "  -o, --output FILE\tAlso write the results as Google Benchmark style JSON\n" << std::endl;
+    }
+
+    int RunBenchmarks( int argc, char* argv[] )
+    {
+        static struct option long_options[] = {
+            { "filter",   required_argument, 0, 'f' },
+            { "help",     no_argument,       0, 'h' },
+            { "list",     no_argument,       0, 'l' },
+            { "min_time", required_argument, 0, 'm' },
+            { "output",   required_argument, 0, 'o' },
+            { 0, 0, 0, 0 }
+        };
+
+        std::string filter = ".*";
+        bool listOnly      = false;
+        double minTime     = 0.5;
+        std::string outputFile;
+        int option_index = 0;
+        int c            = -1;
+        while ( ( c = getopt_long( argc, argv, "f:hlm:o:", long_options, &option_index ) ) != -1 )
+        {
+            switch ( c )
+            {
+                case 'f':
+                    filter = optarg;
+                    break;
+                case 'h':
+                    DisplayHelp( argv[0] );
+                    return 0;
+                case 'l':
+                    listOnly = true;
+                    break;
+                case 'm':
+                    minTime = std::atof( optarg );
+                    break;
+                case 'o':
+                    outputFile = optarg;
+                    break;
+                case '?':
+                    std::cout << "Try '" << argv[0] << " --help' for more information" << std::endl;
+                    return 1;
+                default:
+                    break;
+            }
+        }
+        if ( minTime <= 0 )
+        {
+            DisplayHelp( argv[0] );
+            return 1;
+        }
+
+        std::regex filterRegex;
+        try
+        {
+            filterRegex = std::regex( filter );
+        }
+        catch ( const std::regex_error& )
+        {
+            std::cout << "Invalid filter regex '" << filter << "'" << std::endl;
+            return 1;
+        }
+
+        if ( !listOnly )
+        {
+            char header[256];
+            snprintf( header, sizeof( header ), "%-56s %15s %15s %12s", "Benchmark", "Time", "CPU", "Iterations" );
+            std::cout << header << "\n" << std::string( 101, '-' ) << std::endl;
+        }
+
+        std::vector< RunResult > results;
+        for ( const auto& bench : GetRegistry() )
+        {
+            std::vector< std::vector< int64_t > > argSets = bench->argSets;
+            if ( argSets.empty() )
+            {
+                argSets.push_back( {} );
+            }
+            std::vector< int > threadCounts = bench->threadCounts;
+            if ( threadCounts.empty() )
+            {
+                threadCounts.push_back( 1 );
+            }
+
+            for ( const auto& args : argSets )
+            {
+                for ( int numThreads : threadCounts )
+                {
+                    std::string name = bench->name;
+                    for ( int64_t arg : args )
+                    {
+                        name += "/" + std::to_string( arg );
+                    }
+                    if ( !bench->threadCounts.empty() )
+                    {
+                        name += "/threads:" + std::to_string( numThreads );
+                    }
+                    if ( !std::regex_search( name, filterRegex ) )
+                    {
+                        continue;
+                    }
+                    if ( listOnly )
+                    {
+                        std::cout << name << std::endl;
+                        continue;
+                    }
+
+                    RunResult result = RunUntilMinTime( *bench, args, numThreads, minTime );
+                    result.name      = name;
+                    PrintResult( result );
+                    results.push_back( result );
+                }
+            }
+        }
+
+        if ( !outputFile.empty() && !listOnly )
+        {
+            if ( !WriteJSON( outputFile, argv[0], results ) )
+            {
+                return 1;
+            }
+            std::cout << "Wrote results to '" << outputFile << "'" << std::endl;
+        }
+
+        return 0;
+    }
+
+} // namespace Bench
+} // namespace Progression
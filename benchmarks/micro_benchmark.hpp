@@ -0,0 +1,128 @@
+#pragma once
+
+#include "core/platform_defines.hpp"
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+// A small Google Benchmark style harness for timing engine primitives in isolation. Each
+// benchmark is a function taking a State, registered with PG_BENCHMARK, and optionally given
+// arguments and thread counts:
+//
+//     static void BM_Foo( Bench::State& state )
+//     {
+//         while ( state.KeepRunning() ) { ... }
+//         state.SetItemsProcessed( state.iterations() );
+//     }
+//     PG_BENCHMARK( BM_Foo )->Arg( 64 )->Arg( 4096 )->Threads( 4 );
+//
+// The iteration count is grown until a run takes at least the minimum time, and the results can
+// be written out in the same JSON format Google Benchmark uses, so runs can be diffed with its tools
+
+#define _PG_BENCH_CONCAT_INTERNAL( a, b ) a##b
+#define _PG_BENCH_CONCAT( a, b ) _PG_BENCH_CONCAT_INTERNAL( a, b )
+#define PG_BENCHMARK( func ) static Progression::Bench::Benchmark* _PG_BENCH_CONCAT( s_pgBenchmark, __LINE__ ) = \
+    Progression::Bench::Register( #func, func )
+
+namespace Progression
+{
+namespace Bench
+{
+
+    class State
+    {
+    public:
+        State( uint64_t maxIterations, const std::vector< int64_t >& args, int threadIndex, int numThreads );
+
+        bool KeepRunning()
+        {
+            if ( m_iterations < m_maxIterations && m_error.empty() )
+            {
+                if ( m_iterations++ == 0 )
+                {
+                    ResumeTiming();
+                }
+                return true;
+            }
+            PauseTiming();
+            return false;
+        }
+
+        // For per iteration setup that shouldn't be counted, like restoring the input data
+        void PauseTiming();
+        void ResumeTiming();
+
+        int64_t range( size_t index = 0 ) const { return m_args[index]; }
+        uint64_t iterations() const { return m_iterations; }
+        int thread_index() const { return m_threadIndex; }
+        int threads() const { return m_numThreads; }
+
+        void SetItemsProcessed( uint64_t items ) { m_itemsProcessed = items; }
+        void SetBytesProcessed( uint64_t bytes ) { m_bytesProcessed = bytes; }
+
+        // Stops the benchmark and reports the message instead of any timings, for when the setup fails
+        void SkipWithError( const std::string& message ) { m_error = message; }
+
+        // Reported as is, summed over the threads
+        std::map< std::string, double > counters;
+
+    private:
+        friend class Runner;
+
+        uint64_t m_iterations = 0;
+        uint64_t m_maxIterations;
+        std::vector< int64_t > m_args;
+        int m_threadIndex;
+        int m_numThreads;
+        uint64_t m_itemsProcessed = 0;
+        uint64_t m_bytesProcessed = 0;
+        std::string m_error;
+
+        bool m_timing      = false;
+        double m_realTime  = 0; // seconds
+        double m_cpuTime   = 0; // seconds, for this process, so includes the other benchmark threads
+        std::chrono::high_resolution_clock::time_point m_realStart;
+        std::clock_t m_cpuStart;
+    };
+
+    class Benchmark
+    {
+    public:
+        Benchmark( const std::string& name, const std::function< void( State& ) >& func );
+
+        // Each call adds another run of the benchmark, with state.range( 0 ) == arg
+        Benchmark* Arg( int64_t arg );
+        Benchmark* Args( const std::vector< int64_t >& args );
+        // Each call adds another run of every arg set, on that many threads at once
+        Benchmark* Threads( int numThreads );
+
+        std::string name;
+        std::function< void( State& ) > func;
+        std::vector< std::vector< int64_t > > argSets;
+        std::vector< int > threadCounts;
+    };
+
+    Benchmark* Register( const std::string& name, const std::function< void( State& ) >& func );
+
+    // Keeps the compiler from optimizing away a result that is otherwise never used
+    template < typename T >
+    inline void DoNotOptimize( const T& value )
+    {
+#if USING( WINDOWS_PROGRAM )
+        static const void* volatile s_sink;
+        s_sink = &value;
+#else // #if USING( WINDOWS_PROGRAM )
+        asm volatile( "" : : "r,m"( value ) : "memory" );
+#endif // #else // #if USING( WINDOWS_PROGRAM )
+    }
+
+    // Parses the command line, runs every registered benchmark that matches the filter, prints a
+    // table of the results and optionally writes them as JSON. Returns the process exit code
+    int RunBenchmarks( int argc, char* argv[] );
+
+} // namespace Bench
+} // namespace Progression
@@ -0,0 +1,414 @@
+#include "progression.hpp"
+#include "getopt/getopt.h"
+#include "utils/json_parsing.hpp"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+using namespace Progression;
+
+// Runs a scene for a fixed number of frames with a fixed timestep, moving the camera along a
+// scripted path, and writes the per stage frame times as JSON so that regressions show up when
+// runs are diffed across commits. With --headless there is no window, swapchain or Vulkan device
+// at all, so the fastfile loading, scene update and culling stages can be tracked on machines
+// without a GPU
+
+struct CameraKeyFrame
+{
+    float time; // seconds
+    glm::vec3 position;
+    glm::vec3 rotation; // radians
+};
+
+struct StageStats
+{
+    double minMs = 0;
+    double avgMs = 0;
+    double p50Ms = 0;
+    double p99Ms = 0;
+    double maxMs = 0;
+};
+
+static void DisplayHelp()
+{
+    auto msg =
+      "Usage: bench [options] SCENE_FILE\n"
+      "Runs the scene along a camera path with a fixed timestep and writes the frame timings as JSON\n"
+      "\nOptions\n"
+      "  -d, --dt SECONDS\tFixed timestep of every frame. Default is 1/60\n"
+      "  -f, --frames N\t\tNumber of frames to measure. Default is 600\n"
+      "  -h, --help\t\tPrint this message and exit\n"
+      "  -H, --headless\tDon't create a window or use the GPU, only the CPU stages are measured\n"
+      "  -m, --memory FILE\tAlso write the current and peak memory of every memory tag, with the scene still loaded\n"
+      "  -o, --output FILE\tWhere to write the results. Default is bench.json\n"
+      "  -p, --path FILE\tJSON camera path: { \"keyframes\": [ { \"time\", \"position\", \"rotation\" }, ... ] }.\n"
+      "\t\t\tThe time is in seconds and the rotation is in degrees. The path loops.\n"
+      "\t\t\tDefault is one full turn in place from the scene's camera over the whole run\n"
+      "  -w, --warmup N\t\tNumber of frames to run before measuring. Default is 30\n"
+      "\nExits with 1 if any frame after the warmup made a heap allocation\n";
+
+    std::cout << msg << std::endl;
+}
+
+static bool LoadCameraPath( const std::string& filename, std::vector< CameraKeyFrame >& path )
+{
+    auto document = ParseJSONFile( filename );
+    if ( document.IsNull() || !document.HasMember( "keyframes" ) || !document["keyframes"].IsArray() )
+    {
+        LOG_ERR( "Camera path '", filename, "' needs a 'keyframes' array" );
+        return false;
+    }
+
+    for ( auto& v : document["keyframes"].GetArray() )
+    {
+        PG_ASSERT( v.HasMember( "time" ) && v.HasMember( "position" ) && v.HasMember( "rotation" ) );
+        CameraKeyFrame keyFrame;
+        keyFrame.time     = ParseNumber< float >( v["time"] );
+        keyFrame.position = ParseVec3( v["position"] );
+        keyFrame.rotation = glm::radians( ParseVec3( v["rotation"] ) );
+        path.push_back( keyFrame );
+    }
+    std::sort( path.begin(), path.end(), []( const CameraKeyFrame& a, const CameraKeyFrame& b ) { return a.time < b.time; } );
+
+    return !path.empty();
+}
+
+static void MoveCameraAlongPath( Camera& camera, const std::vector< CameraKeyFrame >& path, float time )
+{
+    float duration = path.back().time;
+    if ( duration > 0 )
+    {
+        time = std::fmod( time, duration );
+    }
+
+    size_t next = 0;
+    while ( next < path.size() - 1 && path[next].time <= time )
+    {
+        ++next;
+    }
+    const CameraKeyFrame& a = path[next == 0 ? 0 : next - 1];
+    const CameraKeyFrame& b = path[next];
+    float t = b.time > a.time ? ( time - a.time ) / ( b.time - a.time ) : 0;
+    t       = glm::clamp( t, 0.0f, 1.0f );
+
+    camera.position = glm::mix( a.position, b.position, t );
+    camera.rotation = glm::mix( a.rotation, b.rotation, t );
+    camera.UpdateFrustum();
+}
+
+static StageStats ComputeStats( std::vector< double > times )
+{
+    StageStats stats;
+    if ( times.empty() )
+    {
+        return stats;
+    }
+
+    std::sort( times.begin(), times.end() );
+    double total = 0;
+    for ( double t : times )
+    {
+        total += t;
+    }
+    size_t p99Index = std::min( ( 99 * times.size() + 99 ) / 100 - 1, times.size() - 1 );
+    stats.minMs     = times.front();
+    stats.avgMs     = total / times.size();
+    stats.p50Ms     = times[times.size() / 2];
+    stats.p99Ms     = times[p99Index];
+    stats.maxMs     = times.back();
+
+    return stats;
+}
+
+static std::string StatsToJSON( const StageStats& stats )
+{
+    std::ostringstream out;
+    out << "{ \"min_ms\": " << stats.minMs << ", \"avg_ms\": " << stats.avgMs << ", \"p50_ms\": " << stats.p50Ms
+        << ", \"p99_ms\": " << stats.p99Ms << ", \"max_ms\": " << stats.maxMs << " }";
+
+    return out.str();
+}
+
+static std::string EscapeJSON( const std::string& str )
+{
+    std::string escaped;
+    for ( char c : str )
+    {
+        if ( c == '"' || c == '\\' )
+        {
+            escaped += '\\';
+        }
+        escaped += c;
+    }
+
+    return escaped;
+}
+
+int main( int argc, char* argv[] )
+{
+    static struct option long_options[] = {
+        { "dt",       required_argument, 0, 'd' },
+        { "frames",   required_argument, 0, 'f' },
+        { "help",     no_argument,       0, 'h' },
+        { "headless", no_argument,       0, 'H' },
+        { "memory",   required_argument, 0, 'm' },
+        { "output",   required_argument, 0, 'o' },
+        { "path",     required_argument, 0, 'p' },
+        { "warmup",   required_argument, 0, 'w' },
+        { 0, 0, 0, 0 }
+    };
+
+    float dt               = 1.0f / 60;
+    int numFrames          = 600;
+    int numWarmupFrames    = 30;
+    bool headless          = false;
+    std::string outputFile = "bench.json";
+    std::string pathFile;
+    std::string memoryFile;
+    int option_index = 0;
+    int c            = -1;
+    while ( ( c = getopt_long( argc, argv, "d:f:hHm:o:p:w:", long_options, &option_index ) ) != -1 )
+    {
+        switch ( c )
+        {
+            case 'd':
+                dt = static_cast< float >( std::atof( optarg ) );
+                break;
+            case 'f':
+                numFrames = std::atoi( optarg );
+                break;
+            case 'h':
+                DisplayHelp();
+                return 0;
+            case 'H':
+                headless = true;
+                break;
+            case 'm':
+                memoryFile = optarg;
+                break;
+            case 'o':
+                outputFile = optarg;
+                break;
+            case 'p':
+                pathFile = optarg;
+                break;
+            case 'w':
+                numWarmupFrames = std::atoi( optarg );
+                break;
+            case '?':
+                std::cout << "Try 'bench --help' for more information" << std::endl;
+                return 1;
+            default:
+                break;
+        }
+    }
+
+    if ( optind >= argc || numFrames <= 0 || numWarmupFrames < 0 || dt <= 0 )
+    {
+        DisplayHelp();
+        return 1;
+    }
+    std::string sceneFile = argv[optind];
+
+    Gfx::g_headless = headless;
+    auto initStart  = Time::GetTimePoint();
+    if ( !PG::EngineInitialize( PG_ROOT_DIR "configs/bench.toml" ) )
+    {
+        std::cout << "Failed to initialize the engine" << std::endl;
+        return 1;
+    }
+    double engineInitMs = Time::GetDuration( initStart );
+
+    auto loadStart = Time::GetTimePoint();
+    Scene* scene   = Scene::Load( sceneFile );
+    if ( !scene )
+    {
+        LOG_ERR( "Could not load scene '", sceneFile, "'" );
+        PG::EngineQuit();
+        return 1;
+    }
+    double sceneLoadMs = Time::GetDuration( loadStart );
+    scene->Start();
+
+    std::vector< CameraKeyFrame > path;
+    if ( pathFile.empty() )
+    {
+        float duration = ( numWarmupFrames + numFrames ) * dt;
+        path.push_back( { 0,        scene->camera.position, scene->camera.rotation } );
+        path.push_back( { duration, scene->camera.position, scene->camera.rotation + glm::vec3( 0, glm::radians( 360.0f ), 0 ) } );
+    }
+    else if ( !LoadCameraPath( pathFile, path ) )
+    {
+        delete scene;
+        PG::EngineQuit();
+        return 1;
+    }
+
+    // Reserved up front, so that recording the results doesn't show up as heap allocations in the frames
+    std::vector< double > updateTimes, cullingTimes, renderTimes, frameTimes;
+    std::vector< uint64_t > heapAllocations;
+    updateTimes.reserve( numFrames );
+    cullingTimes.reserve( numFrames );
+    renderTimes.reserve( numFrames );
+    frameTimes.reserve( numFrames );
+    heapAllocations.reserve( numFrames );
+    uint64_t totalVisibleModels = 0;
+    Window* window = headless ? nullptr : GetMainWindow();
+    Time::SetFixedDeltaTime( dt );
+    Time::Reset();
+    for ( int frame = 0; frame < numWarmupFrames + numFrames; ++frame )
+    {
+        auto frameStart = Time::GetTimePoint();
+        if ( window )
+        {
+            window->StartFrame();
+            Input::PollEvents();
+        }
+        else
+        {
+            Time::StartFrame();
+        }
+
+        auto start = Time::GetTimePoint();
+        scene->Update();
+        double updateMs = Time::GetDuration( start );
+
+        // After the update, so that any camera scripts in the scene don't fight the path
+        MoveCameraAlongPath( scene->camera, path, frame * dt );
+
+        start = Time::GetTimePoint();
+        RenderSystem::CullScene( scene );
+        double cullingMs = Time::GetDuration( start );
+
+        // Recording and submitting the frame, reusing the culling above. Render only blocks on the GPU once it
+        // is numFramesInFlight frames behind, so this is the CPU cost of the frame until the GPU becomes the bottleneck
+        double renderMs = 0;
+        if ( !headless )
+        {
+            start = Time::GetTimePoint();
+            RenderSystem::Render( scene );
+            renderMs = Time::GetDuration( start );
+        }
+
+        if ( window )
+        {
+            window->EndFrame();
+        }
+        else
+        {
+            Time::EndFrame();
+            CpuProfile::EndFrame();
+            MemoryManager::EndFrame();
+        }
+
+        if ( frame == numWarmupFrames - 1 && !headless )
+        {
+            Gfx::Profile::ResetStats();
+        }
+        if ( frame >= numWarmupFrames )
+        {
+            updateTimes.push_back( updateMs );
+            cullingTimes.push_back( cullingMs );
+            renderTimes.push_back( renderMs );
+            frameTimes.push_back( Time::GetDuration( frameStart ) );
+            totalVisibleModels += RenderSystem::GetNumVisibleModels();
+            heapAllocations.push_back( MemoryManager::NumHeapAllocationsLastFrame() );
+        }
+    }
+
+    if ( !headless )
+    {
+        PG::Gfx::g_renderState.device.WaitForIdle();
+    }
+
+    std::ofstream out( outputFile );
+    if ( !out )
+    {
+        LOG_ERR( "Could not open the output file '", outputFile, "'" );
+    }
+    else
+    {
+        out << "{\n";
+        out << "    \"benchmark\": \"scene\",\n";
+        out << "    \"scene\": \"" << EscapeJSON( sceneFile ) << "\",\n";
+        out << "    \"headless\": " << ( headless ? "true" : "false" ) << ",\n";
+        out << "    \"frames\": " << numFrames << ",\n";
+        out << "    \"warmup_frames\": " << numWarmupFrames << ",\n";
+        out << "    \"dt\": " << dt << ",\n";
+        out << "    \"engine_init_ms\": " << engineInitMs << ",\n";
+        out << "    \"scene_load_ms\": " << sceneLoadMs << ",\n";
+        out << "    \"fastfiles\": [\n";
+        const auto& fastfiles = ResourceManager::GetFastfileLoadStats();
+        for ( size_t i = 0; i < fastfiles.size(); ++i )
+        {
+            out << "        { \"file\": \"" << EscapeJSON( fastfiles[i].filename ) << "\", \"load_ms\": " << fastfiles[i].milliseconds << " }"
+                << ( i + 1 < fastfiles.size() ? ",\n" : "\n" );
+        }
+        out << "    ],\n";
+        out << "    \"avg_visible_models\": " << static_cast< double >( totalVisibleModels ) / numFrames << ",\n";
+#if USING( PG_COUNT_HEAP_ALLOCATIONS )
+        // Should be all 0 once the scene is in a steady state
+        uint64_t totalHeapAllocations = 0;
+        for ( uint64_t count : heapAllocations )
+        {
+            totalHeapAllocations += count;
+        }
+        out << "    \"heap_allocations_per_frame\": { \"min\": " << *std::min_element( heapAllocations.begin(), heapAllocations.end() )
+            << ", \"avg\": " << static_cast< double >( totalHeapAllocations ) / numFrames
+            << ", \"max\": " << *std::max_element( heapAllocations.begin(), heapAllocations.end() ) << " },\n";
+#endif // #if USING( PG_COUNT_HEAP_ALLOCATIONS )
+        out << "    \"stages\": {\n";
+        out << "        \"update\": " << StatsToJSON( ComputeStats( updateTimes ) ) << ",\n";
+        out << "        \"culling\": " << StatsToJSON( ComputeStats( cullingTimes ) ) << ",\n";
+        if ( !headless )
+        {
+            out << "        \"render\": " << StatsToJSON( ComputeStats( renderTimes ) ) << ",\n";
+        }
+        out << "        \"frame\": " << StatsToJSON( ComputeStats( frameTimes ) ) << "\n";
+        out << "    }";
+        if ( !headless )
+        {
+            // Only covers the last PG_GPU_PROFILE_HISTORY frames
+            out << ",\n    \"gpu\": {\n";
+            bool first = true;
+            for ( uint32_t scope = 0; scope < static_cast< uint32_t >( Gfx::Profile::GpuScope::NUM_SCOPES ); ++scope )
+            {
+                Gfx::Profile::GpuStats gpuStats = Gfx::Profile::GetStats( static_cast< Gfx::Profile::GpuScope >( scope ) );
+                if ( gpuStats.numSamples == 0 )
+                {
+                    continue;
+                }
+                out << ( first ? "" : ",\n" ) << "        \"" << Gfx::Profile::GetScopeName( static_cast< Gfx::Profile::GpuScope >( scope ) ) << "\": { \"min_ms\": "
+                    << gpuStats.minMs << ", \"avg_ms\": " << gpuStats.avgMs << ", \"p99_ms\": " << gpuStats.p99Ms << ", \"samples\": " << gpuStats.numSamples << " }";
+                first = false;
+            }
+            out << "\n    }";
+        }
+        out << "\n}" << std::endl;
+        LOG( "Wrote benchmark results to '", outputFile, "'" );
+    }
+
+    if ( !memoryFile.empty() )
+    {
+        MemoryManager::DumpMemoryStats( memoryFile );
+    }
+
+    // Once warmed up, a frame isn't allowed to touch the heap at all, so any allocation fails the run
+    bool allocated = false;
+#if USING( PG_COUNT_HEAP_ALLOCATIONS )
+    uint64_t maxHeapAllocations = *std::max_element( heapAllocations.begin(), heapAllocations.end() );
+    if ( maxHeapAllocations > 0 )
+    {
+        LOG_ERR( "Frames made heap allocations after the warmup, up to ", maxHeapAllocations, " in a single frame" );
+        allocated = true;
+    }
+#endif // #if USING( PG_COUNT_HEAP_ALLOCATIONS )
+
+    delete scene;
+    PG::EngineQuit();
+
+    return out && !allocated ? 0 : 1;
+}
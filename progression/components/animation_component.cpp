@@ -18,28 +18,52 @@ Animator::Animator( Model* m ) :
 void Animator::AssignNewModel( Model* m )
 {
     PG_ASSERT( m );
-    if ( animationSysSlotID != ~0u )
+    if ( gpuTransforms.IsValid() )
     {
-        AnimationSystem::FreeGPUTransforms( animationSysSlotID );
+        AnimationSystem::FreeGPUTransforms( gpuTransforms );
+        AnimationSystem::FreeSkinnedVertices( skinnedVertices );
     }
     model = m;
-    animationSysSlotID = AnimationSystem::AllocateGPUTransforms( static_cast< uint32_t >( m->skeleton.joints.size() ) );
+    gpuTransforms   = AnimationSystem::AllocateGPUTransforms( static_cast< uint32_t >( m->skeleton.joints.size() ) );
+    skinnedVertices = AnimationSystem::AllocateSkinnedVertices( m->GetNumVertices() );
     transformBuffer.resize( m->skeleton.joints.size() );
 }
 
 void Animator::ReleaseModel()
 {
-    if ( animationSysSlotID != ~0u )
+    if ( gpuTransforms.IsValid() )
     {
-        AnimationSystem::FreeGPUTransforms( animationSysSlotID );
-        animationSysSlotID = ~0u;
+        AnimationSystem::FreeGPUTransforms( gpuTransforms );
+        AnimationSystem::FreeSkinnedVertices( skinnedVertices );
+        gpuTransforms   = {};
+        skinnedVertices = {};
     }
     model = nullptr;
 }
 
 uint32_t Animator::GetTransformSlot() const
 {
-    return GET_ANIMATOR_SLOT_FROM_ID( animationSysSlotID );
+    return gpuTransforms.offset;
+}
+
+uint32_t Animator::GetSkinnedVertexSlot() const
+{
+    return skinnedVertices.offset;
+}
+
+size_t Animator::GetSkinnedPositionOffset() const
+{
+    return skinnedVertices.offset * SKINNED_VERTEX_SIZE;
+}
+
+size_t Animator::GetSkinnedNormalOffset() const
+{
+    return GetSkinnedPositionOffset() + model->GetNumVertices() * sizeof( glm::vec3 );
+}
+
+size_t Animator::GetSkinnedTangentOffset() const
+{
+    return GetSkinnedPositionOffset() + 2 * model->GetNumVertices() * sizeof( glm::vec3 );
 }
 
 Model* Animator::GetModel() const
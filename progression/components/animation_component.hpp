@@ -2,6 +2,10 @@
 
 #include <vector>
 #include "core/math.hpp"
+#include "core/range_allocator.hpp"
+
+// positions, normals and tangents
+#define SKINNED_VERTEX_SIZE ( 3 * sizeof( glm::vec3 ) )
 
 namespace Progression
 {
@@ -16,6 +20,11 @@ namespace Progression
         void AssignNewModel( Model* m );
         void ReleaseModel();
         uint32_t GetTransformSlot() const;
+        uint32_t GetSkinnedVertexSlot() const;
+        // byte offsets into AnimationSystem::renderData.skinnedVertexBuffer
+        size_t GetSkinnedPositionOffset() const;
+        size_t GetSkinnedNormalOffset() const;
+        size_t GetSkinnedTangentOffset() const;
         Model* GetModel() const;
 
         Animation* animation        = nullptr;
@@ -25,8 +34,9 @@ namespace Progression
         std::vector< glm::mat4 > transformBuffer;
 
     private:
-        uint32_t animationSysSlotID = ~0u;
-        Model* model         = nullptr;
+        RangeAllocator::Allocation gpuTransforms;
+        RangeAllocator::Allocation skinnedVertices;
+        Model* model = nullptr;
     };
 
 } // namespace Progression
\ No newline at end of file
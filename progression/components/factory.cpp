@@ -78,9 +78,9 @@ namespace Progression
         Transform& t = registry.assign< Transform >( e );
         static FunctionMapper< void, Transform& > mapping(
         {
-            { "position", []( rapidjson::Value& v, Transform& t ) { t.position = ParseVec3( v ); } },
-            { "rotation", []( rapidjson::Value& v, Transform& t ) { t.rotation = glm::radians( ParseVec3( v ) ); } },
-            { "scale",    []( rapidjson::Value& v, Transform& t ) { t.scale    = ParseVec3( v ); } },
+            { "position", []( rapidjson::Value& v, Transform& t ) { t.SetPosition( ParseVec3( v ) ); } },
+            { "rotation", []( rapidjson::Value& v, Transform& t ) { t.SetEulerAngles( glm::radians( ParseVec3( v ) ) ); } },
+            { "scale",    []( rapidjson::Value& v, Transform& t ) { t.SetScale( ParseVec3( v ) ); } },
         });
 
         mapping.ForEachMember( value, t );
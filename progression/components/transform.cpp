@@ -5,14 +5,45 @@ namespace Progression
 
 glm::mat4 Transform::GetModelMatrix() const
 {
-    glm::mat4 model( 1 );
-    model = glm::translate( model, position );
-    model = glm::rotate( model, rotation.y, glm::vec3( 0, 1, 0 ) );
-    model = glm::rotate( model, rotation.x, glm::vec3( 1, 0, 0 ) );
-    model = glm::rotate( model, rotation.z, glm::vec3( 0, 0, 1 ) );
-    model = glm::scale( model, scale );
+    glm::mat4 model = glm::mat4_cast( m_rotation );
+    model[0] *= m_scale.x;
+    model[1] *= m_scale.y;
+    model[2] *= m_scale.z;
+    model[3]  = glm::vec4( m_position, 1 );
 
     return model;
 }
 
+void Transform::SetPosition( const glm::vec3& position )
+{
+    m_position = position;
+    m_dirty    = true;
+}
+
+void Transform::SetRotation( const glm::quat& rotation )
+{
+    m_rotation = rotation;
+    m_dirty    = true;
+}
+
+void Transform::SetEulerAngles( const glm::vec3& eulerAngles )
+{
+    m_rotation = glm::angleAxis( eulerAngles.y, glm::vec3( 0, 1, 0 ) ) *
+                 glm::angleAxis( eulerAngles.x, glm::vec3( 1, 0, 0 ) ) *
+                 glm::angleAxis( eulerAngles.z, glm::vec3( 0, 0, 1 ) );
+    m_dirty    = true;
+}
+
+void Transform::SetScale( const glm::vec3& scale )
+{
+    m_scale = scale;
+    m_dirty = true;
+}
+
+void Transform::Rotate( float angle, const glm::vec3& axis )
+{
+    m_rotation = glm::normalize( m_rotation * glm::angleAxis( angle, glm::normalize( axis ) ) );
+    m_dirty    = true;
+}
+
 } // namespace Progression
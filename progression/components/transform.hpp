@@ -5,16 +5,47 @@
 namespace Progression
 {
 
+// Local transform of an entity, relative to its parent (EntityMetaData::parent) if it has one.
+// The members are only reachable through the setters so that the TransformSystem knows which
+// entities actually moved this frame and only recomputes their WorldTransform.
 class Transform
 {
 public:
     Transform() = default;
 
+    // Local TRS matrix. Use WorldTransform::M for the final object to world matrix
     glm::mat4 GetModelMatrix() const;
 
-    glm::vec3 position = glm::vec3( 0 );
-    glm::vec3 rotation = glm::vec3( 0 );
-    glm::vec3 scale    = glm::vec3( 1 );
+    const glm::vec3& GetPosition() const { return m_position; }
+    const glm::quat& GetRotation() const { return m_rotation; }
+    const glm::vec3& GetScale() const { return m_scale; }
+
+    void SetPosition( const glm::vec3& position );
+    void SetRotation( const glm::quat& rotation );
+    // Euler angles in radians, applied in the Y, X, Z order
+    void SetEulerAngles( const glm::vec3& eulerAngles );
+    void SetScale( const glm::vec3& scale );
+    // Rotates around the given local axis
+    void Rotate( float angle, const glm::vec3& axis );
+
+    bool IsDirty() const { return m_dirty; }
+    void MarkDirty() { m_dirty = true; }
+    void ClearDirty() { m_dirty = false; }
+
+private:
+    glm::vec3 m_position = glm::vec3( 0 );
+    glm::quat m_rotation = glm::quat( 1, 0, 0, 0 );
+    glm::vec3 m_scale    = glm::vec3( 1 );
+    bool m_dirty         = true;
+};
+
+// Cached results of the hierarchy update. Only written by the TransformSystem
+struct WorldTransform
+{
+    glm::mat4 M           = glm::mat4( 1 ); // object to world
+    glm::mat4 N           = glm::mat4( 1 ); // transpose( inverse( M ) ), for transforming normals
+    uint32_t depth        = 0;              // number of ancestors
+    bool updatedThisFrame = true;           // lets children know they need to be recomputed too
 };
 
 } // namespace Progression
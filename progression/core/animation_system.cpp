@@ -1,23 +1,122 @@
 #include "core/animation_system.hpp"
 #include "core/assert.hpp"
+#include "core/memory_manager.hpp"
 #include "core/scene.hpp"
+#include "core/system_scheduler.hpp"
 #include "core/time.hpp"
 #include "components/animation_component.hpp"
 #include "components/skinned_renderer.hpp"
 #include "graphics/debug_marker.hpp"
-#include "graphics/render_system.hpp"
+#include "graphics/shader_c_shared/structs.h"
 #include "graphics/vulkan.hpp"
 #include "resource/resource_manager.hpp"
 #include "resource/shader.hpp"
 #include "resource/model.hpp"
 #include "utils/logger.hpp"
-#include <list>
+#include <algorithm>
 
 using namespace Progression::Gfx;
 
-extern struct Progression::RenderSystem::GBufferPassData gBufferPassData;
+static Progression::RangeAllocator s_transformAllocator;
+static Progression::RangeAllocator s_skinnedVertexAllocator;
 
-static std::list< std::pair< uint32_t, uint32_t > > s_freeList;
+static void UpdateSharedDescriptorSet()
+{
+    using namespace Progression::AnimationSystem;
+    std::vector< VkWriteDescriptorSet > writeDescriptorSets;
+	std::vector< VkDescriptorBufferInfo > bufferDescriptors;
+    bufferDescriptors =
+    {
+        DescriptorBufferInfo( renderData.gpuBoneBuffer ),
+        DescriptorBufferInfo( renderData.skinnedVertexBuffer ),
+    };
+    writeDescriptorSets =
+    {
+        WriteDescriptorSet( renderData.sharedDescriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 0, &bufferDescriptors[0] ),
+        WriteDescriptorSet( renderData.sharedDescriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, &bufferDescriptors[1] ),
+    };
+    g_renderState.device.UpdateDescriptorSets( static_cast< uint32_t >( writeDescriptorSets.size() ), writeDescriptorSets.data() );
+}
+
+static Buffer NewSkinnedVertexBuffer( uint32_t numVertices )
+{
+    PG_MEMORY_TAG( Animation );
+    return g_renderState.device.NewBuffer( SKINNED_VERTEX_SIZE * numVertices, BUFFER_TYPE_STORAGE | BUFFER_TYPE_VERTEX, MEMORY_TYPE_DEVICE_LOCAL, "Skinned Vertices" );
+}
+
+// Grows the bone buffer so that an allocation of numTransforms is guaranteed to fit. Allocations
+// keep their offsets when the allocator grows, so relocating is just a copy into the new buffer
+static void GrowGPUTransforms( uint32_t numTransforms )
+{
+    using namespace Progression::AnimationSystem;
+    PG_MEMORY_TAG( Animation );
+    uint32_t oldSize = s_transformAllocator.Size();
+    uint32_t newSize = std::max( 2 * oldSize, oldSize + numTransforms );
+    LOG_WARN( "Growing the animation bone buffer from ", oldSize, " to ", newSize, " transforms" );
+    if ( g_headless )
+    {
+        s_transformAllocator.Grow( newSize );
+        return;
+    }
+
+    // The old buffer could still be in use by a frame in flight
+    g_renderState.device.WaitForIdle();
+    Buffer newBuffer = g_renderState.device.NewBuffer( sizeof( glm::mat4 ) * newSize * MAX_FRAMES_IN_FLIGHT,
+        BUFFER_TYPE_STORAGE, MEMORY_TYPE_HOST_VISIBLE | MEMORY_TYPE_HOST_COHERENT, "Bone Transforms" );
+    newBuffer.Map();
+    // Each frame's region grows in place, so every region has to move over separately
+    for ( int frame = 0; frame < MAX_FRAMES_IN_FLIGHT; ++frame )
+    {
+        glm::mat4* dst = reinterpret_cast< glm::mat4* >( newBuffer.MappedPtr() ) + frame * newSize;
+        glm::mat4* src = reinterpret_cast< glm::mat4* >( renderData.gpuBoneBuffer.MappedPtr() ) + frame * oldSize;
+        memcpy( dst, src, sizeof( glm::mat4 ) * oldSize );
+    }
+    renderData.gpuBoneBuffer.UnMap();
+    renderData.gpuBoneBuffer.Free();
+    renderData.gpuBoneBuffer = newBuffer;
+
+    UpdateSharedDescriptorSet();
+    s_transformAllocator.Grow( newSize );
+}
+
+// Same as GrowGPUTransforms, but the skinned vertices are regenerated every frame so nothing needs to be copied
+static void GrowSkinnedVertices( uint32_t numVertices )
+{
+    using namespace Progression::AnimationSystem;
+    uint32_t oldSize = s_skinnedVertexAllocator.Size();
+    uint32_t newSize = std::max( 2 * oldSize, oldSize + numVertices );
+    LOG_WARN( "Growing the skinned vertex buffer from ", oldSize, " to ", newSize, " vertices" );
+    if ( g_headless )
+    {
+        s_skinnedVertexAllocator.Grow( newSize );
+        return;
+    }
+
+    g_renderState.device.WaitForIdle();
+    renderData.skinnedVertexBuffer.Free();
+    renderData.skinnedVertexBuffer = NewSkinnedVertexBuffer( newSize );
+
+    UpdateSharedDescriptorSet();
+    s_skinnedVertexAllocator.Grow( newSize );
+}
+
+static DescriptorSet& GetModelDescriptorSet( Progression::Model* model )
+{
+    using namespace Progression::AnimationSystem;
+    auto it = renderData.modelDescriptorSets.find( model );
+    if ( it != renderData.modelDescriptorSets.end() )
+    {
+        return it->second;
+    }
+
+    PG_ASSERT( renderData.modelDescriptorSets.size() < MAX_NUM_SKINNED_MODELS, "Too many unique skinned models, increase MAX_NUM_SKINNED_MODELS" );
+    DescriptorSet set = renderData.descriptorPool.NewDescriptorSet( renderData.descriptorSetLayouts[PG_SKINNING_MODEL_SET], model->name + " skinning" );
+    VkDescriptorBufferInfo bufferDescriptor = DescriptorBufferInfo( model->vertexBuffer );
+    VkWriteDescriptorSet writeDescriptorSet = WriteDescriptorSet( set, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 0, &bufferDescriptor );
+    g_renderState.device.UpdateDescriptorSets( 1, &writeDescriptorSet );
+
+    return renderData.modelDescriptorSets[model] = set;
+}
 
 namespace Progression
 {
@@ -29,73 +128,41 @@ RenderData renderData;
 
 bool Init()
 {
-    s_freeList = { { 0, MAX_ANIMATOR_NUM_TRANSFORMS } };
-    renderData.gpuBoneBuffer = g_renderState.device.NewBuffer( sizeof( glm::mat4 ) * MAX_ANIMATOR_NUM_TRANSFORMS,
+    PG_MEMORY_TAG( Animation );
+    // Headless still needs the allocators, since every Animator gets a slot on construction
+    s_transformAllocator.Init( INITIAL_ANIMATOR_NUM_TRANSFORMS );
+    s_skinnedVertexAllocator.Init( INITIAL_NUM_SKINNED_VERTICES );
+    if ( g_headless )
+    {
+        return true;
+    }
+
+    renderData.gpuBoneBuffer = g_renderState.device.NewBuffer( sizeof( glm::mat4 ) * INITIAL_ANIMATOR_NUM_TRANSFORMS * MAX_FRAMES_IN_FLIGHT,
         BUFFER_TYPE_STORAGE, MEMORY_TYPE_HOST_VISIBLE | MEMORY_TYPE_HOST_COHERENT, "Bone Transforms" );
     renderData.gpuBoneBuffer.Map();
+    renderData.skinnedVertexBuffer = NewSkinnedVertexBuffer( INITIAL_NUM_SKINNED_VERTICES );
 
     VkDescriptorPoolSize poolSize[1] = {};
     poolSize[0].type            = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-    poolSize[0].descriptorCount = 1;
+    poolSize[0].descriptorCount = 2 + MAX_NUM_SKINNED_MODELS;
 
-    renderData.descriptorPool = g_renderState.device.NewDescriptorPool( 1, poolSize, 1, "animation system" );
+    renderData.descriptorPool = g_renderState.device.NewDescriptorPool( 1, poolSize, 1 + MAX_NUM_SKINNED_MODELS, "animation system" );
 
-    auto vertShader = ResourceManager::Get< Shader >( "animatedModelsVert" );
-    auto fragShader = ResourceManager::Get< Shader >( "gBufferFrag" );
+    auto compShader = ResourceManager::Get< Shader >( "skinningComp" );
+    PG_ASSERT( compShader );
 
-    std::vector< DescriptorSetLayoutData > descriptorSetData = vertShader->reflectInfo.descriptorSetLayouts;
-    descriptorSetData.insert( descriptorSetData.end(), fragShader->reflectInfo.descriptorSetLayouts.begin(), fragShader->reflectInfo.descriptorSetLayouts.end() );
-    auto combined = CombineDescriptorSetLayouts( descriptorSetData );
+    renderData.descriptorSetLayouts = g_renderState.device.NewDescriptorSetLayouts( compShader->reflectInfo.descriptorSetLayouts );
+    renderData.sharedDescriptorSet  = renderData.descriptorPool.NewDescriptorSet( renderData.descriptorSetLayouts[PG_SKINNING_SHARED_SET], "skinning shared" );
+    UpdateSharedDescriptorSet();
 
-    renderData.descriptorSetLayouts        = g_renderState.device.NewDescriptorSetLayouts( combined );
-    renderData.animationBonesDescriptorSet = renderData.descriptorPool.NewDescriptorSet( renderData.descriptorSetLayouts[2], "skeletal animation" );
+    ComputePipelineDescriptor pipelineDesc;
+    pipelineDesc.shader               = compShader.get();
+    pipelineDesc.descriptorSetLayouts = renderData.descriptorSetLayouts;
 
-    std::vector< VkWriteDescriptorSet > writeDescriptorSets;
-	std::vector< VkDescriptorBufferInfo > bufferDescriptors;
-    bufferDescriptors =
+    renderData.skinningPipeline = g_renderState.device.NewComputePipeline( pipelineDesc, "skinning" );
+    if ( !renderData.skinningPipeline )
     {
-        DescriptorBufferInfo( renderData.gpuBoneBuffer ),
-    };
-    writeDescriptorSets =
-    {
-        WriteDescriptorSet( renderData.animationBonesDescriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 0, &bufferDescriptors[0] ),
-    };
-    g_renderState.device.UpdateDescriptorSets( static_cast< uint32_t >( writeDescriptorSets.size() ), writeDescriptorSets.data() );
-
-    VertexBindingDescriptor bindingDescs[] =
-    {
-        VertexBindingDescriptor( 0, sizeof( glm::vec3 ) ),
-        VertexBindingDescriptor( 1, sizeof( glm::vec3 ) ),
-        VertexBindingDescriptor( 2, sizeof( glm::vec2 ) ),
-        VertexBindingDescriptor( 3, sizeof( glm::vec3 ) ),
-        VertexBindingDescriptor( 4, 2 * sizeof( glm::vec4 ) ),
-    };
-
-    VertexAttributeDescriptor attribDescs[] =
-    {
-        VertexAttributeDescriptor( 0, 0, BufferDataType::FLOAT3, 0 ),
-        VertexAttributeDescriptor( 1, 1, BufferDataType::FLOAT3, 0 ),
-        VertexAttributeDescriptor( 2, 2, BufferDataType::FLOAT2, 0 ),
-        VertexAttributeDescriptor( 3, 3, BufferDataType::FLOAT3, 0 ),
-        VertexAttributeDescriptor( 4, 4, BufferDataType::FLOAT4, 0 ),
-        VertexAttributeDescriptor( 5, 4, BufferDataType::UINT4, sizeof( glm::vec4 ) ),
-    };
-
-    PipelineDescriptor pipelineDesc;
-    pipelineDesc.renderPass             = &gBufferPassData.renderPass;
-    pipelineDesc.descriptorSetLayouts   = renderData.descriptorSetLayouts;
-    pipelineDesc.vertexDescriptor       = VertexInputDescriptor::Create( 5, bindingDescs, 6, attribDescs );
-    pipelineDesc.viewport               = FullScreenViewport();
-    pipelineDesc.viewport.height        = -pipelineDesc.viewport.height;
-    pipelineDesc.viewport.y             = -pipelineDesc.viewport.height;
-    pipelineDesc.scissor                = FullScreenScissor();
-    pipelineDesc.shaders[0]             = vertShader.get();
-    pipelineDesc.shaders[1]             = fragShader.get();
-
-    renderData.animatedPipeline = g_renderState.device.NewPipeline( pipelineDesc, "animation" );
-    if ( !renderData.animatedPipeline )
-    {
-        LOG_ERR( "Could not create animated model pipeline" );
+        LOG_ERR( "Could not create skinning pipeline" );
         return false;
     }
 
@@ -104,17 +171,25 @@ bool Init()
 
 void Shutdown()
 {
+    if ( g_headless )
+    {
+        return;
+    }
+
     g_renderState.device.WaitForIdle();
     renderData.gpuBoneBuffer.UnMap();
     renderData.gpuBoneBuffer.Free();
+    renderData.skinnedVertexBuffer.Free();
+    renderData.modelDescriptorSets.clear();
     FreeDescriptorSetLayouts( renderData.descriptorSetLayouts );
     renderData.descriptorPool.Free();
-    renderData.animatedPipeline.Free();
+    renderData.skinningPipeline.Free();
 }
 
 void Update( Scene* scene )
 {
-    scene->registry.view< Animator >().each([&]( const entt::entity e, Animator& comp )
+    // Each animator only writes to its own transform buffer, so they can all be updated in parallel
+    ParallelEach< Animator >( scene->registry, [&]( const entt::entity e, Animator& comp )
     {
         if ( comp.animation && comp.animationTime < comp.animation->duration )
         {
@@ -153,76 +228,127 @@ void Update( Scene* scene )
 
             comp.GetModel()->ApplyPoseToJoints( 0, glm::mat4( 1 ), comp.transformBuffer );
         }
-    });
+    }, 4 );
 }
 
 void UploadToGpu( Scene* scene )
 {
+    // Only writes this frame's region. Finished animations still get written, since the other regions
+    // can hold an older pose than the last one
+    glm::mat4* frameTransforms = (glm::mat4*) renderData.gpuBoneBuffer.MappedPtr() + g_renderState.currentFrame * s_transformAllocator.Size();
     scene->registry.view< Animator >().each([&]( const entt::entity e, Animator& comp )
     {
-        if ( comp.animation && comp.animationTime < comp.animation->duration )
+        if ( comp.animation )
         {
             auto& boneTransforms = comp.transformBuffer;
-            glm::mat4* ptr = (glm::mat4*) renderData.gpuBoneBuffer.MappedPtr();
-            memcpy( ptr + comp.GetTransformSlot(), boneTransforms.data(), boneTransforms.size() * sizeof( glm::mat4 ) );
+            memcpy( frameTransforms + comp.GetTransformSlot(), boneTransforms.data(), boneTransforms.size() * sizeof( glm::mat4 ) );
         }
     });
 }
 
-uint32_t AllocateGPUTransforms( uint32_t numTransforms )
+void SkinningPass( Scene* scene, CommandBuffer& cmdBuf )
 {
-    for ( auto it = s_freeList.begin(); it != s_freeList.end(); ++it )
+    PG_PROFILE_GPU_START( cmdBuf, Skinning );
+    PG_DEBUG_MARKER_BEGIN_REGION( cmdBuf, "Skinning Pass", glm::vec4( .6, .2, .6, 1 ) );
+
+    // The previous frame can still be drawing with the skinned vertices this pass overwrites
+    VkBufferMemoryBarrier warBarrier = {};
+    warBarrier.sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    warBarrier.srcAccessMask       = 0;
+    warBarrier.dstAccessMask       = VK_ACCESS_SHADER_WRITE_BIT;
+    warBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    warBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    warBarrier.buffer              = renderData.skinnedVertexBuffer.GetHandle();
+    warBarrier.offset              = 0;
+    warBarrier.size                = VK_WHOLE_SIZE;
+    cmdBuf.PipelineBarrier( VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, warBarrier );
+
+    uint32_t frameTransformOffset = g_renderState.currentFrame * s_transformAllocator.Size();
+    cmdBuf.BindComputePipeline( renderData.skinningPipeline );
+    cmdBuf.BindDescriptorSets( 1, &renderData.sharedDescriptorSet, renderData.skinningPipeline, PG_SKINNING_SHARED_SET );
+    scene->registry.view< Animator >().each( [&]( Animator& animator )
     {
-        uint32_t slot = it->first;
-        if ( numTransforms <= it->second )
+        Model* model = animator.GetModel();
+        if ( !model || model->GetBlendWeightOffset() == ~0u )
         {
-            if ( numTransforms == it->second )
-            {
-                s_freeList.erase( it );
-            }
-            else
-            {
-                it->first  = it->first + numTransforms;
-                it->second = it->second - numTransforms;
-            }
-            return slot | numTransforms << 16;
+            return;
         }
-    }
 
-    PG_ASSERT( false, "Not enough contiguous memory available for animation transforms!" );
-    return ~0u;
+        cmdBuf.BindDescriptorSets( 1, &GetModelDescriptorSet( model ), renderData.skinningPipeline, PG_SKINNING_MODEL_SET );
+
+        Gpu::SkinningConstantData pushData;
+        pushData.numVertices       = model->GetNumVertices();
+        pushData.boneTransformIdx  = frameTransformOffset + animator.GetTransformSlot();
+        pushData.positionOffset    = model->GetVertexOffset() / sizeof( float );
+        pushData.normalOffset      = model->GetNormalOffset() / sizeof( float );
+        pushData.tangentOffset     = model->GetTangentOffset() == ~0u ? ~0u : model->GetTangentOffset() / static_cast< uint32_t >( sizeof( float ) );
+        pushData.blendWeightOffset = model->GetBlendWeightOffset() / sizeof( float );
+        pushData.outputOffset      = static_cast< uint32_t >( animator.GetSkinnedPositionOffset() / sizeof( float ) );
+        cmdBuf.PushConstants( renderData.skinningPipeline, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof( Gpu::SkinningConstantData ), &pushData );
+
+        PG_DEBUG_MARKER_INSERT( cmdBuf, "Skin \"" + model->name + "\"", glm::vec4( 0 ) );
+        cmdBuf.Dispatch( ( pushData.numVertices + PG_SKINNING_GROUP_SIZE - 1 ) / PG_SKINNING_GROUP_SIZE );
+    });
+
+    VkBufferMemoryBarrier barrier = {};
+    barrier.sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcAccessMask       = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask       = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.buffer              = renderData.skinnedVertexBuffer.GetHandle();
+    barrier.offset              = 0;
+    barrier.size                = VK_WHOLE_SIZE;
+    cmdBuf.PipelineBarrier( VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, barrier );
+
+    PG_DEBUG_MARKER_END_REGION( cmdBuf );
+    PG_PROFILE_GPU_END( cmdBuf, Skinning );
 }
 
-void FreeGPUTransforms( uint32_t id )
+RangeAllocator::Allocation AllocateGPUTransforms( uint32_t numTransforms )
 {
-    uint32_t slot = GET_ANIMATOR_SLOT_FROM_ID( id );
-    uint32_t size = GET_ANIMATOR_SIZE_FROM_ID( id );
-    auto it = s_freeList.begin();
-    while ( it != s_freeList.end() && it->first < slot )
+    RangeAllocator::Allocation allocation = s_transformAllocator.Allocate( numTransforms );
+    if ( !allocation.IsValid() )
     {
-        if ( slot == it->first + it->second )
-        {
-            it->second += size;
-            auto next = std::next( it );
-            if ( next != s_freeList.end() && slot + size == next->first )
-            {
-                it->second += next->second;
-                s_freeList.erase( next );
-            }
-            return;
-        }
-        ++it;
+        GrowGPUTransforms( numTransforms );
+        allocation = s_transformAllocator.Allocate( numTransforms );
     }
+    PG_ASSERT( allocation.IsValid(), "Not enough contiguous memory available for animation transforms!" );
 
-    if ( it != s_freeList.end() && slot + size == it->first )
-    {
-        it->first   = slot;
-        it->second += size;
-    }
-    else
+    return allocation;
+}
+
+void FreeGPUTransforms( const RangeAllocator::Allocation& allocation )
+{
+    s_transformAllocator.Free( allocation );
+}
+
+RangeAllocator::Stats GetGPUTransformStats()
+{
+    return s_transformAllocator.GetStats();
+}
+
+RangeAllocator::Allocation AllocateSkinnedVertices( uint32_t numVertices )
+{
+    RangeAllocator::Allocation allocation = s_skinnedVertexAllocator.Allocate( numVertices );
+    if ( !allocation.IsValid() )
     {
-        s_freeList.insert( it, { slot, size } );
+        GrowSkinnedVertices( numVertices );
+        allocation = s_skinnedVertexAllocator.Allocate( numVertices );
     }
+    PG_ASSERT( allocation.IsValid(), "Not enough contiguous memory available for skinned vertices!" );
+
+    return allocation;
+}
+
+void FreeSkinnedVertices( const RangeAllocator::Allocation& allocation )
+{
+    s_skinnedVertexAllocator.Free( allocation );
+}
+
+RangeAllocator::Stats GetSkinnedVertexStats()
+{
+    return s_skinnedVertexAllocator.GetStats();
 }
 
 void OnAnimatorConstruction( entt::entity entity, entt::registry& registry, Animator& animator )
@@ -241,13 +367,12 @@ void OnAnimatorDestruction( entt::entity entity, entt::registry& registry )
     a.ReleaseModel();
 }
 
-void PrintFreeList()
+void PrintGPUTransformStats()
 {
-    LOG( "Animation Free List:" );
-    for ( const auto& [ slot, size ] : s_freeList )
-    {
-        LOG( "Slot = ", slot, ", size = ", size );
-    }
+    RangeAllocator::Stats stats = s_transformAllocator.GetStats();
+    LOG( "Animation transform allocator:" );
+    LOG( "Size = ", stats.totalSize, ", free = ", stats.totalFree, ", largest free region = ", stats.largestFreeRegion );
+    LOG( "Allocations = ", stats.numAllocations, ", free regions = ", stats.numFreeRegions, ", fragmentation = ", stats.fragmentation );
     LOG( "" );
 }
 
@@ -2,10 +2,13 @@
 #include "graphics/graphics_api.hpp"
 #include "components/animation_component.hpp"
 #include "core/ecs.hpp"
+#include "core/range_allocator.hpp"
+#include <unordered_map>
 
-#define MAX_ANIMATOR_NUM_TRANSFORMS 1000
-#define GET_ANIMATOR_SLOT_FROM_ID( id ) ( id & 0xFFFF )
-#define GET_ANIMATOR_SIZE_FROM_ID( id ) ( id >> 16 )
+// Starting sizes of the bone and skinned vertex buffers. They grow automatically (and relocate) when they run out of space
+#define INITIAL_ANIMATOR_NUM_TRANSFORMS 1024
+#define INITIAL_NUM_SKINNED_VERTICES 65536
+#define MAX_NUM_SKINNED_MODELS 256
 
 namespace Progression
 {
@@ -17,10 +20,15 @@ namespace AnimationSystem
 
     struct RenderData
     {
+        // One region of GetGPUTransformStats().totalSize transforms per frame in flight
         Gfx::Buffer gpuBoneBuffer;
-        Gfx::Pipeline animatedPipeline;
+        // Output of the skinning pass, read as regular vertex data by every pass that draws skinned models.
+        // See Animator::GetSkinnedPositionOffset for the layout
+        Gfx::Buffer skinnedVertexBuffer;
+        Gfx::Pipeline skinningPipeline;
         std::vector< Gfx::DescriptorSetLayout > descriptorSetLayouts;
-        Gfx::DescriptorSet animationBonesDescriptorSet;
+        Gfx::DescriptorSet sharedDescriptorSet;
+        std::unordered_map< Model*, Gfx::DescriptorSet > modelDescriptorSets;
         Gfx::DescriptorPool descriptorPool;
     };
 
@@ -34,9 +42,20 @@ namespace AnimationSystem
 
     void UploadToGpu( Scene* scene );
 
-    uint32_t AllocateGPUTransforms( uint32_t numTransforms );
+    // Skins every animated model once for the frame with a compute shader
+    void SkinningPass( Scene* scene, Gfx::CommandBuffer& cmdBuf );
 
-    void FreeGPUTransforms( uint32_t id );
+    RangeAllocator::Allocation AllocateGPUTransforms( uint32_t numTransforms );
+
+    void FreeGPUTransforms( const RangeAllocator::Allocation& allocation );
+
+    RangeAllocator::Stats GetGPUTransformStats();
+
+    RangeAllocator::Allocation AllocateSkinnedVertices( uint32_t numVertices );
+
+    void FreeSkinnedVertices( const RangeAllocator::Allocation& allocation );
+
+    RangeAllocator::Stats GetSkinnedVertexStats();
 
     void OnAnimatorConstruction( entt::entity entity, entt::registry& registry, Animator& animator );
     void OnAnimatorDestruction( entt::entity entity, entt::registry& registry );
@@ -74,6 +74,19 @@ void AABB::Encompass( const AABB& aabb, const Transform& transform )
     extent = max - min;
 }
 
+AABB AABB::Transformed( const glm::mat4& M ) const
+{
+    glm::vec3 center     = glm::vec3( M * glm::vec4( 0.5f * ( min + max ), 1 ) );
+    glm::vec3 halfExtent = 0.5f * ( max - min );
+    glm::vec3 newHalfExtent( 0 );
+    for ( int i = 0; i < 3; ++i )
+    {
+        newHalfExtent += glm::abs( glm::vec3( M[i] ) ) * halfExtent[i];
+    }
+
+    return AABB( center - newHalfExtent, center + newHalfExtent );
+}
+
 glm::mat4 AABB::GetModelMatrix() const
 {
     glm::mat4 model( 1 );
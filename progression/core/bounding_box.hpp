@@ -16,6 +16,8 @@ public:
     void SetCenter( const glm::vec3& point );
     void Encompass( const AABB& aabb, const Transform& transform );
     void Encompass( glm::vec3* points, int numPoints );
+    // Smallest AABB containing this box after it's transformed by M. Only uses min and max
+    AABB Transformed( const glm::mat4& M ) const;
     glm::mat4 GetModelMatrix() const;
     glm::vec3 GetP( const glm::vec3& planeNormal ) const;
     glm::vec3 GetN( const glm::vec3& planeNormal ) const;
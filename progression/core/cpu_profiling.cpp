@@ -0,0 +1,403 @@
+#include "core/cpu_profiling.hpp"
+#include "core/assert.hpp"
+#include "imgui/imgui.h"
+#include "utils/logger.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+namespace Progression
+{
+namespace CpuProfile
+{
+
+struct ZoneEvent
+{
+    const char* name;
+    uint64_t startNs;
+    uint64_t endNs;
+    uint32_t depth;
+    uint32_t threadIndex;
+};
+
+// Single producer (the owning thread), single consumer (EndFrame on the main thread)
+struct ThreadBuffer
+{
+    uint32_t index;
+    const char* name;
+    uint32_t depth = 0; // only touched by the owning thread
+    std::atomic< uint64_t > writePos = { 0 };
+    std::atomic< uint64_t > readPos  = { 0 };
+    std::atomic< uint64_t > numDropped = { 0 };
+    ZoneEvent events[PG_PROFILE_EVENTS_PER_THREAD];
+};
+
+struct Frame
+{
+    uint64_t startNs;
+    uint64_t endNs;
+    std::vector< ZoneEvent > events; // sorted by thread, then start time
+};
+
+struct TreeNode
+{
+    const char* name;
+    uint64_t totalNs;
+    uint32_t calls;
+    std::vector< TreeNode > children;
+};
+
+#define GPU_THREAD_INDEX ( ~0u )
+
+static std::chrono::steady_clock::time_point s_startTime = std::chrono::steady_clock::now();
+static std::atomic< bool > s_enabled = { false };
+static uint32_t s_mainThreadIndex;
+
+// Buffers outlive their threads, so that zones from a thread that just exited can still be collected.
+// They are only freed at exit, since threads keep a pointer to theirs
+static std::mutex s_threadBuffersLock;
+static std::vector< std::unique_ptr< ThreadBuffer > > s_threadBuffers;
+static thread_local ThreadBuffer* s_threadBuffer = nullptr;
+
+static std::mutex s_internLock;
+static std::unordered_set< std::string > s_internedNames;
+
+static std::vector< ZoneEvent > s_pendingGpuZones;
+static std::vector< Frame > s_frames;
+static uint32_t s_nextFrame;
+static uint32_t s_numFrames;
+static uint64_t s_frameStartNs;
+static uint64_t s_numDroppedReported;
+
+static std::vector< TreeNode > s_threadTrees; // one root per thread that had zones last frame
+static bool s_treeFrozen = false;
+
+static ThreadBuffer* GetThreadBuffer()
+{
+    if ( !s_threadBuffer )
+    {
+        std::lock_guard< std::mutex > lock( s_threadBuffersLock );
+        s_threadBuffers.emplace_back( std::make_unique< ThreadBuffer >() );
+        s_threadBuffer        = s_threadBuffers.back().get();
+        s_threadBuffer->index = static_cast< uint32_t >( s_threadBuffers.size() - 1 );
+        s_threadBuffer->name  = nullptr;
+    }
+
+    return s_threadBuffer;
+}
+
+void Init()
+{
+    s_frames.clear();
+    s_frames.resize( PG_PROFILE_HISTORY_FRAMES );
+    s_nextFrame          = 0;
+    s_numFrames          = 0;
+    s_frameStartNs       = NowNs();
+    s_numDroppedReported = 0;
+    s_pendingGpuZones.clear();
+    s_threadTrees.clear();
+    SetThreadName( "Main" );
+    s_mainThreadIndex = GetThreadBuffer()->index;
+
+    // Drop anything recorded before Init
+    {
+        std::lock_guard< std::mutex > lock( s_threadBuffersLock );
+        for ( auto& buffer : s_threadBuffers )
+        {
+            buffer->readPos.store( buffer->writePos.load( std::memory_order_acquire ), std::memory_order_release );
+        }
+    }
+    s_enabled = true;
+}
+
+void Shutdown()
+{
+    s_enabled = false;
+    s_frames.clear();
+    s_pendingGpuZones.clear();
+    s_threadTrees.clear();
+}
+
+void SetThreadName( const char* name )
+{
+    ThreadBuffer* buffer = GetThreadBuffer();
+    std::lock_guard< std::mutex > lock( s_threadBuffersLock );
+    buffer->name = name;
+}
+
+const char* InternName( const std::string& name )
+{
+    std::lock_guard< std::mutex > lock( s_internLock );
+    return s_internedNames.insert( name ).first->c_str();
+}
+
+uint64_t NowNs()
+{
+    return std::chrono::duration_cast< std::chrono::nanoseconds >( std::chrono::steady_clock::now() - s_startTime ).count();
+}
+
+Scope::Scope( const char* name ) : m_name( name ), m_startNs( NowNs() )
+{
+    ++GetThreadBuffer()->depth;
+}
+
+Scope::~Scope()
+{
+    uint64_t endNs       = NowNs();
+    ThreadBuffer* buffer = s_threadBuffer;
+    uint32_t depth       = --buffer->depth;
+    if ( !s_enabled.load( std::memory_order_relaxed ) )
+    {
+        return;
+    }
+
+    uint64_t pos = buffer->writePos.load( std::memory_order_relaxed );
+    if ( pos - buffer->readPos.load( std::memory_order_acquire ) >= PG_PROFILE_EVENTS_PER_THREAD )
+    {
+        buffer->numDropped.fetch_add( 1, std::memory_order_relaxed );
+        return;
+    }
+    buffer->events[pos & ( PG_PROFILE_EVENTS_PER_THREAD - 1 )] = { m_name, m_startNs, endNs, depth, buffer->index };
+    buffer->writePos.store( pos + 1, std::memory_order_release );
+}
+
+void AddGpuZone( const char* name, uint64_t startNs, uint64_t endNs )
+{
+    if ( s_enabled )
+    {
+        s_pendingGpuZones.push_back( { name, startNs, endNs, 0, GPU_THREAD_INDEX } );
+    }
+}
+
+// GPU zones don't know how they nest, so figure it out from which zones contain which
+static void AssignGpuDepths( std::vector< ZoneEvent >& zones )
+{
+    std::sort( zones.begin(), zones.end(), []( const ZoneEvent& a, const ZoneEvent& b )
+    {
+        return a.startNs < b.startNs || ( a.startNs == b.startNs && a.endNs > b.endNs );
+    });
+    std::vector< uint64_t > openEnds;
+    for ( auto& zone : zones )
+    {
+        while ( !openEnds.empty() && zone.startNs >= openEnds.back() )
+        {
+            openEnds.pop_back();
+        }
+        zone.depth = static_cast< uint32_t >( openEnds.size() );
+        openEnds.push_back( zone.endNs );
+    }
+}
+
+static TreeNode& FindOrAddChild( TreeNode& parent, const char* name )
+{
+    for ( auto& child : parent.children )
+    {
+        if ( child.name == name || !strcmp( child.name, name ) )
+        {
+            return child;
+        }
+    }
+    parent.children.push_back( { name, 0, 0, {} } );
+
+    return parent.children.back();
+}
+
+// Events are sorted by thread and start time, so a zone's parent always comes before it
+static void BuildTrees( const std::vector< ZoneEvent >& events )
+{
+    s_threadTrees.clear();
+    std::vector< TreeNode* > stack;
+    uint32_t currentThread = ~0u - 1;
+    for ( const auto& event : events )
+    {
+        if ( event.threadIndex != currentThread )
+        {
+            currentThread = event.threadIndex;
+            const char* name = "GPU";
+            if ( currentThread != GPU_THREAD_INDEX )
+            {
+                std::lock_guard< std::mutex > lock( s_threadBuffersLock );
+                name = s_threadBuffers[currentThread]->name;
+                if ( !name )
+                {
+                    name = InternName( "Thread " + std::to_string( currentThread ) );
+                }
+            }
+            s_threadTrees.push_back( { name, 0, 0, {} } );
+            stack.clear();
+        }
+
+        TreeNode& root = s_threadTrees.back();
+        if ( event.depth > stack.size() )
+        {
+            // Parent was dropped or started before the profiler did, treat it as a root zone
+            stack.resize( event.depth, &root );
+        }
+        stack.resize( event.depth );
+        TreeNode* parent = event.depth == 0 ? &root : stack.back();
+        TreeNode& node   = FindOrAddChild( *parent, event.name );
+        node.totalNs    += event.endNs - event.startNs;
+        node.calls      += 1;
+        if ( event.depth == 0 )
+        {
+            root.totalNs += event.endNs - event.startNs;
+        }
+        stack.push_back( &node );
+    }
+}
+
+void EndFrame()
+{
+    if ( !s_enabled )
+    {
+        return;
+    }
+
+    uint64_t frameEndNs = NowNs();
+    Frame& frame        = s_frames[s_nextFrame];
+    frame.startNs       = s_frameStartNs;
+    frame.endNs         = frameEndNs;
+    frame.events.clear();
+
+    uint64_t numDropped = 0;
+    {
+        std::lock_guard< std::mutex > lock( s_threadBuffersLock );
+        for ( auto& buffer : s_threadBuffers )
+        {
+            uint64_t readPos  = buffer->readPos.load( std::memory_order_relaxed );
+            uint64_t writePos = buffer->writePos.load( std::memory_order_acquire );
+            size_t firstEvent = frame.events.size();
+            for ( uint64_t pos = readPos; pos < writePos; ++pos )
+            {
+                frame.events.push_back( buffer->events[pos & ( PG_PROFILE_EVENTS_PER_THREAD - 1 )] );
+            }
+            buffer->readPos.store( writePos, std::memory_order_release );
+
+            // Zones finish in child -> parent order, but the tree and the trace want parents first
+            std::sort( frame.events.begin() + firstEvent, frame.events.end(), []( const ZoneEvent& a, const ZoneEvent& b )
+            {
+                return a.startNs < b.startNs || ( a.startNs == b.startNs && a.depth < b.depth );
+            });
+            numDropped += buffer->numDropped.load( std::memory_order_relaxed );
+        }
+    }
+
+    AssignGpuDepths( s_pendingGpuZones );
+    frame.events.insert( frame.events.end(), s_pendingGpuZones.begin(), s_pendingGpuZones.end() );
+    s_pendingGpuZones.clear();
+
+    if ( numDropped != s_numDroppedReported )
+    {
+        LOG_WARN( "Profiler dropped ", numDropped - s_numDroppedReported, " zones, increase PG_PROFILE_EVENTS_PER_THREAD" );
+        s_numDroppedReported = numDropped;
+    }
+
+    if ( !s_treeFrozen )
+    {
+        BuildTrees( frame.events );
+    }
+
+    s_nextFrame    = ( s_nextFrame + 1 ) % PG_PROFILE_HISTORY_FRAMES;
+    s_numFrames    = std::min( s_numFrames + 1, static_cast< uint32_t >( PG_PROFILE_HISTORY_FRAMES ) );
+    s_frameStartNs = frameEndNs;
+}
+
+static std::string EscapeJSON( const char* str )
+{
+    std::string escaped;
+    for ( ; *str; ++str )
+    {
+        if ( *str == '"' || *str == '\\' )
+        {
+            escaped += '\\';
+        }
+        escaped += *str;
+    }
+
+    return escaped;
+}
+
+bool ExportChromeTrace( const std::string& filename )
+{
+    std::ofstream out( filename );
+    if ( !out )
+    {
+        LOG_ERR( "Could not open '", filename, "' to write the profiling trace" );
+        return false;
+    }
+
+    // Chrome trace timestamps are in microseconds. The CPU threads are one process, the GPU is another
+    out << std::fixed << std::setprecision( 3 );
+    out << "{\n\"displayTimeUnit\": \"ms\",\n\"traceEvents\": [\n";
+    out << "{ \"name\": \"process_name\", \"ph\": \"M\", \"pid\": 0, \"args\": { \"name\": \"CPU\" } },\n";
+    out << "{ \"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"args\": { \"name\": \"GPU\" } },\n";
+    {
+        std::lock_guard< std::mutex > lock( s_threadBuffersLock );
+        for ( const auto& buffer : s_threadBuffers )
+        {
+            std::string name = buffer->name ? buffer->name : "Thread " + std::to_string( buffer->index );
+            out << "{ \"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": " << buffer->index << ", \"args\": { \"name\": \"" << EscapeJSON( name.c_str() ) << "\" } },\n";
+            out << "{ \"name\": \"thread_sort_index\", \"ph\": \"M\", \"pid\": 0, \"tid\": " << buffer->index << ", \"args\": { \"sort_index\": " << buffer->index << " } },\n";
+        }
+    }
+
+    uint32_t firstFrame = ( s_nextFrame + PG_PROFILE_HISTORY_FRAMES - s_numFrames ) % PG_PROFILE_HISTORY_FRAMES;
+    for ( uint32_t i = 0; i < s_numFrames; ++i )
+    {
+        const Frame& frame = s_frames[( firstFrame + i ) % PG_PROFILE_HISTORY_FRAMES];
+        out << "{ \"name\": \"Frame\", \"ph\": \"X\", \"pid\": 0, \"tid\": " << s_mainThreadIndex << ", \"ts\": " << frame.startNs / 1000.0 << ", \"dur\": " << ( frame.endNs - frame.startNs ) / 1000.0 << " },\n";
+        for ( const auto& event : frame.events )
+        {
+            bool gpu = event.threadIndex == GPU_THREAD_INDEX;
+            out << "{ \"name\": \"" << EscapeJSON( event.name ) << "\", \"ph\": \"X\", \"pid\": " << ( gpu ? 1 : 0 ) << ", \"tid\": " << ( gpu ? 0 : event.threadIndex ) <<
+                ", \"ts\": " << event.startNs / 1000.0 << ", \"dur\": " << ( event.endNs - event.startNs ) / 1000.0 << " },\n";
+        }
+    }
+    // The trace format doesn't allow a trailing comma, so finish with an event that is always there
+    out << "{ \"name\": \"Trace Exported\", \"ph\": \"i\", \"s\": \"g\", \"pid\": 0, \"tid\": " << s_mainThreadIndex << ", \"ts\": " << NowNs() / 1000.0 << " }\n";
+    out << "]\n}\n";
+
+    LOG( "Wrote profiling trace of the last ", s_numFrames, " frames to '", filename, "'" );
+    return true;
+}
+
+static void DrawNode( const TreeNode& node )
+{
+    ImGuiTreeNodeFlags flags = node.children.empty() ? ImGuiTreeNodeFlags_Leaf : ImGuiTreeNodeFlags_DefaultOpen;
+    if ( ImGui::TreeNodeEx( node.name, flags, "%s: %.3f ms (%u)", node.name, node.totalNs / 1e6, node.calls ) )
+    {
+        for ( const auto& child : node.children )
+        {
+            DrawNode( child );
+        }
+        ImGui::TreePop();
+    }
+}
+
+void DrawZoneTree()
+{
+    ImGui::Checkbox( "Freeze", &s_treeFrozen );
+    for ( const auto& root : s_threadTrees )
+    {
+        ImGui::PushID( &root );
+        if ( ImGui::TreeNodeEx( root.name, ImGuiTreeNodeFlags_DefaultOpen, "%s: %.3f ms", root.name, root.totalNs / 1e6 ) )
+        {
+            for ( const auto& child : root.children )
+            {
+                DrawNode( child );
+            }
+            ImGui::TreePop();
+        }
+        ImGui::PopID();
+    }
+}
+
+} // namespace CpuProfile
+} // namespace Progression
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "core/feature_defines.hpp"
+#include <cstdint>
+#include <string>
+
+// Hierarchical CPU instrumentation. PG_PROFILE_SCOPE( "name" ) times the enclosing scope on whatever
+// thread it runs on. Each thread records finished zones into its own single producer ring buffer
+// without taking any locks, and the main thread collects them once per frame in EndFrame. The last
+// PG_PROFILE_HISTORY_FRAMES frames are kept for Chrome trace export (chrome://tracing or
+// ui.perfetto.dev), along with the GPU zones from Gfx::Profile, converted to the same clock.
+// Zone names must stay valid for the lifetime of the profiler: use string literals, or InternName.
+
+#if USING( PG_PROFILING )
+
+#define _PG_PROFILE_CONCAT_INTERNAL( a, b ) a##b
+#define _PG_PROFILE_CONCAT( a, b ) _PG_PROFILE_CONCAT_INTERNAL( a, b )
+#define PG_PROFILE_SCOPE( name ) Progression::CpuProfile::Scope _PG_PROFILE_CONCAT( _pgProfileScope, __LINE__ )( name )
+
+#else // #if USING( PG_PROFILING )
+
+#define PG_PROFILE_SCOPE( name )
+
+#endif // #else // #if USING( PG_PROFILING )
+
+// Number of finished zones a thread can have waiting for EndFrame before new ones get dropped, must be a power of 2
+#define PG_PROFILE_EVENTS_PER_THREAD 16384
+#define PG_PROFILE_HISTORY_FRAMES 120
+
+namespace Progression
+{
+namespace CpuProfile
+{
+
+    void Init();
+    void Shutdown();
+
+    // Shown in the trace and the zone tree instead of the thread's index
+    void SetThreadName( const char* name );
+
+    // Returns a copy of the string that lives until the profiler shuts down, for names only known at runtime
+    const char* InternName( const std::string& name );
+
+    // Nanoseconds since Init. Every zone, including the GPU ones, is on this clock
+    uint64_t NowNs();
+
+    // Called once per frame on the main thread. Collects the zones from every thread into the frame
+    // history and rebuilds the zone tree
+    void EndFrame();
+
+    // For zones timed somewhere else, like GPU timestamps. Main thread only
+    void AddGpuZone( const char* name, uint64_t startNs, uint64_t endNs );
+
+    // Writes the frame history as a Chrome trace event JSON file
+    bool ExportChromeTrace( const std::string& filename );
+
+    // ImGui tree of the last frame's zones, per thread, with the time and call count of each
+    void DrawZoneTree();
+
+    class Scope
+    {
+    public:
+        Scope( const char* name );
+        ~Scope();
+
+        Scope( const Scope& ) = delete;
+        Scope& operator=( const Scope& ) = delete;
+
+    private:
+        const char* m_name;
+        uint64_t m_startNs;
+    };
+
+} // namespace CpuProfile
+} // namespace Progression
@@ -4,3 +4,37 @@
 #include "core/platform_defines.hpp"
 
 #define LZ4_COMPRESSED_FASTFILES NOT_IN_USE
+
+// CPU zones (core/cpu_profiling.hpp) and GPU timestamps (graphics/graphics_api/profiling.hpp)
+#if !USING( SHIP_BUILD )
+
+#define PG_PROFILING IN_USE
+
+#else // #if !USING( SHIP_BUILD )
+
+#define PG_PROFILING NOT_IN_USE
+
+#endif // #else // #if !USING( SHIP_BUILD )
+
+// Counts calls to the global operator new, to catch heap allocations creeping into the frame (core/memory_manager.hpp)
+#if !USING( SHIP_BUILD )
+
+#define PG_COUNT_HEAP_ALLOCATIONS IN_USE
+
+#else // #if !USING( SHIP_BUILD )
+
+#define PG_COUNT_HEAP_ALLOCATIONS NOT_IN_USE
+
+#endif // #else // #if !USING( SHIP_BUILD )
+
+// Accounts CPU and GPU memory by tag (core/memory_manager.hpp). CPU tracking goes through the
+// counted operator new, so this needs PG_COUNT_HEAP_ALLOCATIONS
+#if !USING( SHIP_BUILD )
+
+#define PG_MEMORY_TRACKING IN_USE
+
+#else // #if !USING( SHIP_BUILD )
+
+#define PG_MEMORY_TRACKING NOT_IN_USE
+
+#endif // #else // #if !USING( SHIP_BUILD )
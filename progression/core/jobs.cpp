@@ -0,0 +1,338 @@
+#include "core/jobs.hpp"
+#include "core/assert.hpp"
+#include "core/cpu_profiling.hpp"
+#include "core/memory_manager.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Progression
+{
+namespace Jobs
+{
+
+struct Job
+{
+    JobFunction function;
+    Counter* counter = nullptr;
+};
+
+// Ring buffer of jobs. Only grows when it is full, so once the busiest frame has been seen, queueing
+// a job never allocates (unlike std::deque, which allocates and frees blocks as it moves along)
+class JobRing
+{
+public:
+    JobRing() : m_jobs( 256 ) {}
+
+    bool Empty() const { return m_size == 0; }
+
+    void PushBack( Job&& job )
+    {
+        if ( m_size == m_jobs.size() )
+        {
+            std::vector< Job > jobs( 2 * m_jobs.size() );
+            for ( size_t i = 0; i < m_size; ++i )
+            {
+                jobs[i] = std::move( m_jobs[( m_front + i ) & ( m_jobs.size() - 1 )] );
+            }
+            m_jobs.swap( jobs );
+            m_front = 0;
+        }
+        m_jobs[( m_front + m_size ) & ( m_jobs.size() - 1 )] = std::move( job );
+        ++m_size;
+    }
+
+    Job PopBack()
+    {
+        PG_ASSERT( m_size > 0 );
+        --m_size;
+        return std::move( m_jobs[( m_front + m_size ) & ( m_jobs.size() - 1 )] );
+    }
+
+    Job PopFront()
+    {
+        PG_ASSERT( m_size > 0 );
+        Job job = std::move( m_jobs[m_front] );
+        m_front = ( m_front + 1 ) & ( m_jobs.size() - 1 );
+        --m_size;
+        return job;
+    }
+
+private:
+    std::vector< Job > m_jobs; // size is always a power of 2
+    size_t m_front = 0;
+    size_t m_size  = 0;
+};
+
+// The owning thread pushes and pops from the back (most recent job first, which is usually still
+// in cache), while thieves take from the front
+struct JobQueue
+{
+    std::mutex lock;
+    JobRing jobs;
+};
+
+static std::vector< std::unique_ptr< JobQueue > > s_queues;
+static JobQueue s_mainThreadQueue;
+static std::vector< std::thread > s_workers;
+static std::atomic< uint32_t > s_numPendingJobs = { 0 };
+static std::atomic< bool > s_shutdown = { false };
+static std::atomic< uint32_t > s_numStartedWorkers = { 0 };
+static std::mutex s_sleepLock;
+static std::condition_variable s_wakeCondition;
+static thread_local uint32_t s_threadIndex = 0;
+
+static bool PopJob( uint32_t threadIndex, Job& job )
+{
+    {
+        JobQueue& queue = *s_queues[threadIndex];
+        std::lock_guard< std::mutex > lock( queue.lock );
+        if ( !queue.jobs.Empty() )
+        {
+            job = queue.jobs.PopBack();
+            return true;
+        }
+    }
+
+    uint32_t numQueues = static_cast< uint32_t >( s_queues.size() );
+    for ( uint32_t i = 1; i < numQueues; ++i )
+    {
+        JobQueue& victim = *s_queues[( threadIndex + i ) % numQueues];
+        std::lock_guard< std::mutex > lock( victim.lock );
+        if ( !victim.jobs.Empty() )
+        {
+            job = victim.jobs.PopFront();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void Execute( Job& job )
+{
+    {
+        PG_PROFILE_SCOPE( "Job" );
+        job.function();
+    }
+    if ( job.counter )
+    {
+        job.counter->value.fetch_sub( 1, std::memory_order_acq_rel );
+    }
+}
+
+static void WorkerMain( uint32_t threadIndex )
+{
+    s_threadIndex = threadIndex;
+    CpuProfile::SetThreadName( CpuProfile::InternName( "Worker " + std::to_string( threadIndex ) ) );
+    // Created up front, so that the first job on this thread to use it doesn't allocate in the middle of a frame
+    MemoryManager::ScratchArena();
+    s_numStartedWorkers.fetch_add( 1, std::memory_order_release );
+    while ( !s_shutdown )
+    {
+        Job job;
+        if ( PopJob( threadIndex, job ) )
+        {
+            s_numPendingJobs.fetch_sub( 1, std::memory_order_relaxed );
+            Execute( job );
+        }
+        else
+        {
+            std::unique_lock< std::mutex > lock( s_sleepLock );
+            s_wakeCondition.wait( lock, []() { return s_shutdown || s_numPendingJobs > 0; } );
+        }
+    }
+}
+
+void Init( uint32_t numThreads )
+{
+    PG_ASSERT( s_queues.empty(), "Job system already initialized" );
+    if ( numThreads == 0 )
+    {
+        numThreads = std::max( 1u, std::thread::hardware_concurrency() );
+    }
+    uint32_t numWorkers = numThreads - 1;
+
+    s_shutdown          = false;
+    s_numPendingJobs    = 0;
+    s_numStartedWorkers = 0;
+    s_threadIndex       = 0;
+    for ( uint32_t i = 0; i < numWorkers + 1; ++i )
+    {
+        s_queues.emplace_back( std::make_unique< JobQueue >() );
+    }
+    for ( uint32_t i = 1; i < numWorkers + 1; ++i )
+    {
+        s_workers.emplace_back( WorkerMain, i );
+    }
+    // So that the workers' own setup is done before the first frame, instead of allocating during it
+    while ( s_numStartedWorkers.load( std::memory_order_acquire ) < numWorkers )
+    {
+        std::this_thread::yield();
+    }
+}
+
+void Shutdown()
+{
+    {
+        std::lock_guard< std::mutex > lock( s_sleepLock );
+        s_shutdown = true;
+    }
+    s_wakeCondition.notify_all();
+    for ( auto& worker : s_workers )
+    {
+        worker.join();
+    }
+    s_workers.clear();
+
+    // Finish anything that was still queued, so no one is left waiting on a counter
+    while ( TryRunJob() );
+    s_queues.clear();
+    ProcessMainThreadJobs();
+}
+
+uint32_t NumThreads()
+{
+    return std::max( 1u, static_cast< uint32_t >( s_queues.size() ) );
+}
+
+uint32_t GetThreadIndex()
+{
+    return s_threadIndex;
+}
+
+void Submit( JobFunction job, Counter* counter )
+{
+    if ( counter )
+    {
+        counter->value.fetch_add( 1, std::memory_order_relaxed );
+    }
+
+    if ( s_queues.empty() )
+    {
+        Job j{ std::move( job ), counter };
+        Execute( j );
+        return;
+    }
+
+    {
+        JobQueue& queue = *s_queues[s_threadIndex];
+        std::lock_guard< std::mutex > lock( queue.lock );
+        queue.jobs.PushBack( { std::move( job ), counter } );
+    }
+    {
+        // Taking the lock makes sure a worker can't check for pending jobs and then go to sleep
+        // after this increment, missing the notify
+        std::lock_guard< std::mutex > lock( s_sleepLock );
+        s_numPendingJobs.fetch_add( 1, std::memory_order_relaxed );
+    }
+    s_wakeCondition.notify_one();
+}
+
+void SubmitMainThread( JobFunction job, Counter* counter )
+{
+    if ( counter )
+    {
+        counter->value.fetch_add( 1, std::memory_order_relaxed );
+    }
+
+    if ( s_queues.empty() && s_threadIndex == 0 )
+    {
+        Job j{ std::move( job ), counter };
+        Execute( j );
+        return;
+    }
+
+    std::lock_guard< std::mutex > lock( s_mainThreadQueue.lock );
+    s_mainThreadQueue.jobs.PushBack( { std::move( job ), counter } );
+}
+
+static bool PopMainThreadJob( Job& job )
+{
+    std::lock_guard< std::mutex > lock( s_mainThreadQueue.lock );
+    if ( s_mainThreadQueue.jobs.Empty() )
+    {
+        return false;
+    }
+    job = s_mainThreadQueue.jobs.PopFront();
+
+    return true;
+}
+
+void ProcessMainThreadJobs()
+{
+    PG_ASSERT( s_threadIndex == 0, "Main thread jobs can only be run on the main thread" );
+    Job job;
+    while ( PopMainThreadJob( job ) )
+    {
+        Execute( job );
+    }
+}
+
+bool TryRunJob()
+{
+    Job job;
+    if ( s_threadIndex == 0 && PopMainThreadJob( job ) )
+    {
+        Execute( job );
+        return true;
+    }
+
+    if ( s_queues.empty() )
+    {
+        return false;
+    }
+
+    if ( !PopJob( s_threadIndex, job ) )
+    {
+        return false;
+    }
+    s_numPendingJobs.fetch_sub( 1, std::memory_order_relaxed );
+    Execute( job );
+
+    return true;
+}
+
+void Wait( Counter* counter )
+{
+    while ( !counter->IsDone() )
+    {
+        if ( !TryRunJob() )
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void ParallelFor( uint32_t count, uint32_t minBatchSize, ParallelForFunction invoke, const void* fn )
+{
+    if ( count == 0 )
+    {
+        return;
+    }
+
+    // A few batches per thread so that uneven batches still balance out through stealing
+    uint32_t targetNumBatches = 4 * NumThreads();
+    uint32_t batchSize        = std::max( std::max( 1u, minBatchSize ), ( count + targetNumBatches - 1 ) / targetNumBatches );
+    if ( batchSize >= count )
+    {
+        invoke( fn, 0, count );
+        return;
+    }
+
+    Counter counter;
+    for ( uint32_t begin = batchSize; begin < count; begin += batchSize )
+    {
+        uint32_t end = std::min( count, begin + batchSize );
+        Submit( [invoke, fn, begin, end]() { invoke( fn, begin, end ); }, &counter );
+    }
+    invoke( fn, 0, batchSize );
+    Wait( &counter );
+}
+
+} // namespace Jobs
+} // namespace Progression
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Bytes a job's captures can take up. Jobs are submitted every frame, so they are stored inline
+// instead of on the heap. Capture a pointer to anything bigger
+#define PG_JOB_FUNCTION_STORAGE 64
+
+namespace Progression
+{
+namespace Jobs
+{
+
+    // Move only void() callable, stored inline. A capture that doesn't fit is a compile error,
+    // instead of a heap allocation per job like std::function would do
+    class JobFunction
+    {
+    public:
+        JobFunction() = default;
+
+        template < typename F, typename = std::enable_if_t< !std::is_same< std::decay_t< F >, JobFunction >::value > >
+        JobFunction( F&& f )
+        {
+            using Fn = std::decay_t< F >;
+            static_assert( sizeof( Fn ) <= PG_JOB_FUNCTION_STORAGE, "Job captures too big, capture a pointer to them instead" );
+            static_assert( alignof( Fn ) <= alignof( std::max_align_t ), "Job captures are over aligned" );
+            static_assert( std::is_nothrow_move_constructible< Fn >::value, "Jobs get moved between queues, so they can't throw when moved" );
+            new ( m_storage ) Fn( std::forward< F >( f ) );
+            m_invoke = []( void* fn ) { ( *static_cast< Fn* >( fn ) )(); };
+            m_move   = []( void* dst, void* src ) noexcept
+            {
+                if ( dst )
+                {
+                    new ( dst ) Fn( std::move( *static_cast< Fn* >( src ) ) );
+                }
+                static_cast< Fn* >( src )->~Fn();
+            };
+        }
+
+        JobFunction( JobFunction&& other ) noexcept { MoveFrom( other ); }
+
+        JobFunction& operator=( JobFunction&& other ) noexcept
+        {
+            if ( this != &other )
+            {
+                Reset();
+                MoveFrom( other );
+            }
+            return *this;
+        }
+
+        JobFunction( const JobFunction& ) = delete;
+        JobFunction& operator=( const JobFunction& ) = delete;
+
+        ~JobFunction() { Reset(); }
+
+        void operator()() { m_invoke( m_storage ); }
+        explicit operator bool() const { return m_invoke != nullptr; }
+
+    private:
+        void MoveFrom( JobFunction& other ) noexcept
+        {
+            if ( other.m_invoke )
+            {
+                other.m_move( m_storage, other.m_storage );
+                m_invoke       = other.m_invoke;
+                m_move         = other.m_move;
+                other.m_invoke = nullptr;
+                other.m_move   = nullptr;
+            }
+        }
+
+        void Reset() noexcept
+        {
+            if ( m_invoke )
+            {
+                m_move( nullptr, m_storage );
+                m_invoke = nullptr;
+                m_move   = nullptr;
+            }
+        }
+
+        alignas( std::max_align_t ) unsigned char m_storage[PG_JOB_FUNCTION_STORAGE];
+        void ( *m_invoke )( void* fn ) = nullptr;
+        // Moves the callable from src into dst and destroys what is left in src. Only destroys with a null dst
+        void ( *m_move )( void* dst, void* src ) noexcept = nullptr;
+    };
+
+    // Incremented when a job is submitted with it, and decremented when that job finishes.
+    // Wait on it to know when a group of jobs are all done
+    struct Counter
+    {
+        std::atomic< uint32_t > value = { 0 };
+
+        bool IsDone() const { return value.load( std::memory_order_acquire ) == 0; }
+    };
+
+    // numThreads includes the calling (main) thread, so numThreads - 1 background workers are started,
+    // each with their own job deque. 0 = one thread per hardware thread
+    void Init( uint32_t numThreads = 0 );
+    void Shutdown();
+
+    // Number of threads that run jobs, including the main thread (index 0)
+    uint32_t NumThreads();
+    uint32_t GetThreadIndex();
+
+    // Pushes the job onto the calling thread's deque. Other threads that run out of work steal
+    // from the opposite end. Runs the job immediately if the job system isn't initialized
+    void Submit( JobFunction job, Counter* counter = nullptr );
+
+    // For work that has to happen on the main thread, like creating GPU resources or touching the
+    // lua state. Workers never pick these up; the main thread runs them in TryRunJob, Wait, and
+    // ProcessMainThreadJobs
+    void SubmitMainThread( JobFunction job, Counter* counter = nullptr );
+
+    // Runs every main thread job that is currently queued. Call once per frame from the main thread
+    void ProcessMainThreadJobs();
+
+    // Runs one pending job on the calling thread, if there are any. Returns false if nothing ran
+    bool TryRunJob();
+
+    // Runs other jobs while waiting, so it is safe to call from inside of a job
+    void Wait( Counter* counter );
+
+    // Splits [0, count) into batches of at least minBatchSize elements and calls fn( begin, end )
+    // for each batch across all of the threads. Returns once every batch is done
+    template < typename Fn >
+    void ParallelFor( uint32_t count, uint32_t minBatchSize, const Fn& fn );
+
+    // The type erased version the template calls. fn is only referenced, since it lives until ParallelFor returns
+    using ParallelForFunction = void ( * )( const void* fn, uint32_t begin, uint32_t end );
+    void ParallelFor( uint32_t count, uint32_t minBatchSize, ParallelForFunction invoke, const void* fn );
+
+    template < typename Fn >
+    void ParallelFor( uint32_t count, uint32_t minBatchSize, const Fn& fn )
+    {
+        ParallelFor( count, minBatchSize, []( const void* f, uint32_t begin, uint32_t end ) { ( *static_cast< const Fn* >( f ) )( begin, end ); }, &fn );
+    }
+
+} // namespace Jobs
+} // namespace Progression
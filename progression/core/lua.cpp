@@ -3,6 +3,7 @@
 #include "core/ecs.hpp"
 #include "core/input.hpp"
 #include "core/math.hpp"
+#include "core/memory_manager.hpp"
 #include "core/scene.hpp"
 #include "core/window.hpp"
 #include "components/entity_metadata.hpp"
@@ -30,6 +31,9 @@ namespace Progression
         luaUINamespace["Visible"]        = &Gfx::UIOverlay::Visible;
         luaUINamespace["SetVisible"]     = &Gfx::UIOverlay::SetVisible;
 
+        auto luaMemoryNamespace = lua["Memory"].get_or_create< sol::table >();
+        luaMemoryNamespace["DumpStats"] = &MemoryManager::DumpMemoryStats;
+
         sol::usertype< ScriptComponent > scriptComponent_type = lua.new_usertype< ScriptComponent >( "ScriptComponent" );
         scriptComponent_type["GetFunction"] = &ScriptComponent::GetFunction;
         REGISTER_COMPONENT_WITH_ECS( lua, ScriptComponent,
@@ -41,9 +45,11 @@ namespace Progression
             static_cast< NameComponent&( entt::registry::* )( const entt::entity )> ( &entt::registry::assign< NameComponent > ) );
 
         sol::usertype< Transform > transform_type = lua.new_usertype< Transform >( "Transform" );
-        transform_type["position"] = &Transform::position;
-        transform_type["rotation"] = &Transform::rotation;
-        transform_type["scale"] = &Transform::scale;
+        // position and scale are returned by value, so they have to be assigned as a whole: transform.position = newPos
+        transform_type["position"]       = sol::property( &Transform::GetPosition, &Transform::SetPosition );
+        transform_type["scale"]          = sol::property( &Transform::GetScale, &Transform::SetScale );
+        transform_type["SetEulerAngles"] = &Transform::SetEulerAngles;
+        transform_type["Rotate"]         = &Transform::Rotate;
         transform_type["GetModelMatrix"] = &Transform::GetModelMatrix;
         REGISTER_COMPONENT_WITH_ECS( lua, Transform,
             static_cast< Transform&( entt::registry::* )( const entt::entity )> ( &entt::registry::assign< Transform > ) );
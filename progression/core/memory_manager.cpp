@@ -1,62 +1,433 @@
 #include "core/memory_manager.hpp"
+#include "core/assert.hpp"
+#include "imgui/imgui.h"
+#include "utils/logger.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+
+#if USING( PG_MEMORY_TRACKING ) && !USING( PG_COUNT_HEAP_ALLOCATIONS )
+#error "PG_MEMORY_TRACKING needs PG_COUNT_HEAP_ALLOCATIONS"
+#endif // #if USING( PG_MEMORY_TRACKING ) && !USING( PG_COUNT_HEAP_ALLOCATIONS )
 
 namespace Progression
 {
 namespace MemoryManager
 {
-    void* Allocate( size_t bytes )
+
+#if USING( PG_MEMORY_TRACKING )
+
+    struct TagStats
+    {
+        std::atomic< int64_t > currentBytes;
+        std::atomic< int64_t > peakBytes;
+        std::atomic< int64_t > numAllocations;
+    };
+
+    // The extra slot at the end of each heap is the total over every tag
+    static TagStats s_stats[static_cast< int >( MemoryHeap::NUM_HEAPS )][static_cast< int >( MemoryTag::NUM_TAGS ) + 1];
+    static thread_local MemoryTag s_currentTag = MemoryTag::General;
+
+    // In front of every tracked CPU allocation, so that frees know what to credit back. Keeps the
+    // memory after it aligned as well as malloc's
+    struct alignas( alignof( std::max_align_t ) ) AllocationHeader
+    {
+        size_t size;
+        MemoryTag tag;
+    };
+
+    static void AddToStats( TagStats& stats, int64_t bytes, int64_t allocations )
+    {
+        int64_t current = stats.currentBytes.fetch_add( bytes, std::memory_order_relaxed ) + bytes;
+        stats.numAllocations.fetch_add( allocations, std::memory_order_relaxed );
+        int64_t peak = stats.peakBytes.load( std::memory_order_relaxed );
+        while ( current > peak && !stats.peakBytes.compare_exchange_weak( peak, current, std::memory_order_relaxed ) )
+        {
+        }
+    }
+
+    static void* AllocateTracked( size_t bytes, MemoryTag tag )
+    {
+        AllocationHeader* header = static_cast< AllocationHeader* >( malloc( sizeof( AllocationHeader ) + bytes ) );
+        if ( !header )
+        {
+            return nullptr;
+        }
+        header->size = bytes;
+        header->tag  = tag;
+        TrackAllocation( MemoryHeap::CPU, tag, bytes );
+
+        return header + 1;
+    }
+
+    static void FreeTracked( void* ptr ) noexcept
+    {
+        if ( !ptr )
+        {
+            return;
+        }
+        AllocationHeader* header = static_cast< AllocationHeader* >( ptr ) - 1;
+        TrackFree( MemoryHeap::CPU, header->tag, header->size );
+        free( header );
+    }
+
+#else // #if USING( PG_MEMORY_TRACKING )
+
+    static void* AllocateTracked( size_t bytes, MemoryTag )
     {
         return malloc( bytes );
     }
-    
-    void Free( void* ptr ) noexcept
+
+    static void FreeTracked( void* ptr ) noexcept
     {
         free( ptr );
     }
-    
+
+#endif // #else // #if USING( PG_MEMORY_TRACKING )
+
 } // namespace MemoryManager
 } // namespace Progression
 
-/*
-#include <iostream>
-#include <vector>
+#if USING( PG_COUNT_HEAP_ALLOCATIONS )
 
-using namespace Progression;
+static std::atomic< uint64_t > s_numHeapAllocations = { 0 };
 
-struct Point
+// Only the basic forms are replaced. The default versions of the array and nothrow forms call
+// these, and the aligned forms are rare enough to not matter for the count
+void* operator new( size_t size )
 {
-    Point() = default;
-    Point( float _x, float _y, float _z ) : x(_x), y(_y), z(_z) {}
-    ~Point()
+    using namespace Progression::MemoryManager;
+    s_numHeapAllocations.fetch_add( 1, std::memory_order_relaxed );
+    void* ptr = AllocateTracked( size ? size : 1, GetCurrentMemoryTag() );
+    if ( !ptr )
     {
-        std::cout << "Point dtor" << std::endl;
+        throw std::bad_alloc();
     }
 
-    float x = 0;
-    float y = 0;
-    float z = 0;
-};
+    return ptr;
+}
+
+void operator delete( void* ptr ) noexcept
+{
+    Progression::MemoryManager::FreeTracked( ptr );
+}
 
-void Example()
+void operator delete( void* ptr, size_t ) noexcept
 {
-    Point* p = MemoryManager::New< Point >( 1, 2, 3 );
-    std::cout << p->x << " " << p->y << " " << p->z << std::endl;
-    MemoryManager::Delete( p );
+    Progression::MemoryManager::FreeTracked( ptr );
+}
+
+#endif // #if USING( PG_COUNT_HEAP_ALLOCATIONS )
+
+namespace Progression
+{
+namespace MemoryManager
+{
+
+    static LinearAllocator s_frameAllocator;
+    static thread_local LinearAllocator s_scratchArena;
+    static uint64_t s_heapAllocationsAtFrameEnd = 0;
+    static uint64_t s_heapAllocationsLastFrame  = 0;
+    static bool s_frameOverflowReported         = false;
+
+    static size_t AlignUp( size_t x, size_t alignment )
+    {
+        return ( x + alignment - 1 ) & ~( alignment - 1 );
+    }
+
+    void Init()
     {
-        std::vector< Point, MemoryManager::Allocator< Point > > vec;
-        for ( int i = 0; i < 10; ++i )
+        FrameAllocator();
+        s_heapAllocationsAtFrameEnd = NumHeapAllocations();
+        s_heapAllocationsLastFrame  = 0;
+        s_frameOverflowReported     = false;
+    }
+
+    void Shutdown()
+    {
+        s_frameAllocator.Shutdown();
+    }
+
+    void EndFrame()
+    {
+        if ( s_frameAllocator.NumOverflowAllocations() && !s_frameOverflowReported )
         {
-            std::cout << "Vector capacity: " << vec.capacity() << std::endl;
-            vec.push_back( {} );
-            std::cout << "Total elements currently: " << i << std::endl;
+            LOG_WARN( "Frame allocator ran out this frame (", s_frameAllocator.NumOverflowAllocations(), " heap allocations). Consider raising PG_FRAME_ALLOCATOR_SIZE" );
+            s_frameOverflowReported = true;
         }
-        std::cout << "clearing" << std::endl;
-        vec.clear();
-        std::cout << "shrinking" << std::endl;
-        vec.shrink_to_fit();
+        s_frameAllocator.Reset();
 
-        std::cout << "ending" << std::endl;
+        uint64_t numHeapAllocations = NumHeapAllocations();
+        s_heapAllocationsLastFrame  = numHeapAllocations - s_heapAllocationsAtFrameEnd;
+        s_heapAllocationsAtFrameEnd = numHeapAllocations;
     }
-    std::cout << "done" << std::endl;
-}
-*/
\ No newline at end of file
+
+    void* Allocate( size_t bytes )
+    {
+        return AllocateTracked( bytes, GetCurrentMemoryTag() );
+    }
+
+    void* Allocate( size_t bytes, MemoryTag tag )
+    {
+        return AllocateTracked( bytes, tag );
+    }
+
+    void Free( void* ptr ) noexcept
+    {
+        FreeTracked( ptr );
+    }
+
+    LinearAllocator::~LinearAllocator()
+    {
+        Shutdown();
+    }
+
+    void LinearAllocator::Init( size_t capacity )
+    {
+        Shutdown();
+        m_memory   = static_cast< char* >( MemoryManager::Allocate( capacity, MemoryTag::Allocators ) );
+        m_capacity = capacity;
+    }
+
+    void LinearAllocator::Shutdown()
+    {
+        Reset();
+        MemoryManager::Free( m_memory );
+        m_memory        = nullptr;
+        m_capacity      = 0;
+        m_highWaterMark = 0;
+    }
+
+    void* LinearAllocator::Allocate( size_t bytes, size_t alignment )
+    {
+        PG_ASSERT( alignment && ( alignment & ( alignment - 1 ) ) == 0, "Alignment must be a power of 2" );
+        size_t start = AlignUp( reinterpret_cast< size_t >( m_memory ) + m_offset, alignment ) - reinterpret_cast< size_t >( m_memory );
+        if ( m_memory && start + bytes <= m_capacity )
+        {
+            m_offset        = start + bytes;
+            m_highWaterMark = std::max( m_highWaterMark, m_offset );
+            return m_memory + start;
+        }
+
+        // Out of space. The block header is padded out to the alignment, so the returned memory stays aligned
+        size_t headerSize     = AlignUp( sizeof( OverflowBlock ), std::max( alignment, alignof( std::max_align_t ) ) );
+        OverflowBlock* block  = static_cast< OverflowBlock* >( MemoryManager::Allocate( headerSize + bytes + alignment ) );
+        block->next           = m_overflowHead;
+        m_overflowHead        = block;
+        ++m_numOverflowAllocations;
+        char* data = reinterpret_cast< char* >( block ) + headerSize;
+        return reinterpret_cast< void* >( AlignUp( reinterpret_cast< size_t >( data ), alignment ) );
+    }
+
+    LinearAllocator::Marker LinearAllocator::GetMarker() const
+    {
+        return { m_offset, m_overflowHead };
+    }
+
+    void LinearAllocator::FreeToMarker( const Marker& marker )
+    {
+        PG_ASSERT( marker.offset <= m_offset, "Markers have to be freed in the reverse order they were taken" );
+        while ( m_overflowHead != marker.overflowHead )
+        {
+            OverflowBlock* next = m_overflowHead->next;
+            MemoryManager::Free( m_overflowHead );
+            m_overflowHead = next;
+        }
+        m_offset = marker.offset;
+    }
+
+    void LinearAllocator::Reset()
+    {
+        FreeToMarker( { 0, nullptr } );
+        m_numOverflowAllocations = 0;
+    }
+
+    LinearAllocator& FrameAllocator()
+    {
+        if ( !s_frameAllocator.Capacity() )
+        {
+            s_frameAllocator.Init( PG_FRAME_ALLOCATOR_SIZE );
+        }
+
+        return s_frameAllocator;
+    }
+
+    LinearAllocator& ScratchArena()
+    {
+        if ( !s_scratchArena.Capacity() )
+        {
+            s_scratchArena.Init( PG_SCRATCH_ARENA_SIZE );
+        }
+
+        return s_scratchArena;
+    }
+
+    uint64_t NumHeapAllocations()
+    {
+#if USING( PG_COUNT_HEAP_ALLOCATIONS )
+        return s_numHeapAllocations.load( std::memory_order_relaxed );
+#else // #if USING( PG_COUNT_HEAP_ALLOCATIONS )
+        return 0;
+#endif // #else // #if USING( PG_COUNT_HEAP_ALLOCATIONS )
+    }
+
+    uint64_t NumHeapAllocationsLastFrame()
+    {
+        return s_heapAllocationsLastFrame;
+    }
+
+    static const char* s_tagNames[] =
+    {
+#define _PG_MEMORY_TAG_NAME( name ) #name,
+        PG_MEMORY_TAGS( _PG_MEMORY_TAG_NAME )
+#undef _PG_MEMORY_TAG_NAME
+    };
+
+    const char* GetMemoryTagName( MemoryTag tag )
+    {
+        PG_ASSERT( tag < MemoryTag::NUM_TAGS );
+        return s_tagNames[static_cast< int >( tag )];
+    }
+
+#if USING( PG_MEMORY_TRACKING )
+
+    MemoryTag GetCurrentMemoryTag()
+    {
+        return s_currentTag;
+    }
+
+    void TrackAllocation( MemoryHeap heap, MemoryTag tag, size_t bytes )
+    {
+        AddToStats( s_stats[static_cast< int >( heap )][static_cast< int >( tag )], static_cast< int64_t >( bytes ), 1 );
+        AddToStats( s_stats[static_cast< int >( heap )][static_cast< int >( MemoryTag::NUM_TAGS )], static_cast< int64_t >( bytes ), 1 );
+    }
+
+    void TrackFree( MemoryHeap heap, MemoryTag tag, size_t bytes )
+    {
+        AddToStats( s_stats[static_cast< int >( heap )][static_cast< int >( tag )], -static_cast< int64_t >( bytes ), -1 );
+        AddToStats( s_stats[static_cast< int >( heap )][static_cast< int >( MemoryTag::NUM_TAGS )], -static_cast< int64_t >( bytes ), -1 );
+    }
+
+    static MemoryStats LoadStats( const TagStats& stats )
+    {
+        MemoryStats ret;
+        ret.currentBytes   = stats.currentBytes.load( std::memory_order_relaxed );
+        ret.peakBytes      = stats.peakBytes.load( std::memory_order_relaxed );
+        ret.numAllocations = stats.numAllocations.load( std::memory_order_relaxed );
+        return ret;
+    }
+
+    MemoryStats GetMemoryStats( MemoryHeap heap, MemoryTag tag )
+    {
+        PG_ASSERT( heap < MemoryHeap::NUM_HEAPS && tag < MemoryTag::NUM_TAGS );
+        return LoadStats( s_stats[static_cast< int >( heap )][static_cast< int >( tag )] );
+    }
+
+    MemoryStats GetTotalMemoryStats( MemoryHeap heap )
+    {
+        PG_ASSERT( heap < MemoryHeap::NUM_HEAPS );
+        return LoadStats( s_stats[static_cast< int >( heap )][static_cast< int >( MemoryTag::NUM_TAGS )] );
+    }
+
+    ScopedMemoryTag::ScopedMemoryTag( MemoryTag tag ) : m_previousTag( s_currentTag )
+    {
+        s_currentTag = tag;
+    }
+
+    ScopedMemoryTag::~ScopedMemoryTag()
+    {
+        s_currentTag = m_previousTag;
+    }
+
+#else // #if USING( PG_MEMORY_TRACKING )
+
+    MemoryTag GetCurrentMemoryTag()
+    {
+        return MemoryTag::General;
+    }
+
+    void TrackAllocation( MemoryHeap, MemoryTag, size_t )
+    {
+    }
+
+    void TrackFree( MemoryHeap, MemoryTag, size_t )
+    {
+    }
+
+    MemoryStats GetMemoryStats( MemoryHeap, MemoryTag )
+    {
+        return {};
+    }
+
+    MemoryStats GetTotalMemoryStats( MemoryHeap )
+    {
+        return {};
+    }
+
+    ScopedMemoryTag::ScopedMemoryTag( MemoryTag ) : m_previousTag( MemoryTag::General )
+    {
+    }
+
+    ScopedMemoryTag::~ScopedMemoryTag()
+    {
+    }
+
+#endif // #else // #if USING( PG_MEMORY_TRACKING )
+
+    static void WriteStatsJSON( std::ofstream& out, const MemoryStats& stats )
+    {
+        out << "{ \"current_bytes\": " << stats.currentBytes << ", \"peak_bytes\": " << stats.peakBytes
+            << ", \"allocations\": " << stats.numAllocations << " }";
+    }
+
+    bool DumpMemoryStats( const std::string& filename )
+    {
+        std::ofstream out( filename );
+        if ( !out )
+        {
+            LOG_ERR( "Could not open the memory stats file '", filename, "'" );
+            return false;
+        }
+
+        const char* heapNames[] = { "cpu", "gpu" };
+        out << "{\n";
+        for ( int heap = 0; heap < static_cast< int >( MemoryHeap::NUM_HEAPS ); ++heap )
+        {
+            out << "    \"" << heapNames[heap] << "\": {\n";
+            out << "        \"total\": ";
+            WriteStatsJSON( out, GetTotalMemoryStats( static_cast< MemoryHeap >( heap ) ) );
+            out << ",\n        \"tags\": {\n";
+            for ( int tag = 0; tag < static_cast< int >( MemoryTag::NUM_TAGS ); ++tag )
+            {
+                out << "            \"" << s_tagNames[tag] << "\": ";
+                WriteStatsJSON( out, GetMemoryStats( static_cast< MemoryHeap >( heap ), static_cast< MemoryTag >( tag ) ) );
+                out << ( tag + 1 < static_cast< int >( MemoryTag::NUM_TAGS ) ? ",\n" : "\n" );
+            }
+            out << "        }\n";
+            out << "    }" << ( heap + 1 < static_cast< int >( MemoryHeap::NUM_HEAPS ) ? ",\n" : "\n" );
+        }
+        out << "}\n";
+
+        LOG( "Wrote memory stats to '", filename, "'" );
+        return true;
+    }
+
+    void DrawMemoryStats()
+    {
+        const float MB = 1.0f / ( 1024 * 1024 );
+        ImGui::Text( "%-10s %9s %9s %9s %9s", "MB", "CPU", "CPU peak", "GPU", "GPU peak" );
+        for ( int tag = 0; tag < static_cast< int >( MemoryTag::NUM_TAGS ); ++tag )
+        {
+            MemoryStats cpu = GetMemoryStats( MemoryHeap::CPU, static_cast< MemoryTag >( tag ) );
+            MemoryStats gpu = GetMemoryStats( MemoryHeap::GPU, static_cast< MemoryTag >( tag ) );
+            ImGui::Text( "%-10s %9.2f %9.2f %9.2f %9.2f", s_tagNames[tag], cpu.currentBytes * MB, cpu.peakBytes * MB, gpu.currentBytes * MB, gpu.peakBytes * MB );
+        }
+        MemoryStats cpu = GetTotalMemoryStats( MemoryHeap::CPU );
+        MemoryStats gpu = GetTotalMemoryStats( MemoryHeap::GPU );
+        ImGui::Separator();
+        ImGui::Text( "%-10s %9.2f %9.2f %9.2f %9.2f", "Total", cpu.currentBytes * MB, cpu.peakBytes * MB, gpu.currentBytes * MB, gpu.peakBytes * MB );
+    }
+
+} // namespace MemoryManager
+} // namespace Progression
@@ -1,11 +1,87 @@
 #pragma once
 
+#include "core/feature_defines.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Size of the linear allocator that is reset at the end of every frame
+#define PG_FRAME_ALLOCATOR_SIZE ( 4 * 1024 * 1024 )
+// Size of each thread's scratch arena. Only allocated the first time a thread uses it
+#define PG_SCRATCH_ARENA_SIZE ( 8 * 1024 * 1024 )
+
+// Every category memory is accounted under, on both the CPU and the GPU. Allocations are tagged with
+// whatever tag is active on the allocating thread (see PG_MEMORY_TAG), and credited back to the same
+// tag when freed, wherever that happens
+#define PG_MEMORY_TAGS( X ) \
+    X( General )            \
+    X( Allocators )         \
+    X( Scene )              \
+    X( Shaders )            \
+    X( Images )             \
+    X( Materials )          \
+    X( Models )             \
+    X( Animation )          \
+    X( Scripts )            \
+    X( Rendering )          \
+    X( UI )                 \
+    X( Staging )
+
+#if USING( PG_MEMORY_TRACKING )
+
+#define _PG_MEMORY_CONCAT_INTERNAL( a, b ) a##b
+#define _PG_MEMORY_CONCAT( a, b ) _PG_MEMORY_CONCAT_INTERNAL( a, b )
+#define PG_MEMORY_TAG( tag ) Progression::MemoryManager::ScopedMemoryTag _PG_MEMORY_CONCAT( _pgMemoryTag, __LINE__ )( Progression::MemoryManager::MemoryTag::tag )
+
+#else // #if USING( PG_MEMORY_TRACKING )
+
+#define PG_MEMORY_TAG( tag )
+
+#endif // #else // #if USING( PG_MEMORY_TRACKING )
+
 namespace Progression
 {
 namespace MemoryManager
 {
 
+    enum class MemoryTag : uint8_t
+    {
+#define _PG_MEMORY_TAG_ENUM( name ) name,
+        PG_MEMORY_TAGS( _PG_MEMORY_TAG_ENUM )
+#undef _PG_MEMORY_TAG_ENUM
+
+        NUM_TAGS
+    };
+
+    enum class MemoryHeap : uint8_t
+    {
+        CPU,
+        GPU,
+
+        NUM_HEAPS
+    };
+
+    struct MemoryStats
+    {
+        int64_t currentBytes   = 0;
+        int64_t peakBytes      = 0;
+        int64_t numAllocations = 0; // currently live
+    };
+
+    // Allocates the frame allocator up front, so the first frame doesn't have to
+    void Init();
+    void Shutdown();
+
+    // Resets the frame allocator, and snapshots the heap allocation count. Called once at the end
+    // of every frame, by Window::EndFrame
+    void EndFrame();
+
+    // Tagged with the current tag, unless one is given
     void* Allocate( size_t bytes );
+    void* Allocate( size_t bytes, MemoryTag tag );
     void Free( void* ptr ) noexcept;
 
     template < typename T, typename... Args >
@@ -22,39 +98,175 @@ namespace MemoryManager
         ptr->~T();
         Free( ptr );
     }
- 
-    template < class T >
-    struct Allocator
+
+    // Bump pointer allocator over a single fixed size block. Allocations are never freed one at a
+    // time, instead the whole allocator is either reset, or rolled back to an earlier marker. If the
+    // block runs out, allocations fall back to the heap until they are freed by the reset or roll
+    // back, so running out only costs performance (and shows up in NumOverflowAllocations).
+    // Not thread safe, every thread needs its own
+    class LinearAllocator
+    {
+    public:
+        struct Marker
+        {
+            size_t offset;
+            void* overflowHead;
+        };
+
+        LinearAllocator() = default;
+        ~LinearAllocator();
+
+        LinearAllocator( const LinearAllocator& ) = delete;
+        LinearAllocator& operator=( const LinearAllocator& ) = delete;
+
+        void Init( size_t capacity );
+        void Shutdown();
+
+        void* Allocate( size_t bytes, size_t alignment = alignof( std::max_align_t ) );
+
+        template < typename T >
+        T* Allocate( size_t count )
+        {
+            return static_cast< T* >( Allocate( count * sizeof( T ), alignof( T ) ) );
+        }
+
+        Marker GetMarker() const;
+        // Frees everything allocated since the marker was taken
+        void FreeToMarker( const Marker& marker );
+        void Reset();
+
+        size_t BytesUsed() const { return m_offset; }
+        size_t Capacity() const { return m_capacity; }
+        size_t HighWaterMark() const { return m_highWaterMark; }
+        // Since the last Reset
+        size_t NumOverflowAllocations() const { return m_numOverflowAllocations; }
+
+    private:
+        struct OverflowBlock
+        {
+            OverflowBlock* next;
+        };
+
+        char* m_memory                  = nullptr;
+        size_t m_capacity               = 0;
+        size_t m_offset                 = 0;
+        size_t m_highWaterMark          = 0;
+        OverflowBlock* m_overflowHead   = nullptr;
+        size_t m_numOverflowAllocations = 0;
+    };
+
+    // For anything that only needs to live until the end of the current frame. Main thread only,
+    // jobs should use their thread's ScratchScope instead
+    LinearAllocator& FrameAllocator();
+
+    // The calling thread's scratch arena. Use it through a ScratchScope, so that what gets
+    // allocated is freed again
+    LinearAllocator& ScratchArena();
+
+    // Everything allocated from the thread's scratch arena while this is alive is freed when it goes
+    // out of scope. Scopes can be nested, as long as they are destroyed in reverse order
+    class ScratchScope
     {
-        typedef T value_type;
+    public:
+        ScratchScope() : m_arena( ScratchArena() ), m_marker( m_arena.GetMarker() ) {}
+        ~ScratchScope() { m_arena.FreeToMarker( m_marker ); }
+
+        ScratchScope( const ScratchScope& ) = delete;
+        ScratchScope& operator=( const ScratchScope& ) = delete;
 
-        Allocator() = default;
-        template < class U >
-        constexpr Allocator(const Allocator< U >& ) noexcept {}
+        LinearAllocator& Arena() { return m_arena; }
 
-        T* allocate( std::size_t n )
+        template < typename T >
+        T* Allocate( size_t count )
         {
-            std::cout << "allocator allocating: " << n << " elements" << std::endl;
-            return static_cast< T* >( MemoryManager::Allocate( n * sizeof( T ) ) );
+            return m_arena.Allocate< T >( count );
         }
 
-        void deallocate( T* p, std::size_t ) noexcept
+    private:
+        LinearAllocator& m_arena;
+        LinearAllocator::Marker m_marker;
+    };
+
+    // STL allocator on top of a LinearAllocator. Deallocating does nothing, the memory only comes
+    // back when the arena is reset or rolled back, so a container using this must not outlive that,
+    // and should reserve up front instead of growing
+    template < typename T >
+    class ArenaAllocator
+    {
+    public:
+        using value_type = T;
+
+        ArenaAllocator( LinearAllocator& arena ) noexcept : m_arena( &arena ) {}
+        template < typename U >
+        ArenaAllocator( const ArenaAllocator< U >& other ) noexcept : m_arena( other.GetArena() ) {}
+
+        T* allocate( size_t n )
         {
-            std::cout << "allocator freeing!" << std::endl;
-            MemoryManager::Free( p );
+            return m_arena->Allocate< T >( n );
         }
+
+        void deallocate( T*, size_t ) noexcept
+        {
+        }
+
+        LinearAllocator* GetArena() const { return m_arena; }
+
+    private:
+        LinearAllocator* m_arena;
     };
- 
-    template < class T, class U >
-    bool operator==( const Allocator< T >&, const Allocator< U >& )
+
+    template < typename T, typename U >
+    bool operator==( const ArenaAllocator< T >& a, const ArenaAllocator< U >& b )
     {
-        return true;
+        return a.GetArena() == b.GetArena();
     }
-    template < class T, class U >
-    bool operator!=( const Allocator< T >&, const Allocator< U >& )
+    template < typename T, typename U >
+    bool operator!=( const ArenaAllocator< T >& a, const ArenaAllocator< U >& b )
     {
-        return false;
+        return a.GetArena() != b.GetArena();
     }
-    
+
+    template < typename T >
+    using ArenaVector = std::vector< T, ArenaAllocator< T > >;
+    using ArenaString = std::basic_string< char, std::char_traits< char >, ArenaAllocator< char > >;
+
+    const char* GetMemoryTagName( MemoryTag tag );
+
+    // The calling thread's active tag. General outside of any PG_MEMORY_TAG
+    MemoryTag GetCurrentMemoryTag();
+
+    // For memory that doesn't go through MemoryManager or operator new, like GPU allocations. Each
+    // TrackFree has to use the same heap, tag and size as the TrackAllocation it undoes
+    void TrackAllocation( MemoryHeap heap, MemoryTag tag, size_t bytes );
+    void TrackFree( MemoryHeap heap, MemoryTag tag, size_t bytes );
+
+    MemoryStats GetMemoryStats( MemoryHeap heap, MemoryTag tag );
+    // Summed over every tag. The peak is the peak of the sum, not the sum of the peaks
+    MemoryStats GetTotalMemoryStats( MemoryHeap heap );
+
+    // Writes the current and peak bytes of every tag, for both heaps, as JSON
+    bool DumpMemoryStats( const std::string& filename );
+
+    // ImGui table of the current and peak bytes of every tag
+    void DrawMemoryStats();
+
+    class ScopedMemoryTag
+    {
+    public:
+        ScopedMemoryTag( MemoryTag tag );
+        ~ScopedMemoryTag();
+
+        ScopedMemoryTag( const ScopedMemoryTag& ) = delete;
+        ScopedMemoryTag& operator=( const ScopedMemoryTag& ) = delete;
+
+    private:
+        MemoryTag m_previousTag;
+    };
+
+    // Calls to the global operator new, from every thread. Always 0 without PG_COUNT_HEAP_ALLOCATIONS
+    uint64_t NumHeapAllocations();
+    // Between the last two calls to EndFrame
+    uint64_t NumHeapAllocationsLastFrame();
+
 } // namespace MemoryManager
-} // namespace Progression
\ No newline at end of file
+} // namespace Progression
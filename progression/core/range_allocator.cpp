@@ -0,0 +1,426 @@
+#include "core/range_allocator.hpp"
+#include "core/assert.hpp"
+#include <cstring>
+#include <string>
+
+#if USING( WINDOWS_PROGRAM )
+#include <intrin.h>
+#endif // #if USING( WINDOWS_PROGRAM )
+
+#define MANTISSA_BITS 3
+#define MANTISSA_VALUE ( 1 << MANTISSA_BITS )
+#define MANTISSA_MASK ( MANTISSA_VALUE - 1 )
+
+static uint32_t HighestSetBit( uint32_t x )
+{
+#if USING( WINDOWS_PROGRAM )
+    unsigned long index;
+    _BitScanReverse( &index, x );
+    return index;
+#else // #if USING( WINDOWS_PROGRAM )
+    return 31 - __builtin_clz( x );
+#endif // #else // #if USING( WINDOWS_PROGRAM )
+}
+
+static uint32_t LowestSetBit( uint32_t x )
+{
+#if USING( WINDOWS_PROGRAM )
+    unsigned long index;
+    _BitScanForward( &index, x );
+    return index;
+#else // #if USING( WINDOWS_PROGRAM )
+    return __builtin_ctz( x );
+#endif // #else // #if USING( WINDOWS_PROGRAM )
+}
+
+// Returns the index of the lowest set bit in mask that is >= startBit, or NO_SPACE if there is none
+static uint32_t FindLowestSetBitAfter( uint32_t mask, uint32_t startBit )
+{
+    if ( startBit >= 32 )
+    {
+        return Progression::RangeAllocator::NO_SPACE;
+    }
+    uint32_t maskAfterStart = mask & ~( ( 1u << startBit ) - 1 );
+    if ( maskAfterStart == 0 )
+    {
+        return Progression::RangeAllocator::NO_SPACE;
+    }
+    return LowestSetBit( maskAfterStart );
+}
+
+// Bin sizes follow a small float distribution: 3 bit mantissa, 5 bit exponent. Sizes < 8 are
+// exact (denormals). Allocations round up so that any node in the found bin is big enough,
+// free nodes round down so that a node is never placed in a bin that claims more space than it has.
+static uint32_t SizeToBinRoundUp( uint32_t size )
+{
+    uint32_t exp      = 0;
+    uint32_t mantissa = 0;
+    if ( size < MANTISSA_VALUE )
+    {
+        mantissa = size;
+    }
+    else
+    {
+        uint32_t highestSetBit    = HighestSetBit( size );
+        uint32_t mantissaStartBit = highestSetBit - MANTISSA_BITS;
+        exp                       = mantissaStartBit + 1;
+        mantissa                  = ( size >> mantissaStartBit ) & MANTISSA_MASK;
+
+        uint32_t lowBitsMask = ( 1u << mantissaStartBit ) - 1;
+        if ( ( size & lowBitsMask ) != 0 )
+        {
+            ++mantissa;
+        }
+    }
+
+    // a mantissa overflow carries into the exponent, which is still the correct bin
+    return ( exp << MANTISSA_BITS ) + mantissa;
+}
+
+static uint32_t SizeToBinRoundDown( uint32_t size )
+{
+    uint32_t exp      = 0;
+    uint32_t mantissa = 0;
+    if ( size < MANTISSA_VALUE )
+    {
+        mantissa = size;
+    }
+    else
+    {
+        uint32_t highestSetBit    = HighestSetBit( size );
+        uint32_t mantissaStartBit = highestSetBit - MANTISSA_BITS;
+        exp                       = mantissaStartBit + 1;
+        mantissa                  = ( size >> mantissaStartBit ) & MANTISSA_MASK;
+    }
+
+    return ( exp << MANTISSA_BITS ) | mantissa;
+}
+
+namespace Progression
+{
+
+RangeAllocator::RangeAllocator( uint32_t size )
+{
+    Init( size );
+}
+
+void RangeAllocator::Init( uint32_t size )
+{
+    m_size = size;
+    Reset();
+}
+
+void RangeAllocator::Reset()
+{
+    m_freeStorage    = 0;
+    m_numAllocations = 0;
+    m_numFreeRegions = 0;
+    m_lastNode       = UNUSED;
+    m_usedBinsTop    = 0;
+    memset( m_usedBins, 0, sizeof( m_usedBins ) );
+    memset( m_binIndices, 0xFF, sizeof( m_binIndices ) );
+    m_nodes.clear();
+    m_freeNodes.clear();
+
+    if ( m_size > 0 )
+    {
+        m_lastNode = InsertNodeIntoBin( m_size, 0 );
+    }
+}
+
+RangeAllocator::Allocation RangeAllocator::Allocate( uint32_t size )
+{
+    PG_ASSERT( size > 0, "Trying to make a 0 sized allocation" );
+
+    // Find the first bin that is guaranteed to fit the allocation. Try the rest of the leaf
+    // bins in the same top bin first, then move on to the next top bin with any free nodes
+    uint32_t minBinIndex     = SizeToBinRoundUp( size );
+    uint32_t minTopBinIndex  = minBinIndex >> MANTISSA_BITS;
+    uint32_t minLeafBinIndex = minBinIndex & MANTISSA_MASK;
+
+    uint32_t topBinIndex  = minTopBinIndex;
+    uint32_t leafBinIndex = NO_SPACE;
+    if ( topBinIndex < NUM_TOP_BINS && ( m_usedBinsTop & ( 1u << topBinIndex ) ) )
+    {
+        leafBinIndex = FindLowestSetBitAfter( m_usedBins[topBinIndex], minLeafBinIndex );
+    }
+
+    if ( leafBinIndex == NO_SPACE )
+    {
+        topBinIndex = FindLowestSetBitAfter( m_usedBinsTop, minTopBinIndex + 1 );
+        if ( topBinIndex == NO_SPACE )
+        {
+            return {};
+        }
+        leafBinIndex = LowestSetBit( m_usedBins[topBinIndex] );
+    }
+
+    uint32_t binIndex  = ( topBinIndex << MANTISSA_BITS ) | leafBinIndex;
+    uint32_t nodeIndex = m_binIndices[binIndex];
+    RemoveNodeFromBin( nodeIndex );
+
+    Node& node             = m_nodes[nodeIndex];
+    uint32_t nodeTotalSize = node.size;
+    node.size              = size;
+    node.used              = true;
+    ++m_numAllocations;
+
+    // Put the remainder back into the bins as a new free node, directly after this one
+    uint32_t remainder = nodeTotalSize - size;
+    if ( remainder > 0 )
+    {
+        uint32_t newNodeIndex = InsertNodeIntoBin( remainder, m_nodes[nodeIndex].offset + size );
+        uint32_t nextIndex    = m_nodes[nodeIndex].neighborNext;
+        if ( nextIndex != UNUSED )
+        {
+            m_nodes[nextIndex].neighborPrev = newNodeIndex;
+        }
+        m_nodes[newNodeIndex].neighborPrev = nodeIndex;
+        m_nodes[newNodeIndex].neighborNext = nextIndex;
+        m_nodes[nodeIndex].neighborNext    = newNodeIndex;
+        if ( m_lastNode == nodeIndex )
+        {
+            m_lastNode = newNodeIndex;
+        }
+    }
+
+    return { m_nodes[nodeIndex].offset, nodeIndex };
+}
+
+void RangeAllocator::Free( const Allocation& allocation )
+{
+    PG_ASSERT( allocation.metadata < m_nodes.size(), "Freeing an invalid allocation" );
+    uint32_t nodeIndex = allocation.metadata;
+    Node& node         = m_nodes[nodeIndex];
+    PG_ASSERT( node.used, "Double free of allocation" );
+
+    uint32_t offset = node.offset;
+    uint32_t size   = node.size;
+
+    // Merge with the free neighbors on either side
+    if ( node.neighborPrev != UNUSED && !m_nodes[node.neighborPrev].used )
+    {
+        const Node& prevNode = m_nodes[node.neighborPrev];
+        offset               = prevNode.offset;
+        size                += prevNode.size;
+        uint32_t prevIndex   = node.neighborPrev;
+        node.neighborPrev    = prevNode.neighborPrev;
+        RemoveNodeFromBin( prevIndex );
+        ReleaseNode( prevIndex );
+    }
+
+    if ( node.neighborNext != UNUSED && !m_nodes[node.neighborNext].used )
+    {
+        const Node& nextNode = m_nodes[node.neighborNext];
+        size                += nextNode.size;
+        uint32_t nextIndex   = node.neighborNext;
+        node.neighborNext    = nextNode.neighborNext;
+        RemoveNodeFromBin( nextIndex );
+        ReleaseNode( nextIndex );
+        if ( m_lastNode == nextIndex )
+        {
+            m_lastNode = nodeIndex;
+        }
+    }
+
+    uint32_t neighborPrev = node.neighborPrev;
+    uint32_t neighborNext = node.neighborNext;
+    ReleaseNode( nodeIndex );
+    --m_numAllocations;
+
+    uint32_t combinedIndex = InsertNodeIntoBin( size, offset );
+    if ( neighborPrev != UNUSED )
+    {
+        m_nodes[combinedIndex].neighborPrev = neighborPrev;
+        m_nodes[neighborPrev].neighborNext  = combinedIndex;
+    }
+    if ( neighborNext != UNUSED )
+    {
+        m_nodes[combinedIndex].neighborNext = neighborNext;
+        m_nodes[neighborNext].neighborPrev  = combinedIndex;
+    }
+    if ( m_lastNode == nodeIndex )
+    {
+        m_lastNode = combinedIndex;
+    }
+}
+
+void RangeAllocator::Grow( uint32_t newSize )
+{
+    PG_ASSERT( newSize >= m_size, "RangeAllocator can only grow" );
+    if ( newSize == m_size )
+    {
+        return;
+    }
+
+    uint32_t addedSize = newSize - m_size;
+    if ( m_lastNode != UNUSED && !m_nodes[m_lastNode].used )
+    {
+        // Extend the free range at the end instead of adding a new one next to it
+        uint32_t offset       = m_nodes[m_lastNode].offset;
+        uint32_t size         = m_nodes[m_lastNode].size;
+        uint32_t neighborPrev = m_nodes[m_lastNode].neighborPrev;
+        RemoveNodeFromBin( m_lastNode );
+        ReleaseNode( m_lastNode );
+
+        m_lastNode = InsertNodeIntoBin( size + addedSize, offset );
+        m_nodes[m_lastNode].neighborPrev = neighborPrev;
+        if ( neighborPrev != UNUSED )
+        {
+            m_nodes[neighborPrev].neighborNext = m_lastNode;
+        }
+    }
+    else
+    {
+        uint32_t prevLast = m_lastNode;
+        m_lastNode = InsertNodeIntoBin( addedSize, m_size );
+        m_nodes[m_lastNode].neighborPrev = prevLast;
+        if ( prevLast != UNUSED )
+        {
+            m_nodes[prevLast].neighborNext = m_lastNode;
+        }
+    }
+
+    m_size = newSize;
+}
+
+uint32_t RangeAllocator::AllocationSize( const Allocation& allocation ) const
+{
+    if ( !allocation.IsValid() )
+    {
+        return 0;
+    }
+    return m_nodes[allocation.metadata].size;
+}
+
+uint32_t RangeAllocator::Size() const
+{
+    return m_size;
+}
+
+RangeAllocator::Stats RangeAllocator::GetStats() const
+{
+    Stats stats;
+    stats.totalSize      = m_size;
+    stats.totalFree      = m_freeStorage;
+    stats.numAllocations = m_numAllocations;
+    stats.numFreeRegions = m_numFreeRegions;
+
+    // Nodes are placed in bins by rounding down, so the largest free node has to be somewhere in
+    // the highest used bin, but not necessarily at the head of it
+    if ( m_usedBinsTop )
+    {
+        uint32_t topBinIndex  = HighestSetBit( m_usedBinsTop );
+        uint32_t leafBinIndex = HighestSetBit( m_usedBins[topBinIndex] );
+        uint32_t nodeIndex    = m_binIndices[( topBinIndex << MANTISSA_BITS ) | leafBinIndex];
+        while ( nodeIndex != UNUSED )
+        {
+            if ( m_nodes[nodeIndex].size > stats.largestFreeRegion )
+            {
+                stats.largestFreeRegion = m_nodes[nodeIndex].size;
+            }
+            nodeIndex = m_nodes[nodeIndex].binListNext;
+        }
+    }
+
+    if ( stats.totalFree > 0 )
+    {
+        stats.fragmentation = 1.0f - stats.largestFreeRegion / static_cast< float >( stats.totalFree );
+    }
+
+    return stats;
+}
+
+uint32_t RangeAllocator::InsertNodeIntoBin( uint32_t size, uint32_t offset )
+{
+    uint32_t binIndex     = SizeToBinRoundDown( size );
+    uint32_t topBinIndex  = binIndex >> MANTISSA_BITS;
+    uint32_t leafBinIndex = binIndex & MANTISSA_MASK;
+
+    if ( m_binIndices[binIndex] == UNUSED )
+    {
+        m_usedBins[topBinIndex] |= 1u << leafBinIndex;
+        m_usedBinsTop           |= 1u << topBinIndex;
+    }
+
+    uint32_t headIndex = m_binIndices[binIndex];
+    uint32_t nodeIndex = AcquireNode();
+    Node& node         = m_nodes[nodeIndex];
+    node.offset        = offset;
+    node.size          = size;
+    node.binListPrev   = UNUSED;
+    node.binListNext   = headIndex;
+    node.neighborPrev  = UNUSED;
+    node.neighborNext  = UNUSED;
+    node.used          = false;
+    if ( headIndex != UNUSED )
+    {
+        m_nodes[headIndex].binListPrev = nodeIndex;
+    }
+    m_binIndices[binIndex] = nodeIndex;
+
+    m_freeStorage += size;
+    ++m_numFreeRegions;
+
+    return nodeIndex;
+}
+
+void RangeAllocator::RemoveNodeFromBin( uint32_t nodeIndex )
+{
+    Node& node = m_nodes[nodeIndex];
+    if ( node.binListPrev != UNUSED )
+    {
+        m_nodes[node.binListPrev].binListNext = node.binListNext;
+        if ( node.binListNext != UNUSED )
+        {
+            m_nodes[node.binListNext].binListPrev = node.binListPrev;
+        }
+    }
+    else
+    {
+        // head of the bin list
+        uint32_t binIndex     = SizeToBinRoundDown( node.size );
+        uint32_t topBinIndex  = binIndex >> MANTISSA_BITS;
+        uint32_t leafBinIndex = binIndex & MANTISSA_MASK;
+
+        m_binIndices[binIndex] = node.binListNext;
+        if ( node.binListNext != UNUSED )
+        {
+            m_nodes[node.binListNext].binListPrev = UNUSED;
+        }
+        else
+        {
+            m_usedBins[topBinIndex] &= ~( 1u << leafBinIndex );
+            if ( m_usedBins[topBinIndex] == 0 )
+            {
+                m_usedBinsTop &= ~( 1u << topBinIndex );
+            }
+        }
+    }
+
+    node.binListPrev = UNUSED;
+    node.binListNext = UNUSED;
+    m_freeStorage   -= node.size;
+    --m_numFreeRegions;
+}
+
+uint32_t RangeAllocator::AcquireNode()
+{
+    if ( !m_freeNodes.empty() )
+    {
+        uint32_t index = m_freeNodes.back();
+        m_freeNodes.pop_back();
+        return index;
+    }
+
+    m_nodes.emplace_back();
+    return static_cast< uint32_t >( m_nodes.size() - 1 );
+}
+
+void RangeAllocator::ReleaseNode( uint32_t nodeIndex )
+{
+    m_nodes[nodeIndex].used = false;
+    m_freeNodes.push_back( nodeIndex );
+}
+
+} // namespace Progression
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace Progression
+{
+
+// O(1) TLSF style allocator for handing out sub-ranges of a larger resource (a GPU buffer, a block
+// of device memory, etc). It never touches the memory it manages, it only tracks offsets and sizes,
+// so the units are up to the caller (bytes, matrices, vertices...).
+// Free ranges are binned by a small floating point representation of their size (5 bit exponent,
+// 3 bit mantissa), with a bitmask per level to find a big enough bin in constant time.
+// Neighboring free ranges are merged immediately on Free.
+class RangeAllocator
+{
+public:
+    static constexpr uint32_t NO_SPACE = 0xFFFFFFFF;
+
+    struct Allocation
+    {
+        uint32_t offset   = NO_SPACE;
+        uint32_t metadata = NO_SPACE; // internal node index, needed to free the allocation
+
+        bool IsValid() const { return offset != NO_SPACE; }
+    };
+
+    struct Stats
+    {
+        uint32_t totalSize         = 0;
+        uint32_t totalFree         = 0;
+        uint32_t largestFreeRegion = 0;
+        uint32_t numAllocations    = 0;
+        uint32_t numFreeRegions    = 0;
+        float fragmentation        = 0; // 0 = all free space is contiguous, approaches 1 as it gets split up
+    };
+
+    RangeAllocator() = default;
+    RangeAllocator( uint32_t size );
+
+    void Init( uint32_t size );
+    void Reset();
+
+    // Returns an invalid allocation if there is no free range big enough
+    Allocation Allocate( uint32_t size );
+    void Free( const Allocation& allocation );
+
+    // Extends the managed range to [0, newSize). Existing allocations keep their offsets
+    void Grow( uint32_t newSize );
+
+    uint32_t AllocationSize( const Allocation& allocation ) const;
+    uint32_t Size() const;
+    Stats GetStats() const;
+
+private:
+    static constexpr uint32_t NUM_TOP_BINS  = 32;
+    static constexpr uint32_t BINS_PER_LEAF = 8;
+    static constexpr uint32_t NUM_LEAF_BINS = NUM_TOP_BINS * BINS_PER_LEAF;
+    static constexpr uint32_t UNUSED        = 0xFFFFFFFF;
+
+    struct Node
+    {
+        uint32_t offset       = 0;
+        uint32_t size         = 0;
+        uint32_t binListPrev  = UNUSED;
+        uint32_t binListNext  = UNUSED;
+        uint32_t neighborPrev = UNUSED;
+        uint32_t neighborNext = UNUSED;
+        bool used             = false;
+    };
+
+    uint32_t InsertNodeIntoBin( uint32_t size, uint32_t offset );
+    void RemoveNodeFromBin( uint32_t nodeIndex );
+    uint32_t AcquireNode();
+    void ReleaseNode( uint32_t nodeIndex );
+
+    uint32_t m_size           = 0;
+    uint32_t m_freeStorage    = 0;
+    uint32_t m_numAllocations = 0;
+    uint32_t m_numFreeRegions = 0;
+    uint32_t m_lastNode       = UNUSED; // node with the highest offset, needed for Grow
+
+    uint32_t m_usedBinsTop = 0;
+    uint8_t m_usedBins[NUM_TOP_BINS] = {};
+    uint32_t m_binIndices[NUM_LEAF_BINS] = {};
+
+    std::vector< Node > m_nodes;
+    std::vector< uint32_t > m_freeNodes;
+};
+
+} // namespace Progression
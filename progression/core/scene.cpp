@@ -2,10 +2,15 @@
 #include "core/animation_system.hpp"
 #include "core/assert.hpp"
 #include "core/lua.hpp"
+#include "core/memory_manager.hpp"
 #include "core/time.hpp"
+#include "core/transform_system.hpp"
 #include "components/factory.hpp"
 #include "components/animation_component.hpp"
+#include "components/entity_metadata.hpp"
 #include "components/script_component.hpp"
+#include "components/transform.hpp"
+#include "graphics/vulkan.hpp"
 #include "resource/image.hpp"
 #include "resource/resource_manager.hpp"
 #include "utils/json_parsing.hpp"
@@ -55,10 +60,11 @@ static void ParseDirectionalLight( rapidjson::Value& value, Scene* scene )
 {
     static FunctionMapper< void, ShadowMap& > shadowMapping(
     {
-        { "constantBias", []( rapidjson::Value& v, ShadowMap& m ) { m.constantBias = ParseNumber< float >( v ); } },
-        { "slopeBias",    []( rapidjson::Value& v, ShadowMap& m ) { m.slopeBias    = ParseNumber< float >( v ); } },
-        { "width",        []( rapidjson::Value& v, ShadowMap& m ) { m.width        = ParseNumber< uint32_t >( v ); } },
-        { "height",       []( rapidjson::Value& v, ShadowMap& m ) { m.height       = ParseNumber< uint32_t >( v ); } },
+        { "constantBias",       []( rapidjson::Value& v, ShadowMap& m ) { m.constantBias       = ParseNumber< float >( v ); } },
+        { "slopeBias",          []( rapidjson::Value& v, ShadowMap& m ) { m.slopeBias          = ParseNumber< float >( v ); } },
+        { "width",              []( rapidjson::Value& v, ShadowMap& m ) { m.width              = ParseNumber< uint32_t >( v ); } },
+        { "height",             []( rapidjson::Value& v, ShadowMap& m ) { m.height             = ParseNumber< uint32_t >( v ); } },
+        { "cascadeSplitLambda", []( rapidjson::Value& v, ShadowMap& m ) { m.cascadeSplitLambda = ParseNumber< float >( v ); } },
     });
 
     static FunctionMapper< void, DirectionalLight& > mapping(
@@ -133,6 +139,50 @@ static void ParseAmbientColor( rapidjson::Value& v, Scene* scene )
     scene->ambientColor = ParseVec3( member );
 }
 
+static void UpdateScripts( Scene* scene )
+{
+    auto luaTimeNamespace = g_LuaState["Time"].get_or_create< sol::table >();
+    luaTimeNamespace["dt"] = Time::DeltaTime();
+    g_LuaState["registry"] = &scene->registry;
+    scene->registry.view< ScriptComponent >().each([]( const entt::entity e, ScriptComponent& comp )
+    {
+        for ( int i = 0; i < comp.numScriptsWithUpdate; ++i )
+        {
+            comp.scripts[i].env["entity"] = e;
+            CHECK_SOL_FUNCTION_CALL( comp.scripts[i].updateFunc.second() );
+        }
+    });
+}
+
+static void RegisterEngineSystems( Scene* scene )
+{
+    SystemDescriptor scripts;
+    scripts.name           = "Scripts";
+    scripts.update         = UpdateScripts;
+    scripts.exclusive      = true; // scripts can touch any component
+    scripts.mainThreadOnly = true;
+    scene->scheduler.AddSystem( scripts );
+
+    SystemDescriptor transformSync;
+    transformSync.name      = "TransformSync";
+    transformSync.update    = TransformSystem::SyncHierarchy;
+    transformSync.exclusive = true;
+    scene->scheduler.AddSystem( transformSync );
+
+    SystemDescriptor animation;
+    animation.name   = "Animation";
+    animation.update = AnimationSystem::Update;
+    animation.writes = Components< Animator >();
+    scene->scheduler.AddSystem( animation );
+
+    SystemDescriptor transforms;
+    transforms.name   = "Transforms";
+    transforms.update = TransformSystem::Update;
+    transforms.reads  = Components< EntityMetaData >();
+    transforms.writes = Components< Transform, WorldTransform >();
+    scene->scheduler.AddSystem( transforms );
+}
+
 static void ParseSkybox( rapidjson::Value& v, Scene* scene )
 {
     PG_ASSERT( v.IsString() );
@@ -152,6 +202,13 @@ Scene::~Scene()
         registry.remove< Animator >( entity );
     }
 
+    // Frames in flight can still be rendering into the shadow maps. Scenes can also be made without a device,
+    // like in the tests, so this checks for a device instead of g_headless
+    if ( Gfx::g_renderState.device )
+    {
+        Gfx::g_renderState.device.WaitForIdle();
+    }
+
     if ( directionalLight.shadowMap )
     {
         directionalLight.shadowMap->Free();
@@ -175,6 +232,7 @@ Scene::~Scene()
 
 Scene* Scene::Load( const std::string& filename )
 {
+    PG_MEMORY_TAG( Scene );
     Scene* scene = new Scene;
     scene->directionalLight.colorAndIntensity.w = 0; // turn off the directional light to start
 
@@ -202,6 +260,10 @@ Scene* Scene::Load( const std::string& filename )
 
     scene->registry.on_construct< Animator >().connect< &AnimationSystem::OnAnimatorConstruction >();
     scene->registry.on_destroy< Animator >().connect< &AnimationSystem::OnAnimatorDestruction >();
+    scene->registry.on_destroy< WorldTransform >().connect< &TransformSystem::OnHierarchyChange >();
+    scene->registry.on_destroy< EntityMetaData >().connect< &TransformSystem::OnHierarchyChange >();
+
+    RegisterEngineSystems( scene );
 
     return scene;
 }
@@ -222,23 +284,14 @@ void Scene::Start()
             }
         }
     });
+    // Make sure the world transforms are valid even if the first frame is rendered before any Update
+    TransformSystem::SyncHierarchy( this );
+    TransformSystem::Update( this );
 }
 
 void Scene::Update()
 {
-    auto luaTimeNamespace = g_LuaState["Time"].get_or_create< sol::table >();
-    luaTimeNamespace["dt"] = Time::DeltaTime();
-    g_LuaState["registry"] = &registry;
-    registry.view< ScriptComponent >().each([]( const entt::entity e, ScriptComponent& comp )
-    {
-        for ( int i = 0; i < comp.numScriptsWithUpdate; ++i )
-        {
-            comp.scripts[i].env["entity"] = e;
-            CHECK_SOL_FUNCTION_CALL( comp.scripts[i].updateFunc.second() );
-        }
-    });
-
-    AnimationSystem::Update( this );
+    scheduler.Run( this );
 }
 
 } // namespace Progression
@@ -2,6 +2,7 @@
 
 #include "core/camera.hpp"
 #include "core/ecs.hpp"
+#include "core/system_scheduler.hpp"
 #include "graphics/lights.hpp"
 #include <vector>
 
@@ -27,6 +28,7 @@ namespace Progression
         std::vector< PointLight > pointLights;
         std::vector< SpotLight > spotLights;
         entt::registry registry;
+        SystemScheduler scheduler;
     };
 
 } // namespace Progression
@@ -0,0 +1,44 @@
+#include "core/skinning.hpp"
+#include "core/assert.hpp"
+#include "resource/model.hpp"
+
+namespace Progression
+{
+namespace Skinning
+{
+
+glm::mat4 BlendJointTransforms( const BlendWeight& blendWeight, const glm::mat4* jointTransforms )
+{
+    glm::mat4 transform = jointTransforms[blendWeight.joints[0]] * blendWeight.weights[0];
+    transform          += jointTransforms[blendWeight.joints[1]] * blendWeight.weights[1];
+    transform          += jointTransforms[blendWeight.joints[2]] * blendWeight.weights[2];
+    transform          += jointTransforms[blendWeight.joints[3]] * blendWeight.weights[3];
+
+    return transform;
+}
+
+void SkinModel( const Model& model, const std::vector< glm::mat4 >& jointTransforms, SkinnedVertices& out )
+{
+    PG_ASSERT( model.blendWeights.size() == model.vertices.size(), "Model '" + model.name + "' has no CPU blend weights to skin with" );
+    PG_ASSERT( jointTransforms.size() >= model.skeleton.joints.size() );
+
+    size_t numVertices = model.vertices.size();
+    bool hasTangents   = !model.tangents.empty();
+    out.positions.resize( numVertices );
+    out.normals.resize( numVertices );
+    out.tangents.resize( hasTangents ? numVertices : 0 );
+
+    for ( size_t i = 0; i < numVertices; ++i )
+    {
+        glm::mat4 transform = BlendJointTransforms( model.blendWeights[i], jointTransforms.data() );
+        out.positions[i]    = glm::vec3( transform * glm::vec4( model.vertices[i], 1 ) );
+        out.normals[i]      = glm::normalize( glm::vec3( transform * glm::vec4( model.normals[i], 0 ) ) );
+        if ( hasTangents )
+        {
+            out.tangents[i] = glm::normalize( glm::vec3( transform * glm::vec4( model.tangents[i], 0 ) ) );
+        }
+    }
+}
+
+} // namespace Skinning
+} // namespace Progression
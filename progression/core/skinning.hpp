@@ -0,0 +1,29 @@
+#pragma once
+
+#include "core/math.hpp"
+#include <vector>
+
+namespace Progression
+{
+
+class Model;
+struct BlendWeight;
+
+namespace Skinning
+{
+
+    struct SkinnedVertices
+    {
+        std::vector< glm::vec3 > positions;
+        std::vector< glm::vec3 > normals;
+        std::vector< glm::vec3 > tangents; // empty if the model has no tangents
+    };
+
+    // CPU reference of skinning.comp, so that the GPU output can be verified without a device.
+    // jointTransforms are the final per joint matrices, the same ones uploaded to the bone buffer.
+    // The model needs its CPU copy of the geometry (ModelCreateInfo::freeCpuCopy = false)
+    glm::mat4 BlendJointTransforms( const BlendWeight& blendWeight, const glm::mat4* jointTransforms );
+    void SkinModel( const Model& model, const std::vector< glm::mat4 >& jointTransforms, SkinnedVertices& out );
+
+} // namespace Skinning
+} // namespace Progression
@@ -0,0 +1,168 @@
+#include "core/system_scheduler.hpp"
+#include "core/assert.hpp"
+#include "core/cpu_profiling.hpp"
+#include "core/scene.hpp"
+#include "utils/logger.hpp"
+#include <algorithm>
+#include <memory>
+#include <thread>
+
+namespace Progression
+{
+
+static bool Overlaps( const std::vector< ComponentAccess >& a, const std::vector< ComponentAccess >& b )
+{
+    for ( const auto& x : a )
+    {
+        for ( const auto& y : b )
+        {
+            if ( x.type == y.type )
+            {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+static bool Conflicts( const SystemDescriptor& a, const SystemDescriptor& b )
+{
+    return a.exclusive || b.exclusive || Overlaps( a.writes, b.writes ) || Overlaps( a.writes, b.reads ) || Overlaps( a.reads, b.writes );
+}
+
+void SystemScheduler::AddSystem( const SystemDescriptor& system )
+{
+    PG_ASSERT( system.update, "System '" + system.name + "' has no update function" );
+    m_systems.push_back( system );
+    m_profileNames.push_back( CpuProfile::InternName( system.name ) );
+    m_graphDirty = true;
+}
+
+void SystemScheduler::Clear()
+{
+    m_systems.clear();
+    m_profileNames.clear();
+    m_dependents.clear();
+    m_numDependencies.clear();
+    m_remainingDependencies.reset();
+    m_graphDirty = true;
+}
+
+void SystemScheduler::BuildDependencyGraph()
+{
+    uint32_t numSystems = static_cast< uint32_t >( m_systems.size() );
+    m_dependents.assign( numSystems, {} );
+    m_numDependencies.assign( numSystems, 0 );
+    m_remainingDependencies.reset( new std::atomic< uint32_t >[numSystems] );
+    for ( uint32_t later = 0; later < numSystems; ++later )
+    {
+        for ( uint32_t earlier = 0; earlier < later; ++earlier )
+        {
+            if ( Conflicts( m_systems[earlier], m_systems[later] ) )
+            {
+                m_dependents[earlier].push_back( later );
+                ++m_numDependencies[later];
+            }
+        }
+    }
+    m_graphDirty = false;
+}
+
+void SystemScheduler::Run( Scene* scene )
+{
+    PG_PROFILE_SCOPE( "Scene Systems" );
+    PG_ASSERT( Jobs::GetThreadIndex() == 0, "Systems have to be run from the main thread" );
+    if ( m_graphDirty )
+    {
+        BuildDependencyGraph();
+    }
+
+    uint32_t numSystems = static_cast< uint32_t >( m_systems.size() );
+    if ( numSystems == 0 )
+    {
+        return;
+    }
+
+    for ( const auto& system : m_systems )
+    {
+        for ( const auto& access : system.reads )
+        {
+            access.preparePool( scene->registry );
+        }
+        for ( const auto& access : system.writes )
+        {
+            access.preparePool( scene->registry );
+        }
+    }
+
+    m_runScene = scene;
+    m_numFinished.store( 0, std::memory_order_relaxed );
+    for ( uint32_t i = 0; i < numSystems; ++i )
+    {
+        m_remainingDependencies[i].store( m_numDependencies[i], std::memory_order_relaxed );
+    }
+
+    for ( uint32_t i = 0; i < numSystems; ++i )
+    {
+        if ( m_numDependencies[i] == 0 )
+        {
+            Launch( i );
+        }
+    }
+
+    while ( m_numFinished.load( std::memory_order_acquire ) < numSystems )
+    {
+        if ( !Jobs::TryRunJob() )
+        {
+            std::this_thread::yield();
+        }
+    }
+    m_runScene = nullptr;
+}
+
+void SystemScheduler::Launch( uint32_t index )
+{
+    if ( m_systems[index].mainThreadOnly )
+    {
+        Jobs::SubmitMainThread( [this, index]() { Execute( index ); } );
+    }
+    else
+    {
+        Jobs::Submit( [this, index]() { Execute( index ); } );
+    }
+}
+
+void SystemScheduler::Execute( uint32_t index )
+{
+    {
+        PG_PROFILE_SCOPE( m_profileNames[index] );
+        m_systems[index].update( m_runScene );
+    }
+    for ( uint32_t dependent : m_dependents[index] )
+    {
+        if ( m_remainingDependencies[dependent].fetch_sub( 1, std::memory_order_acq_rel ) == 1 )
+        {
+            Launch( dependent );
+        }
+    }
+    m_numFinished.fetch_add( 1, std::memory_order_release );
+}
+
+void SystemScheduler::PrintDependencies() const
+{
+    for ( size_t i = 0; i < m_systems.size(); ++i )
+    {
+        std::string dependents;
+        if ( i < m_dependents.size() )
+        {
+            for ( uint32_t dependent : m_dependents[i] )
+            {
+                dependents += " " + m_systems[dependent].name;
+            }
+        }
+        LOG( "System '", m_systems[i].name, "' ->", dependents );
+    }
+}
+
+} // namespace Progression
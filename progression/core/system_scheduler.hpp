@@ -0,0 +1,94 @@
+#pragma once
+
+#include "core/ecs.hpp"
+#include "core/jobs.hpp"
+#include "core/memory_manager.hpp"
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <typeindex>
+#include <vector>
+
+namespace Progression
+{
+
+class Scene;
+
+struct ComponentAccess
+{
+    std::type_index type;
+    // EnTT creates component pools lazily, which is not thread safe, so every pool a system
+    // touches gets created on the main thread before any systems start
+    void (*preparePool)( entt::registry& registry );
+};
+
+template< typename... Component >
+std::vector< ComponentAccess > Components()
+{
+    return { ComponentAccess{ typeid( Component ), []( entt::registry& registry ) { registry.view< Component >(); } }... };
+}
+
+struct SystemDescriptor
+{
+    std::string name;
+    std::function< void( Scene* ) > update;
+    std::vector< ComponentAccess > reads;
+    std::vector< ComponentAccess > writes;
+    // Exclusive systems can do anything, including creating and destroying entities or components,
+    // so they never overlap with other systems
+    bool exclusive      = false;
+    // For systems that use the lua state, the window, etc
+    bool mainThreadOnly = false;
+};
+
+// Runs the systems of a scene once per frame. Systems are ordered by the order they were added in,
+// but two systems only wait on each other if their component access conflicts (one writes what
+// the other reads or writes). Everything else runs concurrently on the job system.
+class SystemScheduler
+{
+public:
+    SystemScheduler() = default;
+
+    void AddSystem( const SystemDescriptor& system );
+    void Clear();
+    void Run( Scene* scene );
+
+    void PrintDependencies() const;
+
+private:
+    void BuildDependencyGraph();
+    void Launch( uint32_t index );
+    void Execute( uint32_t index );
+
+    std::vector< SystemDescriptor > m_systems;
+    std::vector< const char* > m_profileNames; // interned system names, for the CPU profiler
+    std::vector< std::vector< uint32_t > > m_dependents;
+    std::vector< uint32_t > m_numDependencies;
+    bool m_graphDirty = true;
+
+    // State of the current Run, kept around so running the systems doesn't allocate every frame
+    Scene* m_runScene = nullptr;
+    std::unique_ptr< std::atomic< uint32_t >[] > m_remainingDependencies;
+    std::atomic< uint32_t > m_numFinished = { 0 };
+};
+
+// Chunked version of view.each for large views. The function has to be safe to call concurrently
+// for different entities: fn( entity, Component&... )
+template< typename... Component, typename Func >
+void ParallelEach( entt::registry& registry, Func fn, uint32_t minBatchSize = 64 )
+{
+    auto view = registry.view< Component... >();
+    // Out of the scratch arena, since this runs every frame
+    MemoryManager::ScratchScope scratch;
+    MemoryManager::ArenaVector< entt::entity > entities( view.begin(), view.end(), MemoryManager::ArenaAllocator< entt::entity >( scratch.Arena() ) );
+    Jobs::ParallelFor( static_cast< uint32_t >( entities.size() ), minBatchSize, [&]( uint32_t begin, uint32_t end )
+    {
+        for ( uint32_t i = begin; i < end; ++i )
+        {
+            fn( entities[i], registry.get< Component >( entities[i] )... );
+        }
+    });
+}
+
+} // namespace Progression
@@ -8,6 +8,7 @@ static TimePoint s_startTime = TimePoint();
 static float s_currentFrameStartTime = 0;
 static float s_lastFrameStartTime    = 0;
 static float s_deltaTime             = 0;
+static float s_fixedDeltaTime        = 0;
 
 namespace Progression
 {
@@ -34,6 +35,13 @@ namespace Time
 
     void StartFrame()
     {
+        if ( s_fixedDeltaTime > 0 )
+        {
+            s_currentFrameStartTime = s_lastFrameStartTime + 1000 * s_fixedDeltaTime;
+            s_deltaTime             = s_fixedDeltaTime;
+            return;
+        }
+
         s_currentFrameStartTime = Time();
         s_deltaTime             = 0.001f * ( s_currentFrameStartTime - s_lastFrameStartTime );
     }
@@ -43,6 +51,11 @@ namespace Time
         s_lastFrameStartTime = s_currentFrameStartTime;
     }
 
+    void SetFixedDeltaTime( float seconds )
+    {
+        s_fixedDeltaTime = seconds;
+    }
+
     TimePoint GetTimePoint()
     {
         return Clock::now();
@@ -14,6 +14,10 @@ namespace Time
     void StartFrame();
     void EndFrame();
 
+    // When > 0, every frame advances by exactly this many seconds instead of the measured time, so
+    // that runs are reproducible (benchmarks, replays). Pass 0 to go back to the real frame time
+    void SetFixedDeltaTime( float seconds );
+
     std::chrono::high_resolution_clock::time_point GetTimePoint();
     // Returns the number of milliseconds elapsed since the given point in time
     double GetDuration( const std::chrono::high_resolution_clock::time_point& point );
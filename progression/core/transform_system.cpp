@@ -0,0 +1,186 @@
+#include "core/transform_system.hpp"
+#include "core/assert.hpp"
+#include "core/jobs.hpp"
+#include "core/scene.hpp"
+#include "components/entity_metadata.hpp"
+#include "components/transform.hpp"
+#include <algorithm>
+#include <vector>
+
+#define MAX_HIERARCHY_DEPTH 256
+
+namespace Progression
+{
+
+struct HierarchyNode
+{
+    entt::entity entity;
+    entt::entity parent; // entt::null if the entity has no parent with a transform
+};
+
+// Kept in the registry's context, so every scene has its own and switching scenes can't reuse a stale order
+struct TransformHierarchy
+{
+    // Every entity with a WorldTransform, sorted by depth
+    std::vector< HierarchyNode > updateOrder;
+    // updateOrder index of the first entity at each depth, plus one past the end
+    std::vector< uint32_t > levelStarts;
+    bool changed = true;
+};
+
+static TransformHierarchy& GetHierarchy( entt::registry& registry )
+{
+    TransformHierarchy* hierarchy = registry.try_ctx< TransformHierarchy >();
+    return hierarchy ? *hierarchy : registry.set< TransformHierarchy >();
+}
+
+// A registry without a hierarchy yet builds one from scratch anyway
+static void MarkHierarchyChanged( entt::registry& registry )
+{
+    if ( TransformHierarchy* hierarchy = registry.try_ctx< TransformHierarchy >() )
+    {
+        hierarchy->changed = true;
+    }
+}
+
+static entt::entity GetTransformParent( entt::registry& registry, entt::entity entity )
+{
+    const EntityMetaData* metaData = registry.try_get< EntityMetaData >( entity );
+    if ( !metaData || metaData->parent == entt::null || !registry.valid( metaData->parent ) || !registry.has< WorldTransform >( metaData->parent ) )
+    {
+        return entt::null;
+    }
+
+    return metaData->parent;
+}
+
+static void RebuildUpdateOrder( entt::registry& registry, TransformHierarchy& hierarchy )
+{
+    std::vector< HierarchyNode >& updateOrder = hierarchy.updateOrder;
+    updateOrder.clear();
+    registry.view< WorldTransform >().each( [&]( const entt::entity e, WorldTransform& world )
+    {
+        uint32_t depth      = 0;
+        entt::entity parent = GetTransformParent( registry, e );
+        for ( entt::entity ancestor = parent; ancestor != entt::null; ancestor = GetTransformParent( registry, ancestor ) )
+        {
+            ++depth;
+            PG_ASSERT( depth < MAX_HIERARCHY_DEPTH, "Entity hierarchy is too deep, or has a cycle" );
+        }
+
+        world.depth            = depth;
+        world.updatedThisFrame = true;
+        updateOrder.push_back( { e, parent } );
+        registry.get< Transform >( e ).MarkDirty();
+    });
+
+    std::sort( updateOrder.begin(), updateOrder.end(), [&]( const HierarchyNode& lhs, const HierarchyNode& rhs )
+    {
+        return registry.get< WorldTransform >( lhs.entity ).depth < registry.get< WorldTransform >( rhs.entity ).depth;
+    });
+
+    std::vector< uint32_t >& levelStarts = hierarchy.levelStarts;
+    levelStarts.clear();
+    for ( uint32_t i = 0; i < static_cast< uint32_t >( updateOrder.size() ); ++i )
+    {
+        uint32_t depth = registry.get< WorldTransform >( updateOrder[i].entity ).depth;
+        while ( levelStarts.size() <= depth )
+        {
+            levelStarts.push_back( i );
+        }
+    }
+    levelStarts.push_back( static_cast< uint32_t >( updateOrder.size() ) );
+    hierarchy.changed = false;
+}
+
+namespace TransformSystem
+{
+
+void SyncHierarchy( Scene* scene )
+{
+    entt::registry& registry = scene->registry;
+
+    // Keep the WorldTransforms in sync with the Transforms, since entities can be created and
+    // changed at any point (by scripts, the scene file, etc)
+    std::vector< entt::entity > changed;
+    registry.view< Transform >( entt::exclude< WorldTransform > ).each( [&]( const entt::entity e, Transform& )
+    {
+        changed.push_back( e );
+    });
+    for ( entt::entity e : changed )
+    {
+        registry.assign< WorldTransform >( e );
+    }
+    changed.clear();
+    registry.view< WorldTransform >( entt::exclude< Transform > ).each( [&]( const entt::entity e, WorldTransform& )
+    {
+        changed.push_back( e );
+    });
+    for ( entt::entity e : changed )
+    {
+        registry.remove< WorldTransform >( e );
+    }
+
+    TransformHierarchy& hierarchy = GetHierarchy( registry );
+    if ( hierarchy.changed || hierarchy.updateOrder.size() != registry.size< WorldTransform >() )
+    {
+        RebuildUpdateOrder( registry, hierarchy );
+    }
+}
+
+void Update( Scene* scene )
+{
+    entt::registry& registry                   = scene->registry;
+    const TransformHierarchy& hierarchy        = GetHierarchy( registry );
+    const std::vector< uint32_t >& levelStarts = hierarchy.levelStarts;
+
+    // Entities at the same depth never depend on each other, so each level is split across the job system
+    for ( size_t level = 0; level + 1 < levelStarts.size(); ++level )
+    {
+        uint32_t levelStart = levelStarts[level];
+        uint32_t levelSize  = levelStarts[level + 1] - levelStart;
+        Jobs::ParallelFor( levelSize, 256, [&]( uint32_t begin, uint32_t end )
+        {
+            for ( uint32_t i = levelStart + begin; i < levelStart + end; ++i )
+            {
+                const HierarchyNode& node = hierarchy.updateOrder[i];
+                Transform& local          = registry.get< Transform >( node.entity );
+                WorldTransform& world     = registry.get< WorldTransform >( node.entity );
+                const WorldTransform* parentWorld = node.parent == entt::null ? nullptr : &registry.get< WorldTransform >( node.parent );
+
+                world.updatedThisFrame = local.IsDirty() || ( parentWorld && parentWorld->updatedThisFrame );
+                if ( !world.updatedThisFrame )
+                {
+                    continue;
+                }
+
+                world.M = local.GetModelMatrix();
+                if ( parentWorld )
+                {
+                    world.M = parentWorld->M * world.M;
+                }
+                world.N = glm::transpose( glm::inverse( world.M ) );
+                local.ClearDirty();
+            }
+        });
+    }
+}
+
+void SetParent( entt::registry& registry, entt::entity child, entt::entity parent )
+{
+    EntityMetaData* metaData = registry.try_get< EntityMetaData >( child );
+    if ( !metaData )
+    {
+        metaData = &registry.assign< EntityMetaData >( child );
+    }
+    metaData->parent = parent;
+    MarkHierarchyChanged( registry );
+}
+
+void OnHierarchyChange( entt::entity entity, entt::registry& registry )
+{
+    MarkHierarchyChanged( registry );
+}
+
+} // namespace TransformSystem
+} // namespace Progression
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "core/ecs.hpp"
+
+namespace Progression
+{
+
+class Scene;
+
+// Propagates the local Transforms down the EntityMetaData::parent hierarchy into each entity's
+// WorldTransform. Entities are processed in order of depth so parents are always finished before
+// their children, and an entity is only recomputed if its Transform or one of its ancestors
+// changed this frame. Static entities are therefore only computed once. The update order is kept
+// per registry, so each scene has its own.
+namespace TransformSystem
+{
+
+    // Creates and removes WorldTransform components to match the Transforms, and rebuilds the
+    // update order if the hierarchy changed. Must run before Update, and not concurrently with any
+    // other system since it changes the registry's structure
+    void SyncHierarchy( Scene* scene );
+
+    void Update( Scene* scene );
+
+    // Use instead of writing to EntityMetaData::parent directly, so the update order gets rebuilt
+    void SetParent( entt::registry& registry, entt::entity child, entt::entity parent );
+
+    void OnHierarchyChange( entt::entity entity, entt::registry& registry );
+
+} // namespace TransformSystem
+} // namespace Progression
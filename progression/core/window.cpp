@@ -1,7 +1,10 @@
 #include "core/window.hpp"
+#include "core/cpu_profiling.hpp"
 #include "core/lua.hpp"
+#include "core/memory_manager.hpp"
 #include "core/time.hpp"
 #include "utils/logger.hpp"
+#include <cstdio>
 #include <unordered_set>
 
 static std::unordered_set< size_t > s_debugMessages;
@@ -91,12 +94,14 @@ void Window::StartFrame()
 void Window::EndFrame()
 {
     Time::EndFrame();
+    CpuProfile::EndFrame();
+    MemoryManager::EndFrame();
     ++s_framesDrawnSinceLastFPSUpdate;
     if ( Time::GetDuration( s_lastFPSUpdateTime ) > 1000.0f )
     {
-        std::string titleWithFps =
-          m_title + " -- FPS: " + std::to_string( s_framesDrawnSinceLastFPSUpdate );
-        glfwSetWindowTitle( m_window, titleWithFps.c_str() );
+        char titleWithFps[256];
+        snprintf( titleWithFps, sizeof( titleWithFps ), "%s -- FPS: %u", m_title.c_str(), s_framesDrawnSinceLastFPSUpdate );
+        glfwSetWindowTitle( m_window, titleWithFps );
         s_framesDrawnSinceLastFPSUpdate = 0;
         s_lastFPSUpdateTime             = Time::GetTimePoint();
     }
@@ -51,7 +51,7 @@ namespace DebugMarker
         // the RenderDoc terminal doesn't support outputting colors
         if ( s_active )
         {
-            g_Logger.GetLocation( "stdout" )->colored = false;
+            g_Logger.SetLocationColored( "stdout", false );
         }
 	}
 
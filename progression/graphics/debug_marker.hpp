@@ -32,6 +32,16 @@ namespace DebugMarker
 	// Insert a new debug marker into the command buffer
 	void Insert( VkCommandBuffer cmdbuffer, const char* name, glm::vec4 color = glm::vec4( 0 ) );
 
+    inline void BeginRegion( VkCommandBuffer cmdbuffer, const std::string& name, glm::vec4 color = glm::vec4( 0 ) )
+    {
+        BeginRegion( cmdbuffer, name.c_str(), color );
+    }
+
+    inline void Insert( VkCommandBuffer cmdbuffer, const std::string& name, glm::vec4 color = glm::vec4( 0 ) )
+    {
+        Insert( cmdbuffer, name.c_str(), color );
+    }
+
 	// End the current debug marker region
 	void EndRegion( VkCommandBuffer cmdBuffer );
 
@@ -67,20 +77,20 @@ namespace DebugMarker
 #if !USING( SHIP_BUILD )
 
 #define PG_DEBUG_MARKER_NAME( x, y ) ( std::string( x ) + y ).c_str()
-#define PG_DEBUG_MARKER_IF_STR_NOT_EMPTY( s, x ) if ( !s.empty() ) { x; }
+#define PG_DEBUG_MARKER_IF_STR_NOT_EMPTY( s, x ) do { if ( !s.empty() ) { x; } } while ( 0 )
 
-#define PG_DEBUG_MARKER_BEGIN_REGION( cmdbuf, name, color ) Progression::Gfx::DebugMarker::BeginRegion( cmdbuf.GetHandle(), PG_DEBUG_MARKER_NAME( "", name ), color );
-#define PG_DEBUG_MARKER_END_REGION( cmdbuf )                Progression::Gfx::DebugMarker::EndRegion( cmdbuf.GetHandle() );
-#define PG_DEBUG_MARKER_INSERT( cmdbuf, name, color )       Progression::Gfx::DebugMarker::Insert( cmdbuf.GetHandle(), PG_DEBUG_MARKER_NAME( "", name ), color );
+// Recorded every frame, so the name (often built from strings per draw) is only evaluated when a debugger is attached
+#define PG_DEBUG_MARKER_BEGIN_REGION( cmdbuf, name, color ) do { if ( Progression::Gfx::DebugMarker::IsActive() ) { Progression::Gfx::DebugMarker::BeginRegion( cmdbuf.GetHandle(), name, color ); } } while ( 0 )
+#define PG_DEBUG_MARKER_END_REGION( cmdbuf )                do { if ( Progression::Gfx::DebugMarker::IsActive() ) { Progression::Gfx::DebugMarker::EndRegion( cmdbuf.GetHandle() ); } } while ( 0 )
+#define PG_DEBUG_MARKER_INSERT( cmdbuf, name, color )       do { if ( Progression::Gfx::DebugMarker::IsActive() ) { Progression::Gfx::DebugMarker::Insert( cmdbuf.GetHandle(), name, color ); } } while ( 0 )
 
+// Memory is suballocated out of shared blocks, so only the resource itself gets named
 #define PG_DEBUG_MARKER_SET_BUFFER_NAME( buffer, name ) \
-    Progression::Gfx::DebugMarker::SetBufferName( Progression::Gfx::g_renderState.device.GetHandle(), (buffer).GetHandle(), PG_DEBUG_MARKER_NAME( "Buffer: ", name ) ); \
-    Progression::Gfx::DebugMarker::SetDeviceMemoryName( Progression::Gfx::g_renderState.device.GetHandle(), (buffer).GetMemoryHandle(), PG_DEBUG_MARKER_NAME( "Memory: buffer ", name ) )
+    Progression::Gfx::DebugMarker::SetBufferName( Progression::Gfx::g_renderState.device.GetHandle(), (buffer).GetHandle(), PG_DEBUG_MARKER_NAME( "Buffer: ", name ) )
 
 #define PG_DEBUG_MARKER_SET_IMAGE_NAME( image, name ) \
     Progression::Gfx::DebugMarker::SetImageName( Progression::Gfx::g_renderState.device.GetHandle(), image.GetHandle(), PG_DEBUG_MARKER_NAME( "Image: ", name ) ); \
-    Progression::Gfx::DebugMarker::SetImageViewName( Progression::Gfx::g_renderState.device.GetHandle(), image.GetView(), PG_DEBUG_MARKER_NAME( "Image View: ", name ) ); \
-    Progression::Gfx::DebugMarker::SetDeviceMemoryName( Progression::Gfx::g_renderState.device.GetHandle(), image.GetMemoryHandle(), PG_DEBUG_MARKER_NAME( "Memory: image ", name ) )
+    Progression::Gfx::DebugMarker::SetImageViewName( Progression::Gfx::g_renderState.device.GetHandle(), image.GetView(), PG_DEBUG_MARKER_NAME( "Image View: ", name ) )
 
 #define PG_DEBUG_MARKER_SET_PIPELINE_NAME( pipeline, name ) \
     Progression::Gfx::DebugMarker::SetPipelineName( Progression::Gfx::g_renderState.device.GetHandle(), pipeline.GetHandle(), PG_DEBUG_MARKER_NAME( "Pipeline: ", name ) ); \
@@ -1,6 +1,7 @@
 #include "graphics/graphics_api/buffer.hpp"
 #include "core/assert.hpp"
 #include "core/core_defines.hpp"
+#include "graphics/vulkan.hpp"
 
 namespace Progression
 {
@@ -24,34 +25,43 @@ namespace Gfx
     {
         PG_ASSERT( m_handle != VK_NULL_HANDLE );
         vkDestroyBuffer( m_device, m_handle, nullptr );
-        vkFreeMemory( m_device, m_memory, nullptr );
+        g_renderState.device.FreeMemory( m_allocation );
+        MemoryManager::TrackFree( MemoryManager::MemoryHeap::GPU, m_memoryTag, m_allocatedSize );
         m_handle = VK_NULL_HANDLE;
     }
 
+    // Host visible blocks stay mapped for their whole lifetime, so these only hand out the pointer
     void Buffer::Map()
     {
-        vkMapMemory( m_device, m_memory, 0, VK_WHOLE_SIZE, 0, &m_mappedPtr );
+        PG_ASSERT( m_allocation.mappedPtr, "Mapping a buffer that isn't host visible" );
+        m_mappedPtr = m_allocation.mappedPtr;
     }
 
     void Buffer::UnMap()
     {
-        vkUnmapMemory( m_device, m_memory );
         m_mappedPtr = nullptr;
     }
 
     void Buffer::BindMemory( size_t offset ) const
     {
         PG_ASSERT( m_handle != VK_NULL_HANDLE && m_memory != VK_NULL_HANDLE );
-        vkBindBufferMemory( m_device, m_handle, m_memory, offset );
+        vkBindBufferMemory( m_device, m_handle, m_memory, m_allocation.offset + offset );
     }
 
     bool Buffer::Flush( size_t size, size_t offset )
     {
+        // VK_WHOLE_SIZE would flush the rest of the block. Allocations are padded to nonCoherentAtomSize,
+        // so rounding up never touches a neighbor
+        VkDeviceSize atomSize = g_renderState.physicalDeviceInfo.deviceProperties.limits.nonCoherentAtomSize;
+        if ( size == VK_WHOLE_SIZE )
+        {
+            size = m_allocation.size - offset;
+        }
         VkMappedMemoryRange mappedRange = {};
 		mappedRange.sType  = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
 		mappedRange.memory = m_memory;
-		mappedRange.offset = offset;
-		mappedRange.size   = size;
+		mappedRange.offset = m_allocation.offset + offset;
+		mappedRange.size   = ( size + atomSize - 1 ) / atomSize * atomSize;
 		return vkFlushMappedMemoryRanges( m_device, 1, &mappedRange ) == VK_SUCCESS;
     }
 
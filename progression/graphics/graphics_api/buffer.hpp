@@ -1,5 +1,7 @@
 #pragma once
 
+#include "core/memory_manager.hpp"
+#include "graphics/graphics_api/device_memory.hpp"
 #include <vulkan/vulkan.h>
 
 namespace Progression
@@ -132,8 +134,12 @@ namespace Gfx
         void* m_mappedPtr       = nullptr;
         size_t m_length         = 0; // in bytes
         VkBuffer m_handle       = VK_NULL_HANDLE;
-        VkDeviceMemory m_memory = VK_NULL_HANDLE;
+        VkDeviceMemory m_memory = VK_NULL_HANDLE; // the block the buffer lives in, shared with other resources
         VkDevice m_device       = VK_NULL_HANDLE;
+        DeviceAllocation m_allocation;
+        // What was actually allocated, which can be more than m_length
+        size_t m_allocatedSize  = 0;
+        MemoryManager::MemoryTag m_memoryTag = MemoryManager::MemoryTag::General;
     };
 
 } // namespace Gfx
@@ -1,9 +1,11 @@
 #include "graphics/graphics_api/command_buffer.hpp"
 #include "core/assert.hpp"
+#include "core/memory_manager.hpp"
 #include "graphics/debug_marker.hpp"
 #include "graphics/graphics_api/descriptor.hpp"
 #include "graphics/pg_to_vulkan_types.hpp"
 #include "graphics/vulkan.hpp"
+#include <algorithm>
 
 namespace Progression
 {
@@ -37,12 +39,28 @@ namespace Gfx
         return vkBeginCommandBuffer( m_handle, &beginInfo ) == VK_SUCCESS;
     }
 
+    bool CommandBuffer::BeginRecording( const RenderPass& renderPass, const Framebuffer& framebuffer, CommandBufferUsage flags ) const
+    {
+        PG_ASSERT( m_handle != VK_NULL_HANDLE );
+        VkCommandBufferInheritanceInfo inheritanceInfo = {};
+        inheritanceInfo.sType       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+        inheritanceInfo.renderPass  = renderPass.GetHandle();
+        inheritanceInfo.subpass     = 0;
+        inheritanceInfo.framebuffer = framebuffer.GetHandle();
+
+        VkCommandBufferBeginInfo beginInfo = {};
+        beginInfo.sType            = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags            = PGToVulkanCommandBufferUsage( flags ) | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+        beginInfo.pInheritanceInfo = &inheritanceInfo;
+        return vkBeginCommandBuffer( m_handle, &beginInfo ) == VK_SUCCESS;
+    }
+
     bool CommandBuffer::EndRecording() const
     {
         return vkEndCommandBuffer( m_handle ) == VK_SUCCESS;
     }
 
-    void CommandBuffer::BeginRenderPass( const RenderPass& renderPass, const Framebuffer& framebuffer, const VkExtent2D& extent ) const
+    void CommandBuffer::BeginRenderPass( const RenderPass& renderPass, const Framebuffer& framebuffer, const VkExtent2D& extent, bool secondaryContents ) const
     {
         VkRenderPassBeginInfo renderPassInfo = {};
         renderPassInfo.sType             = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
@@ -68,7 +86,7 @@ namespace Gfx
         renderPassInfo.clearValueCount = static_cast< uint32_t >( i );
         renderPassInfo.pClearValues    = clearValues;
 
-        vkCmdBeginRenderPass( m_handle, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE );
+        vkCmdBeginRenderPass( m_handle, &renderPassInfo, secondaryContents ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE );
     }
 
     void CommandBuffer::EndRenderPass() const
@@ -76,14 +94,35 @@ namespace Gfx
         vkCmdEndRenderPass( m_handle );
     }
 
+    void CommandBuffer::ExecuteCommandBuffers( uint32_t numBuffers, const CommandBuffer* cmdBufs ) const
+    {
+        if ( numBuffers == 0 )
+        {
+            return;
+        }
+        MemoryManager::ScratchScope scratch;
+        VkCommandBuffer* handles = scratch.Allocate< VkCommandBuffer >( numBuffers );
+        for ( uint32_t i = 0; i < numBuffers; ++i )
+        {
+            handles[i] = cmdBufs[i].GetHandle();
+        }
+
+        vkCmdExecuteCommands( m_handle, numBuffers, handles );
+    }
+
     void CommandBuffer::BindRenderPipeline( const Pipeline& pipeline ) const
     {
         vkCmdBindPipeline( m_handle, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.GetHandle() );
     }
 
+    void CommandBuffer::BindComputePipeline( const Pipeline& pipeline ) const
+    {
+        vkCmdBindPipeline( m_handle, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline.GetHandle() );
+    }
+
     void CommandBuffer::BindDescriptorSets( uint32_t numSets, DescriptorSet* sets, const Pipeline& pipeline, uint32_t firstSet ) const
     {
-        vkCmdBindDescriptorSets( m_handle, VK_PIPELINE_BIND_POINT_GRAPHICS,
+        vkCmdBindDescriptorSets( m_handle, pipeline.GetPipelineBindPoint(),
                                  pipeline.GetLayoutHandle(), firstSet, numSets, (VkDescriptorSet*) sets, 0, nullptr );
     }
 
@@ -95,13 +134,14 @@ namespace Gfx
 
     void CommandBuffer::BindVertexBuffers( uint32_t numBuffers, const Buffer* buffers, size_t* offsets, uint32_t firstBinding ) const
     {
-        std::vector< VkBuffer > vertexBuffers( numBuffers );
+        MemoryManager::ScratchScope scratch;
+        VkBuffer* vertexBuffers = scratch.Allocate< VkBuffer >( numBuffers );
         for ( uint32_t i = 0; i < numBuffers; ++i )
         {
             vertexBuffers[i] = buffers[i].GetHandle();
         }
 
-        vkCmdBindVertexBuffers( m_handle, firstBinding, numBuffers, vertexBuffers.data(), offsets );
+        vkCmdBindVertexBuffers( m_handle, firstBinding, numBuffers, vertexBuffers, offsets );
     }
 
     void CommandBuffer::BindIndexBuffer( const Buffer& buffer, IndexType indexType, size_t offset ) const
@@ -115,6 +155,19 @@ namespace Gfx
         vkCmdPipelineBarrier( m_handle, srcStage, dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier );
     }
 
+    void CommandBuffer::PipelineBarrier( VkPipelineStageFlags srcStage, VkPipelineStageFlags dstStage,
+                                         const VkBufferMemoryBarrier& barrier ) const
+    {
+        vkCmdPipelineBarrier( m_handle, srcStage, dstStage, 0, 0, nullptr, 1, &barrier, 0, nullptr );
+    }
+
+    void CommandBuffer::PipelineBarrier( VkPipelineStageFlags srcStage, VkPipelineStageFlags dstStage,
+                                         uint32_t numBufferBarriers, const VkBufferMemoryBarrier* bufferBarriers,
+                                         uint32_t numImageBarriers, const VkImageMemoryBarrier* imageBarriers ) const
+    {
+        vkCmdPipelineBarrier( m_handle, srcStage, dstStage, 0, 0, nullptr, numBufferBarriers, bufferBarriers, numImageBarriers, imageBarriers );
+    }
+
     void CommandBuffer::SetViewport( const Viewport& viewport ) const
     {
         VkViewport v;
@@ -142,6 +195,20 @@ namespace Gfx
         vkCmdSetDepthBias( m_handle, constant, clamp, slope );
     }
 
+    void CommandBuffer::ClearDepthAttachment( const Scissor& rect, float depth ) const
+    {
+        VkClearAttachment attachment       = {};
+        attachment.aspectMask              = VK_IMAGE_ASPECT_DEPTH_BIT;
+        attachment.clearValue.depthStencil = { depth, 0 };
+
+        VkClearRect clearRect    = {};
+        clearRect.rect.offset    = { rect.x, rect.y };
+        clearRect.rect.extent    = { static_cast< uint32_t >( rect.width ), static_cast< uint32_t >( rect.height ) };
+        clearRect.baseArrayLayer = 0;
+        clearRect.layerCount     = 1;
+        vkCmdClearAttachments( m_handle, 1, &attachment, 1, &clearRect );
+    }
+
     void CommandBuffer::PushConstants( const Pipeline& pipeline, VkShaderStageFlags stageFlags, uint32_t offset, uint32_t size, void* data ) const
     {
         vkCmdPushConstants( m_handle, pipeline.GetLayoutHandle(), stageFlags, offset, size, data );
@@ -153,6 +220,82 @@ namespace Gfx
         copyRegion.size = src.GetLength();
         vkCmdCopyBuffer( m_handle, src.GetHandle(), dst.GetHandle(), 1, &copyRegion );
     }
+
+    void CommandBuffer::Copy( const Buffer& dst, const Buffer& src, size_t size, size_t srcOffset, size_t dstOffset ) const
+    {
+        VkBufferCopy copyRegion = {};
+        copyRegion.srcOffset    = srcOffset;
+        copyRegion.dstOffset    = dstOffset;
+        copyRegion.size         = size;
+        vkCmdCopyBuffer( m_handle, src.GetHandle(), dst.GetHandle(), 1, &copyRegion );
+    }
+
+    void CommandBuffer::CopyBufferToImage( const Buffer& buffer, const Texture& tex, bool copyAllMips, size_t bufferOffset ) const
+    {
+        uint32_t numMips = tex.GetMipLevels();
+        if ( !copyAllMips )
+        {
+            numMips = 1;
+        }
+        MemoryManager::ScratchScope scratch;
+        VkBufferImageCopy* bufferCopyRegions = scratch.Allocate< VkBufferImageCopy >( tex.GetArrayLayers() * numMips );
+        uint32_t numRegions = 0;
+        size_t offset       = bufferOffset;
+        for ( uint32_t face = 0; face < tex.GetArrayLayers(); ++face )
+        {
+            uint32_t width  = tex.GetWidth();
+            uint32_t height = tex.GetHeight();
+            for ( uint32_t mip = 0; mip < numMips; ++mip )
+            {
+                VkBufferImageCopy& region              = bufferCopyRegions[numRegions++];
+                region                                 = {};
+                region.bufferOffset                    = offset;
+                region.imageSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+                region.imageSubresource.mipLevel       = mip;
+                region.imageSubresource.baseArrayLayer = face;
+                region.imageSubresource.layerCount     = 1;
+                region.imageExtent.width               = width;
+                region.imageExtent.height              = height;
+                region.imageExtent.depth               = tex.GetDepth();
+
+                uint32_t size = SizeOfPixelFromat( tex.GetPixelFormat() );
+                if ( PixelFormatIsCompressed( tex.GetPixelFormat() ) )
+                {
+                    uint32_t roundedWidth  = ( width  + 3 ) & ~3;
+                    uint32_t roundedHeight = ( height + 3 ) & ~3;
+                    uint32_t numBlocksX    = roundedWidth  / 4;
+                    uint32_t numBlocksY    = roundedHeight / 4;
+                    size                  *= numBlocksX * numBlocksY;
+                }
+                else
+                {
+                    size *= width * height;
+                }
+                offset += size;
+
+                width  = std::max( width  >> 1, 1u );
+                height = std::max( height >> 1, 1u );
+            }
+        }
+
+        vkCmdCopyBufferToImage( m_handle, buffer.GetHandle(), tex.GetHandle(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, numRegions, bufferCopyRegions );
+    }
+
+    void CommandBuffer::CopyImageToBuffer( const Texture& tex, const Buffer& buffer, size_t bufferOffset ) const
+    {
+        PG_ASSERT( !PixelFormatIsCompressed( tex.GetPixelFormat() ) );
+        VkBufferImageCopy region               = {};
+        region.bufferOffset                    = bufferOffset;
+        region.imageSubresource.aspectMask     = PixelFormatIsDepthFormat( tex.GetPixelFormat() ) ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.mipLevel       = 0;
+        region.imageSubresource.baseArrayLayer = 0;
+        region.imageSubresource.layerCount     = 1;
+        region.imageExtent.width               = tex.GetWidth();
+        region.imageExtent.height              = tex.GetHeight();
+        region.imageExtent.depth               = tex.GetDepth();
+
+        vkCmdCopyImageToBuffer( m_handle, tex.GetHandle(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, buffer.GetHandle(), 1, &region );
+    }
     
     void CommandBuffer::Draw( uint32_t firstVert, uint32_t vertCount, uint32_t instanceCount, uint32_t firstInstance ) const
     {
@@ -164,6 +307,11 @@ namespace Gfx
         vkCmdDrawIndexed( m_handle, indexCount, instanceCount, firstIndex, vertexOffset, firstInstance );
     }
 
+    void CommandBuffer::Dispatch( uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ ) const
+    {
+        vkCmdDispatch( m_handle, groupCountX, groupCountY, groupCountZ );
+    }
+
 
     void CommandPool::Free()
     {
@@ -174,18 +322,24 @@ namespace Gfx
         }
     }
 
+    void CommandPool::Reset()
+    {
+        PG_ASSERT( m_handle != VK_NULL_HANDLE );
+        vkResetCommandPool( m_device, m_handle, 0 );
+    }
+
     CommandPool::operator bool() const
     {
         return m_handle != VK_NULL_HANDLE;
     }
 
-    CommandBuffer CommandPool::NewCommandBuffer( const std::string& name )
+    CommandBuffer CommandPool::NewCommandBuffer( const std::string& name, CommandBufferLevel level )
     {
         PG_ASSERT( m_handle != VK_NULL_HANDLE );
         VkCommandBufferAllocateInfo allocInfo = {};
         allocInfo.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
         allocInfo.commandPool        = m_handle;
-        allocInfo.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.level              = level == CommandBufferLevel::PRIMARY ? VK_COMMAND_BUFFER_LEVEL_PRIMARY : VK_COMMAND_BUFFER_LEVEL_SECONDARY;
         allocInfo.commandBufferCount = 1;
     
         CommandBuffer buf;
@@ -29,27 +29,47 @@ namespace Gfx
 
         void Free();
         bool BeginRecording( CommandBufferUsage flags = 0 ) const;
+        // For secondary command buffers, which only record the draws inside of the given render pass. None
+        // of the state bound in the primary carries over, so they have to bind everything they use again
+        bool BeginRecording( const RenderPass& renderPass, const Framebuffer& framebuffer, CommandBufferUsage flags = 0 ) const;
         bool EndRecording() const;
-        void BeginRenderPass( const RenderPass& renderPass, const Framebuffer& framebuffer, const VkExtent2D& extent ) const;
+        // With secondaryContents, the render pass can only contain ExecuteCommandBuffers calls
+        void BeginRenderPass( const RenderPass& renderPass, const Framebuffer& framebuffer, const VkExtent2D& extent, bool secondaryContents = false ) const;
         void EndRenderPass() const;
+        void ExecuteCommandBuffers( uint32_t numBuffers, const CommandBuffer* cmdBufs ) const;
         void BindRenderPipeline( const Pipeline& pipeline ) const;
+        void BindComputePipeline( const Pipeline& pipeline ) const;
         void BindDescriptorSets( uint32_t numSets, DescriptorSet* sets, const Pipeline& pipeline, uint32_t firstSet = 0 ) const;
         void BindVertexBuffer( const Buffer& buffer, size_t offset = 0, uint32_t firstBinding = 0 ) const;
         void BindVertexBuffers( uint32_t numBuffers, const Buffer* buffers, size_t* offsets, uint32_t firstBinding = 0 ) const;
         void BindIndexBuffer( const Buffer& buffer, IndexType indexType, size_t offset = 0 ) const;
         void PipelineBarrier( VkPipelineStageFlags srcStage, VkPipelineStageFlags dstStage,
                               const VkImageMemoryBarrier& barrier ) const;
+        void PipelineBarrier( VkPipelineStageFlags srcStage, VkPipelineStageFlags dstStage,
+                              const VkBufferMemoryBarrier& barrier ) const;
+        void PipelineBarrier( VkPipelineStageFlags srcStage, VkPipelineStageFlags dstStage,
+                              uint32_t numBufferBarriers, const VkBufferMemoryBarrier* bufferBarriers,
+                              uint32_t numImageBarriers, const VkImageMemoryBarrier* imageBarriers ) const;
         void SetViewport( const Viewport& viewport ) const;
         void SetScissor( const Scissor& scissor ) const;
         void SetDepthBias( float constant, float clamp, float slope ) const;
+        // Clears part of the current subpass's depth attachment, so it has to be inside of a render pass
+        void ClearDepthAttachment( const Scissor& rect, float depth = 1.0f ) const;
         
         void PushConstants( const Pipeline& pipeline, VkShaderStageFlags stageFlags, uint32_t offset, uint32_t size, void* data ) const;
 
         void Copy( const Buffer& dst, const Buffer& src ) const;
+        void Copy( const Buffer& dst, const Buffer& src, size_t size, size_t srcOffset, size_t dstOffset = 0 ) const;
+        // The buffer holds every face and mip tightly packed, face by face. The texture has to be in TRANSFER_DST_OPTIMAL
+        void CopyBufferToImage( const Buffer& buffer, const Texture& tex, bool copyAllMips = true, size_t bufferOffset = 0 ) const;
+        // Only the first mip of the first layer, tightly packed. The texture has to be in TRANSFER_SRC_OPTIMAL
+        void CopyImageToBuffer( const Texture& tex, const Buffer& buffer, size_t bufferOffset = 0 ) const;
 
         void Draw( uint32_t firstVert, uint32_t vertCount, uint32_t instanceCount = 1, uint32_t firstInstance = 0 ) const;
         void DrawIndexed( uint32_t firstIndex, uint32_t indexCount, int vertexOffset = 0, uint32_t firstInstance = 0, uint32_t instanceCount = 1 ) const;
 
+        void Dispatch( uint32_t groupCountX, uint32_t groupCountY = 1, uint32_t groupCountZ = 1 ) const;
+
     private:
         VkDevice m_device        = VK_NULL_HANDLE;
         VkCommandPool m_pool     = VK_NULL_HANDLE;
@@ -65,11 +85,18 @@ namespace Gfx
     enum class CommandPoolQueueFamily
     {
         GRAPHICS,
-        COMPUTE
+        COMPUTE,
+        TRANSFER
     };
 
     typedef uint32_t CommandPoolCreateFlags;
 
+    enum class CommandBufferLevel
+    {
+        PRIMARY,
+        SECONDARY
+    };
+
     class CommandPool
     {
         friend class Device;
@@ -77,7 +104,9 @@ namespace Gfx
         CommandPool() = default;
 
         void Free();
-        CommandBuffer NewCommandBuffer( const std::string& name = "" );
+        // Puts every command buffer allocated from the pool back into the initial state at once
+        void Reset();
+        CommandBuffer NewCommandBuffer( const std::string& name = "", CommandBufferLevel level = CommandBufferLevel::PRIMARY );
         operator bool() const;
         VkCommandPool GetHandle() const;
 
@@ -1,10 +1,14 @@
 #include "graphics/graphics_api/device.hpp"
 #include "core/assert.hpp"
+#include "core/jobs.hpp"
 #include "core/platform_defines.hpp"
+#include "core/time.hpp"
 #include "graphics/debug_marker.hpp"
 #include "graphics/pg_to_vulkan_types.hpp"
+#include "graphics/pipeline_cache.hpp"
 #include "graphics/render_system.hpp"
 #include "graphics/texture_manager.hpp"
+#include "graphics/upload_manager.hpp"
 #include "graphics/vulkan.hpp"
 #include "utils/logger.hpp"
 #include <set>
@@ -18,12 +22,59 @@ namespace Progression
 namespace Gfx
 {
 
+    class VulkanMemoryBackend : public DeviceMemoryBackend
+    {
+    public:
+        uint64_t AllocateBlock( uint32_t memoryTypeIndex, uint64_t size, void** mappedPtr ) override
+        {
+            const auto& limits = g_renderState.physicalDeviceInfo.deviceProperties.limits;
+            if ( m_numBlocks + 1 > limits.maxMemoryAllocationCount )
+            {
+                LOG_ERR( "Hit maxMemoryAllocationCount (", limits.maxMemoryAllocationCount, ")" );
+                return 0;
+            }
+
+            VkMemoryAllocateInfo allocInfo = {};
+            allocInfo.sType                = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+            allocInfo.allocationSize       = size;
+            allocInfo.memoryTypeIndex      = memoryTypeIndex;
+            VkDeviceMemory memory;
+            if ( vkAllocateMemory( m_device, &allocInfo, nullptr, &memory ) != VK_SUCCESS )
+            {
+                return 0;
+            }
+            ++m_numBlocks;
+
+            *mappedPtr = nullptr;
+            if ( g_renderState.physicalDeviceInfo.memProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT )
+            {
+                vkMapMemory( m_device, memory, 0, VK_WHOLE_SIZE, 0, mappedPtr );
+            }
+            PG_DEBUG_MARKER_SET_MEMORY_NAME( memory, "block " + std::to_string( m_numBlocks ) + " type " + std::to_string( memoryTypeIndex ) );
+
+            return reinterpret_cast< uint64_t >( memory );
+        }
+
+        void FreeBlock( uint32_t /* memoryTypeIndex */, uint64_t memory ) override
+        {
+            // Freeing implicitly unmaps
+            vkFreeMemory( m_device, reinterpret_cast< VkDeviceMemory >( memory ), nullptr );
+            --m_numBlocks;
+        }
+
+        VkDevice m_device    = VK_NULL_HANDLE;
+        uint32_t m_numBlocks = 0;
+    };
+
+    static VulkanMemoryBackend s_memoryBackend;
+    static DeviceMemoryAllocator s_memoryAllocator;
+
     Device Device::CreateDefault()
     {
         Device device;
         const auto& indices                     = g_renderState.physicalDeviceInfo.indices;
         PG_ASSERT( indices.IsComplete() );
-        std::set< uint32_t> uniqueQueueFamilies = { indices.graphicsFamily, indices.presentFamily, indices.computeFamily };
+        std::set< uint32_t> uniqueQueueFamilies = { indices.graphicsFamily, indices.presentFamily, indices.computeFamily, indices.transferFamily };
 
         float queuePriority = 1.0f;
         std::vector< VkDeviceQueueCreateInfo > queueCreateInfos;
@@ -67,6 +118,13 @@ namespace Gfx
         vkGetDeviceQueue( device.m_handle, indices.graphicsFamily, 0, &device.m_graphicsQueue );
         vkGetDeviceQueue( device.m_handle, indices.presentFamily,  0, &device.m_presentQueue );
         vkGetDeviceQueue( device.m_handle, indices.computeFamily,  0, &device.m_computeQueue );
+        vkGetDeviceQueue( device.m_handle, indices.transferFamily, 0, &device.m_transferQueue );
+
+        // Every allocation starts on a nonCoherentAtomSize boundary, so host visible ones can be flushed on their own
+        const auto& limits = g_renderState.physicalDeviceInfo.deviceProperties.limits;
+        s_memoryBackend.m_device = device.m_handle;
+        s_memoryAllocator.Init( &s_memoryBackend, g_renderState.physicalDeviceInfo.memProperties.memoryTypeCount, limits.bufferImageGranularity,
+                                std::max< uint64_t >( 256, limits.nonCoherentAtomSize ) );
 
         return device;
     }
@@ -75,6 +133,7 @@ namespace Gfx
     {
         if ( m_handle != VK_NULL_HANDLE )
         {
+            s_memoryAllocator.Shutdown();
             vkDestroyDevice( m_handle, nullptr );
             m_handle = VK_NULL_HANDLE;
         }
@@ -91,6 +150,35 @@ namespace Gfx
         vkQueueSubmit( m_graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE );
     }
 
+    void Device::Submit( CommandPoolQueueFamily queue, const CommandBuffer& cmdBuf, const Semaphore* waitSemaphore, const Semaphore* signalSemaphore, const Fence* fence ) const
+    {
+        VkCommandBuffer vkCmdBuf           = cmdBuf.GetHandle();
+        VkSemaphore vkWaitSemaphore        = waitSemaphore ? waitSemaphore->GetHandle() : VK_NULL_HANDLE;
+        VkSemaphore vkSignalSemaphore      = signalSemaphore ? signalSemaphore->GetHandle() : VK_NULL_HANDLE;
+        VkPipelineStageFlags waitStage     = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+        VkSubmitInfo submitInfo            = {};
+        submitInfo.sType                   = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.waitSemaphoreCount      = waitSemaphore ? 1 : 0;
+        submitInfo.pWaitSemaphores         = &vkWaitSemaphore;
+        submitInfo.pWaitDstStageMask       = &waitStage;
+        submitInfo.commandBufferCount      = 1;
+        submitInfo.pCommandBuffers         = &vkCmdBuf;
+        submitInfo.signalSemaphoreCount    = signalSemaphore ? 1 : 0;
+        submitInfo.pSignalSemaphores       = &vkSignalSemaphore;
+
+        VkQueue vkQueue = m_graphicsQueue;
+        if ( queue == CommandPoolQueueFamily::COMPUTE )
+        {
+            vkQueue = m_computeQueue;
+        }
+        else if ( queue == CommandPoolQueueFamily::TRANSFER )
+        {
+            vkQueue = m_transferQueue;
+        }
+        VkResult ret = vkQueueSubmit( vkQueue, 1, &submitInfo, fence ? fence->GetHandle() : VK_NULL_HANDLE );
+        PG_ASSERT( ret == VK_SUCCESS );
+    }
+
     void Device::WaitForIdle() const
     {
         vkQueueWaitIdle( m_graphicsQueue );
@@ -106,6 +194,10 @@ namespace Gfx
         {
             poolInfo.queueFamilyIndex = g_renderState.physicalDeviceInfo.indices.computeFamily;
         }
+        else if ( family == CommandPoolQueueFamily::TRANSFER )
+        {
+            poolInfo.queueFamilyIndex = g_renderState.physicalDeviceInfo.indices.transferFamily;
+        }
 
         CommandPool cmdPool;
         cmdPool.m_device = m_handle;
@@ -220,15 +312,14 @@ namespace Gfx
         VkMemoryRequirements memRequirements;
         vkGetBufferMemoryRequirements( m_handle, buffer.m_handle, &memRequirements );
 
-        VkMemoryAllocateInfo allocInfo = {};
-        allocInfo.sType                = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize       = memRequirements.size;
-        VkMemoryPropertyFlags flags    = PGToVulkanMemoryType( memoryType );
-        allocInfo.memoryTypeIndex      = FindMemoryType( memRequirements.memoryTypeBits, flags );
-        ret = vkAllocateMemory( m_handle, &allocInfo, nullptr, &buffer.m_memory );
-        PG_ASSERT( ret == VK_SUCCESS );
+        buffer.m_allocation = AllocateMemory( memRequirements, PGToVulkanMemoryType( memoryType ), false );
+        PG_ASSERT( buffer.m_allocation.IsValid() );
+        buffer.m_memory        = reinterpret_cast< VkDeviceMemory >( buffer.m_allocation.memory );
+        buffer.m_allocatedSize = memRequirements.size;
+        buffer.m_memoryTag     = MemoryManager::GetCurrentMemoryTag();
+        MemoryManager::TrackAllocation( MemoryManager::MemoryHeap::GPU, buffer.m_memoryTag, buffer.m_allocatedSize );
 
-        vkBindBufferMemory( m_handle, buffer.m_handle, buffer.m_memory, 0 );
+        vkBindBufferMemory( m_handle, buffer.m_handle, buffer.m_memory, buffer.m_allocation.offset );
         PG_DEBUG_MARKER_IF_STR_NOT_EMPTY( name, PG_DEBUG_MARKER_SET_BUFFER_NAME( buffer, name ) );
 
         return buffer;
@@ -240,14 +331,9 @@ namespace Gfx
 
         if ( memoryType & MEMORY_TYPE_DEVICE_LOCAL )
         {
-            Buffer stagingBuffer = NewBuffer( length, BUFFER_TYPE_TRANSFER_SRC, MEMORY_TYPE_HOST_VISIBLE | MEMORY_TYPE_HOST_COHERENT );
-            stagingBuffer.Map();
-            memcpy( stagingBuffer.MappedPtr(), data, length );
-            stagingBuffer.UnMap();
-
+            // The copy is submitted with the next UploadManager::Flush
             dstBuffer = NewBuffer( length, type | BUFFER_TYPE_TRANSFER_DST, memoryType, name );
-            Copy( dstBuffer, stagingBuffer );
-            stagingBuffer.Free();
+            UploadManager::UploadBuffer( dstBuffer, data, length );
         }
         else if ( ( memoryType & MEMORY_TYPE_HOST_VISIBLE ) && ( memoryType & MEMORY_TYPE_HOST_COHERENT ) )
         {
@@ -266,7 +352,21 @@ namespace Gfx
 
     Texture Device::NewTexture( const ImageDescriptor& desc, bool managed, const std::string& name ) const
     {
-        bool isDepth = PixelFormatIsDepthFormat( desc.format );
+        VkMemoryRequirements memRequirements;
+        Texture tex = NewUnboundTexture( desc, memRequirements );
+
+        tex.m_allocation = AllocateMemory( memRequirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, true );
+        PG_ASSERT( tex.m_allocation.IsValid() );
+        tex.m_allocatedSize = memRequirements.size;
+        tex.m_memoryTag     = MemoryManager::GetCurrentMemoryTag();
+        MemoryManager::TrackAllocation( MemoryManager::MemoryHeap::GPU, tex.m_memoryTag, tex.m_allocatedSize );
+        BindTextureMemory( tex, reinterpret_cast< VkDeviceMemory >( tex.m_allocation.memory ), tex.m_allocation.offset, managed, name );
+
+        return tex;
+    }
+
+    Texture Device::NewUnboundTexture( const ImageDescriptor& desc, VkMemoryRequirements& requirements ) const
+    {
         VkImageCreateInfo imageInfo = {};
         imageInfo.sType         = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
         imageInfo.imageType     = PGToVulkanImageType( desc.type );
@@ -294,55 +394,39 @@ namespace Gfx
 
         VkResult res = vkCreateImage( m_handle, &imageInfo, nullptr, &tex.m_image );
         PG_ASSERT( res == VK_SUCCESS);
+        vkGetImageMemoryRequirements( m_handle, tex.m_image, &requirements );
 
-        VkMemoryRequirements memRequirements;
-        vkGetImageMemoryRequirements( m_handle, tex.m_image, &memRequirements );
+        return tex;
+    }
 
-        VkMemoryAllocateInfo allocInfo = {};
-        allocInfo.sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize  = memRequirements.size;
-        allocInfo.memoryTypeIndex = FindMemoryType( memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT );
-        res                       = vkAllocateMemory( m_handle, &allocInfo, nullptr, &tex.m_memory );
-        PG_ASSERT( res == VK_SUCCESS);
-        vkBindImageMemory( m_handle, tex.m_image, tex.m_memory, 0 );
+    void Device::BindTextureMemory( Texture& tex, VkDeviceMemory memory, VkDeviceSize offset, bool managed, const std::string& name ) const
+    {
+        PG_ASSERT( tex.m_image != VK_NULL_HANDLE && tex.m_imageView == VK_NULL_HANDLE );
+        tex.m_memory = memory;
+        vkBindImageMemory( m_handle, tex.m_image, tex.m_memory, offset );
 
+        bool isDepth = PixelFormatIsDepthFormat( tex.m_desc.format );
         VkFormatFeatureFlags features = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT;
         if ( isDepth )
         {
             features |= VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT;
         }
-        VkFormat vkFormat = PGToVulkanPixelFormat( desc.format );
+        VkFormat vkFormat = PGToVulkanPixelFormat( tex.m_desc.format );
         PG_ASSERT( FormatSupported( vkFormat, features ) );
-        tex.m_imageView = CreateImageView( tex.m_image, vkFormat, isDepth ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT, desc.mipLevels, desc.arrayLayers );
+        tex.m_imageView = CreateImageView( tex.m_image, vkFormat, isDepth ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT, tex.m_desc.mipLevels, tex.m_desc.arrayLayers );
         if ( managed )
         {
             tex.m_textureSlot = TextureManager::GetOpenSlot( &tex );
         }
         PG_DEBUG_MARKER_IF_STR_NOT_EMPTY( name, PG_DEBUG_MARKER_SET_IMAGE_NAME( tex, name ) );
-
-        return tex;
     }
 
     Texture Device::NewTextureFromBuffer( ImageDescriptor& desc, void* data, bool managed, const std::string& name ) const
     {
         desc.usage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
-        Texture tex          = NewTexture( desc, managed, name );
-        size_t imSize        = CalculateTotalTextureSize( desc );
-        Buffer stagingBuffer = NewBuffer( imSize, BUFFER_TYPE_TRANSFER_SRC, MEMORY_TYPE_HOST_VISIBLE | MEMORY_TYPE_HOST_COHERENT );
-        stagingBuffer.Map();
-        memcpy( stagingBuffer.MappedPtr(), data, imSize );
-        stagingBuffer.UnMap();
-
-        VkFormat vkFormat = PGToVulkanPixelFormat( desc.format );
-        PG_ASSERT( FormatSupported( vkFormat, VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT ) );
-        
-        TransitionImageLayout( tex.GetHandle(), vkFormat, VK_IMAGE_LAYOUT_UNDEFINED,
-                               VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, tex.m_desc.mipLevels, tex.m_desc.arrayLayers );
-        CopyBufferToImage( stagingBuffer, tex );
-        TransitionImageLayout( tex.GetHandle(), vkFormat, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, tex.m_desc.mipLevels, tex.m_desc.arrayLayers );
-
-        stagingBuffer.Free();
+        Texture tex = NewTexture( desc, managed, name );
+        PG_ASSERT( FormatSupported( PGToVulkanPixelFormat( desc.format ), VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT ) );
+        UploadManager::UploadTexture( tex, data );
 
         return tex;
     }
@@ -380,6 +464,7 @@ namespace Gfx
 
     Pipeline Device::NewPipeline( const PipelineDescriptor& desc, const std::string& name ) const
     {
+        auto startTime = Time::GetTimePoint();
         Pipeline p;
         p.m_desc   = desc;
         p.m_device = m_handle;
@@ -535,17 +620,78 @@ namespace Gfx
         pipelineInfo.pDynamicState       = &dynamicState;
         pipelineInfo.layout              = p.m_pipelineLayout;
         pipelineInfo.renderPass          = desc.renderPass->GetHandle();
-        pipelineInfo.renderPass          = desc.renderPass->GetHandle();
         pipelineInfo.subpass             = 0;
         pipelineInfo.basePipelineHandle  = VK_NULL_HANDLE;
 
-        if ( vkCreateGraphicsPipelines( m_handle, VK_NULL_HANDLE, 1,
+        if ( vkCreateGraphicsPipelines( m_handle, PipelineCache::GetHandle(), 1,
                                         &pipelineInfo, nullptr, &p.m_pipeline ) != VK_SUCCESS )
         {
             vkDestroyPipelineLayout( m_handle, p.m_pipelineLayout, nullptr );
             p.m_pipeline = VK_NULL_HANDLE;
+            return p;
+        }
+        PG_DEBUG_MARKER_IF_STR_NOT_EMPTY( name, PG_DEBUG_MARKER_SET_PIPELINE_NAME( p, name ) );
+        LOG( "Created pipeline '", name, "' in ", Time::GetDuration( startTime ), "ms" );
+
+        return p;
+    }
+
+    std::vector< Pipeline > Device::NewPipelines( const std::vector< PipelineDescriptor >& descs, const std::vector< std::string >& names ) const
+    {
+        PG_ASSERT( descs.size() == names.size() );
+        auto startTime = Time::GetTimePoint();
+        std::vector< Pipeline > pipelines( descs.size() );
+        Jobs::ParallelFor( static_cast< uint32_t >( descs.size() ), 1, [&]( uint32_t begin, uint32_t end )
+        {
+            for ( uint32_t i = begin; i < end; ++i )
+            {
+                pipelines[i] = NewPipeline( descs[i], names[i] );
+            }
+        });
+        LOG( "Created ", descs.size(), " pipelines in ", Time::GetDuration( startTime ), "ms" );
+
+        return pipelines;
+    }
+
+    Pipeline Device::NewComputePipeline( const ComputePipelineDescriptor& desc, const std::string& name ) const
+    {
+        PG_ASSERT( desc.shader && desc.shader->reflectInfo.stage == ShaderStage::COMPUTE );
+        auto startTime = Time::GetTimePoint();
+        Pipeline p;
+        p.m_device    = m_handle;
+        p.m_bindPoint = VK_PIPELINE_BIND_POINT_COMPUTE;
+
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        std::vector< VkDescriptorSetLayout > layouts( desc.descriptorSetLayouts.size() );
+        for ( size_t i = 0; i < layouts.size(); ++i )
+        {
+            layouts[i] = desc.descriptorSetLayouts[i].GetHandle();
+        }
+        pipelineLayoutInfo.setLayoutCount         = static_cast< uint32_t >( layouts.size() );
+        pipelineLayoutInfo.pSetLayouts            = layouts.data();
+        pipelineLayoutInfo.pushConstantRangeCount = static_cast< uint32_t >( desc.shader->reflectInfo.pushConstants.size() );
+        pipelineLayoutInfo.pPushConstantRanges    = desc.shader->reflectInfo.pushConstants.data();
+
+        if ( vkCreatePipelineLayout( m_handle, &pipelineLayoutInfo, nullptr, &p.m_pipelineLayout ) != VK_SUCCESS )
+        {
+            return p;
+        }
+
+        VkComputePipelineCreateInfo pipelineInfo = {};
+        pipelineInfo.sType              = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipelineInfo.stage              = desc.shader->GetVkPipelineShaderStageCreateInfo();
+        pipelineInfo.layout             = p.m_pipelineLayout;
+        pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+        if ( vkCreateComputePipelines( m_handle, PipelineCache::GetHandle(), 1, &pipelineInfo, nullptr, &p.m_pipeline ) != VK_SUCCESS )
+        {
+            vkDestroyPipelineLayout( m_handle, p.m_pipelineLayout, nullptr );
+            p.m_pipeline = VK_NULL_HANDLE;
+            return p;
         }
         PG_DEBUG_MARKER_IF_STR_NOT_EMPTY( name, PG_DEBUG_MARKER_SET_PIPELINE_NAME( p, name ) );
+        LOG( "Created compute pipeline '", name, "' in ", Time::GetDuration( startTime ), "ms" );
 
         return p;
     }
@@ -606,13 +752,18 @@ namespace Gfx
             attachments.push_back( depthAttachment );
         }
 
+        // The attachments are shared between frames, and with more than one frame in flight, the previous
+        // frame can still be sampling them or writing them when this pass starts
         VkSubpassDependency dependency = {};
         dependency.srcSubpass    = VK_SUBPASS_EXTERNAL;
         dependency.dstSubpass    = 0;
-        dependency.srcStageMask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-        dependency.srcAccessMask = 0;
-        dependency.dstStageMask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-        dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        dependency.srcStageMask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+                                   VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+        dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        dependency.dstStageMask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+                                   VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+                                   VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
 
         VkRenderPassCreateInfo renderPassInfo = {};
         renderPassInfo.sType           = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
@@ -632,7 +783,7 @@ namespace Gfx
         return pass;
     }
 
-    Framebuffer Device::NewFramebuffer( const std::vector< Texture* >& attachments, const RenderPass& renderPass, const std::string& name ) const
+    Framebuffer Device::NewFramebuffer( const std::vector< const Texture* >& attachments, const RenderPass& renderPass, const std::string& name ) const
     {
         PG_ASSERT( 0 < attachments.size() && attachments.size() <= 9 );
         VkImageView frameBufferAttachments[9];
@@ -675,83 +826,25 @@ namespace Gfx
         return ret;
     }
 
-    void Device::Copy( Buffer dst, Buffer src ) const
+    DeviceAllocation Device::AllocateMemory( const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, bool optimalImage ) const
     {
-        CommandBuffer cmdBuf = g_renderState.transientCommandPool.NewCommandBuffer();
-
-        cmdBuf.BeginRecording( COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT );
-        cmdBuf.Copy( dst, src );
-        cmdBuf.EndRecording();
-
-        Submit( cmdBuf );
-        WaitForIdle();
+        DeviceMemoryRequest request;
+        request.size            = requirements.size;
+        request.alignment       = requirements.alignment;
+        request.memoryTypeIndex = FindMemoryType( requirements.memoryTypeBits, properties );
+        request.optimalImage    = optimalImage;
 
-        cmdBuf.Free();
+        return s_memoryAllocator.Allocate( request );
     }
 
-    void Device::CopyBufferToImage( const Buffer& buffer, const Texture& tex, bool copyAllMips ) const
+    void Device::FreeMemory( const DeviceAllocation& allocation ) const
     {
-        CommandBuffer cmdBuf = g_renderState.transientCommandPool.NewCommandBuffer();
-        cmdBuf.BeginRecording( COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT );
-
-        std::vector< VkBufferImageCopy > bufferCopyRegions;
-		uint32_t offset = 0;
-
-        uint32_t numMips = tex.GetMipLevels();
-        if ( !copyAllMips )
-        {
-            numMips = 1;
-        }
-        for ( uint32_t face = 0; face < tex.GetArrayLayers(); ++face )
-        {
-            uint32_t width  = tex.GetWidth();
-            uint32_t height = tex.GetHeight();
-            for ( uint32_t mip = 0; mip < numMips; ++mip )
-            {
-                VkBufferImageCopy region               = {};
-                region.bufferOffset                    = offset;
-                region.imageSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
-                region.imageSubresource.mipLevel       = mip;
-                region.imageSubresource.baseArrayLayer = face;
-                region.imageSubresource.layerCount     = 1;
-                region.imageExtent.width               = width;
-                region.imageExtent.height              = height;
-                region.imageExtent.depth               = tex.GetDepth();
-
-                bufferCopyRegions.push_back( region );
-                uint32_t size = SizeOfPixelFromat( tex.GetPixelFormat() );
-                if ( PixelFormatIsCompressed( tex.GetPixelFormat() ) )
-                {
-                    uint32_t roundedWidth  = ( width  + 3 ) & ~3;
-                    uint32_t roundedHeight = ( height + 3 ) & ~3;
-                    uint32_t numBlocksX    = roundedWidth  / 4;
-                    uint32_t numBlocksY    = roundedHeight / 4;
-                    size                  *= numBlocksX * numBlocksY;
-                }
-                else
-                {
-                    size *= width * height;
-                }
-                offset += size;
-
-                width  = std::max( width  >> 1, 1u );
-                height = std::max( height >> 1, 1u );
-            }
-        }
-
-        vkCmdCopyBufferToImage(
-            cmdBuf.GetHandle(),
-            buffer.GetHandle(),
-            tex.GetHandle(),
-            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-            static_cast< uint32_t >( bufferCopyRegions.size() ),
-            bufferCopyRegions.data()
-        );
+        s_memoryAllocator.Free( allocation );
+    }
 
-        cmdBuf.EndRecording();
-        g_renderState.device.Submit( cmdBuf );
-        g_renderState.device.WaitForIdle();
-        cmdBuf.Free();
+    DeviceMemoryStats Device::GetMemoryStats() const
+    {
+        return s_memoryAllocator.GetStats();
     }
 
     VkDevice Device::GetHandle() const
@@ -769,6 +862,11 @@ namespace Gfx
         return m_presentQueue;
     }
 
+    VkQueue Device::TransferQueue() const
+    {
+        return m_transferQueue;
+    }
+
     Device::operator bool() const
     {
         return m_handle != VK_NULL_HANDLE;
@@ -786,7 +884,8 @@ namespace Gfx
         VkSubmitInfo submitInfo = {};
         submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-        VkSemaphore waitSemaphores[]      = { g_renderState.presentCompleteSemaphore.GetHandle() };
+        const FrameData& frame            = CurrentFrame();
+        VkSemaphore waitSemaphores[]      = { frame.presentCompleteSemaphore.GetHandle() };
         VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
         submitInfo.waitSemaphoreCount     = 1;
         submitInfo.pWaitSemaphores        = waitSemaphores;
@@ -794,11 +893,11 @@ namespace Gfx
         submitInfo.commandBufferCount     = numBuffers;
         submitInfo.pCommandBuffers        = vkCmdBufs;
 
-        VkSemaphore signalSemaphores[]    = { g_renderState.renderCompleteSemaphore.GetHandle() };
+        VkSemaphore signalSemaphores[]    = { frame.renderCompleteSemaphore.GetHandle() };
         submitInfo.signalSemaphoreCount   = 1;
         submitInfo.pSignalSemaphores      = signalSemaphores;
 
-        VkResult ret = vkQueueSubmit( m_graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE );
+        VkResult ret = vkQueueSubmit( m_graphicsQueue, 1, &submitInfo, frame.inFlightFence.GetHandle() );
         PG_ASSERT( ret == VK_SUCCESS );
     }
 
@@ -810,17 +909,13 @@ namespace Gfx
         submitInfo.commandBufferCount     = 1;
         submitInfo.pCommandBuffers        = &buff;
 
-        VkSemaphore signalSemaphores[]    = { g_renderState.renderCompleteSemaphore.GetHandle() };
-        submitInfo.signalSemaphoreCount   = 1;
-        submitInfo.pSignalSemaphores      = signalSemaphores;
-
         VkResult ret = vkQueueSubmit( m_computeQueue, 1, &submitInfo, g_renderState.computeFence.GetHandle() );
         PG_ASSERT( ret == VK_SUCCESS );
     }
 
     void Device::SubmitFrame( uint32_t imageIndex ) const
     {
-        VkSemaphore signalSemaphores[] = { g_renderState.renderCompleteSemaphore.GetHandle() };
+        VkSemaphore signalSemaphores[] = { CurrentFrame().renderCompleteSemaphore.GetHandle() };
         VkPresentInfoKHR presentInfo   = {};
         presentInfo.sType              = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
         presentInfo.waitSemaphoreCount = 1;
@@ -832,8 +927,6 @@ namespace Gfx
         presentInfo.pImageIndices   = &imageIndex;
 
         vkQueuePresentKHR( m_presentQueue, &presentInfo );
-        
-        vkDeviceWaitIdle( g_renderState.device.GetHandle() );
     }
 
 } // namespace Gfx
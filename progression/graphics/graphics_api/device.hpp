@@ -23,6 +23,9 @@ namespace Gfx
         operator bool() const;
 
         void Submit( const CommandBuffer& cmdBuf ) const;
+        // Submits to the queue of the given family. Any of the semaphores and the fence can be null. The
+        // whole command buffer waits on waitSemaphore
+        void Submit( CommandPoolQueueFamily queue, const CommandBuffer& cmdBuf, const Semaphore* waitSemaphore, const Semaphore* signalSemaphore, const Fence* fence ) const;
         void WaitForIdle() const;
         CommandPool NewCommandPool( CommandPoolCreateFlags flags = 0, CommandPoolQueueFamily family = CommandPoolQueueFamily::GRAPHICS, const std::string& name = "" ) const;
         DescriptorPool NewDescriptorPool( int numPoolSizes, VkDescriptorPoolSize* poolSizes, uint32_t maxSets = 1, const std::string& name = "" ) const;
@@ -31,30 +34,44 @@ namespace Gfx
         Buffer NewBuffer( size_t length, BufferType type, MemoryType memoryType, const std::string& name = "" ) const;
         Buffer NewBuffer( size_t length, void* data, BufferType type, MemoryType memoryType, const std::string& name = "" ) const;
         Texture NewTexture( const ImageDescriptor& desc, bool managed = true, const std::string& name = "" ) const;
+        // Only creates the image, for placing it in memory managed by the caller with BindTextureMemory
+        Texture NewUnboundTexture( const ImageDescriptor& desc, VkMemoryRequirements& requirements ) const;
+        // Binds the image and creates its view. The memory isn't owned by the texture, Free leaves it alone
+        void BindTextureMemory( Texture& tex, VkDeviceMemory memory, VkDeviceSize offset, bool managed = false, const std::string& name = "" ) const;
         Texture NewTextureFromBuffer( ImageDescriptor& desc, void* data, bool managed = true, const std::string& name = "" ) const;
         Sampler NewSampler( const SamplerDescriptor& desc ) const;
         Fence NewFence( bool signaled, const std::string& name = "" ) const;
         Semaphore NewSemaphore( const std::string& name = "" ) const;
         Pipeline NewPipeline( const PipelineDescriptor& desc, const std::string& name = "" ) const;
+        // Compiles the pipelines in parallel on the job threads. Any that failed are left invalid
+        std::vector< Pipeline > NewPipelines( const std::vector< PipelineDescriptor >& descs, const std::vector< std::string >& names ) const;
+        Pipeline NewComputePipeline( const ComputePipelineDescriptor& desc, const std::string& name = "" ) const;
         RenderPass NewRenderPass( const RenderPassDescriptor& desc, const std::string& name = "" ) const;
-        Framebuffer NewFramebuffer( const std::vector< Texture* >& attachments, const RenderPass& renderPass, const std::string& name = "" ) const;
+        Framebuffer NewFramebuffer( const std::vector< const Texture* >& attachments, const RenderPass& renderPass, const std::string& name = "" ) const;
         Framebuffer NewFramebuffer( const VkFramebufferCreateInfo& info, const std::string& name = "" ) const;
+        // Waits on the current frame's present semaphore, and signals its render semaphore and in flight fence
         void SubmitRenderCommands( int numBuffers, CommandBuffer* cmdBufs ) const;
         void SubmitComputeCommand( const CommandBuffer& cmdBuf ) const;
+        // Doesn't wait for the frame to finish. The frame's fence says when its resources can be reused
         void SubmitFrame( uint32_t imageIndex ) const;
 
-        void Copy( Buffer dst, Buffer src ) const;
-        void CopyBufferToImage( const Buffer& buffer, const Texture& tex, bool copyAllMips = true ) const;
+        // Suballocated out of the shared blocks of the memory type. optimalImage keeps buffers and
+        // optimally tiled images apart, to respect bufferImageGranularity
+        DeviceAllocation AllocateMemory( const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, bool optimalImage ) const;
+        void FreeMemory( const DeviceAllocation& allocation ) const;
+        DeviceMemoryStats GetMemoryStats() const;
 
         VkDevice GetHandle() const;
         VkQueue GraphicsQueue() const;
         VkQueue PresentQueue() const;
+        VkQueue TransferQueue() const;
 
     private:
         VkDevice m_handle        = VK_NULL_HANDLE;
         VkQueue  m_graphicsQueue = VK_NULL_HANDLE;
         VkQueue  m_presentQueue  = VK_NULL_HANDLE;
         VkQueue  m_computeQueue  = VK_NULL_HANDLE;
+        VkQueue  m_transferQueue = VK_NULL_HANDLE;
     };
 
 } // namespace Gfx
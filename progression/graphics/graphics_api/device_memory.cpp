@@ -0,0 +1,442 @@
+#include "graphics/graphics_api/device_memory.hpp"
+#include "core/assert.hpp"
+#include "utils/logger.hpp"
+#include <algorithm>
+
+static uint64_t AlignUp( uint64_t x, uint64_t alignment )
+{
+    return ( x + alignment - 1 ) & ~( alignment - 1 );
+}
+
+static uint64_t DivRoundUp( uint64_t x, uint64_t y )
+{
+    return ( x + y - 1 ) / y;
+}
+
+namespace Progression
+{
+namespace Gfx
+{
+
+    void DeviceMemoryAllocator::Init( DeviceMemoryBackend* backend, uint32_t numMemoryTypes, uint64_t granularity, uint64_t minAlignment, uint64_t blockSize )
+    {
+        PG_ASSERT( backend );
+        PG_ASSERT( minAlignment && ( minAlignment & ( minAlignment - 1 ) ) == 0, "minAlignment must be a power of 2" );
+        PG_ASSERT( granularity && ( granularity & ( granularity - 1 ) ) == 0, "bufferImageGranularity must be a power of 2" );
+        std::lock_guard< std::mutex > lock( m_lock );
+        m_backend        = backend;
+        m_numMemoryTypes = numMemoryTypes;
+        m_granularity    = granularity;
+        m_minAlignment   = minAlignment;
+        m_blockSize      = AlignUp( blockSize, minAlignment );
+        m_pools.clear();
+        m_pools.resize( 2 * numMemoryTypes );
+        for ( uint32_t i = 0; i < numMemoryTypes; ++i )
+        {
+            m_pools[2 * i + 0].memoryTypeIndex = i;
+            m_pools[2 * i + 1].memoryTypeIndex = i;
+        }
+        m_records.clear();
+        m_freeRecords.clear();
+    }
+
+    void DeviceMemoryAllocator::Shutdown()
+    {
+        std::lock_guard< std::mutex > lock( m_lock );
+        uint32_t numLeaked = 0;
+        for ( const Record& record : m_records )
+        {
+            numLeaked += record.live;
+        }
+        if ( numLeaked )
+        {
+            LOG_WARN( numLeaked, " device memory allocations were never freed" );
+        }
+
+        for ( uint32_t poolIndex = 0; poolIndex < static_cast< uint32_t >( m_pools.size() ); ++poolIndex )
+        {
+            for ( uint32_t blockIndex = 0; blockIndex < static_cast< uint32_t >( m_pools[poolIndex].blocks.size() ); ++blockIndex )
+            {
+                if ( m_pools[poolIndex].blocks[blockIndex].memory )
+                {
+                    FreeBlock( poolIndex, blockIndex );
+                }
+            }
+        }
+        m_pools.clear();
+        m_records.clear();
+        m_freeRecords.clear();
+    }
+
+    DeviceAllocation DeviceMemoryAllocator::Allocate( const DeviceMemoryRequest& request )
+    {
+        PG_ASSERT( request.size > 0 && request.memoryTypeIndex < m_numMemoryTypes );
+        PG_ASSERT( request.alignment && ( request.alignment & ( request.alignment - 1 ) ) == 0, "Alignment must be a power of 2" );
+        std::lock_guard< std::mutex > lock( m_lock );
+        uint32_t poolIndex = GeneralPoolIndex( request.memoryTypeIndex, request.optimalImage );
+        DeviceAllocation allocation;
+        bool found = false;
+        if ( request.size > m_blockSize / 2 )
+        {
+            uint32_t blockIndex = NewBlock( poolIndex, AlignUp( request.size, m_minAlignment ), true );
+            if ( blockIndex != DeviceAllocation::INVALID )
+            {
+                found = AllocateFromBlock( poolIndex, blockIndex, request, allocation );
+            }
+        }
+        else
+        {
+            Pool& pool = m_pools[poolIndex];
+            for ( uint32_t blockIndex = 0; blockIndex < static_cast< uint32_t >( pool.blocks.size() ) && !found; ++blockIndex )
+            {
+                if ( pool.blocks[blockIndex].memory && !pool.blocks[blockIndex].dedicated )
+                {
+                    found = AllocateFromBlock( poolIndex, blockIndex, request, allocation );
+                }
+            }
+            if ( !found )
+            {
+                uint32_t blockIndex = NewBlock( poolIndex, m_blockSize, false );
+                if ( blockIndex != DeviceAllocation::INVALID )
+                {
+                    found = AllocateFromBlock( poolIndex, blockIndex, request, allocation );
+                }
+            }
+        }
+
+        if ( !found )
+        {
+            LOG_ERR( "Out of device memory for an allocation of ", request.size, " bytes from memory type ", request.memoryTypeIndex );
+            return {};
+        }
+
+        uint32_t recordIndex;
+        if ( !m_freeRecords.empty() )
+        {
+            recordIndex = m_freeRecords.back();
+            m_freeRecords.pop_back();
+        }
+        else
+        {
+            recordIndex = static_cast< uint32_t >( m_records.size() );
+            m_records.emplace_back();
+        }
+        allocation.recordIndex            = recordIndex;
+        m_records[recordIndex].allocation = allocation;
+        m_records[recordIndex].alignment  = request.alignment;
+        m_records[recordIndex].userData   = request.userData;
+        m_records[recordIndex].live       = true;
+
+        return allocation;
+    }
+
+    void DeviceMemoryAllocator::Free( const DeviceAllocation& allocation )
+    {
+        PG_ASSERT( allocation.IsValid() );
+        std::lock_guard< std::mutex > lock( m_lock );
+        if ( m_pools[allocation.poolIndex].linear )
+        {
+            return;
+        }
+
+        Record& record = m_records[allocation.recordIndex];
+        PG_ASSERT( record.live, "Double free of device memory" );
+        // Defragmentation could have moved it since, so the record is the one to trust
+        FreeRange( record.allocation );
+        record.live = false;
+        m_freeRecords.push_back( allocation.recordIndex );
+    }
+
+    uint32_t DeviceMemoryAllocator::CreateLinearPool( uint32_t memoryTypeIndex, uint64_t size )
+    {
+        PG_ASSERT( memoryTypeIndex < m_numMemoryTypes );
+        std::lock_guard< std::mutex > lock( m_lock );
+        uint32_t poolIndex = static_cast< uint32_t >( m_pools.size() );
+        m_pools.emplace_back();
+        m_pools[poolIndex].memoryTypeIndex = memoryTypeIndex;
+        m_pools[poolIndex].linear          = true;
+        if ( NewBlock( poolIndex, AlignUp( size, m_minAlignment ), false ) == DeviceAllocation::INVALID )
+        {
+            LOG_ERR( "Could not allocate a linear pool of ", size, " bytes from memory type ", memoryTypeIndex );
+        }
+
+        return poolIndex;
+    }
+
+    DeviceAllocation DeviceMemoryAllocator::AllocateLinear( uint32_t poolIndex, const DeviceMemoryRequest& request )
+    {
+        PG_ASSERT( poolIndex < m_pools.size() && m_pools[poolIndex].linear );
+        PG_ASSERT( request.alignment && ( request.alignment & ( request.alignment - 1 ) ) == 0, "Alignment must be a power of 2" );
+        std::lock_guard< std::mutex > lock( m_lock );
+        Pool& pool = m_pools[poolIndex];
+        if ( pool.blocks.empty() || !pool.blocks[0].memory )
+        {
+            return {};
+        }
+
+        Block& block    = pool.blocks[0];
+        uint64_t offset = AlignUp( pool.linearOffset, std::max( request.alignment, m_minAlignment ) );
+        // A buffer and an optimal image can't share a bufferImageGranularity sized page, so switching
+        // between the two starts a new page
+        if ( block.numAllocations && pool.lastWasOptimalImage != request.optimalImage )
+        {
+            offset = AlignUp( offset, m_granularity );
+        }
+        if ( offset + request.size > block.size )
+        {
+            return {};
+        }
+
+        pool.linearOffset        = offset + AlignUp( request.size, m_minAlignment );
+        pool.lastWasOptimalImage = request.optimalImage;
+        block.usedBytes          = pool.linearOffset;
+        ++block.numAllocations;
+
+        DeviceAllocation allocation;
+        allocation.memory          = block.memory;
+        allocation.offset          = offset;
+        allocation.size            = request.size;
+        allocation.mappedPtr       = block.mappedPtr ? static_cast< char* >( block.mappedPtr ) + offset : nullptr;
+        allocation.memoryTypeIndex = pool.memoryTypeIndex;
+        allocation.poolIndex       = poolIndex;
+        allocation.blockIndex      = 0;
+
+        return allocation;
+    }
+
+    void DeviceMemoryAllocator::ResetLinearPool( uint32_t poolIndex )
+    {
+        PG_ASSERT( poolIndex < m_pools.size() && m_pools[poolIndex].linear );
+        std::lock_guard< std::mutex > lock( m_lock );
+        Pool& pool               = m_pools[poolIndex];
+        pool.linearOffset        = 0;
+        pool.lastWasOptimalImage = false;
+        if ( !pool.blocks.empty() )
+        {
+            pool.blocks[0].numAllocations = 0;
+            pool.blocks[0].usedBytes      = 0;
+        }
+    }
+
+    uint64_t DeviceMemoryAllocator::Defragment( const MoveFunction& move, uint64_t maxBytesToMove )
+    {
+        std::lock_guard< std::mutex > lock( m_lock );
+        uint64_t bytesMoved = 0;
+        for ( uint32_t poolIndex = 0; poolIndex < 2 * m_numMemoryTypes; ++poolIndex )
+        {
+            Pool& pool = m_pools[poolIndex];
+            std::vector< uint32_t > blocks;
+            for ( uint32_t blockIndex = 0; blockIndex < static_cast< uint32_t >( pool.blocks.size() ); ++blockIndex )
+            {
+                if ( pool.blocks[blockIndex].memory && !pool.blocks[blockIndex].dedicated )
+                {
+                    blocks.push_back( blockIndex );
+                }
+            }
+            if ( blocks.size() < 2 )
+            {
+                continue;
+            }
+
+            // Empty the least used blocks into the most used ones
+            std::sort( blocks.begin(), blocks.end(), [&pool]( uint32_t a, uint32_t b ) { return pool.blocks[a].usedBytes < pool.blocks[b].usedBytes; } );
+            for ( size_t src = 0; src + 1 < blocks.size(); ++src )
+            {
+                for ( uint32_t recordIndex = 0; recordIndex < static_cast< uint32_t >( m_records.size() ); ++recordIndex )
+                {
+                    Record& record = m_records[recordIndex];
+                    if ( !record.live || record.allocation.poolIndex != poolIndex || record.allocation.blockIndex != blocks[src] )
+                    {
+                        continue;
+                    }
+                    if ( bytesMoved + record.allocation.size > maxBytesToMove )
+                    {
+                        return bytesMoved;
+                    }
+
+                    DeviceMemoryRequest request;
+                    request.size            = record.allocation.size;
+                    request.alignment       = record.alignment;
+                    request.memoryTypeIndex = pool.memoryTypeIndex;
+                    request.optimalImage    = poolIndex & 1;
+                    DeviceAllocation dst;
+                    bool found = false;
+                    for ( size_t dstBlock = blocks.size() - 1; dstBlock > src && !found; --dstBlock )
+                    {
+                        found = AllocateFromBlock( poolIndex, blocks[dstBlock], request, dst );
+                    }
+                    if ( !found )
+                    {
+                        continue;
+                    }
+
+                    dst.recordIndex = recordIndex;
+                    if ( move( record.allocation, dst, record.userData ) )
+                    {
+                        bytesMoved += record.allocation.size;
+                        FreeRange( record.allocation );
+                        record.allocation = dst;
+                    }
+                    else
+                    {
+                        FreeRange( dst );
+                    }
+                }
+            }
+        }
+
+        return bytesMoved;
+    }
+
+    DeviceMemoryStats DeviceMemoryAllocator::GetStats() const
+    {
+        std::lock_guard< std::mutex > lock( m_lock );
+        DeviceMemoryStats stats;
+        for ( const Pool& pool : m_pools )
+        {
+            for ( const Block& block : pool.blocks )
+            {
+                if ( block.memory )
+                {
+                    ++stats.numBlocks;
+                    stats.numAllocations += block.numAllocations;
+                    stats.blockBytes     += block.size;
+                    stats.usedBytes      += block.usedBytes;
+                }
+            }
+        }
+
+        return stats;
+    }
+
+    uint32_t DeviceMemoryAllocator::GeneralPoolIndex( uint32_t memoryTypeIndex, bool optimalImage ) const
+    {
+        return 2 * memoryTypeIndex + ( optimalImage ? 1 : 0 );
+    }
+
+    bool DeviceMemoryAllocator::AllocateFromBlock( uint32_t poolIndex, uint32_t blockIndex, const DeviceMemoryRequest& request, DeviceAllocation& allocation )
+    {
+        Block& block = m_pools[poolIndex].blocks[blockIndex];
+        allocation.memory          = block.memory;
+        allocation.size            = request.size;
+        allocation.memoryTypeIndex = m_pools[poolIndex].memoryTypeIndex;
+        allocation.poolIndex       = poolIndex;
+        allocation.blockIndex      = blockIndex;
+        // The range allocator rounds sizes up to its bins, so a dedicated block sized exactly for its
+        // allocation wouldn't fit. It doesn't need one anyways
+        if ( block.dedicated )
+        {
+            block.numAllocations = 1;
+            block.usedBytes      = block.size;
+            allocation.offset    = 0;
+            allocation.mappedPtr = block.mappedPtr;
+            allocation.range     = {};
+            return true;
+        }
+
+        uint64_t units = DivRoundUp( request.size, m_minAlignment );
+        if ( units > block.ranges.Size() )
+        {
+            return false;
+        }
+
+        // Every unit is aligned to m_minAlignment, so only bigger alignments need any padding. Try
+        // without first, since most allocations end up aligned anyways
+        RangeAllocator::Allocation range = block.ranges.Allocate( static_cast< uint32_t >( units ) );
+        if ( !range.IsValid() )
+        {
+            return false;
+        }
+        uint64_t offset = range.offset * m_minAlignment;
+        if ( offset % request.alignment )
+        {
+            block.ranges.Free( range );
+            uint64_t paddingUnits = DivRoundUp( request.alignment, m_minAlignment ) - 1;
+            range = block.ranges.Allocate( static_cast< uint32_t >( units + paddingUnits ) );
+            if ( !range.IsValid() )
+            {
+                return false;
+            }
+            offset = AlignUp( range.offset * m_minAlignment, request.alignment );
+        }
+
+        ++block.numAllocations;
+        block.usedBytes += block.ranges.AllocationSize( range ) * m_minAlignment;
+
+        allocation.offset    = offset;
+        allocation.mappedPtr = block.mappedPtr ? static_cast< char* >( block.mappedPtr ) + offset : nullptr;
+        allocation.range     = range;
+
+        return true;
+    }
+
+    uint32_t DeviceMemoryAllocator::NewBlock( uint32_t poolIndex, uint64_t size, bool dedicated )
+    {
+        Pool& pool      = m_pools[poolIndex];
+        void* mappedPtr = nullptr;
+        uint64_t memory = m_backend->AllocateBlock( pool.memoryTypeIndex, size, &mappedPtr );
+        if ( !memory )
+        {
+            return DeviceAllocation::INVALID;
+        }
+
+        uint32_t blockIndex = 0;
+        while ( blockIndex < static_cast< uint32_t >( pool.blocks.size() ) && pool.blocks[blockIndex].memory )
+        {
+            ++blockIndex;
+        }
+        if ( blockIndex == static_cast< uint32_t >( pool.blocks.size() ) )
+        {
+            pool.blocks.emplace_back();
+        }
+
+        Block& block    = pool.blocks[blockIndex];
+        block.memory    = memory;
+        block.size      = size;
+        block.mappedPtr = mappedPtr;
+        block.dedicated = dedicated;
+        if ( !pool.linear && !dedicated )
+        {
+            block.ranges.Init( static_cast< uint32_t >( size / m_minAlignment ) );
+        }
+
+        return blockIndex;
+    }
+
+    void DeviceMemoryAllocator::FreeBlock( uint32_t poolIndex, uint32_t blockIndex )
+    {
+        Pool& pool = m_pools[poolIndex];
+        m_backend->FreeBlock( pool.memoryTypeIndex, pool.blocks[blockIndex].memory );
+        pool.blocks[blockIndex] = Block();
+    }
+
+    void DeviceMemoryAllocator::FreeRange( const DeviceAllocation& allocation )
+    {
+        Pool& pool   = m_pools[allocation.poolIndex];
+        Block& block = pool.blocks[allocation.blockIndex];
+        if ( !block.dedicated )
+        {
+            block.usedBytes -= block.ranges.AllocationSize( allocation.range ) * m_minAlignment;
+            block.ranges.Free( allocation.range );
+        }
+        --block.numAllocations;
+        if ( block.numAllocations )
+        {
+            return;
+        }
+
+        // Keep one empty block around per pool, so that allocating and freeing a single resource
+        // over and over doesn't hit the driver every time
+        bool otherBlocks = false;
+        for ( uint32_t blockIndex = 0; blockIndex < static_cast< uint32_t >( pool.blocks.size() ) && !otherBlocks; ++blockIndex )
+        {
+            otherBlocks = blockIndex != allocation.blockIndex && pool.blocks[blockIndex].memory && !pool.blocks[blockIndex].dedicated;
+        }
+        if ( block.dedicated || otherBlocks )
+        {
+            FreeBlock( allocation.poolIndex, allocation.blockIndex );
+        }
+    }
+
+} // namespace Gfx
+} // namespace Progression
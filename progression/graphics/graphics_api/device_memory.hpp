@@ -0,0 +1,157 @@
+#pragma once
+
+#include "core/range_allocator.hpp"
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+// Size of the device memory blocks that resources are suballocated from. Anything bigger than half
+// of this gets a block of its own
+#define PG_DEVICE_MEMORY_BLOCK_SIZE ( 64ull * 1024 * 1024 )
+
+namespace Progression
+{
+namespace Gfx
+{
+
+    // Where the blocks of device memory come from. The Device implements this with vkAllocateMemory.
+    // The allocator itself never calls Vulkan, so its logic can be run against a mock backend
+    class DeviceMemoryBackend
+    {
+    public:
+        virtual ~DeviceMemoryBackend() = default;
+
+        // Returns the memory handle (a VkDeviceMemory), or 0 on failure. Host visible memory should
+        // be mapped for its whole lifetime, with the pointer returned in mappedPtr
+        virtual uint64_t AllocateBlock( uint32_t memoryTypeIndex, uint64_t size, void** mappedPtr ) = 0;
+        virtual void FreeBlock( uint32_t memoryTypeIndex, uint64_t memory ) = 0;
+    };
+
+    struct DeviceMemoryRequest
+    {
+        uint64_t size            = 0;
+        uint64_t alignment       = 1;
+        uint32_t memoryTypeIndex = 0;
+        // Images with optimal tiling. They never share a block with buffers and linear images in the
+        // general pools, so bufferImageGranularity can't be violated there
+        bool optimalImage        = false;
+        // Handed back to the defragmentation callback, usually the owner of the resource
+        void* userData           = nullptr;
+    };
+
+    struct DeviceAllocation
+    {
+        static constexpr uint32_t INVALID = 0xFFFFFFFF;
+
+        uint64_t memory          = 0; // VkDeviceMemory of the block
+        uint64_t offset          = 0; // into the block
+        uint64_t size            = 0;
+        void* mappedPtr          = nullptr; // already offset. Null if the memory isn't host visible
+        uint32_t memoryTypeIndex = 0;
+
+        // internal
+        uint32_t poolIndex   = INVALID;
+        uint32_t blockIndex  = INVALID;
+        uint32_t recordIndex = INVALID;
+        RangeAllocator::Allocation range;
+
+        bool IsValid() const { return memory != 0; }
+    };
+
+    struct DeviceMemoryStats
+    {
+        uint32_t numBlocks      = 0; // live vkAllocateMemory allocations
+        uint32_t numAllocations = 0;
+        uint64_t blockBytes     = 0;
+        uint64_t usedBytes      = 0;
+    };
+
+    // Suballocates resources out of large blocks of device memory, instead of one vkAllocateMemory
+    // per resource. Each memory type has two general pools (one for buffers and linear images, one
+    // for optimal images) built on RangeAllocator, which grow a block at a time. Linear pools are
+    // created explicitly, bump allocate out of a single block, and are only freed all at once by
+    // resetting them, which makes them a good fit for transient data like staging memory.
+    // Thread safe
+    class DeviceMemoryAllocator
+    {
+    public:
+        // Called for every allocation that Defragment wants to move. It has to move the resource's
+        // contents from src to dst and rebind it, or return false to leave it where it is. It is
+        // called with the allocator locked, so it can't allocate or free through the allocator
+        using MoveFunction = std::function< bool( const DeviceAllocation& src, const DeviceAllocation& dst, void* userData ) >;
+
+        // granularity is bufferImageGranularity. Every allocation is aligned to minAlignment at least,
+        // which also keeps the sizes a multiple of it (nonCoherentAtomSize, for flushing)
+        void Init( DeviceMemoryBackend* backend, uint32_t numMemoryTypes, uint64_t granularity, uint64_t minAlignment = 256, uint64_t blockSize = PG_DEVICE_MEMORY_BLOCK_SIZE );
+        // Frees every block. Anything still allocated is reported as a leak
+        void Shutdown();
+
+        // Returns an invalid allocation if the backend is out of memory
+        DeviceAllocation Allocate( const DeviceMemoryRequest& request );
+        void Free( const DeviceAllocation& allocation );
+
+        // Returns the index of the new pool. Its one block is allocated immediately
+        uint32_t CreateLinearPool( uint32_t memoryTypeIndex, uint64_t size );
+        // Returns an invalid allocation if the pool is full. Allocations from linear pools are never
+        // freed on their own, Free is a no-op for them
+        DeviceAllocation AllocateLinear( uint32_t poolIndex, const DeviceMemoryRequest& request );
+        void ResetLinearPool( uint32_t poolIndex );
+
+        // Tries to empty the least used blocks of each general pool, by moving their allocations into
+        // the other blocks of the same pool. Emptied blocks are freed. Returns the number of bytes moved
+        uint64_t Defragment( const MoveFunction& move, uint64_t maxBytesToMove );
+
+        DeviceMemoryStats GetStats() const;
+
+    private:
+        struct Block
+        {
+            uint64_t memory         = 0; // 0 for a free slot
+            uint64_t size           = 0;
+            void* mappedPtr         = nullptr;
+            uint32_t numAllocations = 0;
+            uint64_t usedBytes      = 0;
+            bool dedicated          = false; // holds a single large allocation
+            RangeAllocator ranges; // in units of m_minAlignment
+        };
+
+        struct Pool
+        {
+            uint32_t memoryTypeIndex = 0;
+            bool linear              = false;
+            std::vector< Block > blocks;
+
+            // linear pools only
+            uint64_t linearOffset    = 0;
+            bool lastWasOptimalImage = false;
+        };
+
+        struct Record
+        {
+            DeviceAllocation allocation;
+            uint64_t alignment = 1; // needed again when defragmenting
+            void* userData     = nullptr;
+            bool live          = false;
+        };
+
+        uint32_t GeneralPoolIndex( uint32_t memoryTypeIndex, bool optimalImage ) const;
+        bool AllocateFromBlock( uint32_t poolIndex, uint32_t blockIndex, const DeviceMemoryRequest& request, DeviceAllocation& allocation );
+        uint32_t NewBlock( uint32_t poolIndex, uint64_t size, bool dedicated );
+        void FreeBlock( uint32_t poolIndex, uint32_t blockIndex );
+        // Gives the allocation's range back to its block, and frees the block if it isn't needed anymore
+        void FreeRange( const DeviceAllocation& allocation );
+
+        DeviceMemoryBackend* m_backend = nullptr;
+        uint32_t m_numMemoryTypes      = 0;
+        uint64_t m_granularity         = 1;
+        uint64_t m_minAlignment        = 256;
+        uint64_t m_blockSize           = PG_DEVICE_MEMORY_BLOCK_SIZE;
+        std::vector< Pool > m_pools; // the general pools first, 2 per memory type, then the linear ones
+        std::vector< Record > m_records;
+        std::vector< uint32_t > m_freeRecords;
+        mutable std::mutex m_lock;
+    };
+
+} // namespace Gfx
+} // namespace Progression
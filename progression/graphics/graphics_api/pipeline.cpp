@@ -28,6 +28,11 @@ namespace Gfx
         return m_pipelineLayout;
     }
 
+    VkPipelineBindPoint Pipeline::GetPipelineBindPoint() const
+    {
+        return m_bindPoint;
+    }
+
     Pipeline::operator bool() const
     {
         return m_pipeline != VK_NULL_HANDLE;
@@ -160,7 +160,7 @@ namespace Gfx
         VertexInputDescriptor vertexDescriptor;
         Viewport viewport;
         Scissor scissor;
-        RenderPass* renderPass;
+        const RenderPass* renderPass;
         std::vector< DescriptorSetLayout > descriptorSetLayouts;
         RasterizerInfo rasterizerInfo;
         PrimitiveType primitiveType = PrimitiveType::TRIANGLES;
@@ -169,6 +169,13 @@ namespace Gfx
         std::array< PipelineColorAttachmentInfo, 8 > colorAttachmentInfos;
     };
 
+    class ComputePipelineDescriptor
+    {
+    public:
+        Shader* shader = nullptr;
+        std::vector< DescriptorSetLayout > descriptorSetLayouts;
+    };
+
     class Pipeline
     {
         friend class Device;
@@ -178,10 +185,12 @@ namespace Gfx
         void Free();
         VkPipeline GetHandle() const;
         VkPipelineLayout GetLayoutHandle() const;
+        VkPipelineBindPoint GetPipelineBindPoint() const;
         operator bool() const;
 
     private:
         PipelineDescriptor m_desc;
+        VkPipelineBindPoint m_bindPoint   = VK_PIPELINE_BIND_POINT_GRAPHICS;
         VkPipeline m_pipeline             = VK_NULL_HANDLE;
         VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE;
         VkDevice m_device                 = VK_NULL_HANDLE;
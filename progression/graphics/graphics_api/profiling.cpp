@@ -1,25 +1,37 @@
 #include "graphics/graphics_api/profiling.hpp"
 #include "core/assert.hpp"
-#include "core/time.hpp"
+#include "core/cpu_profiling.hpp"
 #include "graphics/vulkan.hpp"
 #include "utils/logger.hpp"
 #include <algorithm>
-#include <fstream>
-#include <sstream>
-#include <unordered_map>
-#include <vector>
-
-#define MAX_NUM_QUERIES 100
-#define MILLISECONDS_BETWEEN_SAMPLES 100
-
-static std::vector< uint64_t > s_cpuQueries;
-static VkQueryPool s_queryPool = VK_NULL_HANDLE;
-static std::unordered_map< std::string, int > s_nameToIndexMap;
-static uint32_t s_nextFreeIndex;
-static double s_timestampToMillisInv;
-std::string tmpFileName = "pg_profiling_log.txt";
-static std::ofstream s_outputFile;
-static float s_lastSampledTime;
+
+#define NUM_GPU_SCOPES static_cast< uint32_t >( GpuScope::NUM_SCOPES )
+#define NUM_QUERIES ( 2 * NUM_GPU_SCOPES )
+
+using namespace Progression;
+using namespace Gfx;
+using namespace Profile;
+
+struct ScopeHistory
+{
+    float durations[PG_GPU_PROFILE_HISTORY];
+    uint32_t next  = 0;
+    uint32_t count = 0;
+};
+
+static const char* s_scopeNames[] =
+{
+#define _PG_GPU_SCOPE_NAME( name ) #name,
+    PG_GPU_PROFILE_SCOPES( _PG_GPU_SCOPE_NAME )
+#undef _PG_GPU_SCOPE_NAME
+};
+
+static VkQueryPool s_queryPools[MAX_FRAMES_IN_FLIGHT];
+static bool s_queryPoolUsed[MAX_FRAMES_IN_FLIGHT];
+static uint32_t s_currentPool;
+static ScopeHistory s_history[NUM_GPU_SCOPES];
+static double s_timestampPeriodNs;
+static double s_gpuToCpuOffsetNs; // GPU timestamp * period + offset = CpuProfile::NowNs() at the same moment
 
 namespace Progression
 {
@@ -28,171 +40,195 @@ namespace Gfx
 namespace Profile
 {
 
+    // Writes a single timestamp on an otherwise idle queue and waits for it, to line up the GPU's
+    // clock with the CPU profiler's. The GPU wrote it somewhere between the submit and the wait
+    // returning, so the midpoint is used. Done once, so any drift between the clocks over a long
+    // session isn't accounted for
+    static void CalibrateGpuClock()
+    {
+        CommandBuffer cmdBuf = g_renderState.transientCommandPool.NewCommandBuffer();
+        cmdBuf.BeginRecording( COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT );
+        vkCmdResetQueryPool( cmdBuf.GetHandle(), s_queryPools[0], 0, 1 );
+        vkCmdWriteTimestamp( cmdBuf.GetHandle(), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, s_queryPools[0], 0 );
+        cmdBuf.EndRecording();
+
+        g_renderState.device.WaitForIdle();
+        uint64_t cpuBeforeNs = CpuProfile::NowNs();
+        g_renderState.device.Submit( cmdBuf );
+        g_renderState.device.WaitForIdle();
+        uint64_t cpuAfterNs = CpuProfile::NowNs();
+        cmdBuf.Free();
+
+        uint64_t gpuTimestamp;
+        vkGetQueryPoolResults( g_renderState.device.GetHandle(), s_queryPools[0], 0, 1, sizeof( uint64_t ), &gpuTimestamp, sizeof( uint64_t ),
+            VK_QUERY_RESULT_WAIT_BIT | VK_QUERY_RESULT_64_BIT );
+        s_gpuToCpuOffsetNs = 0.5 * ( cpuBeforeNs + cpuAfterNs ) - gpuTimestamp * s_timestampPeriodNs;
+    }
+
+    static uint64_t GpuTimestampToCpuNs( uint64_t timestamp )
+    {
+        return static_cast< uint64_t >( timestamp * s_timestampPeriodNs + s_gpuToCpuOffsetNs );
+    }
+
+    // Doesn't wait on the GPU. Scopes whose start and end timestamps aren't both available yet
+    // (or that weren't timed in that frame at all) are skipped
+    static void ReadResults( VkQueryPool pool )
+    {
+        struct QueryResult
+        {
+            uint64_t timestamp;
+            uint64_t available;
+        };
+        QueryResult results[NUM_QUERIES];
+        VkResult res = vkGetQueryPoolResults( g_renderState.device.GetHandle(), pool, 0, NUM_QUERIES, sizeof( results ), results, sizeof( QueryResult ),
+            VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT );
+        if ( res != VK_SUCCESS && res != VK_NOT_READY )
+        {
+            return;
+        }
+
+        for ( uint32_t scope = 0; scope < NUM_GPU_SCOPES; ++scope )
+        {
+            const QueryResult& start = results[2 * scope + 0];
+            const QueryResult& end   = results[2 * scope + 1];
+            if ( !start.available || !end.available )
+            {
+                continue;
+            }
+
+            ScopeHistory& history = s_history[scope];
+            history.durations[history.next] = static_cast< float >( ( end.timestamp - start.timestamp ) * s_timestampPeriodNs / 1e6 );
+            history.next  = ( history.next + 1 ) % PG_GPU_PROFILE_HISTORY;
+            history.count = std::min( history.count + 1, static_cast< uint32_t >( PG_GPU_PROFILE_HISTORY ) );
+            CpuProfile::AddGpuZone( s_scopeNames[scope], GpuTimestampToCpuNs( start.timestamp ), GpuTimestampToCpuNs( end.timestamp ) );
+        }
+    }
+
     bool Init()
     {
         #if !USING( PG_PROFILING )
             return true;
-        #endif // #if !USING( SHIP_BUILD )
-        s_lastSampledTime = 0;
+        #endif // #if !USING( PG_PROFILING )
         VkQueryPoolCreateInfo createInfo = {};
         createInfo.sType        = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
         createInfo.pNext        = nullptr;
         createInfo.queryType    = VK_QUERY_TYPE_TIMESTAMP;
-        createInfo.queryCount   = MAX_NUM_QUERIES;
-        VkResult res = vkCreateQueryPool( g_renderState.device.GetHandle(), &createInfo, nullptr, &s_queryPool );
-        PG_ASSERT( res == VK_SUCCESS );
-
-        s_cpuQueries.resize( MAX_NUM_QUERIES );
-        s_timestampToMillisInv = 1.0 / g_renderState.physicalDeviceInfo.deviceProperties.limits.timestampPeriod / 1e6;
-        s_nextFreeIndex = 0;
-
-        s_outputFile.open( tmpFileName );
-        if ( !s_outputFile.is_open() )
+        createInfo.queryCount   = NUM_QUERIES;
+        for ( int i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i )
         {
-            return false;
+            VkResult res = vkCreateQueryPool( g_renderState.device.GetHandle(), &createInfo, nullptr, &s_queryPools[i] );
+            if ( res != VK_SUCCESS )
+            {
+                return false;
+            }
+            s_queryPoolUsed[i] = false;
         }
+        s_currentPool       = 0;
+        s_timestampPeriodNs = g_renderState.physicalDeviceInfo.deviceProperties.limits.timestampPeriod;
+        ResetStats();
+        CalibrateGpuClock();
 
         return true;
     }
 
     void Shutdown()
     {
-        if ( s_queryPool != VK_NULL_HANDLE )
+        for ( int i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i )
         {
-            vkDestroyQueryPool( g_renderState.device.GetHandle(), s_queryPool, nullptr );
-        }
-
-        s_outputFile.close();
-
-        // read the log file back in and calculate average durations between timestamps with same prefix
-        // expects that the durations the user cares about come in pairs.
-        // Eg: "Frame_Start" + "Frame_End", "ShadowPass_Start" + "ShadowPass_End", etc
-        LOG( "Processing profiling timestamps..." );
-        std::ifstream in( tmpFileName );
-        struct Entry
-        {
-            std::string name;
-            double totalTime = 0;
-            int count        = 0;
-        };
-        struct LogTimestamp
-        {
-            std::string name;
-            double time;
-        };
-        std::unordered_map< std::string, Entry > pairings;
-        
-        std::vector< LogTimestamp > timestamps;
-        
-        std::string line;
-        while ( std::getline( in, line ) )
-        {
-            // newline signifies end of frame. Calculate durations
-            if ( line == "" )
-            {
-                std::sort( timestamps.begin(), timestamps.end(), []( const LogTimestamp& lhs, const LogTimestamp& rhs ) { return lhs.name < rhs.name; } );
-                size_t numTimestamps = timestamps.size();
-                for ( size_t i = 0; i < timestamps.size() && i != timestamps.size() - 1; i += 2 )
-                {
-                    auto pos = timestamps[i].name.find( '_' );
-                    std::string first_prefix  = timestamps[i].name.substr( 0, pos );
-                    std::string first_postfix = timestamps[i].name.substr( pos + 1 );
-                    pos = timestamps[i + 1].name.find( '_' );
-                    std::string second_prefix  = timestamps[i + 1].name.substr( 0, pos );
-                    std::string second_postfix = timestamps[i + 1].name.substr( pos + 1 );
-
-                    if ( first_prefix != second_prefix )
-                    {
-                        --i;
-                        continue;
-                    }
-                    std::string entryName = first_prefix + ": " + second_postfix + " - " + first_postfix;
-                    auto& entry      = pairings[entryName];
-                    entry.count     += 1;
-                    entry.totalTime += ( timestamps[i].time - timestamps[i + 1].time );                    
-                }
-                timestamps.clear();
-
-                continue;
-            }
-
-            LogTimestamp t;
-            std::stringstream ss( line );
-            ss >> t.name >> t.time;
-            auto pos = t.name.find( "_" );
-            if ( pos != std::string::npos )
+            if ( s_queryPools[i] != VK_NULL_HANDLE )
             {
-                timestamps.push_back( t );
+                vkDestroyQueryPool( g_renderState.device.GetHandle(), s_queryPools[i], nullptr );
+                s_queryPools[i] = VK_NULL_HANDLE;
             }
         }
 
-        if ( pairings.size() == 0 )
+        bool anySamples = false;
+        for ( uint32_t scope = 0; scope < NUM_GPU_SCOPES && !anySamples; ++scope )
+        {
+            anySamples = s_history[scope].count > 0;
+        }
+        if ( !anySamples )
         {
             return;
         }
 
-        // display from lowest time to highest
-        std::vector< Entry > entries;
-        for ( auto& [ name, entry ] : pairings )
+        LOG( "GPU timings over the last ", PG_GPU_PROFILE_HISTORY, " frames (min / avg / p99 ms):" );
+        for ( uint32_t scope = 0; scope < NUM_GPU_SCOPES; ++scope )
         {
-            entry.name = name;
-            entries.push_back( entry );
+            GpuStats stats = GetStats( static_cast< GpuScope >( scope ) );
+            if ( stats.numSamples )
+            {
+                LOG( "    ", s_scopeNames[scope], ": ", stats.minMs, " / ", stats.avgMs, " / ", stats.p99Ms );
+            }
         }
-        std::sort( entries.begin(), entries.end(), []( const Entry& lhs, const Entry& rhs ){ return lhs.totalTime / lhs.count < rhs.totalTime  / rhs.count; } );
+    }
 
-        LOG( "Profiling timestamps: " );
-        for ( const auto& entry : entries )
+    void BeginFrame( const CommandBuffer& cmdbuf )
+    {
+        // Render waited on this frame's fence before recording, so the pool's results from the last time
+        // this frame slot was used are ready
+        s_currentPool = g_renderState.currentFrame;
+        if ( s_queryPoolUsed[s_currentPool] )
         {
-            LOG( entry.name, ": ", entry.totalTime * s_timestampToMillisInv / entry.count );
+            ReadResults( s_queryPools[s_currentPool] );
         }
+        vkCmdResetQueryPool( cmdbuf.GetHandle(), s_queryPools[s_currentPool], 0, NUM_QUERIES );
+        s_queryPoolUsed[s_currentPool] = true;
     }
 
-    void Reset( const CommandBuffer& cmdbuf )
+    void StartScope( const CommandBuffer& cmdbuf, GpuScope scope )
     {
-        vkCmdResetQueryPool( cmdbuf.GetHandle(), s_queryPool, 0, MAX_NUM_QUERIES );
-        s_nextFreeIndex = 0;
+        vkCmdWriteTimestamp( cmdbuf.GetHandle(), VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, s_queryPools[s_currentPool], 2 * static_cast< uint32_t >( scope ) );
     }
 
-    void GetResults()
+    void EndScope( const CommandBuffer& cmdbuf, GpuScope scope )
     {
-        float currentTime = Time::Time();
-        if ( currentTime >= s_lastSampledTime + MILLISECONDS_BETWEEN_SAMPLES )
-        {
-            s_lastSampledTime = currentTime;
-            vkGetQueryPoolResults( g_renderState.device.GetHandle(), s_queryPool, 0, s_nextFreeIndex, s_cpuQueries.size() * sizeof( uint64_t ),
-                s_cpuQueries.data(), sizeof( uint64_t ), VK_QUERY_RESULT_WAIT_BIT | VK_QUERY_RESULT_64_BIT );
-        
-            for ( const auto& [ name, index ] : s_nameToIndexMap )
-            {
-                s_outputFile << name << " " << s_cpuQueries[s_nameToIndexMap[name]] << "\n";
-            }
-            s_outputFile << "\n";
-        }
+        vkCmdWriteTimestamp( cmdbuf.GetHandle(), VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, s_queryPools[s_currentPool], 2 * static_cast< uint32_t >( scope ) + 1 );
     }
-    
-    void Timestamp( const CommandBuffer& cmdbuf, const std::string& name )
+
+    const char* GetScopeName( GpuScope scope )
     {
-        s_nameToIndexMap[name] = s_nextFreeIndex++;
-        vkCmdWriteTimestamp( cmdbuf.GetHandle(), VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, s_queryPool, s_nameToIndexMap[name] );
+        PG_ASSERT( scope < GpuScope::NUM_SCOPES );
+        return s_scopeNames[static_cast< uint32_t >( scope )];
     }
 
-    uint64_t GetTimestamp( const std::string& name )
+    GpuStats GetStats( GpuScope scope )
     {
-        #if !USING( PG_PROFILING )
-            return 0;
-        #endif // #if !USING( SHIP_BUILD )
-        PG_ASSERT( s_nameToIndexMap.find( name ) != s_nameToIndexMap.end() );
-        return s_cpuQueries[s_nameToIndexMap[name]];
+        PG_ASSERT( scope < GpuScope::NUM_SCOPES );
+        const ScopeHistory& history = s_history[static_cast< uint32_t >( scope )];
+        GpuStats stats;
+        stats.numSamples = history.count;
+        if ( history.count == 0 )
+        {
+            return stats;
+        }
+
+        float sorted[PG_GPU_PROFILE_HISTORY];
+        std::copy( history.durations, history.durations + history.count, sorted );
+        std::sort( sorted, sorted + history.count );
+        float total = 0;
+        for ( uint32_t i = 0; i < history.count; ++i )
+        {
+            total += sorted[i];
+        }
+        uint32_t p99Index = ( 99 * history.count + 99 ) / 100 - 1;
+        stats.lastMs = history.durations[( history.next + PG_GPU_PROFILE_HISTORY - 1 ) % PG_GPU_PROFILE_HISTORY];
+        stats.minMs  = sorted[0];
+        stats.avgMs  = total / history.count;
+        stats.p99Ms  = sorted[std::min( p99Index, history.count - 1 )];
+
+        return stats;
     }
 
-    float GetDuration( const std::string& start, const std::string& end )
+    void ResetStats()
     {
-        #if !USING( PG_PROFILING )
-            return 0;
-        #endif // #if !USING( SHIP_BUILD )
-        return static_cast< float >( ( GetTimestamp( end ) - GetTimestamp( start ) ) * s_timestampToMillisInv );
+        for ( auto& history : s_history )
+        {
+            history.next  = 0;
+            history.count = 0;
+        }
     }
 
 } // namespace Profile
 } // namespace Gfx
-} // namespace Progression
\ No newline at end of file
+} // namespace Progression
@@ -1,8 +1,31 @@
 #pragma once
 
 #include "graphics/graphics_api/command_buffer.hpp"
-#include "core/platform_defines.hpp"
-#include <string>
+#include "core/feature_defines.hpp"
+#include <cstdint>
+
+// Every GPU scope that can be timed. Each one owns a fixed pair of queries (start and end) in the
+// query pools, so timing a scope never has to look anything up
+#define PG_GPU_PROFILE_SCOPES( X ) \
+    X( Frame )                     \
+    X( Skinning )                  \
+    X( StaticShadow )              \
+    X( Shadow )                    \
+    X( GBuffer )                   \
+    X( SSAODownsample )            \
+    X( SSAO )                      \
+    X( SSAOBlurX )                 \
+    X( SSAOBlurY )                 \
+    X( SSAOUpsample )              \
+    X( Lighting )                  \
+    X( HiZ )                       \
+    X( Background )                \
+    X( Transparency )              \
+    X( PostProcess )               \
+    X( UI )
+
+// Number of frames the rolling statistics of each scope are computed over
+#define PG_GPU_PROFILE_HISTORY 256
 
 namespace Progression
 {
@@ -11,40 +34,52 @@ namespace Gfx
 namespace Profile
 {
 
+    enum class GpuScope : uint32_t
+    {
+#define _PG_GPU_SCOPE_ENUM( name ) name,
+        PG_GPU_PROFILE_SCOPES( _PG_GPU_SCOPE_ENUM )
+#undef _PG_GPU_SCOPE_ENUM
+
+        NUM_SCOPES
+    };
+
+    struct GpuStats
+    {
+        float lastMs        = 0;
+        float minMs         = 0;
+        float avgMs         = 0;
+        float p99Ms         = 0;
+        uint32_t numSamples = 0; // 0 if the scope hasn't been timed in the last PG_GPU_PROFILE_HISTORY frames
+    };
+
     bool Init();
     void Shutdown();
 
-    void Reset( const CommandBuffer& cmdbuf );
-    void GetResults();
-    
-    void Timestamp( const CommandBuffer& cmdbuf, const std::string& name );
-    uint64_t GetTimestamp( const std::string& name );
-    float GetDuration( const std::string& start, const std::string& end );
+    // Call at the start of every frame's command buffer. There is one query pool per frame in flight.
+    // This reads back the results from the last time the current frame's pool was used, without
+    // waiting for them, and then resets the pool for this frame
+    void BeginFrame( const CommandBuffer& cmdbuf );
+    void StartScope( const CommandBuffer& cmdbuf, GpuScope scope );
+    void EndScope( const CommandBuffer& cmdbuf, GpuScope scope );
+
+    const char* GetScopeName( GpuScope scope );
+    GpuStats GetStats( GpuScope scope );
+    void ResetStats();
 
 } // namespace Profile
 } // namespace Gfx
 } // namespace Progression
 
-#if !USING( SHIP_BUILD )
-
-#define PG_PROFILING IN_USE
-
-#else // #if !USING( SHIP_BUILD )
-
-#define PG_PROFILING NOT_IN_USE
-
-#endif // #else // #if !USING( SHIP_BUILD )
-
 #if USING( PG_PROFILING )
 
-#define PG_PROFILE_RESET( cmdbuf ) Progression::Gfx::Profile::Reset( cmdbuf );
-#define PG_PROFILE_GET_RESULTS() Progression::Gfx::Profile::GetResults();
-#define PG_PROFILE_TIMESTAMP( cmdbuf, name ) Progression::Gfx::Profile::Timestamp( cmdbuf, name );
+#define PG_PROFILE_GPU_BEGIN_FRAME( cmdbuf ) Progression::Gfx::Profile::BeginFrame( cmdbuf );
+#define PG_PROFILE_GPU_START( cmdbuf, scope ) Progression::Gfx::Profile::StartScope( cmdbuf, Progression::Gfx::Profile::GpuScope::scope );
+#define PG_PROFILE_GPU_END( cmdbuf, scope ) Progression::Gfx::Profile::EndScope( cmdbuf, Progression::Gfx::Profile::GpuScope::scope );
 
 #else // #if USING( PG_PROFILING )
 
-#define PG_PROFILE_RESET( cmdbuf )
-#define PG_PROFILE_GET_RESULTS()
-#define PG_PROFILE_TIMESTAMP( cmdbuf, name )
+#define PG_PROFILE_GPU_BEGIN_FRAME( cmdbuf )
+#define PG_PROFILE_GPU_START( cmdbuf, scope )
+#define PG_PROFILE_GPU_END( cmdbuf, scope )
 
-#endif // #else // #if USING( PG_PROFILING )
\ No newline at end of file
+#endif // #else // #if USING( PG_PROFILING )
@@ -18,6 +18,12 @@ namespace Gfx
         vkWaitForFences( m_device, 1, &m_handle, VK_TRUE, UINT64_MAX );
     }
 
+    bool Fence::IsSignaled() const
+    {
+        PG_ASSERT( m_device != VK_NULL_HANDLE && m_handle != VK_NULL_HANDLE );
+        return vkGetFenceStatus( m_device, m_handle ) == VK_SUCCESS;
+    }
+
     void Fence::Reset()
     {
         PG_ASSERT( m_device != VK_NULL_HANDLE && m_handle != VK_NULL_HANDLE );
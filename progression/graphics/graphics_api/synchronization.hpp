@@ -15,6 +15,7 @@ namespace Gfx
 
         void Free();
         void WaitFor();
+        bool IsSignaled() const;
         void Reset();
         VkFence GetHandle() const;
         operator bool() const;
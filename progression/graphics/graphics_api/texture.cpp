@@ -465,15 +465,13 @@ namespace Gfx
         return totalSize;
     }
 
-    void Texture::GenerateMipMaps()
+    void Texture::GenerateMipMaps( const CommandBuffer& cmdBuf ) const
     {
         PG_ASSERT( m_image != VK_NULL_HANDLE );
         VkFormatProperties formatProperties;
         vkGetPhysicalDeviceFormatProperties( g_renderState.physicalDeviceInfo.device, PGToVulkanPixelFormat( m_desc.format ), &formatProperties );
         PG_MAYBE_UNUSED( formatProperties );
         PG_ASSERT( formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT, "Mipmapping not supported on this gpu" );
-        CommandBuffer cmdBuf = g_renderState.transientCommandPool.NewCommandBuffer();
-        cmdBuf.BeginRecording( COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT );
 
         VkImageMemoryBarrier barrier = {};
         barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
@@ -538,13 +536,6 @@ namespace Gfx
             barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
             cmdBuf.PipelineBarrier( VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, barrier );
         }
-
-        cmdBuf.EndRecording();
-
-        g_renderState.device.Submit( cmdBuf );
-        g_renderState.device.WaitForIdle();
-
-        cmdBuf.Free();
     }
 
     void Texture::Free()
@@ -555,7 +546,12 @@ namespace Gfx
 
         vkDestroyImage( m_device, m_image, nullptr );
         vkDestroyImageView( m_device, m_imageView, nullptr );
-        vkFreeMemory( m_device, m_memory, nullptr );
+        // Textures placed with BindTextureMemory don't own their memory
+        if ( m_allocation.IsValid() )
+        {
+            g_renderState.device.FreeMemory( m_allocation );
+            MemoryManager::TrackFree( MemoryManager::MemoryHeap::GPU, m_memoryTag, m_allocatedSize );
+        }
         if ( m_textureSlot != PG_INVALID_TEXTURE_INDEX )
         {
             TextureManager::FreeSlot( m_textureSlot );
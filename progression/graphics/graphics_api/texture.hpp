@@ -1,5 +1,7 @@
 #pragma once
 
+#include "core/memory_manager.hpp"
+#include "graphics/graphics_api/device_memory.hpp"
 #include "graphics/shader_c_shared/defines.h"
 #include <string>
 #include <vulkan/vulkan.h>
@@ -12,6 +14,7 @@ class Image;
 namespace Gfx
 {
 
+    class CommandBuffer;
     class Sampler;
 
     enum class PixelFormat
@@ -167,7 +170,9 @@ namespace Gfx
         Texture() = default;
 
         void Free();
-        void GenerateMipMaps();
+        // Records blitting mip 0 down into the rest of the mips. Every mip has to be in TRANSFER_DST_OPTIMAL,
+        // and they are all left in SHADER_READ_ONLY_OPTIMAL. Needs a graphics queue
+        void GenerateMipMaps( const CommandBuffer& cmdBuf ) const;
 
         unsigned char* GetPixelData() const;
         ImageType GetType() const;
@@ -191,10 +196,13 @@ namespace Gfx
         ImageDescriptor m_desc;
         VkImage m_image         = VK_NULL_HANDLE;
         VkImageView m_imageView = VK_NULL_HANDLE;
-        VkDeviceMemory m_memory = VK_NULL_HANDLE;
+        VkDeviceMemory m_memory = VK_NULL_HANDLE; // the block the image lives in, shared with other resources
         VkDevice m_device       = VK_NULL_HANDLE;
+        DeviceAllocation m_allocation;
         uint16_t m_textureSlot  = PG_INVALID_TEXTURE_INDEX;
         Sampler* m_sampler      = nullptr;
+        size_t m_allocatedSize  = 0;
+        MemoryManager::MemoryTag m_memoryTag = MemoryManager::MemoryTag::General;
     };
 
 } // namespace Gfx
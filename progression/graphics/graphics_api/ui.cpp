@@ -1,12 +1,15 @@
 #include "graphics/graphics_api/ui.hpp"
 #include "core/assert.hpp"
 #include "core/input.hpp"
+#include "core/memory_manager.hpp"
 #include "core/time.hpp"
 #include "core/window.hpp"
 #include "graphics/graphics_api/buffer.hpp"
 #include "graphics/graphics_api/descriptor.hpp"
 #include "graphics/graphics_api/pipeline.hpp"
 #include "graphics/graphics_api/texture.hpp"
+#include "graphics/render_system.hpp"
+#include "graphics/shader_c_shared/defines.h"
 #include "graphics/vulkan.hpp"
 #include "resource/resource_manager.hpp"
 #include "resource/shader.hpp"
@@ -31,8 +34,9 @@ static DescriptorPool s_descriptorPool;
 static std::vector< DescriptorSetLayout > s_descriptorSetLayouts;
 static DescriptorSet s_descriptorSet;
 static Pipeline s_pipeline;
-static Buffer s_VBO, s_IBO;
-static int s_vertexCount = 0, s_indexCount = 0;
+// Rewritten every frame, so each frame in flight needs its own pair
+static Buffer s_VBO[MAX_FRAMES_IN_FLIGHT], s_IBO[MAX_FRAMES_IN_FLIGHT];
+static int s_vertexCount[MAX_FRAMES_IN_FLIGHT] = {}, s_indexCount[MAX_FRAMES_IN_FLIGHT] = {};
 static std::unordered_map< std::string, std::function< void() > > s_drawFunctions;
 
 struct PushConstBlock
@@ -46,6 +50,7 @@ namespace UIOverlay
 
     bool Init()
     {
+        PG_MEMORY_TAG( UI );
         s_visible = false;
         s_updated = false;
         ImGui::CreateContext();
@@ -135,6 +140,20 @@ namespace UIOverlay
             ImGui::SetNextWindowPos( ImVec2( 5, 5 ), ImGuiCond_FirstUseEver );
 		    ImGui::Begin( "Renderer Debug Settings", nullptr, ImGuiWindowFlags_AlwaysAutoResize );
             UIOverlay::ComboBox( "View", &g_debugLayer, { "Regular", "No SSAO", "SSAO Only", "Ambient", "Lit Diffuse", "Lit Specular", "Positions", "Normals", "GBuffer Diffuse", "GBuffer Specular" } );
+            int ssaoKernel = 0;
+            while ( ( PG_SSAO_MIN_KERNEL_SIZE << ssaoKernel ) < static_cast< int >( RenderSystem::GetSSAOKernelSize() ) )
+            {
+                ++ssaoKernel;
+            }
+            if ( UIOverlay::ComboBox( "SSAO Samples", &ssaoKernel, { "8", "16", "32", "64" } ) )
+            {
+                RenderSystem::SetSSAOKernelSize( PG_SSAO_MIN_KERNEL_SIZE << ssaoKernel );
+            }
+            bool occlusionCulling = RenderSystem::GetOcclusionCulling();
+            if ( UIOverlay::CheckBox( "Occlusion Culling", &occlusionCulling ) )
+            {
+                RenderSystem::SetOcclusionCulling( occlusionCulling );
+            }
 		    ImGui::End();
         });
 #endif // #if USING( DEBUG_BUILD )
@@ -145,13 +164,16 @@ namespace UIOverlay
     void Shutdown()
     {
         ImGui::DestroyContext();
-        if ( s_VBO )
+        for ( int i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i )
         {
-            s_VBO.Free();
-        }
-        if ( s_IBO )
-        {
-            s_IBO.Free();
+            if ( s_VBO[i] )
+            {
+                s_VBO[i].Free();
+            }
+            if ( s_IBO[i] )
+            {
+                s_IBO[i].Free();
+            }
         }
         s_fontTexture.Free();
         s_pipeline.Free();
@@ -161,6 +183,7 @@ namespace UIOverlay
 
     static void UpdateBuffers()
     {
+        PG_MEMORY_TAG( UI );
         ImDrawData* imDrawData = ImGui::GetDrawData();
 
 		// Note: Alignment is done inside buffer creation
@@ -173,39 +196,44 @@ namespace UIOverlay
 		}
 
 		// Update buffers only if vertex or index count has been changed compared to current buffer size
+        uint32_t frame   = g_renderState.currentFrame;
+        Buffer& vbo      = s_VBO[frame];
+        Buffer& ibo      = s_IBO[frame];
+        int& vertexCount = s_vertexCount[frame];
+        int& indexCount  = s_indexCount[frame];
 
 		// Vertex buffer
-		if ( !s_VBO || s_vertexCount != imDrawData->TotalVtxCount )
+		if ( !vbo || vertexCount != imDrawData->TotalVtxCount )
         {
-            if ( s_VBO )
+            if ( vbo )
             {
-                s_VBO.UnMap();
-                s_VBO.Free();
+                vbo.UnMap();
+                vbo.Free();
             }
-            s_VBO = g_renderState.device.NewBuffer( vertexBufferSize, BUFFER_TYPE_VERTEX, MEMORY_TYPE_HOST_VISIBLE, "UI Vertex Buffer" );
-            PG_ASSERT( s_VBO );
-			s_vertexCount = imDrawData->TotalVtxCount;
-            s_VBO.Map();
+            vbo = g_renderState.device.NewBuffer( vertexBufferSize, BUFFER_TYPE_VERTEX, MEMORY_TYPE_HOST_VISIBLE, "UI Vertex Buffer" );
+            PG_ASSERT( vbo );
+			vertexCount = imDrawData->TotalVtxCount;
+            vbo.Map();
 		}
 
 		// Index buffer
 		VkDeviceSize indexSize = imDrawData->TotalIdxCount * sizeof(ImDrawIdx);
-		if ( !s_IBO || s_indexCount < imDrawData->TotalIdxCount )
+		if ( !ibo || indexCount < imDrawData->TotalIdxCount )
         {
-            if ( s_IBO )
+            if ( ibo )
             {
-                s_IBO.UnMap();
-                s_IBO.Free();
+                ibo.UnMap();
+                ibo.Free();
             }
-            s_IBO = g_renderState.device.NewBuffer( indexBufferSize, BUFFER_TYPE_INDEX, MEMORY_TYPE_HOST_VISIBLE, "UI Index Buffer" );
-            PG_ASSERT( s_IBO );
-			s_indexCount = imDrawData->TotalIdxCount;
-            s_IBO.Map();
+            ibo = g_renderState.device.NewBuffer( indexBufferSize, BUFFER_TYPE_INDEX, MEMORY_TYPE_HOST_VISIBLE, "UI Index Buffer" );
+            PG_ASSERT( ibo );
+			indexCount = imDrawData->TotalIdxCount;
+            ibo.Map();
 		}
 
 		// Upload data
-		ImDrawVert* vtxDst = reinterpret_cast< ImDrawVert* >( s_VBO.MappedPtr() );
-		ImDrawIdx* idxDst  = reinterpret_cast< ImDrawIdx* >( s_IBO.MappedPtr() );
+		ImDrawVert* vtxDst = reinterpret_cast< ImDrawVert* >( vbo.MappedPtr() );
+		ImDrawIdx* idxDst  = reinterpret_cast< ImDrawIdx* >( ibo.MappedPtr() );
 
 		for ( int n = 0; n < imDrawData->CmdListsCount; n++ )
         {
@@ -217,8 +245,8 @@ namespace UIOverlay
 		}
 
 		// Flush to make writes visible to GPU
-        s_VBO.Flush();
-        s_IBO.Flush();
+        vbo.Flush();
+        ibo.Flush();
     }
 
     void AddDrawFunction( const std::string& name, const std::function< void() >& func )
@@ -275,8 +303,8 @@ namespace UIOverlay
 		pushConstBlock.translate = glm::vec2( -1.0f );
         cmdBuf.PushConstants( s_pipeline, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof( PushConstBlock ), &pushConstBlock );
 
-        cmdBuf.BindVertexBuffer( s_VBO );
-        cmdBuf.BindIndexBuffer( s_IBO, IndexType::UNSIGNED_SHORT );
+        cmdBuf.BindVertexBuffer( s_VBO[g_renderState.currentFrame] );
+        cmdBuf.BindIndexBuffer( s_IBO[g_renderState.currentFrame], IndexType::UNSIGNED_SHORT );
 
         int vertexOffset = 0;
 		int indexOffset  = 0;
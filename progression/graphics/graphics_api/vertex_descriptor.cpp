@@ -54,6 +54,9 @@ namespace Gfx
 
     const VkPipelineVertexInputStateCreateInfo& VertexInputDescriptor::GetHandle()
     {
+        // A copied descriptor would still point at the original's arrays, which might be gone by now
+        m_createInfo.pVertexBindingDescriptions   = m_vkBindingDescs.empty() ? nullptr : m_vkBindingDescs.data();
+        m_createInfo.pVertexAttributeDescriptions = m_vkAttribDescs.empty() ? nullptr : m_vkAttribDescs.data();
         return m_createInfo;
     }
 
@@ -0,0 +1,222 @@
+#include "graphics/light_clusters.hpp"
+#include "core/assert.hpp"
+#include <algorithm>
+#include <cmath>
+
+// How far x is outside of the range, 0 if it is inside
+static float DistanceToRange( float x, const glm::vec2& range )
+{
+    return std::max( { range.x - x, x - range.y, 0.0f } );
+}
+
+// Whether a sphere, relative to the apex of a cone, touches the cone. Only for cones narrower than a
+// hemisphere. Splits the sphere's center into the parts along and away from the axis, and checks its
+// distance to the closest side of the cone, along with whether it is behind the apex
+static bool SphereTouchesCone( const glm::vec3& center, float radius, const glm::vec3& axis, float cosAngle, float sinAngle )
+{
+    float alongAxis    = glm::dot( center, axis );
+    float awayFromAxis = std::sqrt( std::max( glm::dot( center, center ) - alongAxis * alongAxis, 0.0f ) );
+    float distance     = cosAngle * awayFromAxis - sinAngle * alongAxis;
+    return distance <= radius && alongAxis >= -radius;
+}
+
+static uint32_t NdcToCluster( float ndc, int numClusters )
+{
+    int cluster = static_cast< int >( std::floor( ( 0.5f * ndc + 0.5f ) * numClusters ) );
+    return static_cast< uint32_t >( std::clamp( cluster, 0, numClusters - 1 ) );
+}
+
+namespace Progression
+{
+namespace Gfx
+{
+
+    void LightClusters::SetProjection( float fov, float aspectRatio, float nearPlane, float farPlane )
+    {
+        if ( fov == m_fov && aspectRatio == m_aspectRatio && nearPlane == m_nearPlane && farPlane == m_farPlane )
+        {
+            return;
+        }
+        PG_ASSERT( 0 < nearPlane && nearPlane < farPlane );
+        m_fov         = fov;
+        m_aspectRatio = aspectRatio;
+        m_nearPlane   = nearPlane;
+        m_farPlane    = farPlane;
+
+        float tanY       = std::tan( 0.5f * fov );
+        float tanX       = tanY * aspectRatio;
+        float depthScale = PG_LIGHT_CLUSTERS_Z / std::log( farPlane / nearPlane );
+        m_shaderParams   = glm::vec4( 1 / tanX, 1 / tanY, depthScale, -std::log( nearPlane ) * depthScale );
+
+        m_depthBounds.resize( PG_LIGHT_CLUSTERS_Z );
+        m_xBounds.resize( PG_LIGHT_CLUSTERS_X * PG_LIGHT_CLUSTERS_Z );
+        m_yBounds.resize( PG_LIGHT_CLUSTERS_Y * PG_LIGHT_CLUSTERS_Z );
+        for ( uint32_t z = 0; z < PG_LIGHT_CLUSTERS_Z; ++z )
+        {
+            float d0 = nearPlane * std::pow( farPlane / nearPlane, z / static_cast< float >( PG_LIGHT_CLUSTERS_Z ) );
+            float d1 = nearPlane * std::pow( farPlane / nearPlane, ( z + 1 ) / static_cast< float >( PG_LIGHT_CLUSTERS_Z ) );
+            m_depthBounds[z] = glm::vec2( d0, d1 );
+
+            // The sides of a cluster are planes through the eye, so it is widest at one of its depth ends
+            for ( uint32_t x = 0; x < PG_LIGHT_CLUSTERS_X; ++x )
+            {
+                float ndc0 = -1 + 2.0f * x / PG_LIGHT_CLUSTERS_X;
+                float ndc1 = -1 + 2.0f * ( x + 1 ) / PG_LIGHT_CLUSTERS_X;
+                m_xBounds[z * PG_LIGHT_CLUSTERS_X + x] = tanX * glm::vec2( std::min( ndc0 * d0, ndc0 * d1 ), std::max( ndc1 * d0, ndc1 * d1 ) );
+            }
+            for ( uint32_t y = 0; y < PG_LIGHT_CLUSTERS_Y; ++y )
+            {
+                float ndc0 = -1 + 2.0f * y / PG_LIGHT_CLUSTERS_Y;
+                float ndc1 = -1 + 2.0f * ( y + 1 ) / PG_LIGHT_CLUSTERS_Y;
+                m_yBounds[z * PG_LIGHT_CLUSTERS_Y + y] = tanY * glm::vec2( std::min( ndc0 * d0, ndc0 * d1 ), std::max( ndc1 * d0, ndc1 * d1 ) );
+            }
+        }
+    }
+
+    void LightClusters::AddLights( const glm::mat4& V, const std::vector< glm::vec4 >& lights, const std::vector< glm::vec4 >* cones,
+        std::vector< uint32_t >& hits, uint32_t* counts )
+    {
+        float tanX = 1 / m_shaderParams.x;
+        float tanY = 1 / m_shaderParams.y;
+        for ( uint32_t lightIndex = 0; lightIndex < static_cast< uint32_t >( lights.size() ); ++lightIndex )
+        {
+            glm::vec3 center = glm::vec3( V * glm::vec4( glm::vec3( lights[lightIndex] ), 1 ) );
+            float radius     = lights[lightIndex].w;
+            float depth      = -center.z;
+            float minDepth   = std::max( depth - radius, m_nearPlane );
+            float maxDepth   = std::min( depth + radius, m_farPlane );
+            if ( minDepth >= maxDepth )
+            {
+                continue;
+            }
+
+            // Clusters that touch the sphere also have to touch the cone. Wide cones are left as spheres
+            bool testCone = false;
+            glm::vec3 coneAxis;
+            float cosAngle = 0, sinAngle = 0;
+            if ( cones && ( *cones )[lightIndex].w < 0.5f * M_PI )
+            {
+                testCone = true;
+                coneAxis = glm::normalize( glm::vec3( V * glm::vec4( glm::vec3( ( *cones )[lightIndex] ), 0 ) ) );
+                cosAngle = std::cos( ( *cones )[lightIndex].w );
+                sinAngle = std::sin( ( *cones )[lightIndex].w );
+            }
+
+            // The screen bounds of the sphere's box. x / depth only grows or shrinks with each of them, so
+            // the extremes are at the corners
+            float minNdcX = std::min( ( center.x - radius ) / minDepth, ( center.x - radius ) / maxDepth ) / tanX;
+            float maxNdcX = std::max( ( center.x + radius ) / minDepth, ( center.x + radius ) / maxDepth ) / tanX;
+            float minNdcY = std::min( ( center.y - radius ) / minDepth, ( center.y - radius ) / maxDepth ) / tanY;
+            float maxNdcY = std::max( ( center.y + radius ) / minDepth, ( center.y + radius ) / maxDepth ) / tanY;
+            if ( maxNdcX < -1 || minNdcX > 1 || maxNdcY < -1 || minNdcY > 1 )
+            {
+                continue;
+            }
+
+            // Padded by a cluster on each side, so that rounding can't drop a cluster the light just touches.
+            // The exact test below throws the extra ones out
+            uint32_t x0 = NdcToCluster( minNdcX, PG_LIGHT_CLUSTERS_X ), x1 = NdcToCluster( maxNdcX, PG_LIGHT_CLUSTERS_X );
+            uint32_t y0 = NdcToCluster( minNdcY, PG_LIGHT_CLUSTERS_Y ), y1 = NdcToCluster( maxNdcY, PG_LIGHT_CLUSTERS_Y );
+            int slice0  = static_cast< int >( std::floor( std::log( minDepth ) * m_shaderParams.z + m_shaderParams.w ) );
+            int slice1  = static_cast< int >( std::floor( std::log( maxDepth ) * m_shaderParams.z + m_shaderParams.w ) );
+            x0 = x0 > 0 ? x0 - 1 : 0;
+            y0 = y0 > 0 ? y0 - 1 : 0;
+            x1 = std::min< uint32_t >( x1 + 1, PG_LIGHT_CLUSTERS_X - 1 );
+            y1 = std::min< uint32_t >( y1 + 1, PG_LIGHT_CLUSTERS_Y - 1 );
+            uint32_t z0 = static_cast< uint32_t >( std::clamp( slice0 - 1, 0, PG_LIGHT_CLUSTERS_Z - 1 ) );
+            uint32_t z1 = static_cast< uint32_t >( std::clamp( slice1 + 1, 0, PG_LIGHT_CLUSTERS_Z - 1 ) );
+
+            // Sphere against the cluster's box. Depth and y are the same across a row, so whole rows get skipped
+            float radiusSquared = radius * radius;
+            for ( uint32_t z = z0; z <= z1; ++z )
+            {
+                float dz = DistanceToRange( depth, m_depthBounds[z] );
+                for ( uint32_t y = y0; y <= y1; ++y )
+                {
+                    float dy  = DistanceToRange( center.y, m_yBounds[z * PG_LIGHT_CLUSTERS_Y + y] );
+                    float dyz = dy * dy + dz * dz;
+                    if ( dyz > radiusSquared )
+                    {
+                        continue;
+                    }
+                    for ( uint32_t x = x0; x <= x1; ++x )
+                    {
+                        const glm::vec2& xBounds = m_xBounds[z * PG_LIGHT_CLUSTERS_X + x];
+                        float dx = DistanceToRange( center.x, xBounds );
+                        if ( dx * dx + dyz > radiusSquared )
+                        {
+                            continue;
+                        }
+                        if ( testCone )
+                        {
+                            // The cluster's bounding sphere, against the cone
+                            const glm::vec2& yBounds     = m_yBounds[z * PG_LIGHT_CLUSTERS_Y + y];
+                            const glm::vec2& depthBounds = m_depthBounds[z];
+                            glm::vec3 halfExtent( 0.5f * ( xBounds.y - xBounds.x ), 0.5f * ( yBounds.y - yBounds.x ), 0.5f * ( depthBounds.y - depthBounds.x ) );
+                            glm::vec3 clusterCenter( 0.5f * ( xBounds.x + xBounds.y ), 0.5f * ( yBounds.x + yBounds.y ), -0.5f * ( depthBounds.x + depthBounds.y ) );
+                            if ( !SphereTouchesCone( clusterCenter - center, glm::length( halfExtent ), coneAxis, cosAngle, sinAngle ) )
+                            {
+                                continue;
+                            }
+                        }
+                        uint32_t cluster = ( z * PG_LIGHT_CLUSTERS_Y + y ) * PG_LIGHT_CLUSTERS_X + x;
+                        hits.push_back( cluster );
+                        hits.push_back( lightIndex );
+                        ++counts[cluster];
+                    }
+                }
+            }
+        }
+    }
+
+    void LightClusters::Assign( const glm::mat4& V, const std::vector< glm::vec4 >& pointLights, const std::vector< glm::vec4 >& spotLights,
+        const std::vector< glm::vec4 >& spotCones )
+    {
+        PG_ASSERT( !m_depthBounds.empty(), "SetProjection has to be called before assigning lights" );
+        PG_ASSERT( pointLights.size() < 0xFFFF && spotLights.size() < 0xFFFF );
+        PG_ASSERT( spotCones.size() == spotLights.size() );
+        m_pointHits.clear();
+        m_spotHits.clear();
+        m_pointCounts.assign( PG_NUM_LIGHT_CLUSTERS, 0 );
+        m_spotCounts.assign( PG_NUM_LIGHT_CLUSTERS, 0 );
+        AddLights( V, pointLights, nullptr, m_pointHits, m_pointCounts.data() );
+        AddLights( V, spotLights, &spotCones, m_spotHits, m_spotCounts.data() );
+
+        m_clusters.resize( PG_NUM_LIGHT_CLUSTERS );
+        uint32_t numIndices = 0;
+        for ( uint32_t cluster = 0; cluster < PG_NUM_LIGHT_CLUSTERS; ++cluster )
+        {
+            uint32_t numPointLights = std::min< uint32_t >( m_pointCounts[cluster], PG_MAX_LIGHTS_PER_CLUSTER );
+            uint32_t numSpotLights  = std::min< uint32_t >( m_spotCounts[cluster], PG_MAX_LIGHTS_PER_CLUSTER - numPointLights );
+            m_clusters[cluster].indexOffset = numIndices;
+            m_clusters[cluster].counts      = numPointLights | ( numSpotLights << 16 );
+            numIndices += numPointLights + numSpotLights;
+            // reused as how many of each have been written so far
+            m_pointCounts[cluster] = 0;
+            m_spotCounts[cluster]  = 0;
+        }
+
+        // The hits are in light order, so every cluster's lists come out sorted
+        m_lightIndices.resize( numIndices );
+        for ( size_t i = 0; i < m_pointHits.size(); i += 2 )
+        {
+            uint32_t cluster = m_pointHits[i];
+            const Gpu::LightCluster& c = m_clusters[cluster];
+            if ( m_pointCounts[cluster] < ( c.counts & 0xFFFF ) )
+            {
+                m_lightIndices[c.indexOffset + m_pointCounts[cluster]++] = m_pointHits[i + 1];
+            }
+        }
+        for ( size_t i = 0; i < m_spotHits.size(); i += 2 )
+        {
+            uint32_t cluster = m_spotHits[i];
+            const Gpu::LightCluster& c = m_clusters[cluster];
+            if ( m_spotCounts[cluster] < ( c.counts >> 16 ) )
+            {
+                m_lightIndices[c.indexOffset + ( c.counts & 0xFFFF ) + m_spotCounts[cluster]++] = m_spotHits[i + 1];
+            }
+        }
+    }
+
+} // namespace Gfx
+} // namespace Progression
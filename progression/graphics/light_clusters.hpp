@@ -0,0 +1,66 @@
+#pragma once
+
+#include "core/math.hpp"
+#include "graphics/shader_c_shared/lights.h"
+#include <cstdint>
+#include <vector>
+
+namespace Progression
+{
+namespace Gfx
+{
+
+    // Sorts the point and spot lights into the clusters of the view frustum, so that the lighting
+    // shaders only loop over the lights that can reach the cluster a pixel is in. Each light is only
+    // tested against the clusters inside of its bounds on the screen and in depth, so assigning scales
+    // with how many clusters the lights cover, not with lights * clusters.
+    // Like the render graph, this never touches the device, so it can be run and checked on the CPU
+    class LightClusters
+    {
+    public:
+        LightClusters() = default;
+
+        // Rebuilds the view space bounds of the clusters. Does nothing if the projection didn't change
+        void SetProjection( float fov, float aspectRatio, float nearPlane, float farPlane );
+
+        // The lights are their world space positions and radii (PointLight::positionAndRadius). The spot
+        // lights also need their cones (SpotLight::directionAndCutoff), one per spot light
+        void Assign( const glm::mat4& V, const std::vector< glm::vec4 >& pointLights, const std::vector< glm::vec4 >& spotLights,
+            const std::vector< glm::vec4 >& spotCones );
+
+        // PG_NUM_LIGHT_CLUSTERS of them, x fastest, then y, then z
+        const std::vector< Gpu::LightCluster >& GetClusters() const { return m_clusters; }
+        // At most PG_NUM_LIGHT_CLUSTERS * PG_MAX_LIGHTS_PER_CLUSTER
+        const std::vector< uint32_t >& GetLightIndices() const { return m_lightIndices; }
+        // SceneConstantBufferData::lightClusterParams, for finding a position's cluster in the shaders
+        glm::vec4 GetShaderParams() const { return m_shaderParams; }
+
+    private:
+        // cones is nullptr for the point lights
+        void AddLights( const glm::mat4& V, const std::vector< glm::vec4 >& lights, const std::vector< glm::vec4 >* cones,
+            std::vector< uint32_t >& hits, uint32_t* counts );
+
+        float m_fov         = 0;
+        float m_aspectRatio = 0;
+        float m_nearPlane   = 0;
+        float m_farPlane    = 0;
+        glm::vec4 m_shaderParams = glm::vec4( 0 );
+
+        // View space bounds of the clusters, with depth positive into the screen. X only depends on the
+        // column and slice, y on the row and slice, and depth on the slice
+        std::vector< glm::vec2 > m_xBounds; // PG_LIGHT_CLUSTERS_X per slice
+        std::vector< glm::vec2 > m_yBounds; // PG_LIGHT_CLUSTERS_Y per slice
+        std::vector< glm::vec2 > m_depthBounds;
+
+        // Every ( cluster, light ) pair that touches, found before the lists are laid out
+        std::vector< uint32_t > m_pointHits;
+        std::vector< uint32_t > m_spotHits;
+        std::vector< uint32_t > m_pointCounts;
+        std::vector< uint32_t > m_spotCounts;
+
+        std::vector< Gpu::LightCluster > m_clusters;
+        std::vector< uint32_t > m_lightIndices;
+    };
+
+} // namespace Gfx
+} // namespace Progression
@@ -0,0 +1,280 @@
+#include "graphics/occlusion_culling.hpp"
+#include "core/assert.hpp"
+#include "core/core_defines.hpp"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+// The size of a level, where each texel covers 2^level texels of level 0
+static uint32_t LevelSize( uint32_t size, uint32_t level )
+{
+    return std::max( ( size + ( 1u << level ) - 1 ) >> level, 1u );
+}
+
+static glm::vec3 BoxCorner( const Progression::AABB& box, int corner )
+{
+    return glm::vec3( corner & 1 ? box.max.x : box.min.x, corner & 2 ? box.max.y : box.min.y, corner & 4 ? box.max.z : box.min.z );
+}
+
+// Two triangles for each face of the corners from BoxCorner
+static const uint32_t s_boxIndices[] =
+{
+    0, 2, 6, 0, 6, 4, // -x
+    1, 3, 7, 1, 7, 5, // +x
+    0, 1, 5, 0, 5, 4, // -y
+    2, 3, 7, 2, 7, 6, // +y
+    0, 1, 3, 0, 3, 2, // -z
+    4, 5, 7, 4, 7, 6, // +z
+};
+
+static float EdgeFunction( const glm::vec3& a, const glm::vec3& b, float x, float y )
+{
+    return ( b.x - a.x ) * ( y - a.y ) - ( b.y - a.y ) * ( x - a.x );
+}
+
+namespace Progression
+{
+namespace Gfx
+{
+
+    void DepthPyramid::Build( const float* depths, uint32_t width, uint32_t height, const glm::mat4& VP )
+    {
+        PG_ASSERT( depths && width > 0 && height > 0 );
+        m_width  = width;
+        m_height = height;
+        m_VP     = VP;
+
+        uint32_t numLevels = 1;
+        while ( LevelSize( width, numLevels - 1 ) > 1 || LevelSize( height, numLevels - 1 ) > 1 )
+        {
+            ++numLevels;
+        }
+        m_levels.resize( numLevels );
+        m_levels[0].assign( depths, depths + width * height );
+
+        for ( uint32_t level = 1; level < numLevels; ++level )
+        {
+            const std::vector< float >& src = m_levels[level - 1];
+            uint32_t srcWidth  = LevelSize( width, level - 1 );
+            uint32_t srcHeight = LevelSize( height, level - 1 );
+            uint32_t dstWidth  = LevelSize( width, level );
+            uint32_t dstHeight = LevelSize( height, level );
+            std::vector< float >& dst = m_levels[level];
+            dst.resize( dstWidth * dstHeight );
+            for ( uint32_t y = 0; y < dstHeight; ++y )
+            {
+                // The last row and column only cover one texel of odd sized levels
+                uint32_t y0 = 2 * y;
+                uint32_t y1 = std::min( 2 * y + 1, srcHeight - 1 );
+                for ( uint32_t x = 0; x < dstWidth; ++x )
+                {
+                    uint32_t x0 = 2 * x;
+                    uint32_t x1 = std::min( 2 * x + 1, srcWidth - 1 );
+                    dst[y * dstWidth + x] = std::max( std::max( src[y0 * srcWidth + x0], src[y0 * srcWidth + x1] ),
+                                                      std::max( src[y1 * srcWidth + x0], src[y1 * srcWidth + x1] ) );
+                }
+            }
+        }
+    }
+
+    void DepthPyramid::Clear()
+    {
+        m_levels.clear();
+        m_width  = 0;
+        m_height = 0;
+    }
+
+    bool DepthPyramid::IsBoxVisible( const AABB& box ) const
+    {
+        if ( m_levels.empty() )
+        {
+            return true;
+        }
+
+        glm::vec2 minUV( FLT_MAX );
+        glm::vec2 maxUV( -FLT_MAX );
+        float minDepth = FLT_MAX;
+        for ( int corner = 0; corner < 8; ++corner )
+        {
+            glm::vec4 p = m_VP * glm::vec4( BoxCorner( box, corner ), 1 );
+            // Reaches past the near plane, where its screen bounds stop meaning anything
+            if ( p.z < 0 )
+            {
+                return true;
+            }
+            glm::vec3 ndc = glm::vec3( p ) / p.w;
+            glm::vec2 uv( 0.5f + 0.5f * ndc.x, 0.5f - 0.5f * ndc.y );
+            minUV    = glm::min( minUV, uv );
+            maxUV    = glm::max( maxUV, uv );
+            minDepth = std::min( minDepth, ndc.z );
+        }
+        if ( minUV.x < 0 || minUV.y < 0 || maxUV.x > 1 || maxUV.y > 1 )
+        {
+            return true;
+        }
+
+        uint32_t x0 = std::min( static_cast< uint32_t >( minUV.x * m_width ), m_width - 1 );
+        uint32_t x1 = std::min( static_cast< uint32_t >( maxUV.x * m_width ), m_width - 1 );
+        uint32_t y0 = std::min( static_cast< uint32_t >( minUV.y * m_height ), m_height - 1 );
+        uint32_t y1 = std::min( static_cast< uint32_t >( maxUV.y * m_height ), m_height - 1 );
+
+        // The lowest level where the box's bounds touch at most 2x2 texels
+        uint32_t level = 0;
+        while ( level + 1 < m_levels.size() && ( ( x1 >> level ) - ( x0 >> level ) > 1 || ( y1 >> level ) - ( y0 >> level ) > 1 ) )
+        {
+            ++level;
+        }
+
+        const std::vector< float >& depths = m_levels[level];
+        uint32_t levelWidth = LevelSize( m_width, level );
+        float maxDepth      = 0;
+        for ( uint32_t y = y0 >> level; y <= ( y1 >> level ); ++y )
+        {
+            for ( uint32_t x = x0 >> level; x <= ( x1 >> level ); ++x )
+            {
+                maxDepth = std::max( maxDepth, depths[y * levelWidth + x] );
+            }
+        }
+
+        return minDepth <= maxDepth;
+    }
+
+    uint32_t DepthPyramid::GetWidth( uint32_t level ) const
+    {
+        PG_ASSERT( level < m_levels.size() );
+        return LevelSize( m_width, level );
+    }
+
+    uint32_t DepthPyramid::GetHeight( uint32_t level ) const
+    {
+        PG_ASSERT( level < m_levels.size() );
+        return LevelSize( m_height, level );
+    }
+
+    float DepthPyramid::GetDepth( uint32_t level, uint32_t x, uint32_t y ) const
+    {
+        PG_ASSERT( x < GetWidth( level ) && y < GetHeight( level ) );
+        return m_levels[level][y * GetWidth( level ) + x];
+    }
+
+    void SoftwareDepthRasterizer::Init( uint32_t width, uint32_t height )
+    {
+        PG_ASSERT( width > 0 && height > 0 );
+        m_width  = width;
+        m_height = height;
+        Clear();
+    }
+
+    void SoftwareDepthRasterizer::Clear()
+    {
+        m_depths.assign( m_width * m_height, 1.0f );
+    }
+
+    void SoftwareDepthRasterizer::DrawTriangles( const glm::mat4& MVP, const glm::vec3* positions, const uint32_t* indices, uint32_t numIndices )
+    {
+        Rasterize( MVP, positions, indices, numIndices, m_depths.data() );
+    }
+
+    void SoftwareDepthRasterizer::DrawBox( const glm::mat4& VP, const AABB& box )
+    {
+        glm::vec3 corners[8];
+        for ( int corner = 0; corner < 8; ++corner )
+        {
+            corners[corner] = BoxCorner( box, corner );
+        }
+        Rasterize( VP, corners, s_boxIndices, ARRAY_COUNT( s_boxIndices ), m_depths.data() );
+    }
+
+    bool SoftwareDepthRasterizer::IsBoxVisible( const glm::mat4& VP, const AABB& box ) const
+    {
+        glm::vec3 corners[8];
+        for ( int corner = 0; corner < 8; ++corner )
+        {
+            corners[corner] = BoxCorner( box, corner );
+        }
+        return Rasterize( VP, corners, s_boxIndices, ARRAY_COUNT( s_boxIndices ), nullptr );
+    }
+
+    bool SoftwareDepthRasterizer::Rasterize( const glm::mat4& MVP, const glm::vec3* positions, const uint32_t* indices, uint32_t numIndices, float* dstDepths ) const
+    {
+        PG_ASSERT( numIndices % 3 == 0 );
+        for ( uint32_t tri = 0; tri < numIndices; tri += 3 )
+        {
+            glm::vec3 v[3];
+            bool crossesNearPlane = false;
+            for ( int i = 0; i < 3; ++i )
+            {
+                glm::vec4 p = MVP * glm::vec4( positions[indices[tri + i]], 1 );
+                if ( p.z < 0 )
+                {
+                    crossesNearPlane = true;
+                    break;
+                }
+                v[i] = glm::vec3( ( 0.5f + 0.5f * p.x / p.w ) * m_width, ( 0.5f - 0.5f * p.y / p.w ) * m_height, p.z / p.w );
+            }
+            if ( crossesNearPlane )
+            {
+                // Skipping it is only conservative for occluders. Whatever is being tested is right in front of the camera
+                if ( !dstDepths )
+                {
+                    return true;
+                }
+                continue;
+            }
+
+            float area = EdgeFunction( v[0], v[1], v[2].x, v[2].y );
+            if ( area == 0 )
+            {
+                continue;
+            }
+
+            // Every pixel whose center is inside of the triangle's bounds
+            float minX = std::min( { v[0].x, v[1].x, v[2].x } );
+            float maxX = std::max( { v[0].x, v[1].x, v[2].x } );
+            float minY = std::min( { v[0].y, v[1].y, v[2].y } );
+            float maxY = std::max( { v[0].y, v[1].y, v[2].y } );
+            int x0 = std::max( static_cast< int >( std::ceil( minX - 0.5f ) ), 0 );
+            int x1 = std::min( static_cast< int >( std::floor( maxX - 0.5f ) ), static_cast< int >( m_width ) - 1 );
+            int y0 = std::max( static_cast< int >( std::ceil( minY - 0.5f ) ), 0 );
+            int y1 = std::min( static_cast< int >( std::floor( maxY - 0.5f ) ), static_cast< int >( m_height ) - 1 );
+            for ( int y = y0; y <= y1; ++y )
+            {
+                for ( int x = x0; x <= x1; ++x )
+                {
+                    float px = x + 0.5f;
+                    float py = y + 0.5f;
+                    float b0 = EdgeFunction( v[1], v[2], px, py ) / area;
+                    float b1 = EdgeFunction( v[2], v[0], px, py ) / area;
+                    float b2 = EdgeFunction( v[0], v[1], px, py ) / area;
+                    if ( b0 < 0 || b1 < 0 || b2 < 0 )
+                    {
+                        continue;
+                    }
+
+                    // Depth is linear in screen space after the divide. Past the far plane it gets clipped
+                    float depth = b0 * v[0].z + b1 * v[1].z + b2 * v[2].z;
+                    if ( depth > 1 )
+                    {
+                        continue;
+                    }
+                    float stored = m_depths[y * m_width + x];
+                    if ( !dstDepths )
+                    {
+                        if ( depth <= stored )
+                        {
+                            return true;
+                        }
+                    }
+                    else if ( depth < stored )
+                    {
+                        dstDepths[y * m_width + x] = depth;
+                    }
+                }
+            }
+        }
+
+        return false;
+    }
+
+} // namespace Gfx
+} // namespace Progression
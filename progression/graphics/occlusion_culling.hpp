@@ -0,0 +1,83 @@
+#pragma once
+
+#include "core/bounding_box.hpp"
+#include "core/math.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace Progression
+{
+namespace Gfx
+{
+
+    // A hierarchical Z buffer. Level 0 is a low resolution copy of a frame's depth buffer, where every texel
+    // keeps the farthest depth of the screen pixels under it, and every level above keeps the farthest depth
+    // of the 2x2 texels under it. A box is hidden if its closest point is behind all of those depths, which
+    // only takes checking the 2x2 texels of the level it is about one texel wide in.
+    // The depths come from an earlier frame, so boxes get projected with the view projection that frame was
+    // drawn with, and anything that was off of that frame's screen is visible, since nothing is known about
+    // what was in front of it. Like the light clusters, this never touches the device, so it can be built
+    // from the SoftwareDepthRasterizer and checked on the CPU
+    class DepthPyramid
+    {
+    public:
+        DepthPyramid() = default;
+
+        // Depths are in [0, 1], row by row with the top of the screen first, like the gbuffer's depth
+        void Build( const float* depths, uint32_t width, uint32_t height, const glm::mat4& VP );
+        // Nothing is occluded until the next Build
+        void Clear();
+        bool IsBuilt() const { return !m_levels.empty(); }
+
+        // Whether any part of the world space box could be in front of what was drawn
+        bool IsBoxVisible( const AABB& box ) const;
+
+        uint32_t GetNumLevels() const { return static_cast< uint32_t >( m_levels.size() ); }
+        uint32_t GetWidth( uint32_t level ) const;
+        uint32_t GetHeight( uint32_t level ) const;
+        float GetDepth( uint32_t level, uint32_t x, uint32_t y ) const;
+        const glm::mat4& GetVP() const { return m_VP; }
+
+    private:
+        // Texel x of level n + 1 covers texels 2x and 2x + 1 of level n, so level n's texel for a level 0
+        // texel is always just the level 0 coordinate shifted down by n, even when the sizes are odd
+        std::vector< std::vector< float > > m_levels;
+        uint32_t m_width  = 0;
+        uint32_t m_height = 0;
+        glm::mat4 m_VP    = glm::mat4( 1 );
+    };
+
+    // A depth only triangle rasterizer, the reference that the DepthPyramid gets checked against when there
+    // is no device. It fills the same pixels the gbuffer does: pixel centers, depth in [0, 1], top row first.
+    // Triangles that cross the near plane get skipped instead of clipped, which only ever leaves holes in
+    // the occluders, so culling against what it draws stays conservative
+    class SoftwareDepthRasterizer
+    {
+    public:
+        SoftwareDepthRasterizer() = default;
+
+        void Init( uint32_t width, uint32_t height );
+        // Back to the clear depth of 1
+        void Clear();
+        void DrawTriangles( const glm::mat4& MVP, const glm::vec3* positions, const uint32_t* indices, uint32_t numIndices );
+        void DrawBox( const glm::mat4& VP, const AABB& box );
+        // The exact answer DepthPyramid::IsBoxVisible approximates: whether any pixel of the box would pass
+        // the depth test. Doesn't draw the box
+        bool IsBoxVisible( const glm::mat4& VP, const AABB& box ) const;
+
+        const std::vector< float >& GetDepths() const { return m_depths; }
+        uint32_t GetWidth() const { return m_width; }
+        uint32_t GetHeight() const { return m_height; }
+
+    private:
+        // Writes the closer depths into dstDepths. Without any, it only tests, and returns true as soon as
+        // any pixel passes
+        bool Rasterize( const glm::mat4& MVP, const glm::vec3* positions, const uint32_t* indices, uint32_t numIndices, float* dstDepths ) const;
+
+        std::vector< float > m_depths;
+        uint32_t m_width  = 0;
+        uint32_t m_height = 0;
+    };
+
+} // namespace Gfx
+} // namespace Progression
@@ -0,0 +1,194 @@
+#include "graphics/pipeline_cache.hpp"
+#include "core/platform_defines.hpp"
+#include "graphics/vulkan.hpp"
+#include "utils/logger.hpp"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string_view>
+#include <vector>
+
+#define PG_PIPELINE_CACHE_DIR PG_RESOURCE_DIR "cache/pipelines/"
+
+static constexpr uint32_t PIPELINE_CACHE_MAGIC   = 0x50474350; // 'PGCP'
+static constexpr uint32_t PIPELINE_CACHE_VERSION = 1;
+
+namespace Progression
+{
+namespace Gfx
+{
+namespace PipelineCache
+{
+
+    // Written in front of the driver's data. The driver checks its own header too, but that says nothing
+    // about the shaders, so without this a recompiled shader would leave dead entries in the cache forever
+    struct FileHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t vendorID;
+        uint32_t deviceID;
+        uint32_t driverVersion;
+        uint8_t uuid[VK_UUID_SIZE];
+        uint64_t shaderHash;
+        uint64_t dataSize;
+    };
+
+    static VkPipelineCache s_cache = VK_NULL_HANDLE;
+    static FileHeader s_header;
+
+    // The pipelines are built from the compiled shaders, so they change whenever any of those files do.
+    // Order independent, since the directory iteration order isn't specified
+    static uint64_t HashCompiledShaders()
+    {
+        namespace fs = std::filesystem;
+
+        uint64_t hash = 0;
+        std::error_code ec;
+        for ( const auto& entry : fs::directory_iterator( PG_RESOURCE_DIR "cache/shaders/", ec ) )
+        {
+            std::string filename = entry.path().filename().string();
+            if ( !entry.is_regular_file() || filename.rfind( "settings_", 0 ) == 0 )
+            {
+                continue;
+            }
+            std::ifstream in( entry.path(), std::ios::binary );
+            std::string contents( ( std::istreambuf_iterator< char >( in ) ), std::istreambuf_iterator< char >() );
+            uint64_t fileHash = std::hash< std::string >{}( filename ) * 31 + std::hash< std::string_view >{}( contents );
+            hash += fileHash * 0x9E3779B97F4A7C15ull;
+        }
+
+        return hash;
+    }
+
+    static std::string GetFilename()
+    {
+        const auto& props = g_renderState.physicalDeviceInfo.deviceProperties;
+        return PG_PIPELINE_CACHE_DIR + std::to_string( props.vendorID ) + "_" + std::to_string( props.deviceID ) + ".bin";
+    }
+
+    // Returns the driver data in the file, or nothing if it was written for a different device, driver or set of shaders
+    static std::vector< char > LoadCacheData( const std::string& filename )
+    {
+        std::ifstream in( filename, std::ios::binary );
+        if ( !in )
+        {
+            return {};
+        }
+
+        FileHeader header;
+        if ( !in.read( reinterpret_cast< char* >( &header ), sizeof( header ) ) )
+        {
+            LOG_WARN( "Pipeline cache file '", filename, "' is truncated, ignoring it" );
+            return {};
+        }
+        if ( header.magic != s_header.magic || header.version != s_header.version ||
+             header.vendorID != s_header.vendorID || header.deviceID != s_header.deviceID ||
+             header.driverVersion != s_header.driverVersion || memcmp( header.uuid, s_header.uuid, VK_UUID_SIZE ) )
+        {
+            LOG( "Pipeline cache was saved by a different device or driver, rebuilding it" );
+            return {};
+        }
+        if ( header.shaderHash != s_header.shaderHash )
+        {
+            LOG( "Shaders changed since the pipeline cache was saved, rebuilding it" );
+            return {};
+        }
+
+        std::vector< char > data( header.dataSize );
+        if ( !in.read( data.data(), header.dataSize ) )
+        {
+            LOG_WARN( "Pipeline cache file '", filename, "' is truncated, ignoring it" );
+            return {};
+        }
+
+        return data;
+    }
+
+    void Init()
+    {
+        const auto& props      = g_renderState.physicalDeviceInfo.deviceProperties;
+        s_header               = {};
+        s_header.magic         = PIPELINE_CACHE_MAGIC;
+        s_header.version       = PIPELINE_CACHE_VERSION;
+        s_header.vendorID      = props.vendorID;
+        s_header.deviceID      = props.deviceID;
+        s_header.driverVersion = props.driverVersion;
+        memcpy( s_header.uuid, props.pipelineCacheUUID, VK_UUID_SIZE );
+        s_header.shaderHash    = HashCompiledShaders();
+
+        std::vector< char > data = LoadCacheData( GetFilename() );
+
+        VkPipelineCacheCreateInfo info = {};
+        info.sType           = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+        info.initialDataSize = data.size();
+        info.pInitialData    = data.empty() ? nullptr : data.data();
+        VkResult ret = vkCreatePipelineCache( g_renderState.device.GetHandle(), &info, nullptr, &s_cache );
+        if ( ret != VK_SUCCESS && !data.empty() )
+        {
+            LOG_WARN( "Driver rejected the saved pipeline cache, starting with an empty one" );
+            info.initialDataSize = 0;
+            info.pInitialData    = nullptr;
+            ret = vkCreatePipelineCache( g_renderState.device.GetHandle(), &info, nullptr, &s_cache );
+        }
+        if ( ret != VK_SUCCESS )
+        {
+            LOG_WARN( "Could not create the pipeline cache, pipelines will be compiled without one" );
+            s_cache = VK_NULL_HANDLE;
+            return;
+        }
+
+        if ( !data.empty() )
+        {
+            LOG( "Seeded pipeline cache with ", data.size() / 1024, "KB" );
+        }
+    }
+
+    void Shutdown()
+    {
+        if ( s_cache == VK_NULL_HANDLE )
+        {
+            return;
+        }
+
+        VkDevice device = g_renderState.device.GetHandle();
+        size_t size     = 0;
+        std::vector< char > data;
+        if ( vkGetPipelineCacheData( device, s_cache, &size, nullptr ) == VK_SUCCESS && size > 0 )
+        {
+            data.resize( size );
+            if ( vkGetPipelineCacheData( device, s_cache, &size, data.data() ) != VK_SUCCESS )
+            {
+                data.clear();
+            }
+        }
+        vkDestroyPipelineCache( device, s_cache, nullptr );
+        s_cache = VK_NULL_HANDLE;
+
+        if ( data.empty() )
+        {
+            return;
+        }
+
+        std::error_code ec;
+        std::filesystem::create_directories( PG_PIPELINE_CACHE_DIR, ec );
+        std::string filename = GetFilename();
+        std::ofstream out( filename, std::ios::binary );
+        if ( !out )
+        {
+            LOG_WARN( "Could not open pipeline cache file '", filename, "' for writing" );
+            return;
+        }
+        s_header.dataSize = size;
+        out.write( reinterpret_cast< const char* >( &s_header ), sizeof( s_header ) );
+        out.write( data.data(), size );
+    }
+
+    VkPipelineCache GetHandle()
+    {
+        return s_cache;
+    }
+
+} // namespace PipelineCache
+} // namespace Gfx
+} // namespace Progression
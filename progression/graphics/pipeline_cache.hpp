@@ -0,0 +1,24 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+namespace Progression
+{
+namespace Gfx
+{
+
+// One VkPipelineCache shared by every pipeline the engine creates. It gets seeded from disk on startup
+// and written back on shutdown, so only the first launch has to compile every pipeline from SPIR-V.
+// The saved data is only used when the device UUID, driver version and compiled shaders all match
+namespace PipelineCache
+{
+
+    void Init();
+    // Saves the cache data before destroying it. Needs to happen before the device gets freed
+    void Shutdown();
+
+    VkPipelineCache GetHandle();
+
+} // namespace PipelineCache
+} // namespace Gfx
+} // namespace Progression
@@ -0,0 +1,595 @@
+#include "graphics/render_graph.hpp"
+#include "core/assert.hpp"
+#include "utils/logger.hpp"
+#include <algorithm>
+
+static uint64_t AlignUp( uint64_t x, uint64_t alignment )
+{
+    return ( x + alignment - 1 ) & ~( alignment - 1 );
+}
+
+namespace Progression
+{
+namespace Gfx
+{
+
+    struct UsageInfo
+    {
+        ImageLayout layout;
+        VkPipelineStageFlags stages;
+        VkAccessFlags readAccess;
+        VkAccessFlags writeAccess;
+        VkImageUsageFlags imageUsage;
+    };
+
+    static const UsageInfo s_usageInfo[] =
+    {
+        // COLOR_ATTACHMENT
+        { ImageLayout::COLOR_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+          VK_ACCESS_COLOR_ATTACHMENT_READ_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT },
+        // DEPTH_ATTACHMENT
+        { ImageLayout::DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+          VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT },
+        // SAMPLED
+        { ImageLayout::SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+          VK_ACCESS_SHADER_READ_BIT, 0, VK_IMAGE_USAGE_SAMPLED_BIT },
+        // SAMPLED_COMPUTE
+        { ImageLayout::SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+          VK_ACCESS_SHADER_READ_BIT, 0, VK_IMAGE_USAGE_SAMPLED_BIT },
+        // STORAGE_COMPUTE
+        { ImageLayout::GENERAL, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+          VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_USAGE_STORAGE_BIT },
+    };
+    static_assert( sizeof( s_usageInfo ) / sizeof( s_usageInfo[0] ) == static_cast< size_t >( ResourceUsage::NUM_RESOURCE_USAGES ), "Missing usage info" );
+
+    // Every texture a pass touches, flattened out of its attachments, inputs and storage outputs
+    struct TextureUse
+    {
+        RenderGraph::TextureHandle texture;
+        ResourceUsage usage;
+        bool loadsContents;
+        bool writes;
+    };
+
+    static std::vector< TextureUse > GetUses( const RenderGraph::Pass& pass )
+    {
+        std::vector< TextureUse > uses;
+        for ( const auto& attach : pass.GetColorOutputs() )
+        {
+            uses.push_back( { attach.texture, ResourceUsage::COLOR_ATTACHMENT, attach.loadAction == LoadAction::LOAD, true } );
+        }
+        const auto& depth = pass.GetDepthOutput();
+        if ( depth.texture != RenderGraph::INVALID_HANDLE )
+        {
+            uses.push_back( { depth.texture, ResourceUsage::DEPTH_ATTACHMENT, depth.loadAction == LoadAction::LOAD, true } );
+        }
+        for ( const auto& input : pass.GetTextureInputs() )
+        {
+            uses.push_back( { input.texture, input.usage, true, false } );
+        }
+        for ( RenderGraph::TextureHandle texture : pass.GetStorageOutputs() )
+        {
+            uses.push_back( { texture, ResourceUsage::STORAGE_COMPUTE, true, true } );
+        }
+
+        return uses;
+    }
+
+    RenderGraph::Pass& RenderGraph::Pass::AddColorOutput( TextureHandle texture, LoadAction loadAction, const glm::vec4& clearColor )
+    {
+        Attachment attach;
+        attach.texture    = texture;
+        attach.loadAction = loadAction;
+        attach.clearColor = clearColor;
+        m_colorOutputs.push_back( attach );
+        return *this;
+    }
+
+    RenderGraph::Pass& RenderGraph::Pass::SetDepthOutput( TextureHandle texture, LoadAction loadAction, float clearDepth )
+    {
+        m_depthOutput.texture    = texture;
+        m_depthOutput.loadAction = loadAction;
+        m_depthOutput.clearDepth = clearDepth;
+        return *this;
+    }
+
+    RenderGraph::Pass& RenderGraph::Pass::AddTextureInput( TextureHandle texture, ResourceUsage usage )
+    {
+        PG_ASSERT( usage == ResourceUsage::SAMPLED || usage == ResourceUsage::SAMPLED_COMPUTE, "Attachments and storage images are outputs" );
+        m_inputs.push_back( { texture, usage } );
+        return *this;
+    }
+
+    RenderGraph::Pass& RenderGraph::Pass::AddStorageOutput( TextureHandle texture )
+    {
+        m_storageOutputs.push_back( texture );
+        return *this;
+    }
+
+    RenderGraph::Pass& RenderGraph::Pass::SetSecondaryCommandBuffers( bool secondary )
+    {
+        m_secondaryCommandBuffers = secondary;
+        return *this;
+    }
+
+    RenderGraph::Pass& RenderGraph::Pass::SetExecute( const std::function< void( CommandBuffer& ) >& execute )
+    {
+        m_execute = execute;
+        return *this;
+    }
+
+    RenderGraph::TextureHandle RenderGraph::CreateTexture( const std::string& name, PixelFormat format, uint32_t width, uint32_t height )
+    {
+        PG_ASSERT( width > 0 && height > 0, "Transient textures need a size" );
+        TextureDesc desc;
+        desc.name   = name;
+        desc.format = format;
+        desc.width  = width;
+        desc.height = height;
+        m_textures.push_back( desc );
+
+        return static_cast< TextureHandle >( m_textures.size() - 1 );
+    }
+
+    RenderGraph::TextureHandle RenderGraph::ImportTexture( const std::string& name, PixelFormat format, ImageLayout finalLayout, uint32_t width, uint32_t height )
+    {
+        TextureDesc desc;
+        desc.name        = name;
+        desc.format      = format;
+        desc.width       = width;
+        desc.height      = height;
+        desc.imported    = true;
+        desc.finalLayout = finalLayout;
+        m_textures.push_back( desc );
+
+        return static_cast< TextureHandle >( m_textures.size() - 1 );
+    }
+
+    void RenderGraph::MarkOutput( TextureHandle texture, ImageLayout finalLayout )
+    {
+        PG_ASSERT( texture < m_textures.size() );
+        m_textures[texture].output      = true;
+        m_textures[texture].finalLayout = finalLayout;
+    }
+
+    RenderGraph::Pass& RenderGraph::AddPass( const std::string& name )
+    {
+        m_passes.emplace_back();
+        Pass& pass   = m_passes.back();
+        pass.m_name  = name;
+        pass.m_index = static_cast< uint32_t >( m_passes.size() - 1 );
+
+        return pass;
+    }
+
+    bool RenderGraph::Compile( const MemoryRequirementsFunction& getMemoryRequirements, bool aliasing )
+    {
+        if ( !Validate() )
+        {
+            return false;
+        }
+
+        Cull();
+        ComputeLifetimes();
+        PlaceTextures( getMemoryRequirements, aliasing );
+        PlaceBarriers();
+
+        return true;
+    }
+
+    void RenderGraph::Reset()
+    {
+        m_textures.clear();
+        m_passes.clear();
+        m_placements.clear();
+        m_heaps.clear();
+        m_finalBarriers.clear();
+    }
+
+    const RenderGraph::TextureDesc& RenderGraph::GetTextureDesc( TextureHandle texture ) const
+    {
+        PG_ASSERT( texture < m_textures.size() );
+        return m_textures[texture];
+    }
+
+    const RenderGraph::TexturePlacement& RenderGraph::GetPlacement( TextureHandle texture ) const
+    {
+        PG_ASSERT( texture < m_placements.size(), "Graph hasn't been compiled" );
+        return m_placements[texture];
+    }
+
+    const RenderGraph::Pass& RenderGraph::GetPass( uint32_t index ) const
+    {
+        PG_ASSERT( index < m_passes.size() );
+        return m_passes[index];
+    }
+
+    bool RenderGraph::MemoryOverlaps( TextureHandle a, TextureHandle b ) const
+    {
+        const TexturePlacement& pa = GetPlacement( a );
+        const TexturePlacement& pb = GetPlacement( b );
+        if ( pa.heap == INVALID_HANDLE || pa.heap != pb.heap )
+        {
+            return false;
+        }
+
+        return pa.offset < pb.offset + pb.size && pb.offset < pa.offset + pa.size;
+    }
+
+    bool RenderGraph::Validate() const
+    {
+        bool valid = true;
+        for ( const Pass& pass : m_passes )
+        {
+            std::vector< TextureUse > uses = GetUses( pass );
+            for ( size_t i = 0; i < uses.size(); ++i )
+            {
+                if ( uses[i].texture >= m_textures.size() )
+                {
+                    LOG_ERR( "Pass '", pass.m_name, "' uses an invalid texture handle" );
+                    return false;
+                }
+                for ( size_t j = 0; j < i; ++j )
+                {
+                    if ( uses[i].texture == uses[j].texture )
+                    {
+                        LOG_ERR( "Pass '", pass.m_name, "' uses texture '", m_textures[uses[i].texture].name, "' more than once" );
+                        valid = false;
+                    }
+                }
+            }
+
+            if ( pass.m_colorOutputs.size() > 8 )
+            {
+                LOG_ERR( "Pass '", pass.m_name, "' has more than 8 color outputs" );
+                valid = false;
+            }
+            for ( const Attachment& attach : pass.m_colorOutputs )
+            {
+                if ( PixelFormatIsDepthFormat( m_textures[attach.texture].format ) )
+                {
+                    LOG_ERR( "Pass '", pass.m_name, "' uses depth texture '", m_textures[attach.texture].name, "' as a color output" );
+                    valid = false;
+                }
+            }
+            if ( pass.m_depthOutput.texture != INVALID_HANDLE && !PixelFormatIsDepthFormat( m_textures[pass.m_depthOutput.texture].format ) )
+            {
+                LOG_ERR( "Pass '", pass.m_name, "' uses color texture '", m_textures[pass.m_depthOutput.texture].name, "' as its depth output" );
+                valid = false;
+            }
+
+            // Imported textures without a size can only be checked once they are bound
+            uint32_t width = 0, height = 0;
+            for ( const TextureUse& use : uses )
+            {
+                const TextureDesc& desc = m_textures[use.texture];
+                bool isAttachment = use.usage == ResourceUsage::COLOR_ATTACHMENT || use.usage == ResourceUsage::DEPTH_ATTACHMENT;
+                if ( !isAttachment || desc.width == 0 )
+                {
+                    continue;
+                }
+                if ( width == 0 )
+                {
+                    width  = desc.width;
+                    height = desc.height;
+                }
+                else if ( desc.width != width || desc.height != height )
+                {
+                    LOG_ERR( "The attachments of pass '", pass.m_name, "' are not all the same size" );
+                    valid = false;
+                    break;
+                }
+            }
+        }
+
+        return valid;
+    }
+
+    // Walks the passes backwards, tracking which textures still have to hold something when the pass
+    // ends. A pass is only kept if it writes one of those. Overwriting a whole texture (clearing it or
+    // not caring about it) means nothing before that needs to have written it, while reading it or
+    // loading it as an attachment means something does
+    void RenderGraph::Cull()
+    {
+        std::vector< bool > needed( m_textures.size() );
+        for ( size_t i = 0; i < m_textures.size(); ++i )
+        {
+            needed[i] = m_textures[i].output;
+        }
+
+        for ( auto it = m_passes.rbegin(); it != m_passes.rend(); ++it )
+        {
+            Pass& pass = *it;
+            std::vector< TextureUse > uses = GetUses( pass );
+            bool writesAnything = false;
+            bool live           = false;
+            for ( const TextureUse& use : uses )
+            {
+                writesAnything = writesAnything || use.writes;
+                live           = live || ( use.writes && needed[use.texture] );
+            }
+            // A pass that doesn't write any texture is only there for its side effects, so it is always kept
+            pass.m_culled = writesAnything && !live;
+            if ( pass.m_culled )
+            {
+                continue;
+            }
+
+            for ( const TextureUse& use : uses )
+            {
+                if ( use.writes && !use.loadsContents )
+                {
+                    needed[use.texture] = false;
+                }
+            }
+            for ( const TextureUse& use : uses )
+            {
+                if ( use.loadsContents )
+                {
+                    needed[use.texture] = true;
+                }
+            }
+        }
+    }
+
+    void RenderGraph::ComputeLifetimes()
+    {
+        m_placements.clear();
+        m_placements.resize( m_textures.size() );
+        for ( TextureDesc& desc : m_textures )
+        {
+            desc.usage = 0;
+        }
+
+        for ( const Pass& pass : m_passes )
+        {
+            if ( pass.m_culled )
+            {
+                continue;
+            }
+            for ( const TextureUse& use : GetUses( pass ) )
+            {
+                TexturePlacement& placement = m_placements[use.texture];
+                TextureDesc& desc           = m_textures[use.texture];
+                if ( placement.firstPass == INVALID_HANDLE )
+                {
+                    placement.firstPass = pass.m_index;
+                    if ( !desc.imported && use.loadsContents )
+                    {
+                        LOG_WARN( "Pass '", pass.m_name, "' reads transient texture '", desc.name, "' before anything writes it" );
+                    }
+                }
+                placement.lastPass = pass.m_index;
+                desc.usage        |= s_usageInfo[static_cast< int >( use.usage )].imageUsage;
+            }
+        }
+
+        // Outputs are still used after the graph, so nothing that comes after their first use can share their memory
+        for ( size_t i = 0; i < m_textures.size(); ++i )
+        {
+            if ( m_textures[i].output && m_placements[i].firstPass != INVALID_HANDLE )
+            {
+                m_placements[i].lastPass = static_cast< uint32_t >( m_passes.size() );
+                if ( m_textures[i].finalLayout == ImageLayout::TRANSFER_SRC_OPTIMAL )
+                {
+                    m_textures[i].usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+                }
+            }
+        }
+
+        // Nothing reads a transient texture after its last use, so the attachment doesn't have to be written to memory
+        for ( Pass& pass : m_passes )
+        {
+            auto SetStoreAction = [&]( Attachment& attach )
+            {
+                const TextureDesc& desc = m_textures[attach.texture];
+                bool discard = !desc.imported && !desc.output && m_placements[attach.texture].lastPass == pass.m_index;
+                attach.storeAction = discard ? StoreAction::DONT_CARE : StoreAction::STORE;
+            };
+            for ( Attachment& attach : pass.m_colorOutputs )
+            {
+                SetStoreAction( attach );
+            }
+            if ( pass.m_depthOutput.texture != INVALID_HANDLE )
+            {
+                SetStoreAction( pass.m_depthOutput );
+            }
+        }
+    }
+
+    // Places the biggest textures first, each one at the lowest offset that doesn't overlap any texture
+    // already placed in the heap which is alive at the same time as it
+    void RenderGraph::PlaceTextures( const MemoryRequirementsFunction& getMemoryRequirements, bool aliasing )
+    {
+        m_heaps.clear();
+        std::vector< MemoryRequirements > requirements( m_textures.size() );
+        std::vector< TextureHandle > order;
+        for ( TextureHandle i = 0; i < m_textures.size(); ++i )
+        {
+            if ( m_textures[i].imported || m_placements[i].firstPass == INVALID_HANDLE )
+            {
+                continue;
+            }
+            requirements[i]      = getMemoryRequirements( i, m_textures[i] );
+            m_placements[i].size = requirements[i].size;
+            order.push_back( i );
+        }
+        std::stable_sort( order.begin(), order.end(), [&]( TextureHandle a, TextureHandle b ) { return requirements[a].size > requirements[b].size; } );
+
+        std::vector< std::vector< TextureHandle > > heapTextures;
+        for ( TextureHandle texture : order )
+        {
+            const MemoryRequirements& req = requirements[texture];
+            TexturePlacement& placement   = m_placements[texture];
+
+            uint32_t heapIndex = 0;
+            while ( heapIndex < m_heaps.size() && m_heaps[heapIndex].memoryTypeBits != req.memoryTypeBits )
+            {
+                ++heapIndex;
+            }
+            if ( heapIndex == m_heaps.size() )
+            {
+                m_heaps.push_back( {} );
+                m_heaps.back().memoryTypeBits = req.memoryTypeBits;
+                heapTextures.emplace_back();
+            }
+            Heap& heap = m_heaps[heapIndex];
+
+            std::vector< TextureHandle > conflicts;
+            for ( TextureHandle other : heapTextures[heapIndex] )
+            {
+                const TexturePlacement& o = m_placements[other];
+                bool aliveTogether = placement.firstPass <= o.lastPass && o.firstPass <= placement.lastPass;
+                if ( !aliasing || aliveTogether )
+                {
+                    conflicts.push_back( other );
+                }
+            }
+            std::sort( conflicts.begin(), conflicts.end(), [&]( TextureHandle a, TextureHandle b ) { return m_placements[a].offset < m_placements[b].offset; } );
+
+            uint64_t offset = 0;
+            for ( TextureHandle other : conflicts )
+            {
+                const TexturePlacement& o = m_placements[other];
+                if ( AlignUp( offset, req.alignment ) + req.size <= o.offset )
+                {
+                    break;
+                }
+                offset = std::max( offset, o.offset + o.size );
+            }
+            placement.heap   = heapIndex;
+            placement.offset = AlignUp( offset, req.alignment );
+            heap.size        = std::max( heap.size, placement.offset + placement.size );
+            heap.alignment   = std::max( heap.alignment, req.alignment );
+            heapTextures[heapIndex].push_back( texture );
+        }
+    }
+
+    // Tracks the layout of every texture, along with the stages that used it since the last barrier and
+    // whether any of them wrote it. Reads that follow reads in the same layout don't need a barrier, they
+    // just add their stages to the ones the next write has to wait on
+    void RenderGraph::PlaceBarriers()
+    {
+        struct State
+        {
+            ImageLayout layout          = ImageLayout::UNDEFINED;
+            VkPipelineStageFlags stages = 0;
+            VkAccessFlags writeAccess   = 0;
+            bool used                   = false;
+        };
+        std::vector< State > states( m_textures.size() );
+
+        // The first use of each texture waits on whatever used its memory last, which could be any
+        // texture aliased with it, or itself in the previous frame. Those are only known after the walk
+        struct FirstUse
+        {
+            uint32_t pass    = INVALID_HANDLE;
+            uint32_t barrier = 0;
+        };
+        std::vector< FirstUse > firstUses( m_textures.size() );
+
+        for ( Pass& pass : m_passes )
+        {
+            pass.m_barriers.clear();
+            if ( pass.m_culled )
+            {
+                continue;
+            }
+
+            for ( const TextureUse& use : GetUses( pass ) )
+            {
+                const UsageInfo& info   = s_usageInfo[static_cast< int >( use.usage )];
+                const TextureDesc& desc = m_textures[use.texture];
+                State& state            = states[use.texture];
+
+                Barrier barrier;
+                barrier.texture   = use.texture;
+                barrier.newLayout = info.layout;
+                barrier.dstStages = info.stages;
+                barrier.dstAccess = info.readAccess | ( use.writes ? info.writeAccess : 0 );
+                bool needsBarrier = true;
+                if ( !state.used )
+                {
+                    barrier.oldLayout = desc.imported && use.loadsContents ? desc.finalLayout : ImageLayout::UNDEFINED;
+                    firstUses[use.texture] = { pass.m_index, static_cast< uint32_t >( pass.m_barriers.size() ) };
+                }
+                else if ( state.layout != info.layout || state.writeAccess || use.writes )
+                {
+                    barrier.oldLayout = state.layout;
+                    barrier.srcStages = state.stages;
+                    barrier.srcAccess = state.writeAccess;
+                }
+                else
+                {
+                    needsBarrier = false;
+                }
+
+                if ( needsBarrier )
+                {
+                    pass.m_barriers.push_back( barrier );
+                    state.layout      = info.layout;
+                    state.stages      = info.stages;
+                    state.writeAccess = use.writes ? info.writeAccess : 0;
+                    state.used        = true;
+                }
+                else
+                {
+                    state.stages |= info.stages;
+                }
+            }
+        }
+
+        // Whatever uses the imported textures and outputs after the graph is unknown, so the next frame
+        // has to wait on all of it. Imported textures could also get written outside of the graph
+        m_finalBarriers.clear();
+        std::vector< State > endStates = states;
+        for ( TextureHandle i = 0; i < m_textures.size(); ++i )
+        {
+            const TextureDesc& desc = m_textures[i];
+            const State& state      = states[i];
+            if ( !state.used || !( desc.imported || desc.output ) )
+            {
+                continue;
+            }
+
+            ImageLayout finalLayout = desc.finalLayout == ImageLayout::UNDEFINED ? state.layout : desc.finalLayout;
+            if ( finalLayout != state.layout || state.writeAccess )
+            {
+                Barrier barrier;
+                barrier.texture   = i;
+                barrier.oldLayout = state.layout;
+                barrier.newLayout = finalLayout;
+                barrier.srcStages = state.stages;
+                barrier.srcAccess = state.writeAccess;
+                barrier.dstStages = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+                barrier.dstAccess = VK_ACCESS_MEMORY_READ_BIT | ( desc.imported ? VK_ACCESS_MEMORY_WRITE_BIT : 0 );
+                m_finalBarriers.push_back( barrier );
+            }
+            endStates[i].stages      = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+            endStates[i].writeAccess = desc.imported ? VK_ACCESS_MEMORY_WRITE_BIT : 0;
+        }
+
+        for ( TextureHandle i = 0; i < m_textures.size(); ++i )
+        {
+            if ( firstUses[i].pass == INVALID_HANDLE )
+            {
+                continue;
+            }
+            Barrier& barrier = m_passes[firstUses[i].pass].m_barriers[firstUses[i].barrier];
+            for ( TextureHandle other = 0; other < m_textures.size(); ++other )
+            {
+                if ( states[other].used && ( other == i || MemoryOverlaps( i, other ) ) )
+                {
+                    barrier.srcStages |= endStates[other].stages;
+                    barrier.srcAccess |= endStates[other].writeAccess;
+                }
+            }
+            if ( !barrier.srcStages )
+            {
+                barrier.srcStages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+            }
+        }
+    }
+
+} // namespace Gfx
+} // namespace Progression
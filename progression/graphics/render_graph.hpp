@@ -0,0 +1,197 @@
+#pragma once
+
+#include "graphics/graphics_api/render_pass.hpp"
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace Progression
+{
+namespace Gfx
+{
+
+    class CommandBuffer;
+
+    // How a pass uses a texture. Decides the layout the texture has to be in during the pass, and which
+    // stages and accesses the barriers around the pass have to wait on
+    enum class ResourceUsage : uint8_t
+    {
+        COLOR_ATTACHMENT = 0,
+        DEPTH_ATTACHMENT = 1,
+        SAMPLED          = 2, // sampled in a fragment shader
+        SAMPLED_COMPUTE  = 3, // sampled in a compute shader
+        STORAGE_COMPUTE  = 4, // read and written as a storage image in a compute shader
+
+        NUM_RESOURCE_USAGES
+    };
+
+    // A declarative description of the frame. Passes declare which textures they read and write, and
+    // Compile works out from that:
+    //   - which passes can be culled, because nothing that is used later depends on what they write
+    //   - when every texture is first and last used, and which transient textures can share memory
+    //     because they are never alive at the same time
+    //   - the load and store actions of the attachments
+    //   - every barrier and layout transition between the passes
+    // The graph never calls Vulkan, so its compilation can be run and checked on the CPU without a
+    // device. The RenderGraphExecutor creates the actual resources from the compiled graph and records it.
+    // Textures are either transient, and owned by the graph, or imported from outside of it
+    class RenderGraph
+    {
+    public:
+        using TextureHandle = uint32_t;
+        static constexpr TextureHandle INVALID_HANDLE = 0xFFFFFFFF;
+
+        struct TextureDesc
+        {
+            std::string name;
+            PixelFormat format      = PixelFormat::INVALID;
+            uint32_t width          = 0; // 0 for imported textures that can be any size
+            uint32_t height         = 0;
+            bool imported           = false;
+            bool output             = false; // used after the graph, so it is never culled or aliased
+            // Imported textures are expected to be in this layout when the graph starts, and they get
+            // transitioned back to it at the end. Outputs get transitioned to it too
+            ImageLayout finalLayout = ImageLayout::UNDEFINED;
+            VkImageUsageFlags usage = 0; // filled in by Compile, from every use of the texture
+        };
+
+        struct Attachment
+        {
+            TextureHandle texture   = INVALID_HANDLE;
+            LoadAction loadAction   = LoadAction::CLEAR;
+            StoreAction storeAction = StoreAction::STORE; // filled in by Compile
+            glm::vec4 clearColor    = glm::vec4( 0 );
+            float clearDepth        = 1.0f;
+        };
+
+        struct TextureInput
+        {
+            TextureHandle texture = INVALID_HANDLE;
+            ResourceUsage usage   = ResourceUsage::SAMPLED;
+        };
+
+        struct Barrier
+        {
+            TextureHandle texture          = INVALID_HANDLE;
+            ImageLayout oldLayout          = ImageLayout::UNDEFINED;
+            ImageLayout newLayout          = ImageLayout::UNDEFINED;
+            VkPipelineStageFlags srcStages = 0;
+            VkAccessFlags srcAccess        = 0;
+            VkPipelineStageFlags dstStages = 0;
+            VkAccessFlags dstAccess        = 0;
+        };
+
+        // Passes with attachments run inside of a render pass made from them. Passes without any, like
+        // compute passes, just get the barriers recorded in front of them
+        class Pass
+        {
+            friend class RenderGraph;
+        public:
+            Pass& AddColorOutput( TextureHandle texture, LoadAction loadAction = LoadAction::CLEAR, const glm::vec4& clearColor = glm::vec4( 0 ) );
+            Pass& SetDepthOutput( TextureHandle texture, LoadAction loadAction = LoadAction::CLEAR, float clearDepth = 1.0f );
+            Pass& AddTextureInput( TextureHandle texture, ResourceUsage usage = ResourceUsage::SAMPLED );
+            // Storage images are both read and written, so their contents are always kept
+            Pass& AddStorageOutput( TextureHandle texture );
+            // The render pass only executes secondary command buffers, recorded against GetRenderPass
+            Pass& SetSecondaryCommandBuffers( bool secondary );
+            // Records the pass. The render pass is already begun, and gets ended after this returns
+            Pass& SetExecute( const std::function< void( CommandBuffer& ) >& execute );
+
+            const std::string& GetName() const { return m_name; }
+            uint32_t GetIndex() const { return m_index; }
+            bool IsCulled() const { return m_culled; }
+            bool HasAttachments() const { return !m_colorOutputs.empty() || m_depthOutput.texture != INVALID_HANDLE; }
+            bool UsesSecondaryCommandBuffers() const { return m_secondaryCommandBuffers; }
+            const std::vector< Attachment >& GetColorOutputs() const { return m_colorOutputs; }
+            const Attachment& GetDepthOutput() const { return m_depthOutput; }
+            const std::vector< TextureInput >& GetTextureInputs() const { return m_inputs; }
+            const std::vector< TextureHandle >& GetStorageOutputs() const { return m_storageOutputs; }
+            // The barriers that need to be recorded right before the pass
+            const std::vector< Barrier >& GetBarriers() const { return m_barriers; }
+            const std::function< void( CommandBuffer& ) >& GetExecute() const { return m_execute; }
+
+        private:
+            std::string m_name;
+            uint32_t m_index = 0;
+            std::vector< Attachment > m_colorOutputs;
+            Attachment m_depthOutput;
+            std::vector< TextureInput > m_inputs;
+            std::vector< TextureHandle > m_storageOutputs;
+            bool m_secondaryCommandBuffers = false;
+            std::function< void( CommandBuffer& ) > m_execute;
+
+            // filled in by Compile
+            bool m_culled = false;
+            std::vector< Barrier > m_barriers;
+        };
+
+        struct MemoryRequirements
+        {
+            uint64_t size           = 0;
+            uint64_t alignment      = 1;
+            uint32_t memoryTypeBits = 0;
+        };
+
+        // Called by Compile for every transient texture that survived culling, once its usage flags are known
+        using MemoryRequirementsFunction = std::function< MemoryRequirements( TextureHandle texture, const TextureDesc& desc ) >;
+
+        // One block of memory that transient textures get placed in. Textures are only placed in the
+        // same heap if they can use the same memory types
+        struct Heap
+        {
+            uint64_t size           = 0;
+            uint64_t alignment      = 1; // the largest alignment of any texture placed in it
+            uint32_t memoryTypeBits = 0;
+        };
+
+        struct TexturePlacement
+        {
+            uint32_t heap   = INVALID_HANDLE; // INVALID_HANDLE for imported and culled textures
+            uint64_t offset = 0;
+            uint64_t size   = 0;
+            uint32_t firstPass = INVALID_HANDLE; // INVALID_HANDLE if no live pass uses the texture
+            uint32_t lastPass  = INVALID_HANDLE;
+        };
+
+        TextureHandle CreateTexture( const std::string& name, PixelFormat format, uint32_t width, uint32_t height );
+        TextureHandle ImportTexture( const std::string& name, PixelFormat format, ImageLayout finalLayout, uint32_t width = 0, uint32_t height = 0 );
+        // Keeps the texture and everything it depends on from being culled. The texture is left in finalLayout,
+        // and can be copied out of after the graph if that is TRANSFER_SRC_OPTIMAL
+        void MarkOutput( TextureHandle texture, ImageLayout finalLayout );
+        // Passes run in the order they are added. The reference stays valid until the graph is reset
+        Pass& AddPass( const std::string& name );
+
+        // Returns false if the graph is invalid, after logging why. With aliasing disabled, every
+        // transient texture gets its own range of memory, which helps when tracking down sync bugs
+        bool Compile( const MemoryRequirementsFunction& getMemoryRequirements, bool aliasing = true );
+        void Reset();
+
+        uint32_t NumTextures() const { return static_cast< uint32_t >( m_textures.size() ); }
+        uint32_t NumPasses() const { return static_cast< uint32_t >( m_passes.size() ); }
+        const TextureDesc& GetTextureDesc( TextureHandle texture ) const;
+        const TexturePlacement& GetPlacement( TextureHandle texture ) const;
+        const Pass& GetPass( uint32_t index ) const;
+        const std::vector< Heap >& GetHeaps() const { return m_heaps; }
+        // Transitions the imported textures and outputs to their final layouts. Recorded after the last pass
+        const std::vector< Barrier >& GetFinalBarriers() const { return m_finalBarriers; }
+        // True if the two textures share any memory
+        bool MemoryOverlaps( TextureHandle a, TextureHandle b ) const;
+
+    private:
+        bool Validate() const;
+        void Cull();
+        void ComputeLifetimes();
+        void PlaceTextures( const MemoryRequirementsFunction& getMemoryRequirements, bool aliasing );
+        void PlaceBarriers();
+
+        std::vector< TextureDesc > m_textures;
+        std::deque< Pass > m_passes;
+        std::vector< TexturePlacement > m_placements;
+        std::vector< Heap > m_heaps;
+        std::vector< Barrier > m_finalBarriers;
+    };
+
+} // namespace Gfx
+} // namespace Progression
@@ -0,0 +1,349 @@
+#include "graphics/render_graph_executor.hpp"
+#include "core/assert.hpp"
+#include "graphics/pg_to_vulkan_types.hpp"
+#include "graphics/vulkan.hpp"
+#include "utils/logger.hpp"
+
+namespace Progression
+{
+namespace Gfx
+{
+
+    bool RenderGraphExecutor::Init( RenderGraph* graph, bool aliasing )
+    {
+        PG_ASSERT( graph );
+        m_graph     = graph;
+        m_memoryTag = MemoryManager::GetCurrentMemoryTag();
+        m_transientTextures.clear();
+        m_transientTextures.resize( graph->NumTextures() );
+        PG_ASSERT( m_textures.size() <= graph->NumTextures() );
+        m_textures.resize( graph->NumTextures(), nullptr );
+        for ( RenderGraph::TextureHandle i = 0; i < graph->NumTextures(); ++i )
+        {
+            PG_ASSERT( !m_textures[i] || graph->GetTextureDesc( i ).imported, "Only imported textures can be bound" );
+        }
+
+        // The images have to exist to know how much memory they need, so they get created while compiling
+        auto getMemoryRequirements = [this]( RenderGraph::TextureHandle texture, const RenderGraph::TextureDesc& desc )
+        {
+            ImageDescriptor info;
+            info.type    = ImageType::TYPE_2D;
+            info.format  = desc.format;
+            info.width   = desc.width;
+            info.height  = desc.height;
+            info.usage   = desc.usage;
+            info.sampler = "nearest_clamped_nearest"; // render targets are read texel for texel
+
+            VkMemoryRequirements req;
+            m_transientTextures[texture] = g_renderState.device.NewUnboundTexture( info, req );
+
+            RenderGraph::MemoryRequirements ret;
+            ret.size           = req.size;
+            ret.alignment      = req.alignment;
+            ret.memoryTypeBits = req.memoryTypeBits;
+            return ret;
+        };
+        if ( !graph->Compile( getMemoryRequirements, aliasing ) )
+        {
+            LOG_ERR( "Could not compile the render graph" );
+            return false;
+        }
+
+        uint64_t totalTextureSize = 0;
+        for ( const RenderGraph::Heap& heap : graph->GetHeaps() )
+        {
+            VkMemoryRequirements req;
+            req.size           = heap.size;
+            req.alignment      = heap.alignment;
+            req.memoryTypeBits = heap.memoryTypeBits;
+            m_heaps.push_back( g_renderState.device.AllocateMemory( req, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, true ) );
+            if ( !m_heaps.back().IsValid() )
+            {
+                LOG_ERR( "Could not allocate ", heap.size, " bytes for the render graph's textures" );
+                return false;
+            }
+            MemoryManager::TrackAllocation( MemoryManager::MemoryHeap::GPU, m_memoryTag, heap.size );
+        }
+
+        for ( RenderGraph::TextureHandle i = 0; i < graph->NumTextures(); ++i )
+        {
+            const RenderGraph::TexturePlacement& placement = graph->GetPlacement( i );
+            if ( placement.heap == RenderGraph::INVALID_HANDLE )
+            {
+                continue;
+            }
+            const DeviceAllocation& heap = m_heaps[placement.heap];
+            g_renderState.device.BindTextureMemory( m_transientTextures[i], reinterpret_cast< VkDeviceMemory >( heap.memory ),
+                heap.offset + placement.offset, false, graph->GetTextureDesc( i ).name );
+            m_textures[i]     = &m_transientTextures[i];
+            totalTextureSize += placement.size;
+        }
+        uint64_t totalHeapSize = 0;
+        for ( const RenderGraph::Heap& heap : graph->GetHeaps() )
+        {
+            totalHeapSize += heap.size;
+        }
+        LOG( "Render graph textures need ", totalTextureSize / 1024, "KB, aliased into ", totalHeapSize / 1024, "KB" );
+
+        m_renderPasses.clear();
+        m_renderPasses.resize( graph->NumPasses() );
+        m_framebuffers.clear();
+        m_framebuffers.resize( graph->NumPasses() );
+        m_ownsFramebuffer.assign( graph->NumPasses(), false );
+        for ( uint32_t passIndex = 0; passIndex < graph->NumPasses(); ++passIndex )
+        {
+            const RenderGraph::Pass& pass = graph->GetPass( passIndex );
+            if ( pass.IsCulled() || !pass.HasAttachments() )
+            {
+                continue;
+            }
+
+            RenderPassDescriptor desc;
+            std::vector< const Texture* > attachments;
+            bool rendersToUnbound = false;
+            const auto& colorOutputs = pass.GetColorOutputs();
+            for ( size_t i = 0; i < colorOutputs.size(); ++i )
+            {
+                ColorAttachmentDescriptor& attach = desc.colorAttachmentDescriptors[i];
+                attach.format        = graph->GetTextureDesc( colorOutputs[i].texture ).format;
+                attach.loadAction    = colorOutputs[i].loadAction;
+                attach.storeAction   = colorOutputs[i].storeAction;
+                attach.clearColor    = colorOutputs[i].clearColor;
+                attach.initialLayout = ImageLayout::COLOR_ATTACHMENT_OPTIMAL;
+                attach.finalLayout   = ImageLayout::COLOR_ATTACHMENT_OPTIMAL;
+                attachments.push_back( m_textures[colorOutputs[i].texture] );
+                rendersToUnbound = rendersToUnbound || !attachments.back();
+            }
+            const RenderGraph::Attachment& depth = pass.GetDepthOutput();
+            if ( depth.texture != RenderGraph::INVALID_HANDLE )
+            {
+                DepthAttachmentDescriptor& attach = desc.depthAttachmentDescriptor;
+                attach.format        = graph->GetTextureDesc( depth.texture ).format;
+                attach.loadAction    = depth.loadAction;
+                attach.storeAction   = depth.storeAction;
+                attach.clearValue    = depth.clearDepth;
+                attach.initialLayout = ImageLayout::DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+                attach.finalLayout   = ImageLayout::DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+                attachments.push_back( m_textures[depth.texture] );
+                rendersToUnbound = rendersToUnbound || !attachments.back();
+            }
+
+            m_renderPasses[passIndex] = g_renderState.device.NewRenderPass( desc, pass.GetName() );
+            if ( !m_renderPasses[passIndex] )
+            {
+                LOG_ERR( "Could not create the render pass for render graph pass '", pass.GetName(), "'" );
+                return false;
+            }
+
+            if ( !rendersToUnbound )
+            {
+                m_framebuffers[passIndex] = g_renderState.device.NewFramebuffer( attachments, m_renderPasses[passIndex], pass.GetName() );
+                if ( !m_framebuffers[passIndex] )
+                {
+                    LOG_ERR( "Could not create the framebuffer for render graph pass '", pass.GetName(), "'" );
+                    return false;
+                }
+                m_ownsFramebuffer[passIndex] = true;
+            }
+        }
+
+        return true;
+    }
+
+    void RenderGraphExecutor::Free()
+    {
+        for ( size_t i = 0; i < m_framebuffers.size(); ++i )
+        {
+            if ( m_ownsFramebuffer[i] )
+            {
+                m_framebuffers[i].Free();
+            }
+        }
+        for ( RenderPass& renderPass : m_renderPasses )
+        {
+            if ( renderPass )
+            {
+                renderPass.Free();
+            }
+        }
+        for ( Texture& tex : m_transientTextures )
+        {
+            if ( tex )
+            {
+                tex.Free();
+            }
+        }
+        for ( const DeviceAllocation& heap : m_heaps )
+        {
+            g_renderState.device.FreeMemory( heap );
+            MemoryManager::TrackFree( MemoryManager::MemoryHeap::GPU, m_memoryTag, heap.size );
+        }
+        m_framebuffers.clear();
+        m_ownsFramebuffer.clear();
+        m_renderPasses.clear();
+        m_transientTextures.clear();
+        m_textures.clear();
+        m_heaps.clear();
+        m_beforePass = nullptr;
+        m_afterPass  = nullptr;
+        m_graph = nullptr;
+    }
+
+    void RenderGraphExecutor::BindImportedTexture( RenderGraph::TextureHandle texture, const Texture* tex )
+    {
+        PG_ASSERT( !m_graph || m_graph->GetTextureDesc( texture ).imported );
+        if ( texture >= m_textures.size() )
+        {
+            m_textures.resize( texture + 1, nullptr );
+        }
+        m_textures[texture] = tex;
+    }
+
+    void RenderGraphExecutor::SetFramebuffer( uint32_t pass, const Framebuffer& framebuffer )
+    {
+        PG_ASSERT( pass < m_framebuffers.size() && !m_ownsFramebuffer[pass], "Only passes that render to textures bound after Init take a framebuffer" );
+        m_framebuffers[pass] = framebuffer;
+    }
+
+    void RenderGraphExecutor::SetPassHooks( const PassHook& before, const PassHook& after )
+    {
+        m_beforePass = before;
+        m_afterPass  = after;
+    }
+
+    bool RenderGraphExecutor::WritesUnboundTexture( const RenderGraph::Pass& pass ) const
+    {
+        for ( const auto& attach : pass.GetColorOutputs() )
+        {
+            if ( !m_textures[attach.texture] )
+            {
+                return true;
+            }
+        }
+        if ( pass.GetDepthOutput().texture != RenderGraph::INVALID_HANDLE && !m_textures[pass.GetDepthOutput().texture] )
+        {
+            return true;
+        }
+        for ( RenderGraph::TextureHandle texture : pass.GetStorageOutputs() )
+        {
+            if ( !m_textures[texture] )
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    // All of a pass's barriers go into a single vkCmdPipelineBarrier
+    void RenderGraphExecutor::RecordBarriers( CommandBuffer& cmdBuf, const std::vector< RenderGraph::Barrier >& barriers ) const
+    {
+        std::vector< VkImageMemoryBarrier > imageBarriers;
+        imageBarriers.reserve( barriers.size() );
+        VkPipelineStageFlags srcStages = 0;
+        VkPipelineStageFlags dstStages = 0;
+        for ( const RenderGraph::Barrier& b : barriers )
+        {
+            const Texture* tex = m_textures[b.texture];
+            if ( !tex )
+            {
+                continue;
+            }
+
+            VkImageMemoryBarrier barrier = {};
+            barrier.sType                           = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            barrier.oldLayout                       = PGToVulkanImageLayout( b.oldLayout );
+            barrier.newLayout                       = PGToVulkanImageLayout( b.newLayout );
+            barrier.srcAccessMask                   = b.srcAccess;
+            barrier.dstAccessMask                   = b.dstAccess;
+            barrier.srcQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+            barrier.image                           = tex->GetHandle();
+            barrier.subresourceRange.aspectMask     = PixelFormatIsDepthFormat( tex->GetPixelFormat() ) ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+            barrier.subresourceRange.baseMipLevel   = 0;
+            barrier.subresourceRange.levelCount     = tex->GetMipLevels();
+            barrier.subresourceRange.baseArrayLayer = 0;
+            barrier.subresourceRange.layerCount     = tex->GetArrayLayers();
+            imageBarriers.push_back( barrier );
+            srcStages |= b.srcStages;
+            dstStages |= b.dstStages;
+        }
+
+        if ( !imageBarriers.empty() )
+        {
+            cmdBuf.PipelineBarrier( srcStages, dstStages, 0, nullptr, static_cast< uint32_t >( imageBarriers.size() ), imageBarriers.data() );
+        }
+    }
+
+    void RenderGraphExecutor::Execute( CommandBuffer& cmdBuf ) const
+    {
+        for ( uint32_t passIndex = 0; passIndex < m_graph->NumPasses(); ++passIndex )
+        {
+            const RenderGraph::Pass& pass = m_graph->GetPass( passIndex );
+            if ( pass.IsCulled() )
+            {
+                continue;
+            }
+
+            RecordBarriers( cmdBuf, pass.GetBarriers() );
+            if ( WritesUnboundTexture( pass ) )
+            {
+                continue;
+            }
+
+            if ( m_beforePass )
+            {
+                m_beforePass( cmdBuf, passIndex );
+            }
+            if ( pass.HasAttachments() )
+            {
+                PG_ASSERT( m_framebuffers[passIndex], "No framebuffer was set for pass '" + pass.GetName() + "'" );
+                cmdBuf.BeginRenderPass( m_renderPasses[passIndex], m_framebuffers[passIndex], GetExtent( passIndex ), pass.UsesSecondaryCommandBuffers() );
+            }
+            if ( pass.GetExecute() )
+            {
+                pass.GetExecute()( cmdBuf );
+            }
+            if ( pass.HasAttachments() )
+            {
+                cmdBuf.EndRenderPass();
+            }
+            if ( m_afterPass )
+            {
+                m_afterPass( cmdBuf, passIndex );
+            }
+        }
+
+        RecordBarriers( cmdBuf, m_graph->GetFinalBarriers() );
+    }
+
+    const Texture* RenderGraphExecutor::GetTexture( RenderGraph::TextureHandle texture ) const
+    {
+        PG_ASSERT( texture < m_textures.size() );
+        return m_textures[texture];
+    }
+
+    const RenderPass& RenderGraphExecutor::GetRenderPass( uint32_t pass ) const
+    {
+        PG_ASSERT( pass < m_renderPasses.size() );
+        return m_renderPasses[pass];
+    }
+
+    const Framebuffer& RenderGraphExecutor::GetFramebuffer( uint32_t pass ) const
+    {
+        PG_ASSERT( pass < m_framebuffers.size() );
+        return m_framebuffers[pass];
+    }
+
+    VkExtent2D RenderGraphExecutor::GetExtent( uint32_t pass ) const
+    {
+        const RenderGraph::Pass& graphPass = m_graph->GetPass( pass );
+        RenderGraph::TextureHandle texture = graphPass.GetColorOutputs().empty() ? graphPass.GetDepthOutput().texture : graphPass.GetColorOutputs()[0].texture;
+        const Texture* tex = m_textures[texture];
+        PG_ASSERT( tex );
+
+        return { tex->GetWidth(), tex->GetHeight() };
+    }
+
+} // namespace Gfx
+} // namespace Progression
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "core/memory_manager.hpp"
+#include "graphics/graphics_api/command_buffer.hpp"
+#include "graphics/graphics_api/device_memory.hpp"
+#include "graphics/graphics_api/framebuffer.hpp"
+#include "graphics/graphics_api/render_pass.hpp"
+#include "graphics/graphics_api/texture.hpp"
+#include "graphics/render_graph.hpp"
+#include <functional>
+#include <vector>
+
+namespace Progression
+{
+namespace Gfx
+{
+
+    // Creates the Vulkan objects of a compiled RenderGraph, and records it every frame. The transient
+    // textures are placed in the heaps the graph laid out, so the aliased ones share memory. Every pass
+    // with attachments gets a render pass that leaves them in the layout they started in, since the
+    // graph's barriers do all of the layout transitions.
+    // Imported textures belong to whoever imported them, and have to be bound before Execute. Init creates
+    // the framebuffers of the passes that only render to transient textures and imported textures that
+    // were already bound. Passes that render to textures which get bound later (like a scene's shadow map)
+    // need their framebuffers set along with them
+    class RenderGraphExecutor
+    {
+    public:
+        using PassHook = std::function< void( CommandBuffer& cmdBuf, uint32_t pass ) >;
+
+        RenderGraphExecutor() = default;
+
+        // Compiles the graph, and creates everything the passes that weren't culled need. The graph has
+        // to stay alive until Free
+        bool Init( RenderGraph* graph, bool aliasing = true );
+        void Free();
+
+        // Can be called before Init. Null unbinds it. Passes that write an unbound imported texture are skipped,
+        // but the barriers of their other textures are still recorded, so the layouts stay what the graph expects.
+        // Passes that only read one still run, so it has to be optional in their shaders
+        void BindImportedTexture( RenderGraph::TextureHandle texture, const Texture* tex );
+        void SetFramebuffer( uint32_t pass, const Framebuffer& framebuffer );
+        // Called around every pass that runs, outside of its render pass, after its barriers. Passes that execute
+        // secondary command buffers can't record anything else inside of theirs, so GPU timestamps and debug
+        // marker regions go here
+        void SetPassHooks( const PassHook& before, const PassHook& after );
+
+        // Records the barriers and passes, and then the final barriers. The passes record themselves inside
+        // of their render passes, so they don't begin or end them
+        void Execute( CommandBuffer& cmdBuf ) const;
+
+        const Texture* GetTexture( RenderGraph::TextureHandle texture ) const;
+        // Stays at the same address until Free, so pipelines can be described against it before they are compiled
+        const RenderPass& GetRenderPass( uint32_t pass ) const;
+        const Framebuffer& GetFramebuffer( uint32_t pass ) const;
+        VkExtent2D GetExtent( uint32_t pass ) const;
+
+    private:
+        bool WritesUnboundTexture( const RenderGraph::Pass& pass ) const;
+        void RecordBarriers( CommandBuffer& cmdBuf, const std::vector< RenderGraph::Barrier >& barriers ) const;
+
+        RenderGraph* m_graph = nullptr;
+        std::vector< Texture > m_transientTextures; // indexed by handle. Left empty for imported and culled textures
+        std::vector< const Texture* > m_textures;
+        std::vector< DeviceAllocation > m_heaps;
+        std::vector< RenderPass > m_renderPasses; // indexed by pass
+        std::vector< Framebuffer > m_framebuffers;
+        std::vector< bool > m_ownsFramebuffer;
+        PassHook m_beforePass;
+        PassHook m_afterPass;
+        MemoryManager::MemoryTag m_memoryTag = MemoryManager::MemoryTag::General;
+    };
+
+} // namespace Gfx
+} // namespace Progression
@@ -1,18 +1,29 @@
 #include "graphics/render_system.hpp"
 #include "core/animation_system.hpp"
 #include "core/assert.hpp"
+#include "core/cpu_profiling.hpp"
+#include "core/jobs.hpp"
+#include "core/memory_manager.hpp"
 #include "core/scene.hpp"
 #include "core/time.hpp"
 #include "core/window.hpp"
+#include "components/entity_metadata.hpp"
 #include "components/model_renderer.hpp"
 #include "components/script_component.hpp"
 #include "components/skinned_renderer.hpp"
+#include "components/transform.hpp"
 #include "graphics/debug_marker.hpp"
 #include "graphics/graphics_api.hpp"
+#include "graphics/light_clusters.hpp"
+#include "graphics/occlusion_culling.hpp"
 #include "graphics/pg_to_vulkan_types.hpp"
+#include "graphics/render_graph.hpp"
+#include "graphics/render_graph_executor.hpp"
 #include "graphics/shader_c_shared/defines.h"
 #include "graphics/shader_c_shared/structs.h"
+#include "graphics/shadow_cascades.hpp"
 #include "graphics/texture_manager.hpp"
+#include "graphics/upload_manager.hpp"
 #include "graphics/vulkan.hpp"
 #include "resource/resource_manager.hpp"
 #include "resource/image.hpp"
@@ -20,6 +31,7 @@
 #include "resource/shader.hpp"
 #include "utils/logger.hpp"
 #include <array>
+#include <functional>
 #include <random>
 #include <unordered_map>
 
@@ -65,20 +77,91 @@ namespace RenderSystem
 } // namespace Progression
 
 static Window* s_window;
+static std::vector< entt::entity > s_visibleModels;
+// The meshes of each visible model that survived the occlusion culling. The ones of s_visibleModels[i] are
+// s_visibleMeshes[s_visibleMeshOffsets[i]] up to s_visibleMeshes[s_visibleMeshOffsets[i + 1]]
+static std::vector< uint32_t > s_visibleMeshOffsets;
+static std::vector< uint32_t > s_visibleMeshes;
+// The dynamic casters get drawn into the shadow map every frame. The static ones only get drawn into
+// ShadowMap::staticTexture, and only for the cascades in s_redrawStaticShadows
+static std::vector< entt::entity > s_shadowCasters[PG_NUM_SHADOW_CASCADES];
+static std::vector< entt::entity > s_staticShadowCasters[PG_NUM_SHADOW_CASCADES];
+static bool s_redrawStaticShadows[PG_NUM_SHADOW_CASCADES];
+static std::vector< std::pair< entt::entity, AABB > > s_dynamicCasterBoxes;
+// Set by CullScene and cleared by Render, so a frame that was already culled doesn't get culled twice
+static Scene* s_culledScene = nullptr;
+static_assert( PG_NUM_SHADOW_CASCADES == 4, "The cascades are laid out as the quadrants of the shadow map, and their splits fit in a vec4" );
+
+// How many models one job records into a secondary command buffer. Big enough to be worth a job,
+// small enough that large scenes get spread over every thread
+#define MODELS_PER_SECONDARY_COMMAND_BUFFER 256
+
+// Command pools can only be used by one thread at a time, so each job thread records its secondary
+// command buffers out of its own pool
+struct ThreadCommandBuffers
+{
+    CommandPool pool;
+    std::vector< CommandBuffer > secondaryCmdBufs;
+    uint32_t numUsed = 0;
+};
+
+// The secondary command buffers of one render pass, in the order they get executed
+struct SecondaryRecording
+{
+    std::vector< CommandBuffer > cmdBufs;
+    Jobs::Counter counter;
+    // Set by RecordSecondaryChunks, and only read by its jobs, so they only have to capture the recording
+    const RenderPass* renderPass   = nullptr;
+    const Framebuffer* framebuffer = nullptr;
+    std::function< void( CommandBuffer&, uint32_t ) > recordChunk;
+};
+static SecondaryRecording s_staticShadowRecording;
+static SecondaryRecording s_shadowRecording;
+// Where each cascade's chunks start in the shadow recordings. In s_shadowRecording, the first chunk copies in
+// the static casters, and then every cascade gets its rigid chunks and one for the animated models.
+// In s_staticShadowRecording, only the cascades being redrawn get any
+static std::array< uint32_t, PG_NUM_SHADOW_CASCADES + 1 > s_staticShadowCascadeFirstChunks;
+static std::array< uint32_t, PG_NUM_SHADOW_CASCADES + 1 > s_shadowCascadeFirstChunks;
+static SecondaryRecording s_gBufferRecording;
 static DescriptorPool s_descriptorPool;
-static Buffer s_gpuSceneConstantBuffers;
-static Buffer s_gpuPointLightBuffers;
-static Buffer s_gpuSpotLightBuffers;
+
+// Everything the cpu writes while building a frame. The frame's fence gets waited on before any of it is
+// touched again, so the gpu is never reading what the cpu is overwriting
+struct PerFrameData
+{
+    Buffer sceneConstantBuffer;
+    Buffer pointLightBuffer;
+    Buffer spotLightBuffer;
+    Buffer lightClusterBuffer;
+    Buffer lightIndexBuffer;
+    // The frame's depth buffer, reduced down to PG_HIZ_WIDTH x PG_HIZ_HEIGHT, and the view projection it
+    // was drawn with. Read by the occlusion culling the next time this frame's fence is waited on
+    Buffer hizReadbackBuffer;
+    glm::mat4 hizVP;
+    bool hizWritten = false;
+    DescriptorSet sceneSet;
+    DescriptorSet arrayOfTexturesSet;
+    DescriptorSet lightsSet;
+    DescriptorSet backgroundSet;
+    DescriptorSet staticShadowSet;
+    std::vector< ThreadCommandBuffers > threadCommandBuffers;
+};
+static PerFrameData s_frameData[MAX_FRAMES_IN_FLIGHT];
+
+static PerFrameData& CurrentFrameData()
+{
+    return s_frameData[g_renderState.currentFrame];
+}
 
 struct
 {
-    DescriptorSet scene;
-    DescriptorSet arrayOfTextures;
     DescriptorSet gBufferAttachments;
+    DescriptorSet ssaoDownsample;
     DescriptorSet ssao;
-    DescriptorSet ssaoBlur;
-    DescriptorSet lights;
-    DescriptorSet background;
+    DescriptorSet ssaoBlurX;
+    DescriptorSet ssaoBlurY;
+    DescriptorSet ssaoUpsample;
+    DescriptorSet hizDownsample;
     DescriptorSet postProcessInputColorTex;
 } descriptorSets;
 
@@ -86,38 +169,52 @@ RenderSystem::ShadowPassData shadowPassData;
 
 RenderSystem::GBufferPassData gBufferPassData;
 
+// The AO is computed at 1 / scale of the screen's resolution, from a downsampled copy of the gbuffer's
+// depths and normals. It gets blurred at that resolution, and then upsampled if it isn't the full one
+static RenderSystem::SSAOResolution s_ssaoResolution = RenderSystem::SSAOResolution::FULL;
+static uint32_t s_ssaoKernelSize = 32;
+
+struct
+{
+    Pipeline pipeline;
+    std::vector< DescriptorSetLayout > descriptorSetLayouts;
+} ssaoDownsamplePassData;
+
 struct
 {
-    RenderPass renderPass;
-    Texture texture;
     Texture noise;
     Buffer kernel;
-    Framebuffer frameBuffer;
     Pipeline pipeline;
     std::vector< DescriptorSetLayout > descriptorSetLayouts;
 } ssaoPassData;
 
+// Both directions of the blur share the pipeline
 struct
 {
     Pipeline pipeline;
-    RenderPass renderPass;
     std::vector< DescriptorSetLayout > descriptorSetLayouts;
-    Texture outputTex;
-    Framebuffer framebuffer;
 } ssaoBlurPassData;
 
 struct
 {
-    RenderPass renderPass;
-    Texture outputTexture;
-    Framebuffer frameBuffer;
+    Pipeline pipeline;
+    std::vector< DescriptorSetLayout > descriptorSetLayouts;
+} ssaoUpsamplePassData;
+
+struct
+{
+    Pipeline pipeline;
+    std::vector< DescriptorSetLayout > descriptorSetLayouts;
+} hizPassData;
+
+struct
+{
     Pipeline pipeline;
     std::vector< DescriptorSetLayout > descriptorSetLayouts;
 } lightingPassData;
 
 struct
 {
-    RenderPass renderPass;
     Pipeline skyboxPipeline;
     Buffer cubeBuffer;
     std::vector< DescriptorSetLayout > skyboxDescriptorSetLayouts;
@@ -138,22 +235,117 @@ struct
     std::vector< DescriptorSetLayout > descriptorSetLayouts;
 } postProcessPassData;
 
+// Every pass from the shadows up to the lit scene. The graph owns the render targets and render passes
+// of those passes, and places every barrier between them
+static RenderGraph s_renderGraph;
+static RenderGraphExecutor s_renderGraphExecutor;
+static struct
+{
+    RenderGraph::TextureHandle staticShadowMap;
+    RenderGraph::TextureHandle shadowMap;
+    RenderGraph::TextureHandle depth;
+    RenderGraph::TextureHandle normals;
+    RenderGraph::TextureHandle diffuseAndSpecular;
+    RenderGraph::TextureHandle ssaoDepth;
+    RenderGraph::TextureHandle ssaoNormals;
+    RenderGraph::TextureHandle ssao;
+    RenderGraph::TextureHandle ssaoBlurX;
+    RenderGraph::TextureHandle ssaoBlur;
+    RenderGraph::TextureHandle ssaoUpsampled; // only at the lower resolutions
+    RenderGraph::TextureHandle litScene;
+    RenderGraph::TextureHandle hiz;
+
+    uint32_t staticShadowPass;
+    uint32_t shadowPass;
+    uint32_t gBufferPass;
+    uint32_t ssaoDownsamplePass;
+    uint32_t ssaoPass;
+    uint32_t ssaoBlurXPass;
+    uint32_t ssaoBlurYPass;
+    uint32_t ssaoUpsamplePass;
+    uint32_t lightingPass;
+    uint32_t hizPass;
+    uint32_t backgroundPass;
+} s_graph;
+// The scene being rendered, for the graph's passes
+static Scene* s_graphScene;
+
+// What the lighting pass reads the AO from
+static RenderGraph::TextureHandle SSAOOutput()
+{
+    return s_ssaoResolution == RenderSystem::SSAOResolution::FULL ? s_graph.ssaoBlur : s_graph.ssaoUpsampled;
+}
+
 #define MAX_NUM_POINT_LIGHTS 1024
 #define MAX_NUM_SPOT_LIGHTS 256
 
-static bool InitShadowPassData()
+static LightClusters s_lightClusters;
+// The positions and radii of the scene's lights, and the spot light cones, gathered for the cluster assignment
+static std::vector< glm::vec4 > s_pointLightSpheres;
+static std::vector< glm::vec4 > s_spotLightSpheres;
+static std::vector< glm::vec4 > s_spotLightCones;
+
+// The meshes get tested against the depth of the frame that last used this frame's resources, so the
+// depth is numFramesInFlight frames old. The two phases of the culling are spread over two frames:
+// everything that passed the test last frame gets drawn no matter what, and everything else only if it
+// passes. All of them still get tested, to decide what gets drawn untested next frame. That way a mesh
+// that the old depth wrongly says is hidden for a frame doesn't flicker out
+static bool s_occlusionCulling = true;
+static DepthPyramid s_depthPyramid;
+struct OcclusionHistory
 {
-    RenderPassDescriptor desc;
-    desc.depthAttachmentDescriptor.format      = PixelFormat::DEPTH_32_FLOAT;
-    desc.depthAttachmentDescriptor.loadAction  = LoadAction::CLEAR;
-    desc.depthAttachmentDescriptor.storeAction = StoreAction::STORE;
-    desc.depthAttachmentDescriptor.finalLayout = ImageLayout::SHADER_READ_ONLY_OPTIMAL;
-    
-    shadowPassData.renderPass = g_renderState.device.NewRenderPass( desc, "directional shadow" );
-    if ( !shadowPassData.renderPass )
+    // Where a model's meshes start in meshPassed, and how many it has
+    struct MeshRange
     {
-        return false;
+        entt::entity entity = entt::null; // null if the slot's entity wasn't tested that frame
+        uint32_t firstMesh  = 0;
+        uint32_t numMeshes  = 0;
+    };
+    // Indexed by the entity's index, and sized to every entity the registry has created, so it never
+    // has to rehash. The full entity is kept to tell apart the entities that reuse an index
+    std::vector< MeshRange > meshRanges;
+    std::vector< bool > meshPassed;
+};
+static OcclusionHistory s_occlusionHistory[2];
+static uint32_t s_currentOcclusionHistory = 0;
+
+// The passes only describe their pipelines while initializing. They all get compiled together at the
+// end, so that they can be spread across the job threads instead of compiling one after another
+static std::vector< PipelineDescriptor > s_queuedPipelineDescs;
+static std::vector< std::string > s_queuedPipelineNames;
+static std::vector< Pipeline* > s_queuedPipelineDsts;
+
+static void QueuePipeline( Pipeline* dst, const PipelineDescriptor& desc, const std::string& name )
+{
+    s_queuedPipelineDescs.push_back( desc );
+    s_queuedPipelineNames.push_back( name );
+    s_queuedPipelineDsts.push_back( dst );
+}
+
+static bool CreateQueuedPipelines()
+{
+    std::vector< Pipeline > pipelines = g_renderState.device.NewPipelines( s_queuedPipelineDescs, s_queuedPipelineNames );
+    bool success = true;
+    for ( size_t i = 0; i < pipelines.size(); ++i )
+    {
+        *s_queuedPipelineDsts[i] = pipelines[i];
+        if ( !pipelines[i] )
+        {
+            LOG_ERR( "Could not create the ", s_queuedPipelineNames[i], " pipeline" );
+            success = false;
+        }
     }
+    s_queuedPipelineDescs.clear();
+    s_queuedPipelineNames.clear();
+    s_queuedPipelineDsts.clear();
+
+    return success;
+}
+
+static bool InitShadowPassData()
+{
+    shadowPassData.renderPass       = &s_renderGraphExecutor.GetRenderPass( s_graph.shadowPass );
+    shadowPassData.staticRenderPass = &s_renderGraphExecutor.GetRenderPass( s_graph.staticShadowPass );
 
     auto vertShader = ResourceManager::Get< Shader >( "directionalShadowVert" );
     PG_ASSERT( vertShader );
@@ -161,19 +353,16 @@ static bool InitShadowPassData()
     VertexBindingDescriptor bindingDescs[] =
     {
         VertexBindingDescriptor( 0, sizeof( glm::vec3 ) ),
-        VertexBindingDescriptor( 1, 2 * sizeof( glm::vec4 ) ),
     };
 
     VertexAttributeDescriptor attribDescs[] =
     {
         VertexAttributeDescriptor( 0, 0, BufferDataType::FLOAT3, 0 ),
-        VertexAttributeDescriptor( 1, 1, BufferDataType::FLOAT4, 0 ),
-        VertexAttributeDescriptor( 2, 1, BufferDataType::UINT4, sizeof( glm::vec4 ) ),
     };
 
     PipelineDescriptor shadowPassDataPipelineDesc;
     shadowPassDataPipelineDesc.rasterizerInfo.depthBiasEnable = true;
-    shadowPassDataPipelineDesc.renderPass             = &shadowPassData.renderPass;
+    shadowPassDataPipelineDesc.renderPass             = shadowPassData.renderPass;
     shadowPassDataPipelineDesc.vertexDescriptor       = VertexInputDescriptor::Create( 1, bindingDescs, 1, attribDescs );
     shadowPassDataPipelineDesc.rasterizerInfo.winding = WindingOrder::COUNTER_CLOCKWISE;
     // shadowPassDataPipelineDesc.viewport               = Viewport( DIRECTIONAL_SHADOW_MAP_RESOLUTION, -DIRECTIONAL_SHADOW_MAP_RESOLUTION );
@@ -182,53 +371,34 @@ static bool InitShadowPassData()
     shadowPassDataPipelineDesc.shaders[0]             = vertShader.get();
     shadowPassDataPipelineDesc.dynamicStates          = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
 
-    shadowPassData.rigidPipeline = g_renderState.device.NewPipeline( shadowPassDataPipelineDesc, "directional shadow pass rigid" );
-    if ( !shadowPassData.rigidPipeline )
-    {
-        LOG_ERR( "Could not create directional shadow rigid pipeline" );
-        return false;
-    }
+    QueuePipeline( &shadowPassData.rigidPipeline, shadowPassDataPipelineDesc, "directional shadow pass rigid" );
 
-    vertShader = ResourceManager::Get< Shader >( "directionalShadowAnimatedVert" );
-    PG_ASSERT( vertShader );
+    auto quadVertShader      = ResourceManager::Get< Shader >( "fullScreenQuadVert" );
+    auto compositeFragShader = ResourceManager::Get< Shader >( "staticShadowCompositeFrag" );
+    PG_ASSERT( quadVertShader && compositeFragShader );
 
-    shadowPassData.animatedDescriptorSetLayouts = g_renderState.device.NewDescriptorSetLayouts( vertShader->reflectInfo.descriptorSetLayouts );
+    std::vector< DescriptorSetLayoutData > descriptorSetData = quadVertShader->reflectInfo.descriptorSetLayouts;
+    descriptorSetData.insert( descriptorSetData.end(), compositeFragShader->reflectInfo.descriptorSetLayouts.begin(), compositeFragShader->reflectInfo.descriptorSetLayouts.end() );
+    auto combined = CombineDescriptorSetLayouts( descriptorSetData );
+    shadowPassData.compositeDescriptorSetLayouts = g_renderState.device.NewDescriptorSetLayouts( combined );
 
-    shadowPassDataPipelineDesc.descriptorSetLayouts = shadowPassData.animatedDescriptorSetLayouts;
-    shadowPassDataPipelineDesc.vertexDescriptor     = VertexInputDescriptor::Create( 2, bindingDescs, 3, attribDescs );
-    shadowPassDataPipelineDesc.shaders[0]           = vertShader.get();
+    // Overwrites every texel, whatever was cleared there
+    PipelineDescriptor compositePipelineDesc;
+    compositePipelineDesc.renderPass            = shadowPassData.renderPass;
+    compositePipelineDesc.descriptorSetLayouts  = shadowPassData.compositeDescriptorSetLayouts;
+    compositePipelineDesc.vertexDescriptor      = VertexInputDescriptor::Create( 1, bindingDescs, 1, attribDescs );
+    compositePipelineDesc.depthInfo.compareFunc = CompareFunction::ALWAYS;
+    compositePipelineDesc.shaders[0]            = quadVertShader.get();
+    compositePipelineDesc.shaders[1]            = compositeFragShader.get();
+    compositePipelineDesc.dynamicStates         = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
 
-    shadowPassData.animatedPipeline = g_renderState.device.NewPipeline( shadowPassDataPipelineDesc, "directional shadow pass animated" );
-    if ( !shadowPassData.animatedPipeline )
-    {
-        LOG_ERR( "Could not create directional shadow animated pipeline" );
-        return false;
-    }
+    QueuePipeline( &shadowPassData.compositePipeline, compositePipelineDesc, "directional shadow static composite" );
 
     return true;
 }
 
 static bool InitGBufferPassData()
 {
-    RenderPassDescriptor desc;
-    desc.colorAttachmentDescriptors[0].format      = PixelFormat::R32_G32_B32_A32_FLOAT;
-    desc.colorAttachmentDescriptors[0].finalLayout = ImageLayout::SHADER_READ_ONLY_OPTIMAL;
-    desc.colorAttachmentDescriptors[1].format      = PixelFormat::R8_G8_B8_A8_UNORM; // R16_G16_B16_A16_FLOAT // R8_G8_B8_A8_UNORM
-    desc.colorAttachmentDescriptors[1].finalLayout = ImageLayout::SHADER_READ_ONLY_OPTIMAL;
-    desc.colorAttachmentDescriptors[2].format      = PixelFormat::R16_G16_B16_A16_UINT;
-    desc.colorAttachmentDescriptors[2].finalLayout = ImageLayout::SHADER_READ_ONLY_OPTIMAL;
-
-    desc.depthAttachmentDescriptor.format      = PixelFormat::DEPTH_32_FLOAT;
-    desc.depthAttachmentDescriptor.loadAction  = LoadAction::CLEAR;
-    desc.depthAttachmentDescriptor.storeAction = StoreAction::STORE;
-    desc.depthAttachmentDescriptor.finalLayout = ImageLayout::DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-
-    gBufferPassData.renderPass = g_renderState.device.NewRenderPass( desc, "gBuffer" );
-    if ( !gBufferPassData.renderPass )
-    {
-        return false;
-    }
-
     VertexBindingDescriptor bindingDescs[] =
     {
         VertexBindingDescriptor( 0, sizeof( glm::vec3 ) ),
@@ -255,7 +425,7 @@ static bool InitGBufferPassData()
     gBufferPassData.descriptorSetLayouts = g_renderState.device.NewDescriptorSetLayouts( combined );
 
     PipelineDescriptor pipelineDesc;
-    pipelineDesc.renderPass             = &gBufferPassData.renderPass;
+    pipelineDesc.renderPass             = &s_renderGraphExecutor.GetRenderPass( s_graph.gBufferPass );
     pipelineDesc.descriptorSetLayouts   = gBufferPassData.descriptorSetLayouts;
     pipelineDesc.vertexDescriptor       = VertexInputDescriptor::Create( 4, bindingDescs, 4, attribDescs );
     pipelineDesc.rasterizerInfo.winding = WindingOrder::COUNTER_CLOCKWISE;
@@ -266,55 +436,17 @@ static bool InitGBufferPassData()
     pipelineDesc.shaders[0]             = vertShader.get();
     pipelineDesc.shaders[1]             = fragShader.get();
 
-    gBufferPassData.pipeline = g_renderState.device.NewPipeline( pipelineDesc, "gbuffer rigid model" );
-    if ( !gBufferPassData.pipeline )
-    {
-        LOG_ERR( "Could not create gbuffer pipeline" );
-        return false;
-    }
-
-    ImageDescriptor info;
-    info.type    = ImageType::TYPE_2D;
-    info.width   = g_renderState.swapChain.extent.width;
-    info.height  = g_renderState.swapChain.extent.height;
-    info.sampler = "nearest_clamped_nearest";
-    info.usage   = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
-    info.format                                = PixelFormat::R32_G32_B32_A32_FLOAT;
-    gBufferPassData.gbuffer.positions          = g_renderState.device.NewTexture( info, false, "gbuffer position" );
-    info.format                                = PixelFormat::R8_G8_B8_A8_UNORM; // R16_G16_B16_A16_FLOAT // R8_G8_B8_A8_UNORM
-    gBufferPassData.gbuffer.normals            = g_renderState.device.NewTexture( info, false, "gbuffer normals" );
-    info.format                                = PixelFormat::R16_G16_B16_A16_UINT;
-    gBufferPassData.gbuffer.diffuseAndSpecular = g_renderState.device.NewTexture( info, false, "gbuffer diffuse + specular" );
-
-    gBufferPassData.frameBuffer = g_renderState.device.NewFramebuffer( {
-        &gBufferPassData.gbuffer.positions,
-        &gBufferPassData.gbuffer.normals,
-        &gBufferPassData.gbuffer.diffuseAndSpecular,
-        &g_renderState.depthTex
-        }, gBufferPassData.renderPass, "gbuffer pass" );
-
-    if ( !gBufferPassData.frameBuffer )
-    {
-        return false;
-    }
+    QueuePipeline( &gBufferPassData.pipeline, pipelineDesc, "gbuffer rigid model" );
 
     return true;
 }
 
-static bool InitSSAOPass()
+// A full screen quad, sized to the pass's own render targets, with the layouts reflected from the fragment shader
+static void QueueFullScreenPipeline( Pipeline* pipeline, std::vector< DescriptorSetLayout >& descriptorSetLayouts, const std::string& fragShaderName,
+    uint32_t pass, const std::string& name )
 {
-    RenderPassDescriptor desc;
-    desc.colorAttachmentDescriptors[0].format      = PixelFormat::R8_UNORM;
-    desc.colorAttachmentDescriptors[0].finalLayout = ImageLayout::SHADER_READ_ONLY_OPTIMAL;
-    
-    ssaoPassData.renderPass = g_renderState.device.NewRenderPass( desc, "ssao" );
-    if ( !ssaoPassData.renderPass )
-    {
-        return false;
-    }
-
     auto vertShader = ResourceManager::Get< Shader >( "fullScreenQuadVert" );
-    auto fragShader = ResourceManager::Get< Shader >( "ssao" );
+    auto fragShader = ResourceManager::Get< Shader >( fragShaderName );
     PG_ASSERT( vertShader && fragShader );
 
     VertexBindingDescriptor bindingDescs[] =
@@ -330,52 +462,45 @@ static bool InitSSAOPass()
     std::vector< DescriptorSetLayoutData > descriptorSetData = vertShader->reflectInfo.descriptorSetLayouts;
     descriptorSetData.insert( descriptorSetData.end(), fragShader->reflectInfo.descriptorSetLayouts.begin(), fragShader->reflectInfo.descriptorSetLayouts.end() );
     auto combined = CombineDescriptorSetLayouts( descriptorSetData );
-    ssaoPassData.descriptorSetLayouts = g_renderState.device.NewDescriptorSetLayouts( combined );
+    descriptorSetLayouts = g_renderState.device.NewDescriptorSetLayouts( combined );
 
+    VkExtent2D extent = s_renderGraphExecutor.GetExtent( pass );
     PipelineDescriptor pipelineDesc;
-    pipelineDesc.renderPass           = &ssaoPassData.renderPass;
-    pipelineDesc.descriptorSetLayouts = ssaoPassData.descriptorSetLayouts;
+    pipelineDesc.renderPass           = &s_renderGraphExecutor.GetRenderPass( pass );
+    pipelineDesc.descriptorSetLayouts = descriptorSetLayouts;
     pipelineDesc.vertexDescriptor     = VertexInputDescriptor::Create( 1, bindingDescs, 1, attribDescs );
-    pipelineDesc.viewport             = FullScreenViewport();
-    pipelineDesc.scissor              = FullScreenScissor();
+    pipelineDesc.viewport             = Viewport( static_cast< float >( extent.width ), static_cast< float >( extent.height ) );
+    pipelineDesc.scissor              = Scissor( extent.width, extent.height );
     pipelineDesc.shaders[0]           = vertShader.get();
     pipelineDesc.shaders[1]           = fragShader.get();
 
-    ssaoPassData.pipeline = g_renderState.device.NewPipeline( pipelineDesc, "SSAO pass" );
-    if ( !ssaoPassData.pipeline )
-    {
-        LOG_ERR( "Could not create SSAO pipeline" );
-        return false;
-    }
-
-    ImageDescriptor info;
-    info.type    = ImageType::TYPE_2D;
-    info.width   = g_renderState.swapChain.extent.width;
-    info.height  = g_renderState.swapChain.extent.height;
-    info.sampler = "nearest_clamped_nearest";
-    info.usage   = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
-    info.format  = PixelFormat::R8_UNORM;
-    ssaoPassData.texture = g_renderState.device.NewTexture( info, false, "ssao" );
+    QueuePipeline( pipeline, pipelineDesc, name );
+}
 
-    ssaoPassData.frameBuffer = g_renderState.device.NewFramebuffer( { &ssaoPassData.texture }, ssaoPassData.renderPass, "ssao pass" );
-    if ( !ssaoPassData.frameBuffer )
-    {
-        return false;
-    }
+static bool InitSSAOPass()
+{
+    QueueFullScreenPipeline( &ssaoDownsamplePassData.pipeline, ssaoDownsamplePassData.descriptorSetLayouts, "ssaoDownsample", s_graph.ssaoDownsamplePass, "SSAO downsample pass" );
+    QueueFullScreenPipeline( &ssaoPassData.pipeline, ssaoPassData.descriptorSetLayouts, "ssao", s_graph.ssaoPass, "SSAO pass" );
 
+    // Every kernel size gets its own samples, so that the smaller ones are still spread over the whole hemisphere
     std::uniform_real_distribution< float > randomFloats( 0.0f, 1.0f );
     std::default_random_engine generator;
-    std::vector< glm::vec4 > kernel( PG_SSAO_KERNEL_SIZE );
-    for ( int i = 0; i < PG_SSAO_KERNEL_SIZE; ++i )
-    {
-        glm::vec3 sample( randomFloats( generator ) * 2 - 1, randomFloats( generator ) * 2 - 1, randomFloats( generator ) );
-        sample      = randomFloats( generator ) * glm::normalize( sample );
-        float scale = i / (float) PG_SSAO_KERNEL_SIZE;
-        float t     = scale * scale;
-        scale       = 0.1f + t * 0.9f;
-        kernel[i]   = glm::vec4( scale * sample, 0 );
+    std::vector< glm::vec4 > kernel;
+    kernel.reserve( PG_SSAO_KERNEL_BUFFER_SIZE );
+    for ( int kernelSize = PG_SSAO_MIN_KERNEL_SIZE; kernelSize <= PG_SSAO_MAX_KERNEL_SIZE; kernelSize *= 2 )
+    {
+        for ( int i = 0; i < kernelSize; ++i )
+        {
+            glm::vec3 sample( randomFloats( generator ) * 2 - 1, randomFloats( generator ) * 2 - 1, randomFloats( generator ) );
+            sample      = randomFloats( generator ) * glm::normalize( sample );
+            float scale = i / (float) kernelSize;
+            float t     = scale * scale;
+            scale       = 0.1f + t * 0.9f;
+            kernel.push_back( glm::vec4( scale * sample, 0 ) );
+        }
     }
-    ssaoPassData.kernel = g_renderState.device.NewBuffer( sizeof( glm::vec4 ) * PG_SSAO_KERNEL_SIZE, kernel.data(),
+    PG_ASSERT( kernel.size() == PG_SSAO_KERNEL_BUFFER_SIZE );
+    ssaoPassData.kernel = g_renderState.device.NewBuffer( sizeof( glm::vec4 ) * PG_SSAO_KERNEL_BUFFER_SIZE, kernel.data(),
         BUFFER_TYPE_UNIFORM, MEMORY_TYPE_DEVICE_LOCAL, "SSAO Kernel" );
 
     std::vector< glm::vec4 > noise( 16 );
@@ -384,6 +509,7 @@ static bool InitSSAOPass()
         noise[i] = glm::vec4( randomFloats( generator ) * 2 - 1, randomFloats( generator ) * 2 - 1, 0, 0 );
     }
 
+    ImageDescriptor info;
     info.type          = ImageType::TYPE_2D;
     info.width         = 4;
     info.height        = 4;
@@ -397,88 +523,25 @@ static bool InitSSAOPass()
 
 static bool InitSSAOBlurPassData()
 {
-    RenderPassDescriptor desc;
-    desc.colorAttachmentDescriptors[0].format      = PixelFormat::R8_UNORM;
-    desc.colorAttachmentDescriptors[0].finalLayout = ImageLayout::SHADER_READ_ONLY_OPTIMAL;
-
-    ssaoBlurPassData.renderPass = g_renderState.device.NewRenderPass( desc, "ssao blur" );
-    if ( !ssaoBlurPassData.renderPass )
-    {
-        return false;
-    }
-
-    auto vertShader = ResourceManager::Get< Shader >( "fullScreenQuadVert" );
-    auto fragShader = ResourceManager::Get< Shader >( "ssaoBlur" );
-    PG_ASSERT( vertShader && fragShader );
-
-    VertexBindingDescriptor bindingDescs[] =
-    {
-        VertexBindingDescriptor( 0, sizeof( glm::vec3 ) ),
-    };
-
-    VertexAttributeDescriptor attribDescs[] =
-    {
-        VertexAttributeDescriptor( 0, 0, BufferDataType::FLOAT3, 0 ),
-    };
-
-    std::vector< DescriptorSetLayoutData > descriptorSetData = vertShader->reflectInfo.descriptorSetLayouts;
-    descriptorSetData.insert( descriptorSetData.end(), fragShader->reflectInfo.descriptorSetLayouts.begin(), fragShader->reflectInfo.descriptorSetLayouts.end() );
-    auto combined = CombineDescriptorSetLayouts( descriptorSetData );
-    ssaoBlurPassData.descriptorSetLayouts = g_renderState.device.NewDescriptorSetLayouts( combined );
-
-    PipelineDescriptor pipelineDesc;
-    pipelineDesc.renderPass           = &ssaoBlurPassData.renderPass;
-    pipelineDesc.descriptorSetLayouts = ssaoBlurPassData.descriptorSetLayouts;
-    pipelineDesc.vertexDescriptor     = VertexInputDescriptor::Create( 1, bindingDescs, 1, attribDescs );
-    pipelineDesc.viewport             = FullScreenViewport();
-    pipelineDesc.scissor              = FullScreenScissor();
-    pipelineDesc.shaders[0]           = vertShader.get();
-    pipelineDesc.shaders[1]           = fragShader.get();
-
-    ssaoBlurPassData.pipeline = g_renderState.device.NewPipeline( pipelineDesc, "SSAO blur pass" );
-    if ( !ssaoBlurPassData.pipeline )
+    // Both directions render at the same resolution, so either pass's render pass works
+    QueueFullScreenPipeline( &ssaoBlurPassData.pipeline, ssaoBlurPassData.descriptorSetLayouts, "ssaoBlur", s_graph.ssaoBlurXPass, "SSAO blur pass" );
+    if ( s_ssaoResolution != RenderSystem::SSAOResolution::FULL )
     {
-        LOG_ERR( "Could not create SSAO blur pipeline" );
-        return false;
+        QueueFullScreenPipeline( &ssaoUpsamplePassData.pipeline, ssaoUpsamplePassData.descriptorSetLayouts, "ssaoUpsample", s_graph.ssaoUpsamplePass, "SSAO upsample pass" );
     }
 
-    ImageDescriptor info;
-    info.type    = ImageType::TYPE_2D;
-    info.width   = g_renderState.swapChain.extent.width;
-    info.height  = g_renderState.swapChain.extent.height;
-    info.sampler = "nearest_clamped_nearest";
-    info.usage   = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
-    info.format  = PixelFormat::R8_UNORM;
-    ssaoBlurPassData.outputTex = g_renderState.device.NewTexture( info, false, "ssao blur" );
+    return true;
+}
 
-    ssaoBlurPassData.framebuffer = g_renderState.device.NewFramebuffer( { &ssaoBlurPassData.outputTex }, ssaoBlurPassData.renderPass, "ssao blur pass" );
-    if ( !ssaoBlurPassData.framebuffer )
-    {
-        return false;
-    }
+static bool InitHiZPassData()
+{
+    QueueFullScreenPipeline( &hizPassData.pipeline, hizPassData.descriptorSetLayouts, "hizDownsample", s_graph.hizPass, "HiZ downsample pass" );
 
     return true;
 }
 
 static bool InitLightingPassData()
 {
-    RenderPassDescriptor desc;
-    desc.colorAttachmentDescriptors[0].format      = PixelFormat::R8_G8_B8_A8_UNORM;
-    desc.colorAttachmentDescriptors[0].finalLayout = ImageLayout::COLOR_ATTACHMENT_OPTIMAL;
-    //desc.colorAttachmentDescriptors[0].finalLayout = ImageLayout::SHADER_READ_ONLY_OPTIMAL;
-
-    desc.depthAttachmentDescriptor.format        = PixelFormat::DEPTH_32_FLOAT;
-    desc.depthAttachmentDescriptor.loadAction    = LoadAction::LOAD;
-    desc.depthAttachmentDescriptor.storeAction   = StoreAction::STORE;
-    desc.depthAttachmentDescriptor.initialLayout = ImageLayout::DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-    desc.depthAttachmentDescriptor.finalLayout   = ImageLayout::DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-
-    lightingPassData.renderPass = g_renderState.device.NewRenderPass( desc, "lighting pass" );
-    if ( !lightingPassData.renderPass )
-    {
-        return false;
-    }
-
     VertexBindingDescriptor bindingDescs[] =
     {
         VertexBindingDescriptor( 0, sizeof( glm::vec3 ) ),
@@ -499,7 +562,7 @@ static bool InitLightingPassData()
     lightingPassData.descriptorSetLayouts = g_renderState.device.NewDescriptorSetLayouts( combined );
 
     PipelineDescriptor pipelineDesc;
-    pipelineDesc.renderPass                  = &lightingPassData.renderPass;
+    pipelineDesc.renderPass                  = &s_renderGraphExecutor.GetRenderPass( s_graph.lightingPass );
     pipelineDesc.descriptorSetLayouts        = lightingPassData.descriptorSetLayouts;
     pipelineDesc.vertexDescriptor            = VertexInputDescriptor::Create( 1, bindingDescs, 1, attribDescs );
     pipelineDesc.rasterizerInfo.winding      = WindingOrder::COUNTER_CLOCKWISE;
@@ -510,51 +573,13 @@ static bool InitLightingPassData()
     pipelineDesc.depthInfo.depthWriteEnabled = false;
     pipelineDesc.depthInfo.depthTestEnabled  = false;
 
-    lightingPassData.pipeline = g_renderState.device.NewPipeline( pipelineDesc, "lighting pass rigid model" );
-    if ( !lightingPassData.pipeline )
-    {
-        LOG_ERR( "Could not create lighting pass pipeline" );
-        return false;
-    }
-
-    ImageDescriptor info;
-    info.type    = ImageType::TYPE_2D;
-    info.width   = g_renderState.swapChain.extent.width;
-    info.height  = g_renderState.swapChain.extent.height;
-    info.sampler = "nearest_clamped_nearest";
-    info.usage   = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
-    info.format  = PixelFormat::R8_G8_B8_A8_UNORM;
-    lightingPassData.outputTexture = g_renderState.device.NewTexture( info, false, "lit scene" );
-
-    lightingPassData.frameBuffer = g_renderState.device.NewFramebuffer( { &lightingPassData.outputTexture, &g_renderState.depthTex }, lightingPassData.renderPass, "lighting pass" );
-    if ( !lightingPassData.frameBuffer )
-    {
-        return false;
-    }
+    QueuePipeline( &lightingPassData.pipeline, pipelineDesc, "lighting pass rigid model" );
 
     return true;
 }
 
 static bool InitBackgroundPassData()
 {
-    RenderPassDescriptor desc;
-    desc.colorAttachmentDescriptors[0].format        = PixelFormat::R8_G8_B8_A8_UNORM;
-    desc.colorAttachmentDescriptors[0].loadAction    = LoadAction::LOAD;
-    desc.colorAttachmentDescriptors[0].initialLayout = ImageLayout::COLOR_ATTACHMENT_OPTIMAL;
-    desc.colorAttachmentDescriptors[0].finalLayout   = ImageLayout::SHADER_READ_ONLY_OPTIMAL;
-
-    desc.depthAttachmentDescriptor.format        = PixelFormat::DEPTH_32_FLOAT;
-    desc.depthAttachmentDescriptor.loadAction    = LoadAction::LOAD;
-    desc.depthAttachmentDescriptor.storeAction   = StoreAction::STORE;
-    desc.depthAttachmentDescriptor.initialLayout = ImageLayout::DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-    desc.depthAttachmentDescriptor.finalLayout   = ImageLayout::DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-
-    backgroundPassData.renderPass = g_renderState.device.NewRenderPass( desc, "background pass" );
-    if ( !backgroundPassData.renderPass )
-    {
-        return false;
-    }
-
     VertexBindingDescriptor bindingDescs[] =
     {
         VertexBindingDescriptor( 0, sizeof( glm::vec3 ) ),
@@ -570,7 +595,7 @@ static bool InitBackgroundPassData()
     PG_ASSERT( vertShader && fragShader );
 
     PipelineDescriptor pipelineDesc;
-    pipelineDesc.renderPass             = &backgroundPassData.renderPass;
+    pipelineDesc.renderPass             = &s_renderGraphExecutor.GetRenderPass( s_graph.backgroundPass );
     pipelineDesc.vertexDescriptor       = VertexInputDescriptor::Create( ARRAY_COUNT( bindingDescs ), bindingDescs, ARRAY_COUNT( attribDescs ), attribDescs );
     pipelineDesc.rasterizerInfo.winding = WindingOrder::COUNTER_CLOCKWISE;
     pipelineDesc.viewport               = FullScreenViewport();
@@ -580,12 +605,7 @@ static bool InitBackgroundPassData()
 
     pipelineDesc.depthInfo.compareFunc  = CompareFunction::LEQUAL;
 
-    backgroundPassData.solidColorPipeline = g_renderState.device.NewPipeline( pipelineDesc, "background pass solid color" );
-    if ( !backgroundPassData.solidColorPipeline )
-    {
-        LOG_ERR( "Could not create background pass solid color pipeline" );
-        return false;
-    }
+    QueuePipeline( &backgroundPassData.solidColorPipeline, pipelineDesc, "background pass solid color" );
 
     vertShader = ResourceManager::Get< Shader >( "backgroundSkyboxVert" );
     fragShader = ResourceManager::Get< Shader >( "backgroundSkyboxFrag" );
@@ -605,12 +625,7 @@ static bool InitBackgroundPassData()
     pipelineDesc.shaders[0]             = vertShader.get();
     pipelineDesc.shaders[1]             = fragShader.get();
 
-    backgroundPassData.skyboxPipeline = g_renderState.device.NewPipeline( pipelineDesc, "background pass skybox" );
-    if ( !backgroundPassData.skyboxPipeline )
-    {
-        LOG_ERR( "Could not create background pass skybox pipeline" );
-        return false;
-    }
+    QueuePipeline( &backgroundPassData.skyboxPipeline, pipelineDesc, "background pass skybox" );
 
     glm::vec3 verts[] =
     {
@@ -693,12 +708,7 @@ static bool InitTransparencyPassData()
     pipelineDesc.shaders[0]             = vertShader.get();
     pipelineDesc.shaders[1]             = fragShader.get();
 
-    transparencyPassData.pipeline = g_renderState.device.NewPipeline( pipelineDesc, "transparency rigid model" );
-    if ( !transparencyPassData.pipeline )
-    {
-        LOG_ERR( "Could not create transparency pipeline" );
-        return false;
-    }
+    QueuePipeline( &transparencyPassData.pipeline, pipelineDesc, "transparency rigid model" );
 
     return true;
 }
@@ -733,12 +743,7 @@ bool InitPostProcessPassData()
     postProcessingPipelineDesc.shaders[0]	          = vertShader.get();
     postProcessingPipelineDesc.shaders[1]			  = fragShader.get();
 
-	postProcessPassData.pipeline = g_renderState.device.NewPipeline( postProcessingPipelineDesc , "post process" );
-	if ( !postProcessPassData.pipeline )
-	{
-		LOG_ERR( "Could not create post processing pipeline" );
-		return false;
-	}
+    QueuePipeline( &postProcessPassData.pipeline, postProcessingPipelineDesc, "post process" );
 
     glm::vec3 verts[] =
     {
@@ -757,21 +762,27 @@ bool InitPostProcessPassData()
 
 bool InitDescriptorPoolAndPrimarySets()
 {
+    // The scene, texture array, light and skybox sets are per frame, the rest only point at render targets
     VkDescriptorPoolSize poolSize[3] = {};
-    poolSize[0] = { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2 }; // scene const buffer + ssao kernel
-    poolSize[1] = { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2 }; // point and spot light buffers
-    poolSize[2] = { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 11 }; // tex array + 4 gbuffer attachment sampler2Ds + 3 ssao + 1 skybox
-
-    s_descriptorPool = g_renderState.device.NewDescriptorPool( 3, poolSize, 8, "render system" );
-
-    descriptorSets.scene                    = s_descriptorPool.NewDescriptorSet( lightingPassData.descriptorSetLayouts[0],    "scene data" );
-    descriptorSets.arrayOfTextures          = s_descriptorPool.NewDescriptorSet( lightingPassData.descriptorSetLayouts[1],    "array of textures" );
-    descriptorSets.gBufferAttachments       = s_descriptorPool.NewDescriptorSet( lightingPassData.descriptorSetLayouts[2],    "gbuffer attachments" );
-    descriptorSets.ssao                     = s_descriptorPool.NewDescriptorSet( ssaoPassData.descriptorSetLayouts[0],        "ssao textures" );
-    descriptorSets.ssaoBlur                 = s_descriptorPool.NewDescriptorSet( ssaoBlurPassData.descriptorSetLayouts[0],    "ssao blur tex" );
-    descriptorSets.lights                   = s_descriptorPool.NewDescriptorSet( lightingPassData.descriptorSetLayouts[3],    "scene lights" );
-    descriptorSets.postProcessInputColorTex = s_descriptorPool.NewDescriptorSet( postProcessPassData.descriptorSetLayouts[0], "post process input tex" );
-    descriptorSets.background               = s_descriptorPool.NewDescriptorSet( backgroundPassData.skyboxDescriptorSetLayouts[0], "background skybox tex" );
+    poolSize[0] = { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, MAX_FRAMES_IN_FLIGHT + 1 }; // scene const buffers + ssao kernel
+    poolSize[1] = { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4 * MAX_FRAMES_IN_FLIGHT }; // point and spot lights, light clusters and indices
+    // tex arrays + skyboxes + static shadow maps + 4 gbuffer attachment sampler2Ds + 2 ssao downsample + 3 ssao
+    // + 2 * 2 ssao blur + 3 ssao upsample + 1 hiz downsample + 1 post process
+    poolSize[2] = { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, MAX_FRAMES_IN_FLIGHT * ( PG_MAX_NUM_TEXTURES + 2 ) + 18 };
+
+    s_descriptorPool = g_renderState.device.NewDescriptorPool( 3, poolSize, 8 + 5 * MAX_FRAMES_IN_FLIGHT, "render system" );
+
+    descriptorSets.gBufferAttachments       = s_descriptorPool.NewDescriptorSet( lightingPassData.descriptorSetLayouts[2],       "gbuffer attachments" );
+    descriptorSets.ssaoDownsample           = s_descriptorPool.NewDescriptorSet( ssaoDownsamplePassData.descriptorSetLayouts[0], "ssao downsample textures" );
+    descriptorSets.ssao                     = s_descriptorPool.NewDescriptorSet( ssaoPassData.descriptorSetLayouts[0],           "ssao textures" );
+    descriptorSets.ssaoBlurX                = s_descriptorPool.NewDescriptorSet( ssaoBlurPassData.descriptorSetLayouts[0],       "ssao blur x tex" );
+    descriptorSets.ssaoBlurY                = s_descriptorPool.NewDescriptorSet( ssaoBlurPassData.descriptorSetLayouts[0],       "ssao blur y tex" );
+    if ( s_ssaoResolution != RenderSystem::SSAOResolution::FULL )
+    {
+        descriptorSets.ssaoUpsample         = s_descriptorPool.NewDescriptorSet( ssaoUpsamplePassData.descriptorSetLayouts[0],   "ssao upsample tex" );
+    }
+    descriptorSets.hizDownsample            = s_descriptorPool.NewDescriptorSet( hizPassData.descriptorSetLayouts[0],            "hiz downsample tex" );
+    descriptorSets.postProcessInputColorTex = s_descriptorPool.NewDescriptorSet( postProcessPassData.descriptorSetLayouts[0],    "post process input tex" );
     
     std::vector< VkWriteDescriptorSet > writeDescriptorSets;
 	std::vector< VkDescriptorImageInfo > imageDescriptors;
@@ -783,20 +794,35 @@ bool InitDescriptorPoolAndPrimarySets()
     // GBuffer Pass (some shared with lighting pass)
     imageDescriptors = std::vector< VkDescriptorImageInfo >( PG_MAX_NUM_TEXTURES, DescriptorImageInfo( *dummyImage->GetTexture(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL ) );
 
-    bufferDescriptors =
-    {
-        DescriptorBufferInfo( s_gpuSceneConstantBuffers ),
-        DescriptorBufferInfo( s_gpuPointLightBuffers ),
-        DescriptorBufferInfo( s_gpuSpotLightBuffers ),
-    };
-    writeDescriptorSets =
+    for ( int i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i )
     {
-        WriteDescriptorSet( descriptorSets.scene,           VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,          0, &bufferDescriptors[0] ),
-        WriteDescriptorSet( descriptorSets.arrayOfTextures, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,  0, imageDescriptors.data(), static_cast< uint32_t >( imageDescriptors.size() ) ),
-        WriteDescriptorSet( descriptorSets.lights,          VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,          1, &bufferDescriptors[1] ),
-        WriteDescriptorSet( descriptorSets.lights,          VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,          2, &bufferDescriptors[2] ),
-    };
-    g_renderState.device.UpdateDescriptorSets( static_cast< uint32_t >( writeDescriptorSets.size() ), writeDescriptorSets.data() );
+        PerFrameData& frame      = s_frameData[i];
+        std::string suffix       = " frame " + std::to_string( i );
+        frame.sceneSet           = s_descriptorPool.NewDescriptorSet( lightingPassData.descriptorSetLayouts[0], "scene data" + suffix );
+        frame.arrayOfTexturesSet = s_descriptorPool.NewDescriptorSet( lightingPassData.descriptorSetLayouts[1], "array of textures" + suffix );
+        frame.lightsSet          = s_descriptorPool.NewDescriptorSet( lightingPassData.descriptorSetLayouts[3], "scene lights" + suffix );
+        frame.backgroundSet      = s_descriptorPool.NewDescriptorSet( backgroundPassData.skyboxDescriptorSetLayouts[0], "background skybox tex" + suffix );
+        frame.staticShadowSet    = s_descriptorPool.NewDescriptorSet( shadowPassData.compositeDescriptorSetLayouts[0], "static shadow map" + suffix );
+
+        bufferDescriptors =
+        {
+            DescriptorBufferInfo( frame.sceneConstantBuffer ),
+            DescriptorBufferInfo( frame.pointLightBuffer ),
+            DescriptorBufferInfo( frame.spotLightBuffer ),
+            DescriptorBufferInfo( frame.lightClusterBuffer ),
+            DescriptorBufferInfo( frame.lightIndexBuffer ),
+        };
+        writeDescriptorSets =
+        {
+            WriteDescriptorSet( frame.sceneSet,           VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,          0, &bufferDescriptors[0] ),
+            WriteDescriptorSet( frame.arrayOfTexturesSet, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,  0, imageDescriptors.data(), static_cast< uint32_t >( imageDescriptors.size() ) ),
+            WriteDescriptorSet( frame.lightsSet,          VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,          1, &bufferDescriptors[1] ),
+            WriteDescriptorSet( frame.lightsSet,          VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,          2, &bufferDescriptors[2] ),
+            WriteDescriptorSet( frame.lightsSet,          VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,          3, &bufferDescriptors[3] ),
+            WriteDescriptorSet( frame.lightsSet,          VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,          4, &bufferDescriptors[4] ),
+        };
+        g_renderState.device.UpdateDescriptorSets( static_cast< uint32_t >( writeDescriptorSets.size() ), writeDescriptorSets.data() );
+    }
 
     // SSAO Pass
     bufferDescriptors =
@@ -805,28 +831,53 @@ bool InitDescriptorPoolAndPrimarySets()
     };
     imageDescriptors =
     {
-        DescriptorImageInfo( gBufferPassData.gbuffer.positions, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL ),
-        DescriptorImageInfo( gBufferPassData.gbuffer.normals,   VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL ),
-        DescriptorImageInfo( ssaoPassData.noise,                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL ),
-        DescriptorImageInfo( ssaoPassData.texture,              VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL ),
+        DescriptorImageInfo( *s_renderGraphExecutor.GetTexture( s_graph.depth ),       VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL ),
+        DescriptorImageInfo( *s_renderGraphExecutor.GetTexture( s_graph.normals ),     VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL ),
+        DescriptorImageInfo( *s_renderGraphExecutor.GetTexture( s_graph.ssaoDepth ),   VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL ),
+        DescriptorImageInfo( *s_renderGraphExecutor.GetTexture( s_graph.ssaoNormals ), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL ),
+        DescriptorImageInfo( ssaoPassData.noise,                                       VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL ),
+        DescriptorImageInfo( *s_renderGraphExecutor.GetTexture( s_graph.ssao ),        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL ),
+        DescriptorImageInfo( *s_renderGraphExecutor.GetTexture( s_graph.ssaoBlurX ),   VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL ),
     };
     writeDescriptorSets =
     {
-        WriteDescriptorSet( descriptorSets.ssao,     VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 0, &imageDescriptors[0] ),
-        WriteDescriptorSet( descriptorSets.ssao,     VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, &imageDescriptors[1] ),
-        WriteDescriptorSet( descriptorSets.ssao,     VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2, &imageDescriptors[2] ),
-        WriteDescriptorSet( descriptorSets.ssao,     VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,         3, &bufferDescriptors[0] ),
-        WriteDescriptorSet( descriptorSets.ssaoBlur, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 0, &imageDescriptors[3] ),
+        WriteDescriptorSet( descriptorSets.ssaoDownsample, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 0, &imageDescriptors[0] ),
+        WriteDescriptorSet( descriptorSets.ssaoDownsample, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, &imageDescriptors[1] ),
+        WriteDescriptorSet( descriptorSets.ssao,           VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 0, &imageDescriptors[2] ),
+        WriteDescriptorSet( descriptorSets.ssao,           VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, &imageDescriptors[3] ),
+        WriteDescriptorSet( descriptorSets.ssao,           VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2, &imageDescriptors[4] ),
+        WriteDescriptorSet( descriptorSets.ssao,           VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,         3, &bufferDescriptors[0] ),
+        WriteDescriptorSet( descriptorSets.ssaoBlurX,      VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 0, &imageDescriptors[5] ),
+        WriteDescriptorSet( descriptorSets.ssaoBlurX,      VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, &imageDescriptors[2] ),
+        WriteDescriptorSet( descriptorSets.ssaoBlurY,      VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 0, &imageDescriptors[6] ),
+        WriteDescriptorSet( descriptorSets.ssaoBlurY,      VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, &imageDescriptors[2] ),
     };
     g_renderState.device.UpdateDescriptorSets( static_cast< uint32_t >( writeDescriptorSets.size() ), writeDescriptorSets.data() );
 
+    if ( s_ssaoResolution != RenderSystem::SSAOResolution::FULL )
+    {
+        imageDescriptors =
+        {
+            DescriptorImageInfo( *s_renderGraphExecutor.GetTexture( s_graph.ssaoBlur ),  VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL ),
+            DescriptorImageInfo( *s_renderGraphExecutor.GetTexture( s_graph.ssaoDepth ), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL ),
+            DescriptorImageInfo( *s_renderGraphExecutor.GetTexture( s_graph.depth ),     VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL ),
+        };
+        writeDescriptorSets =
+        {
+            WriteDescriptorSet( descriptorSets.ssaoUpsample, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 0, &imageDescriptors[0] ),
+            WriteDescriptorSet( descriptorSets.ssaoUpsample, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, &imageDescriptors[1] ),
+            WriteDescriptorSet( descriptorSets.ssaoUpsample, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2, &imageDescriptors[2] ),
+        };
+        g_renderState.device.UpdateDescriptorSets( static_cast< uint32_t >( writeDescriptorSets.size() ), writeDescriptorSets.data() );
+    }
+
     // Lighting Pass
     imageDescriptors =
     {
-        DescriptorImageInfo( gBufferPassData.gbuffer.positions,          VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL ),
-        DescriptorImageInfo( gBufferPassData.gbuffer.normals,            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL ),
-        DescriptorImageInfo( gBufferPassData.gbuffer.diffuseAndSpecular, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL ),
-        DescriptorImageInfo( ssaoBlurPassData.outputTex,                 VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL ),
+        DescriptorImageInfo( *s_renderGraphExecutor.GetTexture( s_graph.depth ),              VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL ),
+        DescriptorImageInfo( *s_renderGraphExecutor.GetTexture( s_graph.normals ),            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL ),
+        DescriptorImageInfo( *s_renderGraphExecutor.GetTexture( s_graph.diffuseAndSpecular ), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL ),
+        DescriptorImageInfo( *s_renderGraphExecutor.GetTexture( SSAOOutput() ),               VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL ),
     };
     writeDescriptorSets =
     {
@@ -837,11 +888,16 @@ bool InitDescriptorPoolAndPrimarySets()
     };
     g_renderState.device.UpdateDescriptorSets( static_cast< uint32_t >( writeDescriptorSets.size() ), writeDescriptorSets.data() );
 
-    // Post Process Pass
-    VkDescriptorImageInfo imageInfo = DescriptorImageInfo( lightingPassData.outputTexture, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL );
+    // HiZ Downsample Pass, and Post Process Pass
+    imageDescriptors =
+    {
+        DescriptorImageInfo( *s_renderGraphExecutor.GetTexture( s_graph.depth ),    VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL ),
+        DescriptorImageInfo( *s_renderGraphExecutor.GetTexture( s_graph.litScene ), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL ),
+    };
     writeDescriptorSets =
     {
-        WriteDescriptorSet( descriptorSets.postProcessInputColorTex, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 0, &imageInfo ),
+        WriteDescriptorSet( descriptorSets.hizDownsample,            VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 0, &imageDescriptors[0] ),
+        WriteDescriptorSet( descriptorSets.postProcessInputColorTex, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 0, &imageDescriptors[1] ),
     };
     g_renderState.device.UpdateDescriptorSets( static_cast< uint32_t >( writeDescriptorSets.size() ), writeDescriptorSets.data() );
 
@@ -853,17 +909,37 @@ namespace Progression
 namespace RenderSystem
 {
 
+    static bool InitRenderGraph();
+
     bool Init()
     {
+        PG_MEMORY_TAG( Rendering );
         s_window = GetMainWindow();
 
-        uint32_t numImages = static_cast< uint32_t >( g_renderState.swapChain.images.size() );
-        s_gpuSceneConstantBuffers = g_renderState.device.NewBuffer( sizeof( Gpu::SceneConstantBufferData ),
-                BUFFER_TYPE_UNIFORM, MEMORY_TYPE_HOST_VISIBLE | MEMORY_TYPE_HOST_COHERENT, "Scene Constants" );
-        s_gpuPointLightBuffers = g_renderState.device.NewBuffer( sizeof( PointLight ) * MAX_NUM_POINT_LIGHTS,
-                BUFFER_TYPE_STORAGE, MEMORY_TYPE_HOST_VISIBLE | MEMORY_TYPE_HOST_COHERENT, "Point Lights " );
-        s_gpuSpotLightBuffers = g_renderState.device.NewBuffer( sizeof( SpotLight ) * MAX_NUM_SPOT_LIGHTS,
-                BUFFER_TYPE_STORAGE, MEMORY_TYPE_HOST_VISIBLE | MEMORY_TYPE_HOST_COHERENT, "Spot Lights " );
+        for ( int i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i )
+        {
+            PerFrameData& frame       = s_frameData[i];
+            std::string suffix        = " frame " + std::to_string( i );
+            frame.sceneConstantBuffer = g_renderState.device.NewBuffer( sizeof( Gpu::SceneConstantBufferData ),
+                    BUFFER_TYPE_UNIFORM, MEMORY_TYPE_HOST_VISIBLE | MEMORY_TYPE_HOST_COHERENT, "Scene Constants" + suffix );
+            frame.pointLightBuffer    = g_renderState.device.NewBuffer( sizeof( PointLight ) * MAX_NUM_POINT_LIGHTS,
+                    BUFFER_TYPE_STORAGE, MEMORY_TYPE_HOST_VISIBLE | MEMORY_TYPE_HOST_COHERENT, "Point Lights" + suffix );
+            frame.spotLightBuffer     = g_renderState.device.NewBuffer( sizeof( SpotLight ) * MAX_NUM_SPOT_LIGHTS,
+                    BUFFER_TYPE_STORAGE, MEMORY_TYPE_HOST_VISIBLE | MEMORY_TYPE_HOST_COHERENT, "Spot Lights" + suffix );
+            frame.lightClusterBuffer  = g_renderState.device.NewBuffer( sizeof( Gpu::LightCluster ) * PG_NUM_LIGHT_CLUSTERS,
+                    BUFFER_TYPE_STORAGE, MEMORY_TYPE_HOST_VISIBLE | MEMORY_TYPE_HOST_COHERENT, "Light Clusters" + suffix );
+            frame.lightIndexBuffer    = g_renderState.device.NewBuffer( sizeof( uint32_t ) * PG_NUM_LIGHT_CLUSTERS * PG_MAX_LIGHTS_PER_CLUSTER,
+                    BUFFER_TYPE_STORAGE, MEMORY_TYPE_HOST_VISIBLE | MEMORY_TYPE_HOST_COHERENT, "Light Indices" + suffix );
+            frame.hizReadbackBuffer   = g_renderState.device.NewBuffer( sizeof( float ) * PG_HIZ_WIDTH * PG_HIZ_HEIGHT,
+                    BUFFER_TYPE_TRANSFER_DST, MEMORY_TYPE_HOST_VISIBLE | MEMORY_TYPE_HOST_COHERENT, "HiZ Readback" + suffix );
+        }
+
+        // The passes describe their pipelines against the graph's render passes
+        if ( !InitRenderGraph() )
+        {
+            LOG_ERR( "Could not init the render graph" );
+            return false;
+        }
 
         if ( !InitGBufferPassData() )
         {
@@ -883,6 +959,12 @@ namespace RenderSystem
             return false;
         }
 
+        if ( !InitHiZPassData() )
+        {
+            LOG_ERR( "Could not init HiZ pass data" );
+            return false;
+        }
+
         if ( !InitLightingPassData() )
         {
             LOG_ERR( "Could not init lighting pass data" );
@@ -907,12 +989,34 @@ namespace RenderSystem
             return false;
         }
 
+        if ( !CreateQueuedPipelines() )
+        {
+            LOG_ERR( "Could not create the render system pipelines" );
+            return false;
+        }
+
         if ( !InitDescriptorPoolAndPrimarySets() )
         {
             LOG_ERR( "Could not init descriptor pool and sets" );
             return false;
         }
 
+        for ( int frameIdx = 0; frameIdx < MAX_FRAMES_IN_FLIGHT; ++frameIdx )
+        {
+            auto& threadCommandBuffers = s_frameData[frameIdx].threadCommandBuffers;
+            threadCommandBuffers.resize( Jobs::NumThreads() );
+            for ( uint32_t i = 0; i < Jobs::NumThreads(); ++i )
+            {
+                std::string name = "secondary thread " + std::to_string( i ) + " frame " + std::to_string( frameIdx );
+                threadCommandBuffers[i].pool = g_renderState.device.NewCommandPool( COMMAND_POOL_TRANSIENT, CommandPoolQueueFamily::GRAPHICS, name );
+                if ( !threadCommandBuffers[i].pool )
+                {
+                    LOG_ERR( "Could not create the secondary command pool for thread ", i );
+                    return false;
+                }
+            }
+        }
+
         if ( !Profile::Init() )
         {
             LOG_ERR( "Could not initialize profiler" );
@@ -925,64 +1029,134 @@ namespace RenderSystem
             return false;
         }
 
-        s_gpuSceneConstantBuffers.Map();
-        s_gpuPointLightBuffers.Map();
-        s_gpuSpotLightBuffers.Map();
+#if USING( PG_PROFILING )
+        UIOverlay::AddDrawFunction( "CPU Profiler", []()
+        {
+            ImGui::SetNextWindowPos( ImVec2( 5, 200 ), ImGuiCond_FirstUseEver );
+            ImGui::Begin( "Profiler", nullptr, ImGuiWindowFlags_AlwaysAutoResize );
+            if ( UIOverlay::Button( "Export Chrome Trace" ) )
+            {
+                CpuProfile::ExportChromeTrace( PG_ROOT_DIR "logs/profile_trace.json" );
+            }
+            if ( ImGui::CollapsingHeader( "GPU (last / min / avg / p99 ms)", ImGuiTreeNodeFlags_DefaultOpen ) )
+            {
+                for ( uint32_t i = 0; i < static_cast< uint32_t >( Profile::GpuScope::NUM_SCOPES ); ++i )
+                {
+                    Profile::GpuScope scope = static_cast< Profile::GpuScope >( i );
+                    Profile::GpuStats stats = Profile::GetStats( scope );
+                    if ( stats.numSamples )
+                    {
+                        ImGui::Text( "%-12s %7.3f %7.3f %7.3f %7.3f", Profile::GetScopeName( scope ), stats.lastMs, stats.minMs, stats.avgMs, stats.p99Ms );
+                    }
+                }
+            }
+            if ( ImGui::CollapsingHeader( "CPU", ImGuiTreeNodeFlags_DefaultOpen ) )
+            {
+                CpuProfile::DrawZoneTree();
+            }
+            ImGui::End();
+        });
+#endif // #if USING( PG_PROFILING )
+
+#if USING( PG_MEMORY_TRACKING )
+        UIOverlay::AddDrawFunction( "Memory", []()
+        {
+            ImGui::SetNextWindowPos( ImVec2( 5, 500 ), ImGuiCond_FirstUseEver );
+            ImGui::Begin( "Memory", nullptr, ImGuiWindowFlags_AlwaysAutoResize );
+            if ( UIOverlay::Button( "Dump to JSON" ) )
+            {
+                MemoryManager::DumpMemoryStats( PG_ROOT_DIR "logs/memory_stats.json" );
+            }
+            MemoryManager::DrawMemoryStats();
+            DeviceMemoryStats deviceStats = g_renderState.device.GetMemoryStats();
+            ImGui::Text( "Device memory: %u allocations in %u blocks, %.1f / %.1f MB used", deviceStats.numAllocations, deviceStats.numBlocks,
+                         deviceStats.usedBytes / ( 1024.0 * 1024.0 ), deviceStats.blockBytes / ( 1024.0 * 1024.0 ) );
+            ImGui::End();
+        });
+#endif // #if USING( PG_MEMORY_TRACKING )
+
+        for ( PerFrameData& frame : s_frameData )
+        {
+            frame.sceneConstantBuffer.Map();
+            frame.pointLightBuffer.Map();
+            frame.spotLightBuffer.Map();
+            frame.lightClusterBuffer.Map();
+            frame.lightIndexBuffer.Map();
+            frame.hizReadbackBuffer.Map();
+        }
 
         return true;
     }
 
     void Shutdown()
     {
+        UploadManager::WaitForAll();
         g_renderState.device.WaitForIdle();
         
         UIOverlay::Shutdown();
         Profile::Shutdown();
 
-        s_gpuSceneConstantBuffers.UnMap();
-        s_gpuPointLightBuffers.UnMap();
-        s_gpuSpotLightBuffers.UnMap();
+        for ( PerFrameData& frame : s_frameData )
+        {
+            for ( ThreadCommandBuffers& thread : frame.threadCommandBuffers )
+            {
+                thread.pool.Free();
+            }
+            frame.threadCommandBuffers.clear();
+
+            frame.sceneConstantBuffer.UnMap();
+            frame.pointLightBuffer.UnMap();
+            frame.spotLightBuffer.UnMap();
+            frame.lightClusterBuffer.UnMap();
+            frame.lightIndexBuffer.UnMap();
+            frame.hizReadbackBuffer.UnMap();
+        }
 
-        shadowPassData.renderPass.Free();
         shadowPassData.rigidPipeline.Free();
-        shadowPassData.animatedPipeline.Free();
-        FreeDescriptorSetLayouts( shadowPassData.animatedDescriptorSetLayouts );
+        shadowPassData.compositePipeline.Free();
+        FreeDescriptorSetLayouts( shadowPassData.compositeDescriptorSetLayouts );
 
         s_descriptorPool.Free();
 
-        s_gpuSceneConstantBuffers.Free();
-        s_gpuPointLightBuffers.Free();
-        s_gpuSpotLightBuffers.Free();
+        for ( PerFrameData& frame : s_frameData )
+        {
+            frame.sceneConstantBuffer.Free();
+            frame.pointLightBuffer.Free();
+            frame.spotLightBuffer.Free();
+            frame.lightClusterBuffer.Free();
+            frame.lightIndexBuffer.Free();
+            frame.hizReadbackBuffer.Free();
+        }
+
+        s_renderGraphExecutor.Free();
+        s_renderGraph.Reset();
 
-        gBufferPassData.gbuffer.positions.Free();
-        gBufferPassData.gbuffer.normals.Free();
-        gBufferPassData.gbuffer.diffuseAndSpecular.Free();
-        gBufferPassData.renderPass.Free();
-        gBufferPassData.frameBuffer.Free();
         gBufferPassData.pipeline.Free();
         FreeDescriptorSetLayouts( gBufferPassData.descriptorSetLayouts );
 
-        ssaoPassData.renderPass.Free();
-        ssaoPassData.texture.Free();
-        ssaoPassData.frameBuffer.Free();
+        ssaoDownsamplePassData.pipeline.Free();
+        FreeDescriptorSetLayouts( ssaoDownsamplePassData.descriptorSetLayouts );
+
         ssaoPassData.pipeline.Free();
         ssaoPassData.kernel.Free();
         ssaoPassData.noise.Free();
         FreeDescriptorSetLayouts( ssaoPassData.descriptorSetLayouts );
 
         ssaoBlurPassData.pipeline.Free();
-        ssaoBlurPassData.renderPass.Free();
-        ssaoBlurPassData.outputTex.Free();
-        ssaoBlurPassData.framebuffer.Free();
         FreeDescriptorSetLayouts( ssaoBlurPassData.descriptorSetLayouts );
 
-        lightingPassData.renderPass.Free();
-        lightingPassData.outputTexture.Free();
-        lightingPassData.frameBuffer.Free();
+        if ( ssaoUpsamplePassData.pipeline )
+        {
+            ssaoUpsamplePassData.pipeline.Free();
+            FreeDescriptorSetLayouts( ssaoUpsamplePassData.descriptorSetLayouts );
+        }
+
+        hizPassData.pipeline.Free();
+        FreeDescriptorSetLayouts( hizPassData.descriptorSetLayouts );
+
         lightingPassData.pipeline.Free();
         FreeDescriptorSetLayouts( lightingPassData.descriptorSetLayouts );
 
-        backgroundPassData.renderPass.Free();
         backgroundPassData.cubeBuffer.Free();
         backgroundPassData.solidColorPipeline.Free();
         backgroundPassData.skyboxPipeline.Free();
@@ -996,35 +1170,256 @@ namespace RenderSystem
         postProcessPassData.quadBuffer.Free();
     }
     
-    void UpdateBuffersAndTextures( Scene* scene )
+    void CullScene( Scene* scene )
     {
-        TextureManager::UpdateDescriptors( descriptorSets.arrayOfTextures );
-
-        // skybox texture
-        if ( scene->skybox )
+        PG_PROFILE_SCOPE( "CullScene" );
+        s_culledScene = scene;
+        s_visibleModels.clear();
+        for ( uint32_t cascade = 0; cascade < PG_NUM_SHADOW_CASCADES; ++cascade )
         {
-            VkDescriptorImageInfo imageDesc = DescriptorImageInfo( *scene->skybox->GetTexture(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL );
-            VkWriteDescriptorSet writeSet   = WriteDescriptorSet( descriptorSets.background, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 0, &imageDesc );
-            g_renderState.device.UpdateDescriptorSets( 1, &writeSet );
+            s_shadowCasters[cascade].clear();
+            s_staticShadowCasters[cascade].clear();
+            s_redrawStaticShadows[cascade] = false;
         }
-        
-        Gpu::SceneConstantBufferData scbuf;
+        // The camera scripts only keep the view matrix up to date, not the frustum
+        scene->camera.UpdateFrustum();
+        const Frustum frustum = scene->camera.GetFrustum();
 
-        glm::vec3 pos( 0, 20, 10 );
-        //auto entity = GetEntityByName( scene->registry, "camera" );
-        //auto scriptData = scene->registry.get< ScriptComponent >( entity ).GetScriptData( "lightController" );
-        //const glm::vec3& pos = scriptData->env["position"];
-        auto V = glm::lookAt( pos, pos + glm::vec3( scene->directionalLight.direction ), glm::vec3( 0, 1, 0 ) );
-        auto P = glm::ortho< float >( -30, 30, -30, 30, 0.0f, 100.0f );
-        if ( scene->directionalLight.shadowMap )
+        // Each cascade covers its slice of the view frustum, and only the casters that can shadow it get drawn into it
+        ShadowMap* shadowMap = scene->directionalLight.shadowMap.get();
+        if ( shadowMap )
         {
-            scene->directionalLight.shadowMap->LSM = P * V;
-            scbuf.LSM = scene->directionalLight.shadowMap->LSM;
-        }
+            const Camera& camera = scene->camera;
+            float splits[PG_NUM_SHADOW_CASCADES];
+            ComputeCascadeSplits( camera.nearPlane, camera.farPlane, shadowMap->cascadeSplitLambda, splits );
+            // The size of a quadrant, like CascadeRect
+            glm::uvec2 resolution( shadowMap->width / 2, shadowMap->height / 2 );
+            for ( uint32_t cascade = 0; cascade < PG_NUM_SHADOW_CASCADES; ++cascade )
+            {
+                float sliceStart = cascade == 0 ? camera.nearPlane : splits[cascade - 1];
+                shadowMap->cascades[cascade].Fit( camera, glm::vec3( scene->directionalLight.direction ), sliceStart, splits[cascade], resolution );
+            }
+        }
+
+        // The static casters go first, so the cascades only move for the dynamic ones if they stick out
+        // in front of every static caster
+        s_dynamicCasterBoxes.clear();
+        scene->registry.view< ModelRenderer, WorldTransform >().each( [&]( const entt::entity e, ModelRenderer& renderer, const WorldTransform& transform )
+        {
+            AABB box = renderer.model->aabb.Transformed( transform.M );
+            if ( frustum.BoxInFrustum( box ) )
+            {
+                s_visibleModels.push_back( e );
+            }
+            if ( !shadowMap )
+            {
+                return;
+            }
+            const EntityMetaData* metaData = scene->registry.try_get< EntityMetaData >( e );
+            if ( !metaData || !metaData->isStatic )
+            {
+                s_dynamicCasterBoxes.emplace_back( e, box );
+                return;
+            }
+            for ( uint32_t cascade = 0; cascade < PG_NUM_SHADOW_CASCADES; ++cascade )
+            {
+                if ( shadowMap->cascades[cascade].AddCaster( box ) )
+                {
+                    s_staticShadowCasters[cascade].push_back( e );
+                }
+            }
+        });
+        if ( !shadowMap )
+        {
+            return;
+        }
+
+        for ( const auto& caster : s_dynamicCasterBoxes )
+        {
+            for ( uint32_t cascade = 0; cascade < PG_NUM_SHADOW_CASCADES; ++cascade )
+            {
+                if ( shadowMap->cascades[cascade].AddCaster( caster.second ) )
+                {
+                    s_shadowCasters[cascade].push_back( caster.first );
+                }
+            }
+        }
+
+        // The static casters are assumed to never move, so a cascade's cache is still good as long as
+        // the cascade and the list of static casters in it stay the same
+        for ( uint32_t cascade = 0; cascade < PG_NUM_SHADOW_CASCADES; ++cascade )
+        {
+            const glm::mat4& VP = shadowMap->cascades[cascade].GetVP();
+            if ( shadowMap->staticVPs[cascade] != VP || shadowMap->staticCasters[cascade] != s_staticShadowCasters[cascade] )
+            {
+                shadowMap->staticVPs[cascade]     = VP;
+                shadowMap->staticCasters[cascade] = s_staticShadowCasters[cascade];
+                s_redrawStaticShadows[cascade]    = true;
+            }
+        }
+    }
+
+    // Doesn't touch any of the frame's data, so it runs before waiting on the frame's fence
+    static void AssignLightsToClusters( Scene* scene )
+    {
+        PG_PROFILE_SCOPE( "AssignLightsToClusters" );
+        const Camera& camera = scene->camera;
+        s_lightClusters.SetProjection( camera.fov, camera.aspectRatio, camera.nearPlane, camera.farPlane );
+
+        s_pointLightSpheres.clear();
+        for ( const PointLight& light : scene->pointLights )
+        {
+            s_pointLightSpheres.push_back( light.positionAndRadius );
+        }
+        s_spotLightSpheres.clear();
+        s_spotLightCones.clear();
+        for ( const SpotLight& light : scene->spotLights )
+        {
+            s_spotLightSpheres.push_back( light.positionAndRadius );
+            s_spotLightCones.push_back( light.directionAndCutoff );
+        }
+        s_lightClusters.Assign( camera.GetV(), s_pointLightSpheres, s_spotLightSpheres, s_spotLightCones );
+    }
+
+    static uint32_t EntityIndex( entt::entity e )
+    {
+        using Traits = entt::entt_traits< std::underlying_type_t< entt::entity > >;
+        return static_cast< uint32_t >( e ) & Traits::entity_mask;
+    }
+
+    // Has to run after waiting on the frame's fence, since it reads the frame's depth readback. Drops the
+    // models and meshes from s_visibleModels that the depth says are hidden, see s_occlusionHistory
+    static void OcclusionCullScene( Scene* scene )
+    {
+        PG_PROFILE_SCOPE( "OcclusionCullScene" );
+        const PerFrameData& frame = CurrentFrameData();
+        if ( s_occlusionCulling && frame.hizWritten )
+        {
+            s_depthPyramid.Build( reinterpret_cast< const float* >( frame.hizReadbackBuffer.MappedPtr() ), PG_HIZ_WIDTH, PG_HIZ_HEIGHT, frame.hizVP );
+        }
+        else
+        {
+            s_depthPyramid.Clear();
+        }
+
+        const OcclusionHistory& lastFrame = s_occlusionHistory[s_currentOcclusionHistory];
+        s_currentOcclusionHistory         = 1 - s_currentOcclusionHistory;
+        OcclusionHistory& thisFrame       = s_occlusionHistory[s_currentOcclusionHistory];
+        thisFrame.meshRanges.assign( scene->registry.size(), {} );
+        thisFrame.meshPassed.clear();
+
+        s_visibleMeshOffsets.clear();
+        s_visibleMeshes.clear();
+        size_t numVisibleModels = 0;
+        for ( entt::entity e : s_visibleModels )
+        {
+            const Model& model  = *scene->registry.get< ModelRenderer >( e ).model;
+            const glm::mat4& M  = scene->registry.get< WorldTransform >( e ).M;
+            uint32_t numMeshes  = static_cast< uint32_t >( model.meshes.size() );
+            uint32_t index      = EntityIndex( e );
+            bool hasHistory     = index < lastFrame.meshRanges.size() && lastFrame.meshRanges[index].entity == e &&
+                                  lastFrame.meshRanges[index].numMeshes == numMeshes;
+            uint32_t lastFirst  = hasHistory ? lastFrame.meshRanges[index].firstMesh : 0;
+            bool modelPassed    = s_depthPyramid.IsBoxVisible( model.aabb.Transformed( M ) );
+            uint32_t firstMesh  = static_cast< uint32_t >( s_visibleMeshes.size() );
+            thisFrame.meshRanges[index] = { e, static_cast< uint32_t >( thisFrame.meshPassed.size() ), numMeshes };
+            for ( uint32_t i = 0; i < numMeshes; ++i )
+            {
+                // The only mesh of a model has the model's box
+                bool passed = modelPassed && ( numMeshes == 1 || s_depthPyramid.IsBoxVisible( model.meshes[i].aabb.Transformed( M ) ) );
+                thisFrame.meshPassed.push_back( passed );
+                if ( passed || ( hasHistory && lastFrame.meshPassed[lastFirst + i] ) )
+                {
+                    s_visibleMeshes.push_back( i );
+                }
+            }
+            if ( s_visibleMeshes.size() > firstMesh )
+            {
+                s_visibleModels[numVisibleModels++] = e;
+                s_visibleMeshOffsets.push_back( firstMesh );
+            }
+        }
+        s_visibleModels.resize( numVisibleModels );
+        s_visibleMeshOffsets.push_back( static_cast< uint32_t >( s_visibleMeshes.size() ) );
+    }
+
+    uint32_t GetNumVisibleModels()
+    {
+        return static_cast< uint32_t >( s_visibleModels.size() );
+    }
+
+    void SetOcclusionCulling( bool enabled )
+    {
+        s_occlusionCulling = enabled;
+    }
+
+    bool GetOcclusionCulling()
+    {
+        return s_occlusionCulling;
+    }
+
+    void SetSSAOResolution( SSAOResolution resolution )
+    {
+        s_ssaoResolution = resolution;
+    }
+
+    SSAOResolution GetSSAOResolution()
+    {
+        return s_ssaoResolution;
+    }
+
+    bool SetSSAOKernelSize( uint32_t kernelSize )
+    {
+        bool powerOfTwo = ( kernelSize & ( kernelSize - 1 ) ) == 0;
+        if ( !powerOfTwo || kernelSize < PG_SSAO_MIN_KERNEL_SIZE || PG_SSAO_MAX_KERNEL_SIZE < kernelSize )
+        {
+            return false;
+        }
+        s_ssaoKernelSize = kernelSize;
+        return true;
+    }
+
+    uint32_t GetSSAOKernelSize()
+    {
+        return s_ssaoKernelSize;
+    }
+
+    void UpdateBuffersAndTextures( Scene* scene )
+    {
+        PG_PROFILE_SCOPE( "UpdateBuffersAndTextures" );
+        PerFrameData& frame = CurrentFrameData();
+        TextureManager::UpdateDescriptors( frame.arrayOfTexturesSet, g_renderState.currentFrame );
+
+        // skybox texture
+        if ( scene->skybox )
+        {
+            VkDescriptorImageInfo imageDesc = DescriptorImageInfo( *scene->skybox->GetTexture(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL );
+            VkWriteDescriptorSet writeSet   = WriteDescriptorSet( frame.backgroundSet, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 0, &imageDesc );
+            g_renderState.device.UpdateDescriptorSets( 1, &writeSet );
+        }
+        
+        if ( scene->directionalLight.shadowMap )
+        {
+            VkDescriptorImageInfo imageDesc = DescriptorImageInfo( scene->directionalLight.shadowMap->staticTexture, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL );
+            VkWriteDescriptorSet writeSet   = WriteDescriptorSet( frame.staticShadowSet, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 0, &imageDesc );
+            g_renderState.device.UpdateDescriptorSets( 1, &writeSet );
+        }
+        
+        Gpu::SceneConstantBufferData scbuf;
+        if ( scene->directionalLight.shadowMap )
+        {
+            // CullScene already fit the cascades
+            for ( uint32_t cascade = 0; cascade < PG_NUM_SHADOW_CASCADES; ++cascade )
+            {
+                scbuf.cascadeVPs[cascade]    = scene->directionalLight.shadowMap->cascades[cascade].GetVP();
+                scbuf.cascadeSplits[cascade] = scene->directionalLight.shadowMap->cascades[cascade].GetSliceEnd();
+            }
+        }
 
         scbuf.V                          = scene->camera.GetV();
         scbuf.P                          = scene->camera.GetP();
         scbuf.VP                         = scene->camera.GetVP();
+        scbuf.invVP                      = glm::inverse( scbuf.VP );
         scbuf.cameraPos                  = glm::vec4( scene->camera.position, 0 );        
         scbuf.ambientColor               = glm::vec4( scene->ambientColor, 0 );
         scbuf.dirLight.colorAndIntensity = scene->directionalLight.colorAndIntensity;
@@ -1034,17 +1429,18 @@ namespace RenderSystem
         {
             scbuf.dirLight.shadowMapIndex.x = scene->directionalLight.shadowMap->texture.GetShaderSlot();
         }
+        scbuf.lightClusterParams = s_lightClusters.GetShaderParams();
         scbuf.numPointLights = static_cast< uint32_t >( scene->pointLights.size() );
         scbuf.numSpotLights  = static_cast< uint32_t >( scene->spotLights.size() );
-        memcpy( s_gpuSceneConstantBuffers.MappedPtr(), &scbuf, sizeof( Gpu::SceneConstantBufferData ) );
+        memcpy( frame.sceneConstantBuffer.MappedPtr(), &scbuf, sizeof( Gpu::SceneConstantBufferData ) );
 
-        Gpu::PointLight* gpuPointLights = (Gpu::PointLight*) s_gpuPointLightBuffers.MappedPtr();
+        Gpu::PointLight* gpuPointLights = (Gpu::PointLight*) frame.pointLightBuffer.MappedPtr();
         for ( size_t i = 0; i < scene->pointLights.size(); ++i )
         {
             gpuPointLights[i].colorAndIntensity = scene->pointLights[i].colorAndIntensity;
             gpuPointLights[i].positionAndRadius = scene->pointLights[i].positionAndRadius;
         }
-        Gpu::SpotLight* gpuSpotLights = (Gpu::SpotLight*) s_gpuSpotLightBuffers.MappedPtr();
+        Gpu::SpotLight* gpuSpotLights = (Gpu::SpotLight*) frame.spotLightBuffer.MappedPtr();
         for ( size_t i = 0; i < scene->spotLights.size(); ++i )
         {
             gpuSpotLights[i].colorAndIntensity  = scene->spotLights[i].colorAndIntensity;
@@ -1052,28 +1448,47 @@ namespace RenderSystem
             gpuSpotLights[i].directionAndCutoff = scene->spotLights[i].directionAndCutoff;
         }
 
+        memcpy( frame.lightClusterBuffer.MappedPtr(), s_lightClusters.GetClusters().data(), sizeof( Gpu::LightCluster ) * PG_NUM_LIGHT_CLUSTERS );
+        memcpy( frame.lightIndexBuffer.MappedPtr(), s_lightClusters.GetLightIndices().data(), sizeof( uint32_t ) * s_lightClusters.GetLightIndices().size() );
+
         AnimationSystem::UploadToGpu( scene );
     }
 
-    static void RenderSingleShadow( Scene* scene, CommandBuffer& cmdBuf, const ShadowMap& shadowMap )
+    // The cascade's quadrant of the shadow map, and of its static cache
+    static Scissor CascadeRect( const ShadowMap& shadowMap, uint32_t cascade )
     {
-        float width  = static_cast< float >( shadowMap.texture.GetWidth() );
-        float height = static_cast< float >( shadowMap.texture.GetHeight() );
-        Viewport viewport( width, -height );
-        viewport.y = height;
-        Scissor scissor( (int) width, (int) height );
+        Scissor rect( shadowMap.texture.GetWidth() / 2, shadowMap.texture.GetHeight() / 2 );
+        rect.x = ( cascade % 2 ) * rect.width;
+        rect.y = ( cascade / 2 ) * rect.height;
 
-        cmdBuf.BeginRenderPass( shadowPassData.renderPass, shadowMap.framebuffer, { shadowMap.texture.GetWidth(), shadowMap.texture.GetHeight() } );
+        return rect;
+    }
+
+    // Limits the draws to the cascade's quadrant
+    static void BindShadowState( CommandBuffer& cmdBuf, const ShadowMap& shadowMap, uint32_t cascade )
+    {
+        Scissor scissor = CascadeRect( shadowMap, cascade );
+        Viewport viewport( static_cast< float >( scissor.width ), -static_cast< float >( scissor.height ) );
+        viewport.x = static_cast< float >( scissor.x );
+        viewport.y = static_cast< float >( scissor.y + scissor.height );
 
-        PG_DEBUG_MARKER_BEGIN_REGION( cmdBuf, "Shadow rigid models", glm::vec4( .2, .6, .4, 1 ) );
         cmdBuf.BindRenderPipeline( shadowPassData.rigidPipeline );
         cmdBuf.SetViewport( viewport );
         cmdBuf.SetScissor( scissor );
         cmdBuf.SetDepthBias( shadowMap.constantBias, 0, shadowMap.slopeBias );
-        scene->registry.view< ModelRenderer, Transform >().each( [&]( ModelRenderer& renderer, Transform& transform )
+    }
+
+    static void RecordRigidShadowDraws( Scene* scene, CommandBuffer& cmdBuf, const ShadowMap& shadowMap, uint32_t cascade,
+                                        const std::vector< entt::entity >& casters, size_t begin, size_t end )
+    {
+        PG_DEBUG_MARKER_BEGIN_REGION( cmdBuf, "Shadow rigid models", glm::vec4( .2, .6, .4, 1 ) );
+        BindShadowState( cmdBuf, shadowMap, cascade );
+        for ( size_t modelIdx = begin; modelIdx < end; ++modelIdx )
         {
+            const ModelRenderer& renderer   = scene->registry.get< ModelRenderer >( casters[modelIdx] );
+            const WorldTransform& transform = scene->registry.get< WorldTransform >( casters[modelIdx] );
             const auto& model = renderer.model;
-            auto MVP = shadowMap.LSM * transform.GetModelMatrix();
+            auto MVP = shadowMap.cascades[cascade].GetVP() * transform.M;
             cmdBuf.PushConstants( shadowPassData.rigidPipeline, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof( glm::mat4 ), &MVP[0][0] );
         
             cmdBuf.BindVertexBuffer( model->vertexBuffer, model->GetVertexOffset(), 0 );
@@ -1085,23 +1500,37 @@ namespace RenderSystem
                 PG_DEBUG_MARKER_INSERT( cmdBuf, "Draw \"" + model->name + "\" : \"" + mesh.name + "\"", glm::vec4( 0 ) );
                 cmdBuf.DrawIndexed( mesh.startIndex, mesh.numIndices, mesh.startVertex );
             }
-        });
+        }
         PG_DEBUG_MARKER_END_REGION( cmdBuf );
+    }
 
-        PG_DEBUG_MARKER_BEGIN_REGION( cmdBuf, "Shadow animated models", glm::vec4( .6, .2, .4, 1 ) );
-        cmdBuf.BindRenderPipeline( shadowPassData.animatedPipeline );
+    // Copies the static casters' depth over the whole shadow map
+    static void RecordStaticShadowComposite( CommandBuffer& cmdBuf, const ShadowMap& shadowMap )
+    {
+        PG_DEBUG_MARKER_BEGIN_REGION( cmdBuf, "Shadow static composite", glm::vec4( .4, .4, .6, 1 ) );
+        Viewport viewport( static_cast< float >( shadowMap.texture.GetWidth() ), static_cast< float >( shadowMap.texture.GetHeight() ) );
+        Scissor scissor( shadowMap.texture.GetWidth(), shadowMap.texture.GetHeight() );
+        cmdBuf.BindRenderPipeline( shadowPassData.compositePipeline );
         cmdBuf.SetViewport( viewport );
         cmdBuf.SetScissor( scissor );
-        cmdBuf.SetDepthBias( shadowMap.constantBias, 0, shadowMap.slopeBias );
-        cmdBuf.BindDescriptorSets( 1, &AnimationSystem::renderData.animationBonesDescriptorSet, shadowPassData.animatedPipeline, PG_BONE_TRANSFORMS_SET );
-        scene->registry.view< Animator, SkinnedRenderer, Transform >().each( [&]( Animator& animator, SkinnedRenderer& renderer, Transform& transform )
+        cmdBuf.BindDescriptorSets( 1, &CurrentFrameData().staticShadowSet, shadowPassData.compositePipeline );
+        cmdBuf.BindVertexBuffer( postProcessPassData.quadBuffer, 0, 0 );
+        cmdBuf.Draw( 0, 6 );
+        PG_DEBUG_MARKER_END_REGION( cmdBuf );
+    }
+
+    // Skinned models don't have bounds to cull with, so they go into every cascade
+    static void RecordAnimatedShadowDraws( Scene* scene, CommandBuffer& cmdBuf, const ShadowMap& shadowMap, uint32_t cascade )
+    {
+        PG_DEBUG_MARKER_BEGIN_REGION( cmdBuf, "Shadow animated models", glm::vec4( .6, .2, .4, 1 ) );
+        BindShadowState( cmdBuf, shadowMap, cascade );
+        scene->registry.view< Animator, SkinnedRenderer, WorldTransform >().each( [&]( Animator& animator, SkinnedRenderer& renderer, const WorldTransform& transform )
         {
             const auto& model = renderer.model;
-            Gpu::AnimatedShadowPerObjectData pushData{ shadowMap.LSM * transform.GetModelMatrix(), animator.GetTransformSlot() };
-            cmdBuf.PushConstants( shadowPassData.animatedPipeline, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof( Gpu::AnimatedShadowPerObjectData ), &pushData );
+            auto MVP = shadowMap.cascades[cascade].GetVP() * transform.M;
+            cmdBuf.PushConstants( shadowPassData.rigidPipeline, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof( glm::mat4 ), &MVP[0][0] );
         
-            cmdBuf.BindVertexBuffer( model->vertexBuffer, model->GetVertexOffset(), 0 );
-            cmdBuf.BindVertexBuffer( model->vertexBuffer, model->GetBlendWeightOffset(), 1 );
+            cmdBuf.BindVertexBuffer( AnimationSystem::renderData.skinnedVertexBuffer, animator.GetSkinnedPositionOffset(), 0 );
             cmdBuf.BindIndexBuffer(  model->indexBuffer, model->GetIndexType() );
         
             for ( size_t i = 0; i < model->meshes.size(); ++i )
@@ -1112,46 +1541,31 @@ namespace RenderSystem
             }
         });
         PG_DEBUG_MARKER_END_REGION( cmdBuf );
-
-        cmdBuf.EndRenderPass();
     }
 
-    void ShadowPass( Scene* scene, CommandBuffer& cmdBuf )
+    static void BindGBufferState( CommandBuffer& cmdBuf )
     {
-        PG_PROFILE_TIMESTAMP( cmdBuf, "Shadow_Start" );
-        PG_DEBUG_MARKER_BEGIN_REGION( cmdBuf, "Shadow Pass", glm::vec4( .2, .2, .4, 1 ) );
-        
-        if ( scene->directionalLight.shadowMap )
-        {
-            RenderSingleShadow( scene, cmdBuf, *scene->directionalLight.shadowMap );
-        }
-
-        PG_DEBUG_MARKER_END_REGION( cmdBuf );
-        PG_PROFILE_TIMESTAMP( cmdBuf, "Shadow_End" );
+        cmdBuf.BindRenderPipeline( gBufferPassData.pipeline );
+        cmdBuf.BindDescriptorSets( 1, &CurrentFrameData().sceneSet, gBufferPassData.pipeline, PG_SCENE_CONSTANT_BUFFER_SET );
+        cmdBuf.BindDescriptorSets( 1, &CurrentFrameData().arrayOfTexturesSet, gBufferPassData.pipeline, PG_2D_TEXTURES_SET );
     }
 
-    void GBufferPass( Scene* scene, CommandBuffer& cmdBuf )
+    static void RecordRigidGBufferDraws( Scene* scene, CommandBuffer& cmdBuf, size_t begin, size_t end )
     {
-        PG_PROFILE_TIMESTAMP( cmdBuf, "GBuffer_Start" );
-        PG_DEBUG_MARKER_BEGIN_REGION( cmdBuf, "GBuffer Pass", glm::vec4( .8, .8, .2, 1 ) );
-        cmdBuf.BeginRenderPass( gBufferPassData.renderPass, gBufferPassData.frameBuffer, g_renderState.swapChain.extent );
         PG_DEBUG_MARKER_BEGIN_REGION( cmdBuf, "GBuffer -- Rigid Models", glm::vec4( .2, .8, .2, 1 ) );
-        cmdBuf.BindRenderPipeline( gBufferPassData.pipeline );
-        cmdBuf.BindDescriptorSets( 1, &descriptorSets.scene, gBufferPassData.pipeline, PG_SCENE_CONSTANT_BUFFER_SET );
-        cmdBuf.BindDescriptorSets( 1, &descriptorSets.arrayOfTextures, gBufferPassData.pipeline, PG_2D_TEXTURES_SET );
-
-        scene->registry.view< ModelRenderer, Transform >().each( [&]( ModelRenderer& modelRenderer, Transform& transform )
+        BindGBufferState( cmdBuf );
+        for ( size_t modelIdx = begin; modelIdx < end; ++modelIdx )
         {
+            const ModelRenderer& modelRenderer = scene->registry.get< ModelRenderer >( s_visibleModels[modelIdx] );
+            const WorldTransform& transform    = scene->registry.get< WorldTransform >( s_visibleModels[modelIdx] );
             const auto& model = modelRenderer.model;
             // TODO: Actually fix this for models without tangets as well
             if ( model->GetTangentOffset() == ~0u )
             {
-                return;
+                continue;
             }
             
-            auto M = transform.GetModelMatrix();
-            auto N = glm::transpose( glm::inverse( M ) );
-            Gpu::ObjectConstantBufferData b{ M, N };
+            Gpu::ObjectConstantBufferData b{ transform.M, transform.N };
             cmdBuf.PushConstants( gBufferPassData.pipeline, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof( Gpu::ObjectConstantBufferData ), &b );
 
             cmdBuf.BindVertexBuffer( model->vertexBuffer, model->GetVertexOffset(), 0 );
@@ -1160,9 +1574,9 @@ namespace RenderSystem
             cmdBuf.BindVertexBuffer( model->vertexBuffer, model->GetTangentOffset(), 3 );
             cmdBuf.BindIndexBuffer(  model->indexBuffer, model->GetIndexType() );
 
-            for ( size_t i = 0; i < model->meshes.size(); ++i )
+            for ( uint32_t i = s_visibleMeshOffsets[modelIdx]; i < s_visibleMeshOffsets[modelIdx + 1]; ++i )
             {
-                const auto& mesh = modelRenderer.model->meshes[i];
+                const auto& mesh = modelRenderer.model->meshes[s_visibleMeshes[i]];
                 const auto& mat  = modelRenderer.materials[mesh.materialIndex];
                 // if ( mat->transparent )
                 // {
@@ -1179,16 +1593,16 @@ namespace RenderSystem
                 PG_DEBUG_MARKER_INSERT( cmdBuf, "Draw \"" + model->name + "\" : \"" + mesh.name + "\"", glm::vec4( 0 ) );
                 cmdBuf.DrawIndexed( mesh.startIndex, mesh.numIndices, mesh.startVertex );
             }
-        });
+        }
         PG_DEBUG_MARKER_END_REGION( cmdBuf );
+    }
 
+    // Skinned models were already skinned in the SkinningPass, so they go through the rigid pipeline
+    static void RecordAnimatedGBufferDraws( Scene* scene, CommandBuffer& cmdBuf )
+    {
         PG_DEBUG_MARKER_BEGIN_REGION( cmdBuf, "GBuffer animated models", glm::vec4( .8, .2, .2, 1 ) );
-        auto& animPipeline = AnimationSystem::renderData.animatedPipeline;
-        cmdBuf.BindRenderPipeline( animPipeline );
-        cmdBuf.BindDescriptorSets( 1, &descriptorSets.scene, animPipeline, PG_SCENE_CONSTANT_BUFFER_SET );
-        cmdBuf.BindDescriptorSets( 1, &descriptorSets.arrayOfTextures, animPipeline, PG_2D_TEXTURES_SET );
-        cmdBuf.BindDescriptorSets( 1, &AnimationSystem::renderData.animationBonesDescriptorSet, animPipeline, PG_BONE_TRANSFORMS_SET );
-        scene->registry.view< Animator, SkinnedRenderer, Transform >().each( [&]( Animator& animator, SkinnedRenderer& renderer, Transform& transform )
+        BindGBufferState( cmdBuf );
+        scene->registry.view< Animator, SkinnedRenderer, WorldTransform >().each( [&]( Animator& animator, SkinnedRenderer& renderer, const WorldTransform& transform )
         {
             const auto& model = renderer.model;
             // TODO: Actually fix this for models without tangets as well
@@ -1197,16 +1611,14 @@ namespace RenderSystem
                 return;
             }
             
-            auto M = transform.GetModelMatrix();
-            auto N = glm::transpose( glm::inverse( M ) );
-            Gpu::AnimatedObjectConstantBufferData b{ M, N, animator.GetTransformSlot() };
-            cmdBuf.PushConstants( animPipeline, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof( Gpu::AnimatedObjectConstantBufferData ), &b );
+            Gpu::ObjectConstantBufferData b{ transform.M, transform.N };
+            cmdBuf.PushConstants( gBufferPassData.pipeline, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof( Gpu::ObjectConstantBufferData ), &b );
 
-            cmdBuf.BindVertexBuffer( model->vertexBuffer, model->GetVertexOffset(), 0 );
-            cmdBuf.BindVertexBuffer( model->vertexBuffer, model->GetNormalOffset(), 1 );
+            const Buffer& skinnedVertexBuffer = AnimationSystem::renderData.skinnedVertexBuffer;
+            cmdBuf.BindVertexBuffer( skinnedVertexBuffer, animator.GetSkinnedPositionOffset(), 0 );
+            cmdBuf.BindVertexBuffer( skinnedVertexBuffer, animator.GetSkinnedNormalOffset(), 1 );
             cmdBuf.BindVertexBuffer( model->vertexBuffer, model->GetUVOffset(), 2 );
-            cmdBuf.BindVertexBuffer( model->vertexBuffer, model->GetTangentOffset(), 3 );
-            cmdBuf.BindVertexBuffer( model->vertexBuffer, model->GetBlendWeightOffset(), 4 );
+            cmdBuf.BindVertexBuffer( skinnedVertexBuffer, animator.GetSkinnedTangentOffset(), 3 );
             cmdBuf.BindIndexBuffer(  model->indexBuffer, model->GetIndexType() );
 
             for ( size_t i = 0; i < model->meshes.size(); ++i )
@@ -1223,63 +1635,312 @@ namespace RenderSystem
                 mcbuf.Ks = glm::vec4( mat->Ks, mat->Ns );
                 mcbuf.diffuseTexIndex = mat->map_Kd   ? mat->map_Kd->GetTexture()->GetShaderSlot()   : PG_INVALID_TEXTURE_INDEX;
                 mcbuf.normalMapIndex  = mat->map_Norm ? mat->map_Norm->GetTexture()->GetShaderSlot() : PG_INVALID_TEXTURE_INDEX;
-                cmdBuf.PushConstants( animPipeline, VK_SHADER_STAGE_FRAGMENT_BIT, PG_MATERIAL_PUSH_CONSTANT_OFFSET, sizeof( Gpu::MaterialConstantBufferData ), &mcbuf );
+                cmdBuf.PushConstants( gBufferPassData.pipeline, VK_SHADER_STAGE_FRAGMENT_BIT, PG_MATERIAL_PUSH_CONSTANT_OFFSET, sizeof( Gpu::MaterialConstantBufferData ), &mcbuf );
 
                 PG_DEBUG_MARKER_INSERT( cmdBuf, "Draw \"" + model->name + "\" : \"" + mesh.name + "\"", glm::vec4( 0 ) );
                 cmdBuf.DrawIndexed( mesh.startIndex, mesh.numIndices, mesh.startVertex );
             }
         });
         PG_DEBUG_MARKER_END_REGION( cmdBuf );
-        
-        cmdBuf.EndRenderPass();
+    }
+
+    // Hands out the calling thread's next secondary command buffer, allocating more as needed
+    static CommandBuffer NextSecondaryCommandBuffer()
+    {
+        ThreadCommandBuffers& thread = CurrentFrameData().threadCommandBuffers[Jobs::GetThreadIndex()];
+        if ( thread.numUsed == thread.secondaryCmdBufs.size() )
+        {
+            std::string name = "secondary " + std::to_string( Jobs::GetThreadIndex() ) + "_" + std::to_string( thread.numUsed );
+            thread.secondaryCmdBufs.push_back( thread.pool.NewCommandBuffer( name, CommandBufferLevel::SECONDARY ) );
+        }
+
+        return thread.secondaryCmdBufs[thread.numUsed++];
+    }
+
+    // Submits one job per chunk, each recording its draws into its own secondary command buffer.
+    // The buffers end up in chunk order, no matter which thread finishes first
+    static void RecordSecondaryChunks( SecondaryRecording& recording, const RenderPass& renderPass, const Framebuffer& framebuffer,
+                                       uint32_t numChunks, std::function< void( CommandBuffer&, uint32_t ) > recordChunk )
+    {
+        recording.cmdBufs.resize( numChunks );
+        recording.renderPass  = &renderPass;
+        recording.framebuffer = &framebuffer;
+        recording.recordChunk = std::move( recordChunk );
+        for ( uint32_t chunk = 0; chunk < numChunks; ++chunk )
+        {
+            Jobs::Submit( [&recording, chunk]()
+            {
+                CommandBuffer cmdBuf = NextSecondaryCommandBuffer();
+                cmdBuf.BeginRecording( *recording.renderPass, *recording.framebuffer, COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT );
+                recording.recordChunk( cmdBuf, chunk );
+                cmdBuf.EndRecording();
+                recording.cmdBufs[chunk] = cmdBuf;
+            }, &recording.counter );
+        }
+    }
+
+    // Kicks off the recording of the draw heavy passes on the job threads. They record while the main thread
+    // records the rest of the frame into the primary command buffer, which then executes them
+    static void StartSecondaryRecording( Scene* scene )
+    {
+        PG_PROFILE_SCOPE( "StartSecondaryRecording" );
+        // Render already waited on this frame's fence, so nothing recorded out of these pools is still pending
+        for ( ThreadCommandBuffers& thread : CurrentFrameData().threadCommandBuffers )
+        {
+            thread.pool.Reset();
+            thread.numUsed = 0;
+        }
+
+        s_staticShadowRecording.cmdBufs.clear();
+        s_shadowRecording.cmdBufs.clear();
+        if ( scene->directionalLight.shadowMap )
+        {
+            const ShadowMap* shadowMap = scene->directionalLight.shadowMap.get();
+
+            // A redrawn cascade always gets at least one chunk, since its first one clears its quadrant
+            s_staticShadowCascadeFirstChunks[0] = 0;
+            for ( uint32_t cascade = 0; cascade < PG_NUM_SHADOW_CASCADES; ++cascade )
+            {
+                uint32_t numChunks = 0;
+                if ( s_redrawStaticShadows[cascade] )
+                {
+                    numChunks = static_cast< uint32_t >( ( s_staticShadowCasters[cascade].size() + MODELS_PER_SECONDARY_COMMAND_BUFFER - 1 ) / MODELS_PER_SECONDARY_COMMAND_BUFFER );
+                    numChunks = std::max( numChunks, 1u );
+                }
+                s_staticShadowCascadeFirstChunks[cascade + 1] = s_staticShadowCascadeFirstChunks[cascade] + numChunks;
+            }
+            RecordSecondaryChunks( s_staticShadowRecording, *shadowPassData.staticRenderPass, shadowMap->staticFramebuffer, s_staticShadowCascadeFirstChunks[PG_NUM_SHADOW_CASCADES], [scene, shadowMap]( CommandBuffer& cmdBuf, uint32_t chunk )
+            {
+                uint32_t cascade = 0;
+                while ( chunk >= s_staticShadowCascadeFirstChunks[cascade + 1] )
+                {
+                    ++cascade;
+                }
+                uint32_t cascadeChunk = chunk - s_staticShadowCascadeFirstChunks[cascade];
+                if ( cascadeChunk == 0 )
+                {
+                    cmdBuf.ClearDepthAttachment( CascadeRect( *shadowMap, cascade ) );
+                }
+                size_t begin = cascadeChunk * MODELS_PER_SECONDARY_COMMAND_BUFFER;
+                size_t end   = std::min( begin + MODELS_PER_SECONDARY_COMMAND_BUFFER, s_staticShadowCasters[cascade].size() );
+                RecordRigidShadowDraws( scene, cmdBuf, *shadowMap, cascade, s_staticShadowCasters[cascade], begin, end );
+            });
+
+            s_shadowCascadeFirstChunks[0] = 1;
+            for ( uint32_t cascade = 0; cascade < PG_NUM_SHADOW_CASCADES; ++cascade )
+            {
+                uint32_t numRigidChunks = static_cast< uint32_t >( ( s_shadowCasters[cascade].size() + MODELS_PER_SECONDARY_COMMAND_BUFFER - 1 ) / MODELS_PER_SECONDARY_COMMAND_BUFFER );
+                s_shadowCascadeFirstChunks[cascade + 1] = s_shadowCascadeFirstChunks[cascade] + numRigidChunks + 1;
+            }
+            RecordSecondaryChunks( s_shadowRecording, *shadowPassData.renderPass, shadowMap->framebuffer, s_shadowCascadeFirstChunks[PG_NUM_SHADOW_CASCADES], [scene, shadowMap]( CommandBuffer& cmdBuf, uint32_t chunk )
+            {
+                if ( chunk == 0 )
+                {
+                    RecordStaticShadowComposite( cmdBuf, *shadowMap );
+                    return;
+                }
+                uint32_t cascade = 0;
+                while ( chunk >= s_shadowCascadeFirstChunks[cascade + 1] )
+                {
+                    ++cascade;
+                }
+                uint32_t cascadeChunk = chunk - s_shadowCascadeFirstChunks[cascade];
+                if ( chunk == s_shadowCascadeFirstChunks[cascade + 1] - 1 )
+                {
+                    RecordAnimatedShadowDraws( scene, cmdBuf, *shadowMap, cascade );
+                    return;
+                }
+                size_t begin = cascadeChunk * MODELS_PER_SECONDARY_COMMAND_BUFFER;
+                size_t end   = std::min( begin + MODELS_PER_SECONDARY_COMMAND_BUFFER, s_shadowCasters[cascade].size() );
+                RecordRigidShadowDraws( scene, cmdBuf, *shadowMap, cascade, s_shadowCasters[cascade], begin, end );
+            });
+        }
+
+        uint32_t numRigidChunks = static_cast< uint32_t >( ( s_visibleModels.size() + MODELS_PER_SECONDARY_COMMAND_BUFFER - 1 ) / MODELS_PER_SECONDARY_COMMAND_BUFFER );
+        RecordSecondaryChunks( s_gBufferRecording, s_renderGraphExecutor.GetRenderPass( s_graph.gBufferPass ), s_renderGraphExecutor.GetFramebuffer( s_graph.gBufferPass ), numRigidChunks + 1, [scene, numRigidChunks]( CommandBuffer& cmdBuf, uint32_t chunk )
+        {
+            if ( chunk == numRigidChunks )
+            {
+                RecordAnimatedGBufferDraws( scene, cmdBuf );
+                return;
+            }
+            size_t begin = chunk * MODELS_PER_SECONDARY_COMMAND_BUFFER;
+            size_t end   = std::min( begin + MODELS_PER_SECONDARY_COMMAND_BUFFER, s_visibleModels.size() );
+            RecordRigidGBufferDraws( scene, cmdBuf, begin, end );
+        });
+    }
+
+    // The passes below execute secondary command buffers, so their render passes can't have anything else in
+    // them. Their timestamps and debug marker regions get recorded around them by these executor hooks instead
+    static void BeginSecondaryPassScope( CommandBuffer& cmdBuf, uint32_t pass )
+    {
+        if ( pass == s_graph.staticShadowPass )
+        {
+            PG_PROFILE_GPU_START( cmdBuf, StaticShadow );
+            PG_DEBUG_MARKER_BEGIN_REGION( cmdBuf, "Static Shadow Pass", glm::vec4( .2, .2, .6, 1 ) );
+        }
+        else if ( pass == s_graph.shadowPass )
+        {
+            PG_PROFILE_GPU_START( cmdBuf, Shadow );
+            PG_DEBUG_MARKER_BEGIN_REGION( cmdBuf, "Shadow Pass", glm::vec4( .2, .2, .4, 1 ) );
+        }
+        else if ( pass == s_graph.gBufferPass )
+        {
+            PG_PROFILE_GPU_START( cmdBuf, GBuffer );
+            PG_DEBUG_MARKER_BEGIN_REGION( cmdBuf, "GBuffer Pass", glm::vec4( .8, .8, .2, 1 ) );
+        }
+    }
+
+    static void EndSecondaryPassScope( CommandBuffer& cmdBuf, uint32_t pass )
+    {
+        if ( pass == s_graph.staticShadowPass )
+        {
+            PG_DEBUG_MARKER_END_REGION( cmdBuf );
+            PG_PROFILE_GPU_END( cmdBuf, StaticShadow );
+        }
+        else if ( pass == s_graph.shadowPass )
+        {
+            PG_DEBUG_MARKER_END_REGION( cmdBuf );
+            PG_PROFILE_GPU_END( cmdBuf, Shadow );
+        }
+        else if ( pass == s_graph.gBufferPass )
+        {
+            PG_DEBUG_MARKER_END_REGION( cmdBuf );
+            PG_PROFILE_GPU_END( cmdBuf, GBuffer );
+        }
+    }
+
+    // Usually records nothing, since the cache only gets redrawn when a cascade moves
+    void StaticShadowPass( Scene* scene, CommandBuffer& cmdBuf )
+    {
+        PG_PROFILE_SCOPE( "StaticShadowPass" );
+        Jobs::Wait( &s_staticShadowRecording.counter );
+        if ( !s_staticShadowRecording.cmdBufs.empty() )
+        {
+            cmdBuf.ExecuteCommandBuffers( static_cast< uint32_t >( s_staticShadowRecording.cmdBufs.size() ), s_staticShadowRecording.cmdBufs.data() );
+        }
+    }
+
+    void ShadowPass( Scene* scene, CommandBuffer& cmdBuf )
+    {
+        PG_PROFILE_SCOPE( "ShadowPass" );
+        Jobs::Wait( &s_shadowRecording.counter );
+        cmdBuf.ExecuteCommandBuffers( static_cast< uint32_t >( s_shadowRecording.cmdBufs.size() ), s_shadowRecording.cmdBufs.data() );
+    }
+
+    void GBufferPass( Scene* scene, CommandBuffer& cmdBuf )
+    {
+        PG_PROFILE_SCOPE( "GBufferPass" );
+        Jobs::Wait( &s_gBufferRecording.counter );
+        cmdBuf.ExecuteCommandBuffers( static_cast< uint32_t >( s_gBufferRecording.cmdBufs.size() ), s_gBufferRecording.cmdBufs.data() );
+    }
+
+    static Gpu::SSAOResampleData GetSSAOResampleData( const Camera& camera )
+    {
+        glm::mat4 P = camera.GetP();
+        Gpu::SSAOResampleData data;
+        data.V           = camera.GetV();
+        data.depthParams = glm::vec2( P[3][2], P[2][2] );
+        data.scale       = static_cast< uint32_t >( s_ssaoResolution );
+        return data;
+    }
+
+    void SSAODownsamplePass( Scene* scene, CommandBuffer& cmdBuf )
+    {
+        PG_PROFILE_SCOPE( "SSAODownsamplePass" );
+        PG_PROFILE_GPU_START( cmdBuf, SSAODownsample );
+        PG_DEBUG_MARKER_BEGIN_REGION( cmdBuf, "SSAO Downsample Pass", glm::vec4( .8, .7, .5, 1 ) );
+        cmdBuf.BindRenderPipeline( ssaoDownsamplePassData.pipeline );
+        cmdBuf.BindDescriptorSets( 1, &descriptorSets.ssaoDownsample, ssaoDownsamplePassData.pipeline, 0 );
+        Gpu::SSAOResampleData pushData = GetSSAOResampleData( scene->camera );
+        cmdBuf.PushConstants( ssaoDownsamplePassData.pipeline, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof( Gpu::SSAOResampleData ), &pushData );
+        PG_DEBUG_MARKER_INSERT( cmdBuf, "Draw full-screen quad", glm::vec4( 0 ) );
+        cmdBuf.BindVertexBuffer( postProcessPassData.quadBuffer, 0, 0 );
+        cmdBuf.Draw( 0, 6 );
         PG_DEBUG_MARKER_END_REGION( cmdBuf );
-        PG_PROFILE_TIMESTAMP( cmdBuf, "GBuffer_End" );
+        PG_PROFILE_GPU_END( cmdBuf, SSAODownsample );
     }
 
     void SSAOPass( Scene* scene, CommandBuffer& cmdBuf )
     {
-        PG_PROFILE_TIMESTAMP( cmdBuf, "SSAO_Start" );
-        PG_DEBUG_MARKER_BEGIN_REGION( cmdBuf, "SSAO", glm::vec4( .5, .5, .5, 1 ) );
+        PG_PROFILE_SCOPE( "SSAOPass" );
+        PG_PROFILE_GPU_START( cmdBuf, SSAO );
         PG_DEBUG_MARKER_BEGIN_REGION( cmdBuf, "SSAO Occlusion Pass", glm::vec4( .8, .5, .5, 1 ) );
-        cmdBuf.BeginRenderPass( ssaoPassData.renderPass, ssaoPassData.frameBuffer, g_renderState.swapChain.extent );
-        
         cmdBuf.BindRenderPipeline( ssaoPassData.pipeline );
         cmdBuf.BindDescriptorSets( 1, &descriptorSets.ssao, ssaoPassData.pipeline, 0 );
-        Gpu::SSAOShaderData pushData{ scene->camera.GetV(), scene->camera.GetP() };
+        VkExtent2D extent = s_renderGraphExecutor.GetExtent( s_graph.ssaoPass );
+        float scale       = static_cast< float >( s_ssaoResolution );
+        Gpu::SSAOShaderData pushData;
+        pushData.P            = scene->camera.GetP();
+        pushData.uvScale      = scale * glm::vec2( extent.width, extent.height ) / glm::vec2( g_renderState.swapChain.extent.width, g_renderState.swapChain.extent.height );
+        pushData.kernelOffset = s_ssaoKernelSize - PG_SSAO_MIN_KERNEL_SIZE;
+        pushData.kernelSize   = s_ssaoKernelSize;
         cmdBuf.PushConstants( ssaoPassData.pipeline, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof( Gpu::SSAOShaderData ), &pushData );
         PG_DEBUG_MARKER_INSERT( cmdBuf, "Draw full-screen quad", glm::vec4( 0 ) );
         cmdBuf.BindVertexBuffer( postProcessPassData.quadBuffer, 0, 0 );
         cmdBuf.Draw( 0, 6 );
-        
-        cmdBuf.EndRenderPass();
         PG_DEBUG_MARKER_END_REGION( cmdBuf );
+        PG_PROFILE_GPU_END( cmdBuf, SSAO );
+    }
 
-        PG_DEBUG_MARKER_BEGIN_REGION( cmdBuf, "SSAO Blur Pass", glm::vec4( .5, .5, .8, 1 ) );
-        cmdBuf.BeginRenderPass( ssaoBlurPassData.renderPass, ssaoBlurPassData.framebuffer, g_renderState.swapChain.extent );
-        
+    void SSAOBlurXPass( Scene* scene, CommandBuffer& cmdBuf )
+    {
+        PG_PROFILE_SCOPE( "SSAOBlurXPass" );
+        PG_PROFILE_GPU_START( cmdBuf, SSAOBlurX );
+        PG_DEBUG_MARKER_BEGIN_REGION( cmdBuf, "SSAO Blur X Pass", glm::vec4( .5, .5, .8, 1 ) );
         cmdBuf.BindRenderPipeline( ssaoBlurPassData.pipeline );
-        cmdBuf.BindDescriptorSets( 1, &descriptorSets.ssaoBlur, ssaoBlurPassData.pipeline, 0 );
+        cmdBuf.BindDescriptorSets( 1, &descriptorSets.ssaoBlurX, ssaoBlurPassData.pipeline, 0 );
+        glm::ivec2 direction( 1, 0 );
+        cmdBuf.PushConstants( ssaoBlurPassData.pipeline, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof( glm::ivec2 ), &direction );
         PG_DEBUG_MARKER_INSERT( cmdBuf, "Draw full-screen quad", glm::vec4( 0 ) );
         cmdBuf.BindVertexBuffer( postProcessPassData.quadBuffer, 0, 0 );
         cmdBuf.Draw( 0, 6 );
-        
-        cmdBuf.EndRenderPass();
         PG_DEBUG_MARKER_END_REGION( cmdBuf );
+        PG_PROFILE_GPU_END( cmdBuf, SSAOBlurX );
+    }
+
+    void SSAOBlurYPass( Scene* scene, CommandBuffer& cmdBuf )
+    {
+        PG_PROFILE_SCOPE( "SSAOBlurYPass" );
+        PG_PROFILE_GPU_START( cmdBuf, SSAOBlurY );
+        PG_DEBUG_MARKER_BEGIN_REGION( cmdBuf, "SSAO Blur Y Pass", glm::vec4( .5, .5, .8, 1 ) );
+        cmdBuf.BindRenderPipeline( ssaoBlurPassData.pipeline );
+        cmdBuf.BindDescriptorSets( 1, &descriptorSets.ssaoBlurY, ssaoBlurPassData.pipeline, 0 );
+        glm::ivec2 direction( 0, 1 );
+        cmdBuf.PushConstants( ssaoBlurPassData.pipeline, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof( glm::ivec2 ), &direction );
+        PG_DEBUG_MARKER_INSERT( cmdBuf, "Draw full-screen quad", glm::vec4( 0 ) );
+        cmdBuf.BindVertexBuffer( postProcessPassData.quadBuffer, 0, 0 );
+        cmdBuf.Draw( 0, 6 );
         PG_DEBUG_MARKER_END_REGION( cmdBuf );
-        PG_PROFILE_TIMESTAMP( cmdBuf, "SSAO_End" );
+        PG_PROFILE_GPU_END( cmdBuf, SSAOBlurY );
+    }
+
+    void SSAOUpsamplePass( Scene* scene, CommandBuffer& cmdBuf )
+    {
+        PG_PROFILE_SCOPE( "SSAOUpsamplePass" );
+        PG_PROFILE_GPU_START( cmdBuf, SSAOUpsample );
+        PG_DEBUG_MARKER_BEGIN_REGION( cmdBuf, "SSAO Upsample Pass", glm::vec4( .5, .7, .8, 1 ) );
+        cmdBuf.BindRenderPipeline( ssaoUpsamplePassData.pipeline );
+        cmdBuf.BindDescriptorSets( 1, &descriptorSets.ssaoUpsample, ssaoUpsamplePassData.pipeline, 0 );
+        Gpu::SSAOResampleData pushData = GetSSAOResampleData( scene->camera );
+        cmdBuf.PushConstants( ssaoUpsamplePassData.pipeline, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof( Gpu::SSAOResampleData ), &pushData );
+        PG_DEBUG_MARKER_INSERT( cmdBuf, "Draw full-screen quad", glm::vec4( 0 ) );
+        cmdBuf.BindVertexBuffer( postProcessPassData.quadBuffer, 0, 0 );
+        cmdBuf.Draw( 0, 6 );
+        PG_DEBUG_MARKER_END_REGION( cmdBuf );
+        PG_PROFILE_GPU_END( cmdBuf, SSAOUpsample );
     }
 
     void DeferredLightingPass( Scene* scene, CommandBuffer& cmdBuf )
     {
-        PG_PROFILE_TIMESTAMP( cmdBuf, "Lighting_Start" );
+        PG_PROFILE_SCOPE( "DeferredLightingPass" );
+        PG_PROFILE_GPU_START( cmdBuf, Lighting );
         PG_DEBUG_MARKER_BEGIN_REGION( cmdBuf, "Lighting Pass", glm::vec4( .8, 0, .8, 1 ) );
-        cmdBuf.BeginRenderPass( lightingPassData.renderPass, lightingPassData.frameBuffer, g_renderState.swapChain.extent );
-
         cmdBuf.BindRenderPipeline( lightingPassData.pipeline );
-        cmdBuf.BindDescriptorSets( 1, &descriptorSets.scene, lightingPassData.pipeline, PG_SCENE_CONSTANT_BUFFER_SET );
-        cmdBuf.BindDescriptorSets( 1, &descriptorSets.arrayOfTextures, lightingPassData.pipeline, PG_2D_TEXTURES_SET );
+        cmdBuf.BindDescriptorSets( 1, &CurrentFrameData().sceneSet, lightingPassData.pipeline, PG_SCENE_CONSTANT_BUFFER_SET );
+        cmdBuf.BindDescriptorSets( 1, &CurrentFrameData().arrayOfTexturesSet, lightingPassData.pipeline, PG_2D_TEXTURES_SET );
         cmdBuf.BindDescriptorSets( 1, &descriptorSets.gBufferAttachments, lightingPassData.pipeline, 2 );
-        cmdBuf.BindDescriptorSets( 1, &descriptorSets.lights, lightingPassData.pipeline, 3 );
+        cmdBuf.BindDescriptorSets( 1, &CurrentFrameData().lightsSet, lightingPassData.pipeline, 3 );
         PG_DEBUG_MARKER_INSERT( cmdBuf, "Draw full-screen quad", glm::vec4( 0 ) );
 
 #if USING( DEBUG_BUILD )
@@ -1287,25 +1948,36 @@ namespace RenderSystem
 #endif // #if USING( DEBUG_BUILD )
         cmdBuf.BindVertexBuffer( postProcessPassData.quadBuffer, 0, 0 );
         cmdBuf.Draw( 0, 6 );
+        PG_DEBUG_MARKER_END_REGION( cmdBuf );
+        PG_PROFILE_GPU_END( cmdBuf, Lighting );
+    }
 
-        cmdBuf.EndRenderPass();
+    void HiZDownsamplePass( Scene* scene, CommandBuffer& cmdBuf )
+    {
+        PG_PROFILE_SCOPE( "HiZDownsamplePass" );
+        PG_PROFILE_GPU_START( cmdBuf, HiZ );
+        PG_DEBUG_MARKER_BEGIN_REGION( cmdBuf, "HiZ Downsample Pass", glm::vec4( .5, .8, .5, 1 ) );
+        cmdBuf.BindRenderPipeline( hizPassData.pipeline );
+        cmdBuf.BindDescriptorSets( 1, &descriptorSets.hizDownsample, hizPassData.pipeline, 0 );
+        PG_DEBUG_MARKER_INSERT( cmdBuf, "Draw full-screen quad", glm::vec4( 0 ) );
+        cmdBuf.BindVertexBuffer( postProcessPassData.quadBuffer, 0, 0 );
+        cmdBuf.Draw( 0, 6 );
         PG_DEBUG_MARKER_END_REGION( cmdBuf );
-        PG_PROFILE_TIMESTAMP( cmdBuf, "Lighting_End" );
+        PG_PROFILE_GPU_END( cmdBuf, HiZ );
     }
 
     void BackgroundPass( Scene* scene, CommandBuffer& cmdBuf )
     {
-        PG_PROFILE_TIMESTAMP( cmdBuf, "Background_Start" );
+        PG_PROFILE_SCOPE( "BackgroundPass" );
+        PG_PROFILE_GPU_START( cmdBuf, Background );
         PG_DEBUG_MARKER_BEGIN_REGION( cmdBuf, "Background Pass", glm::vec4( .2, .8, .8, 1 ) );
-        cmdBuf.BeginRenderPass( backgroundPassData.renderPass, lightingPassData.frameBuffer, g_renderState.swapChain.extent );
-
         if ( scene->skybox )
         {
             cmdBuf.BindRenderPipeline( backgroundPassData.skyboxPipeline );
             PG_DEBUG_MARKER_INSERT( cmdBuf, "Draw Skybox", glm::vec4( 0 ) );
             glm::mat4 VP = scene->camera.GetP() * glm::mat4( glm::mat3( scene->camera.GetV() ) );
             cmdBuf.PushConstants( backgroundPassData.skyboxPipeline, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof( glm::mat4 ), glm::value_ptr( VP ) );
-            cmdBuf.BindDescriptorSets( 1, &descriptorSets.background, backgroundPassData.skyboxPipeline );
+            cmdBuf.BindDescriptorSets( 1, &CurrentFrameData().backgroundSet, backgroundPassData.skyboxPipeline );
             cmdBuf.BindVertexBuffer( backgroundPassData.cubeBuffer, 0, 0 );
             cmdBuf.Draw( 0, 36 );
         }
@@ -1317,35 +1989,34 @@ namespace RenderSystem
             cmdBuf.BindVertexBuffer( postProcessPassData.quadBuffer, 0, 0 );
             cmdBuf.Draw( 0, 6 );
         }
-
-        cmdBuf.EndRenderPass();
         PG_DEBUG_MARKER_END_REGION( cmdBuf );
-        PG_PROFILE_TIMESTAMP( cmdBuf, "Background_End" );
+        PG_PROFILE_GPU_END( cmdBuf, Background );
     }
 
     void TransparencyPass( Scene* scene, CommandBuffer& cmdBuf )
     {
-        PG_PROFILE_TIMESTAMP( cmdBuf, "Transparency_Start" );
+        PG_PROFILE_SCOPE( "TransparencyPass" );
+        PG_PROFILE_GPU_START( cmdBuf, Transparency );
         PG_DEBUG_MARKER_BEGIN_REGION( cmdBuf, "Transparency Pass", glm::vec4( .8, .8, .2, 1 ) );
-        cmdBuf.BeginRenderPass( transparencyPassData.renderPass, lightingPassData.frameBuffer, g_renderState.swapChain.extent );
+        cmdBuf.BeginRenderPass( transparencyPassData.renderPass, s_renderGraphExecutor.GetFramebuffer( s_graph.lightingPass ), g_renderState.swapChain.extent );
         PG_DEBUG_MARKER_BEGIN_REGION( cmdBuf, "Transparency -- Rigid Models", glm::vec4( .2, .8, .2, 1 ) );
         cmdBuf.BindRenderPipeline( transparencyPassData.pipeline );
-        cmdBuf.BindDescriptorSets( 1, &descriptorSets.scene, transparencyPassData.pipeline, PG_SCENE_CONSTANT_BUFFER_SET );
-        cmdBuf.BindDescriptorSets( 1, &descriptorSets.arrayOfTextures, transparencyPassData.pipeline, PG_2D_TEXTURES_SET );
-        cmdBuf.BindDescriptorSets( 1, &descriptorSets.lights, transparencyPassData.pipeline, 3 );
+        cmdBuf.BindDescriptorSets( 1, &CurrentFrameData().sceneSet, transparencyPassData.pipeline, PG_SCENE_CONSTANT_BUFFER_SET );
+        cmdBuf.BindDescriptorSets( 1, &CurrentFrameData().arrayOfTexturesSet, transparencyPassData.pipeline, PG_2D_TEXTURES_SET );
+        cmdBuf.BindDescriptorSets( 1, &CurrentFrameData().lightsSet, transparencyPassData.pipeline, 3 );
 
-        scene->registry.view< ModelRenderer, Transform >().each( [&]( ModelRenderer& modelRenderer, Transform& transform )
+        for ( size_t modelIdx = 0; modelIdx < s_visibleModels.size(); ++modelIdx )
         {
+            const ModelRenderer& modelRenderer = scene->registry.get< ModelRenderer >( s_visibleModels[modelIdx] );
+            const WorldTransform& transform    = scene->registry.get< WorldTransform >( s_visibleModels[modelIdx] );
             const auto& model = modelRenderer.model;
             // TODO: Actually fix this for models without tangets as well
             if ( model->GetTangentOffset() == ~0u )
             {
-                return;
+                continue;
             }
             
-            auto M = transform.GetModelMatrix();
-            auto N = glm::transpose( glm::inverse( M ) );
-            Gpu::ObjectConstantBufferData b{ M, N };
+            Gpu::ObjectConstantBufferData b{ transform.M, transform.N };
             cmdBuf.PushConstants( transparencyPassData.pipeline, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof( Gpu::ObjectConstantBufferData ), &b );
 
             cmdBuf.BindVertexBuffer( model->vertexBuffer, model->GetVertexOffset(), 0 );
@@ -1354,9 +2025,9 @@ namespace RenderSystem
             cmdBuf.BindVertexBuffer( model->vertexBuffer, model->GetTangentOffset(), 3 );
             cmdBuf.BindIndexBuffer(  model->indexBuffer, model->GetIndexType() );
 
-            for ( size_t i = 0; i < model->meshes.size(); ++i )
+            for ( uint32_t i = s_visibleMeshOffsets[modelIdx]; i < s_visibleMeshOffsets[modelIdx + 1]; ++i )
             {
-                const auto& mesh = modelRenderer.model->meshes[i];
+                const auto& mesh = modelRenderer.model->meshes[s_visibleMeshes[i]];
                 const auto& mat  = modelRenderer.materials[mesh.materialIndex];
                 if ( !mat->transparent )
                 {
@@ -1373,19 +2044,20 @@ namespace RenderSystem
                 PG_DEBUG_MARKER_INSERT( cmdBuf, "Draw \"" + model->name + "\" : \"" + mesh.name + "\"", glm::vec4( 0 ) );
                 cmdBuf.DrawIndexed( mesh.startIndex, mesh.numIndices, mesh.startVertex );
             }
-        });
+        }
         PG_DEBUG_MARKER_END_REGION( cmdBuf );
 
         // transparent animated models?
         
         cmdBuf.EndRenderPass();
         PG_DEBUG_MARKER_END_REGION( cmdBuf );
-        PG_PROFILE_TIMESTAMP( cmdBuf, "Transparency_End" );
+        PG_PROFILE_GPU_END( cmdBuf, Transparency );
     }
 
     void PostProcessPass( Scene* scene, CommandBuffer& cmdBuf, uint32_t swapChainImageIndex )
     {
-        PG_PROFILE_TIMESTAMP( cmdBuf, "PostProcess_Start" );
+        PG_PROFILE_SCOPE( "PostProcessPass" );
+        PG_PROFILE_GPU_START( cmdBuf, PostProcess );
         PG_DEBUG_MARKER_BEGIN_REGION( cmdBuf, "Post Process Pass", glm::vec4( .2, .2, 1, 1 ) );
         cmdBuf.BeginRenderPass( g_renderState.renderPass, g_renderState.swapChainFramebuffers[swapChainImageIndex], g_renderState.swapChain.extent );
         
@@ -1397,52 +2069,228 @@ namespace RenderSystem
         cmdBuf.Draw( 0, 6 );
         
         PG_DEBUG_MARKER_END_REGION( cmdBuf );
-        PG_PROFILE_TIMESTAMP( cmdBuf, "PostProcess_End" );
+        PG_PROFILE_GPU_END( cmdBuf, PostProcess );
     }
 
     void UIPass( Scene* scene, CommandBuffer& cmdBuf, uint32_t swapChainImageIndex )
     {
-        PG_PROFILE_TIMESTAMP( cmdBuf, "UI_Start" );
+        PG_PROFILE_SCOPE( "UIPass" );
+        PG_PROFILE_GPU_START( cmdBuf, UI );
         PG_DEBUG_MARKER_BEGIN_REGION( cmdBuf, "UI Pass", glm::vec4( .4, .7, 9, 1 ) );
         
         UIOverlay::Draw( cmdBuf );
         
         cmdBuf.EndRenderPass();
         PG_DEBUG_MARKER_END_REGION( cmdBuf );
-        PG_PROFILE_TIMESTAMP( cmdBuf, "UI_End" );
+        PG_PROFILE_GPU_END( cmdBuf, UI );
+    }
+
+    // The post process and UI passes stay outside of the graph, since they draw into the swapchain's
+    // render pass, which the UI overlay shares
+    static bool InitRenderGraph()
+    {
+        uint32_t width  = g_renderState.swapChain.extent.width;
+        uint32_t height = g_renderState.swapChain.extent.height;
+        RenderGraph& graph = s_renderGraph;
+
+        // Owned by the scene, and bound every frame
+        s_graph.staticShadowMap    = graph.ImportTexture( "static shadow map", PixelFormat::DEPTH_32_FLOAT, ImageLayout::SHADER_READ_ONLY_OPTIMAL );
+        s_graph.shadowMap          = graph.ImportTexture( "shadow map", PixelFormat::DEPTH_32_FLOAT, ImageLayout::SHADER_READ_ONLY_OPTIMAL );
+        // Shared with the swapchain framebuffers
+        s_graph.depth              = graph.ImportTexture( "main depth texture", PixelFormat::DEPTH_32_FLOAT, ImageLayout::DEPTH_STENCIL_ATTACHMENT_OPTIMAL, width, height );
+        // Positions get rebuilt from the depth, and the normals are octahedral encoded
+        s_graph.normals            = graph.CreateTexture( "gbuffer normals", PixelFormat::R16_G16_UNORM, width, height );
+        s_graph.diffuseAndSpecular = graph.CreateTexture( "gbuffer diffuse + specular", PixelFormat::R16_G16_B16_A16_UINT, width, height );
+        // Rounded up, so the AO covers the whole screen
+        uint32_t ssaoScale         = static_cast< uint32_t >( s_ssaoResolution );
+        uint32_t ssaoWidth         = ( width + ssaoScale - 1 ) / ssaoScale;
+        uint32_t ssaoHeight        = ( height + ssaoScale - 1 ) / ssaoScale;
+        s_graph.ssaoDepth          = graph.CreateTexture( "ssao view depth", PixelFormat::R32_FLOAT, ssaoWidth, ssaoHeight );
+        s_graph.ssaoNormals        = graph.CreateTexture( "ssao view normals", PixelFormat::R16_G16_UNORM, ssaoWidth, ssaoHeight );
+        s_graph.ssao               = graph.CreateTexture( "ssao", PixelFormat::R8_UNORM, ssaoWidth, ssaoHeight );
+        s_graph.ssaoBlurX          = graph.CreateTexture( "ssao blur x", PixelFormat::R8_UNORM, ssaoWidth, ssaoHeight );
+        s_graph.ssaoBlur           = graph.CreateTexture( "ssao blur", PixelFormat::R8_UNORM, ssaoWidth, ssaoHeight );
+        if ( s_ssaoResolution != SSAOResolution::FULL )
+        {
+            s_graph.ssaoUpsampled  = graph.CreateTexture( "ssao upsampled", PixelFormat::R8_UNORM, width, height );
+        }
+        s_graph.litScene           = graph.CreateTexture( "lit scene", PixelFormat::R8_G8_B8_A8_UNORM, width, height );
+        graph.MarkOutput( s_graph.litScene, ImageLayout::SHADER_READ_ONLY_OPTIMAL );
+        s_graph.hiz                = graph.CreateTexture( "hiz", PixelFormat::R32_FLOAT, PG_HIZ_WIDTH, PG_HIZ_HEIGHT );
+        graph.MarkOutput( s_graph.hiz, ImageLayout::TRANSFER_SRC_OPTIMAL );
+
+        // Loads the cache, so the cascades that didn't move keep what they had
+        s_graph.staticShadowPass = graph.AddPass( "directional shadow static cache" )
+            .SetDepthOutput( s_graph.staticShadowMap, LoadAction::LOAD )
+            .SetSecondaryCommandBuffers( true )
+            .SetExecute( []( CommandBuffer& cmdBuf ) { StaticShadowPass( s_graphScene, cmdBuf ); } )
+            .GetIndex();
+
+        s_graph.shadowPass = graph.AddPass( "directional shadow" )
+            .SetDepthOutput( s_graph.shadowMap )
+            .AddTextureInput( s_graph.staticShadowMap )
+            .SetSecondaryCommandBuffers( true )
+            .SetExecute( []( CommandBuffer& cmdBuf ) { ShadowPass( s_graphScene, cmdBuf ); } )
+            .GetIndex();
+
+        s_graph.gBufferPass = graph.AddPass( "gbuffer" )
+            .AddColorOutput( s_graph.normals )
+            .AddColorOutput( s_graph.diffuseAndSpecular )
+            .SetDepthOutput( s_graph.depth )
+            .SetSecondaryCommandBuffers( true )
+            .SetExecute( []( CommandBuffer& cmdBuf ) { GBufferPass( s_graphScene, cmdBuf ); } )
+            .GetIndex();
+
+        s_graph.ssaoDownsamplePass = graph.AddPass( "ssao downsample" )
+            .AddColorOutput( s_graph.ssaoDepth )
+            .AddColorOutput( s_graph.ssaoNormals )
+            .AddTextureInput( s_graph.depth )
+            .AddTextureInput( s_graph.normals )
+            .SetExecute( []( CommandBuffer& cmdBuf ) { SSAODownsamplePass( s_graphScene, cmdBuf ); } )
+            .GetIndex();
+
+        s_graph.ssaoPass = graph.AddPass( "ssao" )
+            .AddColorOutput( s_graph.ssao )
+            .AddTextureInput( s_graph.ssaoDepth )
+            .AddTextureInput( s_graph.ssaoNormals )
+            .SetExecute( []( CommandBuffer& cmdBuf ) { SSAOPass( s_graphScene, cmdBuf ); } )
+            .GetIndex();
+
+        // Separable, and weighted by depth, so the AO of one surface doesn't bleed onto another
+        s_graph.ssaoBlurXPass = graph.AddPass( "ssao blur x" )
+            .AddColorOutput( s_graph.ssaoBlurX )
+            .AddTextureInput( s_graph.ssao )
+            .AddTextureInput( s_graph.ssaoDepth )
+            .SetExecute( []( CommandBuffer& cmdBuf ) { SSAOBlurXPass( s_graphScene, cmdBuf ); } )
+            .GetIndex();
+
+        s_graph.ssaoBlurYPass = graph.AddPass( "ssao blur y" )
+            .AddColorOutput( s_graph.ssaoBlur )
+            .AddTextureInput( s_graph.ssaoBlurX )
+            .AddTextureInput( s_graph.ssaoDepth )
+            .SetExecute( []( CommandBuffer& cmdBuf ) { SSAOBlurYPass( s_graphScene, cmdBuf ); } )
+            .GetIndex();
+
+        if ( s_ssaoResolution != SSAOResolution::FULL )
+        {
+            s_graph.ssaoUpsamplePass = graph.AddPass( "ssao upsample" )
+                .AddColorOutput( s_graph.ssaoUpsampled )
+                .AddTextureInput( s_graph.ssaoBlur )
+                .AddTextureInput( s_graph.ssaoDepth )
+                .AddTextureInput( s_graph.depth )
+                .SetExecute( []( CommandBuffer& cmdBuf ) { SSAOUpsamplePass( s_graphScene, cmdBuf ); } )
+                .GetIndex();
+        }
+
+        // The shadow map is optional in the lighting shader, so the pass still runs for scenes without one
+        s_graph.lightingPass = graph.AddPass( "lighting" )
+            .AddColorOutput( s_graph.litScene )
+            .AddTextureInput( s_graph.depth )
+            .AddTextureInput( s_graph.normals )
+            .AddTextureInput( s_graph.diffuseAndSpecular )
+            .AddTextureInput( SSAOOutput() )
+            .AddTextureInput( s_graph.shadowMap )
+            .SetExecute( []( CommandBuffer& cmdBuf ) { DeferredLightingPass( s_graphScene, cmdBuf ); } )
+            .GetIndex();
+
+        // Before the background pass, so the sky doesn't count as an occluder. Copied out after the graph runs
+        s_graph.hizPass = graph.AddPass( "hiz downsample" )
+            .AddColorOutput( s_graph.hiz )
+            .AddTextureInput( s_graph.depth )
+            .SetExecute( []( CommandBuffer& cmdBuf ) { HiZDownsamplePass( s_graphScene, cmdBuf ); } )
+            .GetIndex();
+
+        s_graph.backgroundPass = graph.AddPass( "background" )
+            .AddColorOutput( s_graph.litScene, LoadAction::LOAD )
+            .SetDepthOutput( s_graph.depth, LoadAction::LOAD )
+            .SetExecute( []( CommandBuffer& cmdBuf ) { BackgroundPass( s_graphScene, cmdBuf ); } )
+            .GetIndex();
+
+        // Bound before Init, so the framebuffers that use it get created with the rest
+        s_renderGraphExecutor.BindImportedTexture( s_graph.depth, &g_renderState.depthTex );
+        s_renderGraphExecutor.SetPassHooks( BeginSecondaryPassScope, EndSecondaryPassScope );
+
+        return s_renderGraphExecutor.Init( &s_renderGraph );
     }
 
     void Render( Scene* scene )
     {
+        PG_PROFILE_SCOPE( "Render" );
         PG_ASSERT( scene != nullptr );
         PG_ASSERT( scene->pointLights.size() < MAX_NUM_POINT_LIGHTS && scene->spotLights.size() < MAX_NUM_SPOT_LIGHTS );
 
-        auto swapChainImageIndex = g_renderState.swapChain.AcquireNextImage( g_renderState.presentCompleteSemaphore );
+        // Any GPU work that background jobs handed back to the main thread
+        Jobs::ProcessMainThreadJobs();
+        // Submitted before this frame's commands, so everything loaded so far is ready to use
+        UploadManager::Update();
+
+        if ( s_culledScene != scene )
+        {
+            CullScene( scene );
+        }
+        s_culledScene = nullptr;
+        AssignLightsToClusters( scene );
+
+        // Only blocks if the gpu is numFramesInFlight frames behind. Everything after this can reuse the frame's resources
+        FrameData& frame = CurrentFrame();
+        {
+            PG_PROFILE_SCOPE( "WaitForFrame" );
+            frame.inFlightFence.WaitFor();
+            frame.inFlightFence.Reset();
+        }
 
+        auto swapChainImageIndex = g_renderState.swapChain.AcquireNextImage( frame.presentCompleteSemaphore );
+
+        OcclusionCullScene( scene );
         UpdateBuffersAndTextures( scene );
+        StartSecondaryRecording( scene );
 
-        auto& cmdBuf = g_renderState.graphicsCommandBuffer;
+        auto& cmdBuf = frame.graphicsCommandBuffer;
         cmdBuf.BeginRecording();
-        PG_PROFILE_RESET( cmdBuf );
+        PG_PROFILE_GPU_BEGIN_FRAME( cmdBuf );
+
+        PG_PROFILE_GPU_START( cmdBuf, Frame );
 
-        PG_PROFILE_TIMESTAMP( cmdBuf, "Frame_Start" );
+        AnimationSystem::SkinningPass( scene, cmdBuf );
+
+        s_graphScene = scene;
+        const ShadowMap* shadowMap = scene->directionalLight.shadowMap.get();
+        s_renderGraphExecutor.BindImportedTexture( s_graph.staticShadowMap, shadowMap ? &shadowMap->staticTexture : nullptr );
+        s_renderGraphExecutor.BindImportedTexture( s_graph.shadowMap, shadowMap ? &shadowMap->texture : nullptr );
+        if ( shadowMap )
+        {
+            s_renderGraphExecutor.SetFramebuffer( s_graph.staticShadowPass, shadowMap->staticFramebuffer );
+            s_renderGraphExecutor.SetFramebuffer( s_graph.shadowPass, shadowMap->framebuffer );
+        }
+        s_renderGraphExecutor.Execute( cmdBuf );
+
+        // Read on the CPU by OcclusionCullScene, the next time this frame's fence is waited on
+        PerFrameData& frameData = CurrentFrameData();
+        cmdBuf.CopyImageToBuffer( *s_renderGraphExecutor.GetTexture( s_graph.hiz ), frameData.hizReadbackBuffer );
+        VkBufferMemoryBarrier barrier = {};
+        barrier.sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        barrier.srcAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask       = VK_ACCESS_HOST_READ_BIT;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.buffer              = frameData.hizReadbackBuffer.GetHandle();
+        barrier.offset              = 0;
+        barrier.size                = VK_WHOLE_SIZE;
+        cmdBuf.PipelineBarrier( VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, barrier );
+        frameData.hizVP      = scene->camera.GetVP();
+        frameData.hizWritten = true;
 
-        ShadowPass( scene, cmdBuf );
-        GBufferPass( scene, cmdBuf );
-        SSAOPass( scene, cmdBuf );
-        DeferredLightingPass( scene, cmdBuf );
-        BackgroundPass( scene, cmdBuf );
         PostProcessPass( scene, cmdBuf, swapChainImageIndex );
         UIPass( scene, cmdBuf, swapChainImageIndex );
 
-        PG_PROFILE_TIMESTAMP( cmdBuf, "Frame_End" );
+        PG_PROFILE_GPU_END( cmdBuf, Frame );
 
         cmdBuf.EndRecording();
         g_renderState.device.SubmitRenderCommands( 1, &cmdBuf );
         g_renderState.device.SubmitFrame( swapChainImageIndex );
 
-        PG_PROFILE_GET_RESULTS();
-    } 
+        g_renderState.currentFrame = ( g_renderState.currentFrame + 1 ) % g_renderState.numFramesInFlight;
+    }
 
     void InitSamplers()
     {
@@ -19,30 +19,21 @@ namespace Gfx
 namespace RenderSystem
 {
 
-    // placed here for sharing between the animation system and render system
-    struct GBuffer
-    {
-        Gfx::Texture positions;
-        Gfx::Texture normals;
-        Gfx::Texture diffuseAndSpecular;
-        Gfx::Texture specular;
-    };
-
+    // The gbuffer textures and the render passes belong to the render graph
     struct GBufferPassData
     {
-        Gfx::RenderPass renderPass;
-        GBuffer gbuffer;
-        Gfx::Framebuffer frameBuffer;
         Gfx::Pipeline pipeline;
         std::vector< Gfx::DescriptorSetLayout > descriptorSetLayouts;
     };
 
     struct ShadowPassData
     {
-        Gfx::RenderPass renderPass;
+        const Gfx::RenderPass* renderPass       = nullptr;
+        const Gfx::RenderPass* staticRenderPass = nullptr; // draws into ShadowMap::staticTexture
         Gfx::Pipeline rigidPipeline;
-        Gfx::Pipeline animatedPipeline;
-        std::vector< Gfx::DescriptorSetLayout > animatedDescriptorSetLayouts;
+        // Copies the static casters' depth into the shadow map, before the dynamic casters get drawn
+        Gfx::Pipeline compositePipeline;
+        std::vector< Gfx::DescriptorSetLayout > compositeDescriptorSetLayouts;
     };
 
     bool Init();
@@ -50,6 +41,33 @@ namespace RenderSystem
     void Shutdown();
 
     void Render( Scene* scene );
+
+    // Frustum culls the rigid models against the scene camera, for the GBuffer and transparency passes.
+    // Render does this itself, unless it was already called for the scene since the last Render, so it has to
+    // come after anything that moves the camera or the models. CPU only, so it also works when running headless
+    void CullScene( Scene* scene );
+    uint32_t GetNumVisibleModels();
+
+    // Drops the meshes that were hidden behind the depth of numFramesInFlight frames ago, on top of the frustum
+    // culling. Anything that just came out from behind something can take a frame longer to show up
+    void SetOcclusionCulling( bool enabled );
+    bool GetOcclusionCulling();
+
+    // How many screen pixels wide each ambient occlusion pixel is
+    enum class SSAOResolution : uint32_t
+    {
+        FULL    = 1,
+        HALF    = 2,
+        QUARTER = 4,
+    };
+
+    // Only read by Init, since the render graph sizes the AO targets with it
+    void SetSSAOResolution( SSAOResolution resolution );
+    SSAOResolution GetSSAOResolution();
+    // Samples per AO pixel. Can change between any two frames, but only 8, 16, 32 and 64 have kernels,
+    // so anything else is ignored and returns false
+    bool SetSSAOKernelSize( uint32_t kernelSize );
+    uint32_t GetSSAOKernelSize();
     
     void InitSamplers();
     void FreeSamplers();
@@ -7,11 +7,35 @@
 
 #define PG_SCENE_CONSTANT_BUFFER_SET 0
 #define PG_2D_TEXTURES_SET 1
-#define PG_BONE_TRANSFORMS_SET 2
+
+#define PG_SKINNING_MODEL_SET 0
+#define PG_SKINNING_SHARED_SET 1
+#define PG_SKINNING_GROUP_SIZE 64
 
 #define PG_MATERIAL_PUSH_CONSTANT_OFFSET 192
 
-#define PG_SSAO_KERNEL_SIZE 32
+// The AO kernel can be 8, 16, 32 or 64 samples. Every size has its own samples in the kernel buffer, one
+// after another, so the size n ones start at n - PG_SSAO_MIN_KERNEL_SIZE
+#define PG_SSAO_MIN_KERNEL_SIZE 8
+#define PG_SSAO_MAX_KERNEL_SIZE 64
+#define PG_SSAO_KERNEL_BUFFER_SIZE ( 2 * PG_SSAO_MAX_KERNEL_SIZE - PG_SSAO_MIN_KERNEL_SIZE )
+
+// The view frustum is split into a grid of clusters for the point and spot lights. X and Y are
+// even splits of the screen, Z is split exponentially between the near and far planes
+#define PG_LIGHT_CLUSTERS_X 16
+#define PG_LIGHT_CLUSTERS_Y 9
+#define PG_LIGHT_CLUSTERS_Z 24
+#define PG_NUM_LIGHT_CLUSTERS ( PG_LIGHT_CLUSTERS_X * PG_LIGHT_CLUSTERS_Y * PG_LIGHT_CLUSTERS_Z )
+// Any lights past this in one cluster are dropped, spot lights first
+#define PG_MAX_LIGHTS_PER_CLUSTER 64
+
+// The directional light's shadow map is split into a 2x2 atlas of cascades, nearest one in the top left
+#define PG_NUM_SHADOW_CASCADES 4
+
+// The depth buffer gets reduced to this size and read back for the occlusion culling. Every texel keeps
+// the farthest depth of the screen pixels it overlaps
+#define PG_HIZ_WIDTH 256
+#define PG_HIZ_HEIGHT 128
 
 #define PG_SHADER_DEBUG_LAYER_REGULAR 0
 #define PG_SHADER_DEBUG_LAYER_NO_SSAO 1
@@ -44,6 +68,8 @@
 #define MAT4 glm::mat4
 #define UINT uint32_t
 
+#define PG_INLINE inline
+
 #else // #ifdef PG_CPP_VERSION
 
 #define PG_NAMESPACE_BEGIN
@@ -64,4 +90,6 @@
 #define MAT4 mat4
 #define UINT uint
 
+#define PG_INLINE
+
 #endif // #else // #ifdef PG_CPP_VERSION
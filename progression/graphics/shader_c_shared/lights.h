@@ -25,5 +25,13 @@ struct SpotLight
     VEC4 directionAndCutoff; // x,y,z = direction, w = cutoff
 };
 
+// The cluster's lights are the point light indices followed by the spot light indices,
+// starting at indexOffset in the light index list
+struct LightCluster
+{
+    UINT indexOffset;
+    UINT counts; // point lights in the low 16 bits, spot lights in the high 16 bits
+};
+
 PG_GPU_NAMESPACE_END
 PG_NAMESPACE_END
\ No newline at end of file
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "graphics/shader_c_shared/defines.h"
+
+#ifdef PG_CPP_VERSION
+#include "core/math.hpp"
+#endif // #ifdef PG_CPP_VERSION
+
+// Shared with the CPU, so everything here sticks to what GLSL and glm both have: no swizzles, vector
+// versions of the built-ins, and float literals
+PG_NAMESPACE_BEGIN
+PG_GPU_NAMESPACE_BEGIN
+
+// OCTAHEDRON ENCODING
+PG_INLINE VEC2 SignNotZero( VEC2 v )
+{
+    return VEC2( ( v.x >= 0.0f ) ? 1.0f : -1.0f, ( v.y >= 0.0f ) ? 1.0f : -1.0f );
+}
+
+// Assumes a normalized input. Projects the sphere onto the octahedron, and then onto the xy plane, with the
+// folds of the lower hemisphere reflected over the diagonals. The output is on [0, 1] for a unorm target
+PG_INLINE VEC2 EncodeOctVec( VEC3 v )
+{
+    VEC2 p = VEC2( v.x, v.y ) * ( 1.0f / dot( abs( v ), VEC3( 1.0f ) ) );
+    if ( v.z < 0.0f )
+    {
+        p = ( VEC2( 1.0f ) - abs( VEC2( p.y, p.x ) ) ) * SignNotZero( p );
+    }
+    
+    return 0.5f * p + VEC2( 0.5f );
+}
+
+// OCTAHEDRON DECODING
+PG_INLINE VEC3 DecodeOctVec( VEC2 e )
+{
+    e      = 2.0f * e - VEC2( 1.0f );
+    VEC3 v = VEC3( e.x, e.y, 1.0f - dot( abs( e ), VEC2( 1.0f ) ) );
+    if ( v.z < 0.0f )
+    {
+        VEC2 xy = ( VEC2( 1.0f ) - abs( VEC2( v.y, v.x ) ) ) * SignNotZero( VEC2( v.x, v.y ) );
+        v.x     = xy.x;
+        v.y     = xy.y;
+    }
+    
+    return normalize( v );
+}
+
+// Both on [0, 1], stored with 8 bits each
+PG_INLINE UINT PackTwoFloatsToShort( float x, float y )
+{
+    UINT uX = UINT( x * 255.0f + 0.5f );
+    UINT uY = UINT( y * 255.0f + 0.5f );
+    return ( uX << 8 ) | ( uY & 0xFFu );
+}
+
+// Ks.w is the specular exponent, which is kept as a whole number
+PG_INLINE UVEC4 PackDiffuseAndSpecular( VEC3 Kd, VEC4 Ks )
+{
+    UVEC4 enc;
+    enc.x = PackTwoFloatsToShort( Kd.x, Ks.x );
+    enc.y = PackTwoFloatsToShort( Kd.y, Ks.y );
+    enc.z = PackTwoFloatsToShort( Kd.z, Ks.z );
+    enc.w = UINT( Ks.w );
+    
+    return enc;
+}
+
+PG_INLINE VEC3 UnpackDiffuse( UVEC4 enc )
+{
+    return VEC3( float( enc.x >> 8 ), float( enc.y >> 8 ), float( enc.z >> 8 ) ) / 255.0f;
+}
+
+PG_INLINE VEC4 UnpackSpecular( UVEC4 enc )
+{
+    return VEC4( float( enc.x & 0xFFu ) / 255.0f, float( enc.y & 0xFFu ) / 255.0f, float( enc.z & 0xFFu ) / 255.0f, float( enc.w ) );
+}
+
+// A perspective projection's [0, 1] depth back to the distance along the view direction. Params are
+// ( P[3][2], P[2][2] ), since only those two affect depth
+PG_INLINE float ViewDepth( float depth, VEC2 params )
+{
+    return params.x / ( depth + params.y );
+}
+
+PG_GPU_NAMESPACE_END
+PG_NAMESPACE_END
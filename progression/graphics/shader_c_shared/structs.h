@@ -11,10 +11,13 @@ struct SceneConstantBufferData
     MAT4 V;
     MAT4 P;
     MAT4 VP;
-    MAT4 LSM;
+    MAT4 invVP; // for rebuilding positions from the depth buffer
+    MAT4 cascadeVPs[PG_NUM_SHADOW_CASCADES]; // world space to each cascade's own [0, 1] of the shadow map
     VEC4 cameraPos;
     VEC4 ambientColor;
     DirectionalLight dirLight;
+    VEC4 lightClusterParams; // x,y = 1 / tan of half the fov in x and y, z,w = scale and bias of log( depth ) to the z slice
+    VEC4 cascadeSplits; // the view depth each cascade ends at
     UINT numPointLights;
     UINT numSpotLights;
 };
@@ -25,17 +28,17 @@ struct ObjectConstantBufferData
     MAT4 N;
 };
 
-struct AnimatedObjectConstantBufferData
+// All offsets are in floats. The skinned output for one instance is laid out as
+// [ positions | normals | tangents ], each numVertices long
+struct SkinningConstantData
 {
-    MAT4 M;
-    MAT4 N;
-    UINT boneTransformIdx;
-};
-
-struct AnimatedShadowPerObjectData
-{
-    MAT4 MVP;
+    UINT numVertices;
     UINT boneTransformIdx;
+    UINT positionOffset;
+    UINT normalOffset;
+    UINT tangentOffset; // ~0u if the model has no tangents
+    UINT blendWeightOffset;
+    UINT outputOffset;
 };
 
 struct MaterialConstantBufferData
@@ -46,10 +49,20 @@ struct MaterialConstantBufferData
     UINT normalMapIndex;
 };
 
-struct SSAOShaderData
+// For the passes that go between the full resolution gbuffer and the AO resolution
+struct SSAOResampleData
 {
     MAT4 V;
+    VEC2 depthParams; // for ViewDepth
+    UINT scale; // how many screen pixels wide each AO pixel is
+};
+
+struct SSAOShaderData
+{
     MAT4 P;
+    VEC2 uvScale; // AO texture uv to screen uv, since the AO texture hangs over the screen's edge if it doesn't divide evenly
+    UINT kernelOffset;
+    UINT kernelSize;
 };
 
 PG_GPU_NAMESPACE_END
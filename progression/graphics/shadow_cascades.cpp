@@ -0,0 +1,90 @@
+#include "graphics/shadow_cascades.hpp"
+#include "core/assert.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace Progression
+{
+namespace Gfx
+{
+
+    void ComputeCascadeSplits( float nearPlane, float farPlane, float lambda, float* splits )
+    {
+        PG_ASSERT( 0 < nearPlane && nearPlane < farPlane );
+        for ( uint32_t i = 1; i <= PG_NUM_SHADOW_CASCADES; ++i )
+        {
+            float t           = i / static_cast< float >( PG_NUM_SHADOW_CASCADES );
+            float logSplit    = nearPlane * std::pow( farPlane / nearPlane, t );
+            float evenSplit   = nearPlane + ( farPlane - nearPlane ) * t;
+            splits[i - 1]     = lambda * logSplit + ( 1 - lambda ) * evenSplit;
+        }
+        // no rounding error on the last one, so nothing past it falls out of every cascade
+        splits[PG_NUM_SHADOW_CASCADES - 1] = farPlane;
+    }
+
+    void ShadowCascade::Fit( const Camera& camera, const glm::vec3& lightDir, float sliceStart, float sliceEnd, const glm::uvec2& resolution )
+    {
+        PG_ASSERT( 0 < sliceStart && sliceStart < sliceEnd );
+        PG_ASSERT( resolution.x > 2 && resolution.y > 2 );
+        m_sliceStart = sliceStart;
+        m_sliceEnd   = sliceEnd;
+
+        // The slice's corners at depth d are sqrt( k ) * d away from the view axis, so the smallest sphere
+        // around them is centered on the axis, as far from the near corners as from the far ones. Only depends
+        // on the projection, so it doesn't change as the camera turns
+        float tanY       = std::tan( 0.5f * camera.fov );
+        float tanX       = tanY * camera.aspectRatio;
+        float k          = tanX * tanX + tanY * tanY;
+        float centerDist = std::min( 0.5f * ( sliceStart + sliceEnd ) * ( 1 + k ), sliceEnd );
+        float radius     = std::sqrt( ( sliceEnd - centerDist ) * ( sliceEnd - centerDist ) + k * sliceEnd * sliceEnd );
+        glm::vec3 center = camera.position + centerDist * camera.GetForwardDir();
+
+        // A texel of padding on each side, since snapping moves the sphere by up to one. The cascade's part of
+        // the shadow map doesn't have to be square, so the texels don't either
+        glm::vec2 halfExtent = radius / ( 1.0f - 2.0f / glm::vec2( resolution ) );
+        glm::vec2 texelSize  = 2.0f * halfExtent / glm::vec2( resolution );
+
+        glm::vec3 dir = glm::normalize( lightDir );
+        glm::vec3 up  = std::abs( dir.y ) > 0.99f ? glm::vec3( 1, 0, 0 ) : glm::vec3( 0, 1, 0 );
+        m_V           = glm::lookAt( glm::vec3( 0 ), dir, up );
+
+        glm::vec3 centerInLightSpace = glm::vec3( m_V * glm::vec4( center, 1 ) );
+        glm::vec2 snapped            = texelSize * glm::floor( glm::vec2( centerInLightSpace ) / texelSize );
+        m_min       = snapped - halfExtent;
+        m_max       = snapped + halfExtent;
+        m_nearDepth = -centerInLightSpace.z - radius;
+        m_farDepth  = -centerInLightSpace.z + radius;
+        UpdateVP();
+    }
+
+    bool ShadowCascade::AddCaster( const AABB& box )
+    {
+        AABB boxInLightSpace = box.Transformed( m_V );
+        if ( boxInLightSpace.max.x < m_min.x || boxInLightSpace.min.x > m_max.x ||
+             boxInLightSpace.max.y < m_min.y || boxInLightSpace.min.y > m_max.y )
+        {
+            return false;
+        }
+
+        // Casters entirely past the slice can only shadow what is even further away
+        float casterNearDepth = -boxInLightSpace.max.z;
+        if ( casterNearDepth > m_farDepth )
+        {
+            return false;
+        }
+        if ( casterNearDepth < m_nearDepth )
+        {
+            m_nearDepth = casterNearDepth;
+            UpdateVP();
+        }
+
+        return true;
+    }
+
+    void ShadowCascade::UpdateVP()
+    {
+        m_VP = glm::ortho( m_min.x, m_max.x, m_min.y, m_max.y, m_nearDepth, m_farDepth ) * m_V;
+    }
+
+} // namespace Gfx
+} // namespace Progression
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "core/bounding_box.hpp"
+#include "core/camera.hpp"
+#include "graphics/shader_c_shared/defines.h"
+#include <cstdint>
+
+namespace Progression
+{
+namespace Gfx
+{
+
+    // Splits [nearPlane, farPlane] into PG_NUM_SHADOW_CASCADES slices, and writes the view depth each one
+    // ends at. Lambda blends between even slices (0) and logarithmic ones (1), which keep the texel to
+    // pixel ratio the same across the cascades but make the near ones tiny
+    void ComputeCascadeSplits( float nearPlane, float farPlane, float lambda, float* splits );
+
+    // The directional light's orthographic projection for one slice of the camera frustum.
+    // It is fit around the slice's bounding sphere instead of its corners, so its size doesn't change as the
+    // camera turns, and its position is snapped to whole shadow map texels, so the edges of the shadows
+    // don't crawl as the camera moves.
+    // Starts out only as deep as the slice, and AddCaster pulls the near plane back towards the light for
+    // every caster in front of it. Like the light clusters, this never touches the device, so it can be
+    // run and checked on the CPU
+    class ShadowCascade
+    {
+    public:
+        ShadowCascade() = default;
+
+        // resolution is the size in texels of the cascade's part of the shadow map
+        void Fit( const Camera& camera, const glm::vec3& lightDir, float sliceStart, float sliceEnd, const glm::uvec2& resolution );
+
+        // Whether a caster with this world space box can shadow anything in the slice
+        bool AddCaster( const AABB& box );
+
+        // World space to the cascade's clip space
+        const glm::mat4& GetVP() const { return m_VP; }
+        float GetSliceStart() const { return m_sliceStart; }
+        float GetSliceEnd() const { return m_sliceEnd; }
+
+    private:
+        void UpdateVP();
+
+        glm::mat4 m_V  = glm::mat4( 1 ); // only rotates, the snapped bounds do the translation
+        glm::mat4 m_VP = glm::mat4( 1 );
+        // Light view space bounds. Depth is the distance along the light direction
+        glm::vec2 m_min = glm::vec2( 0 );
+        glm::vec2 m_max = glm::vec2( 0 );
+        float m_nearDepth  = 0;
+        float m_farDepth   = 0;
+        float m_sliceStart = 0;
+        float m_sliceEnd   = 0;
+    };
+
+} // namespace Gfx
+} // namespace Progression
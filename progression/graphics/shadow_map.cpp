@@ -1,4 +1,6 @@
 #include "graphics/shadow_map.hpp"
+#include "core/memory_manager.hpp"
+#include "graphics/pg_to_vulkan_types.hpp"
 #include "graphics/vulkan.hpp"
 #include "graphics/render_system.hpp"
 
@@ -11,6 +13,12 @@ using namespace Gfx;
 
 bool ShadowMap::Init()
 {
+    PG_MEMORY_TAG( Rendering );
+    if ( g_headless )
+    {
+        return true;
+    }
+
     ImageDescriptor desc = {};
     desc.width    = width;
     desc.height   = height;
@@ -23,17 +31,37 @@ bool ShadowMap::Init()
     {
         return false;
     }
-    framebuffer   = g_renderState.device.NewFramebuffer( { &texture }, shadowPassData.renderPass );
+    framebuffer   = g_renderState.device.NewFramebuffer( { &texture }, *shadowPassData.renderPass );
     if ( !framebuffer )
     {
         return false;
     }
+
+    // The static cache pass loads it, so it needs to start in the layout the render graph expects
+    staticTexture = g_renderState.device.NewTexture( desc );
+    if ( !staticTexture )
+    {
+        return false;
+    }
+    TransitionImageLayout( staticTexture.GetHandle(), PGToVulkanPixelFormat( desc.format ), VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL );
+    staticFramebuffer = g_renderState.device.NewFramebuffer( { &staticTexture }, *shadowPassData.staticRenderPass );
+    if ( !staticFramebuffer )
+    {
+        return false;
+    }
     
     return true;
 }
 
 void ShadowMap::Free()
 {
+    if ( g_headless )
+    {
+        return;
+    }
+
+    staticFramebuffer.Free();
+    staticTexture.Free();
     framebuffer.Free();
     texture.Free();
 }
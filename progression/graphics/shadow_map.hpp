@@ -1,8 +1,10 @@
 #pragma once
 
+#include "core/ecs.hpp"
 #include "core/math.hpp"
 #include "graphics/graphics_api/texture.hpp"
 #include "graphics/graphics_api/framebuffer.hpp"
+#include "graphics/shadow_cascades.hpp"
 
 namespace Progression
 {
@@ -17,11 +19,23 @@ public:
 
     Gfx::Texture texture;
     Gfx::Framebuffer framebuffer;
-    glm::mat4 LSM;
+    // Refit to the camera every frame, each one renders into its quadrant of the texture
+    Gfx::ShadowCascade cascades[PG_NUM_SHADOW_CASCADES];
+    float cascadeSplitLambda = 0.75f;
+
     float constantBias = 2;
     float slopeBias    = 9;
     uint32_t width     = 2048;
     uint32_t height    = 2048;
+
+    // Depth of only the static casters (EntityMetaData::isStatic). A cascade's quadrant only gets redrawn
+    // when the cascade moves or its static casters change. Every frame the shadow pass starts from a copy
+    // of it, and draws the dynamic casters on top
+    Gfx::Texture staticTexture;
+    Gfx::Framebuffer staticFramebuffer;
+    // What each quadrant of staticTexture was last drawn with
+    glm::mat4 staticVPs[PG_NUM_SHADOW_CASCADES] = {};
+    std::vector< entt::entity > staticCasters[PG_NUM_SHADOW_CASCADES];
 };
 
 } // namespace Progression
@@ -20,7 +20,9 @@ struct TexInfo
     VkSampler sampler;
 };
 
-static std::vector< std::pair< uint16_t, TexInfo > > s_slotsAddedSinceLastUpdate;
+// Each frame in flight has its own texture descriptor set, so every change has to be written into
+// all of them, each one only once the frame that last used it has finished
+static std::vector< std::pair< uint16_t, TexInfo > > s_slotsAddedSinceLastUpdate[Progression::Gfx::MAX_FRAMES_IN_FLIGHT];
 
 namespace Progression
 {
@@ -32,7 +34,10 @@ namespace TextureManager
     {
         s_setWrites.reserve( 256 );
         s_imageInfos.reserve( 256 );
-        s_slotsAddedSinceLastUpdate.reserve( 256 );
+        for ( auto& pending : s_slotsAddedSinceLastUpdate )
+        {
+            pending.reserve( 256 );
+        }
         s_slotsInUse.reset();
         s_currentSlot = 0;
         s_freeSlots.clear();
@@ -42,7 +47,10 @@ namespace TextureManager
     {
         s_setWrites.clear();
         s_imageInfos.clear();
-        s_slotsAddedSinceLastUpdate.clear();
+        for ( auto& pending : s_slotsAddedSinceLastUpdate )
+        {
+            pending.clear();
+        }
         s_slotsInUse.reset();
         s_currentSlot = 0;
         s_freeSlots.clear();
@@ -64,7 +72,10 @@ namespace TextureManager
         PG_ASSERT( openSlot < PG_MAX_NUM_TEXTURES && !s_slotsInUse[openSlot] );
         s_slotsInUse[openSlot] = true;
         TexInfo info = { tex->GetView(), tex->GetSampler()->GetHandle() };
-        s_slotsAddedSinceLastUpdate.emplace_back( openSlot, info );
+        for ( auto& pending : s_slotsAddedSinceLastUpdate )
+        {
+            pending.emplace_back( openSlot, info );
+        }
         return openSlot;
     }
 
@@ -79,30 +90,35 @@ namespace TextureManager
     {
         PG_ASSERT( tex && tex->GetShaderSlot() != PG_INVALID_TEXTURE_INDEX && s_slotsInUse[tex->GetShaderSlot()] );
         TexInfo info = { tex->GetView(), tex->GetSampler()->GetHandle() };
-        s_slotsAddedSinceLastUpdate.emplace_back( tex->GetShaderSlot(), info );
+        for ( auto& pending : s_slotsAddedSinceLastUpdate )
+        {
+            pending.emplace_back( tex->GetShaderSlot(), info );
+        }
     }
 
-    void UpdateDescriptors( const DescriptorSet& textureDescriptorSet )
+    void UpdateDescriptors( const DescriptorSet& textureDescriptorSet, uint32_t frameIndex )
     {
-        if ( s_slotsAddedSinceLastUpdate.empty() )
+        PG_ASSERT( frameIndex < MAX_FRAMES_IN_FLIGHT );
+        auto& pending = s_slotsAddedSinceLastUpdate[frameIndex];
+        if ( pending.empty() )
         {
             return;
         }
 
-        s_setWrites.resize( s_slotsAddedSinceLastUpdate.size(), {} );
-        s_imageInfos.resize( s_slotsAddedSinceLastUpdate.size() );
+        s_setWrites.resize( pending.size(), {} );
+        s_imageInfos.resize( pending.size() );
         for ( size_t i = 0; i < s_setWrites.size(); ++i )
         {
             s_imageInfos[i].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-            s_imageInfos[i].imageView   = s_slotsAddedSinceLastUpdate[i].second.view;
-            s_imageInfos[i].sampler     = s_slotsAddedSinceLastUpdate[i].second.sampler;
+            s_imageInfos[i].imageView   = pending[i].second.view;
+            s_imageInfos[i].sampler     = pending[i].second.sampler;
 
-            s_setWrites[i] = WriteDescriptorSet( textureDescriptorSet, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 0, &s_imageInfos[i], 1, static_cast< uint32_t >( s_slotsAddedSinceLastUpdate[i].first ) );
+            s_setWrites[i] = WriteDescriptorSet( textureDescriptorSet, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 0, &s_imageInfos[i], 1, static_cast< uint32_t >( pending[i].first ) );
         }
 
         vkUpdateDescriptorSets( g_renderState.device.GetHandle(), static_cast< uint32_t >( s_setWrites.size() ), s_setWrites.data(), 0, nullptr );
 
-        s_slotsAddedSinceLastUpdate.clear();
+        pending.clear();
     }
 
 } // namespace TextureManager
@@ -18,7 +18,8 @@ namespace TextureManager
     uint16_t GetOpenSlot( Texture* texture );
     void FreeSlot( uint16_t slot );
     void UpdateSampler( Texture* texture );
-    void UpdateDescriptors( const DescriptorSet& textureDescriptorSet );
+    // Writes every slot change that the given frame's descriptor set hasn't seen yet
+    void UpdateDescriptors( const DescriptorSet& textureDescriptorSet, uint32_t frameIndex );
 
 } // namespace TextureManager
 } // namespace Gfx
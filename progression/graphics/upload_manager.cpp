@@ -0,0 +1,444 @@
+#include "graphics/upload_manager.hpp"
+#include "core/assert.hpp"
+#include "core/memory_manager.hpp"
+#include "graphics/vulkan.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <numeric>
+#include <vector>
+
+// Enough to keep recording while the previous batches are still copying
+static constexpr uint32_t NUM_BATCHES = 4;
+static constexpr VkAccessFlags BUFFER_READ_ACCESS = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+
+namespace Progression
+{
+namespace Gfx
+{
+namespace UploadManager
+{
+
+    struct Batch
+    {
+        CommandBuffer transferCmdBuf;
+        // With a dedicated transfer queue, the resources have their ownership acquired by the graphics
+        // queue here, and the mips get generated here too since transfer queues can't blit
+        CommandBuffer graphicsCmdBuf;
+        Semaphore transferComplete;
+        Fence fence;
+        uint64_t ringEnd = 0; // the ring head when the batch was submitted
+        std::vector< Buffer > tempBuffers;
+        // Recorded all at once at the end of the batch, instead of after every copy
+        std::vector< VkBufferMemoryBarrier > bufferBarriers;
+        std::vector< VkImageMemoryBarrier > imageBarriers;
+        std::vector< Texture > mipmapTextures;
+        // Begun buffer uploads that haven't been written and committed yet. The batch can't be submitted until
+        // this is 0 again
+        uint32_t numUncommitted = 0;
+        bool recording = false;
+        bool inFlight  = false;
+    };
+
+    static std::mutex s_lock;
+    // Signaled whenever a buffer upload gets committed
+    static std::condition_variable s_committed;
+    static CommandPool s_transferCommandPool;
+    static CommandPool s_graphicsCommandPool;
+    static Batch s_batches[NUM_BATCHES];
+    static uint32_t s_currentBatch;
+    static bool s_dedicatedTransferQueue;
+    static Buffer s_ring;
+    // Bytes ever allocated from the ring, and bytes ever given back to it. Their difference is how much is in use
+    static uint64_t s_ringHead;
+    static uint64_t s_ringTail;
+
+    struct StagingAllocation
+    {
+        Buffer buffer;
+        size_t offset;
+        char* mappedPtr;
+        bool temporary;
+    };
+
+    // Gives back the staging memory of finished batches, oldest first. With waitForOne set, it blocks until at
+    // least one batch has finished
+    static void Retire( bool waitForOne )
+    {
+        for ( uint32_t i = 0; i < NUM_BATCHES; ++i )
+        {
+            // the current batch is the oldest one, if it isn't recording
+            Batch& batch = s_batches[( s_currentBatch + i ) % NUM_BATCHES];
+            if ( !batch.inFlight )
+            {
+                continue;
+            }
+            if ( !batch.fence.IsSignaled() )
+            {
+                if ( !waitForOne )
+                {
+                    break;
+                }
+                batch.fence.WaitFor();
+            }
+            waitForOne = false;
+
+            s_ringTail = std::max( s_ringTail, batch.ringEnd );
+            for ( Buffer& buffer : batch.tempBuffers )
+            {
+                buffer.Free();
+            }
+            batch.tempBuffers.clear();
+            batch.inFlight = false;
+        }
+    }
+
+    static bool AnyInFlight()
+    {
+        for ( const Batch& batch : s_batches )
+        {
+            if ( batch.inFlight )
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    static void FlushInternal( std::unique_lock< std::mutex >& lock )
+    {
+        // Another thread can flush the batch while this one waits, and start recording the next one
+        while ( s_batches[s_currentBatch].recording && s_batches[s_currentBatch].numUncommitted )
+        {
+            s_committed.wait( lock );
+        }
+        Batch& batch = s_batches[s_currentBatch];
+        if ( !batch.recording )
+        {
+            return;
+        }
+
+        uint32_t numBufferBarriers = static_cast< uint32_t >( batch.bufferBarriers.size() );
+        uint32_t numImageBarriers  = static_cast< uint32_t >( batch.imageBarriers.size() );
+        if ( s_dedicatedTransferQueue )
+        {
+            // The release and acquire halves of an ownership transfer only use their own side's access mask
+            std::vector< VkAccessFlags > dstAccess;
+            for ( auto& barrier : batch.bufferBarriers )
+            {
+                dstAccess.push_back( barrier.dstAccessMask );
+                barrier.dstAccessMask = 0;
+            }
+            for ( auto& barrier : batch.imageBarriers )
+            {
+                dstAccess.push_back( barrier.dstAccessMask );
+                barrier.dstAccessMask = 0;
+            }
+            batch.transferCmdBuf.PipelineBarrier( VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                                                  numBufferBarriers, batch.bufferBarriers.data(), numImageBarriers, batch.imageBarriers.data() );
+
+            size_t i = 0;
+            for ( auto& barrier : batch.bufferBarriers )
+            {
+                barrier.srcAccessMask = 0;
+                barrier.dstAccessMask = dstAccess[i++];
+            }
+            for ( auto& barrier : batch.imageBarriers )
+            {
+                barrier.srcAccessMask = 0;
+                barrier.dstAccessMask = dstAccess[i++];
+            }
+            batch.graphicsCmdBuf.PipelineBarrier( VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                                                  numBufferBarriers, batch.bufferBarriers.data(), numImageBarriers, batch.imageBarriers.data() );
+        }
+        else if ( numBufferBarriers + numImageBarriers )
+        {
+            batch.transferCmdBuf.PipelineBarrier( VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                                                  numBufferBarriers, batch.bufferBarriers.data(), numImageBarriers, batch.imageBarriers.data() );
+        }
+
+        const CommandBuffer& graphicsCmdBuf = s_dedicatedTransferQueue ? batch.graphicsCmdBuf : batch.transferCmdBuf;
+        for ( const Texture& texture : batch.mipmapTextures )
+        {
+            texture.GenerateMipMaps( graphicsCmdBuf );
+        }
+
+        batch.transferCmdBuf.EndRecording();
+        if ( s_dedicatedTransferQueue )
+        {
+            batch.graphicsCmdBuf.EndRecording();
+            g_renderState.device.Submit( CommandPoolQueueFamily::TRANSFER, batch.transferCmdBuf, nullptr, &batch.transferComplete, nullptr );
+            g_renderState.device.Submit( CommandPoolQueueFamily::GRAPHICS, batch.graphicsCmdBuf, &batch.transferComplete, nullptr, &batch.fence );
+        }
+        else
+        {
+            g_renderState.device.Submit( CommandPoolQueueFamily::TRANSFER, batch.transferCmdBuf, nullptr, nullptr, &batch.fence );
+        }
+
+        batch.bufferBarriers.clear();
+        batch.imageBarriers.clear();
+        batch.mipmapTextures.clear();
+        batch.ringEnd   = s_ringHead;
+        batch.recording = false;
+        batch.inFlight  = true;
+        s_currentBatch  = ( s_currentBatch + 1 ) % NUM_BATCHES;
+    }
+
+    static Batch& RecordingBatch()
+    {
+        Batch& batch = s_batches[s_currentBatch];
+        if ( batch.recording )
+        {
+            return batch;
+        }
+
+        // Every batch is in flight, and this is the oldest one
+        if ( batch.inFlight )
+        {
+            Retire( true );
+        }
+        batch.fence.Reset();
+        batch.transferCmdBuf.BeginRecording( COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT );
+        if ( s_dedicatedTransferQueue )
+        {
+            batch.graphicsCmdBuf.BeginRecording( COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT );
+        }
+        batch.recording = true;
+
+        return batch;
+    }
+
+    // alignment doesn't have to be a power of 2, since texel sizes can be 3 or 12 bytes
+    static StagingAllocation AllocateStaging( std::unique_lock< std::mutex >& lock, size_t size, size_t alignment )
+    {
+        StagingAllocation alloc;
+        if ( size + alignment > PG_STAGING_RING_SIZE )
+        {
+            PG_MEMORY_TAG( Staging );
+            alloc.buffer    = g_renderState.device.NewBuffer( size, BUFFER_TYPE_TRANSFER_SRC, MEMORY_TYPE_HOST_VISIBLE | MEMORY_TYPE_HOST_COHERENT, "Upload Staging" );
+            alloc.buffer.Map();
+            alloc.offset    = 0;
+            alloc.mappedPtr = alloc.buffer.MappedPtr();
+            alloc.temporary = true;
+            return alloc;
+        }
+
+        while ( true )
+        {
+            // Start over at the beginning of a lap when it's empty, so anything up to the whole ring fits
+            if ( s_ringHead == s_ringTail )
+            {
+                s_ringHead = s_ringTail = ( s_ringHead + PG_STAGING_RING_SIZE - 1 ) / PG_STAGING_RING_SIZE * PG_STAGING_RING_SIZE;
+            }
+            uint64_t lapStart = s_ringHead / PG_STAGING_RING_SIZE * PG_STAGING_RING_SIZE;
+            uint64_t offset   = ( s_ringHead - lapStart + alignment - 1 ) / alignment * alignment;
+            if ( offset + size > PG_STAGING_RING_SIZE )
+            {
+                lapStart += PG_STAGING_RING_SIZE;
+                offset    = 0;
+            }
+            if ( lapStart + offset + size - s_ringTail <= PG_STAGING_RING_SIZE )
+            {
+                s_ringHead      = lapStart + offset + size;
+                alloc.buffer    = s_ring;
+                alloc.offset    = offset;
+                alloc.mappedPtr = s_ring.MappedPtr() + offset;
+                alloc.temporary = false;
+                return alloc;
+            }
+
+            // Out of space. What's recorded so far has to be submitted before any of it can be freed
+            if ( !AnyInFlight() )
+            {
+                FlushInternal( lock );
+            }
+            Retire( true );
+        }
+    }
+
+    void Init()
+    {
+        s_transferCommandPool = g_renderState.device.NewCommandPool( COMMAND_POOL_RESET_COMMAND_BUFFER, CommandPoolQueueFamily::TRANSFER, "upload transfer" );
+        s_graphicsCommandPool = g_renderState.device.NewCommandPool( COMMAND_POOL_RESET_COMMAND_BUFFER, CommandPoolQueueFamily::GRAPHICS, "upload graphics" );
+        const auto& indices      = g_renderState.physicalDeviceInfo.indices;
+        s_dedicatedTransferQueue = indices.transferFamily != indices.graphicsFamily;
+        for ( uint32_t i = 0; i < NUM_BATCHES; ++i )
+        {
+            Batch& batch         = s_batches[i];
+            batch.transferCmdBuf = s_transferCommandPool.NewCommandBuffer( "upload transfer " + std::to_string( i ) );
+            batch.fence          = g_renderState.device.NewFence( false, "upload " + std::to_string( i ) );
+            if ( s_dedicatedTransferQueue )
+            {
+                batch.graphicsCmdBuf   = s_graphicsCommandPool.NewCommandBuffer( "upload graphics " + std::to_string( i ) );
+                batch.transferComplete = g_renderState.device.NewSemaphore( "upload transfer complete " + std::to_string( i ) );
+            }
+        }
+        s_currentBatch = 0;
+        s_ringHead     = 0;
+        s_ringTail     = 0;
+
+        PG_MEMORY_TAG( Staging );
+        s_ring = g_renderState.device.NewBuffer( PG_STAGING_RING_SIZE, BUFFER_TYPE_TRANSFER_SRC, MEMORY_TYPE_HOST_VISIBLE | MEMORY_TYPE_HOST_COHERENT, "Staging Ring" );
+        s_ring.Map();
+    }
+
+    void Shutdown()
+    {
+        WaitForAll();
+        s_ring.UnMap();
+        s_ring.Free();
+        for ( Batch& batch : s_batches )
+        {
+            batch.fence.Free();
+            if ( batch.transferComplete )
+            {
+                batch.transferComplete.Free();
+            }
+            batch = Batch();
+        }
+        s_transferCommandPool.Free();
+        s_graphicsCommandPool.Free();
+    }
+
+    // Records the copy and its barrier, and returns where to stage the data
+    static void* RecordBufferUpload( std::unique_lock< std::mutex >& lock, const Buffer& dst, size_t size, size_t dstOffset )
+    {
+        PG_ASSERT( dst.GetType() & BUFFER_TYPE_TRANSFER_DST );
+        StagingAllocation staging = AllocateStaging( lock, size, 16 );
+        Batch& batch              = RecordingBatch();
+        if ( staging.temporary )
+        {
+            batch.tempBuffers.push_back( staging.buffer );
+        }
+        batch.transferCmdBuf.Copy( dst, staging.buffer, size, staging.offset, dstOffset );
+
+        const auto& indices         = g_renderState.physicalDeviceInfo.indices;
+        VkBufferMemoryBarrier barrier = {};
+        barrier.sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        barrier.srcAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask       = BUFFER_READ_ACCESS;
+        barrier.srcQueueFamilyIndex = s_dedicatedTransferQueue ? indices.transferFamily : VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = s_dedicatedTransferQueue ? indices.graphicsFamily : VK_QUEUE_FAMILY_IGNORED;
+        barrier.buffer              = dst.GetHandle();
+        barrier.offset              = dstOffset;
+        barrier.size                = size;
+        batch.bufferBarriers.push_back( barrier );
+
+        return staging.mappedPtr;
+    }
+
+    void UploadBuffer( const Buffer& dst, const void* data, size_t size, size_t dstOffset )
+    {
+        std::unique_lock< std::mutex > lock( s_lock );
+        memcpy( RecordBufferUpload( lock, dst, size, dstOffset ), data, size );
+    }
+
+    BufferUpload BeginBufferUpload( const Buffer& dst, size_t size, size_t dstOffset )
+    {
+        std::unique_lock< std::mutex > lock( s_lock );
+        BufferUpload upload;
+        upload.data       = RecordBufferUpload( lock, dst, size, dstOffset );
+        upload.batchIndex = s_currentBatch;
+        ++s_batches[s_currentBatch].numUncommitted;
+
+        return upload;
+    }
+
+    void CommitBufferUpload( const BufferUpload& upload )
+    {
+        {
+            std::lock_guard< std::mutex > lock( s_lock );
+            Batch& batch = s_batches[upload.batchIndex];
+            PG_ASSERT( batch.recording && batch.numUncommitted > 0, "Buffer upload committed twice" );
+            --batch.numUncommitted;
+        }
+        s_committed.notify_all();
+    }
+
+    void UploadTexture( const Texture& dst, const void* data, bool generateMips )
+    {
+        ImageDescriptor stagedDesc;
+        stagedDesc.format      = dst.GetPixelFormat();
+        stagedDesc.width       = dst.GetWidth();
+        stagedDesc.height      = dst.GetHeight();
+        stagedDesc.arrayLayers = dst.GetArrayLayers();
+        stagedDesc.mipLevels   = generateMips ? 1 : dst.GetMipLevels();
+        size_t size            = CalculateTotalTextureSize( stagedDesc );
+        // bufferOffset has to be a multiple of both the texel (or block) size and 4
+        size_t texelSize       = static_cast< size_t >( SizeOfPixelFromat( dst.GetPixelFormat() ) );
+        size_t alignment       = std::lcm( std::lcm( texelSize, size_t( 4 ) ), static_cast< size_t >( g_renderState.physicalDeviceInfo.deviceProperties.limits.optimalBufferCopyOffsetAlignment ) );
+
+        std::unique_lock< std::mutex > lock( s_lock );
+        StagingAllocation staging = AllocateStaging( lock, size, alignment );
+        memcpy( staging.mappedPtr, data, size );
+        Batch& batch              = RecordingBatch();
+        if ( staging.temporary )
+        {
+            batch.tempBuffers.push_back( staging.buffer );
+        }
+
+        VkImageMemoryBarrier barrier            = {};
+        barrier.sType                           = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcAccessMask                   = 0;
+        barrier.dstAccessMask                   = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.oldLayout                       = VK_IMAGE_LAYOUT_UNDEFINED;
+        barrier.newLayout                       = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.srcQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image                           = dst.GetHandle();
+        barrier.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+        barrier.subresourceRange.baseMipLevel   = 0;
+        barrier.subresourceRange.levelCount     = dst.GetMipLevels();
+        barrier.subresourceRange.baseArrayLayer = 0;
+        barrier.subresourceRange.layerCount     = dst.GetArrayLayers();
+        batch.transferCmdBuf.PipelineBarrier( VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, barrier );
+        batch.transferCmdBuf.CopyBufferToImage( staging.buffer, dst, !generateMips, staging.offset );
+
+        // The mip generation's own barriers take care of the copy when it's on the same queue
+        if ( generateMips )
+        {
+            batch.mipmapTextures.push_back( dst );
+            if ( !s_dedicatedTransferQueue )
+            {
+                return;
+            }
+        }
+
+        const auto& indices         = g_renderState.physicalDeviceInfo.indices;
+        barrier.srcAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask       = generateMips ? ( VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT ) : VK_ACCESS_SHADER_READ_BIT;
+        barrier.oldLayout           = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout           = generateMips ? VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barrier.srcQueueFamilyIndex = s_dedicatedTransferQueue ? indices.transferFamily : VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = s_dedicatedTransferQueue ? indices.graphicsFamily : VK_QUEUE_FAMILY_IGNORED;
+        batch.imageBarriers.push_back( barrier );
+    }
+
+    void Flush()
+    {
+        std::unique_lock< std::mutex > lock( s_lock );
+        FlushInternal( lock );
+    }
+
+    void Update()
+    {
+        std::unique_lock< std::mutex > lock( s_lock );
+        FlushInternal( lock );
+        Retire( false );
+    }
+
+    void WaitForAll()
+    {
+        std::unique_lock< std::mutex > lock( s_lock );
+        FlushInternal( lock );
+        while ( AnyInFlight() )
+        {
+            Retire( true );
+        }
+    }
+
+} // namespace UploadManager
+} // namespace Gfx
+} // namespace Progression
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Size of the persistently mapped ring that uploads are staged through. Anything that can't fit in it
+// gets a staging buffer of its own, which is freed once its batch finishes
+#define PG_STAGING_RING_SIZE ( 64u * 1024 * 1024 )
+
+namespace Progression
+{
+namespace Gfx
+{
+
+class Buffer;
+class Texture;
+
+// Batches the copies of many uploads into one command buffer, which runs on the dedicated transfer
+// queue if the gpu has one. Uploads are never waited on individually: Flush submits everything
+// recorded so far, and any graphics work submitted after that sees the uploaded data. Fences tell
+// when a batch is done, so its part of the staging ring can be reused.
+namespace UploadManager
+{
+
+    void Init();
+    void Shutdown();
+
+    // Stages the data right away, so it can be freed as soon as this returns
+    void UploadBuffer( const Buffer& dst, const void* data, size_t size, size_t dstOffset = 0 );
+
+    // Staging memory reserved for one buffer upload, by BeginBufferUpload
+    struct BufferUpload
+    {
+        void* data = nullptr; // where the size bytes of data go
+
+        // internal
+        uint32_t batchIndex = 0;
+    };
+
+    // Reserves the staging memory instead of copying into it, saving a copy when the data has to be built
+    // anyways. Write the data to upload.data, then commit it. The upload's batch doesn't get submitted until
+    // then, so Flush and running out of staging memory wait on it: commit before starting another upload
+    BufferUpload BeginBufferUpload( const Buffer& dst, size_t size, size_t dstOffset = 0 );
+    void CommitBufferUpload( const BufferUpload& upload );
+
+    // The data holds every face with all of their mips, laid out like CalculateTotalTextureSize. With
+    // generateMips, it only holds mip 0 of each face, and the rest get generated. The texture ends up
+    // in SHADER_READ_ONLY_OPTIMAL
+    void UploadTexture( const Texture& dst, const void* data, bool generateMips = false );
+
+    // Submits the current batch, without waiting for it
+    void Flush();
+    // Frees the staging memory of every batch that finished. Called once a frame
+    void Update();
+    void WaitForAll();
+
+} // namespace UploadManager
+} // namespace Gfx
+} // namespace Progression
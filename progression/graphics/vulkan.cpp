@@ -1,11 +1,14 @@
 #include "graphics/vulkan.hpp"
 #include "core/platform_defines.hpp"
 #include <vulkan/vulkan.h>
+#include "core/memory_manager.hpp"
 #include "core/window.hpp"
 #include "graphics/debug_marker.hpp"
 #include "graphics/graphics_api.hpp"
 #include "graphics/render_system.hpp"
 #include "graphics/pg_to_vulkan_types.hpp"
+#include "graphics/pipeline_cache.hpp"
+#include "graphics/upload_manager.hpp"
 #include "utils/logger.hpp"
 #include <algorithm>
 #include <iostream>
@@ -29,6 +32,7 @@ namespace Gfx
 {
 
 RenderState g_renderState;
+bool g_headless = false;
 
 bool PhysicalDeviceInfo::ExtensionSupported( const std::string& extensionName ) const
 {
@@ -213,6 +217,18 @@ static QueueFamilyIndices FindQueueFamilies( VkPhysicalDevice device, VkSurfaceK
         }
     }
 
+    // Dedicated transfer queues are usually backed by DMA engines, which can copy while the graphics queue is busy
+    indices.transferFamily = indices.graphicsFamily;
+    for ( uint32_t i = 0; i < static_cast< uint32_t >( queueFamilies.size() ); ++i )
+    {
+        VkQueueFlags flags = queueFamilies[i].queueFlags;
+        if ( queueFamilies[i].queueCount > 0 && ( flags & VK_QUEUE_TRANSFER_BIT ) && !( flags & ( VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT ) ) )
+        {
+            indices.transferFamily = i;
+            break;
+        }
+    }
+
     return indices;
 }
 
@@ -576,10 +592,14 @@ static bool CreateCommandPoolAndBuffers()
     }
     g_renderState.computeCommandBuffer = g_renderState.computeCommandPool.NewCommandBuffer( "compute" );
 
-    g_renderState.graphicsCommandBuffer = g_renderState.graphicsCommandPool.NewCommandBuffer( "global graphics" );
-    if ( !g_renderState.graphicsCommandBuffer )
+    for ( int i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i )
     {
-        return false;
+        auto& frame = g_renderState.frames[i];
+        frame.graphicsCommandBuffer = g_renderState.graphicsCommandPool.NewCommandBuffer( "graphics frame " + std::to_string( i ) );
+        if ( !frame.graphicsCommandBuffer )
+        {
+            return false;
+        }
     }
 
     return true;
@@ -587,9 +607,21 @@ static bool CreateCommandPoolAndBuffers()
 
 static bool CreateSynchronizationObjects()
 {
-    g_renderState.presentCompleteSemaphore = g_renderState.device.NewSemaphore( "present complete" );
-    g_renderState.renderCompleteSemaphore  = g_renderState.device.NewSemaphore( "render complete" );
-    g_renderState.computeFence             = g_renderState.device.NewFence( true, "compute" );
+    for ( int i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i )
+    {
+        auto& frame = g_renderState.frames[i];
+        std::string suffix = " frame " + std::to_string( i );
+        frame.presentCompleteSemaphore = g_renderState.device.NewSemaphore( "present complete" + suffix );
+        frame.renderCompleteSemaphore  = g_renderState.device.NewSemaphore( "render complete" + suffix );
+        // Created signaled, so the first wait on each frame doesn't block
+        frame.inFlightFence            = g_renderState.device.NewFence( true, "in flight" + suffix );
+        if ( !frame.presentCompleteSemaphore || !frame.renderCompleteSemaphore || !frame.inFlightFence )
+        {
+            return false;
+        }
+    }
+    g_renderState.computeFence = g_renderState.device.NewFence( true, "compute" );
+    g_renderState.currentFrame = 0;
 
     return true;
 }
@@ -677,6 +709,7 @@ uint32_t SwapChain::AcquireNextImage( const Semaphore& presentCompleteSemaphore
 
 bool VulkanInit()
 {
+    PG_MEMORY_TAG( Rendering );
     if ( !CreateInstance() )
     {
         LOG_ERR( "Could not create vulkan instance" );
@@ -718,6 +751,9 @@ bool VulkanInit()
     PG_DEBUG_MARKER_SET_LOGICAL_DEVICE_NAME( g_renderState.device, "default" );
     PG_DEBUG_MARKER_SET_QUEUE_NAME( g_renderState.device.GraphicsQueue(), "graphics" );
     PG_DEBUG_MARKER_SET_QUEUE_NAME( g_renderState.device.PresentQueue(), "present" );
+    PG_DEBUG_MARKER_SET_QUEUE_NAME( g_renderState.device.TransferQueue(), "transfer" );
+
+    PipelineCache::Init();
 
     RenderSystem::InitSamplers();
 
@@ -757,16 +793,24 @@ bool VulkanInit()
         return false;
     }
 
+    UploadManager::Init();
+
     return true;
 }
 
 void VulkanShutdown()
 {
+    UploadManager::Shutdown();
+    PipelineCache::Shutdown();
     RenderSystem::FreeSamplers();
     VkDevice dev = g_renderState.device.GetHandle();
 
-    g_renderState.presentCompleteSemaphore.Free();
-    g_renderState.renderCompleteSemaphore.Free();
+    for ( auto& frame : g_renderState.frames )
+    {
+        frame.presentCompleteSemaphore.Free();
+        frame.renderCompleteSemaphore.Free();
+        frame.inFlightFence.Free();
+    }
     g_renderState.computeFence.Free();
 
     g_renderState.depthTex.Free();
@@ -793,6 +837,33 @@ void VulkanShutdown()
     vkDestroyInstance( g_renderState.instance, nullptr );
 }
 
+FrameData& CurrentFrame()
+{
+    return g_renderState.frames[g_renderState.currentFrame];
+}
+
+void SetFramePacing( FramePacing pacing )
+{
+    uint32_t numFrames = pacing == FramePacing::LOW_LATENCY ? 1 : MAX_FRAMES_IN_FLIGHT;
+    if ( numFrames == g_renderState.numFramesInFlight )
+    {
+        return;
+    }
+
+    if ( !g_headless && g_renderState.device )
+    {
+        g_renderState.device.WaitForIdle();
+    }
+    g_renderState.numFramesInFlight = numFrames;
+    g_renderState.currentFrame      = 0;
+    LOG( "Frame pacing set to ", pacing == FramePacing::LOW_LATENCY ? "low latency" : "throughput", ", ", numFrames, " frame(s) in flight" );
+}
+
+FramePacing GetFramePacing()
+{
+    return g_renderState.numFramesInFlight == 1 ? FramePacing::LOW_LATENCY : FramePacing::THROUGHPUT;
+}
+
 uint32_t FindMemoryType( uint32_t typeFilter, VkMemoryPropertyFlags properties )
 {
     auto& memProperties = g_renderState.physicalDeviceInfo.memProperties;
@@ -828,7 +899,10 @@ void TransitionImageLayout( VkImage image, VkFormat format, VkImageLayout oldLay
     barrier.subresourceRange.layerCount     = layers;
     barrier.srcAccessMask                   = 0;
     barrier.dstAccessMask                   = 0;
-    PG_UNUSED( format );
+    if ( format == VK_FORMAT_D32_SFLOAT || format == VK_FORMAT_D16_UNORM )
+    {
+        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+    }
 
     VkPipelineStageFlags srcStage, dstStage;
     if ( oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL )
@@ -845,6 +919,14 @@ void TransitionImageLayout( VkImage image, VkFormat format, VkImageLayout oldLay
         srcStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
         dstStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
     }
+    else if ( oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL )
+    {
+        // Render targets that get loaded before anything has been rendered to them. The contents stay undefined
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        srcStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+        dstStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    }
     else
     {
         PG_ASSERT( false, "The transition barriers are unknown for the given old and new layouts" );
@@ -11,11 +11,31 @@ namespace Gfx
 {
     const int MAX_FRAMES_IN_FLIGHT = 2;
 
+    // LOW_LATENCY waits for the previous frame to finish before starting the next one. THROUGHPUT lets
+    // the cpu record up to MAX_FRAMES_IN_FLIGHT frames ahead of the gpu, at the cost of a frame of latency
+    enum class FramePacing
+    {
+        LOW_LATENCY,
+        THROUGHPUT,
+    };
+
+    // Everything that the cpu writes while recording a frame needs one copy per frame in flight,
+    // since the gpu can still be reading the copy from the previous frame
+    struct FrameData
+    {
+        CommandBuffer graphicsCommandBuffer;
+        Semaphore presentCompleteSemaphore;
+        Semaphore renderCompleteSemaphore;
+        // Signaled when the frame's graphics work is done, and all of its per-frame resources can be reused
+        Fence inFlightFence;
+    };
+
     struct QueueFamilyIndices
     {
         uint32_t graphicsFamily = ~0u;
         uint32_t presentFamily  = ~0u;
         uint32_t computeFamily  = ~0u;
+        uint32_t transferFamily = ~0u; // the graphics family, if there is no dedicated transfer queue
 
         bool IsComplete() const
         {
@@ -64,23 +84,34 @@ namespace Gfx
         CommandPool graphicsCommandPool;
         CommandPool transientCommandPool;
         CommandPool computeCommandPool;
-        CommandBuffer graphicsCommandBuffer;
         CommandBuffer computeCommandBuffer;
-        
-        Semaphore presentCompleteSemaphore;
-        Semaphore renderCompleteSemaphore;
         Fence computeFence;
 
+        FrameData frames[MAX_FRAMES_IN_FLIGHT];
+        uint32_t currentFrame      = 0;
+        uint32_t numFramesInFlight = MAX_FRAMES_IN_FLIGHT;
+
         Device device;
         RenderPass renderPass;
     };
 
     extern RenderState g_renderState;
 
+    // Set before EngineInitialize to run without a window, swapchain or Vulkan device, for the CPU
+    // only benchmarks. Resources still get loaded, but nothing gets created on the GPU
+    extern bool g_headless;
+
     bool VulkanInit();
 
     void VulkanShutdown();
 
+    FrameData& CurrentFrame();
+
+    // Waits for the device to go idle before switching, so no frame is left using resources that
+    // the new mode would hand out again
+    void SetFramePacing( FramePacing pacing );
+    FramePacing GetFramePacing();
+
     uint32_t FindMemoryType( uint32_t typeFilter, VkMemoryPropertyFlags properties );
 
     void TransitionImageLayout( VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels = 1, uint32_t layers = 1 );
@@ -38,13 +38,27 @@ bool EngineInitialize( std::string config_name )
         bool colors = *logConfig->get_as< bool >( "useColors" );
 
         g_Logger.Init( filename, colors );
+
+        // optional, for LOG_FAST messages
+        if ( logConfig->contains( "binaryFile" ) )
+        {
+            std::string binaryFilename = PG_ROOT_DIR + *logConfig->get_as< std::string >( "binaryFile" );
+            if ( !BinaryLog::Init( binaryFilename ) )
+            {
+                LOG_WARN( "Could not open the binary log file '", binaryFilename, "'" );
+            }
+        }
     }
 
+    MemoryManager::Init();
+    CpuProfile::Init();
+    Jobs::Init();
     RegisterTypesAndFunctionsToLua( g_LuaState );
 
     Random::SetSeed( time( NULL ) );
 
-    // window
+    // window, input, and the GPU. None of which exist when running headless
+    if ( !Gfx::g_headless )
     {
         auto winConfig = conf->get_table( "window" );
         PG_ASSERT( winConfig );
@@ -60,15 +74,57 @@ bool EngineInitialize( std::string config_name )
         winCreate.visible = *winConfig->get_as< bool >( "visible" );
         winCreate.vsync   = *winConfig->get_as< bool >( "vsync" );
         InitWindowSystem( winCreate );
+        Input::Init();
+        Gfx::TextureManager::Init();
+        if ( !Gfx::VulkanInit() )
+        {
+            LOG_ERR( "Could not initialize vulkan" );
+            return false;
+        }
+        // optional, trades a frame of cpu/gpu overlap for a frame less of input latency
+        if ( winConfig->contains( "lowLatency" ) && *winConfig->get_as< bool >( "lowLatency" ) )
+        {
+            Gfx::SetFramePacing( Gfx::FramePacing::LOW_LATENCY );
+        }
+
+        // optional, trades ambient occlusion detail for speed
+        auto ssaoConfig = conf->get_table( "ssao" );
+        if ( ssaoConfig )
+        {
+            if ( ssaoConfig->contains( "resolution" ) )
+            {
+                std::string resolution = *ssaoConfig->get_as< std::string >( "resolution" );
+                if ( resolution == "full" )
+                {
+                    RenderSystem::SetSSAOResolution( RenderSystem::SSAOResolution::FULL );
+                }
+                else if ( resolution == "half" )
+                {
+                    RenderSystem::SetSSAOResolution( RenderSystem::SSAOResolution::HALF );
+                }
+                else if ( resolution == "quarter" )
+                {
+                    RenderSystem::SetSSAOResolution( RenderSystem::SSAOResolution::QUARTER );
+                }
+                else
+                {
+                    LOG_WARN( "Unknown SSAO resolution '", resolution, "', expected full, half or quarter" );
+                }
+            }
+            if ( ssaoConfig->contains( "kernelSize" ) && !RenderSystem::SetSSAOKernelSize( *ssaoConfig->get_as< int >( "kernelSize" ) ) )
+            {
+                LOG_WARN( "Unsupported SSAO kernel size ", *ssaoConfig->get_as< int >( "kernelSize" ), ", expected 8, 16, 32 or 64" );
+            }
+        }
+
+        // optional, on by default
+        auto cullingConfig = conf->get_table( "culling" );
+        if ( cullingConfig && cullingConfig->contains( "occlusion" ) )
+        {
+            RenderSystem::SetOcclusionCulling( *cullingConfig->get_as< bool >( "occlusion" ) );
+        }
     }
     Time::Reset();
-    Input::Init();
-    Gfx::TextureManager::Init();
-    if ( !Gfx::VulkanInit() )
-    {
-        LOG_ERR( "Could not initialize vulkan" );
-        return false;
-    }
     ResourceManager::Init();
     if ( !g_converterMode )
     {
@@ -76,7 +132,7 @@ bool EngineInitialize( std::string config_name )
         {
             return false;
         }
-        if ( !RenderSystem::Init() )
+        if ( !Gfx::g_headless && !RenderSystem::Init() )
         {
             LOG_ERR( "Could not initialize the rendering system" );
             return false;
@@ -92,13 +148,23 @@ void EngineQuit()
     if ( !g_converterMode )
     {
         AnimationSystem::Shutdown();
-        RenderSystem::Shutdown();
+        if ( !Gfx::g_headless )
+        {
+            RenderSystem::Shutdown();
+        }
     }
     ResourceManager::Shutdown();
-    Gfx::VulkanShutdown();
-    Gfx::TextureManager::Shutdown();
-    Input::Free();
-    ShutdownWindowSystem();
+    if ( !Gfx::g_headless )
+    {
+        Gfx::VulkanShutdown();
+        Gfx::TextureManager::Shutdown();
+        Input::Free();
+        ShutdownWindowSystem();
+    }
+    Jobs::Shutdown();
+    CpuProfile::Shutdown();
+    MemoryManager::Shutdown();
+    BinaryLog::Shutdown();
     g_Logger.Shutdown();
 }
 
@@ -4,15 +4,20 @@
 #include "core/assert.hpp"
 #include "core/camera.hpp"
 #include "core/config.hpp"
+#include "core/cpu_profiling.hpp"
 #include "core/platform_defines.hpp"
 #include "core/ecs.hpp"
 #include "core/frustum.hpp"
 #include "core/input.hpp"
 #include "core/input_types.hpp"
+#include "core/jobs.hpp"
 #include "core/lua.hpp"
 #include "core/math.hpp"
+#include "core/memory_manager.hpp"
 #include "core/scene.hpp"
+#include "core/system_scheduler.hpp"
 #include "core/time.hpp"
+#include "core/transform_system.hpp"
 #include "core/window.hpp"
 
 #include "graphics/graphics_api.hpp"
@@ -29,6 +34,7 @@
 #include "resource/resource_manager.hpp"
 #include "resource/script.hpp"
 #include "resource/shader.hpp"
+#include "utils/binary_log.hpp"
 #include "utils/logger.hpp"
 #include "utils/random.hpp"
 
@@ -1,6 +1,7 @@
 #include "core/feature_defines.hpp"
 #include "basis_universal/transcoder/basisu_transcoder.h"
 #include "basis_universal/basisu_comp.h"
+#include "core/jobs.hpp"
 #include "core/time.hpp"
 #include "graphics/graphics_api.hpp"
 #include "lz4/lz4.h"
@@ -10,12 +11,14 @@
 #include "resource/model.hpp"
 #include "resource/resource_version_numbers.hpp"
 #include "resource/shader.hpp"
+#include "utils/binary_log.hpp"
 #include "utils/fileIO.hpp"
 #include "utils/json_parsing.hpp"
 #include "utils/logger.hpp"
 #include "utils/serialize.hpp"
 #include "utils/timestamp.hpp"
 #include "utils/type_name.hpp"
+#include <atomic>
 #include <filesystem>
 #include <fstream>
 
@@ -322,27 +325,49 @@ static ConverterStatus WriteResources( std::ofstream& out, std::vector< Converte
     return CONVERT_SUCCESS;
 }
 
+// Converters that only read their own input files and write their own output files can run in parallel.
+// Images are left serial since the basis compressor already uses every core for a single image
 template< typename ConverterType >
-static ConverterStatus RunConverts( std::vector< ConverterType >& converters )
+static ConverterStatus RunConverts( std::vector< ConverterType >& converters, bool parallel = false )
 {
-    uint32_t numResource = static_cast< uint32_t >( converters.size() );
-    for ( auto& converter : converters )
+    std::atomic< bool > failed = { false };
+    const auto typeName        = type_name< ConverterType >();
+    PG_MAYBE_UNUSED( typeName );
+    auto convert = [&]( uint32_t begin, uint32_t end )
     {
-        if ( converter.status != ASSET_UP_TO_DATE )
+        for ( uint32_t i = begin; i < end && !failed; ++i )
         {
-            auto time = Time::GetTimePoint();
-            LOG( "\nConverter: ", type_name< ConverterType >(), ", resource '", converter.GetName(), "'" );
-            if ( converter.Convert() != CONVERT_SUCCESS )
+            auto& converter = converters[i];
+            if ( converter.status == ASSET_UP_TO_DATE )
+            {
+                LOG_FAST( "{} '{}' is up to date", std::string_view( typeName.data(), typeName.size() ), converter.GetName() );
+            }
+            else
             {
-                LOG_ERR( "Error while in ", type_name< ConverterType >() );
-                return CONVERT_ERROR;
+                auto time = Time::GetTimePoint();
+                if ( converter.Convert() != CONVERT_SUCCESS )
+                {
+                    LOG_ERR( "Error while in ", type_name< ConverterType >(), ", resource '", converter.GetName(), "'" );
+                    failed = true;
+                    return;
+                }
+                PG_MAYBE_UNUSED( time );
+                LOG_FAST( "{} '{}' converted in {} ms", std::string_view( typeName.data(), typeName.size() ), converter.GetName(), Time::GetDuration( time ) );
             }
-            PG_MAYBE_UNUSED( time );
-            LOG( "Convert finished in: ", Time::GetDuration( time ) / 1000, " seconds" );
         }
+    };
+
+    uint32_t numResources = static_cast< uint32_t >( converters.size() );
+    if ( parallel )
+    {
+        Jobs::ParallelFor( numResources, 1, convert );
+    }
+    else
+    {
+        convert( 0, numResources );
     }
 
-    return CONVERT_SUCCESS;
+    return failed ? CONVERT_ERROR : CONVERT_SUCCESS;
 }
 
 ConverterStatus FastfileConverter::Convert()
@@ -355,7 +380,7 @@ ConverterStatus FastfileConverter::Convert()
     auto fastFileStartTime = Time::GetTimePoint();
 
     ConverterStatus ret;
-    ret = RunConverts( shaderConverters );
+    ret = RunConverts( shaderConverters, true );
     if ( ret != CONVERT_SUCCESS ) return ret;
 
     ret = RunConverts( imageConverters );
@@ -367,7 +392,7 @@ ConverterStatus FastfileConverter::Convert()
     ret = RunConverts( modelConverters );
     if ( ret != CONVERT_SUCCESS ) return ret;
 
-    ret = RunConverts( scriptConverters );
+    ret = RunConverts( scriptConverters, true );
     if ( ret != CONVERT_SUCCESS ) return ret;
 
     for ( int i = 0; i < 2; ++i )
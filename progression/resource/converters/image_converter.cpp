@@ -2,6 +2,7 @@
 #include "basis_universal/transcoder/basisu_transcoder.h"
 #include "basis_universal/basisu_comp.h"
 #include "core/assert.hpp"
+#include "core/jobs.hpp"
 #include "graphics/render_system.hpp"
 #include "resource/image.hpp"
 #include "resource/resource_manager.hpp"
@@ -13,7 +14,6 @@
 #include "utils/timestamp.hpp"
 #include <filesystem>
 #include <fstream>
-#include <thread>
 
 using namespace Progression;
 namespace fs = std::filesystem;
@@ -352,15 +352,9 @@ static bool CompressImage( const Image& image, basisu::basis_compressor& compres
 {
     basist::etc1_global_selector_codebook sel_codebook( basist::g_global_selector_cb_size, basist::g_global_selector_cb );
 
-    uint32_t num_threads = 1;
-    num_threads = std::thread::hardware_concurrency();
-    if ( num_threads < 1 )
-    {
-	    num_threads = 1;
-    }
-
+    // The compressor only accepts its own job_pool type, but size it the same as the engine's job system
     basisu::basis_compressor_params params = {};
-    basisu::job_pool jpool( num_threads );
+    basisu::job_pool jpool( Jobs::NumThreads() );
     params.m_pJob_pool                = &jpool;
     params.m_read_source_images       = false;
     params.m_write_output_basis_files = false;
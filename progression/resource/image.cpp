@@ -1,8 +1,10 @@
 #include "resource/image.hpp"
 #include "core/assert.hpp"
+#include "core/memory_manager.hpp"
 #include "graphics/debug_marker.hpp"
 #include "graphics/render_system.hpp"
 #include "graphics/pg_to_vulkan_types.hpp"
+#include "graphics/upload_manager.hpp"
 #include "graphics/vulkan.hpp"
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image/stb_image.h"
@@ -190,7 +192,7 @@ bool Image::Load( ResourceCreateInfo* createInfo )
         }
     }
 
-    if ( m_flags & IMAGE_CREATE_TEXTURE_ON_LOAD )
+    if ( ( m_flags & IMAGE_CREATE_TEXTURE_ON_LOAD ) && !g_headless )
     {
         UploadToGpu();
     }
@@ -263,7 +265,10 @@ bool Image::Deserialize( char*& buffer )
             m_pixels = reinterpret_cast< unsigned char* >( buffer );
             buffer += totalSize;
         }
-        UploadToGpu();
+        if ( !g_headless )
+        {
+            UploadToGpu();
+        }
 
         if ( m_flags & IMAGE_FREE_CPU_COPY_ON_LOAD )
         {
@@ -333,41 +338,20 @@ bool Image::Save( const std::string& fname, bool flipVertically ) const
 
 void Image::UploadToGpu()
 {
-    auto& device  = g_renderState.device;
-    size_t imSize = CalculateTotalTextureSize( m_texture.m_desc );
-    Buffer stagingBuffer = device.NewBuffer( imSize, BUFFER_TYPE_TRANSFER_SRC, MEMORY_TYPE_HOST_VISIBLE | MEMORY_TYPE_HOST_COHERENT );
-    stagingBuffer.Map();
-    memcpy( stagingBuffer.MappedPtr(), m_pixels, imSize );
-    stagingBuffer.UnMap();
+    PG_MEMORY_TAG( Images );
+    PG_ASSERT( FormatSupported( PGToVulkanPixelFormat( m_texture.GetPixelFormat() ), VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT ) );
 
-    VkFormat vkFormat = PGToVulkanPixelFormat( m_texture.GetPixelFormat() );
-    PG_ASSERT( FormatSupported( vkFormat, VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT ) );
-
-    bool generateMips = (m_flags & IMAGE_GENERATE_MIPMAPS) && GetMipLevels() == 1;
+    // Compressed formats can't be blitted
+    bool generateMips = ( m_flags & IMAGE_GENERATE_MIPMAPS ) && GetMipLevels() == 1 && !Gfx::PixelFormatIsCompressed( GetPixelFormat() );
     if ( generateMips )
     {
         m_texture.m_desc.mipLevels = static_cast< uint32_t >( 1 + std::floor( std::log2( std::max( m_texture.m_desc.width, m_texture.m_desc.height ) ) ) );
     }
 
     bool isTex2D = m_texture.m_desc.arrayLayers == 1;
-    m_texture = device.NewTexture( m_texture.m_desc, isTex2D, name );
-    TransitionImageLayout( m_texture.GetHandle(), vkFormat, VK_IMAGE_LAYOUT_UNDEFINED,
-                           VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, m_texture.m_desc.mipLevels, m_texture.m_desc.arrayLayers );
-    
-    device.CopyBufferToImage( stagingBuffer, m_texture, !generateMips || Gfx::PixelFormatIsCompressed( GetPixelFormat() ) );
-
-    if ( generateMips )
-    {
-        m_texture.GenerateMipMaps();
-        //PG_ASSERT( ( m_flags & IMAGE_FREE_CPU_COPY_ON_LOAD ), "Mipmaps currently not copied back to the cpu yet" );
-    }
-    else
-    {
-        TransitionImageLayout( m_texture.GetHandle(), vkFormat, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                               VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, m_texture.m_desc.mipLevels, m_texture.m_desc.arrayLayers );
-    }
-
-    stagingBuffer.Free();
+    m_texture = g_renderState.device.NewTexture( m_texture.m_desc, isTex2D, name );
+    // Staged right away, so the pixels can be freed as soon as this returns
+    UploadManager::UploadTexture( m_texture, m_pixels, generateMips );
 }
 
 void Image::ReadToCpu()
@@ -4,8 +4,10 @@
 #include "assimp/scene.h"
 #include "core/assert.hpp"
 #include "core/math.hpp"
+#include "core/memory_manager.hpp"
 #include "core/time.hpp"
 #include "graphics/debug_marker.hpp"
+#include "graphics/upload_manager.hpp"
 #include "graphics/vulkan.hpp"
 #include "meshoptimizer/src/meshoptimizer.h"
 #include "resource/resource_manager.hpp"
@@ -709,6 +711,9 @@ namespace Progression
             serialize::Write( out, mesh.numIndices );
             serialize::Write( out, mesh.startVertex );
             serialize::Write( out, mesh.numVertices );
+            serialize::Write( out, mesh.aabb.min );
+            serialize::Write( out, mesh.aabb.max );
+            serialize::Write( out, mesh.aabb.extent );
         }
         skeleton.Serialize( out );
         size_t numAnimations = animations.size();
@@ -760,10 +765,12 @@ namespace Progression
             totalVertexSize += numUVs * sizeof( glm::vec2 );
             totalVertexSize += numBlendWeights * 2 * sizeof( glm::vec4 );
             totalVertexSize += numTangents * sizeof( glm::vec3 );
-            vertexBuffer = Gfx::g_renderState.device.NewBuffer( totalVertexSize, buffer, BUFFER_TYPE_VERTEX, MEMORY_TYPE_DEVICE_LOCAL, name + " VBO" );
-            buffer += totalVertexSize;
-            indexBuffer  = Gfx::g_renderState.device.NewBuffer( numIndices * sizeof( uint32_t ), buffer, BUFFER_TYPE_INDEX, MEMORY_TYPE_DEVICE_LOCAL, name + " IBO" );
-            buffer += numIndices * sizeof( uint32_t );
+            if ( !Gfx::g_headless )
+            {
+                vertexBuffer = Gfx::g_renderState.device.NewBuffer( totalVertexSize, buffer, BUFFER_TYPE_VERTEX, MEMORY_TYPE_DEVICE_LOCAL, name + " VBO" );
+                indexBuffer  = Gfx::g_renderState.device.NewBuffer( numIndices * sizeof( uint32_t ), buffer + totalVertexSize, BUFFER_TYPE_INDEX, MEMORY_TYPE_DEVICE_LOCAL, name + " IBO" );
+            }
+            buffer += totalVertexSize + numIndices * sizeof( uint32_t );
 
             m_numVertices       = numVertices;
             m_normalOffset      = m_numVertices * sizeof( glm::vec3 );
@@ -798,7 +805,7 @@ namespace Progression
             serialize::Read( buffer, blendWeights );
             serialize::Read( buffer, indices );
 
-            if ( createGpuCopy )
+            if ( createGpuCopy && !Gfx::g_headless )
             {
                 UploadToGpu();
             }
@@ -818,7 +825,11 @@ namespace Progression
             serialize::Read( buffer, mesh.numIndices );
             serialize::Read( buffer, mesh.startVertex );
             serialize::Read( buffer, mesh.numVertices );
+            serialize::Read( buffer, mesh.aabb.min );
+            serialize::Read( buffer, mesh.aabb.max );
+            serialize::Read( buffer, mesh.aabb.extent );
         }
+        PG_MEMORY_TAG( Animation );
         skeleton.Deserialize( buffer );
 
         size_t numAnimations;
@@ -879,6 +890,22 @@ namespace Progression
             aabb.max = glm::max( aabb.max, vertex );
         }
         aabb.extent = 0.5f * ( aabb.max - aabb.min );
+
+        for ( auto& mesh : meshes )
+        {
+            if ( mesh.numVertices == 0 )
+            {
+                mesh.aabb = aabb;
+                continue;
+            }
+            mesh.aabb.min = mesh.aabb.max = vertices[mesh.startVertex];
+            for ( uint32_t i = mesh.startVertex; i < mesh.startVertex + mesh.numVertices; ++i )
+            {
+                mesh.aabb.min = glm::min( mesh.aabb.min, vertices[i] );
+                mesh.aabb.max = glm::max( mesh.aabb.max, vertices[i] );
+            }
+            mesh.aabb.extent = 0.5f * ( mesh.aabb.max - mesh.aabb.min );
+        }
     }
 
     void Model::UploadToGpu()
@@ -893,8 +920,19 @@ namespace Progression
         {
             indexBuffer.Free();
         }
-        std::vector< float > vertexData( 3 * vertices.size() + 3 * normals.size() + 2 * uvs.size() + 8 * blendWeights.size() + 3 * tangents.size() );
-        char* dst = (char*) vertexData.data();
+        size_t numFloats = 3 * vertices.size() + 3 * normals.size() + 2 * uvs.size() + 8 * blendWeights.size() + 3 * tangents.size();
+        // skinned models are also read by the skinning compute shader
+        BufferType vertexBufferType = BUFFER_TYPE_VERTEX | BUFFER_TYPE_TRANSFER_DST;
+        if ( !blendWeights.empty() )
+        {
+            vertexBufferType |= BUFFER_TYPE_STORAGE;
+        }
+        vertexBuffer = Gfx::g_renderState.device.NewBuffer( numFloats * sizeof( float ), vertexBufferType, MEMORY_TYPE_DEVICE_LOCAL, name + " VBO" );
+        indexBuffer  = Gfx::g_renderState.device.NewBuffer( indices.size() * sizeof ( uint32_t ), BUFFER_TYPE_INDEX | BUFFER_TYPE_TRANSFER_DST, MEMORY_TYPE_DEVICE_LOCAL, name + " IBO" );
+
+        // The vertex streams are packed straight into the staging memory
+        Gfx::UploadManager::BufferUpload vertexUpload = Gfx::UploadManager::BeginBufferUpload( vertexBuffer, numFloats * sizeof( float ) );
+        char* dst = static_cast< char* >( vertexUpload.data );
         memcpy( dst, vertices.data(), vertices.size() * sizeof( glm::vec3 ) );
         dst += vertices.size() * sizeof( glm::vec3 );
         memcpy( dst, normals.data(), normals.size() * sizeof( glm::vec3 ) );
@@ -903,9 +941,9 @@ namespace Progression
         dst += uvs.size() * sizeof( glm::vec2 );
         memcpy( dst, blendWeights.data(), blendWeights.size() * 2 * sizeof( glm::vec4 ) );
         dst += blendWeights.size() * 2 * sizeof( glm::vec4 );
-        memcpy( dst, blendWeights.data(), tangents.size() * sizeof( glm::vec3 ) );
-        vertexBuffer = Gfx::g_renderState.device.NewBuffer( vertexData.size() * sizeof( float ), vertexData.data(), BUFFER_TYPE_VERTEX, MEMORY_TYPE_DEVICE_LOCAL, name + " VBO" );
-        indexBuffer  = Gfx::g_renderState.device.NewBuffer( indices.size() * sizeof ( uint32_t ), indices.data(), BUFFER_TYPE_INDEX, MEMORY_TYPE_DEVICE_LOCAL, name + " IBO" );
+        memcpy( dst, tangents.data(), tangents.size() * sizeof( glm::vec3 ) );
+        Gfx::UploadManager::CommitBufferUpload( vertexUpload );
+        Gfx::UploadManager::UploadBuffer( indexBuffer, indices.data(), indices.size() * sizeof( uint32_t ) );
 
         m_numVertices       = static_cast< uint32_t >( vertices.size() );
         m_normalOffset      = m_numVertices * sizeof( glm::vec3 );
@@ -962,7 +1000,8 @@ namespace Progression
             return;
         }
 
-        std::vector< Vertex > interleavedVerts;
+        MemoryManager::ScratchScope scratch;
+        MemoryManager::ArenaVector< Vertex > interleavedVerts( scratch.Arena() );
         interleavedVerts.reserve( vertices.size() );
         bool hasNormals      = !normals.empty();
         bool hasUVs          = !uvs.empty();
@@ -999,7 +1038,9 @@ namespace Progression
 
         for ( auto& mesh : meshes )
         {
-            std::vector< Vertex > optVertices;
+            MemoryManager::ScratchScope meshScratch;
+            MemoryManager::ArenaVector< Vertex > optVertices( meshScratch.Arena() );
+            optVertices.reserve( mesh.numVertices );
             for ( size_t idx = 0; idx < mesh.numVertices; ++idx )
             {
                 optVertices.push_back( interleavedVerts[mesh.startVertex + idx] );
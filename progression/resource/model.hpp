@@ -59,6 +59,7 @@ namespace Progression
         uint32_t numIndices  = 0;
         uint32_t startVertex = 0;
         uint32_t numVertices = 0;
+        AABB aabb; // model space, for culling the meshes one by one
     };
 
     struct Skeleton
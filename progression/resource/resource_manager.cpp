@@ -1,5 +1,6 @@
 #include "core/feature_defines.hpp"
 #include "core/assert.hpp"
+#include "core/cpu_profiling.hpp"
 #include "core/time.hpp"
 #include "core/window.hpp"
 #include "lz4/lz4.h"
@@ -11,6 +12,7 @@
 #include "resource/resource_version_numbers.hpp"
 #include "resource/script.hpp"
 #include "resource/shader.hpp"
+#include "utils/binary_log.hpp"
 #include "utils/logger.hpp"
 #include "utils/serialize.hpp"
 #include "utils/type_name.hpp"
@@ -26,10 +28,12 @@ namespace ResourceManager
 {
 
     ResourceDB f_resources = {};
+    static std::vector< FastfileLoadStats > s_fastfileLoadStats;
 
     void Init()
     {
         f_resources.Clear();
+        s_fastfileLoadStats.clear();
         auto defaultMat                                         = std::make_shared< Material >();
         defaultMat->Kd                                          = glm::vec3( 1, 1, 0 );
         f_resources[GetResourceTypeID< Material >()]["default"] = defaultMat;
@@ -56,6 +60,9 @@ namespace ResourceManager
             }
         }
         ResourceMap& resources = f_resources[GetResourceTypeID< ResourceType >()];
+        const auto typeName    = type_name< ResourceType >();
+        PG_MAYBE_UNUSED( typeName );
+        MemoryManager::ScopedMemoryTag memoryTag( GetResourceMemoryTag< ResourceType >() );
         for ( uint32_t i = 0; i < numRes; ++i )
         {
             auto res = std::make_shared< ResourceType >();
@@ -64,6 +71,7 @@ namespace ResourceManager
                 LOG_ERR( "Failed to load type from fastfile" );
                 return false;
             }
+            LOG_FAST( "Deserialized {} '{}'", std::string_view( typeName.data(), typeName.size() ), res->name );
             if ( resources.find( res->name ) != resources.end() )
             {
                 LOG_WARN( "Resource of type '", type_name< ResourceType >(), "' and name '", res->name, "' is already in resource manager, overwritting" );
@@ -103,6 +111,7 @@ namespace ResourceManager
 
     bool LoadFastFile( std::string fname, bool runConverterIfEnabled )
     {
+        PG_PROFILE_SCOPE( "LoadFastFile" );
 #if USING( DEBUG_BUILD )
         fname += "d";
 #endif // #if USING( DEBUG_BUILD )
@@ -179,8 +188,9 @@ namespace ResourceManager
         success = success && DeserializeResources< Model >( data, PG_RESOURCE_MODEL_VERSION );
         success = success && DeserializeResources< Script >( data, PG_RESOURCE_SCRIPT_VERSION );
 
-        PG_MAYBE_UNUSED( start );
-        LOG( "Loaded fastfile '", fname, "' in: ", Time::GetDuration( start ), " ms." );
+        double loadTime = Time::GetDuration( start );
+        s_fastfileLoadStats.push_back( { fname, loadTime } );
+        LOG_FAST( "Fastfile '{}' success: {}, {} ms", fname, success, loadTime );
 
 #if USING( LZ4_COMPRESSED_FASTFILES )
         free( uncompressedStartPtr );
@@ -189,5 +199,10 @@ namespace ResourceManager
         return true;
     }
 
+    const std::vector< FastfileLoadStats >& GetFastfileLoadStats()
+    {
+        return s_fastfileLoadStats;
+    }
+
 } // namespace ResourceManager
 } // namespace Progression
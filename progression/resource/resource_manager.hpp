@@ -1,5 +1,6 @@
 #pragma once
 
+#include "core/memory_manager.hpp"
 #include "resource/resource.hpp"
 #include <memory>
 #include <unordered_map>
@@ -28,6 +29,12 @@ uint32_t GetResourceTypeID()
 namespace Progression
 {
 
+class Image;
+class Material;
+class Model;
+class Script;
+class Shader;
+
 enum ResourceTypes
 {
     SHADER = 0,
@@ -73,10 +80,19 @@ namespace ResourceManager
 
     extern ResourceDB f_resources;
 
+    struct FastfileLoadStats
+    {
+        std::string filename;
+        double milliseconds;
+    };
+
     void Init();
     bool LoadFastFile( std::string fname, bool runConverterIfEnabled = true );
     void Shutdown();
 
+    // Every fastfile loaded since Init, in load order
+    const std::vector< FastfileLoadStats >& GetFastfileLoadStats();
+
     template < typename T >
     std::shared_ptr< T > Get( const std::string& name )
     {
@@ -87,6 +103,36 @@ namespace ResourceManager
         return it == group.end() ? nullptr : std::dynamic_pointer_cast< T >( it->second );
     }
 
+    // Everything a resource allocates while loading, including its GPU copy, is accounted under this
+    template < typename T >
+    MemoryManager::MemoryTag GetResourceMemoryTag()
+    {
+        if constexpr ( std::is_same< T, Image >::value )
+        {
+            return MemoryManager::MemoryTag::Images;
+        }
+        else if constexpr ( std::is_same< T, Material >::value )
+        {
+            return MemoryManager::MemoryTag::Materials;
+        }
+        else if constexpr ( std::is_same< T, Model >::value )
+        {
+            return MemoryManager::MemoryTag::Models;
+        }
+        else if constexpr ( std::is_same< T, Script >::value )
+        {
+            return MemoryManager::MemoryTag::Scripts;
+        }
+        else if constexpr ( std::is_same< T, Shader >::value )
+        {
+            return MemoryManager::MemoryTag::Shaders;
+        }
+        else
+        {
+            return MemoryManager::MemoryTag::General;
+        }
+    }
+
     template < typename T >
     std::shared_ptr< T > LoadInternal( ResourceCreateInfo* createInfo )
     {
@@ -99,6 +145,7 @@ namespace ResourceManager
             return currentResPtr;
         }
 
+        MemoryManager::ScopedMemoryTag memoryTag( GetResourceMemoryTag< T >() );
         auto resourcePtr  = std::make_shared< T >();
         resourcePtr->name = createInfo->name;
         if ( !resourcePtr->Load( createInfo ) )
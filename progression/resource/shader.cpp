@@ -150,16 +150,19 @@ namespace Progression
         size_t spirvSize;
         serialize::Read( buffer, spirvSize );
 
-        VkShaderModuleCreateInfo vkShaderInfo = {};
-        vkShaderInfo.sType    = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-        vkShaderInfo.codeSize = spirvSize;
-        vkShaderInfo.pCode    = reinterpret_cast< const uint32_t* >( buffer );
-        VkResult ret = vkCreateShaderModule( Gfx::g_renderState.device.GetHandle(), &vkShaderInfo, nullptr, &m_shaderModule );
-        if ( ret != VK_SUCCESS )
+        if ( !Gfx::g_headless )
         {
-            return false;
+            VkShaderModuleCreateInfo vkShaderInfo = {};
+            vkShaderInfo.sType    = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+            vkShaderInfo.codeSize = spirvSize;
+            vkShaderInfo.pCode    = reinterpret_cast< const uint32_t* >( buffer );
+            VkResult ret = vkCreateShaderModule( Gfx::g_renderState.device.GetHandle(), &vkShaderInfo, nullptr, &m_shaderModule );
+            if ( ret != VK_SUCCESS )
+            {
+                return false;
+            }
+            PG_DEBUG_MARKER_SET_SHADER_NAME( (*this), name );
         }
-        PG_DEBUG_MARKER_SET_SHADER_NAME( (*this), name );
         buffer += spirvSize;
 
         return true;
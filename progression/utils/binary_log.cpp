@@ -0,0 +1,182 @@
+#include "utils/binary_log.hpp"
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+// Size a thread's buffer can reach before it gets written to the file
+#define BINARY_LOG_THREAD_BUFFER_SIZE ( 64 * 1024 )
+
+namespace BinaryLog
+{
+
+static FILE* s_file = nullptr;
+static std::atomic< bool > s_open = { false };
+static std::mutex s_fileLock;
+static std::atomic< uint32_t > s_nextFormatID  = { 1 };
+static std::atomic< uint32_t > s_nextThreadID  = { 0 };
+static std::chrono::steady_clock::time_point s_startTime;
+
+// Every format registered so far. The call sites keep their IDs across Shutdown and Init, so
+// each new file needs all of them written again
+struct Format
+{
+    uint32_t id;
+    uint32_t line;
+    const char* file;
+    const char* format;
+    std::vector< ArgType > argTypes;
+};
+static std::vector< Format > s_formats;
+
+static void WriteString( FILE* file, const char* str )
+{
+    uint32_t len = static_cast< uint32_t >( strlen( str ) );
+    fwrite( &len, sizeof( len ), 1, file );
+    fwrite( str, 1, len, file );
+}
+
+static void WriteFormat( FILE* file, const Format& format )
+{
+    RecordType type = RecordType::FORMAT;
+    uint8_t numArgs = static_cast< uint8_t >( format.argTypes.size() );
+    fwrite( &type, sizeof( type ), 1, file );
+    fwrite( &format.id, sizeof( format.id ), 1, file );
+    fwrite( &format.line, sizeof( format.line ), 1, file );
+    fwrite( &numArgs, sizeof( numArgs ), 1, file );
+    fwrite( format.argTypes.data(), sizeof( ArgType ), numArgs, file );
+    WriteString( file, format.file );
+    WriteString( file, format.format );
+}
+
+struct ThreadBuffer
+{
+    ThreadBuffer() : threadID( s_nextThreadID.fetch_add( 1, std::memory_order_relaxed ) )
+    {
+        data.reserve( BINARY_LOG_THREAD_BUFFER_SIZE );
+    }
+
+    ~ThreadBuffer()
+    {
+        Flush();
+    }
+
+    void Flush()
+    {
+        if ( data.empty() )
+        {
+            return;
+        }
+
+        std::lock_guard< std::mutex > lock( s_fileLock );
+        if ( s_file )
+        {
+            RecordType type   = RecordType::CHUNK;
+            uint32_t numBytes = static_cast< uint32_t >( data.size() );
+            fwrite( &type, sizeof( type ), 1, s_file );
+            fwrite( &threadID, sizeof( threadID ), 1, s_file );
+            fwrite( &numBytes, sizeof( numBytes ), 1, s_file );
+            fwrite( data.data(), 1, data.size(), s_file );
+        }
+        data.clear();
+    }
+
+    uint32_t threadID;
+    std::vector< char > data;
+};
+
+static ThreadBuffer& GetThreadBuffer()
+{
+    static thread_local ThreadBuffer buffer;
+    return buffer;
+}
+
+bool Init( const std::string& filename )
+{
+    std::lock_guard< std::mutex > lock( s_fileLock );
+    s_file = fopen( filename.c_str(), "wb" );
+    if ( !s_file )
+    {
+        return false;
+    }
+
+    s_startTime = std::chrono::steady_clock::now();
+    FileHeader header;
+    header.magicNumber = MAGIC_NUMBER;
+    header.version     = VERSION;
+    header.startTimeNs = std::chrono::duration_cast< std::chrono::nanoseconds >( std::chrono::system_clock::now().time_since_epoch() ).count();
+    fwrite( &header, sizeof( header ), 1, s_file );
+    for ( const Format& format : s_formats )
+    {
+        WriteFormat( s_file, format );
+    }
+    s_open = true;
+
+    return true;
+}
+
+void Shutdown()
+{
+    if ( !s_open )
+    {
+        return;
+    }
+
+    // Other threads flush their buffers when they exit, which should have already happened by now
+    FlushThread();
+    s_open = false;
+    std::lock_guard< std::mutex > lock( s_fileLock );
+    fclose( s_file );
+    s_file = nullptr;
+}
+
+void FlushThread()
+{
+    GetThreadBuffer().Flush();
+}
+
+uint32_t RegisterFormat( FormatSite& site, const char* file, int line, const char* format, const ArgType* argTypes, uint8_t numArgs )
+{
+    std::lock_guard< std::mutex > lock( s_fileLock );
+    // Another thread could have registered it while this one was waiting on the lock
+    uint32_t id = site.id.load( std::memory_order_acquire );
+    if ( id != 0 )
+    {
+        return id;
+    }
+
+    id = s_nextFormatID.fetch_add( 1, std::memory_order_relaxed );
+    s_formats.push_back( { id, static_cast< uint32_t >( line ), file, format, std::vector< ArgType >( argTypes, argTypes + numArgs ) } );
+    if ( s_file )
+    {
+        WriteFormat( s_file, s_formats.back() );
+    }
+    site.id.store( id, std::memory_order_release );
+
+    return id;
+}
+
+bool IsOpen()
+{
+    return s_open.load( std::memory_order_relaxed );
+}
+
+char* Reserve( uint32_t numBytes )
+{
+    ThreadBuffer& buffer = GetThreadBuffer();
+    if ( buffer.data.size() + numBytes > BINARY_LOG_THREAD_BUFFER_SIZE )
+    {
+        buffer.Flush();
+    }
+    size_t offset = buffer.data.size();
+    buffer.data.resize( offset + numBytes );
+
+    return buffer.data.data() + offset;
+}
+
+uint64_t NanosecondsSinceInit()
+{
+    return std::chrono::duration_cast< std::chrono::nanoseconds >( std::chrono::steady_clock::now() - s_startTime ).count();
+}
+
+} // namespace BinaryLog
@@ -0,0 +1,175 @@
+#pragma once
+
+#include "core/platform_defines.hpp"
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+// Near zero cost logging for hot paths. Instead of formatting text, LOG_FAST appends the call site's
+// format ID, a timestamp, and the raw bytes of each argument to a per thread buffer, which gets
+// written to the binary log file once it fills up. Use tools/logdecode to turn the file back into
+// text or JSON. The format string uses {} for each argument, and the arguments can be integers,
+// floats, bools and strings:
+//     LOG_FAST( "Loaded model {} with {} vertices in {} ms", model->name, numVerts, ms );
+
+#if USING( SHIP_BUILD )
+
+#define LOG_FAST( ... ) do {} while(0)
+
+#else // #if USING( SHIP_BUILD )
+
+#define LOG_FAST( ... )                                                                          \
+do                                                                                               \
+{                                                                                                \
+    static BinaryLog::FormatSite _pgLogFastSite;                                                 \
+    BinaryLog::Write( _pgLogFastSite, __FILE__, __LINE__, __VA_ARGS__ );                         \
+} while ( 0 )
+
+#endif // #else // #if USING( SHIP_BUILD )
+
+namespace BinaryLog
+{
+
+    // Layout of the file:
+    //   FileHeader
+    //   records, each starting with a RecordType byte:
+    //     FORMAT:  uint32 formatID, uint32 line, uint8 numArgs, ArgType[numArgs], string file, string format
+    //     CHUNK:   uint32 threadID, uint32 numBytes, then numBytes of messages from that thread:
+    //                  uint32 formatID, uint64 nanoseconds since Init, each argument's bytes
+    //   where strings are a uint32 length followed by the characters
+    // A format record is always written before any chunk that uses it.
+    constexpr uint32_t MAGIC_NUMBER = 0x474C4750; // "PGLG"
+    constexpr uint32_t VERSION      = 1;
+
+    struct FileHeader
+    {
+        uint32_t magicNumber;
+        uint32_t version;
+        uint64_t startTimeNs; // system clock time of Init, nanoseconds since the epoch
+    };
+
+    enum class RecordType : uint8_t
+    {
+        FORMAT = 0,
+        CHUNK  = 1,
+    };
+
+    enum class ArgType : uint8_t
+    {
+        INT32  = 0,
+        UINT32 = 1,
+        INT64  = 2,
+        UINT64 = 3,
+        FLOAT  = 4,
+        DOUBLE = 5,
+        BOOL   = 6,
+        STRING = 7,
+    };
+
+    // One per LOG_FAST call site. The ID is assigned, and the format written to the file, the first
+    // time the call site is hit. Init writes the formats of every site hit so far into the new file
+    struct FormatSite
+    {
+        std::atomic< uint32_t > id = { 0 }; // 0 = not registered yet
+    };
+
+    bool Init( const std::string& filename );
+    void Shutdown();
+
+    // Writes out the calling thread's buffer. Buffers are also written when they fill up, and when their thread exits
+    void FlushThread();
+
+    uint32_t RegisterFormat( FormatSite& site, const char* file, int line, const char* format, const ArgType* argTypes, uint8_t numArgs );
+    bool IsOpen();
+
+    // Returns where the next numBytes of the current message go, flushing the thread's buffer first if needed.
+    // The bytes are part of the thread's buffer as soon as they are written
+    char* Reserve( uint32_t numBytes );
+    uint64_t NanosecondsSinceInit();
+
+    template < typename T >
+    constexpr ArgType GetArgType()
+    {
+        using U = std::decay_t< T >;
+        if constexpr ( std::is_same_v< U, bool > ) return ArgType::BOOL;
+        else if constexpr ( std::is_same_v< U, float > ) return ArgType::FLOAT;
+        else if constexpr ( std::is_same_v< U, double > ) return ArgType::DOUBLE;
+        else if constexpr ( std::is_integral_v< U > && std::is_signed_v< U > && sizeof( U ) <= 4 ) return ArgType::INT32;
+        else if constexpr ( std::is_integral_v< U > && sizeof( U ) <= 4 ) return ArgType::UINT32;
+        else if constexpr ( std::is_integral_v< U > && std::is_signed_v< U > ) return ArgType::INT64;
+        else if constexpr ( std::is_integral_v< U > ) return ArgType::UINT64;
+        else if constexpr ( std::is_enum_v< U > ) return sizeof( U ) <= 4 ? ArgType::INT32 : ArgType::INT64;
+        else
+        {
+            static_assert( std::is_convertible_v< U, std::string_view >, "LOG_FAST only supports integers, floats, bools, and strings" );
+            return ArgType::STRING;
+        }
+    }
+
+    template < typename T >
+    uint32_t ArgSize( const T& arg )
+    {
+        constexpr ArgType type = GetArgType< T >();
+        if constexpr ( type == ArgType::STRING ) return 4 + static_cast< uint32_t >( std::string_view( arg ).size() );
+        else if constexpr ( type == ArgType::BOOL ) return 1;
+        else if constexpr ( type == ArgType::INT32 || type == ArgType::UINT32 || type == ArgType::FLOAT ) return 4;
+        else return 8;
+    }
+
+    template < typename T >
+    void WriteArg( char*& dst, const T& arg )
+    {
+        constexpr ArgType type = GetArgType< T >();
+        if constexpr ( type == ArgType::STRING )
+        {
+            std::string_view str( arg );
+            uint32_t len = static_cast< uint32_t >( str.size() );
+            memcpy( dst, &len, 4 );
+            memcpy( dst + 4, str.data(), len );
+            dst += 4 + len;
+        }
+        else if constexpr ( type == ArgType::BOOL )
+        {
+            *dst++ = arg ? 1 : 0;
+        }
+        else
+        {
+            using Stored = std::conditional_t< type == ArgType::INT32, int32_t,
+                           std::conditional_t< type == ArgType::UINT32, uint32_t,
+                           std::conditional_t< type == ArgType::INT64, int64_t,
+                           std::conditional_t< type == ArgType::UINT64, uint64_t, T > > > >;
+            Stored value = static_cast< Stored >( arg );
+            memcpy( dst, &value, sizeof( Stored ) );
+            dst += sizeof( Stored );
+        }
+    }
+
+    template < typename... Args >
+    void Write( FormatSite& site, const char* file, int line, const char* format, const Args&... args )
+    {
+        if ( !IsOpen() )
+        {
+            return;
+        }
+
+        uint32_t id = site.id.load( std::memory_order_acquire );
+        if ( id == 0 )
+        {
+            constexpr uint8_t numArgs = static_cast< uint8_t >( sizeof...( Args ) );
+            const ArgType argTypes[numArgs + 1] = { GetArgType< Args >()... };
+            id = RegisterFormat( site, file, line, format, argTypes, numArgs );
+        }
+
+        uint32_t numBytes = 4 + 8 + ( 0 + ... + ArgSize( args ) );
+        char* dst         = Reserve( numBytes );
+        uint64_t time     = NanosecondsSinceInit();
+        memcpy( dst, &id, 4 );
+        memcpy( dst + 4, &time, 8 );
+        dst += 12;
+        ( WriteArg( dst, args ), ... );
+    }
+
+} // namespace BinaryLog
@@ -1,9 +1,29 @@
 #include "utils/logger.hpp"
 #include "core/unused.hpp"
+#include <chrono>
+#include <cstdint>
 #include <filesystem>
+#include <iomanip>
+
+// How long the writer thread sleeps when there is nothing to write. Errors wake it up immediately
+#define LOG_WRITER_SLEEP_MS 5
+
+static std::chrono::steady_clock::time_point s_startTime = std::chrono::steady_clock::now();
+static std::atomic< uint32_t > s_nextThreadID = { 0 };
 
 Logger g_Logger;
 
+static uint32_t GetLoggingThreadID()
+{
+    static thread_local uint32_t threadID = s_nextThreadID.fetch_add( 1, std::memory_order_relaxed );
+    return threadID;
+}
+
+static double SecondsSinceStart()
+{
+    return std::chrono::duration< double >( std::chrono::steady_clock::now() - s_startTime ).count();
+}
+
 PrintModifier::PrintModifier( Color c, Emphasis e ) :
     color( c ),
     emphasis( e )
@@ -15,6 +35,11 @@ std::ostream& operator<<( std::ostream& out, const PrintModifier& mod )
     return out << "\033[" << mod.emphasis << ";" << mod.color << "m";
 }
 
+Logger::~Logger()
+{
+    Shutdown();
+}
+
 void Logger::Init( const std::string& filename, bool useColors )
 {
     PG_MAYBE_UNUSED( filename );
@@ -27,13 +52,257 @@ void Logger::Init( const std::string& filename, bool useColors )
     {
         AddLocation( "configFileOutput", filename );
     }
-    
+
+    m_ring.reset( new Message[LOG_RING_BUFFER_SIZE] );
+    for ( size_t i = 0; i < LOG_RING_BUFFER_SIZE; ++i )
+    {
+        m_ring[i].sequence.store( i, std::memory_order_relaxed );
+    }
+    m_enqueuePos         = 0;
+    m_dequeuePos         = 0;
+    m_numDropped         = 0;
+    m_numDroppedReported = 0;
+    m_stopRequested      = false;
+    m_running            = true;
+    m_writerThread       = std::thread( &Logger::WriterThreadMain, this );
 #endif // #if !USING( SHIP_BUILD )
 }
 
 void Logger::Shutdown()
 {
-#if !USING( SHIP_BUILD )
+    if ( m_running.exchange( false ) )
+    {
+        // New messages get written immediately from here on. The ones already on their way into the ring
+        // have to land before the writer thread finishes the rest, and before the ring goes away
+        while ( m_numWriters.load( std::memory_order_acquire ) != 0 )
+        {
+            std::this_thread::yield();
+        }
+        {
+            std::lock_guard< std::mutex > lock( m_wakeLock );
+            m_stopRequested = true;
+        }
+        m_wakeCondition.notify_one();
+        m_writerThread.join();
+        m_ring.reset();
+    }
+
+    std::lock_guard< std::mutex > lock( m_outputLock );
     outputs.clear();
-#endif // #if !USING( SHIP_BUILD )
+}
+
+void Logger::Flush()
+{
+    if ( !m_running )
+    {
+        return;
+    }
+
+    size_t target = m_enqueuePos.load( std::memory_order_acquire );
+    m_wakeCondition.notify_one();
+    while ( m_dequeuePos.load( std::memory_order_acquire ) < target )
+    {
+        std::this_thread::yield();
+    }
+}
+
+void Logger::AddLocation( const std::string& name, std::ostream* output, bool useColors, bool isFile )
+{
+    std::lock_guard< std::mutex > lock( m_outputLock );
+    outputs.emplace_back( std::make_unique< LoggerOutputLocation >( name, output, useColors, isFile ) );
+}
+
+void Logger::AddLocation( const std::string& name, const std::string& filename )
+{
+    auto location = std::make_unique< LoggerOutputLocation >( name, filename );
+    if ( !location->output || !static_cast< std::ofstream* >( location->output )->is_open() )
+    {
+        std::cout << "Failed to open logging location '" << filename << "'" << std::endl;
+        return;
+    }
+
+    std::lock_guard< std::mutex > lock( m_outputLock );
+    outputs.emplace_back( std::move( location ) );
+}
+
+void Logger::RemoveLocation( const std::string& name )
+{
+    std::lock_guard< std::mutex > lock( m_outputLock );
+    for ( size_t i = 0; i < outputs.size(); ++i )
+    {
+        if ( name == outputs[i]->name )
+        {
+            outputs.erase( outputs.begin() + i );
+            return;
+        }
+    }
+}
+
+void Logger::SetLocationColored( const std::string& name, bool colored )
+{
+    std::lock_guard< std::mutex > lock( m_outputLock );
+    for ( auto& output : outputs )
+    {
+        if ( output->name == name )
+        {
+            output->colored = colored;
+        }
+    }
+}
+
+Logger::Message* Logger::BeginMessage( Severity sev )
+{
+    size_t pos = m_enqueuePos.load( std::memory_order_relaxed );
+    for ( ;; )
+    {
+        Message& msg  = m_ring[pos & ( LOG_RING_BUFFER_SIZE - 1 )];
+        size_t seq    = msg.sequence.load( std::memory_order_acquire );
+        intptr_t diff = static_cast< intptr_t >( seq ) - static_cast< intptr_t >( pos );
+        if ( diff == 0 )
+        {
+            if ( m_enqueuePos.compare_exchange_weak( pos, pos + 1, std::memory_order_relaxed ) )
+            {
+                msg.position  = pos;
+                msg.severity  = sev;
+                msg.threadID  = GetLoggingThreadID();
+                msg.timestamp = SecondsSinceStart();
+                return &msg;
+            }
+        }
+        else if ( diff < 0 )
+        {
+            // Full. Debug messages aren't worth stalling the caller for, but warnings and errors are
+            if ( sev == DEBUG )
+            {
+                m_numDropped.fetch_add( 1, std::memory_order_relaxed );
+                return nullptr;
+            }
+            m_wakeCondition.notify_one();
+            std::this_thread::yield();
+            pos = m_enqueuePos.load( std::memory_order_relaxed );
+        }
+        else
+        {
+            pos = m_enqueuePos.load( std::memory_order_relaxed );
+        }
+    }
+}
+
+void Logger::CommitMessage( Message* msg )
+{
+    // The slot can be consumed and reused as soon as the sequence is stored, so don't touch it after
+    Severity sev = msg->severity;
+    msg->sequence.store( msg->position + 1, std::memory_order_release );
+    if ( sev == ERR )
+    {
+        m_wakeCondition.notify_one();
+    }
+}
+
+void Logger::AppendMessage( Severity sev, uint32_t threadID, double timestamp, const std::function< void( std::ostream& ) >& format )
+{
+    const char* severity = "";
+    PrintModifier mod( PrintModifier::GREEN, PrintModifier::NONE );
+    if ( sev == WARN )
+    {
+        severity = "WARNING  ";
+        mod      = PrintModifier( PrintModifier::YELLOW, PrintModifier::NONE );
+    }
+    else if ( sev == ERR )
+    {
+        severity = "ERROR    ";
+        mod      = PrintModifier( PrintModifier::RED, PrintModifier::NONE );
+    }
+
+    std::ostringstream prefixStream;
+    prefixStream << "[" << std::fixed << std::setprecision( 3 ) << std::setw( 9 ) << timestamp << "][T" << threadID << "] ";
+    std::string prefix = prefixStream.str();
+    std::ostringstream textStream;
+    format( textStream );
+    std::string text = textStream.str();
+
+    for ( auto& output : outputs )
+    {
+        if ( output->colored )
+        {
+            std::ostringstream colored;
+            colored << mod << prefix << severity << text << "\033[0m\n";
+            output->pending += colored.str();
+        }
+        else
+        {
+            output->pending += prefix + severity + text + "\n";
+        }
+    }
+}
+
+void Logger::WritePending()
+{
+    for ( auto& output : outputs )
+    {
+        if ( !output->pending.empty() )
+        {
+            output->output->write( output->pending.data(), output->pending.size() );
+            output->output->flush();
+            output->pending.clear();
+        }
+    }
+}
+
+void Logger::WriteImmediately( Severity sev, const std::function< void( std::ostream& ) >& format )
+{
+    std::lock_guard< std::mutex > lock( m_outputLock );
+    AppendMessage( sev, GetLoggingThreadID(), SecondsSinceStart(), format );
+    WritePending();
+}
+
+// Formats everything currently in the ring buffer and writes it out in one batch per output.
+// Returns true if there was anything to write
+bool Logger::DrainMessages()
+{
+    std::lock_guard< std::mutex > lock( m_outputLock );
+    size_t pos   = m_dequeuePos.load( std::memory_order_relaxed );
+    size_t start = pos;
+    for ( ;; )
+    {
+        Message& msg = m_ring[pos & ( LOG_RING_BUFFER_SIZE - 1 )];
+        if ( msg.sequence.load( std::memory_order_acquire ) != pos + 1 )
+        {
+            break;
+        }
+
+        AppendMessage( msg.severity, msg.threadID, msg.timestamp, [&msg]( std::ostream& out ) { msg.format( out, msg.payload ); } );
+        msg.destroy( msg.payload );
+        msg.sequence.store( pos + LOG_RING_BUFFER_SIZE, std::memory_order_release );
+        ++pos;
+        m_dequeuePos.store( pos, std::memory_order_release );
+    }
+
+    uint64_t numDropped = m_numDropped.load( std::memory_order_relaxed );
+    if ( numDropped != m_numDroppedReported )
+    {
+        uint64_t newlyDropped = numDropped - m_numDroppedReported;
+        m_numDroppedReported  = numDropped;
+        AppendMessage( WARN, GetLoggingThreadID(), SecondsSinceStart(), [newlyDropped]( std::ostream& out )
+        {
+            out << "Logger buffer was full, dropped " << newlyDropped << " messages";
+        });
+    }
+
+    WritePending();
+
+    return pos != start;
+}
+
+void Logger::WriterThreadMain()
+{
+    while ( !m_stopRequested )
+    {
+        if ( !DrainMessages() )
+        {
+            std::unique_lock< std::mutex > lock( m_wakeLock );
+            m_wakeCondition.wait_for( lock, std::chrono::milliseconds( LOG_WRITER_SLEEP_MS ), [this]() { return m_stopRequested.load(); } );
+        }
+    }
+    DrainMessages();
 }
@@ -1,10 +1,19 @@
 #pragma once
 
 #include "core/platform_defines.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
 #include <fstream>
+#include <functional>
 #include <iostream>
+#include <memory>
 #include <mutex>
+#include <sstream>
 #include <string>
+#include <thread>
+#include <tuple>
+#include <type_traits>
 #include <vector>
 
 #if USING( SHIP_BUILD )
@@ -21,6 +30,11 @@
 
 #endif // #else // #if USING( SHIP_BUILD )
 
+// Number of messages the ring buffer can hold before messages start getting dropped, must be a power of 2
+#define LOG_RING_BUFFER_SIZE 4096
+// Bytes available to store a message's arguments. Messages with bigger arguments get formatted by the caller instead
+#define LOG_PAYLOAD_SIZE 200
+
 class PrintModifier
 {
 public:
@@ -75,12 +89,28 @@ public:
         }
     }
 
+    LoggerOutputLocation( const LoggerOutputLocation& ) = delete;
+    LoggerOutputLocation& operator=( const LoggerOutputLocation& ) = delete;
+
     std::string name;
     std::ostream* output;
     bool colored;
     bool isFile;
+    std::string pending; // formatted text waiting for the next batched write
 };
 
+// How Logger::Write stores each argument until the writer thread formats it. Pointers to strings could
+// be gone by then, so those are copied
+template < typename T > struct CapturedArg { using type = T; };
+template < > struct CapturedArg< const char* > { using type = std::string; };
+template < > struct CapturedArg< char* > { using type = std::string; };
+
+// Asynchronous logger. Write captures the arguments by value into a slot of a lock free ring buffer
+// (multiple producers, single consumer), and a background thread does all of the formatting and
+// the I/O in batches. If the buffer is full, DEBUG messages are dropped (and counted), while
+// warnings and errors wait for space. Before Init and after Shutdown, messages are written immediately.
+// Writers count themselves as in flight before checking that the logger is running, so Shutdown can
+// close the gate and wait for them to leave before the ring buffer is freed.
 class Logger
 {
 public:
@@ -92,110 +122,104 @@ public:
     };
 
     Logger() = default;
+    ~Logger();
 
     void Init( const std::string& filename = "", bool useColors = true );
     void Shutdown();
 
-    void AddLocation( const std::string& name, std::ostream* output, bool useColors = true, bool isFile = false )
-    {
-        outputs.emplace_back( name, output, useColors, isFile );
-    }
+    // Blocks until every message logged before this call has been written out
+    void Flush();
 
-    void AddLocation( const std::string& name, const std::string& filename )
-    {
-        outputs.emplace_back( name, filename );
-        if ( !outputs[outputs.size() - 1].output || !( ( std::ofstream*) outputs[outputs.size() - 1].output )->is_open() )
-        {
-            outputs.pop_back();
-            std::cout << "Failed to open logging location '" << filename << "'" << std::endl;
-        }
-    }
+    void AddLocation( const std::string& name, std::ostream* output, bool useColors = true, bool isFile = false );
+    void AddLocation( const std::string& name, const std::string& filename );
+    void RemoveLocation( const std::string& name );
+    void SetLocationColored( const std::string& name, bool colored );
+
+    uint64_t NumDroppedMessages() const { return m_numDropped.load( std::memory_order_relaxed ); }
 
-    LoggerOutputLocation* GetLocation( const std::string& name )
+    template < typename... Args >
+    void Write( Severity sev, Args&&... args )
     {
-        for ( auto& output : outputs )
+        using Payload = std::tuple< typename CapturedArg< std::decay_t< Args > >::type... >;
+        if constexpr ( sizeof( Payload ) <= LOG_PAYLOAD_SIZE && alignof( Payload ) <= alignof( std::max_align_t ) )
         {
-            if ( output.name == name )
+            if ( !EnterWrite() )
             {
-                return &output;
+                WriteImmediately( sev, [&]( std::ostream& out ) { ( out << ... << args ); } );
+                return;
             }
-        }
-
-        return nullptr;
-    }
 
-    void RemoveLocation( const std::string& name )
-    {
-        size_t index = -1;
-        for ( size_t i = 0; i < outputs.size(); ++i )
-        {
-            if ( name == outputs[i].name )
+            Message* msg = BeginMessage( sev );
+            if ( msg )
             {
-                index = i;
-                break;
+                new ( msg->payload ) Payload( std::forward< Args >( args )... );
+                msg->format  = []( std::ostream& out, void* payload )
+                {
+                    std::apply( [&out]( const auto&... a ) { ( out << ... << a ); }, *static_cast< Payload* >( payload ) );
+                };
+                msg->destroy = []( void* payload ) { static_cast< Payload* >( payload )->~Payload(); };
+                CommitMessage( msg );
             }
+            LeaveWrite();
         }
-        if ( index != -1 )
+        else
         {
-            outputs.erase( outputs.begin() + index );
+            std::ostringstream ss;
+            ( ss << ... << args );
+            Write( sev, ss.str() );
         }
     }
 
-    template < typename T >
-    void PrintArgs( std::ostream& out, T t )
-    {
-        out << t;
-    }
-
-    template < typename T, typename U, typename... Args >
-    void PrintArgs( std::ostream& out, T t, U u, Args... args )
+private:
+    struct Message
     {
-        out << t;
-        PrintArgs( out, u, args... );
-    }
+        std::atomic< size_t > sequence;
+        size_t position;
+        Severity severity;
+        uint32_t threadID;
+        double timestamp; // seconds since Init
+        void (*format)( std::ostream& out, void* payload );
+        void (*destroy)( void* payload );
+        alignas( std::max_align_t ) unsigned char payload[LOG_PAYLOAD_SIZE];
+    };
 
-    template < typename... Args >
-    void Write( Severity sev, Args&&... args )
+    // Both sides of the gate are sequentially consistent: either Shutdown sees the writer's count, or the
+    // writer sees that the logger stopped and writes immediately instead
+    bool EnterWrite()
     {
-        std::string severity;
-        PrintModifier mod;
-        switch ( sev )
-        {
-            case DEBUG:
-                severity = "";
-                mod      = PrintModifier( PrintModifier::GREEN, PrintModifier::NONE );
-                break;
-            case WARN:
-                severity = "WARNING  ";
-                mod      = PrintModifier( PrintModifier::YELLOW, PrintModifier::NONE );
-                break;
-            case ERR:
-                severity = "ERROR    ";
-                mod      = PrintModifier( PrintModifier::RED, PrintModifier::NONE );
-                break;
-        }
-
-        m_lock.lock();
-        for ( const auto& output : outputs )
+        m_numWriters.fetch_add( 1 );
+        if ( m_running.load() )
         {
-            if ( output.colored )
-            {
-                std::cout << mod << severity;
-                PrintArgs( *output.output, std::forward< Args >( args )... );
-                *output.output << "\033[0m" << std::endl;
-            }
-            else
-            {
-                PrintArgs( *output.output, severity, std::forward< Args >( args )... );
-                *output.output << std::endl;
-            }
+            return true;
         }
-        m_lock.unlock();
+        m_numWriters.fetch_sub( 1 );
+        return false;
     }
-
-private:
-    std::vector< LoggerOutputLocation > outputs;
-    std::mutex m_lock;
+    void LeaveWrite() { m_numWriters.fetch_sub( 1, std::memory_order_release ); }
+
+    Message* BeginMessage( Severity sev );
+    void CommitMessage( Message* msg );
+    void WriteImmediately( Severity sev, const std::function< void( std::ostream& ) >& format );
+    void WriterThreadMain();
+    bool DrainMessages();
+    void AppendMessage( Severity sev, uint32_t threadID, double timestamp, const std::function< void( std::ostream& ) >& format );
+    void WritePending();
+
+    std::vector< std::unique_ptr< LoggerOutputLocation > > outputs;
+    std::mutex m_outputLock;
+
+    std::unique_ptr< Message[] > m_ring;
+    std::atomic< size_t > m_enqueuePos = { 0 };
+    std::atomic< size_t > m_dequeuePos = { 0 };
+    std::atomic< uint64_t > m_numDropped = { 0 };
+    uint64_t m_numDroppedReported = 0;
+
+    std::atomic< bool > m_running = { false };
+    std::atomic< uint32_t > m_numWriters = { 0 }; // Write calls between EnterWrite and LeaveWrite
+    std::atomic< bool > m_stopRequested = { false };
+    std::thread m_writerThread;
+    std::mutex m_wakeLock;
+    std::condition_variable m_wakeCondition;
 };
 
 extern Logger g_Logger;
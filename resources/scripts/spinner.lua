@@ -9,7 +9,7 @@ function Start()
 end
 
 function Update()
-    transform.rotation.y = transform.rotation.y + 2 * Time.dt
+    transform:Rotate( 2 * Time.dt, vec3.new( 0, 1, 0 ) )
     transform.scale      = vec3.scale( 1 + .2 * math.sin( theta ) , originalScale );
     theta = theta + 3 * Time.dt
 end
\ No newline at end of file
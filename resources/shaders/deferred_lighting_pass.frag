@@ -5,7 +5,7 @@
 #include "graphics/shader_c_shared/lights.h"
 #include "graphics/shader_c_shared/structs.h"
 #include "lighting_functions.h"
-#include "packing.h"
+#include "graphics/shader_c_shared/packing.h"
 
 layout( location = 0 ) in vec2 UV;
 
@@ -26,9 +26,19 @@ layout( std140, set = 3, binding = 2 ) buffer SpotLights
     SpotLight spotLights[];
 };
 
+layout( std430, set = 3, binding = 3 ) readonly buffer LightClusters
+{
+    LightCluster lightClusters[];
+};
+
+layout( std430, set = 3, binding = 4 ) readonly buffer LightIndices
+{
+    uint lightIndices[];
+};
+
 layout( set = PG_2D_TEXTURES_SET, binding = 0 ) uniform sampler2D textures[PG_MAX_NUM_TEXTURES];
 
-layout( set = 2, binding = 0 ) uniform sampler2D positionTex;
+layout( set = 2, binding = 0 ) uniform sampler2D depthTex;
 layout( set = 2, binding = 1 ) uniform sampler2D normalTex;
 layout( set = 2, binding = 2 ) uniform usampler2D diffuseAndSpecularTex;
 layout( set = 2, binding = 3 ) uniform sampler2D ssaoTex;
@@ -42,12 +52,14 @@ layout( std430, push_constant ) uniform DebugSwitch
 
 void main()
 {
-    vec3 posInWorldSpace = texture( positionTex, UV ).xyz;
-    vec3 n               = DecodeOctVec( texture( normalTex, UV ).xyz );
-    uvec4 packed         = texture( diffuseAndSpecularTex,  UV );
-    vec3 Kd;
-    vec4 Ks;
-    UnpackDiffuseAndSpecular( packed, Kd, Ks );
+    // The gbuffer's viewport is flipped, so the top of the screen is +1 in NDC
+    float depth          = texture( depthTex, UV ).r;
+    vec4 pos             = sceneConstantBuffer.invVP * vec4( 2 * UV.x - 1, 1 - 2 * UV.y, depth, 1 );
+    vec3 posInWorldSpace = pos.xyz / pos.w;
+    vec3 n               = DecodeOctVec( texture( normalTex, UV ).xy );
+    uvec4 enc            = texture( diffuseAndSpecularTex,  UV );
+    vec3 Kd              = UnpackDiffuse( enc );
+    vec4 Ks              = UnpackSpecular( enc );
 
     vec3 e     = normalize( sceneConstantBuffer.cameraPos.xyz - posInWorldSpace );
     
@@ -63,10 +75,12 @@ void main()
     vec3 l = normalize( -sceneConstantBuffer.dirLight.direction.xyz );
     vec3 h = normalize( l + e );
     
+    vec3 posInViewSpace = ( sceneConstantBuffer.V * vec4( posInWorldSpace, 1 ) ).xyz;
     float S = 1;
     if ( sceneConstantBuffer.dirLight.shadowMapIndex.x != PG_INVALID_TEXTURE_INDEX )
     {
-        S = 1 - ShadowAmount( sceneConstantBuffer.LSM * vec4( posInWorldSpace, 1 ), textures[sceneConstantBuffer.dirLight.shadowMapIndex.x] );
+        uint cascade = ShadowCascadeIndex( -posInViewSpace.z, sceneConstantBuffer.cascadeSplits );
+        S = 1 - ShadowAmount( sceneConstantBuffer.cascadeVPs[cascade] * vec4( posInWorldSpace, 1 ), cascade, textures[sceneConstantBuffer.dirLight.shadowMapIndex.x] );
     }
     diffuseColor += S * lightColor * Kd * max( 0.0, dot( l, n ) );
     if ( dot( l, n ) > PG_SHADER_EPSILON )
@@ -74,14 +88,20 @@ void main()
         specularColor += S * lightColor * Ks.xyz * pow( max( dot( h, n ), 0.0 ), 4 * Ks.w );
     }
 
+    // Only the lights that reach this pixel's cluster
+    LightCluster cluster = lightClusters[LightClusterIndex( posInViewSpace, sceneConstantBuffer.lightClusterParams )];
+    uint numPointLights  = cluster.counts & 0xFFFF;
+    uint numSpotLights   = cluster.counts >> 16;
+
     // pointlights
-    for ( uint i = 0; i < sceneConstantBuffer.numPointLights; ++i )
+    for ( uint i = 0; i < numPointLights; ++i )
     {
-        vec3 lightColor = pointLights[i].colorAndIntensity.w * pointLights[i].colorAndIntensity.xyz;
-        vec3 d = pointLights[i].positionAndRadius.xyz - posInWorldSpace;
+        PointLight light = pointLights[lightIndices[cluster.indexOffset + i]];
+        vec3 lightColor = light.colorAndIntensity.w * light.colorAndIntensity.xyz;
+        vec3 d = light.positionAndRadius.xyz - posInWorldSpace;
         vec3 l = normalize( d );
         vec3 h = normalize( l + e );
-        float attenuation = Attenuate( dot( d, d ), pointLights[i].positionAndRadius.w * pointLights[i].positionAndRadius.w );
+        float attenuation = Attenuate( dot( d, d ), light.positionAndRadius.w * light.positionAndRadius.w );
 
         diffuseColor += attenuation * lightColor * Kd * max( 0.0, dot( l, n ) );
         if ( dot( l, n ) > PG_SHADER_EPSILON )
@@ -91,17 +111,18 @@ void main()
     }
     
     // spotlights
-    for ( uint i = 0; i < sceneConstantBuffer.numSpotLights; ++i )
+    for ( uint i = 0; i < numSpotLights; ++i )
     {
-        vec3 l = normalize( spotLights[i].positionAndRadius.xyz - posInWorldSpace );
-        float theta = dot( -l, spotLights[i].directionAndCutoff.xyz );
-        if ( theta > cos( spotLights[i].directionAndCutoff.w ) )
+        SpotLight light = spotLights[lightIndices[cluster.indexOffset + numPointLights + i]];
+        vec3 l = normalize( light.positionAndRadius.xyz - posInWorldSpace );
+        float theta = dot( -l, light.directionAndCutoff.xyz );
+        if ( theta > cos( light.directionAndCutoff.w ) )
         {
-            vec3 lightColor = spotLights[i].colorAndIntensity.w * spotLights[i].colorAndIntensity.xyz;
-            vec3 d = spotLights[i].positionAndRadius.xyz - posInWorldSpace;
+            vec3 lightColor = light.colorAndIntensity.w * light.colorAndIntensity.xyz;
+            vec3 d = light.positionAndRadius.xyz - posInWorldSpace;
             vec3 l = normalize( d );
             vec3 h = normalize( l + e );
-            float attenuation = Attenuate( dot( d, d ), spotLights[i].positionAndRadius.w * spotLights[i].positionAndRadius.w );
+            float attenuation = Attenuate( dot( d, d ), light.positionAndRadius.w * light.positionAndRadius.w );
 
             diffuseColor += attenuation * lightColor * Kd * max( 0.0, dot( l, n ) );
             if ( dot( l, n ) > PG_SHADER_EPSILON )
@@ -28,6 +28,16 @@ layout( std140, set = 3, binding = 2 ) buffer SpotLights
     SpotLight spotLights[];
 };
 
+layout( std430, set = 3, binding = 3 ) readonly buffer LightClusters
+{
+    LightCluster lightClusters[];
+};
+
+layout( std430, set = 3, binding = 4 ) readonly buffer LightIndices
+{
+    uint lightIndices[];
+};
+
 layout( set = PG_2D_TEXTURES_SET, binding = 0 ) uniform sampler2D textures[PG_MAX_NUM_TEXTURES];
 
 layout( std430, push_constant ) uniform MaterialConstantBufferUniform
@@ -64,10 +74,12 @@ void main()
     vec3 l = normalize( -sceneConstantBuffer.dirLight.direction.xyz );
     vec3 h = normalize( l + e );
     
+    vec3 posInViewSpace = ( sceneConstantBuffer.V * vec4( posInWorldSpace, 1 ) ).xyz;
     float S = 1;
     if ( sceneConstantBuffer.dirLight.shadowMapIndex.x != PG_INVALID_TEXTURE_INDEX )
     {
-        S = 1 - ShadowAmount( sceneConstantBuffer.LSM * vec4( posInWorldSpace, 1 ), textures[sceneConstantBuffer.dirLight.shadowMapIndex.x] );
+        uint cascade = ShadowCascadeIndex( -posInViewSpace.z, sceneConstantBuffer.cascadeSplits );
+        S = 1 - ShadowAmount( sceneConstantBuffer.cascadeVPs[cascade] * vec4( posInWorldSpace, 1 ), cascade, textures[sceneConstantBuffer.dirLight.shadowMapIndex.x] );
     }
     color += S * lightColor * Kd * max( 0.0, dot( l, n ) );
     if ( dot( l, n ) > PG_SHADER_EPSILON )
@@ -77,14 +89,20 @@ void main()
     
     
 
+    // Only the lights that reach this pixel's cluster
+    LightCluster cluster = lightClusters[LightClusterIndex( posInViewSpace, sceneConstantBuffer.lightClusterParams )];
+    uint numPointLights  = cluster.counts & 0xFFFF;
+    uint numSpotLights   = cluster.counts >> 16;
+
     // pointlights
-    for ( uint i = 0; i < sceneConstantBuffer.numPointLights; ++i )
+    for ( uint i = 0; i < numPointLights; ++i )
     {
-        vec3 lightColor = pointLights[i].colorAndIntensity.w * pointLights[i].colorAndIntensity.xyz;
-        vec3 d = pointLights[i].positionAndRadius.xyz - posInWorldSpace;
+        PointLight light = pointLights[lightIndices[cluster.indexOffset + i]];
+        vec3 lightColor = light.colorAndIntensity.w * light.colorAndIntensity.xyz;
+        vec3 d = light.positionAndRadius.xyz - posInWorldSpace;
         vec3 l = normalize( d );
         vec3 h = normalize( l + e );
-        float attenuation = Attenuate( dot( d, d ), pointLights[i].positionAndRadius.w * pointLights[i].positionAndRadius.w );
+        float attenuation = Attenuate( dot( d, d ), light.positionAndRadius.w * light.positionAndRadius.w );
 
         color += attenuation * lightColor * Kd * max( 0.0, dot( l, n ) );
         if ( dot( l, n ) > PG_SHADER_EPSILON )
@@ -94,17 +112,18 @@ void main()
     }
     
     // spotlights
-    for ( uint i = 0; i < sceneConstantBuffer.numSpotLights; ++i )
+    for ( uint i = 0; i < numSpotLights; ++i )
     {
-        vec3 l = normalize( spotLights[i].positionAndRadius.xyz - posInWorldSpace );
-        float theta = dot( -l, spotLights[i].directionAndCutoff.xyz );
-        if ( theta > cos( spotLights[i].directionAndCutoff.w ) )
+        SpotLight light = spotLights[lightIndices[cluster.indexOffset + numPointLights + i]];
+        vec3 l = normalize( light.positionAndRadius.xyz - posInWorldSpace );
+        float theta = dot( -l, light.directionAndCutoff.xyz );
+        if ( theta > cos( light.directionAndCutoff.w ) )
         {
-            vec3 lightColor = spotLights[i].colorAndIntensity.w * spotLights[i].colorAndIntensity.xyz;
-            vec3 d = spotLights[i].positionAndRadius.xyz - posInWorldSpace;
+            vec3 lightColor = light.colorAndIntensity.w * light.colorAndIntensity.xyz;
+            vec3 d = light.positionAndRadius.xyz - posInWorldSpace;
             vec3 l = normalize( d );
             vec3 h = normalize( l + e );
-            float attenuation = Attenuate( dot( d, d ), spotLights[i].positionAndRadius.w * spotLights[i].positionAndRadius.w );
+            float attenuation = Attenuate( dot( d, d ), light.positionAndRadius.w * light.positionAndRadius.w );
 
             color += attenuation * lightColor * Kd * max( 0.0, dot( l, n ) );
             if ( dot( l, n ) > PG_SHADER_EPSILON )
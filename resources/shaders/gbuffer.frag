@@ -3,11 +3,11 @@
 
 #include "graphics/shader_c_shared/defines.h"
 #include "graphics/shader_c_shared/structs.h"
-#include "packing.h"
+#include "graphics/shader_c_shared/packing.h"
 
-layout( location = 0 ) out vec4 outPosition;
-layout( location = 1 ) out vec4 outNormal;
-layout( location = 2 ) out uvec4 outDiffuseAndSpecular;
+// Positions get rebuilt from the depth buffer, so the normals and materials are all that is stored
+layout( location = 0 ) out vec2 outNormal;
+layout( location = 1 ) out uvec4 outDiffuseAndSpecular;
 
 layout( location = 0 ) in vec3 posInWorldSpace;
 layout( location = 1 ) in vec2 texCoord;
@@ -22,8 +22,6 @@ layout( std430, push_constant ) uniform MaterialConstantBufferUniform
 
 void main()
 {
-    outPosition = vec4( posInWorldSpace, 1 );
-
     vec3 n = normalize( TBN[2] );
     if ( material.normalMapIndex != PG_INVALID_TEXTURE_INDEX )
     {
@@ -32,7 +30,7 @@ void main()
         n.z = sqrt( 1 - n.x * n.x + n.y * n.y );
         n = normalize( TBN * n );
     }
-    outNormal = vec4( EncodeOctVec( n ), 0 );
+    outNormal = EncodeOctVec( n );
     
     vec3 Kd    = material.Kd.xyz;
     if ( material.diffuseTexIndex != PG_INVALID_TEXTURE_INDEX )
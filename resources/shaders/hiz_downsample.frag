@@ -0,0 +1,27 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+#include "graphics/shader_c_shared/defines.h"
+
+layout( set = 0, binding = 0 ) uniform sampler2D depthTex;
+
+layout( location = 0 ) out float outDepth;
+
+// Keeps the farthest depth of every screen pixel this texel overlaps, including the ones it only partly
+// covers when the sizes don't divide evenly, so nothing that could be visible gets culled
+void main()
+{
+    ivec2 screenSize = textureSize( depthTex, 0 );
+    ivec2 hizSize    = ivec2( PG_HIZ_WIDTH, PG_HIZ_HEIGHT );
+    ivec2 texel      = ivec2( gl_FragCoord.xy );
+    ivec2 start      = ( texel * screenSize ) / hizSize;
+    ivec2 end        = min( ( ( texel + 1 ) * screenSize + hizSize - 1 ) / hizSize, screenSize );
+    outDepth = 0;
+    for ( int y = start.y; y < end.y; ++y )
+    {
+        for ( int x = start.x; x < end.x; ++x )
+        {
+            outDepth = max( outDepth, texelFetch( depthTex, ivec2( x, y ), 0 ).r );
+        }
+    }
+}
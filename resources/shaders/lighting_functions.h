@@ -8,7 +8,24 @@ float Attenuate( in const float distSquared, in const float radiusSquared )
     return (atten * atten) / ( 1.0 + distSquared );
 }
 
-float ShadowAmount( in const vec4 posInLightSpace, in sampler2D shadowMap )
+// The first cascade whose slice of the view frustum reaches past the depth
+uint ShadowCascadeIndex( in const float viewDepth, in const vec4 cascadeSplits )
+{
+    uint cascade = 0;
+    for ( uint i = 0; i < PG_NUM_SHADOW_CASCADES - 1; ++i )
+    {
+        if ( viewDepth > cascadeSplits[i] )
+        {
+            cascade = i + 1;
+        }
+    }
+    
+    return cascade;
+}
+
+// posInLightSpace is in the cascade's clip space. The cascades are the quadrants of the shadow map, so the
+// PCF taps are kept inside of the cascade's quadrant
+float ShadowAmount( in const vec4 posInLightSpace, in const uint cascade, in sampler2D shadowMap )
 {
     vec3 ndc             = posInLightSpace.xyz / posInLightSpace.w;
     vec3 projCoords      = .5 * ndc + vec3( .5 );
@@ -20,13 +37,16 @@ float ShadowAmount( in const vec4 posInLightSpace, in sampler2D shadowMap )
         return 0;
     }
     
-    vec2 dUV = 1.0 / textureSize( shadowMap, 0 );
+    vec2 dUV             = 1.0 / textureSize( shadowMap, 0 );
+    vec2 cascadeOffset   = 0.5 * vec2( cascade % 2, cascade / 2 );
     float totalShadowStrength = 0;
     for ( int r = -PCF_HALF_WIDTH; r <= PCF_HALF_WIDTH; ++r )
     {
         for ( int c = -PCF_HALF_WIDTH; c <= PCF_HALF_WIDTH; ++c )
         {
-            vec2 coords = projCoords.xy + vec2( c * dUV.x, r * dUV.y );
+            // a texel of the shadow map is 2 * dUV of the cascade
+            vec2 coords = projCoords.xy + 2 * vec2( c * dUV.x, r * dUV.y );
+            coords      = cascadeOffset + 0.5 * clamp( coords, dUV, vec2( 1 ) - dUV );
             float d = texture( shadowMap, coords ).r;
             if ( d < currentDepth )
             {
@@ -36,4 +56,15 @@ float ShadowAmount( in const vec4 posInLightSpace, in sampler2D shadowMap )
     }
     
     return totalShadowStrength / ( PCF_FULL_WIDTH * PCF_FULL_WIDTH );
-}
\ No newline at end of file
+}
+
+// Which of the light clusters a view space position is in. Has to match LightClusters on the cpu
+uint LightClusterIndex( in const vec3 posInViewSpace, in const vec4 clusterParams )
+{
+    float depth = max( -posInViewSpace.z, PG_SHADER_EPSILON );
+    vec2 ndc    = posInViewSpace.xy * clusterParams.xy / depth;
+    uvec2 xy    = uvec2( clamp( ( 0.5 * ndc + 0.5 ) * vec2( PG_LIGHT_CLUSTERS_X, PG_LIGHT_CLUSTERS_Y ), vec2( 0 ), vec2( PG_LIGHT_CLUSTERS_X - 1, PG_LIGHT_CLUSTERS_Y - 1 ) ) );
+    uint z      = uint( clamp( log( depth ) * clusterParams.z + clusterParams.w, 0, PG_LIGHT_CLUSTERS_Z - 1 ) );
+    
+    return ( z * PG_LIGHT_CLUSTERS_Y + xy.y ) * PG_LIGHT_CLUSTERS_X + xy.x;
+}
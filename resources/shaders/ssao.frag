@@ -3,36 +3,48 @@
 
 #include "graphics/shader_c_shared/defines.h"
 #include "graphics/shader_c_shared/structs.h"
-#include "packing.h"
+#include "graphics/shader_c_shared/packing.h"
 
 #define SCALE_RADIUS 0.5
 #define BIAS 0.01
 
 layout( location = 0 ) in vec2 UV;
 
-layout( set = 0, binding = 0 ) uniform sampler2D worldPositions;
-layout( set = 0, binding = 1 ) uniform sampler2D worldNormals;
+layout( set = 0, binding = 0 ) uniform sampler2D viewDepths;
+layout( set = 0, binding = 1 ) uniform sampler2D viewNormals;
 layout( set = 0, binding = 2 ) uniform sampler2D ssaoNoise;
 
 layout( set = 0, binding = 3 ) uniform SSAOKernel
 {
-	vec4 samples[PG_SSAO_KERNEL_SIZE];
+	vec4 samples[PG_SSAO_KERNEL_BUFFER_SIZE];
 } uboSSAOKernel;
 
-layout( std430, push_constant ) uniform Matrices
+layout( std430, push_constant ) uniform Constants
 {
-    SSAOShaderData matrices;
+    SSAOShaderData constants;
 };
 
 layout( location = 0 ) out float occlusionFactor;
 
+// The inverse of how the samples get projected onto the screen below
+vec3 ViewPosition( vec2 screenUV, float depth )
+{
+    vec2 ndc = vec2( 2 * screenUV.x - 1, 1 - 2 * screenUV.y );
+    return vec3( depth * ndc.x / constants.P[0][0], depth * ndc.y / constants.P[1][1], -depth );
+}
 
 void main()
 {
-    vec3 fragPos = ( matrices.V * texture( worldPositions, UV ) ).xyz;
-    vec3 N       = ( matrices.V * vec4( DecodeOctVec( texture( worldNormals, UV ).xyz ), 0 ) ).xyz;
+    float depth = texture( viewDepths, UV ).r;
+    if ( depth == 0 )
+    {
+        occlusionFactor = 1;
+        return;
+    }
+    vec3 fragPos = ViewPosition( UV * constants.uvScale, depth );
+    vec3 N       = DecodeOctVec( texture( viewNormals, UV ).xy );
     
-    ivec2 texDim       = textureSize( worldPositions, 0 );
+    ivec2 texDim       = textureSize( viewDepths, 0 );
     ivec2 noiseDim     = textureSize( ssaoNoise, 0 );
     const vec2 noiseUV = vec2( float( texDim.x ) / float( noiseDim.x ), float( texDim.y ) / float( noiseDim.y ) ) * UV;  
 	vec3 randomVec     = texture( ssaoNoise, noiseUV ).xyz;
@@ -42,20 +54,25 @@ void main()
     mat3 TBN = mat3( T, B, N );
     
     float occlusion = 0;
-    for ( int i = 0; i < PG_SSAO_KERNEL_SIZE; ++i )
+    for ( uint i = 0; i < constants.kernelSize; ++i )
     {
-        vec3 offsetPos = fragPos + TBN * uboSSAOKernel.samples[i].xyz * SCALE_RADIUS;
+        vec3 offsetPos = fragPos + TBN * uboSSAOKernel.samples[constants.kernelOffset + i].xyz * SCALE_RADIUS;
         
-        vec4 projCoords = matrices.P * vec4( offsetPos, 1 );
+        vec4 projCoords = constants.P * vec4( offsetPos, 1 );
         projCoords.xyz /= projCoords.w;
         projCoords.xy = 0.5 * projCoords.xy + vec2( 0.5 );
         projCoords.y = 1 - projCoords.y; // since current Vulkan viewport is inverted
         
-        float offsetDepth = ( matrices.V * texture( worldPositions, projCoords.xy ) ).z;
+        // view depths are positive, so compare them against -z. Empty pixels are infinitely far away
+        float offsetDepth = texture( viewDepths, projCoords.xy / constants.uvScale ).r;
+        if ( offsetDepth == 0 )
+        {
+            continue;
+        }
         
-        float rangeCheck = smoothstep(0.0f, 1.0f, SCALE_RADIUS / abs(fragPos.z - offsetDepth));
-		occlusion += (offsetDepth >= offsetPos.z + BIAS ? 1.0f : 0.0f) * rangeCheck;
+        float rangeCheck = smoothstep(0.0f, 1.0f, SCALE_RADIUS / abs(depth - offsetDepth));
+		occlusion += (offsetDepth <= -offsetPos.z - BIAS ? 1.0f : 0.0f) * rangeCheck;
     }
     
-    occlusionFactor = 1 - ( occlusion / float( PG_SSAO_KERNEL_SIZE ) );
-}
\ No newline at end of file
+    occlusionFactor = 1 - ( occlusion / float( constants.kernelSize ) );
+}
@@ -1,27 +1,48 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
 
-layout( location = 0 ) in vec2 UV;
-
 layout( set = 0, binding = 0 ) uniform sampler2D ssaoTex;
+layout( set = 0, binding = 1 ) uniform sampler2D viewDepths;
+
+// One texel along the blur's axis. The blur runs once horizontally, and once vertically
+layout( std430, push_constant ) uniform Direction
+{
+    ivec2 direction;
+};
 
 layout( location = 0 ) out float outFragColor;
 
-#define BLUR_KERNEL_SIZE 2
-#define BLUR_KERNEL_TOTAL_SIZE ( 2 * BLUR_KERNEL_SIZE + 1 )
+#define BLUR_RADIUS 4
+#define BLUR_SIGMA ( 0.5 * BLUR_RADIUS )
+// Texels whose depth is more than this fraction away from the center's don't get mixed in
+#define BLUR_DEPTH_TOLERANCE 0.1
 
 void main()
 {
-    vec2 texDims = vec2( 1.0 ) / textureSize( ssaoTex, 0 );
-    float total = 0;
-    for ( int c = -BLUR_KERNEL_SIZE; c <= BLUR_KERNEL_SIZE; ++c )
+    ivec2 center = ivec2( gl_FragCoord.xy );
+    ivec2 maxCoord = textureSize( ssaoTex, 0 ) - 1;
+    float centerDepth = texelFetch( viewDepths, center, 0 ).r;
+    float total = texelFetch( ssaoTex, center, 0 ).r;
+    float totalWeight = 1;
+    // nothing was drawn here, so there is nothing to blend with
+    if ( centerDepth == 0 )
+    {
+        outFragColor = total;
+        return;
+    }
+    for ( int i = -BLUR_RADIUS; i <= BLUR_RADIUS; ++i )
     {
-        for ( int r = -BLUR_KERNEL_SIZE; r <= BLUR_KERNEL_SIZE; ++r )
+        if ( i == 0 )
         {
-            vec2 newUV = UV + vec2( c, r ) * texDims;
-            total += texture( ssaoTex, newUV ).r;
+            continue;
         }
+        ivec2 coord = clamp( center + i * direction, ivec2( 0 ), maxCoord );
+        float depth = texelFetch( viewDepths, coord, 0 ).r;
+        float depthWeight = max( 0.0, 1 - abs( depth - centerDepth ) / ( BLUR_DEPTH_TOLERANCE * centerDepth ) );
+        float weight = exp( -( i * i ) / ( 2 * BLUR_SIGMA * BLUR_SIGMA ) ) * depthWeight;
+        total += weight * texelFetch( ssaoTex, coord, 0 ).r;
+        totalWeight += weight;
     }
     
-    outFragColor = total / ( BLUR_KERNEL_TOTAL_SIZE * BLUR_KERNEL_TOTAL_SIZE );
-}
\ No newline at end of file
+    outFragColor = total / totalWeight;
+}
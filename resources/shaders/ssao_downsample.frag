@@ -0,0 +1,48 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+#include "graphics/shader_c_shared/defines.h"
+#include "graphics/shader_c_shared/structs.h"
+#include "graphics/shader_c_shared/packing.h"
+
+layout( set = 0, binding = 0 ) uniform sampler2D depthTex;
+layout( set = 0, binding = 1 ) uniform sampler2D worldNormals;
+
+layout( std430, push_constant ) uniform Resample
+{
+    SSAOResampleData resample;
+};
+
+layout( location = 0 ) out float outViewDepth;
+layout( location = 1 ) out vec2 outViewNormal;
+
+// Keeps the closest surface in each block of screen pixels, so thin foreground objects don't disappear
+// at the lower resolutions. A depth of 0 means nothing was drawn in the whole block
+void main()
+{
+    ivec2 screenSize = textureSize( depthTex, 0 );
+    ivec2 blockStart = ivec2( gl_FragCoord.xy ) * int( resample.scale );
+    outViewDepth  = 0;
+    outViewNormal = vec2( 0 );
+    for ( int y = 0; y < int( resample.scale ); ++y )
+    {
+        for ( int x = 0; x < int( resample.scale ); ++x )
+        {
+            ivec2 coord = min( blockStart + ivec2( x, y ), screenSize - 1 );
+            float d     = texelFetch( depthTex, coord, 0 ).r;
+            // still at the clear value
+            if ( d == 1 )
+            {
+                continue;
+            }
+            
+            float depth = ViewDepth( d, resample.depthParams );
+            if ( outViewDepth == 0 || depth < outViewDepth )
+            {
+                vec3 N        = DecodeOctVec( texelFetch( worldNormals, coord, 0 ).xy );
+                outViewDepth  = depth;
+                outViewNormal = EncodeOctVec( normalize( mat3( resample.V ) * N ) );
+            }
+        }
+    }
+}
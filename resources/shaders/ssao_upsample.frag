@@ -0,0 +1,53 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+#include "graphics/shader_c_shared/defines.h"
+#include "graphics/shader_c_shared/structs.h"
+#include "graphics/shader_c_shared/packing.h"
+
+layout( set = 0, binding = 0 ) uniform sampler2D ssaoTex;
+layout( set = 0, binding = 1 ) uniform sampler2D viewDepths;
+layout( set = 0, binding = 2 ) uniform sampler2D depthTex;
+
+layout( std430, push_constant ) uniform Resample
+{
+    SSAOResampleData resample;
+};
+
+layout( location = 0 ) out float outFragColor;
+
+// Relative depth difference that still counts as the same surface. Keeps the weights finite when they match
+#define UPSAMPLE_DEPTH_EPSILON 0.001
+
+// Bilinear between the 4 closest AO texels, with each one weighted down by how far its depth is from this
+// pixel's. So the AO doesn't bleed across edges, and when none of them match, the closest one wins
+void main()
+{
+    ivec2 coord = ivec2( gl_FragCoord.xy );
+    float d     = texelFetch( depthTex, coord, 0 ).r;
+    if ( d == 1 )
+    {
+        outFragColor = 1;
+        return;
+    }
+    float depth = ViewDepth( d, resample.depthParams );
+
+    vec2 aoCoord   = ( vec2( coord ) + 0.5 ) / float( resample.scale ) - 0.5;
+    ivec2 base     = ivec2( floor( aoCoord ) );
+    vec2 f         = aoCoord - vec2( base );
+    ivec2 maxCoord = textureSize( ssaoTex, 0 ) - 1;
+    float total       = 0;
+    float totalWeight = 0;
+    for ( int i = 0; i < 4; ++i )
+    {
+        ivec2 offset     = ivec2( i & 1, i >> 1 );
+        ivec2 texel      = clamp( base + offset, ivec2( 0 ), maxCoord );
+        vec2 bilinear    = mix( 1 - f, f, vec2( offset ) );
+        float aoDepth    = texelFetch( viewDepths, texel, 0 ).r;
+        float weight     = bilinear.x * bilinear.y / ( UPSAMPLE_DEPTH_EPSILON + abs( aoDepth - depth ) / depth );
+        total       += weight * texelFetch( ssaoTex, texel, 0 ).r;
+        totalWeight += weight;
+    }
+    
+    outFragColor = total / totalWeight;
+}
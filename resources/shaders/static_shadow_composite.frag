@@ -0,0 +1,10 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// Both are the same size, so the static casters' depth is copied texel for texel
+layout( set = 0, binding = 0 ) uniform sampler2D staticShadowMap;
+
+void main()
+{
+    gl_FragDepth = texelFetch( staticShadowMap, ivec2( gl_FragCoord.xy ), 0 ).r;
+}
@@ -0,0 +1,327 @@
+#include "unit_test.hpp"
+#include "graphics/graphics_api/device_memory.hpp"
+#include <map>
+#include <vector>
+
+using namespace Progression;
+using namespace Progression::Gfx;
+
+// Hands out fake memory handles, keeping track of which blocks are still live. Memory type 1 is host
+// visible and gets real memory to map, and memory type 2 is always out of memory
+class MockDeviceMemoryBackend : public DeviceMemoryBackend
+{
+public:
+    ~MockDeviceMemoryBackend()
+    {
+        for ( auto& block : liveBlocks )
+        {
+            delete[] block.second.mapped;
+        }
+    }
+
+    uint64_t AllocateBlock( uint32_t memoryTypeIndex, uint64_t size, void** mappedPtr ) override
+    {
+        if ( memoryTypeIndex == 2 )
+        {
+            return 0;
+        }
+        Block block = { memoryTypeIndex, size, memoryTypeIndex == 1 ? new char[size] : nullptr };
+        *mappedPtr = block.mapped;
+        liveBlocks[nextMemory] = block;
+        ++numBlocksAllocated;
+        return nextMemory++;
+    }
+
+    void FreeBlock( uint32_t memoryTypeIndex, uint64_t memory ) override
+    {
+        auto it = liveBlocks.find( memory );
+        if ( PG_EXPECT( it != liveBlocks.end() ) && PG_EXPECT( it->second.memoryTypeIndex == memoryTypeIndex ) )
+        {
+            delete[] it->second.mapped;
+            liveBlocks.erase( it );
+        }
+    }
+
+    struct Block
+    {
+        uint32_t memoryTypeIndex;
+        uint64_t size;
+        char* mapped;
+    };
+    std::map< uint64_t, Block > liveBlocks;
+    uint32_t numBlocksAllocated = 0;
+    uint64_t nextMemory         = 1;
+};
+
+static const uint64_t GRANULARITY   = 4096;
+static const uint64_t MIN_ALIGNMENT = 256;
+static const uint64_t BLOCK_SIZE    = 1 << 20;
+
+static DeviceMemoryRequest Request( uint64_t size, uint64_t alignment, uint32_t memoryTypeIndex = 0, bool optimalImage = false )
+{
+    DeviceMemoryRequest request;
+    request.size            = size;
+    request.alignment       = alignment;
+    request.memoryTypeIndex = memoryTypeIndex;
+    request.optimalImage    = optimalImage;
+    return request;
+}
+
+static bool Overlap( const DeviceAllocation& a, const DeviceAllocation& b )
+{
+    return a.memory == b.memory && a.offset < b.offset + b.size && b.offset < a.offset + a.size;
+}
+
+PG_TEST( DeviceMemory_Alignment )
+{
+    MockDeviceMemoryBackend backend;
+    DeviceMemoryAllocator allocator;
+    allocator.Init( &backend, 3, GRANULARITY, MIN_ALIGNMENT, BLOCK_SIZE );
+
+    // Odd sizes in between, so that the bigger alignments actually need padding
+    std::vector< DeviceAllocation > allocations;
+    for ( uint64_t alignment : { 1ull, 256ull, 1024ull, 4096ull, 65536ull } )
+    {
+        for ( uint64_t size : { 100ull, 300ull, 5000ull } )
+        {
+            DeviceAllocation allocation = allocator.Allocate( Request( size, alignment ) );
+            if ( !PG_EXPECT( allocation.IsValid() ) )
+            {
+                return;
+            }
+            PG_EXPECT( allocation.offset % std::max( alignment, MIN_ALIGNMENT ) == 0 );
+            PG_EXPECT( allocation.offset + allocation.size <= BLOCK_SIZE );
+            PG_EXPECT( allocation.size == size );
+            allocations.push_back( allocation );
+        }
+    }
+    for ( size_t i = 0; i < allocations.size(); ++i )
+    {
+        for ( size_t j = i + 1; j < allocations.size(); ++j )
+        {
+            PG_EXPECT( !Overlap( allocations[i], allocations[j] ) );
+        }
+    }
+
+    // Host visible memory comes back mapped, at the allocation's offset into the block
+    DeviceAllocation mapped = allocator.Allocate( Request( 1000, 4096, 1 ) );
+    if ( PG_EXPECT( mapped.IsValid() && mapped.mappedPtr ) )
+    {
+        PG_EXPECT( static_cast< char* >( mapped.mappedPtr ) == backend.liveBlocks[mapped.memory].mapped + mapped.offset );
+        allocator.Free( mapped );
+    }
+    PG_EXPECT( !allocator.Allocate( Request( 100, 1, 2 ) ).IsValid() );
+
+    for ( const DeviceAllocation& allocation : allocations )
+    {
+        allocator.Free( allocation );
+    }
+    PG_EXPECT( allocator.GetStats().numAllocations == 0 );
+    allocator.Shutdown();
+}
+
+PG_TEST( DeviceMemory_BufferImageGranularity )
+{
+    MockDeviceMemoryBackend backend;
+    DeviceMemoryAllocator allocator;
+    allocator.Init( &backend, 3, GRANULARITY, MIN_ALIGNMENT, BLOCK_SIZE );
+
+    // The general pools keep optimal images out of the buffers' blocks altogether
+    DeviceAllocation buffer  = allocator.Allocate( Request( 300, 256 ) );
+    DeviceAllocation image   = allocator.Allocate( Request( 300, 256, 0, true ) );
+    DeviceAllocation buffer2 = allocator.Allocate( Request( 300, 256 ) );
+    PG_EXPECT( buffer.IsValid() && image.IsValid() && buffer2.IsValid() );
+    PG_EXPECT( buffer.memory != image.memory );
+    PG_EXPECT( buffer.memory == buffer2.memory );
+    allocator.Free( buffer );
+    allocator.Free( image );
+    allocator.Free( buffer2 );
+
+    // Linear pools share one block, so switching between buffers and images starts a new page
+    uint32_t pool = allocator.CreateLinearPool( 0, 8 * GRANULARITY );
+    DeviceAllocation a = allocator.AllocateLinear( pool, Request( 100, 16 ) );
+    DeviceAllocation b = allocator.AllocateLinear( pool, Request( 100, 16 ) );
+    DeviceAllocation c = allocator.AllocateLinear( pool, Request( 100, 16, 0, true ) );
+    DeviceAllocation d = allocator.AllocateLinear( pool, Request( 100, 16, 0, true ) );
+    DeviceAllocation e = allocator.AllocateLinear( pool, Request( 100, 16 ) );
+    PG_EXPECT( a.offset == 0 );
+    PG_EXPECT( b.offset == MIN_ALIGNMENT );
+    PG_EXPECT( c.offset == GRANULARITY );
+    PG_EXPECT( d.offset == GRANULARITY + MIN_ALIGNMENT );
+    PG_EXPECT( e.offset == 2 * GRANULARITY );
+    allocator.Shutdown();
+}
+
+PG_TEST( DeviceMemory_DedicatedBlocks )
+{
+    MockDeviceMemoryBackend backend;
+    DeviceMemoryAllocator allocator;
+    allocator.Init( &backend, 3, GRANULARITY, MIN_ALIGNMENT, BLOCK_SIZE );
+
+    DeviceAllocation small = allocator.Allocate( Request( 1000, 256 ) );
+    // Anything over half a block gets a block of its own, sized for it
+    DeviceAllocation big  = allocator.Allocate( Request( BLOCK_SIZE / 2 + 1, 256 ) );
+    DeviceAllocation huge = allocator.Allocate( Request( 3 * BLOCK_SIZE, 256 ) );
+    if ( !PG_EXPECT( small.IsValid() && big.IsValid() && huge.IsValid() ) )
+    {
+        return;
+    }
+    PG_EXPECT( big.memory != small.memory && huge.memory != small.memory && big.memory != huge.memory );
+    PG_EXPECT( big.offset == 0 && huge.offset == 0 );
+    PG_EXPECT( backend.liveBlocks[big.memory].size == BLOCK_SIZE / 2 + MIN_ALIGNMENT );
+    PG_EXPECT( backend.liveBlocks[huge.memory].size == 3 * BLOCK_SIZE );
+    PG_EXPECT( allocator.GetStats().numBlocks == 3 );
+
+    // Dedicated blocks go back to the driver right away, and never take another allocation
+    allocator.Free( big );
+    PG_EXPECT( backend.liveBlocks.count( big.memory ) == 0 );
+    DeviceAllocation small2 = allocator.Allocate( Request( 1000, 256 ) );
+    PG_EXPECT( small2.memory == small.memory );
+    allocator.Free( huge );
+    PG_EXPECT( backend.liveBlocks.size() == 1 );
+
+    // The last general block is kept around empty, so the next allocation doesn't hit the driver
+    allocator.Free( small );
+    allocator.Free( small2 );
+    PG_EXPECT( backend.liveBlocks.size() == 1 );
+    uint32_t numBlocksAllocated = backend.numBlocksAllocated;
+    allocator.Free( allocator.Allocate( Request( 1000, 256 ) ) );
+    PG_EXPECT( backend.numBlocksAllocated == numBlocksAllocated );
+    allocator.Shutdown();
+}
+
+PG_TEST( DeviceMemory_LinearPoolReset )
+{
+    MockDeviceMemoryBackend backend;
+    DeviceMemoryAllocator allocator;
+    allocator.Init( &backend, 3, GRANULARITY, MIN_ALIGNMENT, BLOCK_SIZE );
+
+    const uint64_t poolSize = 4 * MIN_ALIGNMENT;
+    uint32_t pool = allocator.CreateLinearPool( 1, poolSize );
+    PG_EXPECT( backend.liveBlocks.size() == 1 );
+    std::vector< DeviceAllocation > allocations;
+    for ( uint32_t i = 0; i < 4; ++i )
+    {
+        allocations.push_back( allocator.AllocateLinear( pool, Request( 100, 16, 1 ) ) );
+        PG_EXPECT( allocations.back().IsValid() && allocations.back().offset == i * MIN_ALIGNMENT );
+        PG_EXPECT( allocations.back().mappedPtr != nullptr );
+    }
+    PG_EXPECT( !allocator.AllocateLinear( pool, Request( 100, 16, 1 ) ).IsValid() );
+
+    // Freeing on its own does nothing, only the reset gives the space back
+    allocator.Free( allocations[3] );
+    PG_EXPECT( !allocator.AllocateLinear( pool, Request( 100, 16, 1 ) ).IsValid() );
+    allocator.ResetLinearPool( pool );
+    DeviceAllocation first = allocator.AllocateLinear( pool, Request( poolSize, 16, 1 ) );
+    PG_EXPECT( first.IsValid() && first.offset == 0 && first.memory == allocations[0].memory );
+    PG_EXPECT( backend.numBlocksAllocated == 1 );
+
+    allocator.ResetLinearPool( pool );
+    PG_EXPECT( !allocator.AllocateLinear( pool, Request( poolSize + 1, 16, 1 ) ).IsValid() );
+    allocator.Shutdown();
+}
+
+PG_TEST( DeviceMemory_ShutdownFreesBlocks )
+{
+    MockDeviceMemoryBackend backend;
+    DeviceMemoryAllocator allocator;
+    allocator.Init( &backend, 3, GRANULARITY, MIN_ALIGNMENT, BLOCK_SIZE );
+
+    // Still allocated at shutdown: general blocks of both pools, a dedicated block and a linear pool
+    for ( uint32_t i = 0; i < 10; ++i )
+    {
+        allocator.Allocate( Request( BLOCK_SIZE / 4, 256, i % 2 ) );
+    }
+    allocator.Allocate( Request( 1000, 256, 0, true ) );
+    allocator.Allocate( Request( BLOCK_SIZE, 256 ) );
+    allocator.CreateLinearPool( 1, BLOCK_SIZE );
+    PG_EXPECT( backend.liveBlocks.size() == allocator.GetStats().numBlocks );
+    PG_EXPECT( backend.liveBlocks.size() > 5 );
+
+    allocator.Shutdown();
+    PG_EXPECT( backend.liveBlocks.empty() );
+    PG_EXPECT( allocator.GetStats().numBlocks == 0 );
+}
+
+PG_TEST( DeviceMemory_Defragment )
+{
+    MockDeviceMemoryBackend backend;
+    DeviceMemoryAllocator allocator;
+    allocator.Init( &backend, 3, GRANULARITY, MIN_ALIGNMENT, BLOCK_SIZE );
+
+    // Two and a half blocks worth, then free most of it so that everything left fits in one block
+    const uint64_t size = BLOCK_SIZE / 8;
+    std::vector< DeviceAllocation > allocations;
+    std::vector< uint32_t > owners( 20 );
+    for ( uint32_t i = 0; i < 20; ++i )
+    {
+        DeviceMemoryRequest request = Request( size - 1000, 4096 );
+        request.userData            = &owners[i];
+        allocations.push_back( allocator.Allocate( request ) );
+        owners[i] = i;
+    }
+    PG_EXPECT( allocator.GetStats().numBlocks == 3 );
+    std::vector< DeviceAllocation > kept;
+    for ( uint32_t i = 0; i < 20; ++i )
+    {
+        if ( i % 4 == 0 )
+        {
+            kept.push_back( allocations[i] );
+        }
+        else
+        {
+            allocator.Free( allocations[i] );
+        }
+    }
+    PG_EXPECT( allocator.GetStats().numBlocks == 3 );
+
+    // Nothing moves without the callback's say so
+    uint64_t moved = allocator.Defragment( []( const DeviceAllocation&, const DeviceAllocation&, void* ) { return false; }, ~0ull );
+    PG_EXPECT( moved == 0 );
+    PG_EXPECT( allocator.GetStats().numBlocks == 3 );
+
+    // Where each owner's allocation ends up, like the owner would rebind its resource
+    std::map< uint32_t, DeviceAllocation > newLocations;
+    uint32_t numMoves = 0;
+    auto move = [&]( const DeviceAllocation& src, const DeviceAllocation& dst, void* userData )
+    {
+        PG_EXPECT( dst.IsValid() && dst.memory != src.memory );
+        PG_EXPECT( dst.size == src.size && dst.offset % 4096 == 0 );
+        newLocations[*static_cast< uint32_t* >( userData )] = dst;
+        ++numMoves;
+        return true;
+    };
+
+    // The byte limit is respected
+    moved = allocator.Defragment( move, size );
+    PG_EXPECT( numMoves <= 1 && moved <= size );
+
+    moved += allocator.Defragment( move, ~0ull );
+    PG_EXPECT( moved > 0 );
+    PG_EXPECT( allocator.GetStats().numBlocks == 1 );
+    PG_EXPECT( backend.liveBlocks.size() == 1 );
+    PG_EXPECT( allocator.GetStats().numAllocations == kept.size() );
+
+    // The handles from before the move still free the moved allocations
+    std::vector< DeviceAllocation > current;
+    for ( uint32_t i = 0; i < 20; i += 4 )
+    {
+        auto it = newLocations.find( i );
+        current.push_back( it != newLocations.end() ? it->second : allocations[i] );
+    }
+    for ( size_t i = 0; i < current.size(); ++i )
+    {
+        PG_EXPECT( backend.liveBlocks.count( current[i].memory ) == 1 );
+        for ( size_t j = i + 1; j < current.size(); ++j )
+        {
+            PG_EXPECT( !Overlap( current[i], current[j] ) );
+        }
+    }
+    for ( const DeviceAllocation& allocation : kept )
+    {
+        allocator.Free( allocation );
+    }
+    PG_EXPECT( allocator.GetStats().numAllocations == 0 );
+    allocator.Shutdown();
+    PG_EXPECT( backend.liveBlocks.empty() );
+}
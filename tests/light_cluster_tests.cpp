@@ -0,0 +1,231 @@
+#include "unit_test.hpp"
+#include "graphics/light_clusters.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+
+using namespace Progression;
+using namespace Progression::Gfx;
+
+// The camera sits at the origin looking down -z, so view space and world space are the same
+static const glm::mat4 V( 1 );
+static const float FOV        = glm::radians( 60.0f );
+static const float ASPECT     = 16.0f / 9.0f;
+static const float NEAR_PLANE = 0.1f;
+static const float FAR_PLANE  = 100.0f;
+
+// Wide enough that the cluster assignment leaves the spot light as a sphere
+static const glm::vec4 WIDE_CONE( 0, 0, -1, glm::radians( 120.0f ) );
+
+static float Random( std::mt19937& rng, float min, float max )
+{
+    return std::uniform_real_distribution< float >( min, max )( rng );
+}
+
+static LightClusters MakeClusters()
+{
+    LightClusters clusters;
+    clusters.SetProjection( FOV, ASPECT, NEAR_PLANE, FAR_PLANE );
+    return clusters;
+}
+
+static uint32_t ClusterIndex( uint32_t x, uint32_t y, uint32_t z )
+{
+    return ( z * PG_LIGHT_CLUSTERS_Y + y ) * PG_LIGHT_CLUSTERS_X + x;
+}
+
+// Same as LightClusterIndex in lighting_functions.h
+static uint32_t ClusterOf( const LightClusters& clusters, const glm::vec3& posInViewSpace )
+{
+    glm::vec4 params = clusters.GetShaderParams();
+    float depth      = -posInViewSpace.z;
+    glm::vec2 ndc    = glm::vec2( posInViewSpace ) * glm::vec2( params ) / depth;
+    int x = std::clamp( static_cast< int >( std::floor( ( 0.5f * ndc.x + 0.5f ) * PG_LIGHT_CLUSTERS_X ) ), 0, PG_LIGHT_CLUSTERS_X - 1 );
+    int y = std::clamp( static_cast< int >( std::floor( ( 0.5f * ndc.y + 0.5f ) * PG_LIGHT_CLUSTERS_Y ) ), 0, PG_LIGHT_CLUSTERS_Y - 1 );
+    int z = std::clamp( static_cast< int >( std::floor( std::log( depth ) * params.z + params.w ) ), 0, PG_LIGHT_CLUSTERS_Z - 1 );
+    return ClusterIndex( x, y, z );
+}
+
+// The point in the middle of the cluster's screen rect, halfway through its slice
+static glm::vec3 ClusterCenter( uint32_t x, uint32_t y, uint32_t z )
+{
+    float depth = NEAR_PLANE * std::pow( FAR_PLANE / NEAR_PLANE, ( z + 0.5f ) / PG_LIGHT_CLUSTERS_Z );
+    float tanY  = std::tan( 0.5f * FOV );
+    float ndcX  = -1 + ( 2 * x + 1.0f ) / PG_LIGHT_CLUSTERS_X;
+    float ndcY  = -1 + ( 2 * y + 1.0f ) / PG_LIGHT_CLUSTERS_Y;
+    return depth * glm::vec3( ndcX * tanY * ASPECT, ndcY * tanY, -1 );
+}
+
+static bool HasLight( const LightClusters& clusters, uint32_t cluster, uint32_t lightIndex, bool spot )
+{
+    const Gpu::LightCluster& c = clusters.GetClusters()[cluster];
+    uint32_t numPointLights    = c.counts & 0xFFFF;
+    uint32_t begin             = c.indexOffset + ( spot ? numPointLights : 0 );
+    uint32_t end               = spot ? begin + ( c.counts >> 16 ) : begin + numPointLights;
+    const std::vector< uint32_t >& indices = clusters.GetLightIndices();
+    return std::find( indices.begin() + begin, indices.begin() + end, lightIndex ) != indices.begin() + end;
+}
+
+PG_TEST( LightClusters_SliceBounds )
+{
+    LightClusters clusters = MakeClusters();
+    const uint32_t x = PG_LIGHT_CLUSTERS_X / 2, y = PG_LIGHT_CLUSTERS_Y / 2;
+    PG_EXPECT( ClusterOf( clusters, glm::vec3( 0, 0, -NEAR_PLANE * 1.0001f ) ) == ClusterIndex( x, y, 0 ) );
+    PG_EXPECT( ClusterOf( clusters, glm::vec3( 0, 0, -FAR_PLANE * 0.9999f ) ) == ClusterIndex( x, y, PG_LIGHT_CLUSTERS_Z - 1 ) );
+
+    // The slices split the depth range exponentially, so every slice has the same ratio of its far to near depth
+    for ( uint32_t z = 1; z < PG_LIGHT_CLUSTERS_Z; ++z )
+    {
+        float split = NEAR_PLANE * std::pow( FAR_PLANE / NEAR_PLANE, z / static_cast< float >( PG_LIGHT_CLUSTERS_Z ) );
+        PG_EXPECT( ClusterOf( clusters, glm::vec3( 0, 0, -split * 1.0001f ) ) == ClusterIndex( x, y, z ) );
+        PG_EXPECT( ClusterOf( clusters, glm::vec3( 0, 0, -split * 0.9999f ) ) == ClusterIndex( x, y, z - 1 ) );
+
+        // A tiny light in the middle of a slice stays in that slice
+        glm::vec3 center = ClusterCenter( x, y, z );
+        clusters.Assign( V, { glm::vec4( center, 1e-4f * -center.z ) }, {}, {} );
+        for ( uint32_t cluster = 0; cluster < PG_NUM_LIGHT_CLUSTERS; ++cluster )
+        {
+            PG_EXPECT( HasLight( clusters, cluster, 0, false ) == ( cluster == ClusterIndex( x, y, z ) ) );
+        }
+    }
+}
+
+// A light whose center is in one cluster, but whose sphere pokes into the next one over
+PG_TEST( LightClusters_PointLightNearEdge )
+{
+    LightClusters clusters = MakeClusters();
+    const uint32_t y = 4, z = 12;
+    for ( uint32_t x = 1; x < PG_LIGHT_CLUSTERS_X; ++x )
+    {
+        glm::vec3 center   = ClusterCenter( x, y, z );
+        float depth        = -center.z;
+        float edge         = ( -1 + 2.0f * x / PG_LIGHT_CLUSTERS_X ) * std::tan( 0.5f * FOV ) * ASPECT * depth;
+        float radius       = 0.01f * depth;
+        glm::vec3 position = glm::vec3( edge + 0.5f * radius, center.y, center.z );
+        clusters.Assign( V, { glm::vec4( position, radius ) }, {}, {} );
+        PG_EXPECT( ClusterOf( clusters, position ) == ClusterIndex( x, y, z ) );
+        PG_EXPECT( HasLight( clusters, ClusterIndex( x, y, z ), 0, false ) );
+        PG_EXPECT( HasLight( clusters, ClusterIndex( x - 1, y, z ), 0, false ) );
+        PG_EXPECT( !HasLight( clusters, ClusterIndex( x, y + 1, z ), 0, false ) );
+    }
+}
+
+// Random points inside of random lights, which the cluster the point is in must always have
+PG_TEST( LightClusters_NoMissedLights )
+{
+    std::mt19937 rng( 23 );
+    LightClusters clusters = MakeClusters();
+    std::vector< glm::vec4 > pointLights, spotLights, spotCones;
+    for ( int i = 0; i < 200; ++i )
+    {
+        glm::vec4 sphere( Random( rng, -30, 30 ), Random( rng, -15, 15 ), Random( rng, -60, 2 ), Random( rng, 0.1f, 8 ) );
+        glm::vec3 dir = glm::normalize( glm::vec3( Random( rng, -1, 1 ), Random( rng, -1, 1 ), Random( rng, -1, 1 ) ) );
+        pointLights.push_back( sphere );
+        spotLights.push_back( sphere );
+        spotCones.push_back( glm::vec4( dir, glm::radians( Random( rng, 5, 80 ) ) ) );
+    }
+    clusters.Assign( V, pointLights, spotLights, spotCones );
+
+    uint32_t numMissed = 0;
+    for ( uint32_t light = 0; light < 200; ++light )
+    {
+        glm::vec3 center = glm::vec3( pointLights[light] );
+        float radius     = pointLights[light].w;
+        glm::vec3 dir    = glm::vec3( spotCones[light] );
+        for ( int sample = 0; sample < 200; ++sample )
+        {
+            glm::vec3 offset = radius * glm::vec3( Random( rng, -1, 1 ), Random( rng, -1, 1 ), Random( rng, -1, 1 ) );
+            glm::vec3 p      = center + offset;
+            float depth      = -p.z;
+            glm::vec4 params = clusters.GetShaderParams();
+            bool onScreen    = std::abs( p.x * params.x / depth ) <= 1 && std::abs( p.y * params.y / depth ) <= 1;
+            if ( glm::length( offset ) > radius || depth <= NEAR_PLANE || depth >= FAR_PLANE || !onScreen )
+            {
+                continue;
+            }
+            uint32_t cluster = ClusterOf( clusters, p );
+            numMissed += !HasLight( clusters, cluster, light, false );
+            // Same test as the lighting shaders
+            if ( glm::dot( glm::normalize( offset ), dir ) > std::cos( spotCones[light].w ) )
+            {
+                numMissed += !HasLight( clusters, cluster, light, true );
+            }
+        }
+    }
+    if ( !PG_EXPECT( numMissed == 0 ) )
+    {
+        std::cout << "  " << numMissed << " lit points were in clusters without their light" << std::endl;
+    }
+}
+
+PG_TEST( LightClusters_SpotConeExcluded )
+{
+    LightClusters clusters = MakeClusters();
+    // Pointing to the right, so everything on the left half of the sphere, and above and below it, is out of the cone
+    glm::vec4 sphere( 0, 0, -10, 8 );
+    glm::vec4 cone( 1, 0, 0, glm::radians( 15.0f ) );
+    clusters.Assign( V, { sphere }, { sphere }, { cone } );
+
+    uint32_t inCone = ClusterOf( clusters, glm::vec3( 5, 0, -10 ) );
+    PG_EXPECT( HasLight( clusters, inCone, 0, true ) );
+    for ( const glm::vec3& p : { glm::vec3( -5, 0, -10 ), glm::vec3( 0, 5, -10 ), glm::vec3( 0, -5, -10 ), glm::vec3( 1, 0, -16 ) } )
+    {
+        uint32_t cluster = ClusterOf( clusters, p );
+        PG_EXPECT( HasLight( clusters, cluster, 0, false ) );
+        PG_EXPECT( !HasLight( clusters, cluster, 0, true ) );
+    }
+}
+
+PG_TEST( LightClusters_MaxLightsPerCluster )
+{
+    LightClusters clusters = MakeClusters();
+    glm::vec3 center       = ClusterCenter( 5, 5, 10 );
+    uint32_t cluster       = ClusterIndex( 5, 5, 10 );
+    glm::vec4 sphere( center, 0.001f * -center.z );
+
+    // Extra lights are dropped, the highest indices first
+    clusters.Assign( V, std::vector< glm::vec4 >( 100, sphere ), {}, {} );
+    const Gpu::LightCluster* c = &clusters.GetClusters()[cluster];
+    PG_EXPECT( c->counts == PG_MAX_LIGHTS_PER_CLUSTER );
+    for ( uint32_t i = 0; i < PG_MAX_LIGHTS_PER_CLUSTER; ++i )
+    {
+        PG_EXPECT( clusters.GetLightIndices()[c->indexOffset + i] == i );
+    }
+
+    // Spot lights only get the room the point lights left
+    clusters.Assign( V, std::vector< glm::vec4 >( 40, sphere ), std::vector< glm::vec4 >( 40, sphere ), std::vector< glm::vec4 >( 40, WIDE_CONE ) );
+    c = &clusters.GetClusters()[cluster];
+    PG_EXPECT( ( c->counts & 0xFFFF ) == 40 );
+    PG_EXPECT( ( c->counts >> 16 ) == PG_MAX_LIGHTS_PER_CLUSTER - 40 );
+
+    clusters.Assign( V, {}, std::vector< glm::vec4 >( 70, sphere ), std::vector< glm::vec4 >( 70, WIDE_CONE ) );
+    c = &clusters.GetClusters()[cluster];
+    PG_EXPECT( c->counts == PG_MAX_LIGHTS_PER_CLUSTER << 16 );
+    PG_EXPECT( clusters.GetLightIndices().size() == PG_MAX_LIGHTS_PER_CLUSTER );
+}
+
+// Point light counts in the low 16 bits and spot lights in the high, with the point light indices first
+PG_TEST( LightClusters_PackedCounts )
+{
+    LightClusters clusters = MakeClusters();
+    glm::vec3 center       = ClusterCenter( 8, 2, 6 );
+    uint32_t cluster       = ClusterIndex( 8, 2, 6 );
+    glm::vec4 sphere( center, 0.001f * -center.z );
+    glm::vec4 elsewhere( ClusterCenter( 1, 7, 20 ), 0.01f );
+
+    std::vector< glm::vec4 > pointLights = { sphere, elsewhere, sphere, sphere };
+    std::vector< glm::vec4 > spotLights  = { elsewhere, sphere, sphere, sphere, elsewhere, sphere, sphere };
+    clusters.Assign( V, pointLights, spotLights, std::vector< glm::vec4 >( spotLights.size(), WIDE_CONE ) );
+
+    const Gpu::LightCluster& c = clusters.GetClusters()[cluster];
+    if ( !PG_EXPECT( c.counts == ( 3u | ( 5u << 16 ) ) ) )
+    {
+        return;
+    }
+    const uint32_t expected[] = { 0, 2, 3, 1, 2, 3, 5, 6 };
+    for ( uint32_t i = 0; i < 8; ++i )
+    {
+        PG_EXPECT( clusters.GetLightIndices()[c.indexOffset + i] == expected[i] );
+    }
+}
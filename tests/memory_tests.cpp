@@ -0,0 +1,111 @@
+#include "unit_test.hpp"
+#include "components/entity_metadata.hpp"
+#include "components/transform.hpp"
+#include "core/jobs.hpp"
+#include "core/memory_manager.hpp"
+#include "core/scene.hpp"
+#include "core/transform_system.hpp"
+
+using namespace Progression;
+
+#if USING( PG_COUNT_HEAP_ALLOCATIONS )
+
+// Moves every root, so the whole hierarchy gets recomputed every frame
+static void SpinRoots( Scene* scene )
+{
+    ParallelEach< Transform, EntityMetaData >( scene->registry, []( const entt::entity, Transform& transform, const EntityMetaData& metaData )
+    {
+        if ( metaData.parent == entt::null )
+        {
+            transform.Rotate( 0.01f, glm::vec3( 0, 1, 0 ) );
+        }
+    }, 16 );
+}
+
+// Like the render system's recording jobs: a wide capture, and a wait on them from inside a system
+static void SubmitWideJobs( Scene* scene )
+{
+    Jobs::Counter counter;
+    std::atomic< uint32_t > sum = { 0 };
+    const glm::vec3 offset( 1, 2, 3 );
+    for ( uint32_t i = 0; i < 64; ++i )
+    {
+        Jobs::Submit( [scene, &sum, offset, i]()
+        {
+            sum.fetch_add( i + static_cast< uint32_t >( offset.x ) + ( scene ? 1 : 0 ), std::memory_order_relaxed );
+        }, &counter );
+    }
+    Jobs::Wait( &counter );
+}
+
+#endif // #if USING( PG_COUNT_HEAP_ALLOCATIONS )
+
+// Once the first frames have sized everything, a frame of the scene systems, the transform hierarchy
+// and the job system must not touch the heap (MemoryManager::NumHeapAllocationsLastFrame)
+PG_TEST( Memory_NoHeapAllocationsAfterWarmup )
+{
+#if USING( PG_COUNT_HEAP_ALLOCATIONS )
+    Jobs::Init( 4 );
+    MemoryManager::Init();
+    {
+        Scene scene;
+        entt::registry& registry = scene.registry;
+        for ( uint32_t root = 0; root < 64; ++root )
+        {
+            entt::entity parent = registry.create();
+            registry.assign< Transform >( parent ).SetPosition( glm::vec3( root, 0, 0 ) );
+            registry.assign< EntityMetaData >( parent );
+            for ( uint32_t child = 0; child < 8; ++child )
+            {
+                entt::entity e = registry.create();
+                registry.assign< Transform >( e ).SetPosition( glm::vec3( 0, child, 0 ) );
+                TransformSystem::SetParent( registry, e, parent );
+                for ( uint32_t grandChild = 0; grandChild < 4; ++grandChild )
+                {
+                    entt::entity leaf = registry.create();
+                    registry.assign< Transform >( leaf ).SetPosition( glm::vec3( 0, 0, grandChild ) );
+                    TransformSystem::SetParent( registry, leaf, e );
+                }
+            }
+        }
+
+        SystemDescriptor spin;
+        spin.name   = "Spin";
+        spin.update = SpinRoots;
+        spin.reads  = Components< EntityMetaData >();
+        spin.writes = Components< Transform >();
+        scene.scheduler.AddSystem( spin );
+
+        SystemDescriptor transformSync;
+        transformSync.name      = "TransformSync";
+        transformSync.update    = TransformSystem::SyncHierarchy;
+        transformSync.exclusive = true;
+        scene.scheduler.AddSystem( transformSync );
+
+        SystemDescriptor transforms;
+        transforms.name   = "Transforms";
+        transforms.update = TransformSystem::Update;
+        transforms.reads  = Components< EntityMetaData >();
+        transforms.writes = Components< Transform, WorldTransform >();
+        scene.scheduler.AddSystem( transforms );
+
+        SystemDescriptor wideJobs;
+        wideJobs.name   = "WideJobs";
+        wideJobs.update = SubmitWideJobs;
+        scene.scheduler.AddSystem( wideJobs );
+
+        const int numWarmupFrames = 10;
+        for ( int frame = 0; frame < numWarmupFrames + 30; ++frame )
+        {
+            scene.Update();
+            MemoryManager::EndFrame();
+            if ( frame >= numWarmupFrames && !PG_EXPECT( MemoryManager::NumHeapAllocationsLastFrame() == 0 ) )
+            {
+                break;
+            }
+        }
+    }
+    MemoryManager::Shutdown();
+    Jobs::Shutdown();
+#endif // #if USING( PG_COUNT_HEAP_ALLOCATIONS )
+}
@@ -0,0 +1,62 @@
+#include "unit_test.hpp"
+#include "graphics/occlusion_culling.hpp"
+#include <iostream>
+#include <random>
+
+using namespace Progression;
+using namespace Progression::Gfx;
+
+// Random scenes of box occluders, sometimes behind a wall, seen through random cameras at random resolutions
+// (including odd ones, where the pyramid's texels don't split evenly). The pyramid is only an approximation,
+// but it has to be a conservative one: it can keep hidden boxes, but never cull one that the reference
+// rasterizer can see
+PG_TEST( OcclusionCulling_NoFalseCulls )
+{
+    std::mt19937 rng( 1 );
+    std::uniform_real_distribution< float > unit( 0, 1 );
+    uint32_t numFalseCulls = 0, numHidden = 0, numHiddenCulled = 0;
+    for ( int trial = 0; trial < 100; ++trial )
+    {
+        glm::vec3 eye( 4 * unit( rng ) - 2, 2 * unit( rng ), 4 * unit( rng ) - 2 );
+        glm::vec3 target = eye + glm::normalize( glm::vec3( unit( rng ) - 0.5f, 0.2f * ( unit( rng ) - 0.5f ), -1 ) );
+        glm::mat4 VP     = glm::perspective( glm::radians( 60.0f ), 16.0f / 9, 0.1f, 200.0f ) * glm::lookAt( eye, target, glm::vec3( 0, 1, 0 ) );
+        uint32_t width   = 64 + rng() % 300;
+        uint32_t height  = 32 + rng() % 200;
+
+        SoftwareDepthRasterizer rasterizer;
+        rasterizer.Init( width, height );
+        for ( int i = 0; i < 20; ++i )
+        {
+            glm::vec3 center( 40 * unit( rng ) - 20, 6 * unit( rng ) - 3, -40 * unit( rng ) );
+            glm::vec3 extent( 4 * unit( rng ) + 0.5f, 4 * unit( rng ) + 0.5f, 2 * unit( rng ) + 0.1f );
+            rasterizer.DrawBox( VP, AABB( center - extent, center + extent ) );
+        }
+        if ( trial % 2 )
+        {
+            const glm::vec3 wall[]   = { glm::vec3( -30, -10, -15 ), glm::vec3( 30, -10, -15 ), glm::vec3( 30, 10, -15 ), glm::vec3( -30, 10, -15 ) };
+            const uint32_t indices[] = { 0, 1, 2, 0, 2, 3 };
+            rasterizer.DrawTriangles( VP, wall, indices, 6 );
+        }
+
+        DepthPyramid pyramid;
+        pyramid.Build( rasterizer.GetDepths().data(), width, height, VP );
+        for ( int i = 0; i < 1000; ++i )
+        {
+            glm::vec3 center( 60 * unit( rng ) - 30, 10 * unit( rng ) - 5, 5 - 60 * unit( rng ) );
+            glm::vec3 extent( 1.5f * unit( rng ) + 0.01f );
+            AABB box( center - extent, center + extent );
+            bool visible = rasterizer.IsBoxVisible( VP, box );
+            bool culled  = !pyramid.IsBoxVisible( box );
+            numFalseCulls   += visible && culled;
+            numHidden       += !visible;
+            numHiddenCulled += !visible && culled;
+        }
+    }
+
+    if ( !PG_EXPECT( numFalseCulls == 0 ) )
+    {
+        std::cout << "  the depth pyramid culled " << numFalseCulls << " visible boxes" << std::endl;
+    }
+    // Not a correctness requirement, just a check that the test isn't passing by never culling anything
+    PG_EXPECT( numHiddenCulled > numHidden / 4 );
+}
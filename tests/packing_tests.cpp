@@ -0,0 +1,138 @@
+#include "unit_test.hpp"
+#include "graphics/shader_c_shared/packing.h"
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace Progression;
+
+// What a R16G16_UNORM target stores
+static glm::vec2 QuantizeUnorm16( const glm::vec2& v )
+{
+    return glm::round( glm::clamp( v, glm::vec2( 0 ), glm::vec2( 1 ) ) * 65535.0f ) / 65535.0f;
+}
+
+// The poles, the equator where the lower hemisphere gets folded over, and the corners of the folds
+static std::vector< glm::vec3 > OctahedronEdgeCases()
+{
+    std::vector< glm::vec3 > normals =
+    {
+        glm::vec3( 1, 0, 0 ), glm::vec3( -1, 0, 0 ), glm::vec3( 0, 1, 0 ), glm::vec3( 0, -1, 0 ), glm::vec3( 0, 0, 1 ), glm::vec3( 0, 0, -1 ),
+    };
+    for ( float x : { -1.0f, 0.0f, 1.0f } )
+    {
+        for ( float y : { -1.0f, 0.0f, 1.0f } )
+        {
+            for ( float z : { -1.0f, -1e-4f, 0.0f, 1e-4f } )
+            {
+                if ( x != 0 || y != 0 )
+                {
+                    normals.push_back( glm::normalize( glm::vec3( x, y, z ) ) );
+                }
+            }
+        }
+    }
+
+    return normals;
+}
+
+PG_TEST( Packing_OctVecRoundTrip )
+{
+    std::mt19937 rng( 5 );
+    std::normal_distribution< float > normal;
+    std::vector< glm::vec3 > normals = OctahedronEdgeCases();
+    for ( int i = 0; i < 200000; ++i )
+    {
+        normals.push_back( glm::normalize( glm::vec3( normal( rng ), normal( rng ), normal( rng ) ) ) );
+    }
+
+    // Distance between the unit vectors instead of the angle, since acos loses too much precision near 1
+    float maxError = 0, maxQuantizedError = 0;
+    bool inRange = true;
+    for ( const glm::vec3& n : normals )
+    {
+        glm::vec2 e = Gpu::EncodeOctVec( n );
+        inRange     = inRange && 0 <= e.x && e.x <= 1 && 0 <= e.y && e.y <= 1;
+        maxError          = std::max( maxError, glm::length( Gpu::DecodeOctVec( e ) - n ) );
+        maxQuantizedError = std::max( maxQuantizedError, glm::length( Gpu::DecodeOctVec( QuantizeUnorm16( e ) ) - n ) );
+    }
+    PG_EXPECT( inRange );
+    PG_EXPECT( maxError < 1e-5f );
+    // 16 bits over [-1, 1] is a step of ~3e-5, which the octahedron stretches by up to ~2x
+    if ( !PG_EXPECT( maxQuantizedError < 1e-4f ) )
+    {
+        std::cout << "  16 bit round trip error was " << maxQuantizedError << std::endl;
+    }
+
+    // Just above and just below the equator land on opposite edges of the square, but decode next to each other
+    for ( float angle = 0; angle < 6.28f; angle += 0.1f )
+    {
+        glm::vec3 above = glm::normalize( glm::vec3( std::cos( angle ), std::sin( angle ), 1e-3f ) );
+        glm::vec3 below = glm::normalize( glm::vec3( std::cos( angle ), std::sin( angle ), -1e-3f ) );
+        glm::vec3 a     = Gpu::DecodeOctVec( QuantizeUnorm16( Gpu::EncodeOctVec( above ) ) );
+        glm::vec3 b     = Gpu::DecodeOctVec( QuantizeUnorm16( Gpu::EncodeOctVec( below ) ) );
+        PG_EXPECT( glm::length( a - b ) < 3e-3f );
+        PG_EXPECT( a.z > 0 && b.z < 0 );
+    }
+}
+
+PG_TEST( Packing_DiffuseAndSpecular )
+{
+    // Anything that is already 8 bits survives exactly, along with whole number exponents
+    bool exact = true;
+    for ( int a = 0; a < 256; ++a )
+    {
+        for ( int b = 0; b < 256; ++b )
+        {
+            glm::vec3 Kd( a / 255.0f, b / 255.0f, ( a ^ b ) / 255.0f );
+            glm::vec4 Ks( b / 255.0f, a / 255.0f, ( 255 - a ) / 255.0f, static_cast< float >( a * 256 + b ) );
+            glm::uvec4 enc = Gpu::PackDiffuseAndSpecular( Kd, Ks );
+            exact = exact && glm::all( glm::lessThanEqual( glm::abs( Gpu::UnpackDiffuse( enc ) - Kd ), glm::vec3( 1e-6f ) ) );
+            exact = exact && glm::all( glm::lessThanEqual( glm::abs( Gpu::UnpackSpecular( enc ) - Ks ), glm::vec4( 1e-6f ) ) );
+        }
+    }
+    PG_EXPECT( exact );
+
+    // Everything else rounds to the nearest 8 bit value, without bleeding into the other color
+    std::mt19937 rng( 3 );
+    std::uniform_real_distribution< float > unit( 0, 1 );
+    for ( int i = 0; i < 1000; ++i )
+    {
+        glm::vec3 Kd( unit( rng ), unit( rng ), unit( rng ) );
+        glm::vec4 Ks( unit( rng ), unit( rng ), unit( rng ), 50 );
+        glm::uvec4 enc = Gpu::PackDiffuseAndSpecular( Kd, Ks );
+        PG_EXPECT_NEAR( Gpu::UnpackDiffuse( enc ), Kd, 0.5f / 255.0f + 1e-6f );
+        PG_EXPECT_NEAR( Gpu::UnpackSpecular( enc ), Ks, 0.5f / 255.0f + 1e-6f );
+    }
+}
+
+// The depth buffer value of points at known distances, through the same projection as Camera
+PG_TEST( Packing_ViewDepth )
+{
+    struct Planes
+    {
+        float nearPlane;
+        float farPlane;
+    };
+    for ( const Planes& planes : { Planes{ 0.1f, 100.0f }, Planes{ 0.1f, 500.0f }, Planes{ 1.0f, 10000.0f } } )
+    {
+        glm::mat4 P = glm::perspective( glm::radians( 60.0f ), 1.7f, planes.nearPlane, planes.farPlane );
+        glm::vec2 params( P[3][2], P[2][2] );
+        PG_EXPECT_NEAR( Gpu::ViewDepth( 0, params ), planes.nearPlane, 1e-5f * planes.nearPlane );
+        PG_EXPECT_NEAR( Gpu::ViewDepth( 1, params ), planes.farPlane, 1e-3f * planes.farPlane );
+
+        // Depth precision falls off with distance, so only the relative error is bounded
+        float maxRelativeError = 0;
+        for ( float z = planes.nearPlane; z <= planes.farPlane; z *= 1.05f )
+        {
+            glm::vec4 clip = P * glm::vec4( 0.3f, -0.2f, -z, 1 );
+            float depth    = clip.z / clip.w;
+            PG_EXPECT( 0 <= depth && depth <= 1 );
+            maxRelativeError = std::max( maxRelativeError, std::abs( Gpu::ViewDepth( depth, params ) - z ) / z );
+        }
+        if ( !PG_EXPECT( maxRelativeError < 1e-3f ) )
+        {
+            std::cout << "  near " << planes.nearPlane << ", far " << planes.farPlane << ": relative error " << maxRelativeError << std::endl;
+        }
+    }
+}
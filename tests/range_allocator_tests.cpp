@@ -0,0 +1,175 @@
+#include "unit_test.hpp"
+#include "core/range_allocator.hpp"
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace Progression;
+
+// Sizes that are multiples of 64 land exactly on a bin boundary, so a free range of a given size can
+// always be reused by an allocation of the same size. Other sizes round up when allocating and down
+// when freeing, which can skip over a range that would have fit
+static const uint32_t UNIT = 64;
+
+PG_TEST( RangeAllocator_Allocate )
+{
+    RangeAllocator allocator;
+    PG_EXPECT( !allocator.Allocate( 1 ).IsValid() );
+    PG_EXPECT( allocator.GetStats().numFreeRegions == 0 );
+
+    allocator.Init( 16 * UNIT );
+    RangeAllocator::Allocation a = allocator.Allocate( UNIT );
+    RangeAllocator::Allocation b = allocator.Allocate( 2 * UNIT );
+    RangeAllocator::Allocation c = allocator.Allocate( 3 );
+    if ( !PG_EXPECT( a.IsValid() && b.IsValid() && c.IsValid() ) )
+    {
+        return;
+    }
+    PG_EXPECT( a.offset == 0 );
+    PG_EXPECT( b.offset == UNIT );
+    PG_EXPECT( c.offset == 3 * UNIT );
+    PG_EXPECT( allocator.AllocationSize( b ) == 2 * UNIT );
+    PG_EXPECT( allocator.AllocationSize( c ) == 3 );
+
+    RangeAllocator::Stats stats = allocator.GetStats();
+    PG_EXPECT( stats.totalSize == 16 * UNIT );
+    PG_EXPECT( stats.totalFree == 13 * UNIT - 3 );
+    PG_EXPECT( stats.largestFreeRegion == 13 * UNIT - 3 );
+    PG_EXPECT( stats.numAllocations == 3 );
+    PG_EXPECT( stats.numFreeRegions == 1 );
+    PG_EXPECT( stats.fragmentation == 0 );
+}
+
+PG_TEST( RangeAllocator_FreeReusesRange )
+{
+    RangeAllocator allocator( 16 * UNIT );
+    RangeAllocator::Allocation a = allocator.Allocate( UNIT );
+    RangeAllocator::Allocation b = allocator.Allocate( 2 * UNIT );
+    RangeAllocator::Allocation c = allocator.Allocate( UNIT );
+    allocator.Free( b );
+    PG_EXPECT( allocator.GetStats().numAllocations == 2 );
+    PG_EXPECT( allocator.GetStats().numFreeRegions == 2 );
+
+    // The hole left by b is the only free range with exactly the right size
+    RangeAllocator::Allocation d = allocator.Allocate( 2 * UNIT );
+    PG_EXPECT( d.IsValid() && d.offset == UNIT );
+    PG_EXPECT( allocator.GetStats().numFreeRegions == 1 );
+    PG_EXPECT( a.offset == 0 && c.offset == 3 * UNIT );
+}
+
+PG_TEST( RangeAllocator_CoalescesNeighbors )
+{
+    // Every order of freeing three neighbors, so the merge with the previous range, the next range, and
+    // both at once all get hit
+    uint32_t order[] = { 0, 1, 2 };
+    do
+    {
+        RangeAllocator allocator( 3 * UNIT );
+        RangeAllocator::Allocation allocs[3];
+        for ( RangeAllocator::Allocation& alloc : allocs )
+        {
+            alloc = allocator.Allocate( UNIT );
+        }
+        PG_EXPECT( allocator.GetStats().numFreeRegions == 0 );
+
+        for ( uint32_t i : order )
+        {
+            allocator.Free( allocs[i] );
+        }
+        RangeAllocator::Stats stats = allocator.GetStats();
+        PG_EXPECT( stats.numAllocations == 0 );
+        PG_EXPECT( stats.numFreeRegions == 1 );
+        PG_EXPECT( stats.largestFreeRegion == 3 * UNIT );
+
+        // Only possible if all three were merged back into one range
+        RangeAllocator::Allocation all = allocator.Allocate( 3 * UNIT );
+        PG_EXPECT( all.IsValid() && all.offset == 0 );
+    } while ( std::next_permutation( order, order + 3 ) );
+}
+
+PG_TEST( RangeAllocator_OutOfSpace )
+{
+    RangeAllocator allocator( 8 * UNIT );
+    RangeAllocator::Allocation allocs[8];
+    for ( RangeAllocator::Allocation& alloc : allocs )
+    {
+        alloc = allocator.Allocate( UNIT );
+        PG_EXPECT( alloc.IsValid() );
+    }
+    PG_EXPECT( !allocator.Allocate( 1 ).IsValid() );
+
+    // Half of the space is free, but no range is bigger than one unit
+    for ( uint32_t i = 0; i < 8; i += 2 )
+    {
+        allocator.Free( allocs[i] );
+    }
+    RangeAllocator::Stats stats = allocator.GetStats();
+    PG_EXPECT( stats.totalFree == 4 * UNIT );
+    PG_EXPECT( stats.largestFreeRegion == UNIT );
+    PG_EXPECT_NEAR( stats.fragmentation, 0.75f, 1e-6f );
+    PG_EXPECT( !allocator.Allocate( UNIT + 1 ).IsValid() );
+    PG_EXPECT( !allocator.Allocate( 2 * UNIT ).IsValid() );
+    PG_EXPECT( allocator.Allocate( UNIT ).IsValid() );
+    PG_EXPECT( allocator.GetStats().numAllocations == 5 );
+}
+
+// Random allocations and frees, checked against a list of the live ranges
+PG_TEST( RangeAllocator_RandomNoOverlap )
+{
+    struct Live
+    {
+        RangeAllocator::Allocation alloc;
+        uint32_t size;
+    };
+
+    const uint32_t size = 1 << 16;
+    std::mt19937 rng( 19 );
+    RangeAllocator allocator( size );
+    std::vector< Live > live;
+    uint32_t numOverlaps = 0;
+    for ( int i = 0; i < 20000; ++i )
+    {
+        if ( live.empty() || rng() % 3 != 0 )
+        {
+            uint32_t allocSize = 1 + rng() % 1000;
+            RangeAllocator::Allocation alloc = allocator.Allocate( allocSize );
+            if ( !alloc.IsValid() )
+            {
+                continue;
+            }
+            PG_EXPECT( alloc.offset + allocSize <= size );
+            for ( const Live& other : live )
+            {
+                numOverlaps += alloc.offset < other.alloc.offset + other.size && other.alloc.offset < alloc.offset + allocSize;
+            }
+            live.push_back( { alloc, allocSize } );
+        }
+        else
+        {
+            uint32_t index = rng() % live.size();
+            allocator.Free( live[index].alloc );
+            live[index] = live.back();
+            live.pop_back();
+        }
+    }
+    if ( !PG_EXPECT( numOverlaps == 0 ) )
+    {
+        std::cout << "  " << numOverlaps << " allocations overlapped a live one" << std::endl;
+    }
+
+    uint32_t liveSize = 0;
+    for ( const Live& l : live )
+    {
+        liveSize += l.size;
+    }
+    PG_EXPECT( allocator.GetStats().totalFree == size - liveSize );
+
+    for ( const Live& l : live )
+    {
+        allocator.Free( l.alloc );
+    }
+    RangeAllocator::Stats stats = allocator.GetStats();
+    PG_EXPECT( stats.numFreeRegions == 1 );
+    PG_EXPECT( stats.largestFreeRegion == size );
+}
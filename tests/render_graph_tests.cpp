@@ -0,0 +1,284 @@
+#include "unit_test.hpp"
+#include "graphics/render_graph.hpp"
+
+using namespace Progression;
+using namespace Progression::Gfx;
+
+static const uint32_t WIDTH  = 1280;
+static const uint32_t HEIGHT = 720;
+
+// Tightly packed textures, all in the same memory type
+static RenderGraph::MemoryRequirements GetMemoryRequirements( RenderGraph::TextureHandle, const RenderGraph::TextureDesc& desc )
+{
+    uint64_t bytesPerPixel = 4;
+    if ( desc.format == PixelFormat::R32_G32_B32_A32_FLOAT )
+    {
+        bytesPerPixel = 16;
+    }
+    else if ( desc.format == PixelFormat::R8_UNORM )
+    {
+        bytesPerPixel = 1;
+    }
+
+    RenderGraph::MemoryRequirements req;
+    req.size           = desc.width * desc.height * bytesPerPixel;
+    req.alignment      = 4096;
+    req.memoryTypeBits = 1;
+    return req;
+}
+
+static const RenderGraph::Barrier* FindBarrier( const std::vector< RenderGraph::Barrier >& barriers, RenderGraph::TextureHandle texture )
+{
+    for ( const RenderGraph::Barrier& barrier : barriers )
+    {
+        if ( barrier.texture == texture )
+        {
+            return &barrier;
+        }
+    }
+
+    return nullptr;
+}
+
+// A cut down version of the renderer's frame, along with a pair of passes that only feed each other
+struct DeferredGraph
+{
+    RenderGraph graph;
+    RenderGraph::TextureHandle shadowMap, depth, positions, normals, ssaoDepth, ssao, ssaoBlur, litScene, unusedInput, unused;
+    uint32_t shadowPass, gBufferPass, unusedInputPass, unusedPass, ssaoPass, ssaoBlurPass, lightingPass;
+
+    DeferredGraph()
+    {
+        shadowMap   = graph.ImportTexture( "shadow map", PixelFormat::DEPTH_32_FLOAT, ImageLayout::SHADER_READ_ONLY_OPTIMAL );
+        depth       = graph.ImportTexture( "depth", PixelFormat::DEPTH_32_FLOAT, ImageLayout::DEPTH_STENCIL_ATTACHMENT_OPTIMAL, WIDTH, HEIGHT );
+        positions   = graph.CreateTexture( "positions", PixelFormat::R32_G32_B32_A32_FLOAT, WIDTH, HEIGHT );
+        normals     = graph.CreateTexture( "normals", PixelFormat::R8_G8_B8_A8_UNORM, WIDTH, HEIGHT );
+        ssaoDepth   = graph.CreateTexture( "ssao depth", PixelFormat::DEPTH_32_FLOAT, WIDTH, HEIGHT );
+        ssao        = graph.CreateTexture( "ssao", PixelFormat::R8_UNORM, WIDTH, HEIGHT );
+        ssaoBlur    = graph.CreateTexture( "ssao blur", PixelFormat::R8_UNORM, WIDTH, HEIGHT );
+        litScene    = graph.CreateTexture( "lit scene", PixelFormat::R8_G8_B8_A8_UNORM, WIDTH, HEIGHT );
+        unusedInput = graph.CreateTexture( "unused input", PixelFormat::R8_G8_B8_A8_UNORM, WIDTH, HEIGHT );
+        unused      = graph.CreateTexture( "unused", PixelFormat::R8_G8_B8_A8_UNORM, WIDTH, HEIGHT );
+        graph.MarkOutput( litScene, ImageLayout::SHADER_READ_ONLY_OPTIMAL );
+
+        shadowPass      = graph.AddPass( "shadow" ).SetDepthOutput( shadowMap ).GetIndex();
+        gBufferPass     = graph.AddPass( "gbuffer" ).AddColorOutput( positions ).AddColorOutput( normals ).SetDepthOutput( depth ).GetIndex();
+        unusedInputPass = graph.AddPass( "unused input" ).AddColorOutput( unusedInput ).AddTextureInput( positions ).GetIndex();
+        unusedPass      = graph.AddPass( "unused" ).AddColorOutput( unused ).AddTextureInput( unusedInput ).GetIndex();
+        ssaoPass        = graph.AddPass( "ssao" ).AddColorOutput( ssao ).SetDepthOutput( ssaoDepth ).AddTextureInput( positions ).AddTextureInput( normals ).GetIndex();
+        ssaoBlurPass    = graph.AddPass( "ssao blur" ).AddColorOutput( ssaoBlur ).AddTextureInput( ssao ).GetIndex();
+        lightingPass    = graph.AddPass( "lighting" )
+            .AddColorOutput( litScene )
+            .SetDepthOutput( depth, LoadAction::LOAD )
+            .AddTextureInput( positions )
+            .AddTextureInput( normals )
+            .AddTextureInput( ssaoBlur )
+            .AddTextureInput( shadowMap )
+            .GetIndex();
+    }
+};
+
+PG_TEST( RenderGraph_CullsUnusedPasses )
+{
+    DeferredGraph g;
+    if ( !PG_EXPECT( g.graph.Compile( GetMemoryRequirements ) ) )
+    {
+        return;
+    }
+
+    PG_EXPECT( g.graph.GetPass( g.unusedPass ).IsCulled() );
+    PG_EXPECT( g.graph.GetPass( g.unusedInputPass ).IsCulled() ); // only the culled pass reads what it writes
+    for ( uint32_t pass : { g.shadowPass, g.gBufferPass, g.ssaoPass, g.ssaoBlurPass, g.lightingPass } )
+    {
+        PG_EXPECT( !g.graph.GetPass( pass ).IsCulled() );
+    }
+    PG_EXPECT( g.graph.GetPlacement( g.unused ).heap == RenderGraph::INVALID_HANDLE );
+    PG_EXPECT( g.graph.GetPlacement( g.unusedInput ).firstPass == RenderGraph::INVALID_HANDLE );
+    PG_EXPECT( g.graph.GetPass( g.unusedPass ).GetBarriers().empty() );
+
+    // Clearing a texture means nothing before it has to write it, while loading it keeps the writer alive
+    for ( LoadAction loadAction : { LoadAction::CLEAR, LoadAction::LOAD } )
+    {
+        RenderGraph graph;
+        RenderGraph::TextureHandle scratch = graph.CreateTexture( "scratch", PixelFormat::R8_G8_B8_A8_UNORM, WIDTH, HEIGHT );
+        RenderGraph::TextureHandle output  = graph.CreateTexture( "output", PixelFormat::R8_G8_B8_A8_UNORM, WIDTH, HEIGHT );
+        graph.MarkOutput( output, ImageLayout::SHADER_READ_ONLY_OPTIMAL );
+        uint32_t first      = graph.AddPass( "first" ).AddColorOutput( scratch ).GetIndex();
+        uint32_t second     = graph.AddPass( "second" ).AddColorOutput( scratch, loadAction ).GetIndex();
+        uint32_t resolve    = graph.AddPass( "resolve" ).AddColorOutput( output ).AddTextureInput( scratch ).GetIndex();
+        uint32_t sideEffect = graph.AddPass( "side effect" ).AddTextureInput( output ).GetIndex();
+        if ( !PG_EXPECT( graph.Compile( GetMemoryRequirements ) ) )
+        {
+            continue;
+        }
+        PG_EXPECT( graph.GetPass( first ).IsCulled() == ( loadAction == LoadAction::CLEAR ) );
+        PG_EXPECT( !graph.GetPass( second ).IsCulled() );
+        PG_EXPECT( !graph.GetPass( resolve ).IsCulled() );
+        PG_EXPECT( !graph.GetPass( sideEffect ).IsCulled() ); // writes nothing, so it is only there for its side effects
+    }
+}
+
+PG_TEST( RenderGraph_StoreActions )
+{
+    DeferredGraph g;
+    if ( !PG_EXPECT( g.graph.Compile( GetMemoryRequirements ) ) )
+    {
+        return;
+    }
+
+    // Read by later passes, or used after the graph
+    const RenderGraph::Pass& gBuffer = g.graph.GetPass( g.gBufferPass );
+    PG_EXPECT( gBuffer.GetColorOutputs()[0].storeAction == StoreAction::STORE );
+    PG_EXPECT( gBuffer.GetColorOutputs()[1].storeAction == StoreAction::STORE );
+    PG_EXPECT( gBuffer.GetDepthOutput().storeAction == StoreAction::STORE );
+    PG_EXPECT( g.graph.GetPass( g.ssaoBlurPass ).GetColorOutputs()[0].storeAction == StoreAction::STORE );
+    PG_EXPECT( g.graph.GetPass( g.shadowPass ).GetDepthOutput().storeAction == StoreAction::STORE );
+    const RenderGraph::Pass& lighting = g.graph.GetPass( g.lightingPass );
+    PG_EXPECT( lighting.GetColorOutputs()[0].storeAction == StoreAction::STORE );
+    PG_EXPECT( lighting.GetDepthOutput().storeAction == StoreAction::STORE ); // imported
+
+    // Never read after the pass that writes it
+    PG_EXPECT( g.graph.GetPass( g.ssaoPass ).GetDepthOutput().storeAction == StoreAction::DONT_CARE );
+}
+
+PG_TEST( RenderGraph_Barriers )
+{
+    DeferredGraph g;
+    if ( !PG_EXPECT( g.graph.Compile( GetMemoryRequirements, false ) ) )
+    {
+        return;
+    }
+    const VkPipelineStageFlags depthStages = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    const VkAccessFlags depthAccess        = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    const VkAccessFlags colorAccess        = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+    // First uses. Cleared textures don't care what they held, but still wait on whatever used them last frame.
+    // Imported textures could have been written outside of the graph
+    const RenderGraph::Barrier* b = FindBarrier( g.graph.GetPass( g.shadowPass ).GetBarriers(), g.shadowMap );
+    if ( PG_EXPECT( b ) )
+    {
+        PG_EXPECT( b->oldLayout == ImageLayout::UNDEFINED );
+        PG_EXPECT( b->newLayout == ImageLayout::DEPTH_STENCIL_ATTACHMENT_OPTIMAL );
+        PG_EXPECT( b->srcStages == VK_PIPELINE_STAGE_ALL_COMMANDS_BIT );
+        PG_EXPECT( b->srcAccess == VK_ACCESS_MEMORY_WRITE_BIT );
+        PG_EXPECT( b->dstStages == depthStages );
+        PG_EXPECT( b->dstAccess == depthAccess );
+    }
+    b = FindBarrier( g.graph.GetPass( g.gBufferPass ).GetBarriers(), g.positions );
+    if ( PG_EXPECT( b ) )
+    {
+        PG_EXPECT( b->oldLayout == ImageLayout::UNDEFINED );
+        PG_EXPECT( b->newLayout == ImageLayout::COLOR_ATTACHMENT_OPTIMAL );
+        PG_EXPECT( b->srcStages == VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT ); // sampled by the ssao and lighting passes
+        PG_EXPECT( b->srcAccess == 0 );
+        PG_EXPECT( b->dstStages == VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT );
+        PG_EXPECT( b->dstAccess == colorAccess );
+    }
+
+    // Written, then sampled
+    b = FindBarrier( g.graph.GetPass( g.ssaoPass ).GetBarriers(), g.positions );
+    if ( PG_EXPECT( b ) )
+    {
+        PG_EXPECT( b->oldLayout == ImageLayout::COLOR_ATTACHMENT_OPTIMAL );
+        PG_EXPECT( b->newLayout == ImageLayout::SHADER_READ_ONLY_OPTIMAL );
+        PG_EXPECT( b->srcStages == VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT );
+        PG_EXPECT( b->srcAccess == VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT );
+        PG_EXPECT( b->dstStages == VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT );
+        PG_EXPECT( b->dstAccess == VK_ACCESS_SHADER_READ_BIT );
+    }
+    const std::vector< RenderGraph::Barrier >& lightingBarriers = g.graph.GetPass( g.lightingPass ).GetBarriers();
+    b = FindBarrier( lightingBarriers, g.shadowMap );
+    if ( PG_EXPECT( b ) )
+    {
+        PG_EXPECT( b->oldLayout == ImageLayout::DEPTH_STENCIL_ATTACHMENT_OPTIMAL );
+        PG_EXPECT( b->newLayout == ImageLayout::SHADER_READ_ONLY_OPTIMAL );
+        PG_EXPECT( b->srcStages == depthStages );
+        PG_EXPECT( b->srcAccess == VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT );
+        PG_EXPECT( b->dstStages == VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT );
+        PG_EXPECT( b->dstAccess == VK_ACCESS_SHADER_READ_BIT );
+    }
+
+    // Written twice in the same layout
+    b = FindBarrier( lightingBarriers, g.depth );
+    if ( PG_EXPECT( b ) )
+    {
+        PG_EXPECT( b->oldLayout == ImageLayout::DEPTH_STENCIL_ATTACHMENT_OPTIMAL );
+        PG_EXPECT( b->newLayout == ImageLayout::DEPTH_STENCIL_ATTACHMENT_OPTIMAL );
+        PG_EXPECT( b->srcStages == depthStages );
+        PG_EXPECT( b->srcAccess == VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT );
+        PG_EXPECT( b->dstAccess == depthAccess );
+    }
+
+    // Sampled again in the same layout
+    PG_EXPECT( !FindBarrier( lightingBarriers, g.positions ) );
+    PG_EXPECT( !FindBarrier( lightingBarriers, g.normals ) );
+
+    // The depth attachment was written, and the output has to change layouts. The shadow map is already in
+    // its final layout, and was only read since its last barrier
+    const std::vector< RenderGraph::Barrier >& finalBarriers = g.graph.GetFinalBarriers();
+    PG_EXPECT( finalBarriers.size() == 2 );
+    PG_EXPECT( !FindBarrier( finalBarriers, g.shadowMap ) );
+    b = FindBarrier( finalBarriers, g.depth );
+    if ( PG_EXPECT( b ) )
+    {
+        PG_EXPECT( b->oldLayout == ImageLayout::DEPTH_STENCIL_ATTACHMENT_OPTIMAL );
+        PG_EXPECT( b->newLayout == ImageLayout::DEPTH_STENCIL_ATTACHMENT_OPTIMAL );
+        PG_EXPECT( b->srcStages == depthStages );
+        PG_EXPECT( b->srcAccess == VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT );
+        PG_EXPECT( b->dstStages == VK_PIPELINE_STAGE_ALL_COMMANDS_BIT );
+        PG_EXPECT( b->dstAccess == ( VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT ) );
+    }
+    b = FindBarrier( finalBarriers, g.litScene );
+    if ( PG_EXPECT( b ) )
+    {
+        PG_EXPECT( b->oldLayout == ImageLayout::COLOR_ATTACHMENT_OPTIMAL );
+        PG_EXPECT( b->newLayout == ImageLayout::SHADER_READ_ONLY_OPTIMAL );
+        PG_EXPECT( b->srcStages == VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT );
+        PG_EXPECT( b->srcAccess == VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT );
+        PG_EXPECT( b->dstStages == VK_PIPELINE_STAGE_ALL_COMMANDS_BIT );
+        PG_EXPECT( b->dstAccess == VK_ACCESS_MEMORY_READ_BIT ); // outputs are only read after the graph
+    }
+}
+
+// first -> second -> third, where only the neighbouring textures are ever alive at the same time
+PG_TEST( RenderGraph_Aliasing )
+{
+    for ( bool aliasing : { true, false } )
+    {
+        RenderGraph graph;
+        RenderGraph::TextureHandle first  = graph.CreateTexture( "first", PixelFormat::R8_G8_B8_A8_UNORM, WIDTH, HEIGHT );
+        RenderGraph::TextureHandle second = graph.CreateTexture( "second", PixelFormat::R8_G8_B8_A8_UNORM, WIDTH, HEIGHT );
+        RenderGraph::TextureHandle third  = graph.CreateTexture( "third", PixelFormat::R8_G8_B8_A8_UNORM, WIDTH, HEIGHT );
+        graph.MarkOutput( third, ImageLayout::SHADER_READ_ONLY_OPTIMAL );
+        graph.AddPass( "write first" ).AddColorOutput( first );
+        graph.AddPass( "write second" ).AddColorOutput( second ).AddTextureInput( first );
+        uint32_t writeThird = graph.AddPass( "write third" ).AddColorOutput( third ).AddTextureInput( second ).GetIndex();
+        if ( !PG_EXPECT( graph.Compile( GetMemoryRequirements, aliasing ) ) )
+        {
+            continue;
+        }
+
+        const uint64_t textureSize = WIDTH * HEIGHT * 4;
+        PG_EXPECT( !graph.MemoryOverlaps( first, second ) );
+        PG_EXPECT( !graph.MemoryOverlaps( second, third ) );
+        PG_EXPECT( graph.MemoryOverlaps( first, third ) == aliasing );
+        PG_EXPECT( graph.MemoryOverlaps( first, first ) );
+        if ( PG_EXPECT( graph.GetHeaps().size() == 1 ) )
+        {
+            PG_EXPECT( graph.GetHeaps()[0].size == ( aliasing ? 2 : 3 ) * textureSize );
+        }
+
+        // The first use of a texture also has to wait on the textures it shares memory with
+        const RenderGraph::Barrier* b = FindBarrier( graph.GetPass( writeThird ).GetBarriers(), third );
+        if ( PG_EXPECT( b ) )
+        {
+            VkPipelineStageFlags expectedStages = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+            if ( aliasing )
+            {
+                expectedStages |= VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+            }
+            PG_EXPECT( b->oldLayout == ImageLayout::UNDEFINED );
+            PG_EXPECT( b->srcStages == expectedStages );
+        }
+    }
+}
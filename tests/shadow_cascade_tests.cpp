@@ -0,0 +1,194 @@
+#include "unit_test.hpp"
+#include "graphics/shadow_cascades.hpp"
+#include <cmath>
+#include <iostream>
+#include <random>
+
+using namespace Progression;
+using namespace Progression::Gfx;
+
+static const glm::uvec2 RESOLUTION( 1024 );
+
+static float Random( std::mt19937& rng, float min, float max )
+{
+    return std::uniform_real_distribution< float >( min, max )( rng );
+}
+
+static Camera RandomCamera( std::mt19937& rng )
+{
+    Camera camera;
+    camera.position    = glm::vec3( Random( rng, -50, 50 ), Random( rng, -5, 20 ), Random( rng, -50, 50 ) );
+    camera.rotation    = glm::vec3( Random( rng, -1.5f, 1.5f ), Random( rng, -3.14f, 3.14f ), 0 );
+    camera.fov         = glm::radians( Random( rng, 30, 100 ) );
+    camera.aspectRatio = Random( rng, 0.5f, 2.5f );
+    camera.UpdateFrustum();
+    return camera;
+}
+
+static glm::vec3 RandomLightDir( std::mt19937& rng )
+{
+    return glm::normalize( glm::vec3( Random( rng, -1, 1 ), Random( rng, -1, -0.05f ), Random( rng, -1, 1 ) ) );
+}
+
+// A point of the camera frustum, at view depth d. x and y go from -1 to 1 across it
+static glm::vec3 FrustumPoint( const Camera& camera, float d, float x, float y )
+{
+    float tanY = std::tan( 0.5f * camera.fov );
+    float tanX = tanY * camera.aspectRatio;
+    return camera.position + d * ( camera.GetForwardDir() + x * tanX * camera.GetRightDir() + y * tanY * camera.GetUpDir() );
+}
+
+static bool InsideCascade( const ShadowCascade& cascade, const glm::vec3& p )
+{
+    const float epsilon = 1e-4f;
+    glm::vec4 clip = cascade.GetVP() * glm::vec4( p, 1 );
+    return std::abs( clip.x ) <= 1 + epsilon && std::abs( clip.y ) <= 1 + epsilon && clip.z >= -epsilon && clip.z <= 1 + epsilon;
+}
+
+static AABB BoxAround( const glm::vec3& center, float halfSize )
+{
+    return AABB( center - glm::vec3( halfSize ), center + glm::vec3( halfSize ) );
+}
+
+PG_TEST( ShadowCascades_Splits )
+{
+    float splits[PG_NUM_SHADOW_CASCADES];
+    for ( float lambda : { 0.0f, 0.5f, 0.75f, 1.0f } )
+    {
+        ComputeCascadeSplits( 0.1f, 100.0f, lambda, splits );
+        PG_EXPECT( splits[0] > 0.1f );
+        for ( uint32_t i = 1; i < PG_NUM_SHADOW_CASCADES; ++i )
+        {
+            PG_EXPECT( splits[i] > splits[i - 1] );
+        }
+        PG_EXPECT( splits[PG_NUM_SHADOW_CASCADES - 1] == 100.0f );
+    }
+}
+
+// The corners and random points of every slice, for random cameras and lights
+PG_TEST( ShadowCascades_SliceInsideCascade )
+{
+    std::mt19937 rng( 7 );
+    float splits[PG_NUM_SHADOW_CASCADES];
+    uint32_t numOutside = 0;
+    for ( int trial = 0; trial < 500; ++trial )
+    {
+        Camera camera      = RandomCamera( rng );
+        glm::vec3 lightDir = trial % 50 == 0 ? glm::vec3( 0, -1, 0 ) : RandomLightDir( rng );
+        float nearPlane    = Random( rng, 0.05f, 1 );
+        ComputeCascadeSplits( nearPlane, Random( rng, 20, 500 ), Random( rng, 0, 1 ), splits );
+        for ( uint32_t i = 0; i < PG_NUM_SHADOW_CASCADES; ++i )
+        {
+            float sliceStart = i == 0 ? nearPlane : splits[i - 1];
+            float sliceEnd   = splits[i];
+            ShadowCascade cascade;
+            cascade.Fit( camera, lightDir, sliceStart, sliceEnd, RESOLUTION );
+
+            for ( float d : { sliceStart, sliceEnd } )
+            {
+                for ( float x : { -1.0f, 1.0f } )
+                {
+                    for ( float y : { -1.0f, 1.0f } )
+                    {
+                        numOutside += !InsideCascade( cascade, FrustumPoint( camera, d, x, y ) );
+                    }
+                }
+            }
+            for ( int sample = 0; sample < 50; ++sample )
+            {
+                glm::vec3 p = FrustumPoint( camera, Random( rng, sliceStart, sliceEnd ), Random( rng, -1, 1 ), Random( rng, -1, 1 ) );
+                numOutside += !InsideCascade( cascade, p );
+            }
+        }
+    }
+    if ( !PG_EXPECT( numOutside == 0 ) )
+    {
+        std::cout << "  " << numOutside << " points of the camera frustum were outside of their cascade" << std::endl;
+    }
+}
+
+PG_TEST( ShadowCascades_SizeStableUnderRotation )
+{
+    std::mt19937 rng( 11 );
+    Camera camera;
+    camera.UpdateFrustum();
+    glm::vec3 lightDir = glm::normalize( glm::vec3( 0.3f, -1, 0.2f ) );
+    ShadowCascade reference;
+    reference.Fit( camera, lightDir, 1, 10, RESOLUTION );
+
+    for ( int i = 0; i < 100; ++i )
+    {
+        camera.rotation = glm::vec3( Random( rng, -1.5f, 1.5f ), Random( rng, -3.14f, 3.14f ), 0 );
+        camera.UpdateFrustum();
+        ShadowCascade cascade;
+        cascade.Fit( camera, lightDir, 1, 10, RESOLUTION );
+        // Only the translation can change, since the light's rotation and the ortho projection's size are fixed
+        for ( int column = 0; column < 3; ++column )
+        {
+            PG_EXPECT_NEAR( glm::vec3( cascade.GetVP()[column] ), glm::vec3( reference.GetVP()[column] ), 1e-6f );
+        }
+    }
+}
+
+// Moving the camera can only move a fixed world point by whole texels in the shadow map, including when
+// the cascade's part of the shadow map isn't square
+PG_TEST( ShadowCascades_TexelSnapping )
+{
+    for ( const glm::uvec2& resolution : { RESOLUTION, glm::uvec2( 1024, 512 ), glm::uvec2( 300, 1000 ) } )
+    {
+        std::mt19937 rng( 13 );
+        Camera camera;
+        camera.UpdateFrustum();
+        glm::vec3 lightDir = glm::normalize( glm::vec3( 0.3f, -1, 0.2f ) );
+        const glm::vec4 worldPoint( 3, 1, 2, 1 );
+        ShadowCascade reference;
+        reference.Fit( camera, lightDir, 1, 10, resolution );
+        glm::vec4 referenceClip = reference.GetVP() * worldPoint;
+
+        for ( int i = 0; i < 100; ++i )
+        {
+            camera.position = glm::vec3( Random( rng, -5, 5 ), Random( rng, -5, 5 ), Random( rng, -5, 5 ) );
+            camera.UpdateFrustum();
+            ShadowCascade cascade;
+            cascade.Fit( camera, lightDir, 1, 10, resolution );
+            glm::vec4 clip = cascade.GetVP() * worldPoint;
+            glm::vec2 texels = 0.5f * glm::vec2( resolution ) * ( glm::vec2( clip ) - glm::vec2( referenceClip ) );
+            PG_EXPECT_NEAR( texels, glm::round( texels ), 1e-2f );
+        }
+    }
+}
+
+PG_TEST( ShadowCascades_AddCaster )
+{
+    std::mt19937 rng( 17 );
+    for ( int trial = 0; trial < 500; ++trial )
+    {
+        Camera camera      = RandomCamera( rng );
+        glm::vec3 lightDir = RandomLightDir( rng );
+        float sliceStart   = Random( rng, 0.1f, 20 );
+        float sliceEnd     = sliceStart + Random( rng, 1, 100 );
+        ShadowCascade cascade;
+        cascade.Fit( camera, lightDir, sliceStart, sliceEnd, RESOLUTION );
+        glm::vec3 middle = camera.position + 0.5f * ( sliceStart + sliceEnd ) * camera.GetForwardDir();
+
+        // Inside of the slice, so the depth range already covers it
+        glm::mat4 VP = cascade.GetVP();
+        PG_EXPECT( cascade.AddCaster( BoxAround( middle, 0.5f ) ) );
+        PG_EXPECT( cascade.GetVP() == VP );
+
+        // Between the light and the slice. The near plane gets pulled back, so the caster isn't clipped
+        glm::vec3 inFront = middle - ( 3 * sliceEnd + 10 ) * lightDir;
+        if ( PG_EXPECT( cascade.AddCaster( BoxAround( inFront, 1 ) ) ) )
+        {
+            PG_EXPECT( InsideCascade( cascade, inFront - lightDir ) );
+            PG_EXPECT( InsideCascade( cascade, FrustumPoint( camera, sliceEnd, 1, 1 ) ) );
+        }
+
+        // Past the slice, and beside the cascade
+        glm::vec3 behind = middle + ( 10 * sliceEnd + 10 ) * lightDir;
+        PG_EXPECT( !cascade.AddCaster( BoxAround( behind, 1 ) ) );
+        glm::vec3 side   = glm::normalize( glm::cross( lightDir, glm::vec3( 0, 0, 1 ) ) );
+        glm::vec3 beside = middle + ( 10 * sliceEnd + 10 ) * side;
+        PG_EXPECT( !cascade.AddCaster( BoxAround( beside, 1 ) ) );
+    }
+}
@@ -0,0 +1,73 @@
+#include "unit_test.hpp"
+#include "core/skinning.hpp"
+#include "resource/model.hpp"
+
+using namespace Progression;
+
+// Four vertices: two fully on one joint each, and two blended between both
+static void MakeTwoJointModel( Model& model, bool withTangents )
+{
+    model.vertices = { glm::vec3( 1, 0, 0 ), glm::vec3( 0, 1, 0 ), glm::vec3( 0, 0, 1 ), glm::vec3( 1, 2, 3 ) };
+    model.normals  = { glm::vec3( 0, 1, 0 ), glm::vec3( 1, 0, 0 ), glm::vec3( 0, 0, 1 ), glm::normalize( glm::vec3( 1, 1, 1 ) ) };
+    model.uvs      = { glm::vec2( 0 ), glm::vec2( 1, 0 ), glm::vec2( 0, 1 ), glm::vec2( 1 ) };
+    if ( withTangents )
+    {
+        model.tangents = { glm::vec3( 1, 0, 0 ), glm::vec3( 0, 0, 1 ), glm::vec3( 0, 1, 0 ), glm::normalize( glm::vec3( 1, -1, 0 ) ) };
+    }
+    model.blendWeights.resize( 4 );
+    model.blendWeights[0].AddJointData( 0, 1 );
+    model.blendWeights[1].AddJointData( 1, 1 );
+    model.blendWeights[2].AddJointData( 0, 0.5f );
+    model.blendWeights[2].AddJointData( 1, 0.5f );
+    model.blendWeights[3].AddJointData( 0, 0.25f );
+    model.blendWeights[3].AddJointData( 1, 0.75f );
+    model.skeleton.joints.resize( 2 );
+}
+
+static std::vector< glm::mat4 > MakeJointTransforms()
+{
+    return
+    {
+        glm::translate( glm::mat4( 1 ), glm::vec3( 0, 0, 5 ) ),
+        glm::rotate( glm::mat4( 1 ), glm::radians( 90.0f ), glm::vec3( 0, 1, 0 ) ),
+    };
+}
+
+PG_TEST( Skinning_SingleJointVertices )
+{
+    Model model;
+    MakeTwoJointModel( model, true );
+    std::vector< glm::mat4 > jointTransforms = MakeJointTransforms();
+    Skinning::SkinnedVertices skinned;
+    Skinning::SkinModel( model, jointTransforms, skinned );
+
+    if ( !PG_EXPECT( skinned.positions.size() == 4 && skinned.normals.size() == 4 && skinned.tangents.size() == 4 ) )
+    {
+        return;
+    }
+    // Joint 0 only translates, joint 1 turns a quarter around y, taking +x to -z
+    PG_EXPECT_NEAR( skinned.positions[0], glm::vec3( 1, 0, 5 ), 1e-5f );
+    PG_EXPECT_NEAR( skinned.normals[0], glm::vec3( 0, 1, 0 ), 1e-5f );
+    PG_EXPECT_NEAR( skinned.tangents[0], glm::vec3( 1, 0, 0 ), 1e-5f );
+    PG_EXPECT_NEAR( skinned.positions[1], glm::vec3( 0, 1, 0 ), 1e-5f );
+    PG_EXPECT_NEAR( skinned.normals[1], glm::vec3( 0, 0, -1 ), 1e-5f );
+    PG_EXPECT_NEAR( skinned.tangents[1], glm::vec3( 1, 0, 0 ), 1e-5f );
+}
+
+PG_TEST( Skinning_BlendsJointMatrices )
+{
+    Model model;
+    MakeTwoJointModel( model, false );
+    std::vector< glm::mat4 > jointTransforms = MakeJointTransforms();
+    Skinning::SkinnedVertices skinned;
+    Skinning::SkinModel( model, jointTransforms, skinned );
+    PG_EXPECT( skinned.tangents.empty() );
+
+    // The matrices get blended, not the skinned positions, which only matters for the normals here
+    glm::mat4 blended = 0.5f * jointTransforms[0] + 0.5f * jointTransforms[1];
+    PG_EXPECT_NEAR( skinned.positions[2], glm::vec3( blended * glm::vec4( 0, 0, 1, 1 ) ), 1e-5f );
+    PG_EXPECT_NEAR( skinned.positions[2], 0.5f * glm::vec3( 0, 0, 6 ) + 0.5f * glm::vec3( 1, 0, 0 ), 1e-5f );
+    PG_EXPECT_NEAR( glm::length( skinned.normals[3] ), 1.0f, 1e-5f );
+    PG_EXPECT_NEAR( Skinning::BlendJointTransforms( model.blendWeights[3], jointTransforms.data() )[3],
+                    0.25f * jointTransforms[0][3] + 0.75f * jointTransforms[1][3], 1e-6f );
+}
@@ -0,0 +1,203 @@
+#include "unit_test.hpp"
+#include "getopt/getopt.h"
+#include "graphics/vulkan.hpp"
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <regex>
+#include <vector>
+
+namespace Progression
+{
+namespace Test
+{
+
+    struct TestCase
+    {
+        std::string name;
+        std::function< void() > func;
+    };
+
+    static std::vector< TestCase >& GetRegistry()
+    {
+        static std::vector< TestCase > registry;
+        return registry;
+    }
+
+    // Failures of the test that is currently running
+    static uint32_t s_numFailures = 0;
+
+    bool Register( const std::string& name, const std::function< void() >& func )
+    {
+        GetRegistry().push_back( { name, func } );
+        return true;
+    }
+
+    bool Expect( bool passed, const char* expression, const char* file, int line )
+    {
+        if ( !passed )
+        {
+            ++s_numFailures;
+            std::cout << file << ":" << line << ": expected " << expression << std::endl;
+        }
+        return passed;
+    }
+
+    bool ExpectNear( float a, float b, float epsilon, const char* expression, const char* file, int line )
+    {
+        bool passed = std::abs( a - b ) <= epsilon;
+        if ( !passed )
+        {
+            ++s_numFailures;
+            std::cout << file << ":" << line << ": expected " << expression << " within " << epsilon << ", got " << a << " and " << b << std::endl;
+        }
+        return passed;
+    }
+
+    template < typename Vec >
+    static bool ExpectNearVec( const Vec& a, const Vec& b, float epsilon, const char* expression, const char* file, int line )
+    {
+        bool passed = true;
+        for ( int i = 0; i < Vec::length(); ++i )
+        {
+            passed = passed && std::abs( a[i] - b[i] ) <= epsilon;
+        }
+        if ( !passed )
+        {
+            ++s_numFailures;
+            std::cout << file << ":" << line << ": expected " << expression << " within " << epsilon << ", got (";
+            for ( int i = 0; i < Vec::length(); ++i )
+            {
+                std::cout << ( i ? ", " : "" ) << a[i];
+            }
+            std::cout << ") and (";
+            for ( int i = 0; i < Vec::length(); ++i )
+            {
+                std::cout << ( i ? ", " : "" ) << b[i];
+            }
+            std::cout << ")" << std::endl;
+        }
+        return passed;
+    }
+
+    bool ExpectNear( const glm::vec2& a, const glm::vec2& b, float epsilon, const char* expression, const char* file, int line )
+    {
+        return ExpectNearVec( a, b, epsilon, expression, file, line );
+    }
+
+    bool ExpectNear( const glm::vec3& a, const glm::vec3& b, float epsilon, const char* expression, const char* file, int line )
+    {
+        return ExpectNearVec( a, b, epsilon, expression, file, line );
+    }
+
+    bool ExpectNear( const glm::vec4& a, const glm::vec4& b, float epsilon, const char* expression, const char* file, int line )
+    {
+        return ExpectNearVec( a, b, epsilon, expression, file, line );
+    }
+
+    static void DisplayHelp( const char* executable )
+    {
+        std::cout << "Usage: " << executable << " [options]\n"
+            "Runs the registered unit tests, and exits with 1 if any of them failed\n"
+            "\nOptions\n"
+            "  -f, --filter REGEX\tOnly run the tests whose name matches\n"
+            "  -h, --help\t\tPrint this message and exit\n"
+            "  -l, --list\t\tList the tests that would run and exit\n" << std::endl;
+    }
+
+    int RunTests( int argc, char* argv[] )
+    {
+        static struct option long_options[] = {
+            { "filter", required_argument, 0, 'f' },
+            { "help",   no_argument,       0, 'h' },
+            { "list",   no_argument,       0, 'l' },
+            { 0, 0, 0, 0 }
+        };
+
+        std::string filter = ".*";
+        bool listOnly      = false;
+        int option_index   = 0;
+        int c              = -1;
+        while ( ( c = getopt_long( argc, argv, "f:hl", long_options, &option_index ) ) != -1 )
+        {
+            switch ( c )
+            {
+                case 'f':
+                    filter = optarg;
+                    break;
+                case 'h':
+                    DisplayHelp( argv[0] );
+                    return 0;
+                case 'l':
+                    listOnly = true;
+                    break;
+                case '?':
+                    std::cout << "Try '" << argv[0] << " --help' for more information" << std::endl;
+                    return 1;
+                default:
+                    break;
+            }
+        }
+
+        std::regex filterRegex;
+        try
+        {
+            filterRegex = std::regex( filter );
+        }
+        catch ( const std::regex_error& )
+        {
+            std::cout << "Invalid filter regex '" << filter << "'" << std::endl;
+            return 1;
+        }
+
+        uint32_t numRun = 0;
+        std::vector< std::string > failed;
+        for ( const TestCase& test : GetRegistry() )
+        {
+            if ( !std::regex_search( test.name, filterRegex ) )
+            {
+                continue;
+            }
+            if ( listOnly )
+            {
+                std::cout << test.name << std::endl;
+                continue;
+            }
+
+            std::cout << "[ RUN      ] " << test.name << std::endl;
+            s_numFailures = 0;
+            test.func();
+            ++numRun;
+            if ( s_numFailures )
+            {
+                failed.push_back( test.name );
+                std::cout << "[   FAILED ] " << test.name << std::endl;
+            }
+            else
+            {
+                std::cout << "[       OK ] " << test.name << std::endl;
+            }
+        }
+        if ( listOnly )
+        {
+            return 0;
+        }
+
+        std::cout << "\n" << numRun - failed.size() << " of " << numRun << " tests passed" << std::endl;
+        for ( const std::string& name : failed )
+        {
+            std::cout << "  FAILED: " << name << std::endl;
+        }
+
+        return failed.empty() ? 0 : 1;
+    }
+
+} // namespace Test
+} // namespace Progression
+
+int main( int argc, char* argv[] )
+{
+    // The tests never create a device, so nothing they load should try to upload to one
+    Progression::Gfx::g_headless = true;
+    return Progression::Test::RunTests( argc, argv );
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "core/math.hpp"
+#include <cstdint>
+#include <functional>
+#include <string>
+
+// A small harness for testing the engine code that never touches the device. Each test is a function
+// registered with PG_TEST, and fails if any of its expectations do:
+//
+//     PG_TEST( RangeAllocator_ReusesFreedRanges )
+//     {
+//         ...
+//         PG_EXPECT( offset == 0 );
+//         PG_EXPECT_NEAR( depth, 0.5f, 1e-6f );
+//     }
+//
+// The expectations return whether they passed, so a test can stop before indexing into something that
+// isn't there. coreTests runs every test whose name matches the filter, and exits with 1 if any failed
+
+#define _PG_TEST_CONCAT_INTERNAL( a, b ) a##b
+#define _PG_TEST_CONCAT( a, b ) _PG_TEST_CONCAT_INTERNAL( a, b )
+#define PG_TEST( name )                                                                                    \
+    static void name();                                                                                    \
+    static bool _PG_TEST_CONCAT( s_pgTest, name ) = Progression::Test::Register( #name, name );            \
+    static void name()
+
+#define PG_EXPECT( cond ) Progression::Test::Expect( static_cast< bool >( cond ), #cond, __FILE__, __LINE__ )
+#define PG_EXPECT_NEAR( a, b, epsilon ) Progression::Test::ExpectNear( a, b, epsilon, #a " ~= " #b, __FILE__, __LINE__ )
+
+namespace Progression
+{
+namespace Test
+{
+
+    bool Register( const std::string& name, const std::function< void() >& func );
+
+    bool Expect( bool passed, const char* expression, const char* file, int line );
+    bool ExpectNear( float a, float b, float epsilon, const char* expression, const char* file, int line );
+    bool ExpectNear( const glm::vec2& a, const glm::vec2& b, float epsilon, const char* expression, const char* file, int line );
+    bool ExpectNear( const glm::vec3& a, const glm::vec3& b, float epsilon, const char* expression, const char* file, int line );
+    bool ExpectNear( const glm::vec4& a, const glm::vec4& b, float epsilon, const char* expression, const char* file, int line );
+
+    // Parses the command line and runs every registered test that matches the filter. Returns the
+    // process exit code
+    int RunTests( int argc, char* argv[] );
+
+} // namespace Test
+} // namespace Progression
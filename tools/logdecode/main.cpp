@@ -0,0 +1,322 @@
+#include "getopt/getopt.h"
+#include "utils/binary_log.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <unordered_map>
+#include <vector>
+
+using namespace BinaryLog;
+
+struct Format
+{
+    uint32_t line;
+    std::vector< ArgType > argTypes;
+    std::string file;
+    std::string format;
+};
+
+struct DecodedMessage
+{
+    uint64_t timeNs;
+    uint32_t threadID;
+    const Format* format;
+    std::string text;
+};
+
+// Errors go to stderr so that they don't end up in the decoded output
+template < typename... Args >
+static void PrintError( const Args&... args )
+{
+    ( std::cerr << ... << args ) << std::endl;
+}
+
+static void DisplayHelp()
+{
+    auto msg =
+      "Usage: logdecode [--json] BINARY_LOG_FILE\n"
+      "Turns a binary log written by LOG_FAST back into text, sorted by time\n"
+      "\nOptions\n"
+      "  -h, --help\t\tPrint this message and exit\n"
+      "  -j, --json\t\tOutput a JSON array of messages instead of text\n";
+
+    std::cout << msg << std::endl;
+}
+
+class Reader
+{
+public:
+    Reader( const char* data, size_t size ) : m_data( data ), m_end( data + size ) {}
+
+    bool HasBytes( size_t numBytes ) const { return static_cast< size_t >( m_end - m_data ) >= numBytes; }
+    bool AtEnd() const { return m_data == m_end; }
+
+    template < typename T >
+    bool Read( T& value )
+    {
+        if ( !HasBytes( sizeof( T ) ) )
+        {
+            return false;
+        }
+        memcpy( &value, m_data, sizeof( T ) );
+        m_data += sizeof( T );
+        return true;
+    }
+
+    bool Read( std::string& str )
+    {
+        uint32_t len;
+        if ( !Read( len ) || !HasBytes( len ) )
+        {
+            return false;
+        }
+        str.assign( m_data, len );
+        m_data += len;
+        return true;
+    }
+
+    Reader SubReader( uint32_t numBytes )
+    {
+        Reader sub( m_data, numBytes );
+        m_data += numBytes;
+        return sub;
+    }
+
+private:
+    const char* m_data;
+    const char* m_end;
+};
+
+static bool ReadArg( Reader& reader, ArgType type, std::ostream& out )
+{
+    switch ( type )
+    {
+    case ArgType::INT32:  { int32_t v;  if ( !reader.Read( v ) ) return false; out << v; return true; }
+    case ArgType::UINT32: { uint32_t v; if ( !reader.Read( v ) ) return false; out << v; return true; }
+    case ArgType::INT64:  { int64_t v;  if ( !reader.Read( v ) ) return false; out << v; return true; }
+    case ArgType::UINT64: { uint64_t v; if ( !reader.Read( v ) ) return false; out << v; return true; }
+    case ArgType::FLOAT:  { float v;    if ( !reader.Read( v ) ) return false; out << v; return true; }
+    case ArgType::DOUBLE: { double v;   if ( !reader.Read( v ) ) return false; out << v; return true; }
+    case ArgType::BOOL:   { uint8_t v;  if ( !reader.Read( v ) ) return false; out << ( v ? "true" : "false" ); return true; }
+    case ArgType::STRING: { std::string v; if ( !reader.Read( v ) ) return false; out << v; return true; }
+    }
+
+    return false;
+}
+
+// Replaces each {} in the format with the next argument
+static bool DecodeMessage( Reader& reader, const Format& format, std::string& text )
+{
+    std::ostringstream out;
+    size_t pos = 0;
+    for ( ArgType type : format.argTypes )
+    {
+        size_t next = format.format.find( "{}", pos );
+        out << format.format.substr( pos, next == std::string::npos ? std::string::npos : next - pos );
+        if ( !ReadArg( reader, type, out ) )
+        {
+            return false;
+        }
+        pos = next == std::string::npos ? format.format.size() : next + 2;
+    }
+    out << format.format.substr( pos );
+    text = out.str();
+
+    return true;
+}
+
+static std::string EscapeJSON( const std::string& str )
+{
+    std::ostringstream out;
+    for ( char c : str )
+    {
+        switch ( c )
+        {
+        case '"':  out << "\\\""; break;
+        case '\\': out << "\\\\"; break;
+        case '\n': out << "\\n"; break;
+        case '\r': out << "\\r"; break;
+        case '\t': out << "\\t"; break;
+        default:
+            if ( static_cast< unsigned char >( c ) < 0x20 )
+            {
+                out << "\\u" << std::hex << std::setw( 4 ) << std::setfill( '0' ) << static_cast< int >( c ) << std::dec;
+            }
+            else
+            {
+                out << c;
+            }
+        }
+    }
+
+    return out.str();
+}
+
+static bool Decode( const std::string& contents, std::vector< DecodedMessage >& messages, std::unordered_map< uint32_t, Format >& formats )
+{
+    Reader reader( contents.data(), contents.size() );
+    FileHeader header;
+    if ( !reader.Read( header ) || header.magicNumber != MAGIC_NUMBER )
+    {
+        PrintError( "Not a binary log file" );
+        return false;
+    }
+    if ( header.version != VERSION )
+    {
+        PrintError( "Binary log version ", header.version, " is not supported, expected version ", VERSION );
+        return false;
+    }
+
+    while ( !reader.AtEnd() )
+    {
+        RecordType type;
+        if ( !reader.Read( type ) )
+        {
+            break;
+        }
+
+        if ( type == RecordType::FORMAT )
+        {
+            uint32_t id;
+            uint8_t numArgs;
+            Format format;
+            if ( !reader.Read( id ) || !reader.Read( format.line ) || !reader.Read( numArgs ) )
+            {
+                break;
+            }
+            format.argTypes.resize( numArgs );
+            bool ok = true;
+            for ( uint8_t i = 0; i < numArgs && ok; ++i )
+            {
+                ok = reader.Read( format.argTypes[i] );
+            }
+            if ( !ok || !reader.Read( format.file ) || !reader.Read( format.format ) )
+            {
+                break;
+            }
+            formats[id] = std::move( format );
+        }
+        else if ( type == RecordType::CHUNK )
+        {
+            uint32_t threadID, numBytes;
+            if ( !reader.Read( threadID ) || !reader.Read( numBytes ) || !reader.HasBytes( numBytes ) )
+            {
+                break;
+            }
+            Reader chunk = reader.SubReader( numBytes );
+            while ( !chunk.AtEnd() )
+            {
+                uint32_t id;
+                DecodedMessage msg;
+                msg.threadID = threadID;
+                if ( !chunk.Read( id ) || !chunk.Read( msg.timeNs ) )
+                {
+                    PrintError( "Truncated message in chunk from thread ", threadID );
+                    return false;
+                }
+                auto it = formats.find( id );
+                if ( it == formats.end() )
+                {
+                    PrintError( "Message uses unknown format ID ", id, ", can't decode the rest of the chunk" );
+                    return false;
+                }
+                msg.format = &it->second;
+                if ( !DecodeMessage( chunk, it->second, msg.text ) )
+                {
+                    PrintError( "Truncated arguments for format '", it->second.format, "'" );
+                    return false;
+                }
+                messages.push_back( std::move( msg ) );
+            }
+        }
+        else
+        {
+            PrintError( "Unknown record type ", static_cast< int >( type ) );
+            return false;
+        }
+    }
+
+    if ( !reader.AtEnd() )
+    {
+        PrintError( "Binary log ends with a partial record, the program writing it probably didn't shut down cleanly" );
+    }
+
+    // Each thread writes its own chunks, so messages from different threads are interleaved out of order
+    std::stable_sort( messages.begin(), messages.end(), []( const DecodedMessage& a, const DecodedMessage& b ) { return a.timeNs < b.timeNs; } );
+
+    return true;
+}
+
+int main( int argc, char* argv[] )
+{
+    static struct option long_options[] = {
+        { "help", no_argument, 0, 'h' },
+        { "json", no_argument, 0, 'j' },
+        { 0, 0, 0, 0 }
+    };
+
+    bool json        = false;
+    int option_index = 0;
+    int c            = -1;
+    while ( ( c = getopt_long( argc, argv, "hj", long_options, &option_index ) ) != -1 )
+    {
+        switch ( c )
+        {
+            case 'h':
+                DisplayHelp();
+                return 0;
+            case 'j':
+                json = true;
+                break;
+            case '?':
+                std::cout << "Try 'logdecode --help' for more information" << std::endl;
+                return 1;
+            default:
+                break;
+        }
+    }
+
+    if ( optind >= argc )
+    {
+        DisplayHelp();
+        return 1;
+    }
+
+    std::ifstream in( argv[optind], std::ios::binary );
+    if ( !in )
+    {
+        PrintError( "Could not open file '", argv[optind], "'" );
+        return 1;
+    }
+    std::string contents( ( std::istreambuf_iterator< char >( in ) ), std::istreambuf_iterator< char >() );
+
+    std::vector< DecodedMessage > messages;
+    std::unordered_map< uint32_t, Format > formats;
+    bool success = Decode( contents, messages, formats );
+
+    if ( json )
+    {
+        std::cout << "[\n";
+        for ( size_t i = 0; i < messages.size(); ++i )
+        {
+            const auto& msg = messages[i];
+            std::cout << "    { \"timeNs\": " << msg.timeNs << ", \"thread\": " << msg.threadID << ", \"file\": \"" << EscapeJSON( msg.format->file ) <<
+                "\", \"line\": " << msg.format->line << ", \"message\": \"" << EscapeJSON( msg.text ) << "\" }" << ( i + 1 < messages.size() ? ",\n" : "\n" );
+        }
+        std::cout << "]" << std::endl;
+    }
+    else
+    {
+        std::cout << std::fixed << std::setprecision( 3 );
+        for ( const auto& msg : messages )
+        {
+            std::cout << "[" << std::setw( 9 ) << msg.timeNs / 1e9 << "][T" << msg.threadID << "] " << msg.text << "\n";
+        }
+        std::cout << std::flush;
+    }
+
+    return success ? 0 : 1;
+}